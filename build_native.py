@@ -174,6 +174,10 @@ try:
     from .cpu_optimizer import *
     from .memory_manager import *
     from .parallel_executor import *
+    from . import corpus_scanner  # Module import: its scan() would shadow credential_utils.scan
+    from .ooxml_writer import *
+    from .template_engine import *
+    from . import tracing  # Module import: enable()/export() are too generic to flatten
     
     NATIVE_AVAILABLE = True
 except ImportError as e:
@@ -1,5 +1,6 @@
 """Main orchestrator agent for CredentialForge."""
 
+import os
 import time
 import random
 import multiprocessing as mp
@@ -10,7 +11,7 @@ import psutil
 
 # Removed redundant agents - functionality consolidated into ContentGenerationAgent
 from .content_generation_agent import ContentGenerationAgent
-from ..generators.credential_generator import CredentialGenerator
+from ..generators.credential_generator import CredentialGenerator, create_uniqueness_set
 from ..generators.topic_generator import TopicGenerator
 # Old synthesizers removed - using new format-only synthesizers
 # New format-only synthesizers
@@ -27,6 +28,7 @@ from ..db.regex_db import RegexDatabase
 from ..llm.llama_interface import LlamaInterface
 from ..utils.exceptions import GenerationError
 from ..utils.logger import Logger
+from ..utils.performance_monitor import trace_span
 # Removed PromptSystem - using simplified prompts
 
 
@@ -635,6 +637,11 @@ class OrchestratorAgent:
         files = []
         errors = []
         
+        # Only worker processes need the served model; in-process executors
+        # share self.llm directly
+        in_process = self._use_native_executor('pipeline') or self._use_native_executor('native')
+        server_socket = None if in_process else self._ensure_inference_server()
+        
         # Create tasks for parallel processing
         tasks = []
         for i in range(batch_files):
@@ -659,55 +666,58 @@ class OrchestratorAgent:
                 'regex_db_path': self.config.get('regex_db_path', './data/regex_db.json'),
                 'language': language,
                 'enable_parallel_llm': self.enable_parallel_llm,
-                'llm_model_path': self.llm.model_path if self.llm else None
+                'llm_model_path': self.llm.model_path if self.llm else None,
+                'llm_server_socket': server_socket
             })
         
         # Process tasks in parallel with enhanced error handling
         try:
-            with ProcessPoolExecutor(max_workers=max_concurrent_workers) as executor:
-                future_to_task = {
-                    executor.submit(self._generate_single_file_worker, task): task 
-                    for task in tasks
-                }
+            if self._use_native_executor('pipeline'):
+                results = self._run_batch_pipeline(tasks, max_concurrent_workers)
+                for task, result in zip(tasks, results):
+                    self._record_worker_result(task, result, files, errors)
+            elif self._use_native_executor('native'):
+                # Native worker threads share this process, so tasks and the
+                # loaded model are passed by reference instead of pickled
+                from ..native import parallel_executor
+                parallel_executor.init_executor(max_concurrent_workers)
+                futures = parallel_executor.submit_many(
+                    self._generate_single_file_worker, [(task, self.llm) for task in tasks])
                 
-                completed_count = 0
-                for future in as_completed(future_to_task, timeout=600):  # 10 minute timeout for entire batch
-                    task = future_to_task[future]
+                for completed_count, (task, future) in enumerate(zip(tasks, futures), 1):
                     try:
-                        result = future.result(timeout=300)  # 5 minute timeout per file
-                        print(f"DEBUG: Worker result: success={result.get('success', 'unknown')}")
-                        if result['success']:
-                            # Extract just the file path, not the entire file dict
-                            file_info = result['file']
-                            print(f"DEBUG: Raw file_info: {type(file_info)} - {file_info}")
-                            if isinstance(file_info, dict) and 'path' in file_info:
-                                file_path = file_info['path']
-                                files.append(file_path)
-                                print(f"DEBUG: Extracted path from dict: {file_path}")
-                            else:
-                                file_path = str(file_info)
-                                files.append(file_path)
-                                print(f"DEBUG: Used file_info directly: {file_path}")
-                            print(f"DEBUG: Files list now has {len(files)} files")
-                            # Update credential stats
-                            if 'credentials_count' in result:
-                                self.generation_stats['total_credentials'] += result['credentials_count']
-                                cred_type = result.get('credential_type', 'unknown')
-                                self.generation_stats['credentials_by_type'][cred_type] = \
-                                    self.generation_stats['credentials_by_type'].get(cred_type, 0) + result['credentials_count']
-                        else:
-                            print(f"DEBUG: Worker failed: {result.get('error', 'unknown error')}")
-                            errors.append(f"File {task['file_index']}: {result['error']}")
-                        
-                        completed_count += 1
-                        
-                        # Progress logging
-                        if completed_count % 5 == 0:
-                            self.logger.info(f"Completed {completed_count}/{batch_files} files in parallel batch")
-                            
+                        result = future.result(300)  # 5 minute timeout per file
+                        self._record_worker_result(task, result, files, errors)
                     except Exception as e:
                         errors.append(f"File {task['file_index']}: {e}")
-                        completed_count += 1
+                    
+                    if completed_count % 5 == 0:
+                        self.logger.info(f"Completed {completed_count}/{batch_files} files in parallel batch")
+            else:
+                # Workers deduplicate credentials through one shared set
+                with ProcessPoolExecutor(max_workers=max_concurrent_workers,
+                                         initializer=self._init_worker_process,
+                                         initargs=(self._ensure_shared_dedup_set(),)) as executor:
+                    future_to_task = {
+                        executor.submit(self._generate_single_file_worker, task): task 
+                        for task in tasks
+                    }
+                    
+                    completed_count = 0
+                    for future in as_completed(future_to_task, timeout=600):  # 10 minute timeout for entire batch
+                        task = future_to_task[future]
+                        try:
+                            result = future.result(timeout=300)  # 5 minute timeout per file
+                            self._record_worker_result(task, result, files, errors)
+                            completed_count += 1
+                            
+                            # Progress logging
+                            if completed_count % 5 == 0:
+                                self.logger.info(f"Completed {completed_count}/{batch_files} files in parallel batch")
+                                
+                        except Exception as e:
+                            errors.append(f"File {task['file_index']}: {e}")
+                            completed_count += 1
                         
         except Exception as e:
             self.logger.error(f"Multiprocessing failed, falling back to sequential: {e}")
@@ -736,169 +746,330 @@ class OrchestratorAgent:
         
         return {'files': files, 'errors': errors}
     
+    def _use_native_executor(self, mode: str) -> bool:
+        """Whether parallel batches run natively in `mode` ('native' or 'pipeline')."""
+        if self.config.get('executor', 'process') != mode:
+            return False
+        from ..native import NATIVE_AVAILABLE
+        return NATIVE_AVAILABLE
+    
+    def _run_batch_pipeline(self, tasks: List[Dict[str, Any]],
+                            max_concurrent_workers: int) -> List[Dict[str, Any]]:
+        """Run a batch through native content and synthesis stages.
+        
+        Content generation for later files overlaps with writing earlier
+        ones. Stage sizes come from the 'pipeline_workers' config, e.g.
+        {'content': 4, 'synthesize': 2}; the logged stage stats show which
+        one to grow.
+        
+        Returns:
+            Worker result dictionaries in task order
+        """
+        from ..native import parallel_executor
+        
+        # Tasks in one batch share the output directory, regex DB and model
+        components = self._create_worker_components(tasks[0], self.llm)
+        
+        def content(task):
+            try:
+                with trace_span('pipeline.content'):
+                    return task, self._generate_worker_content(task, components), None
+            except Exception as e:
+                return task, None, str(e)
+        
+        def synthesize(item):
+            task, content_data, error = item
+            if error is not None:
+                return {'success': False, 'error': error}
+            try:
+                return self._synthesize_worker_file(task, content_data, components)
+            except Exception as e:
+                return {'success': False, 'error': str(e)}
+        
+        workers = self.config.get('pipeline_workers', {})
+        pipeline = parallel_executor.Pipeline([
+            (content, workers.get('content', max_concurrent_workers), 'content'),
+            (synthesize, workers.get('synthesize', 2), 'synthesize'),
+        ], self.config.get('pipeline_capacity', 8))
+        results = pipeline.run(tasks)
+        
+        stats = pipeline.stats()
+        self.generation_stats['pipeline_bottleneck'] = stats['bottleneck']
+        for stage in stats['stages']:
+            self.logger.info(f"Pipeline stage {stage['name']}: {stage['workers']} workers, "
+                             f"{stage['utilization']:.0%} busy, {stage['input_wait_time']:.2f}s starved, "
+                             f"{stage['output_wait_time']:.2f}s blocked")
+        return results
+    
+    def _record_worker_result(self, task: Dict[str, Any], result: Dict[str, Any],
+                              files: List[str], errors: List[str]) -> None:
+        """Collect one worker result into the batch file and error lists."""
+        print(f"DEBUG: Worker result: success={result.get('success', 'unknown')}")
+        if result['success']:
+            # Extract just the file path, not the entire file dict
+            file_info = result['file']
+            print(f"DEBUG: Raw file_info: {type(file_info)} - {file_info}")
+            if isinstance(file_info, dict) and 'path' in file_info:
+                file_path = file_info['path']
+                files.append(file_path)
+                print(f"DEBUG: Extracted path from dict: {file_path}")
+            else:
+                file_path = str(file_info)
+                files.append(file_path)
+                print(f"DEBUG: Used file_info directly: {file_path}")
+            print(f"DEBUG: Files list now has {len(files)} files")
+            # Update credential stats
+            if 'credentials_count' in result:
+                self.generation_stats['total_credentials'] += result['credentials_count']
+                cred_type = result.get('credential_type', 'unknown')
+                self.generation_stats['credentials_by_type'][cred_type] = \
+                    self.generation_stats['credentials_by_type'].get(cred_type, 0) + result['credentials_count']
+        else:
+            print(f"DEBUG: Worker failed: {result.get('error', 'unknown error')}")
+            errors.append(f"File {task['file_index']}: {result['error']}")
+    
+    def _ensure_inference_server(self) -> Optional[str]:
+        """Start serving the shared model to worker processes, once.
+        
+        Only the process executor calls this. Serving moves self.llm onto
+        the native model it loads, so the orchestrator keeps one copy.
+        
+        Returns:
+            Socket path, or None if workers should load their own model
+        """
+        if not self.llm or not hasattr(self.llm, 'start_inference_server'):
+            return None
+        if not hasattr(self, '_inference_server_socket'):
+            self._inference_server_socket = self.llm.start_inference_server()
+        return self._inference_server_socket
+    
+    def _ensure_shared_dedup_set(self) -> Optional[str]:
+        """Create the fingerprint set worker processes share, once.
+        
+        The orchestrator holds it for its own lifetime, so the segment stays
+        in place while workers attach; the last process to release it
+        removes it.
+        
+        Returns:
+            Shared-memory name, or None without the native module
+        """
+        if not hasattr(self, '_shared_dedup_name'):
+            self._shared_dedup_name = None
+            name = f"credentialforge-dedup-{os.getpid()}-{id(self):x}"
+            try:
+                dedup_set = create_uniqueness_set(shared_name=name)
+            except OSError as e:
+                self.logger.warning(f"Shared credential deduplication unavailable: {e}")
+                dedup_set = set()
+            if not isinstance(dedup_set, set):
+                self._shared_dedup_set = dedup_set
+                self._shared_dedup_name = name
+        return self._shared_dedup_name
+    
     @staticmethod
-    def _generate_single_file_worker(task: Dict[str, Any]) -> Dict[str, Any]:
+    def _init_worker_process(dedup_name: Optional[str]) -> None:
+        """Point a worker process's credential generators at the shared set."""
+        if dedup_name:
+            os.environ['CREDENTIALFORGE_DEDUP_SHM'] = dedup_name
+    
+    @staticmethod
+    def _generate_single_file_worker(task: Dict[str, Any],
+                                     llm_interface: Optional[LlamaInterface] = None) -> Dict[str, Any]:
         """Worker function for multiprocessing file generation."""
         try:
-            # Import here to avoid issues with multiprocessing
-            from ..generators.credential_generator import CredentialGenerator
-            from ..generators.topic_generator import TopicGenerator
-            from ..synthesizers.format_synthesizer import FormatSynthesizer
-            from ..synthesizers.eml_format_synthesizer import EMLFormatSynthesizer
-            from ..synthesizers.msg_format_synthesizer import MSGFormatSynthesizer
-            from ..synthesizers.excel_format_synthesizer import ExcelFormatSynthesizer
-            from ..synthesizers.word_format_synthesizer import WordFormatSynthesizer, RTFFormatSynthesizer
-            from ..synthesizers.pptx_format_synthesizer import PPTXFormatSynthesizer
-            from ..synthesizers.opendocument_format_synthesizer import OpenDocumentFormatSynthesizer
-            from ..synthesizers.pdf_format_synthesizer import PDFFormatSynthesizer
-            from ..synthesizers.image_format_synthesizer import ImageFormatSynthesizer
-            from ..synthesizers.visio_format_synthesizer import VisioFormatSynthesizer
-            from ..db.regex_db import RegexDatabase
-            from pathlib import Path
-            import time
-            
-            # Initialize components in worker process
-            regex_db = RegexDatabase(task.get('regex_db_path', './data/regex_db.json'))
-            from ..utils.prompt_system import EnhancedPromptSystem
-            prompt_system = EnhancedPromptSystem()
-            
-            # Initialize LLM interface in worker process if model path is available
-            llm_interface = None
-            if 'llm_model_path' in task and task['llm_model_path']:
-                try:
-                    # Add a small delay to avoid concurrent model loading
-                    import random
-                    time.sleep(random.uniform(0.1, 0.5))
-                    
-                    from ..llm.llama_interface import LlamaInterface
-                    # Use minimal settings for worker processes to avoid memory issues
-                    llm_interface = LlamaInterface(
-                        task['llm_model_path'],
-                        n_threads=2,  # Reduced threads for worker processes
-                        n_ctx=1024,   # Reduced context for worker processes
-                        n_batch=128   # Reduced batch size for worker processes
-                    )
-                except Exception as e:
-                    print(f"Warning: Failed to initialize LLM in worker process: {e}")
-                    llm_interface = None
-            
-            credential_generator = CredentialGenerator(regex_db=regex_db)
-            topic_generator = TopicGenerator()
-            
-            # Log successful initialization
-            print(f"DEBUG: CredentialGenerator agent initialized successfully with LLM interface and prompt system")
+            components = OrchestratorAgent._create_worker_components(task, llm_interface)
+            content_data = OrchestratorAgent._generate_worker_content(task, components)
+            return OrchestratorAgent._synthesize_worker_file(task, content_data, components)
             
-            synthesizers = {
-                # Email formats
-                'eml': EMLFormatSynthesizer(str(task['output_dir'])),
-                'msg': MSGFormatSynthesizer(str(task['output_dir'])),
-                
-                # Excel formats
-                'xlsm': ExcelFormatSynthesizer(str(task['output_dir']), 'xlsm'),
-                'xlsx': ExcelFormatSynthesizer(str(task['output_dir']), 'xlsx'),
-                'xltm': ExcelFormatSynthesizer(str(task['output_dir']), 'xltm'),
-                'xls': ExcelFormatSynthesizer(str(task['output_dir']), 'xls'),
-                'xlsb': ExcelFormatSynthesizer(str(task['output_dir']), 'xlsb'),
-                
-                # Word formats
-                'docx': WordFormatSynthesizer(str(task['output_dir']), 'docx'),
-                'doc': WordFormatSynthesizer(str(task['output_dir']), 'doc'),
-                'docm': WordFormatSynthesizer(str(task['output_dir']), 'docm'),
-                'rtf': RTFFormatSynthesizer(str(task['output_dir'])),
-                
-                # PowerPoint formats
-                'pptx': PPTXFormatSynthesizer(str(task['output_dir'])),
-                'ppt': PPTXFormatSynthesizer(str(task['output_dir'])),
-                
-                # OpenDocument formats
-                'odf': OpenDocumentFormatSynthesizer(str(task['output_dir']), 'odf'),
-                'ods': OpenDocumentFormatSynthesizer(str(task['output_dir']), 'ods'),
-                'odp': OpenDocumentFormatSynthesizer(str(task['output_dir']), 'odp'),
-                
-                # PDF format
-                'pdf': PDFFormatSynthesizer(str(task['output_dir'])),
-                
-                # Image formats
-                'png': ImageFormatSynthesizer(str(task['output_dir']), 'png'),
-                'jpg': ImageFormatSynthesizer(str(task['output_dir']), 'jpg'),
-                'jpeg': ImageFormatSynthesizer(str(task['output_dir']), 'jpeg'),
-                'bmp': ImageFormatSynthesizer(str(task['output_dir']), 'bmp'),
+        except Exception as e:
+            return {'success': False, 'error': str(e)}
+    
+    @staticmethod
+    def _create_worker_components(task: Dict[str, Any],
+                                  llm_interface: Optional[LlamaInterface] = None) -> Dict[str, Any]:
+        """Build the content agent and synthesizers a worker needs for `task`.
+        
+        Args:
+            task: Task dictionary built by _generate_batch_parallel
+            llm_interface: Loaded model to share; otherwise the worker connects
+                to the inference server or loads its own copy
+        """
+        # Import here to avoid issues with multiprocessing
+        from ..generators.credential_generator import CredentialGenerator
+        from ..generators.topic_generator import TopicGenerator
+        from ..synthesizers.format_synthesizer import FormatSynthesizer
+        from ..synthesizers.eml_format_synthesizer import EMLFormatSynthesizer
+        from ..synthesizers.msg_format_synthesizer import MSGFormatSynthesizer
+        from ..synthesizers.excel_format_synthesizer import ExcelFormatSynthesizer
+        from ..synthesizers.word_format_synthesizer import WordFormatSynthesizer, RTFFormatSynthesizer
+        from ..synthesizers.pptx_format_synthesizer import PPTXFormatSynthesizer
+        from ..synthesizers.opendocument_format_synthesizer import OpenDocumentFormatSynthesizer
+        from ..synthesizers.pdf_format_synthesizer import PDFFormatSynthesizer
+        from ..synthesizers.image_format_synthesizer import ImageFormatSynthesizer
+        from ..synthesizers.visio_format_synthesizer import VisioFormatSynthesizer
+        from ..db.regex_db import RegexDatabase
+        from pathlib import Path
+        import time
+        
+        # Initialize components in worker process
+        regex_db = RegexDatabase(task.get('regex_db_path', './data/regex_db.json'))
+        from ..utils.prompt_system import EnhancedPromptSystem
+        prompt_system = EnhancedPromptSystem()
+        
+        # Prefer the parent's inference server over loading another model copy
+        if llm_interface is None and task.get('llm_server_socket'):
+            try:
+                from ..llm.llama_interface import RemoteLlamaInterface
+                llm_interface = RemoteLlamaInterface(task['llm_server_socket'], task.get('llm_model_path'))
+            except Exception as e:
+                print(f"Warning: Failed to connect to inference server: {e}")
+                llm_interface = None
+        
+        # Initialize LLM interface in worker process if model path is available
+        if llm_interface is None and 'llm_model_path' in task and task['llm_model_path']:
+            try:
+                # Add a small delay to avoid concurrent model loading
+                import random
+                time.sleep(random.uniform(0.1, 0.5))
                 
-                # Visio formats
-                'vsd': VisioFormatSynthesizer(str(task['output_dir']), 'vsd'),
-                'vsdx': VisioFormatSynthesizer(str(task['output_dir']), 'vsdx'),
-                'vsdm': VisioFormatSynthesizer(str(task['output_dir']), 'vsdm'),
-                'vssx': VisioFormatSynthesizer(str(task['output_dir']), 'vssx'),
-                'vssm': VisioFormatSynthesizer(str(task['output_dir']), 'vssm'),
-                'vstx': VisioFormatSynthesizer(str(task['output_dir']), 'vstx'),
-                'vstm': VisioFormatSynthesizer(str(task['output_dir']), 'vstm')
+                from ..llm.llama_interface import LlamaInterface
+                # Use minimal settings for worker processes to avoid memory issues
+                llm_interface = LlamaInterface(
+                    task['llm_model_path'],
+                    n_threads=2,  # Reduced threads for worker processes
+                    n_ctx=1024,   # Reduced context for worker processes
+                    n_batch=128   # Reduced batch size for worker processes
+                )
+            except Exception as e:
+                print(f"Warning: Failed to initialize LLM in worker process: {e}")
+                llm_interface = None
+        
+        credential_generator = CredentialGenerator(regex_db=regex_db)
+        topic_generator = TopicGenerator()
+        
+        # Log successful initialization
+        print(f"DEBUG: CredentialGenerator agent initialized successfully with LLM interface and prompt system")
+        
+        synthesizers = {
+            # Email formats
+            'eml': EMLFormatSynthesizer(str(task['output_dir'])),
+            'msg': MSGFormatSynthesizer(str(task['output_dir'])),
+            
+            # Excel formats
+            'xlsm': ExcelFormatSynthesizer(str(task['output_dir']), 'xlsm'),
+            'xlsx': ExcelFormatSynthesizer(str(task['output_dir']), 'xlsx'),
+            'xltm': ExcelFormatSynthesizer(str(task['output_dir']), 'xltm'),
+            'xls': ExcelFormatSynthesizer(str(task['output_dir']), 'xls'),
+            'xlsb': ExcelFormatSynthesizer(str(task['output_dir']), 'xlsb'),
+            
+            # Word formats
+            'docx': WordFormatSynthesizer(str(task['output_dir']), 'docx'),
+            'doc': WordFormatSynthesizer(str(task['output_dir']), 'doc'),
+            'docm': WordFormatSynthesizer(str(task['output_dir']), 'docm'),
+            'rtf': RTFFormatSynthesizer(str(task['output_dir'])),
+            
+            # PowerPoint formats
+            'pptx': PPTXFormatSynthesizer(str(task['output_dir'])),
+            'ppt': PPTXFormatSynthesizer(str(task['output_dir'])),
+            
+            # OpenDocument formats
+            'odf': OpenDocumentFormatSynthesizer(str(task['output_dir']), 'odf'),
+            'ods': OpenDocumentFormatSynthesizer(str(task['output_dir']), 'ods'),
+            'odp': OpenDocumentFormatSynthesizer(str(task['output_dir']), 'odp'),
+            
+            # PDF format
+            'pdf': PDFFormatSynthesizer(str(task['output_dir'])),
+            
+            # Image formats
+            'png': ImageFormatSynthesizer(str(task['output_dir']), 'png'),
+            'jpg': ImageFormatSynthesizer(str(task['output_dir']), 'jpg'),
+            'jpeg': ImageFormatSynthesizer(str(task['output_dir']), 'jpeg'),
+            'bmp': ImageFormatSynthesizer(str(task['output_dir']), 'bmp'),
+            
+            # Visio formats
+            'vsd': VisioFormatSynthesizer(str(task['output_dir']), 'vsd'),
+            'vsdx': VisioFormatSynthesizer(str(task['output_dir']), 'vsdx'),
+            'vsdm': VisioFormatSynthesizer(str(task['output_dir']), 'vsdm'),
+            'vssx': VisioFormatSynthesizer(str(task['output_dir']), 'vssx'),
+            'vssm': VisioFormatSynthesizer(str(task['output_dir']), 'vssm'),
+            'vstx': VisioFormatSynthesizer(str(task['output_dir']), 'vstx'),
+            'vstm': VisioFormatSynthesizer(str(task['output_dir']), 'vstm')
+        }
+        
+        # Initialize content generation agent
+        from ..agents.content_generation_agent import ContentGenerationAgent
+        content_agent = ContentGenerationAgent(
+            llm_interface=llm_interface,  # Use the LLM interface we initialized (may be None)
+            language_mapper=None,
+            regex_db=regex_db
+        )
+        
+        return {'content_agent': content_agent, 'synthesizers': synthesizers}
+    
+    @staticmethod
+    def _generate_worker_content(task: Dict[str, Any], components: Dict[str, Any]) -> Dict[str, Any]:
+        """Generate topic content and embedded credentials for one file."""
+        # Generate all content using the content generation agent
+        content_data = components['content_agent'].generate_content(
+            topic=task['topic'],
+            credential_types=[task['credential_type']],
+            language=task.get('language', 'en'),
+            format_type=task['file_format'],
+            context={
+                'file_index': task['file_index'],
+                'generation_timestamp': time.time(),
+                'min_credentials_per_file': 1,
+                'max_credentials_per_file': 1
             }
-            
-            # Initialize content generation agent
-            from ..agents.content_generation_agent import ContentGenerationAgent
-            content_agent = ContentGenerationAgent(
-                llm_interface=llm_interface,  # Use the LLM interface we initialized (may be None)
-                language_mapper=None,
-                regex_db=regex_db
-            )
-            
-            # Generate all content using the content generation agent
-            content_data = content_agent.generate_content(
-                topic=task['topic'],
-                credential_types=[task['credential_type']],
-                language=task.get('language', 'en'),
-                format_type=task['file_format'],
-                context={
-                    'file_index': task['file_index'],
-                    'generation_timestamp': time.time(),
-                    'min_credentials_per_file': 1,
-                    'max_credentials_per_file': 1
-                }
-            )
-            
-            # Debug: Log credential generation
-            if 'credentials' in content_data and content_data['credentials']:
-                for cred in content_data['credentials']:
-                    print(f"DEBUG: Generated {cred.get('type', 'unknown')} credential: {cred.get('value', 'N/A')}")
-            
-            # Generate file
-            synthesizer = synthesizers.get(task['file_format'])
-            if not synthesizer:
-                return {'success': False, 'error': f'Unsupported format: {task["file_format"]}'}
-            
+        )
+        
+        # Debug: Log credential generation
+        if 'credentials' in content_data and content_data['credentials']:
+            for cred in content_data['credentials']:
+                print(f"DEBUG: Generated {cred.get('type', 'unknown')} credential: {cred.get('value', 'N/A')}")
+        
+        return content_data
+    
+    @staticmethod
+    def _synthesize_worker_file(task: Dict[str, Any], content_data: Dict[str, Any],
+                                components: Dict[str, Any]) -> Dict[str, Any]:
+        """Write one file from generated content and describe the result."""
+        # Generate file
+        synthesizer = components['synthesizers'].get(task['file_format'])
+        if not synthesizer:
+            return {'success': False, 'error': f'Unsupported format: {task["file_format"]}'}
+        
+        with trace_span(f"synthesize.{task['file_format']}", 'documents'):
             file_path = synthesizer.synthesize(content_data)
-            
-            # Debug: Check what synthesizer returned
-            print(f"DEBUG: Synthesizer returned: {type(file_path)} - {file_path}")
-            
-            # Ensure file_path is a string, not a dict
-            if isinstance(file_path, dict):
-                # Extract path from dict if needed
-                if 'path' in file_path:
-                    file_path = file_path['path']
-                elif 'file_path' in file_path:
-                    file_path = file_path['file_path']
-                elif 'filepath' in file_path:
-                    file_path = file_path['filepath']
-                else:
-                    # Convert dict to string as fallback
-                    file_path = str(file_path)
-                print(f"DEBUG: Converted dict to path: {file_path}")
-            
-            return {
-                'success': True, 
-                'file': {
-                    'path': str(file_path),
-                    'format': task['file_format'],
-                    'topic': task['topic'],
-                    'credential_type': task['credential_type']
-                },
-                'credentials_count': 1,
+        
+        # Debug: Check what synthesizer returned
+        print(f"DEBUG: Synthesizer returned: {type(file_path)} - {file_path}")
+        
+        # Ensure file_path is a string, not a dict
+        if isinstance(file_path, dict):
+            # Extract path from dict if needed
+            if 'path' in file_path:
+                file_path = file_path['path']
+            elif 'file_path' in file_path:
+                file_path = file_path['file_path']
+            elif 'filepath' in file_path:
+                file_path = file_path['filepath']
+            else:
+                # Convert dict to string as fallback
+                file_path = str(file_path)
+            print(f"DEBUG: Converted dict to path: {file_path}")
+        
+        return {
+            'success': True, 
+            'file': {
+                'path': str(file_path),
+                'format': task['file_format'],
+                'topic': task['topic'],
                 'credential_type': task['credential_type']
-            }
-            
-        except Exception as e:
-            return {'success': False, 'error': str(e)}
+            },
+            'credentials_count': 1,
+            'credential_type': task['credential_type']
+        }
     
     def _generate_batch_sequential(self, batch_files: int, formats: List[str], 
                                   topics: List[str], credential_types: List[str],
@@ -991,7 +1162,8 @@ class OrchestratorAgent:
                 
                 output_path = output_dir / f"{file_format}_{topic.replace(' ', '_')}_{batch_start + i}.{file_format}"
                 
-                file_path = synthesizer.synthesize(content_data)
+                with trace_span(f'synthesize.{file_format}', 'documents'):
+                    file_path = synthesizer.synthesize(content_data)
                 
                 # Append just the file path string, not a dictionary
                 files.append(str(file_path))
@@ -1156,7 +1328,8 @@ class OrchestratorAgent:
             }
             
             # Generate file using the new format synthesizer
-            file_path = synthesizer.synthesize(content_data)
+            with trace_span(f'synthesize.{format_name}', 'documents'):
+                file_path = synthesizer.synthesize(content_data)
             
             return {
                 'success': True,
@@ -1,5 +1,6 @@
 """Fast credential generation using regex database patterns."""
 
+import os
 import re
 import random
 import string
@@ -9,6 +10,32 @@ from typing import Dict, List, Optional, Set, Any
 from ..db.regex_db import RegexDatabase
 from ..utils.exceptions import GenerationError, ValidationError
 
+try:
+    from ..native import credential_utils
+except ImportError:
+    credential_utils = None
+
+
+def create_uniqueness_set(capacity: int = 1 << 20, shared_name: Optional[str] = None):
+    """Create the set used to track generated credentials.
+    
+    Uses the native fingerprint set when available (8 bytes per credential
+    instead of the string). With a shared-memory name (by default from
+    CREDENTIALFORGE_DEDUP_SHM) all processes using that name share one set.
+    
+    Args:
+        capacity: Expected number of credentials
+        shared_name: Shared-memory segment name, overriding the environment
+        
+    Returns:
+        Set-like object supporting ``add``, ``in``, ``len`` and ``clear``
+    """
+    if credential_utils is None or not hasattr(credential_utils, 'FingerprintSet'):
+        return set()
+    
+    shared_name = shared_name or os.environ.get('CREDENTIALFORGE_DEDUP_SHM') or None
+    return credential_utils.FingerprintSet(capacity, 8 if shared_name else 0, shared_name)
+
 
 class CredentialGenerator:
     """Fast credential generator using regex database patterns."""
@@ -20,7 +47,7 @@ class CredentialGenerator:
             regex_db: RegexDatabase instance containing patterns
         """
         self.regex_db = regex_db
-        self.generated_credentials: Set[str] = set()
+        self.generated_credentials = create_uniqueness_set()
         self.generation_stats = {
             'total_generated': 0,
             'by_type': {},
@@ -53,21 +80,19 @@ class CredentialGenerator:
             # Generate credential using fast fallback
             credential = self._generate_fast(credential_type, pattern, context)
             
-            # Ensure uniqueness within session
+            # Ensure uniqueness within session; add() returns False when another
+            # process sharing the set claimed the value first, so retry that too
             attempts = 0
-            max_attempts = 10  # Increased attempts to avoid timestamp fallback
-            while credential in self.generated_credentials and attempts < max_attempts:
+            max_attempts = 64
+            while (credential in self.generated_credentials or
+                   self.generated_credentials.add(credential) is False):
+                if attempts >= max_attempts:
+                    raise GenerationError(
+                        f"Could not generate a unique {credential_type} credential after {attempts} attempts")
                 credential = self._generate_fast(credential_type, pattern, context)
                 attempts += 1
             
-            if attempts >= max_attempts:
-                # Instead of adding timestamp suffix that breaks regex, regenerate with different seed
-                import time
-                random.seed(int(time.time() * 1000000))  # Use microsecond precision for better randomness
-                credential = self._generate_fast(credential_type, pattern, context)
-            
             # Track generation
-            self.generated_credentials.add(credential)
             self.generation_stats['total_generated'] += 1
             self.generation_stats['by_type'][credential_type] = \
                 self.generation_stats['by_type'].get(credential_type, 0) + 1
@@ -1,13 +1,15 @@
 """LLM interface for offline inference using llama.cpp."""
 
 import os
+import tempfile
 import time
 import psutil
 import requests
 import threading
 import gc
+import json
 from pathlib import Path
-from typing import Dict, List, Optional, Any, Union
+from typing import Callable, Dict, List, Optional, Any, Union
 from concurrent.futures import ThreadPoolExecutor, as_completed
 from .exceptions import LLMError
 
@@ -39,7 +41,7 @@ class LlamaInterface:
         
         Args:
             model_path: Path to GGUF model file (can be relative to project root)
-            n_threads: Number of threads for inference
+            n_threads: Number of threads for inference (default: one per physical core)
             n_ctx: Context window size
             n_batch: Batch size for processing
             temperature: Sampling temperature
@@ -62,7 +64,9 @@ class LlamaInterface:
                 model_path = project_root / "models" / model_path
         
         self.model_path = str(Path(model_path).resolve())
-        self.n_threads = n_threads or min(psutil.cpu_count(), 8)
+        # SMT siblings add nothing to matmul throughput, so default to physical cores
+        self.n_threads = n_threads or psutil.cpu_count(logical=False) or psutil.cpu_count()
+        self.n_threads_explicit = n_threads is not None
         self.n_ctx = n_ctx
         self.n_batch = n_batch
         self.temperature = temperature
@@ -212,6 +216,8 @@ class LlamaInterface:
         Raises:
             LLMError: If generation fails
         """
+        if getattr(self, 'serving_native', False):
+            return self._generate_served([prompt], max_tokens, temperature, stop)[0]
         if not self.llm:
             raise LLMError("Model not loaded")
         
@@ -286,6 +292,8 @@ class LlamaInterface:
         Raises:
             LLMError: If generation fails
         """
+        if getattr(self, 'serving_native', False):
+            return self._generate_served(prompts, max_tokens, temperature, stop)
         if not self.llm:
             raise LLMError("Model not loaded")
         
@@ -319,6 +327,76 @@ class LlamaInterface:
         except Exception as e:
             raise LLMError(f"Batch generation failed: {e}")
     
+    def _generate_served(self, prompts: List[str], max_tokens: Optional[int],
+                         temperature: Optional[float], stop: Optional[List[str]]) -> List[str]:
+        """Generate on the native model this process serves to workers."""
+        start_time = time.time()
+        max_tokens = max_tokens or self.max_tokens
+        temperature = temperature or self.temperature
+        stop = stop or ["</s>", "\n\n"]
+        
+        try:
+            results = llama_cpp_interface.generate_batch(list(prompts), max_tokens, temperature)
+        except RuntimeError as e:
+            raise LLMError(f"Text generation failed: {e}")
+        
+        trimmed = _trim_native_results(results, stop)
+        with self._lock:
+            self._update_performance_stats(max_tokens * len(prompts), time.time() - start_time)
+        return trimmed
+    
+    def generate_json(self, prompt: str, schema: Dict[str, Any],
+                      max_tokens: Optional[int] = None,
+                      temperature: Optional[float] = None) -> Any:
+        """Generate a JSON document matching a JSON schema.
+        
+        Decoding is constrained by a grammar compiled from the schema (once
+        per distinct schema), so the model can only produce matching JSON
+        and no retries for malformed output are needed.
+        
+        Args:
+            prompt: Input prompt
+            schema: JSON schema of the document
+            max_tokens: Maximum tokens to generate
+            temperature: Sampling temperature
+            
+        Returns:
+            The parsed document
+            
+        Raises:
+            LLMError: If generation fails or max_tokens cut the document short
+        """
+        start_time = time.time()
+        max_tokens = max_tokens or self.max_tokens
+        temperature = temperature or self.temperature
+        text = self._generate_constrained(prompt, schema, max_tokens, temperature)
+        with self._lock:
+            self._update_performance_stats(max_tokens, time.time() - start_time)
+        return _parse_json_result(text)
+    
+    def _generate_constrained(self, prompt: str, schema: Dict[str, Any],
+                              max_tokens: int, temperature: float) -> str:
+        """Schema-constrained completion, native when the model is loaded there."""
+        if (self.native_interface or getattr(self, 'serving_native', False)) and NATIVE_AVAILABLE and llama_cpp_interface and \
+                llama_cpp_interface.is_model_loaded():
+            try:
+                return llama_cpp_interface.generate_text(prompt, max_tokens, temperature,
+                                                         {'json_schema': schema})
+            except (RuntimeError, ValueError) as e:
+                raise LLMError(f"Constrained generation failed: {e}")
+        
+        if not self.llm:
+            raise LLMError("Model not loaded")
+        try:
+            from llama_cpp import LlamaGrammar
+            grammar = LlamaGrammar.from_json_schema(json.dumps(schema))
+            with self._lock:
+                response = self.llm(prompt, max_tokens=max_tokens, temperature=temperature,
+                                    grammar=grammar, echo=False)
+            return response['choices'][0]['text']
+        except Exception as e:
+            raise LLMError(f"Constrained generation failed: {e}")
+    
     def _update_performance_stats(self, tokens_generated: int, generation_time: float) -> None:
         """Update performance statistics."""
         self.performance_stats['total_generations'] += 1
@@ -598,7 +676,7 @@ Generate content that would be found in real-world {format_context} about {topic
         Returns:
             Dictionary with performance metrics
         """
-        if not self.llm:
+        if not self.llm and not getattr(self, 'serving_native', False):
             raise LLMError("Model not loaded")
         
         times = []
@@ -624,8 +702,229 @@ Generate content that would be found in real-world {format_context} about {topic
             'iterations': iterations
         }
     
+    def start_inference_server(self, socket_path: Optional[str] = None, n_parallel: int = 4,
+                               numa_node: Optional[int] = None, pin_threads: bool = True,
+                               draft_model_path: Optional[str] = None, n_draft: int = 4) -> Optional[str]:
+        """Serve this model to worker processes over a Unix socket.
+        
+        Loads the model into the native interface once; workers then use
+        RemoteLlamaInterface instead of loading their own copy. This
+        interface generates on the same native model from then on and
+        releases its llama-cpp-python copy, so the process holds one.
+        
+        Args:
+            socket_path: Socket path (defaults to one in a new directory only
+                this user can enter, under $XDG_RUNTIME_DIR or the temp dir)
+            n_parallel: Sequences the native scheduler decodes together
+            numa_node: Keep inference threads and model pages on this NUMA
+                node; run one server per node to use every socket
+            pin_threads: Pin inference threads to one physical core each
+            draft_model_path: Draft model for speculative decoding of every
+                request the server answers
+            n_draft: Tokens the draft proposes per verify step
+            
+        Returns:
+            Socket path, or None if the native interface is unavailable
+        """
+        if not NATIVE_AVAILABLE or not llama_cpp_interface:
+            return None
+        
+        socket_dir = None
+        if not socket_path:
+            runtime_dir = os.environ.get('XDG_RUNTIME_DIR')
+            socket_dir = tempfile.mkdtemp(prefix='credentialforge-llm-',
+                                          dir=runtime_dir if runtime_dir and os.path.isdir(runtime_dir) else None)
+            socket_path = os.path.join(socket_dir, 'llm.sock')
+        try:
+            llama_cpp_interface.init()
+            if not llama_cpp_interface.is_model_loaded():
+                # Without an explicit count the native side sizes threads to the node
+                llama_cpp_interface.set_cpu_placement(-1 if numa_node is None else numa_node, pin_threads)
+                llama_cpp_interface.set_context_params({'n_ctx': self.n_ctx, 'n_batch': self.n_batch})
+                if self.n_threads_explicit:
+                    llama_cpp_interface.set_threads(self.n_threads)
+                if not llama_cpp_interface.load_model(self.model_path, n_parallel):
+                    self._remove_socket_dir(socket_dir)
+                    return None
+            if draft_model_path:
+                self.enable_speculative_decoding(draft_model_path, n_draft)
+            llama_cpp_interface.serve(socket_path)
+        except Exception as e:
+            print(f"Warning: Failed to start inference server: {e}")
+            self._remove_socket_dir(socket_dir)
+            return None
+        
+        self.server_socket = socket_path
+        self.server_socket_dir = socket_dir
+        with self._lock:
+            self.serving_native = True
+            self.llm = None
+        return socket_path
+    
+    def stop_inference_server(self) -> None:
+        """Stop the inference server started by start_inference_server.
+        
+        The native model stays loaded and keeps serving this interface.
+        """
+        if getattr(self, 'server_socket', None) and llama_cpp_interface:
+            llama_cpp_interface.stop_server()
+            self.server_socket = None
+            self._remove_socket_dir(getattr(self, 'server_socket_dir', None))
+            self.server_socket_dir = None
+    
+    @staticmethod
+    def _remove_socket_dir(socket_dir: Optional[str]) -> None:
+        """Remove the private directory made for a default socket path."""
+        if socket_dir:
+            try:
+                os.rmdir(socket_dir)
+            except OSError:
+                pass
+    
+    def configure_native_context(self, n_ctx: Optional[int] = None, n_batch: Optional[int] = None,
+                                 n_threads: Optional[int] = None,
+                                 n_threads_batch: Optional[int] = None) -> Optional[Dict[str, Any]]:
+        """Retune the native model served by start_inference_server.
+        
+        Thread counts apply between decode steps. A new context or batch
+        size rebuilds the context on the already mapped model: running
+        generations finish first, queued ones wait, and prompt prefixes
+        held in the old context are dropped (cache_prefix snapshots stay).
+        
+        Args:
+            n_ctx: Context window size
+            n_batch: Tokens decoded per step
+            n_threads: Threads for token generation
+            n_threads_batch: Threads for prompt processing
+            
+        Returns:
+            The settings now in effect, or None if the native interface is
+            unavailable
+        """
+        if not NATIVE_AVAILABLE or not llama_cpp_interface:
+            return None
+        
+        params = {'n_ctx': n_ctx, 'n_batch': n_batch,
+                  'n_threads': n_threads, 'n_threads_batch': n_threads_batch}
+        params = {name: value for name, value in params.items() if value is not None}
+        try:
+            llama_cpp_interface.set_context_params(params)
+        except Exception as e:
+            print(f"Warning: Failed to reconfigure native context: {e}")
+            return None
+        
+        if n_ctx is not None:
+            self.n_ctx = n_ctx
+        if n_batch is not None:
+            self.n_batch = n_batch
+        if n_threads is not None:
+            self.n_threads = n_threads
+            self.n_threads_explicit = True
+        return llama_cpp_interface.get_context_params()
+    
+    def enable_speculative_decoding(self, draft_model_path: str, n_draft: int = 4) -> bool:
+        """Speculate with a small draft model on the native model.
+        
+        The draft (same tokenizer, e.g. a 0.5B model of the same family)
+        proposes n_draft tokens per sequence and the served model verifies
+        them in one batched decode. Output is unchanged; throughput grows
+        with the share of proposals accepted (see get_speculative_stats).
+        
+        Args:
+            draft_model_path: GGUF draft model sharing this model's vocabulary
+            n_draft: Tokens proposed per verify step
+            
+        Returns:
+            True if the draft model was loaded
+        """
+        if not NATIVE_AVAILABLE or not llama_cpp_interface:
+            return False
+        try:
+            llama_cpp_interface.load_draft_model(draft_model_path, n_draft, getattr(self, 'handle', None) or 0)
+        except (RuntimeError, ValueError) as e:
+            print(f"Warning: Failed to enable speculative decoding: {e}")
+            return False
+        return True
+    
+    def get_speculative_stats(self) -> Dict[str, Any]:
+        """Draft acceptance rate and tokens per verify step of the native model."""
+        if not NATIVE_AVAILABLE or not llama_cpp_interface:
+            return {}
+        try:
+            return llama_cpp_interface.get_speculative_stats(getattr(self, 'handle', None) or 0)
+        except RuntimeError:
+            return {}
+    
+    def enable_content_cache(self, reuse: int = 4, variants: int = 4,
+                             path: Optional[str] = None, max_bytes: int = 64 << 20,
+                             mutator: Optional[Callable[[str, int], str]] = None) -> bool:
+        """Serve native completions of repeated prompts from a cache.
+        
+        Prompts are keyed by their text with case and whitespace
+        normalized. Each cached text is served up to ``reuse`` times, its
+        own decode included, and a key keeps up to ``variants`` texts that
+        it serves in turn. Use only where the prose need not be unique per
+        document. With ``path`` the cache is mapped from that file and
+        written back on unload, so budgets carry over between runs.
+        
+        Requests answered by start_inference_server's server are cached
+        too, but the mutator only runs on calls made in this process.
+        
+        Args:
+            reuse: Times each text is served; below 2 turns the cache off
+            variants: Texts kept per prompt
+            path: Cache file (one per model)
+            max_bytes: Memory for cached texts
+            mutator: Called as mutator(text, use) on each reuse; returns the
+                text to serve
+            
+        Returns:
+            True if the native cache is configured
+        """
+        if not NATIVE_AVAILABLE or not llama_cpp_interface:
+            return False
+        try:
+            llama_cpp_interface.set_content_cache({'reuse': reuse, 'variants': variants,
+                                                   'max_bytes': max_bytes, 'path': path})
+            llama_cpp_interface.set_content_mutator(mutator)
+        except (OSError, ValueError, TypeError) as e:
+            print(f"Warning: Failed to enable content cache: {e}")
+            return False
+        self.content_cache_path = path
+        return True
+    
+    def get_content_cache_stats(self) -> Dict[str, Any]:
+        """Keys, texts, bytes and hit rate of the native content cache."""
+        if not NATIVE_AVAILABLE or not llama_cpp_interface:
+            return {}
+        return llama_cpp_interface.get_content_cache_stats()
+    
+    def get_native_latency_stats(self) -> Dict[str, Any]:
+        """Token counts, phase times and latency percentiles of the native model.
+        
+        Prompt processing and decode time are measured around each batched
+        decode; time to first token and per-token latency are reported as
+        p50/p95/p99 in seconds. Pass the result to
+        PerformanceMonitor.merge_native_stats to report it with Python metrics.
+        """
+        if not NATIVE_AVAILABLE or not llama_cpp_interface:
+            return {}
+        try:
+            return llama_cpp_interface.get_stats(getattr(self, 'handle', None) or 0)
+        except RuntimeError:
+            return {}
+    
     def unload(self) -> None:
         """Unload the model to free memory."""
+        self.stop_inference_server()
+        
+        if getattr(self, 'content_cache_path', None):
+            try:
+                llama_cpp_interface.save_content_cache(self.content_cache_path)
+            except OSError as e:
+                print(f"Warning: Failed to save content cache: {e}")
+            self.content_cache_path = None
+        
         # Cleanup thread pool
         if self.thread_pool:
             self.thread_pool.shutdown(wait=True)
@@ -635,6 +934,7 @@ Generate content that would be found in real-world {format_context} about {topic
         if self.llm:
             del self.llm
             self.llm = None
+        self.serving_native = False
         
         # Force garbage collection
         self.cleanup_memory()
@@ -913,3 +1213,213 @@ TRANSLATED CONTENT IN {lang_name.upper()}:"""
                 self.logger.warning(f"Translation failed: {e}")
         
         return content
+
+
+def _trim_native_results(results: List[str], stop: List[str]) -> List[str]:
+    """Raise on native error strings and cut each text at its first stop sequence.
+    
+    The native scheduler has no stop sequences, so they are applied here.
+    """
+    trimmed = []
+    for text in results:
+        if text.startswith("Error: "):
+            raise LLMError(f"Text generation failed: {text[7:]}")
+        for sequence in stop:
+            index = text.find(sequence)
+            if index >= 0:
+                text = text[:index]
+        trimmed.append(text)
+    return trimmed
+
+
+def _parse_json_result(text: str) -> Any:
+    """Parse schema-constrained output, raising on native error strings."""
+    if text.startswith("Error: "):
+        raise LLMError(f"Constrained generation failed: {text[7:]}")
+    try:
+        return json.loads(text)
+    except json.JSONDecodeError as e:
+        raise LLMError(f"Generated JSON is incomplete (raise max_tokens?): {e}")
+
+
+class RemoteLlamaInterface(LlamaInterface):
+    """LlamaInterface backed by an inference server in another process."""
+    
+    def __init__(self, socket_path: str, model_path: Optional[str] = None,
+                 temperature: float = 0.88, max_tokens: int = 512):
+        """Connect to a server started with LlamaInterface.start_inference_server.
+        
+        Args:
+            socket_path: Unix socket the server listens on
+            model_path: Model path reported by the server process
+            temperature: Default sampling temperature
+            max_tokens: Default maximum tokens to generate
+            
+        Raises:
+            LLMError: If the native interface is unavailable
+        """
+        if not NATIVE_AVAILABLE or not llama_cpp_interface:
+            raise LLMError("Remote inference requires the native interface")
+        
+        self.socket_path = socket_path
+        self.model_path = model_path
+        self.temperature = temperature
+        self.max_tokens = max_tokens
+        self.n_threads = 1
+        self.enable_multiprocessing = False
+        self.thread_pool = None
+        self.native_interface = None
+        self.server_socket = None
+        self.llm = None
+        self.model_info = {'path': model_path, 'server_socket': socket_path}
+        self._lock = threading.Lock()
+        self.reset_performance_stats()
+    
+    def generate(self, prompt: str, max_tokens: Optional[int] = None,
+                 temperature: Optional[float] = None,
+                 stop: Optional[List[str]] = None) -> str:
+        """Generate text on the inference server."""
+        return self.generate_batch([prompt], max_tokens, temperature, stop)[0]
+    
+    def generate_batch(self, prompts: List[str], max_tokens: Optional[int] = None,
+                      temperature: Optional[float] = None,
+                      stop: Optional[List[str]] = None) -> List[str]:
+        """Send all prompts at once so the server scheduler decodes them together."""
+        start_time = time.time()
+        max_tokens = max_tokens or self.max_tokens
+        temperature = temperature or self.temperature
+        stop = stop or ["</s>", "\n\n"]
+        
+        try:
+            results = llama_cpp_interface.remote_generate(self.socket_path, list(prompts), max_tokens, temperature)
+        except ConnectionError as e:
+            raise LLMError(f"Inference server unavailable: {e}")
+        
+        trimmed = _trim_native_results(results, stop)
+        with self._lock:
+            self._update_performance_stats(max_tokens * len(prompts), time.time() - start_time)
+        return trimmed
+    
+    def _generate_constrained(self, prompt: str, schema: Dict[str, Any],
+                              max_tokens: int, temperature: float) -> str:
+        """Compile the schema here and send its grammar with the request."""
+        try:
+            return llama_cpp_interface.remote_generate(self.socket_path, prompt, max_tokens, temperature,
+                                                       {'json_schema': schema})
+        except ValueError as e:
+            raise LLMError(f"Constrained generation failed: {e}")
+        except ConnectionError as e:
+            raise LLMError(f"Inference server unavailable: {e}")
+    
+    def unload(self) -> None:
+        """Nothing to unload; the model lives in the server process."""
+        self.llm = None
+
+
+class NativeModelInterface(LlamaInterface):
+    """LlamaInterface backed by a handle in the native model registry.
+    
+    Handles on the same file share its weights, and the registry unloads
+    the least recently used idle models when set_model_memory_budget is
+    exceeded, loading them again on their next request.
+    """
+    
+    def __init__(self, model_path: str, n_ctx: int = 4096, n_batch: int = 512,
+                 n_threads: Optional[int] = None, n_parallel: int = 4,
+                 temperature: float = 0.88, max_tokens: int = 512,
+                 draft_model_path: Optional[str] = None, n_draft: int = 4):
+        """Open a registry handle for a GGUF model.
+        
+        Args:
+            model_path: Path to GGUF model file
+            n_ctx: Context window size
+            n_batch: Batch size for processing
+            n_threads: Inference threads (defaults to the physical cores)
+            n_parallel: Sequences the native scheduler decodes together
+            temperature: Default sampling temperature
+            max_tokens: Default maximum tokens to generate
+            draft_model_path: Optional draft model for speculative decoding
+            n_draft: Tokens the draft proposes per verify step
+            
+        Raises:
+            LLMError: If the native interface is unavailable or loading fails
+        """
+        if not NATIVE_AVAILABLE or not llama_cpp_interface:
+            raise LLMError("The model registry requires the native interface")
+        
+        context_params = {'n_ctx': n_ctx, 'n_batch': n_batch}
+        if n_threads:
+            context_params['n_threads'] = n_threads
+        try:
+            self.handle = llama_cpp_interface.open_model(model_path, n_parallel, context_params)
+        except (RuntimeError, ValueError) as e:
+            raise LLMError(f"Failed to load model: {e}")
+        
+        self.model_path = model_path
+        self.n_ctx = n_ctx
+        self.n_batch = n_batch
+        self.n_threads = n_threads or 1
+        self.temperature = temperature
+        self.max_tokens = max_tokens
+        self.enable_multiprocessing = False
+        self.thread_pool = None
+        self.native_interface = None
+        self.server_socket = None
+        self.llm = None
+        self.model_info = {'path': model_path, 'handle': self.handle, 'context_size': n_ctx}
+        self._lock = threading.Lock()
+        self.reset_performance_stats()
+        
+        if draft_model_path:
+            self.enable_speculative_decoding(draft_model_path, n_draft)
+    
+    def generate(self, prompt: str, max_tokens: Optional[int] = None,
+                 temperature: Optional[float] = None,
+                 stop: Optional[List[str]] = None) -> str:
+        """Generate text on this model's registry handle."""
+        return self.generate_batch([prompt], max_tokens, temperature, stop)[0]
+    
+    def generate_batch(self, prompts: List[str], max_tokens: Optional[int] = None,
+                      temperature: Optional[float] = None,
+                      stop: Optional[List[str]] = None) -> List[str]:
+        """Submit all prompts at once so the handle's scheduler decodes them together."""
+        if self.handle is None:
+            raise LLMError("Model has been unloaded")
+        
+        start_time = time.time()
+        max_tokens = max_tokens or self.max_tokens
+        temperature = temperature or self.temperature
+        stop = stop or ["</s>", "\n\n"]
+        
+        try:
+            results = llama_cpp_interface.generate_with_model(self.handle, list(prompts), max_tokens, temperature)
+        except RuntimeError as e:
+            raise LLMError(f"Text generation failed: {e}")
+        
+        trimmed = _trim_native_results(results, stop)
+        with self._lock:
+            self._update_performance_stats(max_tokens * len(prompts), time.time() - start_time)
+        return trimmed
+    
+    def _generate_constrained(self, prompt: str, schema: Dict[str, Any],
+                              max_tokens: int, temperature: float) -> str:
+        """Schema-constrained completion on this model's registry handle."""
+        if self.handle is None:
+            raise LLMError("Model has been unloaded")
+        try:
+            return llama_cpp_interface.generate_with_model(self.handle, prompt, max_tokens, temperature,
+                                                           {'json_schema': schema})
+        except (RuntimeError, ValueError) as e:
+            raise LLMError(f"Constrained generation failed: {e}")
+    
+    def get_native_stats(self) -> Dict[str, Any]:
+        """Registry stats for this handle: residency, loads, evictions, throughput."""
+        if self.handle is None:
+            return {}
+        return llama_cpp_interface.get_model_stats()['models'].get(self.handle, {})
+    
+    def unload(self) -> None:
+        """Release the registry handle; the weights stay mapped while other handles use them."""
+        if getattr(self, 'handle', None) is not None and llama_cpp_interface:
+            llama_cpp_interface.close_model(self.handle)
+            self.handle = None
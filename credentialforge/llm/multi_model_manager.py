@@ -4,22 +4,35 @@ import os
 import time
 from typing import Dict, Optional, Any
 from pathlib import Path
-from .llama_interface import LlamaInterface
+from .llama_interface import LlamaInterface, NativeModelInterface, NATIVE_AVAILABLE
 from .exceptions import LLMError
 
 
 class MultiModelManager:
     """Manages multiple LLM models for different tasks."""
     
-    def __init__(self, models_config: Optional[Dict[str, Dict[str, Any]]] = None):
+    def __init__(self, models_config: Optional[Dict[str, Dict[str, Any]]] = None,
+                 use_native_registry: Optional[bool] = None,
+                 memory_budget_mb: Optional[float] = None):
         """Initialize multi-model manager.
         
         Args:
             models_config: Configuration for different models and their tasks
+            use_native_registry: Serve models from the native model registry,
+                which shares weights between models on the same file and
+                keeps recently used models resident (defaults to whether the
+                native interface is available)
+            memory_budget_mb: With the registry, model files kept mapped at
+                once; least recently used idle models are unloaded beyond it
         """
         self.models: Dict[str, LlamaInterface] = {}
         self.task_to_model: Dict[str, str] = {}
         self.models_config = models_config or self._get_default_config()
+        self.use_native_registry = NATIVE_AVAILABLE if use_native_registry is None else use_native_registry
+        
+        if self.use_native_registry and memory_budget_mb:
+            from ..native import llama_cpp_interface
+            llama_cpp_interface.set_model_memory_budget(int(memory_budget_mb * 1024 * 1024))
         
         # Initialize models based on configuration
         self._initialize_models()
@@ -65,14 +78,7 @@ class MultiModelManager:
             
             try:
                 # Initialize model with task-specific parameters
-                model = LlamaInterface(
-                    model_path=model_path,
-                    n_ctx=config.get('n_ctx', 4096),
-                    temperature=config.get('temperature', 0.2),
-                    max_tokens=config.get('max_tokens', 512)
-                )
-                
-                self.models[model_name] = model
+                self.models[model_name] = self._create_model(model_path, config)
                 
                 # Map tasks to this model
                 for task in config.get('tasks', []):
@@ -83,6 +89,25 @@ class MultiModelManager:
             except Exception as e:
                 print(f"❌ Failed to initialize {model_name}: {e}")
     
+    def _create_model(self, model_path: str, config: Dict[str, Any]) -> LlamaInterface:
+        """Create the interface for one configured model."""
+        if self.use_native_registry:
+            return NativeModelInterface(
+                model_path=model_path,
+                n_ctx=config.get('n_ctx', 4096),
+                n_parallel=config.get('n_parallel', 4),
+                temperature=config.get('temperature', 0.2),
+                max_tokens=config.get('max_tokens', 512),
+                draft_model_path=config.get('draft_model_path'),
+                n_draft=config.get('n_draft', 4)
+            )
+        return LlamaInterface(
+            model_path=model_path,
+            n_ctx=config.get('n_ctx', 4096),
+            temperature=config.get('temperature', 0.2),
+            max_tokens=config.get('max_tokens', 512)
+        )
+    
     def get_model_for_task(self, task: str) -> Optional[LlamaInterface]:
         """Get the appropriate model for a specific task.
         
@@ -172,14 +197,7 @@ class MultiModelManager:
             return False
         
         try:
-            model = LlamaInterface(
-                model_path=model_path,
-                n_ctx=config.get('n_ctx', 4096),
-                temperature=config.get('temperature', 0.2),
-                max_tokens=config.get('max_tokens', 512)
-            )
-            
-            self.models[name] = model
+            self.models[name] = self._create_model(model_path, config)
             
             # Update task mapping
             for task in tasks:
@@ -221,7 +239,7 @@ class MultiModelManager:
                     del self.task_to_model[task]
                 
                 # Unload model
-                del self.models[name]
+                self.models.pop(name).unload()
                 print(f"✅ Unloaded model {name}")
                 return True
                 
@@ -237,8 +255,20 @@ class MultiModelManager:
         process = psutil.Process()
         memory_info = process.memory_info()
         
-        return {
+        usage = {
             'total_memory_mb': memory_info.rss / 1024 / 1024,
             'loaded_models': len(self.models),
             'available_models': len(self.models_config)
         }
+        
+        if self.use_native_registry:
+            from ..native import llama_cpp_interface
+            registry = llama_cpp_interface.get_model_stats()
+            usage['resident_models_mb'] = registry['resident_bytes'] / 1024 / 1024
+            usage['memory_budget_mb'] = registry['budget_bytes'] / 1024 / 1024
+            usage['models'] = {
+                name: model.get_native_stats()
+                for name, model in self.models.items()
+                if isinstance(model, NativeModelInterface)
+            }
+        return usage
@@ -6,6 +6,10 @@ try:
     from . import cpu_optimizer
     from . import memory_manager
     from . import parallel_executor
+    from . import corpus_scanner
+    from . import ooxml_writer
+    from . import template_engine
+    from . import tracing
     
     NATIVE_AVAILABLE = True
 except ImportError:
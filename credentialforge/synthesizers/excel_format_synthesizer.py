@@ -14,6 +14,11 @@ try:
 except ImportError:
     OPENPYXL_AVAILABLE = False
 
+try:
+    from ..native import ooxml_writer
+except ImportError:
+    ooxml_writer = None
+
 
 class ExcelFormatSynthesizer(FormatSynthesizer):
     """Excel format synthesizer that structures agent-generated content."""
@@ -46,7 +51,10 @@ class ExcelFormatSynthesizer(FormatSynthesizer):
             filename = self._generate_filename(content_structure)
             file_path = self._get_file_path(filename)
             
-            if OPENPYXL_AVAILABLE:
+            if ooxml_writer is not None and self.format_type == 'xlsx':
+                # Stream the workbook with the native writer
+                self._create_excel_native(content_structure, file_path)
+            elif OPENPYXL_AVAILABLE:
                 # Create Excel with openpyxl
                 self._create_excel_with_openpyxl(content_structure, file_path)
             else:
@@ -92,6 +100,58 @@ class ExcelFormatSynthesizer(FormatSynthesizer):
         # Save workbook
         wb.save(str(file_path))
     
+    def _create_excel_native(self, content_structure: Dict[str, Any], file_path: Path) -> None:
+        """Create Excel file with the native streaming writer.
+        
+        Same layout as the openpyxl path, but rows go to disk as they are
+        written, so memory does not grow with the number of credentials.
+        """
+        sections = content_structure.get('sections', [])
+        credentials = content_structure.get('credentials', [])
+        language = content_structure.get('language', 'en')
+        metadata = content_structure.get('metadata', {})
+        
+        with ooxml_writer.XlsxWriter(str(file_path), {'title': content_structure.get('title', 'Document')}) as wb:
+            # Title sheet
+            wb.add_sheet("Document Info")
+            wb.write_row([content_structure.get('title', 'Document')], 'title')
+            wb.skip_rows(1)
+            wb.write_row(['Topic:', str(metadata.get('topic', 'N/A'))], ['bold'])
+            wb.write_row(['Language:', content_structure.get('language', 'en')], ['bold'])
+            wb.write_row(['Format:', content_structure.get('format_type', 'unknown')], ['bold'])
+            wb.write_row(['Generated:', str(metadata.get('generated_at', 'N/A'))], ['bold'])
+            
+            # Data sheets
+            for i, section in enumerate(sections):
+                wb.add_sheet(section.get('title', f'Sheet{i+1}'))
+                wb.write_row([section.get('title', 'Section')], 'heading')
+                wb.skip_rows(1)
+                for line in section.get('content', '').split('\n'):
+                    if line.strip():
+                        wb.write_row([line.strip()])
+                    else:
+                        wb.skip_rows(1)
+            
+            # Credentials sheet
+            if credentials:
+                wb.add_sheet(self._get_credentials_sheet_name(language))
+                wb.write_row([self._get_credentials_sheet_name(language)], 'alert_heading')
+                wb.skip_rows(1)
+                wb.write_row([
+                    self._get_credential_type_header(language),
+                    self._get_credential_value_header(language),
+                    self._get_credential_label_header(language)
+                ], 'header')
+                for cred in credentials:
+                    cred_type = cred.get('type', 'unknown')
+                    if 'password' in cred_type.lower():
+                        style = 'red'
+                    elif 'api' in cred_type.lower():
+                        style = 'blue'
+                    else:
+                        style = 'green'
+                    wb.write_row([cred_type, cred.get('value', ''), cred.get('label', cred_type)], [style])
+    
     def _populate_title_sheet(self, sheet, content_structure: Dict[str, Any]) -> None:
         """Populate the title/info sheet."""
         # Title
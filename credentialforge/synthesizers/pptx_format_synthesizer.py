@@ -3,14 +3,24 @@
 import random
 from pathlib import Path
 from typing import Dict, Any
-from pptx import Presentation
-from pptx.util import Inches, Pt
-from pptx.enum.text import PP_ALIGN
-from pptx.dml.color import RGBColor
 
 from .format_synthesizer import FormatSynthesizer
 from ..utils.exceptions import SynthesizerError
 
+try:
+    from pptx import Presentation
+    from pptx.util import Inches, Pt
+    from pptx.enum.text import PP_ALIGN
+    from pptx.dml.color import RGBColor
+    PPTX_AVAILABLE = True
+except ImportError:
+    PPTX_AVAILABLE = False
+
+try:
+    from ..native import ooxml_writer
+except ImportError:
+    ooxml_writer = None
+
 
 class PPTXFormatSynthesizer(FormatSynthesizer):
     """PPTX format synthesizer that structures agent-generated content."""
@@ -38,18 +48,20 @@ class PPTXFormatSynthesizer(FormatSynthesizer):
             # Validate content structure
             self._validate_content_structure(content_structure)
             
-            # Create presentation
-            prs = Presentation()
-            
-            # Create slides from sections
-            self._create_slides_from_sections(prs, content_structure)
-            
-            # Generate filename and save
+            # Generate filename
             filename = self._generate_filename(content_structure)
             file_path = self._get_file_path(filename)
             
-            # Save presentation
-            prs.save(str(file_path))
+            if ooxml_writer is not None:
+                # Stream the slides with the native writer
+                self._create_presentation_native(content_structure, file_path)
+            elif PPTX_AVAILABLE:
+                # Create presentation with python-pptx
+                prs = Presentation()
+                self._create_slides_from_sections(prs, content_structure)
+                prs.save(str(file_path))
+            else:
+                raise SynthesizerError("python-pptx is not installed and native components are not built")
             
             # Log stats
             self._log_generation_stats(content_structure)
@@ -60,7 +72,44 @@ class PPTXFormatSynthesizer(FormatSynthesizer):
             self.generation_stats['errors'] += 1
             raise SynthesizerError(f"PPTX synthesis failed: {e}")
     
-    def _create_slides_from_sections(self, prs: Presentation, content_structure: Dict[str, Any]) -> None:
+    def _create_presentation_native(self, content_structure: Dict[str, Any], file_path: Path) -> None:
+        """Create presentation with the native streaming writer."""
+        sections = content_structure.get('sections', [])
+        credentials = content_structure.get('credentials', [])
+        language = content_structure.get('language', 'en')
+        topic = content_structure.get('metadata', {}).get('topic', 'System Documentation')
+        
+        with ooxml_writer.PptxWriter(str(file_path), {'title': content_structure.get('title', 'Document Title')}) as prs:
+            # Title slide
+            prs.add_title_slide((content_structure.get('title', 'Document Title'), True, 44), f"Topic: {topic}")
+            
+            # Content slides; the first section is covered by the title slide
+            for section in sections[1:]:
+                paragraphs = [
+                    (paragraph.strip(), i == 0, 18)
+                    for i, paragraph in enumerate(section.get('content', '').split('\n\n'))
+                    if paragraph.strip()
+                ]
+                prs.add_slide(section.get('title', 'Section'), paragraphs)
+            
+            # Credentials slide, repeated in the speaker notes
+            if credentials:
+                slide_title = self._get_credentials_slide_title(language)
+                paragraphs = []
+                notes = [f"{slide_title}:", ""]
+                for cred in credentials:
+                    line = f"{cred.get('label', cred.get('type', 'Credential'))}: {cred.get('value', '')}"
+                    if 'password' in cred.get('type', '').lower():
+                        color = 0xFF0000  # Red for passwords
+                    elif 'api' in cred.get('type', '').lower():
+                        color = 0x0000FF  # Blue for API keys
+                    else:
+                        color = 0x008000  # Green for others
+                    paragraphs.append((line, True, 20, color))
+                    notes.append(line)
+                prs.add_slide(slide_title, paragraphs, notes)
+    
+    def _create_slides_from_sections(self, prs: 'Presentation', content_structure: Dict[str, Any]) -> None:
         """Create slides from content sections."""
         sections = content_structure.get('sections', [])
         credentials = content_structure.get('credentials', [])
@@ -80,7 +129,7 @@ class PPTXFormatSynthesizer(FormatSynthesizer):
         if credentials:
             self._create_credentials_slide(prs, credentials, language)
     
-    def _create_title_slide(self, prs: Presentation, content_structure: Dict[str, Any]) -> None:
+    def _create_title_slide(self, prs: 'Presentation', content_structure: Dict[str, Any]) -> None:
         """Create title slide."""
         slide_layout = prs.slide_layouts[0]  # Title slide layout
         slide = prs.slides.add_slide(slide_layout)
@@ -99,7 +148,7 @@ class PPTXFormatSynthesizer(FormatSynthesizer):
         title.text_frame.paragraphs[0].font.size = Pt(44)
         title.text_frame.paragraphs[0].font.bold = True
     
-    def _create_content_slide(self, prs: Presentation, section: Dict[str, str], language: str) -> None:
+    def _create_content_slide(self, prs: 'Presentation', section: Dict[str, str], language: str) -> None:
         """Create content slide from section."""
         slide_layout = prs.slide_layouts[1]  # Title and content layout
         slide = prs.slides.add_slide(slide_layout)
@@ -128,7 +177,7 @@ class PPTXFormatSynthesizer(FormatSynthesizer):
                 if i == 0:
                     p.font.bold = True
     
-    def _create_credentials_slide(self, prs: Presentation, credentials: list, language: str) -> None:
+    def _create_credentials_slide(self, prs: 'Presentation', credentials: list, language: str) -> None:
         """Create credentials slide."""
         slide_layout = prs.slide_layouts[1]  # Title and content layout
         slide = prs.slides.add_slide(slide_layout)
@@ -16,6 +16,11 @@ try:
 except ImportError:
     DOCX_AVAILABLE = False
 
+try:
+    from ..native import ooxml_writer
+except ImportError:
+    ooxml_writer = None
+
 
 class WordFormatSynthesizer(FormatSynthesizer):
     """Word format synthesizer that structures agent-generated content."""
@@ -51,7 +56,10 @@ class WordFormatSynthesizer(FormatSynthesizer):
             filename = self._generate_filename(content_structure)
             file_path = self._get_file_path(filename)
             
-            if DOCX_AVAILABLE and self.format_type in ['docx', 'docm']:
+            if ooxml_writer is not None and self.format_type == 'docx':
+                # Stream the document with the native writer
+                self._create_word_native(content_structure, file_path)
+            elif DOCX_AVAILABLE and self.format_type in ['docx', 'docm']:
                 # Create Word document with python-docx
                 self._create_word_with_docx(content_structure, file_path)
             else:
@@ -102,6 +110,27 @@ class WordFormatSynthesizer(FormatSynthesizer):
         # Save document
         doc.save(str(file_path))
     
+    def _create_word_native(self, content_structure: Dict[str, Any], file_path: Path) -> None:
+        """Create Word document with the native streaming writer."""
+        title = content_structure.get('title', 'Document')
+        
+        with ooxml_writer.DocxWriter(str(file_path), {'title': title}) as doc:
+            doc.add_heading(title, 0)
+            
+            # Metadata
+            metadata = content_structure.get('metadata', {})
+            if metadata:
+                doc.add_paragraph(f"Topic: {metadata.get('topic', 'N/A')}")
+                doc.add_paragraph(f"Language: {content_structure.get('language', 'en')}")
+                doc.add_paragraph(f"Format: {content_structure.get('format_type', 'unknown')}")
+                doc.add_paragraph("")
+            
+            # Sections
+            for section in content_structure.get('sections', []):
+                doc.add_heading(section.get('title', 'Section'), 1)
+                doc.add_paragraph(section.get('content', ''))
+                doc.add_paragraph("")
+    
     def _create_simple_document(self, content_structure: Dict[str, Any], file_path: Path) -> None:
         """Create simple text-based document."""
         content = f"""
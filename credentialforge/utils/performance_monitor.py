@@ -38,6 +38,9 @@ class PerformanceMonitor:
         self.metrics_history = deque(maxlen=max_history)
         self._lock = threading.Lock()
         
+        # Latest counters reported by native components, keyed by source
+        self.native_stats: Dict[str, Dict[str, Any]] = {}
+        
         # System monitoring
         self.system_stats = {
             'cpu_count': psutil.cpu_count(),
@@ -56,6 +59,7 @@ class PerformanceMonitor:
             PerformanceMetrics object for the operation
         """
         start_time = time.time()
+        start_ns = time.monotonic_ns()
         memory_before = self._get_memory_usage()
         cpu_before = psutil.cpu_percent()
         
@@ -90,6 +94,7 @@ class PerformanceMonitor:
             
             with self._lock:
                 self.metrics_history.append(metrics)
+            _record_span(operation_name, start_ns)
     
     def _get_memory_usage(self) -> float:
         """Get current memory usage in MB."""
@@ -126,8 +131,13 @@ class PerformanceMonitor:
             else:
                 metrics = list(self.metrics_history)
         
+        native = self.get_native_stats() if operation_name is None else {}
+        
         if not metrics:
-            return {'message': 'No metrics available'}
+            summary = {'message': 'No metrics available'}
+            if native:
+                summary['native'] = native
+            return summary
         
         successful_metrics = [m for m in metrics if m.success]
         failed_metrics = [m for m in metrics if not m.success]
@@ -162,6 +172,9 @@ class PerformanceMonitor:
             error_messages = [m.error_message for m in failed_metrics if m.error_message]
             summary['common_errors'] = list(set(error_messages))
         
+        if native:
+            summary['native'] = native
+        
         return summary
     
     def get_operation_stats(self, operation_name: str) -> Dict[str, Any]:
@@ -175,6 +188,129 @@ class PerformanceMonitor:
         """
         return self.get_performance_summary(operation_name)
     
+    def merge_native_stats(self, stats: Dict[str, Any], source: str = 'llama_cpp') -> None:
+        """Record a snapshot of native counters alongside Python metrics.
+        
+        Native components keep their own cumulative counters (token counts,
+        prompt and decode time, latency percentiles); the latest snapshot
+        per source replaces the previous one.
+        
+        Args:
+            stats: Counters, e.g. from llama_cpp_interface.get_stats()
+            source: Name the snapshot is reported under
+        """
+        with self._lock:
+            self.native_stats[source] = {**stats, 'collected_at': time.time()}
+    
+    def collect_native_stats(self, handle: int = 0) -> Dict[str, Any]:
+        """Fetch and merge llama_cpp_interface.get_stats() if it is available.
+        
+        Args:
+            handle: Model registry handle (0 for the default interface)
+            
+        Returns:
+            The collected counters, or an empty dictionary
+        """
+        try:
+            from ..native import llama_cpp_interface
+            stats = llama_cpp_interface.get_stats(handle)
+        except (ImportError, RuntimeError):
+            return {}
+        
+        self.merge_native_stats(stats, 'llama_cpp' if handle == 0 else f'llama_cpp:{handle}')
+        return stats
+    
+    def collect_budget_stats(self) -> Dict[str, Any]:
+        """Fetch and merge memory_manager.get_budget_stats() if it is available.
+        
+        The per-category charges are flattened to ``charged_<category>``
+        keys (model_weights, kv_cache, prefix_cache, content_cache, pools,
+        manager).
+        
+        Returns:
+            The collected budget figures, or an empty dictionary
+        """
+        try:
+            from ..native import memory_manager
+            stats = memory_manager.get_budget_stats()
+        except (ImportError, AttributeError):
+            return {}
+        
+        charged = stats.pop('charged', {})
+        stats.update({f'charged_{category}': value for category, value in charged.items()})
+        self.merge_native_stats(stats, 'memory_budget')
+        return stats
+    
+    def enable_tracing(self, categories: Optional[List[str]] = None, ring_events: int = 0) -> bool:
+        """Start recording timeline spans in the native modules and trace_span().
+        
+        Spans go to per-thread ring buffers, so a long run keeps the most
+        recent ones; categories left out cost one relaxed load per span.
+        
+        Args:
+            categories: Any of llm, credentials, executor, memory, documents,
+                scan, cpu and python (default: all)
+            ring_events: Spans kept per thread (0 keeps the current size,
+                8192 by default)
+            
+        Returns:
+            True if native tracing is available
+        """
+        tracing = _native_tracing()
+        if not tracing:
+            return False
+        tracing.enable(categories, ring_events)
+        return True
+    
+    def disable_tracing(self) -> None:
+        """Stop recording spans; the recorded ones stay exportable."""
+        tracing = _native_tracing()
+        if tracing:
+            tracing.disable()
+    
+    def export_trace(self, filepath: str, clear: bool = False) -> int:
+        """Write the recorded spans as Chrome trace JSON.
+        
+        The file opens in chrome://tracing and ui.perfetto.dev, one track
+        per thread, native and Python spans on the same clock.
+        
+        Args:
+            filepath: Output file path
+            clear: Forget the exported spans afterwards
+            
+        Returns:
+            Number of spans written (0 without native tracing)
+        """
+        tracing = _native_tracing()
+        if not tracing:
+            return 0
+        written = tracing.export(filepath)
+        if clear:
+            tracing.clear()
+        return written
+    
+    def collect_trace_stats(self) -> Dict[str, Any]:
+        """Fetch and merge tracing.get_stats() if it is available.
+        
+        Returns:
+            Enabled categories, recording threads and span counts, or an
+            empty dictionary
+        """
+        tracing = _native_tracing()
+        if not tracing:
+            return {}
+        
+        stats = tracing.get_stats()
+        self.merge_native_stats(stats, 'tracing')
+        return stats
+    
+    def get_native_stats(self, source: Optional[str] = None) -> Dict[str, Any]:
+        """Get merged native snapshots, all of them or one source's."""
+        with self._lock:
+            if source is not None:
+                return dict(self.native_stats.get(source, {}))
+            return {name: dict(stats) for name, stats in self.native_stats.items()}
+    
     def cleanup_memory(self) -> Dict[str, Any]:
         """Perform memory cleanup and return cleanup statistics.
         
@@ -224,6 +360,7 @@ class PerformanceMonitor:
         """Reset all performance metrics."""
         with self._lock:
             self.metrics_history.clear()
+            self.native_stats.clear()
     
     def export_metrics(self, filepath: str) -> None:
         """Export metrics to a file.
@@ -314,6 +451,14 @@ class MemoryManager:
         # Force garbage collection
         collected = gc.collect()
         
+        # Then let native caches, pools and idle models give memory back
+        native_reclaimed = 0
+        try:
+            from ..native import memory_manager
+            native_reclaimed = memory_manager.reclaim_memory()
+        except (ImportError, AttributeError):
+            pass
+        
         memory_after = psutil.Process().memory_info().rss / (1024**2)
         memory_freed = memory_before - memory_after
         
@@ -324,6 +469,7 @@ class MemoryManager:
             'memory_after_mb': memory_after,
             'memory_freed_mb': memory_freed,
             'objects_collected': collected,
+            'native_bytes_reclaimed': native_reclaimed,
             'cleanup_count': self.cleanup_count,
             'cleanup_timestamp': time.time()
         }
@@ -373,3 +519,50 @@ def performance_context(operation_name: str):
     monitor = get_global_monitor()
     with monitor.monitor_operation(operation_name) as metrics:
         yield metrics
+
+
+# Native tracing module once imported, False if it is unavailable
+_tracing = None
+_trace_thread = threading.local()
+
+
+def _native_tracing():
+    global _tracing
+    if _tracing is None:
+        try:
+            from ..native import tracing
+            _tracing = tracing
+        except ImportError:
+            _tracing = False
+    return _tracing
+
+
+def _record_span(name: str, start_ns: int, category: str = 'python', value: int = -1) -> None:
+    """Record a span from start_ns to now if its category is traced."""
+    tracing = _native_tracing()
+    if not tracing or not tracing.is_enabled(category):
+        return
+    if not getattr(_trace_thread, 'named', False):
+        tracing.set_thread_name(threading.current_thread().name)
+        _trace_thread.named = True
+    tracing.record(name, start_ns, time.monotonic_ns(), category, value)
+
+
+@contextmanager
+def trace_span(name: str, category: str = 'python', value: int = -1):
+    """Record the enclosed block as a span on the native timeline.
+    
+    The span is handed over in one native call when the block ends, on
+    the clock the native spans use, so it nests with the native work it
+    triggers. Costs a clock read and one check while tracing is off.
+    
+    Args:
+        name: Span name (keep the set of names small; they are interned)
+        category: Trace category the span belongs to
+        value: Shown as args.value in the trace when not negative
+    """
+    start_ns = time.monotonic_ns()
+    try:
+        yield
+    finally:
+        _record_span(name, start_ns, category, value)
@@ -0,0 +1,535 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "memory_budget.h"
+
+// Generated texts kept in front of LlamaCPPInterface, keyed by a hash of
+// the normalized prompt. Content prompts differ little between documents
+// of one topic, company and language, and the prose only has to be
+// loosely unique, so each text may be served up to `reuse` times (its own
+// decode included) before the key decodes again. A key keeps up to
+// `variants` texts and serves them in turn.
+//
+// The table is split into shards, each with its own lock and LRU list, so
+// concurrent generations rarely contend. save() writes every text with its
+// use count; open() maps such a file and serves its texts in place, so a
+// large cache costs no copying at startup and budgets carry over between
+// runs.
+class ContentCache {
+public:
+    struct Config {
+        uint32_t reuse = 0;                   // Below 2 the cache is off
+        uint32_t variants = 4;                // Texts kept per key
+        size_t max_bytes = size_t(64) << 20;  // Text bytes over all shards
+        size_t shards = 16;
+    };
+
+    struct Stats {
+        Config config;
+        size_t keys = 0;
+        size_t texts = 0;
+        size_t bytes = 0;
+        size_t mapped_bytes = 0;  // Of `bytes`, served from a mapped file
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t inserts = 0;
+        uint64_t evictions = 0;
+        std::string path;
+    };
+
+    ContentCache() {
+        apply(Config());
+        reclaimer_id = memory_budget::add_reclaimer("content_cache", 5, [this](size_t bytes) {
+            return shed(bytes);
+        });
+    }
+
+    ~ContentCache() {
+        memory_budget::remove_reclaimer(reclaimer_id);
+    }
+
+    ContentCache(const ContentCache&) = delete;
+    ContentCache& operator=(const ContentCache&) = delete;
+
+    // Hash of the prompt with ASCII case folded and whitespace runs
+    // collapsed, mixed with what shapes the output (token limit, charset).
+    // Stable across runs, since saved caches are looked up by it.
+    static uint64_t key(std::string_view prompt, int max_tokens, std::string_view salt) {
+        uint64_t h = 0xcbf29ce484222325ULL;
+        auto mix = [&h](unsigned char c) {
+            h ^= c;
+            h *= 0x100000001b3ULL;
+        };
+        bool space = false;
+        bool started = false;
+        for (char ch : prompt) {
+            unsigned char c = static_cast<unsigned char>(ch);
+            if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v') {
+                space = started;
+                continue;
+            }
+            if (space) {
+                mix(' ');
+                space = false;
+            }
+            mix(c >= 'A' && c <= 'Z' ? c + 32 : c);
+            started = true;
+        }
+        mix(0);
+        for (char c : salt) {
+            mix(static_cast<unsigned char>(c));
+        }
+        h ^= static_cast<uint64_t>(static_cast<uint32_t>(max_tokens)) * 0x9E3779B97F4A7C15ULL;
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    bool enabled() const {
+        return reuse_limit.load(std::memory_order_relaxed) >= 2;
+    }
+
+    // A text of `key` with budget left, and which use of it this is (2 for
+    // the first reuse). False when the key has to be decoded.
+    bool lookup(uint64_t key, std::string& text, uint32_t& use) {
+        std::shared_lock<std::shared_mutex> layout(layout_mutex);
+        uint32_t reuse = config.reuse;
+        Shard& shard = shard_for(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.entries.find(key);
+        if (it != shard.entries.end()) {
+            Entry& entry = it->second;
+            size_t n = entry.texts.size();
+            for (size_t i = 0; i < n; ++i) {
+                Text& candidate = entry.texts[(entry.next + i) % n];
+                if (candidate.uses < reuse) {
+                    use = ++candidate.uses;
+                    text.assign(candidate.view());
+                    entry.next = static_cast<uint32_t>((entry.next + i + 1) % n);
+                    shard.lru.splice(shard.lru.begin(), shard.lru, entry.lru);
+                    hits.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+        }
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Add a freshly decoded text (one use spent). When the key already
+    // holds `variants` texts the most used one is replaced.
+    void insert(uint64_t key, std::string text) {
+        std::shared_lock<std::shared_mutex> layout(layout_mutex);
+        Shard& shard = shard_for(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        Text added;
+        added.owned = std::move(text);
+        added.uses = 1;
+        place(shard, key, std::move(added), config.variants);
+        inserts.fetch_add(1, std::memory_order_relaxed);
+        evict(shard, config.max_bytes / shard_count);
+    }
+
+    // New limits; a different shard count rehashes what is cached
+    void configure(const Config& next) {
+        std::unique_lock<std::shared_mutex> layout(layout_mutex);
+        Config fixed = next;
+        fixed.variants = std::max<uint32_t>(fixed.variants, 1);
+        fixed.shards = std::max<size_t>(std::min<size_t>(fixed.shards, 1024), 1);
+        if (fixed.shards != shard_count) {
+            std::unique_ptr<Shard[]> old = std::move(shards);
+            size_t old_count = shard_count;
+            apply(fixed);
+            for (size_t s = 0; s < old_count; ++s) {
+                for (auto& item : old[s].entries) {
+                    Shard& shard = shard_for(item.first);
+                    for (Text& moved : item.second.texts) {
+                        account(old[s], moved, false);
+                        place(shard, item.first, std::move(moved), fixed.variants);
+                    }
+                }
+            }
+        } else {
+            config = fixed;
+            reuse_limit.store(fixed.reuse, std::memory_order_relaxed);
+        }
+        for (size_t s = 0; s < shard_count; ++s) {
+            trim_variants(shards[s], fixed.variants);
+            evict(shards[s], fixed.max_bytes / shard_count);
+        }
+    }
+
+    Config get_config() const {
+        std::shared_lock<std::shared_mutex> layout(layout_mutex);
+        return config;
+    }
+
+    void clear() {
+        std::unique_lock<std::shared_mutex> layout(layout_mutex);
+        for (size_t s = 0; s < shard_count; ++s) {
+            std::lock_guard<std::mutex> lock(shards[s].mutex);
+            drop_all(shards[s]);
+        }
+        mappings.clear();
+    }
+
+    // Snapshot file: magic, version and text count, then per text its key,
+    // use count, size and bytes padded to 8. Written beside `path` and
+    // renamed over it, so a file mapped by open() stays intact.
+    bool save(const std::string& path, size_t& count, std::string& error) {
+        std::shared_lock<std::shared_mutex> layout(layout_mutex);
+        std::string temp = path + ".tmp";
+        std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            error = "Cannot open " + temp;
+            return false;
+        }
+        uint64_t header[2] = {(uint64_t(kVersion) << 32) | kMagic, 0};
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+        static const char padding[8] = {};
+        count = 0;
+        for (size_t s = 0; s < shard_count; ++s) {
+            std::lock_guard<std::mutex> lock(shards[s].mutex);
+            for (const auto& item : shards[s].entries) {
+                for (const Text& text : item.second.texts) {
+                    std::string_view bytes = text.view();
+                    uint64_t record[2] = {item.first, (uint64_t(bytes.size()) << 32) | text.uses};
+                    file.write(reinterpret_cast<const char*>(record), sizeof(record));
+                    file.write(bytes.data(), bytes.size());
+                    file.write(padding, (8 - bytes.size() % 8) % 8);
+                    ++count;
+                }
+            }
+        }
+        header[1] = count;
+        file.seekp(0);
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        file.close();
+        if (!file) {
+            error = "Failed writing " + temp;
+            std::remove(temp.c_str());
+            return false;
+        }
+        if (std::rename(temp.c_str(), path.c_str()) != 0) {
+            error = "Cannot replace " + path + ": " + std::strerror(errno);
+            std::remove(temp.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    // Map a file written by save() and serve its texts in place, added to
+    // what is cached. A missing file is an empty cache.
+    bool open(const std::string& path, size_t& count, std::string& error) {
+        count = 0;
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            if (errno == ENOENT) {
+                std::unique_lock<std::shared_mutex> layout(layout_mutex);
+                mapped_path = path;
+                return true;
+            }
+            error = "Cannot open " + path + ": " + std::strerror(errno);
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < 16) {
+            ::close(fd);
+            error = "Not a content cache file: " + path;
+            return false;
+        }
+        size_t size = static_cast<size_t>(st.st_size);
+        void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (addr == MAP_FAILED) {
+            error = std::string("mmap failed: ") + std::strerror(errno);
+            return false;
+        }
+        auto mapping = std::make_shared<Mapping>(addr, size);
+#else
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            std::unique_lock<std::shared_mutex> layout(layout_mutex);
+            mapped_path = path;
+            return true;
+        }
+        std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        auto mapping = std::make_shared<Mapping>(std::move(contents));
+        size_t size = mapping->size;
+#endif
+        const char* base = static_cast<const char*>(mapping->data);
+        uint64_t header[2];
+        std::memcpy(header, base, sizeof(header));
+        if (header[0] != ((uint64_t(kVersion) << 32) | kMagic)) {
+            error = "Not a content cache file: " + path;
+            return false;
+        }
+
+        // Validate the whole file before anything is served from it
+        std::vector<std::pair<uint64_t, Text>> loaded;
+        loaded.reserve(static_cast<size_t>(std::min<uint64_t>(header[1], size / 16)));
+        size_t at = sizeof(header);
+        for (uint64_t i = 0; i < header[1]; ++i) {
+            uint64_t record[2];
+            if (size - at < sizeof(record)) {
+                error = "Truncated content cache file: " + path;
+                return false;
+            }
+            std::memcpy(record, base + at, sizeof(record));
+            at += sizeof(record);
+            size_t length = static_cast<size_t>(record[1] >> 32);
+            if (size - at < length) {
+                error = "Truncated content cache file: " + path;
+                return false;
+            }
+            Text text;
+            text.mapped = base + at;
+            text.mapped_size = static_cast<uint32_t>(length);
+            text.uses = static_cast<uint32_t>(record[1]);
+            loaded.emplace_back(record[0], std::move(text));
+            at += length + (8 - length % 8) % 8;
+            at = std::min(at, size);
+        }
+
+        std::unique_lock<std::shared_mutex> layout(layout_mutex);
+        for (auto& item : loaded) {
+            Shard& shard = shard_for(item.first);
+            place(shard, item.first, std::move(item.second), config.variants);
+        }
+        for (size_t s = 0; s < shard_count; ++s) {
+            evict(shards[s], config.max_bytes / shard_count);
+        }
+        mappings.push_back(std::move(mapping));
+        mapped_path = path;
+        count = loaded.size();
+        return true;
+    }
+
+    // File given to open(), where save() writes by default
+    std::string path() const {
+        std::shared_lock<std::shared_mutex> layout(layout_mutex);
+        return mapped_path;
+    }
+
+    Stats stats() const {
+        std::shared_lock<std::shared_mutex> layout(layout_mutex);
+        Stats stats;
+        stats.config = config;
+        stats.path = mapped_path;
+        for (size_t s = 0; s < shard_count; ++s) {
+            std::lock_guard<std::mutex> lock(shards[s].mutex);
+            stats.keys += shards[s].entries.size();
+            stats.bytes += shards[s].bytes;
+            stats.mapped_bytes += shards[s].mapped_bytes;
+            for (const auto& item : shards[s].entries) {
+                stats.texts += item.second.texts.size();
+            }
+        }
+        stats.hits = hits.load(std::memory_order_relaxed);
+        stats.misses = misses.load(std::memory_order_relaxed);
+        stats.inserts = inserts.load(std::memory_order_relaxed);
+        stats.evictions = evictions.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+    static constexpr uint32_t kMagic = 0x43434643;  // "CFCC"
+    static constexpr uint32_t kVersion = 1;
+    static constexpr size_t kTextOverhead = 64;     // Bookkeeping counted per text
+
+    struct Mapping {
+#ifndef _WIN32
+        Mapping(void* addr, size_t bytes) : data(addr), size(bytes) {}
+        ~Mapping() {
+            munmap(data, size);
+        }
+#else
+        explicit Mapping(std::string contents) : buffer(std::move(contents)), data(buffer.data()), size(buffer.size()) {}
+        std::string buffer;
+#endif
+        void* data;
+        size_t size;
+    };
+
+    // Decoded here (owned) or served from a mapped file
+    struct Text {
+        std::string owned;
+        const char* mapped = nullptr;
+        uint32_t mapped_size = 0;
+        uint32_t uses = 0;
+
+        std::string_view view() const {
+            return mapped ? std::string_view(mapped, mapped_size) : std::string_view(owned);
+        }
+        size_t bytes() const {
+            return view().size() + kTextOverhead;
+        }
+    };
+
+    struct Entry {
+        std::vector<Text> texts;
+        uint32_t next = 0;
+        std::list<uint64_t>::iterator lru;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<uint64_t, Entry> entries;
+        std::list<uint64_t> lru;  // Most recently used first
+        size_t bytes = 0;
+        size_t mapped_bytes = 0;
+    };
+
+    void apply(const Config& next) {
+        config = next;
+        shard_count = next.shards;
+        shards.reset(new Shard[shard_count]);
+        reuse_limit.store(next.reuse, std::memory_order_relaxed);
+    }
+
+    Shard& shard_for(uint64_t key) const {
+        return shards[(key >> 48) % shard_count];
+    }
+
+    void account(Shard& shard, const Text& text, bool add) {
+        size_t bytes = text.bytes();
+        size_t mapped = text.mapped ? bytes : 0;
+        if (add) {
+            shard.bytes += bytes;
+            shard.mapped_bytes += mapped;
+        } else {
+            shard.bytes -= bytes;
+            shard.mapped_bytes -= mapped;
+        }
+        if (!text.mapped) {
+            size_t total = add ? owned_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes
+                               : owned_bytes.fetch_sub(bytes, std::memory_order_relaxed) - bytes;
+            charge.set(total);
+        }
+    }
+
+    // Caller holds the shard lock
+    void place(Shard& shard, uint64_t key, Text text, uint32_t variants) {
+        auto inserted = shard.entries.try_emplace(key);
+        Entry& entry = inserted.first->second;
+        if (inserted.second) {
+            shard.lru.push_front(key);
+            entry.lru = shard.lru.begin();
+        } else {
+            shard.lru.splice(shard.lru.begin(), shard.lru, entry.lru);
+        }
+        account(shard, text, true);
+        if (entry.texts.size() < variants) {
+            entry.texts.push_back(std::move(text));
+            return;
+        }
+        auto worn = std::max_element(entry.texts.begin(), entry.texts.end(), [](const Text& a, const Text& b) {
+            return a.uses < b.uses;
+        });
+        account(shard, *worn, false);
+        *worn = std::move(text);
+    }
+
+    // Caller holds the layout lock exclusively
+    void trim_variants(Shard& shard, uint32_t variants) {
+        for (auto& item : shard.entries) {
+            std::vector<Text>& texts = item.second.texts;
+            while (texts.size() > variants) {
+                account(shard, texts.back(), false);
+                texts.pop_back();
+            }
+            item.second.next = 0;
+        }
+    }
+
+    // Caller holds the shard lock; drops least recently used keys
+    size_t evict(Shard& shard, size_t limit) {
+        size_t freed = 0;
+        while (shard.bytes > limit && !shard.lru.empty()) {
+            freed += drop(shard, shard.lru.back());
+        }
+        return freed;
+    }
+
+    size_t drop(Shard& shard, uint64_t key) {
+        auto it = shard.entries.find(key);
+        size_t freed = 0;
+        for (const Text& text : it->second.texts) {
+            freed += text.bytes();
+            account(shard, text, false);
+        }
+        shard.lru.erase(it->second.lru);
+        shard.entries.erase(it);
+        evictions.fetch_add(1, std::memory_order_relaxed);
+        return freed;
+    }
+
+    void drop_all(Shard& shard) {
+        for (const auto& item : shard.entries) {
+            for (const Text& text : item.second.texts) {
+                account(shard, text, false);
+            }
+        }
+        shard.entries.clear();
+        shard.lru.clear();
+    }
+
+    // Reclaimer: try-locks only, skipping busy shards
+    size_t shed(size_t bytes) {
+        std::shared_lock<std::shared_mutex> layout(layout_mutex, std::try_to_lock);
+        if (!layout.owns_lock()) {
+            return 0;
+        }
+        size_t freed = 0;
+        for (size_t s = 0; s < shard_count && freed < bytes; ++s) {
+            std::unique_lock<std::mutex> lock(shards[s].mutex, std::try_to_lock);
+            while (lock.owns_lock() && freed < bytes && !shards[s].lru.empty()) {
+                freed += drop(shards[s], shards[s].lru.back());
+            }
+        }
+        return freed;
+    }
+
+    mutable std::shared_mutex layout_mutex;  // Exclusive to replace shards or mappings
+    Config config;
+    std::unique_ptr<Shard[]> shards;
+    size_t shard_count = 0;
+    std::atomic<uint32_t> reuse_limit{0};
+    std::vector<std::shared_ptr<Mapping>> mappings;
+    std::string mapped_path;
+    std::atomic<size_t> owned_bytes{0};
+    memory_budget::Charge charge{memory_budget::Category::CONTENT_CACHE};
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> inserts{0};
+    std::atomic<uint64_t> evictions{0};
+    int reclaimer_id = -1;
+};
@@ -0,0 +1,1069 @@
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <filesystem>
+#include <system_error>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef ZLIB_FOUND
+#include <zlib.h>
+#endif
+
+extern "C" {
+    #define PY_SSIZE_T_CLEAN
+    #include <Python.h>
+}
+
+#include "credential_scan.h"
+#include "memory_arena.h"
+#include "parallel_executor.h"
+#include "tracing.h"
+
+// Parallel scanner for generated corpora. Every file is mapped read-only
+// and scanned for the compiled regex_db.json patterns on a private
+// ParallelExecutor, one task per file, largest first. Containers are
+// decoded on the way: OOXML zip parts are inflated one at a time into the
+// worker's scratch arena, PDF streams go through their ASCII85/Flate
+// filters and base64 or quoted-printable MIME bodies are decoded, so
+// credentials are found where a DLP scanner would see them. Without zlib,
+// deflated parts and streams are counted as skipped.
+
+using Buffer = memory_arena::ArenaVector<uint8_t>;
+
+struct ScanOptions {
+    int threads = 0;                           // Executor workers; 0 uses every CPU
+    bool pin_threads = false;
+    bool decode = true;                        // Decode zip parts, PDF streams and MIME bodies
+    bool all_parts = false;                    // Scan every zip part, not only XML and text parts
+    size_t max_part_size = size_t(256) << 20;  // Largest inflated part or stream
+};
+
+// Findings for one file, filled in by a worker without the GIL
+struct FileReport {
+    std::string path;
+    const char* format = "text";
+    std::string error;
+    uint64_t bytes = 0;
+    uint64_t bytes_scanned = 0;   // Raw plus decoded bytes run through the scanner
+    uint32_t parts = 0;           // Zip parts, streams and bodies decoded and scanned
+    uint32_t parts_skipped = 0;   // Encrypted, unsupported, corrupt or over max_part_size
+    double seconds = 0.0;
+    std::vector<std::pair<size_t, std::string>> hits;  // (pattern, credential)
+};
+
+static inline uint16_t le16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t le32(const uint8_t* p) {
+    return static_cast<uint32_t>(le16(p)) | (static_cast<uint32_t>(le16(p + 2)) << 16);
+}
+
+static inline uint64_t le64(const uint8_t* p) {
+    return static_cast<uint64_t>(le32(p)) | (static_cast<uint64_t>(le32(p + 4)) << 32);
+}
+
+static inline std::string_view as_text(const uint8_t* data, size_t n) {
+    return std::string_view(reinterpret_cast<const char*>(data), n);
+}
+
+static bool starts_with_nocase(std::string_view text, std::string_view prefix) {
+    if (text.size() < prefix.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < prefix.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(text[i])) != prefix[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool contains_nocase(std::string_view text, std::string_view needle) {
+    for (size_t i = 0; i + needle.size() <= text.size(); ++i) {
+        if (starts_with_nocase(text.substr(i), needle)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Read-only view of an input file: mapped where mmap is available, read
+// into memory otherwise
+class InputFile {
+public:
+    InputFile() = default;
+    InputFile(const InputFile&) = delete;
+    InputFile& operator=(const InputFile&) = delete;
+
+    ~InputFile() {
+#ifndef _WIN32
+        if (mapping) {
+            munmap(mapping, size);
+        }
+#endif
+    }
+
+    bool open(const std::string& path, std::string& error) {
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            error = std::string("Cannot open: ") + std::strerror(errno);
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            error = std::string("Cannot stat: ") + std::strerror(errno);
+            ::close(fd);
+            return false;
+        }
+        size = static_cast<size_t>(st.st_size);
+        if (size > 0) {
+            void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                error = std::string("Cannot map: ") + std::strerror(errno);
+                ::close(fd);
+                return false;
+            }
+            madvise(p, size, MADV_SEQUENTIAL);
+            mapping = p;
+            data = static_cast<const uint8_t*>(p);
+        }
+        ::close(fd);
+        return true;
+#else
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            error = "Cannot open";
+            return false;
+        }
+        contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        data = reinterpret_cast<const uint8_t*>(contents.data());
+        size = contents.size();
+        return true;
+#endif
+    }
+
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+private:
+#ifndef _WIN32
+    void* mapping = nullptr;
+#else
+    std::string contents;
+#endif
+};
+
+#ifdef ZLIB_FOUND
+// Inflate a raw deflate (`raw`) or zlib stream in chunks, appending to
+// `out` and stopping at `limit` bytes. False if the stream is corrupt,
+// truncated or over the limit; what was inflated stays in `out`.
+static bool inflate_into(const uint8_t* in, size_t n, bool raw, size_t limit, Buffer& out) {
+    static const size_t kChunk = size_t(256) << 10;
+
+    z_stream stream = {};
+    if (inflateInit2(&stream, raw ? -MAX_WBITS : MAX_WBITS) != Z_OK) {
+        return false;
+    }
+
+    size_t fed = 0;
+    int status = Z_OK;
+    while (status != Z_STREAM_END) {
+        if (stream.avail_in == 0 && fed < n) {
+            size_t step = std::min<size_t>(n - fed, UINT_MAX);
+            stream.next_in = const_cast<Bytef*>(in + fed);
+            stream.avail_in = static_cast<uInt>(step);
+            fed += step;
+        }
+        size_t at = out.size();
+        if (at >= limit) {
+            break;
+        }
+        size_t room = std::min(kChunk, limit - at);
+        out.resize(at + room);
+        stream.next_out = out.data() + at;
+        stream.avail_out = static_cast<uInt>(room);
+        status = inflate(&stream, Z_NO_FLUSH);
+        out.resize(at + room - stream.avail_out);
+
+        bool starved = status == Z_BUF_ERROR && stream.avail_in == 0 && fed == n;
+        if (starved || (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR)) {
+            break;
+        }
+    }
+    inflateEnd(&stream);
+    return status == Z_STREAM_END;
+}
+#endif
+
+static void append_utf8(uint32_t cp, uint8_t*& out) {
+    if (cp < 0x80) {
+        *out++ = static_cast<uint8_t>(cp);
+    } else if (cp < 0x800) {
+        *out++ = static_cast<uint8_t>(0xC0 | (cp >> 6));
+        *out++ = static_cast<uint8_t>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        *out++ = static_cast<uint8_t>(0xE0 | (cp >> 12));
+        *out++ = static_cast<uint8_t>(0x80 | ((cp >> 6) & 0x3F));
+        *out++ = static_cast<uint8_t>(0x80 | (cp & 0x3F));
+    } else {
+        *out++ = static_cast<uint8_t>(0xF0 | (cp >> 18));
+        *out++ = static_cast<uint8_t>(0x80 | ((cp >> 12) & 0x3F));
+        *out++ = static_cast<uint8_t>(0x80 | ((cp >> 6) & 0x3F));
+        *out++ = static_cast<uint8_t>(0x80 | (cp & 0x3F));
+    }
+}
+
+// Resolve the predefined XML entities and character references in place,
+// so "p&amp;ss" in sharedStrings.xml is scanned as "p&ss". Every reference
+// is at least as long as its UTF-8 encoding. Returns the new length.
+static size_t decode_xml_entities(uint8_t* data, size_t n) {
+    uint8_t* out = data;
+    size_t r = 0;
+    while (r < n) {
+        const void* amp = std::memchr(data + r, '&', n - r);
+        size_t next = amp ? static_cast<size_t>(static_cast<const uint8_t*>(amp) - data) : n;
+        std::memmove(out, data + r, next - r);
+        out += next - r;
+        r = next;
+        if (r >= n) {
+            break;
+        }
+
+        size_t end = r + 1;
+        while (end < n && end - r <= 10 && data[end] != ';') {
+            ++end;
+        }
+        std::string_view name = end < n && data[end] == ';' ? as_text(data + r + 1, end - r - 1) : std::string_view();
+        uint32_t cp = 0;
+        if (name == "amp") {
+            cp = '&';
+        } else if (name == "lt") {
+            cp = '<';
+        } else if (name == "gt") {
+            cp = '>';
+        } else if (name == "quot") {
+            cp = '"';
+        } else if (name == "apos") {
+            cp = '\'';
+        } else if (name.size() > 1 && name[0] == '#') {
+            bool hex = name[1] == 'x' || name[1] == 'X';
+            std::string digits(name.substr(hex ? 2 : 1));
+            char* parsed = nullptr;
+            unsigned long value = digits.empty() ? 0 : std::strtoul(digits.c_str(), &parsed, hex ? 16 : 10);
+            if (!digits.empty() && parsed && *parsed == '\0' && value > 0 && value <= 0x10FFFF) {
+                cp = static_cast<uint32_t>(value);
+            }
+        }
+
+        if (cp == 0) {
+            *out++ = data[r++];
+            continue;
+        }
+        append_utf8(cp, out);
+        r = end + 1;
+    }
+    return static_cast<size_t>(out - data);
+}
+
+static void decode_ascii85(const uint8_t* in, size_t n, Buffer& out) {
+    uint64_t tuple = 0;
+    int count = 0;
+    auto emit = [&](int bytes) {
+        for (int k = 0; k < bytes; ++k) {
+            out.push_back(static_cast<uint8_t>(tuple >> (24 - 8 * k)));
+        }
+    };
+
+    for (size_t i = 0; i < n; ++i) {
+        uint8_t c = in[i];
+        if (c == '~') {
+            break;
+        }
+        if (c == 'z' && count == 0) {
+            out.insert(out.end(), 4, 0);
+            continue;
+        }
+        if (c < '!' || c > 'u') {
+            continue;  // Whitespace
+        }
+        tuple = tuple * 85 + (c - '!');
+        if (++count == 5) {
+            tuple &= 0xFFFFFFFFu;
+            emit(4);
+            tuple = 0;
+            count = 0;
+        }
+    }
+    if (count > 1) {
+        for (int k = count; k < 5; ++k) {
+            tuple = tuple * 85 + 84;
+        }
+        tuple &= 0xFFFFFFFFu;
+        emit(count - 1);
+    }
+}
+
+static void decode_base64(const uint8_t* in, size_t n, Buffer& out) {
+    static const struct Table {
+        int8_t value[256];
+        Table() {
+            std::memset(value, -1, sizeof(value));
+            const char* symbols = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+            for (int i = 0; i < 64; ++i) {
+                value[static_cast<uint8_t>(symbols[i])] = static_cast<int8_t>(i);
+            }
+        }
+    } table;
+
+    out.reserve(out.size() + n / 4 * 3);
+    uint32_t bits = 0;
+    int count = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (in[i] == '=') {
+            break;
+        }
+        int8_t v = table.value[in[i]];
+        if (v < 0) {
+            continue;  // Line breaks
+        }
+        bits = (bits << 6) | static_cast<uint32_t>(v);
+        if (++count == 4) {
+            out.push_back(static_cast<uint8_t>(bits >> 16));
+            out.push_back(static_cast<uint8_t>(bits >> 8));
+            out.push_back(static_cast<uint8_t>(bits));
+            bits = 0;
+            count = 0;
+        }
+    }
+    if (count >= 2) {
+        bits <<= 6 * (4 - count);
+        out.push_back(static_cast<uint8_t>(bits >> 16));
+        if (count == 3) {
+            out.push_back(static_cast<uint8_t>(bits >> 8));
+        }
+    }
+}
+
+static void decode_quoted_printable(const uint8_t* in, size_t n, Buffer& out) {
+    auto hex = [](uint8_t c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    };
+
+    out.reserve(out.size() + n);
+    for (size_t i = 0; i < n; ++i) {
+        if (in[i] != '=') {
+            out.push_back(in[i]);
+        } else if (i + 1 < n && in[i + 1] == '\n') {
+            i += 1;  // Soft line break
+        } else if (i + 2 < n && in[i + 1] == '\r' && in[i + 2] == '\n') {
+            i += 2;
+        } else if (i + 2 < n && hex(in[i + 1]) >= 0 && hex(in[i + 2]) >= 0) {
+            out.push_back(static_cast<uint8_t>(hex(in[i + 1]) << 4 | hex(in[i + 2])));
+            i += 2;
+        } else {
+            out.push_back(in[i]);
+        }
+    }
+}
+
+// Scans one file and whatever containers it holds
+class DocumentScanner {
+public:
+    DocumentScanner(const PatternRegistry& patterns, const std::vector<bool>& selected,
+                    const ScanOptions& options, FileReport& report)
+        : patterns(patterns), selected(selected), options(options), report(report) {}
+
+    void scan_file() {
+        tracing::Span span(tracing::SCAN, "scan.file");
+        InputFile file;
+        if (!file.open(report.path, report.error)) {
+            return;
+        }
+        report.bytes = file.size;
+        span.set_value(static_cast<int64_t>(file.size));
+        report.format = scan_content(file.data, file.size, 0);
+    }
+
+private:
+    static constexpr int kMaxDepth = 3;  // Containers inside containers (an xlsx attached to an email)
+
+    // Returns the detected format
+    const char* scan_content(const uint8_t* data, size_t n, int depth) {
+        bool nested = options.decode && depth < kMaxDepth;
+        if (nested && n >= 4 && std::memcmp(data, "PK\x03\x04", 4) == 0 && scan_zip(data, n, depth)) {
+            return "zip";
+        }
+
+        scan_region(data, n);
+        if (!nested) {
+            return "text";
+        }
+        if (n >= 5 && std::memcmp(data, "%PDF-", 5) == 0) {
+            scan_pdf_streams(data, n, depth);
+            return "pdf";
+        }
+        if (starts_with_header(as_text(data, std::min<size_t>(n, 1024)))) {
+            return scan_mime_bodies(data, n, depth) ? "mime" : "text";
+        }
+        return "text";
+    }
+
+    void scan_region(const uint8_t* data, size_t n) {
+        credential_scan::scan(patterns, data, n, selected, matches);
+        for (size_t p = 0; p < matches.size(); ++p) {
+            for (const auto& span : matches[p]) {
+                report.hits.emplace_back(p, std::string(reinterpret_cast<const char*>(data) + span.first,
+                                                        span.second - span.first));
+            }
+        }
+        report.bytes_scanned += n;
+    }
+
+    // Decoded content of one part, scanned (and searched for nested
+    // containers) before its scratch memory is rewound
+    void scan_decoded(Buffer& decoded, bool xml, int depth) {
+        size_t n = decoded.size();
+        if (xml) {
+            n = decode_xml_entities(decoded.data(), n);
+        }
+        report.parts++;
+        scan_content(decoded.data(), n, depth + 1);
+    }
+
+    struct ZipEntry {
+        std::string name;
+        uint16_t flags;
+        uint16_t method;
+        uint64_t compressed;
+        uint64_t size;
+        uint64_t local_offset;
+    };
+
+    // Central directory of a zip archive, zip64 included
+    static bool read_zip_directory(const uint8_t* data, size_t n, std::vector<ZipEntry>& entries) {
+        if (n < 22) {
+            return false;
+        }
+        size_t eocd = n - 22;
+        size_t lowest = n > 22 + 65535 ? n - 22 - 65535 : 0;
+        while (le32(data + eocd) != 0x06054b50) {
+            if (eocd == lowest) {
+                return false;
+            }
+            --eocd;
+        }
+
+        uint64_t count = le16(data + eocd + 10);
+        uint64_t offset = le32(data + eocd + 16);
+        if ((count == 0xFFFF || offset == 0xFFFFFFFFu) && eocd >= 20 && le32(data + eocd - 20) == 0x07064b50) {
+            uint64_t record = le64(data + eocd - 20 + 8);
+            if (record + 56 > n || le32(data + record) != 0x06064b50) {
+                return false;
+            }
+            count = le64(data + record + 32);
+            offset = le64(data + record + 48);
+        }
+
+        size_t at = static_cast<size_t>(offset);
+        for (uint64_t i = 0; i < count; ++i) {
+            if (at + 46 > n || le32(data + at) != 0x02014b50) {
+                return false;
+            }
+            ZipEntry entry;
+            entry.flags = le16(data + at + 8);
+            entry.method = le16(data + at + 10);
+            entry.compressed = le32(data + at + 20);
+            entry.size = le32(data + at + 24);
+            entry.local_offset = le32(data + at + 42);
+            size_t name_length = le16(data + at + 28);
+            size_t extra_length = le16(data + at + 30);
+            size_t comment_length = le16(data + at + 32);
+            if (at + 46 + name_length + extra_length + comment_length > n) {
+                return false;
+            }
+            entry.name.assign(reinterpret_cast<const char*>(data + at + 46), name_length);
+
+            // Zip64 extra field: 64-bit values for the fields saturated above, in order
+            const uint8_t* extra = data + at + 46 + name_length;
+            for (size_t e = 0; e + 4 <= extra_length;) {
+                uint16_t id = le16(extra + e);
+                uint16_t length = le16(extra + e + 2);
+                if (id == 0x0001) {
+                    const uint8_t* field = extra + e + 4;
+                    const uint8_t* field_end = field + std::min<size_t>(length, extra_length - e - 4);
+                    for (uint64_t* value : {&entry.size, &entry.compressed, &entry.local_offset}) {
+                        if (*value == 0xFFFFFFFFu && field + 8 <= field_end) {
+                            *value = le64(field);
+                            field += 8;
+                        }
+                    }
+                }
+                e += 4 + length;
+            }
+
+            entries.push_back(std::move(entry));
+            at += 46 + name_length + extra_length + comment_length;
+        }
+        return true;
+    }
+
+    static bool has_suffix(const std::string& name, const char* suffix) {
+        size_t length = std::strlen(suffix);
+        return name.size() >= length &&
+               std::equal(name.end() - length, name.end(), suffix, [](char a, char b) {
+                   return std::tolower(static_cast<unsigned char>(a)) == b;
+               });
+    }
+
+    static bool is_xml_part(const std::string& name) {
+        return has_suffix(name, ".xml") || has_suffix(name, ".rels") || has_suffix(name, ".vml");
+    }
+
+    static bool is_text_part(const std::string& name) {
+        return is_xml_part(name) || has_suffix(name, ".txt") || has_suffix(name, ".csv") ||
+               has_suffix(name, ".json") || has_suffix(name, ".html") || has_suffix(name, ".htm");
+    }
+
+    // False when this is not a readable zip archive, which is then scanned as raw bytes
+    bool scan_zip(const uint8_t* data, size_t n, int depth) {
+        std::vector<ZipEntry> entries;
+        if (!read_zip_directory(data, n, entries)) {
+            return false;
+        }
+
+        for (const ZipEntry& entry : entries) {
+            if (entry.name.empty() || entry.name.back() == '/' || (!options.all_parts && !is_text_part(entry.name))) {
+                continue;
+            }
+
+            size_t header = static_cast<size_t>(entry.local_offset);
+            if (header + 30 > n || le32(data + header) != 0x04034b50 || (entry.flags & 1)) {
+                report.parts_skipped++;  // Corrupt or encrypted
+                continue;
+            }
+            size_t start = header + 30 + le16(data + header + 26) + le16(data + header + 28);
+            if (start > n || entry.compressed > n - start) {
+                report.parts_skipped++;
+                continue;
+            }
+            const uint8_t* body = data + start;
+            size_t length = static_cast<size_t>(entry.compressed);
+            bool xml = is_xml_part(entry.name);
+
+            memory_arena::Scope scratch;
+            Buffer decoded{memory_arena::ArenaAllocator<uint8_t>(scratch.arena())};
+            if (entry.method == 0) {
+                if (!xml || !std::memchr(body, '&', length)) {
+                    // Stored without entities: scan the mapping in place
+                    report.parts++;
+                    scan_content(body, length, depth + 1);
+                    continue;
+                }
+                decoded.assign(body, body + length);
+            } else if (entry.method == 8) {
+#ifdef ZLIB_FOUND
+                decoded.reserve(static_cast<size_t>(std::min<uint64_t>(entry.size, options.max_part_size)));
+                if (!inflate_into(body, length, true, options.max_part_size, decoded)) {
+                    report.parts_skipped++;
+                }
+#else
+                report.parts_skipped++;
+                continue;
+#endif
+            } else {
+                report.parts_skipped++;  // Deflate64, bzip2, LZMA...
+                continue;
+            }
+            scan_decoded(decoded, xml, depth);
+        }
+        return true;
+    }
+
+    enum class PdfFilter { FLATE, ASCII85, UNSUPPORTED };
+
+    // Filters named in a stream dictionary, in the order they apply
+    static std::vector<PdfFilter> pdf_filters(std::string_view dict) {
+        std::vector<PdfFilter> filters;
+        size_t at = dict.find("/Filter");
+        if (at == std::string_view::npos) {
+            return filters;
+        }
+        at += 7;
+        while (at < dict.size() && (dict[at] == ' ' || dict[at] == '\r' || dict[at] == '\n')) {
+            ++at;
+        }
+        bool array = at < dict.size() && dict[at] == '[';
+        size_t end = array ? dict.find(']', at) : dict.find_first_of(" \r\n/>", dict.find('/', at) + 1);
+        std::string_view names = dict.substr(at, end == std::string_view::npos ? std::string_view::npos : end - at);
+
+        for (size_t slash = names.find('/'); slash != std::string_view::npos; slash = names.find('/', slash + 1)) {
+            size_t stop = names.find_first_of(" \r\n/]>", slash + 1);
+            std::string_view name = names.substr(slash + 1, stop == std::string_view::npos ? std::string_view::npos : stop - slash - 1);
+            if (name == "FlateDecode" || name == "Fl") {
+                filters.push_back(PdfFilter::FLATE);
+            } else if (name == "ASCII85Decode" || name == "A85") {
+                filters.push_back(PdfFilter::ASCII85);
+            } else {
+                filters.push_back(PdfFilter::UNSUPPORTED);
+            }
+        }
+        return filters;
+    }
+
+    // Decode filtered streams; unfiltered ones were covered by the raw scan
+    void scan_pdf_streams(const uint8_t* data, size_t n, int depth) {
+        std::string_view text = as_text(data, n);
+        size_t pos = 0;
+        size_t previous_end = 0;
+        while ((pos = text.find("stream", pos)) != std::string_view::npos) {
+            size_t keyword = pos;
+            pos += 6;
+            if (keyword >= 3 && text.compare(keyword - 3, 3, "end") == 0) {
+                continue;
+            }
+            size_t start = pos;
+            if (start < n && text[start] == '\r') {
+                ++start;
+            }
+            if (start >= n || text[start] != '\n') {
+                continue;
+            }
+            ++start;
+            size_t end = text.find("endstream", start);
+            if (end == std::string_view::npos) {
+                break;
+            }
+            pos = end + 9;
+
+            // The dictionary sits between the object header and the keyword
+            size_t window = std::max(previous_end, keyword > 4096 ? keyword - 4096 : size_t(0));
+            size_t object = text.rfind("obj", keyword);
+            size_t dict_start = object != std::string_view::npos && object >= window ? object : window;
+            std::vector<PdfFilter> filters = pdf_filters(text.substr(dict_start, keyword - dict_start));
+            previous_end = pos;
+            if (filters.empty()) {
+                continue;
+            }
+
+            memory_arena::Scope scratch;
+            memory_arena::ArenaAllocator<uint8_t> allocator(scratch.arena());
+            Buffer input{allocator};
+            Buffer output{allocator};
+            const uint8_t* current = data + start;
+            size_t length = end - start;
+            bool ok = true;
+            for (PdfFilter filter : filters) {
+                output.clear();
+                if (filter == PdfFilter::ASCII85) {
+                    decode_ascii85(current, length, output);
+                } else if (filter == PdfFilter::FLATE) {
+#ifdef ZLIB_FOUND
+                    // Streams that end mid-block (a common writer quirk) still get what inflated
+                    inflate_into(current, length, false, options.max_part_size, output);
+#else
+                    ok = false;
+#endif
+                } else {
+                    ok = false;  // Image and other binary filters
+                }
+                if (!ok) {
+                    break;
+                }
+                input.swap(output);
+                current = input.data();
+                length = input.size();
+            }
+
+            if (!ok) {
+                report.parts_skipped++;
+                continue;
+            }
+            scan_decoded(input, false, depth);
+        }
+    }
+
+    // A header line such as "From: ..." or "Content-Type: ..."
+    static bool starts_with_header(std::string_view text) {
+        size_t colon = text.find(':');
+        if (colon == 0 || colon == std::string_view::npos || colon > 76) {
+            return false;
+        }
+        for (size_t i = 0; i < colon; ++i) {
+            unsigned char c = static_cast<unsigned char>(text[i]);
+            if (!(std::isalnum(c) || c == '-')) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Walk MIME header blocks (the message's and each part's after a
+    // boundary line) and decode base64 and quoted-printable bodies.
+    // Returns whether any body was decoded.
+    bool scan_mime_bodies(const uint8_t* data, size_t n, int depth) {
+        std::string_view text = as_text(data, n);
+        enum class Encoding { NONE, BASE64, QUOTED_PRINTABLE };
+        Encoding encoding = Encoding::NONE;
+        bool html = false;
+        bool in_headers = true;
+        bool decoded_any = false;
+
+        size_t line = 0;
+        while (line < n) {
+            size_t eol = text.find('\n', line);
+            size_t next = eol == std::string_view::npos ? n : eol + 1;
+            std::string_view content = text.substr(line, next - line);
+            while (!content.empty() && (content.back() == '\n' || content.back() == '\r')) {
+                content.remove_suffix(1);
+            }
+
+            if (content.size() >= 2 && content[0] == '-' && content[1] == '-') {
+                in_headers = true;  // Boundary: a part's headers follow
+                encoding = Encoding::NONE;
+                html = false;
+            } else if (in_headers && content.empty()) {
+                in_headers = false;
+                if (encoding != Encoding::NONE) {
+                    // The body runs to the next boundary line
+                    size_t boundary = next < n ? text.find("\n--", next - 1) : std::string_view::npos;
+                    size_t body_end = boundary == std::string_view::npos ? n : boundary + 1;
+
+                    memory_arena::Scope scratch;
+                    Buffer decoded{memory_arena::ArenaAllocator<uint8_t>(scratch.arena())};
+                    if (encoding == Encoding::BASE64) {
+                        decode_base64(data + next, body_end - next, decoded);
+                    } else {
+                        decode_quoted_printable(data + next, body_end - next, decoded);
+                    }
+                    scan_decoded(decoded, html, depth);
+                    decoded_any = true;
+                    next = body_end;
+                }
+                encoding = Encoding::NONE;
+            } else if (in_headers) {
+                if (starts_with_nocase(content, "content-transfer-encoding:")) {
+                    std::string_view value = content.substr(26);
+                    if (contains_nocase(value, "base64")) {
+                        encoding = Encoding::BASE64;
+                    } else if (contains_nocase(value, "quoted-printable")) {
+                        encoding = Encoding::QUOTED_PRINTABLE;
+                    }
+                } else if (starts_with_nocase(content, "content-type:")) {
+                    html = contains_nocase(content, "text/html");
+                }
+            }
+            line = next;
+        }
+        return decoded_any;
+    }
+
+    const PatternRegistry& patterns;
+    const std::vector<bool>& selected;
+    const ScanOptions& options;
+    FileReport& report;
+    credential_scan::Matches matches;
+};
+
+static bool parse_scan_options(PyObject* options_obj, ScanOptions& options) {
+    if (!options_obj || options_obj == Py_None) {
+        return true;
+    }
+    if (!PyDict_Check(options_obj)) {
+        PyErr_SetString(PyExc_TypeError, "options must be a dict");
+        return false;
+    }
+
+    PyObject* key;
+    PyObject* value;
+    Py_ssize_t pos = 0;
+    while (PyDict_Next(options_obj, &pos, &key, &value)) {
+        const char* name = PyUnicode_Check(key) ? PyUnicode_AsUTF8(key) : nullptr;
+        if (!name) {
+            PyErr_SetString(PyExc_TypeError, "Option names must be strings");
+            return false;
+        }
+
+        if (std::strcmp(name, "threads") == 0) {
+            options.threads = static_cast<int>(PyLong_AsLong(value));
+        } else if (std::strcmp(name, "pin_threads") == 0) {
+            options.pin_threads = PyObject_IsTrue(value) == 1;
+        } else if (std::strcmp(name, "decode") == 0) {
+            options.decode = PyObject_IsTrue(value) == 1;
+        } else if (std::strcmp(name, "all_parts") == 0) {
+            options.all_parts = PyObject_IsTrue(value) == 1;
+        } else if (std::strcmp(name, "max_part_size") == 0) {
+            options.max_part_size = PyLong_AsSize_t(value);
+        } else {
+            PyErr_Format(PyExc_ValueError, "Unknown scan option: %s", name);
+            return false;
+        }
+        if (PyErr_Occurred()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Paths as given; directories are expanded after the GIL is released
+static bool parse_paths(PyObject* paths_obj, std::vector<std::string>& paths) {
+    auto add = [&](PyObject* item) {
+        PyObject* encoded;
+        if (!PyUnicode_FSConverter(item, &encoded)) {
+            return false;
+        }
+        paths.emplace_back(PyBytes_AS_STRING(encoded), PyBytes_GET_SIZE(encoded));
+        Py_DECREF(encoded);
+        return true;
+    };
+
+    if (PyUnicode_Check(paths_obj) || PyBytes_Check(paths_obj) || PyObject_HasAttrString(paths_obj, "__fspath__")) {
+        return add(paths_obj);
+    }
+    PyObject* seq = PySequence_Fast(paths_obj, "paths must be a path or a sequence of paths");
+    if (!seq) {
+        return false;
+    }
+    for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(seq); ++i) {
+        if (!add(PySequence_Fast_GET_ITEM(seq, i))) {
+            Py_DECREF(seq);
+            return false;
+        }
+    }
+    Py_DECREF(seq);
+    return true;
+}
+
+// Files under each path; directories are walked recursively in name order
+static void expand_paths(const std::vector<std::string>& paths, std::vector<FileReport>& files) {
+    namespace fs = std::filesystem;
+    for (const std::string& path : paths) {
+        std::error_code ec;
+        if (!fs::is_directory(path, ec)) {
+            files.emplace_back();
+            files.back().path = path;
+            continue;
+        }
+
+        std::vector<std::string> found;
+        for (fs::recursive_directory_iterator it(path, fs::directory_options::skip_permission_denied, ec), end;
+             !ec && it != end; it.increment(ec)) {
+            if (it->is_regular_file(ec)) {
+                found.push_back(it->path().string());
+            }
+        }
+        std::sort(found.begin(), found.end());
+        for (std::string& file : found) {
+            files.emplace_back();
+            files.back().path = std::move(file);
+        }
+    }
+}
+
+static PyObject* file_report_dict(const PatternRegistry& patterns, const FileReport& report) {
+    PyObject* hits = PyDict_New();
+    for (const auto& hit : report.hits) {
+        const char* type = credential_scan::type_name(patterns, hit.first).c_str();
+        PyObject* list = PyDict_GetItemString(hits, type);
+        if (!list) {
+            list = PyList_New(0);
+            PyDict_SetItemString(hits, type, list);
+            Py_DECREF(list);
+        }
+        PyObject* text = PyUnicode_DecodeUTF8(hit.second.data(), static_cast<Py_ssize_t>(hit.second.size()), "replace");
+        PyList_Append(list, text);
+        Py_DECREF(text);
+    }
+
+    PyObject* error = report.error.empty() ? Py_None : PyUnicode_FromString(report.error.c_str());
+    if (error == Py_None) {
+        Py_INCREF(error);
+    }
+    return Py_BuildValue("{s:s,s:s,s:K,s:K,s:I,s:I,s:d,s:N,s:N}",
+                         "path", report.path.c_str(),
+                         "format", report.format,
+                         "bytes", static_cast<unsigned long long>(report.bytes),
+                         "bytes_scanned", static_cast<unsigned long long>(report.bytes_scanned),
+                         "parts", report.parts,
+                         "parts_skipped", report.parts_skipped,
+                         "seconds", report.seconds,
+                         "hits", hits,
+                         "error", error);
+}
+
+static PyObject* scan_corpus(PyObject* self, PyObject* args) {
+    PyObject* paths_obj;
+    PyObject* types_obj = Py_None;
+    PyObject* options_obj = nullptr;
+
+    if (!PyArg_ParseTuple(args, "O|OO", &paths_obj, &types_obj, &options_obj)) {
+        return nullptr;
+    }
+
+    std::vector<std::string> paths;
+    std::vector<std::string> types;
+    ScanOptions options;
+    if (!parse_paths(paths_obj, paths) || !parse_scan_options(options_obj, options)) {
+        return nullptr;
+    }
+    if (types_obj != Py_None) {
+        PyObject* seq = PyUnicode_Check(types_obj) ? nullptr : PySequence_Fast(types_obj, "types must be a type name or a sequence of names");
+        if (!seq && !PyUnicode_Check(types_obj)) {
+            return nullptr;
+        }
+        Py_ssize_t count = seq ? PySequence_Fast_GET_SIZE(seq) : 1;
+        for (Py_ssize_t i = 0; i < count; ++i) {
+            PyObject* item = seq ? PySequence_Fast_GET_ITEM(seq, i) : types_obj;
+            const char* name = PyUnicode_Check(item) ? PyUnicode_AsUTF8(item) : nullptr;
+            if (!name) {
+                Py_XDECREF(seq);
+                PyErr_SetString(PyExc_TypeError, "Credential types must be names");
+                return nullptr;
+            }
+            types.emplace_back(name);
+        }
+        Py_XDECREF(seq);
+    }
+
+    std::shared_ptr<const PatternRegistry> patterns = credential_scan::patterns();
+    if (!patterns) {
+        PyErr_SetString(PyExc_RuntimeError, "Patterns not compiled; call credential_utils.compile_patterns() first");
+        return nullptr;
+    }
+    std::vector<bool> selected;
+    if (!types.empty()) {
+        selected.assign(credential_scan::count(*patterns), false);
+        for (const std::string& type : types) {
+            long index = credential_scan::find(*patterns, type);
+            if (index < 0) {
+                PyErr_Format(PyExc_KeyError, "Unknown or uncompiled credential type: %s", type.c_str());
+                return nullptr;
+            }
+            if (!credential_scan::scannable(*patterns, static_cast<size_t>(index))) {
+                PyErr_Format(PyExc_ValueError, "Credential type '%s' is too large to scan for", type.c_str());
+                return nullptr;
+            }
+            selected[index] = true;
+        }
+    }
+
+    std::vector<FileReport> files;
+    int threads = 0;
+    double seconds = 0.0;
+
+    Py_BEGIN_ALLOW_THREADS
+    auto started = std::chrono::steady_clock::now();
+    expand_paths(paths, files);
+
+    // Largest files first so one big file does not finish last on its own
+    std::vector<std::pair<uintmax_t, size_t>> order;
+    for (size_t i = 0; i < files.size(); ++i) {
+        std::error_code ec;
+        uintmax_t size = std::filesystem::file_size(files[i].path, ec);
+        order.emplace_back(ec ? 0 : size, i);
+    }
+    std::sort(order.begin(), order.end(), std::greater<>());
+
+    {
+        ParallelExecutor executor(options.threads, options.pin_threads);
+        threads = executor.get_stats().num_threads;
+        std::vector<std::future<void>> done;
+        for (const auto& entry : order) {
+            FileReport* report = &files[entry.second];
+            done.push_back(executor.submit([&patterns, &selected, &options, report]() {
+                auto file_started = std::chrono::steady_clock::now();
+                try {
+                    DocumentScanner(*patterns, selected, options, *report).scan_file();
+                } catch (const std::exception& e) {
+                    report->error = e.what();
+                }
+                report->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - file_started).count();
+            }));
+        }
+        for (auto& future : done) {
+            future.wait();
+        }
+    }
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    Py_END_ALLOW_THREADS
+
+    uint64_t bytes = 0;
+    uint64_t bytes_scanned = 0;
+    uint64_t parts = 0;
+    uint64_t matches = 0;
+    uint64_t failed = 0;
+    PyObject* file_list = PyList_New(files.size());
+    for (size_t i = 0; i < files.size(); ++i) {
+        const FileReport& report = files[i];
+        bytes += report.bytes;
+        bytes_scanned += report.bytes_scanned;
+        parts += report.parts;
+        matches += report.hits.size();
+        failed += report.error.empty() ? 0 : 1;
+        PyList_SET_ITEM(file_list, i, file_report_dict(*patterns, report));
+    }
+
+    double rate = seconds > 0 ? 1.0 / (seconds * 1e6) : 0.0;
+    PyObject* stats = Py_BuildValue("{s:n,s:K,s:K,s:K,s:K,s:K,s:i,s:d,s:d,s:d}",
+                                    "files", static_cast<Py_ssize_t>(files.size()),
+                                    "failed", static_cast<unsigned long long>(failed),
+                                    "bytes", static_cast<unsigned long long>(bytes),
+                                    "bytes_scanned", static_cast<unsigned long long>(bytes_scanned),
+                                    "parts", static_cast<unsigned long long>(parts),
+                                    "matches", static_cast<unsigned long long>(matches),
+                                    "threads", threads,
+                                    "seconds", seconds,
+                                    "mb_per_s", bytes * rate,
+                                    "scanned_mb_per_s", bytes_scanned * rate);
+    return Py_BuildValue("{s:N,s:N}", "files", file_list, "stats", stats);
+}
+
+static PyMethodDef CorpusScannerMethods[] = {
+    {"scan", scan_corpus, METH_VARARGS, "Scan files or directories for compiled credential types on all cores, decoding zip parts, PDF streams and MIME bodies; returns per-file hits and throughput stats"},
+    {nullptr, nullptr, 0, nullptr}
+};
+
+// Scans run on private executors and touch no Python state without the GIL
+static PyModuleDef_Slot CorpusScannerSlots[] = {
+#if PY_VERSION_HEX >= 0x030C0000
+    {Py_mod_multiple_interpreters, Py_MOD_MULTIPLE_INTERPRETERS_SUPPORTED},
+#endif
+#if PY_VERSION_HEX >= 0x030D0000
+    {Py_mod_gil, Py_MOD_GIL_NOT_USED},
+#endif
+    {0, nullptr}
+};
+
+static struct PyModuleDef corpusscannermodule = {
+    PyModuleDef_HEAD_INIT,
+    "corpus_scanner",
+    "Parallel credential scanner for generated corpora",
+    0,
+    CorpusScannerMethods,
+    CorpusScannerSlots
+};
+
+PyMODINIT_FUNC PyInit_corpus_scanner(void) {
+    return PyModuleDef_Init(&corpusscannermodule);
+}
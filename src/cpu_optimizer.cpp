@@ -7,12 +7,864 @@
 #include <algorithm>
 #include <numeric>
 #include <iostream>
+#include <functional>
+#include <memory>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <set>
 #include <immintrin.h>  // For AVX/SSE instructions
 
+#ifdef __linux__
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include <unistd.h>
+
+#include "cpu_topology.h"
+#include "simd_kernels.h"
+#include "tracing.h"
+
 extern "C" {
     #include <Python.h>
 }
 
+#include "native_buffer.h"
+
+// Runtime-dispatched alphabet-mapping kernels (see simd_kernels.h)
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CF_SIMD_X86 1
+#define CF_TARGET(isa) __attribute__((target(isa)))
+#else
+#define CF_SIMD_X86 0
+#define CF_TARGET(isa)
+#endif
+
+namespace simd_kernels {
+
+const char kHexLowerTable[64] = {
+    '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f',
+    '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f',
+    '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f',
+    '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'
+};
+
+const char kBase64Table[64] = {
+    'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P',
+    'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z', 'a', 'b', 'c', 'd', 'e', 'f',
+    'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p', 'q', 'r', 's', 't', 'u', 'v',
+    'w', 'x', 'y', 'z', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '+', '/'
+};
+
+const char kBase64UrlTable[64] = {
+    'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P',
+    'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z', 'a', 'b', 'c', 'd', 'e', 'f',
+    'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p', 'q', 'r', 's', 't', 'u', 'v',
+    'w', 'x', 'y', 'z', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '-', '_'
+};
+
+static std::atomic<int> level_override{-1};
+
+static Level detect_level() {
+#if CF_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512vbmi") && __builtin_cpu_supports("avx512bw")) {
+        return Level::AVX512VBMI;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return Level::AVX2;
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        return Level::SSSE3;
+    }
+#endif
+    return Level::SCALAR;
+}
+
+Level detected_level() {
+    static const Level level = detect_level();
+    return level;
+}
+
+Level active_level() {
+    int forced = level_override.load(std::memory_order_relaxed);
+    return forced >= 0 ? static_cast<Level>(forced) : detected_level();
+}
+
+void set_level_override(Level level) {
+    int clamped = std::min(static_cast<int>(level), static_cast<int>(detected_level()));
+    level_override.store(clamped, std::memory_order_relaxed);
+}
+
+void clear_level_override() {
+    level_override.store(-1, std::memory_order_relaxed);
+}
+
+const char* level_name(Level level) {
+    switch (level) {
+        case Level::SSSE3: return "ssse3";
+        case Level::AVX2: return "avx2";
+        case Level::AVX512VBMI: return "avx512vbmi";
+        default: return "scalar";
+    }
+}
+
+static size_t index_mask(size_t k) {
+    size_t mask = 1;
+    while (mask < k) {
+        mask <<= 1;
+    }
+    return mask - 1;
+}
+
+static size_t map_alphabet_scalar(const uint8_t* in, size_t n, const char* table, size_t k,
+                                  char* out, size_t out_capacity, size_t& consumed) {
+    const uint8_t mask = static_cast<uint8_t>(index_mask(k));
+    size_t produced = 0;
+    size_t i = 0;
+    
+    for (; i < n && produced < out_capacity; ++i) {
+        uint8_t idx = in[i] & mask;
+        if (idx < k) {
+            out[produced++] = table[idx];
+        }
+    }
+    
+    consumed = i;
+    return produced;
+}
+
+static size_t base64_encode_scalar(const uint8_t* in, size_t n, const char* table, char* out, bool pad) {
+    size_t o = 0;
+    size_t i = 0;
+    
+    for (; i + 3 <= n; i += 3) {
+        uint32_t v = (static_cast<uint32_t>(in[i]) << 16) | (static_cast<uint32_t>(in[i + 1]) << 8) | in[i + 2];
+        out[o++] = table[(v >> 18) & 0x3F];
+        out[o++] = table[(v >> 12) & 0x3F];
+        out[o++] = table[(v >> 6) & 0x3F];
+        out[o++] = table[v & 0x3F];
+    }
+    
+    size_t rest = n - i;
+    if (rest > 0) {
+        uint32_t v = static_cast<uint32_t>(in[i]) << 16;
+        if (rest == 2) {
+            v |= static_cast<uint32_t>(in[i + 1]) << 8;
+        }
+        out[o++] = table[(v >> 18) & 0x3F];
+        out[o++] = table[(v >> 12) & 0x3F];
+        if (rest == 2) {
+            out[o++] = table[(v >> 6) & 0x3F];
+        } else if (pad) {
+            out[o++] = '=';
+        }
+        if (pad) {
+            out[o++] = '=';
+        }
+    }
+    
+    return o;
+}
+
+static inline uint8_t literal_fingerprint(const LiteralMasks& masks, uint8_t a, uint8_t b) {
+    return masks.lo[0][a & 15] & masks.hi[0][a >> 4] & masks.lo[1][b & 15] & masks.hi[1][b >> 4];
+}
+
+static size_t literal_candidates_scalar(const uint8_t* data, size_t n, size_t& pos, const LiteralMasks& masks,
+                                        uint64_t* hits, size_t capacity) {
+    size_t count = 0;
+    size_t i = pos;
+    for (; i + 1 < n && count < capacity; ++i) {
+        uint8_t buckets = literal_fingerprint(masks, data[i], data[i + 1]);
+        if (buckets) {
+            hits[count++] = (static_cast<uint64_t>(i) << 8) | buckets;
+        }
+    }
+    pos = i + 1 < n ? i : n;
+    return count;
+}
+
+#if CF_SIMD_X86
+
+// 64-entry lookup from four 16-byte pshufb tables; idx lanes must be < 64
+CF_TARGET("ssse3")
+static inline __m128i lookup64_ssse3(__m128i idx, const __m128i* tables) {
+    const __m128i low_nibble = _mm_set1_epi8(0x0F);
+    __m128i lo = _mm_and_si128(idx, low_nibble);
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(idx, 4), low_nibble);
+    
+    __m128i result = _mm_setzero_si128();
+    for (int t = 0; t < 4; ++t) {
+        __m128i select = _mm_cmpeq_epi8(hi, _mm_set1_epi8(static_cast<char>(t)));
+        result = _mm_or_si128(result, _mm_and_si128(_mm_shuffle_epi8(tables[t], lo), select));
+    }
+    return result;
+}
+
+CF_TARGET("avx2")
+static inline __m256i lookup64_avx2(__m256i idx, const __m256i* tables) {
+    const __m256i low_nibble = _mm256_set1_epi8(0x0F);
+    __m256i lo = _mm256_and_si256(idx, low_nibble);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(idx, 4), low_nibble);
+    
+    __m256i result = _mm256_setzero_si256();
+    for (int t = 0; t < 4; ++t) {
+        __m256i select = _mm256_cmpeq_epi8(hi, _mm256_set1_epi8(static_cast<char>(t)));
+        result = _mm256_or_si256(result, _mm256_and_si256(_mm256_shuffle_epi8(tables[t], lo), select));
+    }
+    return result;
+}
+
+// Append accepted lanes of `symbols` selected by `valid_mask`, in order
+static inline void compact_lanes(const char* symbols, uint64_t valid_mask, char* out, size_t& produced) {
+    while (valid_mask) {
+        out[produced++] = symbols[__builtin_ctzll(valid_mask)];
+        valid_mask &= valid_mask - 1;
+    }
+}
+
+CF_TARGET("ssse3")
+static size_t map_alphabet_ssse3(const uint8_t* in, size_t n, const char* table, size_t k,
+                                 char* out, size_t out_capacity, size_t& consumed) {
+    __m128i tables[4];
+    for (int t = 0; t < 4; ++t) {
+        tables[t] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(table + t * 16));
+    }
+    const __m128i mask = _mm_set1_epi8(static_cast<char>(index_mask(k)));
+    const __m128i limit = _mm_set1_epi8(static_cast<char>(k));
+    const bool power_of_two = (index_mask(k) + 1) == k;
+    
+    size_t produced = 0;
+    size_t i = 0;
+    for (; i + 16 <= n && produced + 16 <= out_capacity; i += 16) {
+        __m128i idx = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)), mask);
+        __m128i symbols = lookup64_ssse3(idx, tables);
+        
+        if (power_of_two) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + produced), symbols);
+            produced += 16;
+            continue;
+        }
+        
+        uint32_t valid = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(limit, idx)));
+        if (valid == 0xFFFF) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + produced), symbols);
+            produced += 16;
+        } else {
+            alignas(16) char lanes[16];
+            _mm_store_si128(reinterpret_cast<__m128i*>(lanes), symbols);
+            compact_lanes(lanes, valid, out, produced);
+        }
+    }
+    
+    size_t tail_consumed;
+    produced += map_alphabet_scalar(in + i, n - i, table, k, out + produced, out_capacity - produced, tail_consumed);
+    consumed = i + tail_consumed;
+    return produced;
+}
+
+CF_TARGET("avx2")
+static size_t map_alphabet_avx2(const uint8_t* in, size_t n, const char* table, size_t k,
+                                char* out, size_t out_capacity, size_t& consumed) {
+    __m256i tables[4];
+    for (int t = 0; t < 4; ++t) {
+        tables[t] = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(table + t * 16)));
+    }
+    const __m256i mask = _mm256_set1_epi8(static_cast<char>(index_mask(k)));
+    const __m256i limit = _mm256_set1_epi8(static_cast<char>(k));
+    const bool power_of_two = (index_mask(k) + 1) == k;
+    
+    size_t produced = 0;
+    size_t i = 0;
+    for (; i + 32 <= n && produced + 32 <= out_capacity; i += 32) {
+        __m256i idx = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i)), mask);
+        __m256i symbols = lookup64_avx2(idx, tables);
+        
+        if (power_of_two) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + produced), symbols);
+            produced += 32;
+            continue;
+        }
+        
+        uint32_t valid = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(limit, idx)));
+        if (valid == 0xFFFFFFFFu) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + produced), symbols);
+            produced += 32;
+        } else {
+            alignas(32) char lanes[32];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), symbols);
+            compact_lanes(lanes, valid, out, produced);
+        }
+    }
+    
+    size_t tail_consumed;
+    produced += map_alphabet_scalar(in + i, n - i, table, k, out + produced, out_capacity - produced, tail_consumed);
+    consumed = i + tail_consumed;
+    return produced;
+}
+
+CF_TARGET("avx512f,avx512bw,avx512vbmi")
+static size_t map_alphabet_avx512vbmi(const uint8_t* in, size_t n, const char* table, size_t k,
+                                      char* out, size_t out_capacity, size_t& consumed) {
+    const __m512i lookup = _mm512_loadu_si512(table);
+    const __m512i mask = _mm512_set1_epi8(static_cast<char>(index_mask(k)));
+    const __m512i limit = _mm512_set1_epi8(static_cast<char>(k));
+    
+    size_t produced = 0;
+    size_t i = 0;
+    for (; i + 64 <= n && produced + 64 <= out_capacity; i += 64) {
+        __m512i idx = _mm512_and_si512(_mm512_loadu_si512(in + i), mask);
+        __m512i symbols = _mm512_permutexvar_epi8(idx, lookup);
+        uint64_t valid = _mm512_cmplt_epu8_mask(idx, limit);
+        
+        if (valid == ~0ULL) {
+            _mm512_storeu_si512(out + produced, symbols);
+            produced += 64;
+        } else {
+            alignas(64) char lanes[64];
+            _mm512_store_si512(lanes, symbols);
+            compact_lanes(lanes, valid, out, produced);
+        }
+    }
+    
+    size_t tail_consumed;
+    produced += map_alphabet_scalar(in + i, n - i, table, k, out + produced, out_capacity - produced, tail_consumed);
+    consumed = i + tail_consumed;
+    return produced;
+}
+
+// Split 12 input bytes into 16 six-bit indices (Mula's pshufb/mulhi method)
+CF_TARGET("ssse3")
+static inline __m128i base64_indices_ssse3(__m128i input) {
+    input = _mm_shuffle_epi8(input, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    __m128i t0 = _mm_and_si128(input, _mm_set1_epi32(0x0fc0fc00));
+    __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    __m128i t2 = _mm_and_si128(input, _mm_set1_epi32(0x003f03f0));
+    __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t1, t3);
+}
+
+CF_TARGET("ssse3")
+static size_t base64_encode_ssse3(const uint8_t* in, size_t n, const char* table, char* out, bool pad) {
+    __m128i tables[4];
+    for (int t = 0; t < 4; ++t) {
+        tables[t] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(table + t * 16));
+    }
+    
+    size_t i = 0;
+    size_t o = 0;
+    for (; i + 16 <= n; i += 12, o += 16) {  // Loads 16 bytes, consumes 12
+        __m128i indices = base64_indices_ssse3(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + o), lookup64_ssse3(indices, tables));
+    }
+    
+    return o + base64_encode_scalar(in + i, n - i, table, out + o, pad);
+}
+
+CF_TARGET("avx2")
+static size_t base64_encode_avx2(const uint8_t* in, size_t n, const char* table, char* out, bool pad) {
+    __m256i tables[4];
+    for (int t = 0; t < 4; ++t) {
+        tables[t] = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(table + t * 16)));
+    }
+    const __m256i shuffle = _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+                                            10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    
+    size_t i = 0;
+    size_t o = 0;
+    for (; i + 28 <= n; i += 24, o += 32) {  // Two 12-byte groups, one per 128-bit lane
+        __m256i input = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 12)), 1);
+        input = _mm256_shuffle_epi8(input, shuffle);
+        __m256i t0 = _mm256_and_si256(input, _mm256_set1_epi32(0x0fc0fc00));
+        __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        __m256i t2 = _mm256_and_si256(input, _mm256_set1_epi32(0x003f03f0));
+        __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        __m256i indices = _mm256_or_si256(t1, t3);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + o), lookup64_avx2(indices, tables));
+    }
+    
+    return o + base64_encode_ssse3(in + i, n - i, table, out + o, pad);
+}
+
+CF_TARGET("avx512f,avx512bw,avx512vbmi")
+static size_t base64_encode_avx512vbmi(const uint8_t* in, size_t n, const char* table, char* out, bool pad) {
+    const __m512i lookup = _mm512_loadu_si512(table);
+    // Gather each 3-byte group into a 32-bit lane as [b1 b0 b2 b1]
+    const __m512i shuffle = _mm512_setr_epi32(
+        0x01020001, 0x04050304, 0x07080607, 0x0a0b090a,
+        0x0d0e0c0d, 0x10110f10, 0x13141213, 0x16171516,
+        0x191a1819, 0x1c1d1b1c, 0x1f201e1f, 0x22232122,
+        0x25262425, 0x28292728, 0x2b2c2a2b, 0x2e2f2d2e);
+    const __m512i shifts = _mm512_set1_epi64(0x3036242a1016040aLL);
+    
+    size_t i = 0;
+    size_t o = 0;
+    for (; i + 64 <= n; i += 48, o += 64) {  // Loads 64 bytes, consumes 48
+        __m512i input = _mm512_permutexvar_epi8(shuffle, _mm512_loadu_si512(in + i));
+        __m512i indices = _mm512_multishift_epi64_epi8(shifts, input);
+        _mm512_storeu_si512(out + o, _mm512_permutexvar_epi8(indices, lookup));
+    }
+    
+    return o + base64_encode_avx2(in + i, n - i, table, out + o, pad);
+}
+
+// Store the hits of one block whose nonzero lanes are flagged in `lanes`
+static inline void store_literal_hits(const uint8_t* buckets, uint32_t lanes, size_t base,
+                                      uint64_t* hits, size_t& count) {
+    while (lanes) {
+        int j = __builtin_ctz(lanes);
+        hits[count++] = (static_cast<uint64_t>(base + j) << 8) | buckets[j];
+        lanes &= lanes - 1;
+    }
+}
+
+CF_TARGET("ssse3")
+static size_t literal_candidates_ssse3(const uint8_t* data, size_t n, size_t& pos, const LiteralMasks& masks,
+                                       uint64_t* hits, size_t capacity) {
+    const __m128i low_nibble = _mm_set1_epi8(0x0F);
+    __m128i lo[2], hi[2];
+    for (int j = 0; j < 2; ++j) {
+        lo[j] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(masks.lo[j]));
+        hi[j] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(masks.hi[j]));
+    }
+    
+    size_t count = 0;
+    size_t i = pos;
+    alignas(16) uint8_t buckets[16];
+    for (; i + 17 <= n && capacity - count >= 16; i += 16) {  // Second byte of lane 15 is data[i + 16]
+        __m128i fingerprint = _mm_set1_epi8(-1);
+        for (int j = 0; j < 2; ++j) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + j));
+            __m128i l = _mm_shuffle_epi8(lo[j], _mm_and_si128(v, low_nibble));
+            __m128i h = _mm_shuffle_epi8(hi[j], _mm_and_si128(_mm_srli_epi16(v, 4), low_nibble));
+            fingerprint = _mm_and_si128(fingerprint, _mm_and_si128(l, h));
+        }
+        uint32_t lanes = ~_mm_movemask_epi8(_mm_cmpeq_epi8(fingerprint, _mm_setzero_si128())) & 0xFFFF;
+        if (lanes) {
+            _mm_store_si128(reinterpret_cast<__m128i*>(buckets), fingerprint);
+            store_literal_hits(buckets, lanes, i, hits, count);
+        }
+    }
+    
+    pos = i;
+    return count + literal_candidates_scalar(data, n, pos, masks, hits + count, capacity - count);
+}
+
+CF_TARGET("avx2")
+static size_t literal_candidates_avx2(const uint8_t* data, size_t n, size_t& pos, const LiteralMasks& masks,
+                                      uint64_t* hits, size_t capacity) {
+    const __m256i low_nibble = _mm256_set1_epi8(0x0F);
+    __m256i lo[2], hi[2];
+    for (int j = 0; j < 2; ++j) {
+        lo[j] = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(masks.lo[j])));
+        hi[j] = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(masks.hi[j])));
+    }
+    
+    size_t count = 0;
+    size_t i = pos;
+    alignas(32) uint8_t buckets[32];
+    for (; i + 33 <= n && capacity - count >= 32; i += 32) {
+        __m256i fingerprint = _mm256_set1_epi8(-1);
+        for (int j = 0; j < 2; ++j) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + j));
+            __m256i l = _mm256_shuffle_epi8(lo[j], _mm256_and_si256(v, low_nibble));
+            __m256i h = _mm256_shuffle_epi8(hi[j], _mm256_and_si256(_mm256_srli_epi16(v, 4), low_nibble));
+            fingerprint = _mm256_and_si256(fingerprint, _mm256_and_si256(l, h));
+        }
+        uint32_t lanes = ~static_cast<uint32_t>(_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(fingerprint, _mm256_setzero_si256())));
+        if (lanes) {
+            _mm256_store_si256(reinterpret_cast<__m256i*>(buckets), fingerprint);
+            store_literal_hits(buckets, lanes, i, hits, count);
+        }
+    }
+    
+    pos = i;
+    return count + literal_candidates_ssse3(data, n, pos, masks, hits + count, capacity - count);
+}
+
+#endif  // CF_SIMD_X86
+
+size_t map_alphabet(const uint8_t* in, size_t n, const char* table, size_t k,
+                    char* out, size_t out_capacity) {
+    if (k == 0 || k > 64) {
+        return 0;
+    }
+    
+    size_t consumed;
+#if CF_SIMD_X86
+    switch (active_level()) {
+        case Level::AVX512VBMI:
+            return map_alphabet_avx512vbmi(in, n, table, k, out, out_capacity, consumed);
+        case Level::AVX2:
+            return map_alphabet_avx2(in, n, table, k, out, out_capacity, consumed);
+        case Level::SSSE3:
+            return map_alphabet_ssse3(in, n, table, k, out, out_capacity, consumed);
+        default:
+            break;
+    }
+#endif
+    return map_alphabet_scalar(in, n, table, k, out, out_capacity, consumed);
+}
+
+size_t base64_encode(const uint8_t* in, size_t n, const char* table, char* out, bool pad) {
+#if CF_SIMD_X86
+    switch (active_level()) {
+        case Level::AVX512VBMI:
+            return base64_encode_avx512vbmi(in, n, table, out, pad);
+        case Level::AVX2:
+            return base64_encode_avx2(in, n, table, out, pad);
+        case Level::SSSE3:
+            return base64_encode_ssse3(in, n, table, out, pad);
+        default:
+            break;
+    }
+#endif
+    return base64_encode_scalar(in, n, table, out, pad);
+}
+
+size_t literal_candidates(const uint8_t* data, size_t n, size_t& pos, const LiteralMasks& masks,
+                          uint64_t* hits, size_t capacity) {
+#if CF_SIMD_X86
+    switch (active_level()) {
+        case Level::AVX512VBMI:
+        case Level::AVX2:
+            return literal_candidates_avx2(data, n, pos, masks, hits, capacity);
+        case Level::SSSE3:
+            return literal_candidates_ssse3(data, n, pos, masks, hits, capacity);
+        default:
+            break;
+    }
+#endif
+    return literal_candidates_scalar(data, n, pos, masks, hits, capacity);
+}
+
+}  // namespace simd_kernels
+
+// CPU topology from sysfs (see cpu_topology.h)
+namespace cpu_topology {
+
+#ifdef __linux__
+static bool read_sysfs(const std::string& path, std::string& value) {
+    std::ifstream file(path);
+    return static_cast<bool>(std::getline(file, value));
+}
+
+static int read_sysfs_int(const std::string& path, int fallback) {
+    std::string value;
+    if (!read_sysfs(path, value)) {
+        return fallback;
+    }
+    char* end = nullptr;
+    long parsed = std::strtol(value.c_str(), &end, 10);
+    return end != value.c_str() ? static_cast<int>(parsed) : fallback;
+}
+
+// Parse a cpulist such as "0-3,8,10-11"
+static std::vector<int> parse_cpu_list(const std::string& list) {
+    std::vector<int> cpus;
+    const char* p = list.c_str();
+    while (*p) {
+        char* end = nullptr;
+        long first = std::strtol(p, &end, 10);
+        if (end == p) {
+            break;
+        }
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            last = std::strtol(p + 1, &end, 10);
+            p = end;
+        }
+        for (long cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+        if (*p == ',') {
+            ++p;
+        } else {
+            break;
+        }
+    }
+    return cpus;
+}
+
+// Cache sizes in sysfs read like "48K" or "32768K"
+static size_t parse_cache_size(const std::string& text) {
+    char* end = nullptr;
+    size_t size = std::strtoull(text.c_str(), &end, 10);
+    if (*end == 'K') {
+        size <<= 10;
+    } else if (*end == 'M') {
+        size <<= 20;
+    }
+    return size;
+}
+
+static void read_cache_sizes(int cpu, Topology& topology) {
+    std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/cache/index";
+    for (int index = 0; index < 8; ++index) {
+        std::string prefix = base + std::to_string(index) + "/";
+        std::string type;
+        std::string size;
+        if (!read_sysfs(prefix + "type", type) || !read_sysfs(prefix + "size", size)) {
+            break;
+        }
+        int level = read_sysfs_int(prefix + "level", 0);
+        if (level == 1 && type == "Data") {
+            topology.l1d_cache_size = parse_cache_size(size);
+            topology.cache_line_size = read_sysfs_int(prefix + "coherency_line_size", 64);
+        } else if (level == 2 && type != "Instruction") {
+            topology.l2_cache_size = parse_cache_size(size);
+        } else if (level == 3) {
+            topology.l3_cache_size = parse_cache_size(size);
+        }
+    }
+}
+
+static void detect_linux(Topology& topology) {
+    std::string text;
+    if (!read_sysfs("/sys/devices/system/cpu/online", text)) {
+        return;
+    }
+    std::vector<int> online = parse_cpu_list(text);
+    
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    bool have_mask = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+    
+    // NUMA node of each CPU
+    std::map<int, int> cpu_node;
+    if (DIR* dir = opendir("/sys/devices/system/node")) {
+        while (dirent* entry = readdir(dir)) {
+            int node;
+            if (std::sscanf(entry->d_name, "node%d", &node) == 1 &&
+                read_sysfs(std::string("/sys/devices/system/node/") + entry->d_name + "/cpulist", text)) {
+                for (int cpu : parse_cpu_list(text)) {
+                    cpu_node[cpu] = node;
+                }
+            }
+        }
+        closedir(dir);
+    }
+    
+    // E-cores: Intel hybrid parts list them under cpu_atom; elsewhere
+    // (big.LITTLE) they report a lower cpu_capacity than the big cores
+    std::set<int> efficiency;
+    if (read_sysfs("/sys/devices/cpu_atom/cpus", text)) {
+        for (int cpu : parse_cpu_list(text)) {
+            efficiency.insert(cpu);
+        }
+    } else {
+        std::map<int, int> capacity;
+        int max_capacity = 0;
+        for (int cpu : online) {
+            int value = read_sysfs_int("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/cpu_capacity", 0);
+            capacity[cpu] = value;
+            max_capacity = std::max(max_capacity, value);
+        }
+        for (const auto& entry : capacity) {
+            if (entry.second > 0 && entry.second < max_capacity) {
+                efficiency.insert(entry.first);
+            }
+        }
+    }
+    
+    std::map<std::pair<int, int>, int> core_index;
+    for (int cpu : online) {
+        if (have_mask && (cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowed))) {
+            continue;
+        }
+        std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+        int package = std::max(0, read_sysfs_int(base + "physical_package_id", 0));
+        int core_id = read_sysfs_int(base + "core_id", cpu);
+        auto key = std::make_pair(package, core_id);
+        auto found = core_index.find(key);
+        int core = found != core_index.end() ? found->second : static_cast<int>(core_index.size());
+        core_index.emplace(key, core);
+        
+        auto node = cpu_node.find(cpu);
+        topology.cpus.push_back({cpu, core, package, node != cpu_node.end() ? node->second : 0,
+                                 efficiency.count(cpu) > 0});
+    }
+    
+    // Report the caches a performance core sees
+    for (const LogicalCpu& cpu : topology.cpus) {
+        if (!cpu.efficiency) {
+            read_cache_sizes(cpu.id, topology);
+            break;
+        }
+    }
+}
+#endif
+
+static Topology detect() {
+    Topology topology;
+#ifdef __linux__
+    detect_linux(topology);
+#endif
+    if (topology.cpus.empty()) {
+        int count = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        for (int cpu = 0; cpu < count; ++cpu) {
+            topology.cpus.push_back({cpu, cpu, 0, 0, false});
+        }
+    }
+#ifdef _SC_LEVEL1_DCACHE_SIZE
+    if (topology.l1d_cache_size == 0) {
+        topology.l1d_cache_size = static_cast<size_t>(std::max(0L, sysconf(_SC_LEVEL1_DCACHE_SIZE)));
+        topology.l2_cache_size = static_cast<size_t>(std::max(0L, sysconf(_SC_LEVEL2_CACHE_SIZE)));
+        topology.l3_cache_size = static_cast<size_t>(std::max(0L, sysconf(_SC_LEVEL3_CACHE_SIZE)));
+        long line = sysconf(_SC_LEVEL1_DCACHE_LINESIZE);
+        if (line > 0) {
+            topology.cache_line_size = static_cast<size_t>(line);
+        }
+    }
+#endif
+    
+    std::set<int> packages;
+    std::map<int, bool> cores;  // core -> is an E-core
+    for (const LogicalCpu& cpu : topology.cpus) {
+        packages.insert(cpu.package);
+        cores[cpu.core] = cpu.efficiency;
+        if (static_cast<size_t>(cpu.node) >= topology.node_cpus.size()) {
+            topology.node_cpus.resize(cpu.node + 1);
+        }
+        topology.node_cpus[cpu.node].push_back(cpu.id);
+    }
+    
+    topology.logical_cores = static_cast<int>(topology.cpus.size());
+    topology.physical_cores = static_cast<int>(cores.size());
+    for (const auto& core : cores) {
+        (core.second ? topology.efficiency_cores : topology.performance_cores)++;
+    }
+    topology.packages = static_cast<int>(packages.size());
+    for (const auto& cpus : topology.node_cpus) {
+        topology.numa_nodes += cpus.empty() ? 0 : 1;
+    }
+    return topology;
+}
+
+const Topology& get() {
+    static const Topology topology = detect();
+    return topology;
+}
+
+std::vector<int> placement(int n, int node) {
+    const Topology& topology = get();
+    if (n <= 0) {
+        return {};
+    }
+    
+    // Rank each CPU among its core's siblings, so rank 0 is one CPU per core
+    std::map<int, int> sibling_count;
+    std::vector<int> rank(topology.cpus.size());
+    int max_rank = 0;
+    for (size_t i = 0; i < topology.cpus.size(); ++i) {
+        rank[i] = sibling_count[topology.cpus[i].core]++;
+        max_rank = std::max(max_rank, rank[i]);
+    }
+    
+    // Fill rank by rank and performance cores before E-cores, taking CPUs
+    // from the nodes in turn
+    std::vector<int> order;
+    for (int r = 0; r <= max_rank; ++r) {
+        for (int efficiency = 0; efficiency < 2; ++efficiency) {
+            std::vector<std::vector<int>> per_node(topology.node_cpus.size());
+            for (size_t i = 0; i < topology.cpus.size(); ++i) {
+                const LogicalCpu& cpu = topology.cpus[i];
+                if (rank[i] == r && cpu.efficiency == (efficiency == 1) && (node < 0 || cpu.node == node)) {
+                    per_node[cpu.node].push_back(cpu.id);
+                }
+            }
+            for (size_t k = 0;; ++k) {
+                bool any = false;
+                for (const auto& cpus : per_node) {
+                    if (k < cpus.size()) {
+                        order.push_back(cpus[k]);
+                        any = true;
+                    }
+                }
+                if (!any) {
+                    break;
+                }
+            }
+        }
+    }
+    if (order.empty()) {
+        return {};
+    }
+    
+    // More threads than CPUs share them round-robin
+    std::vector<int> cpus(static_cast<size_t>(n));
+    for (int i = 0; i < n; ++i) {
+        cpus[i] = order[static_cast<size_t>(i) % order.size()];
+    }
+    return cpus;
+}
+
+int recommended_threads(int node) {
+    const Topology& topology = get();
+    std::set<int> performance;
+    std::set<int> all;
+    for (const LogicalCpu& cpu : topology.cpus) {
+        if (node >= 0 && cpu.node != node) {
+            continue;
+        }
+        all.insert(cpu.core);
+        if (!cpu.efficiency) {
+            performance.insert(cpu.core);
+        }
+    }
+    return std::max<int>(1, static_cast<int>(performance.empty() ? all.size() : performance.size()));
+}
+
+#ifdef __linux__
+static bool pin_to(const std::vector<int>& cpus) {
+    if (cpus.empty()) {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+#else
+static bool pin_to(const std::vector<int>&) {
+    return false;
+}
+#endif
+
+bool pin_current_thread(int cpu) {
+    return pin_to({cpu});
+}
+
+bool pin_current_thread_to_node(int node) {
+    const Topology& topology = get();
+    if (node < 0 || static_cast<size_t>(node) >= topology.node_cpus.size()) {
+        return false;
+    }
+    return pin_to(topology.node_cpus[node]);
+}
+
+bool unpin_current_thread() {
+    std::vector<int> cpus;
+    for (const LogicalCpu& cpu : get().cpus) {
+        cpus.push_back(cpu.id);
+    }
+    return pin_to(cpus);
+}
+
+}  // namespace cpu_topology
+
 class CPUOptimizer {
 private:
     int num_cores;
@@ -21,6 +873,8 @@ private:
     bool has_avx2;
     bool has_fma;
     bool has_sse4_2;
+    bool has_ssse3;
+    bool has_avx512vbmi;
     
     // Performance monitoring
     std::atomic<uint64_t> total_operations{0};
@@ -29,33 +883,34 @@ private:
 public:
     CPUOptimizer() {
         detect_cpu_features();
-        num_cores = std::thread::hardware_concurrency();
-        cache_line_size = 64;  // Typical cache line size
+        const cpu_topology::Topology& topology = cpu_topology::get();
+        num_cores = topology.logical_cores;
+        cache_line_size = static_cast<int>(topology.cache_line_size);
         
         std::cout << "CPU Optimizer initialized:" << std::endl;
-        std::cout << "  Cores: " << num_cores << std::endl;
+        std::cout << "  Cores: " << topology.physical_cores << " physical, " << num_cores << " logical" << std::endl;
+        if (topology.efficiency_cores > 0) {
+            std::cout << "  Hybrid: " << topology.performance_cores << " P-cores, "
+                      << topology.efficiency_cores << " E-cores" << std::endl;
+        }
+        std::cout << "  Sockets: " << topology.packages << ", NUMA nodes: " << topology.numa_nodes << std::endl;
         std::cout << "  AVX: " << (has_avx ? "Yes" : "No") << std::endl;
         std::cout << "  AVX2: " << (has_avx2 ? "Yes" : "No") << std::endl;
         std::cout << "  FMA: " << (has_fma ? "Yes" : "No") << std::endl;
         std::cout << "  SSE4.2: " << (has_sse4_2 ? "Yes" : "No") << std::endl;
+        std::cout << "  Alphabet kernels: " << simd_kernels::level_name(simd_kernels::detected_level()) << std::endl;
     }
     
-    // Optimized string processing using SIMD
-    std::vector<std::string> process_strings_simd(const std::vector<std::string>& input) {
-        std::vector<std::string> result;
-        result.reserve(input.size());
-        
-        for (const auto& str : input) {
-            if (has_avx2 && str.length() >= 32) {
-                result.push_back(process_string_avx2(str));
-            } else if (has_sse4_2 && str.length() >= 16) {
-                result.push_back(process_string_sse4_2(str));
-            } else {
-                result.push_back(process_string_scalar(str));
-            }
+    // ASCII-uppercase `len` bytes from `in` to `out` (which may be `in`).
+    // Other bytes, UTF-8 continuation bytes included, pass through unchanged.
+    void process_bytes(const char* in, char* out, size_t len) {
+        size_t done = 0;
+        if (has_avx2 && len >= 32) {
+            done = process_bytes_avx2(in, out, len);
+        } else if (has_sse4_2 && len >= 16) {
+            done = process_bytes_sse4_2(in, out, len);
         }
-        
-        return result;
+        process_bytes_scalar(in + done, out + done, len - done);
     }
     
     // Optimized parallel processing
@@ -131,13 +986,17 @@ public:
         }
     }
     
-    // Performance monitoring
-    void start_timer() {
+    // Performance monitoring: one operation per process_strings/process_buffer
+    // call, timed on the tracing clock and recorded as a span when enabled
+    uint64_t start_timer() {
         total_operations++;
+        return tracing::now_ns();
     }
     
-    void end_timer(uint64_t time_ns) {
-        total_time_ns += time_ns;
+    void end_timer(uint64_t start_ns, const char* span_name, size_t bytes) {
+        uint64_t end_ns = tracing::now_ns();
+        total_time_ns += end_ns - start_ns;
+        tracing::record(tracing::CPU, span_name, start_ns, end_ns, static_cast<int64_t>(bytes));
     }
     
     double get_average_time_ns() const {
@@ -156,93 +1015,119 @@ public:
         has_avx2 = __builtin_cpu_supports("avx2");
         has_fma = __builtin_cpu_supports("fma");
         has_sse4_2 = __builtin_cpu_supports("sse4.2");
+        has_ssse3 = __builtin_cpu_supports("ssse3");
+        has_avx512vbmi = __builtin_cpu_supports("avx512vbmi");
     }
     
 private:
-    std::string process_string_avx2(const std::string& input) {
-        // AVX2-optimized string processing
-        std::string result = input;
-        
-        // Simple example: convert to uppercase using AVX2
-        if (input.length() >= 32) {
-            char* data = result.data();
-            size_t len = result.length();
-            
-            // Process 32-byte chunks with AVX2
-            for (size_t i = 0; i < len; i += 32) {
-                size_t chunk_size = std::min(size_t(32), len - i);
-                
-                // Load 32 bytes
-                __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
-                
-                // Convert to uppercase (simplified)
-                __m256i mask = _mm256_set1_epi8(0x20);
-                __m256i upper = _mm256_and_si256(chunk, _mm256_set1_epi8(0xDF));
-                
-                // Store result
-                _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + i), upper);
-            }
+    // The vector kernels handle whole blocks and return how many bytes they
+    // did; the scalar loop finishes the tail, so nothing past `len` is touched
+#if CF_SIMD_X86
+    CF_TARGET("avx2")
+    size_t process_bytes_avx2(const char* in, char* out, size_t len) {
+        // 'a'..'z' shifted to the bottom of the signed range, so one compare finds them
+        const __m256i shift = _mm256_set1_epi8(static_cast<char>(0x80 - 'a'));
+        const __m256i bound = _mm256_set1_epi8(static_cast<char>(-128 + 26));
+        const __m256i flip = _mm256_set1_epi8(0x20);
+        size_t i = 0;
+        for (; i + 32 <= len; i += 32) {
+            __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+            __m256i lower = _mm256_cmpgt_epi8(bound, _mm256_add_epi8(chunk, shift));
+            chunk = _mm256_sub_epi8(chunk, _mm256_and_si256(lower, flip));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), chunk);
         }
-        
-        return result;
+        return i;
     }
     
-    std::string process_string_sse4_2(const std::string& input) {
-        // SSE4.2-optimized string processing
-        std::string result = input;
-        
-        if (input.length() >= 16) {
-            char* data = result.data();
-            size_t len = result.length();
-            
-            // Process 16-byte chunks with SSE4.2
-            for (size_t i = 0; i < len; i += 16) {
-                size_t chunk_size = std::min(size_t(16), len - i);
-                
-                // Load 16 bytes
-                __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
-                
-                // Simple processing (convert to uppercase)
-                __m128i upper = _mm_and_si128(chunk, _mm_set1_epi8(0xDF));
-                
-                // Store result
-                _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), upper);
-            }
+    CF_TARGET("sse4.2")
+    size_t process_bytes_sse4_2(const char* in, char* out, size_t len) {
+        const __m128i shift = _mm_set1_epi8(static_cast<char>(0x80 - 'a'));
+        const __m128i bound = _mm_set1_epi8(static_cast<char>(-128 + 26));
+        const __m128i flip = _mm_set1_epi8(0x20);
+        size_t i = 0;
+        for (; i + 16 <= len; i += 16) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+            __m128i lower = _mm_cmpgt_epi8(bound, _mm_add_epi8(chunk, shift));
+            chunk = _mm_sub_epi8(chunk, _mm_and_si128(lower, flip));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), chunk);
         }
-        
-        return result;
+        return i;
+    }
+#else
+    size_t process_bytes_avx2(const char* in, char* out, size_t len) {
+        return 0;
     }
     
-    std::string process_string_scalar(const std::string& input) {
-        // Scalar fallback
-        std::string result = input;
-        std::transform(result.begin(), result.end(), result.begin(), ::toupper);
-        return result;
+    size_t process_bytes_sse4_2(const char* in, char* out, size_t len) {
+        return 0;
+    }
+#endif
+    
+    static void process_bytes_scalar(const char* in, char* out, size_t len) {
+        for (size_t i = 0; i < len; ++i) {
+            char c = in[i];
+            out[i] = (c >= 'a' && c <= 'z') ? static_cast<char>(c - 0x20) : c;
+        }
     }
 };
 
-// Global instance
+// Global instance; created once and never replaced, so the pointer stays
+// valid once observed. The mutex only orders creation against readers.
 static std::unique_ptr<CPUOptimizer> g_cpu_optimizer = nullptr;
+static std::mutex g_cpu_optimizer_mutex;
+
+static CPUOptimizer* get_cpu_optimizer() {
+    std::lock_guard<std::mutex> lock(g_cpu_optimizer_mutex);
+    return g_cpu_optimizer.get();
+}
 
 // Python C API functions
 static PyObject* init_cpu_optimizer(PyObject* self, PyObject* args) {
-    if (g_cpu_optimizer) {
-        return PyBool_FromLong(1);
+    std::lock_guard<std::mutex> lock(g_cpu_optimizer_mutex);
+    if (!g_cpu_optimizer) {
+        g_cpu_optimizer = std::make_unique<CPUOptimizer>();
     }
-    
-    g_cpu_optimizer = std::make_unique<CPUOptimizer>();
     return PyBool_FromLong(1);
 }
 
 static PyObject* get_cpu_info(PyObject* self, PyObject* args) {
-    if (!g_cpu_optimizer) {
+    if (!get_cpu_optimizer()) {
         PyErr_SetString(PyExc_RuntimeError, "CPU optimizer not initialized");
         return nullptr;
     }
     
-    PyObject* info = PyDict_New();
-    PyDict_SetItemString(info, "cores", PyLong_FromLong(std::thread::hardware_concurrency()));
-    PyDict_SetItemString(info, "cache_line_size", PyLong_FromLong(64));
+    const cpu_topology::Topology& topology = cpu_topology::get();
+    PyObject* node_cpus = PyList_New(0);
+    for (const std::vector<int>& cpus : topology.node_cpus) {
+        PyObject* list = PyList_New(static_cast<Py_ssize_t>(cpus.size()));
+        for (size_t i = 0; i < cpus.size(); ++i) {
+            PyList_SET_ITEM(list, static_cast<Py_ssize_t>(i), PyLong_FromLong(cpus[i]));
+        }
+        PyList_Append(node_cpus, list);
+        Py_DECREF(list);
+    }
+    
+    PyObject* info = Py_BuildValue("{s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:n,s:n,s:n,s:n,s:i,s:N}",
+                                   "cores", topology.logical_cores,
+                                   "logical_cores", topology.logical_cores,
+                                   "physical_cores", topology.physical_cores,
+                                   "performance_cores", topology.performance_cores,
+                                   "efficiency_cores", topology.efficiency_cores,
+                                   "packages", topology.packages,
+                                   "numa_nodes", topology.numa_nodes,
+                                   "cache_line_size", static_cast<Py_ssize_t>(topology.cache_line_size),
+                                   "l1d_cache_size", static_cast<Py_ssize_t>(topology.l1d_cache_size),
+                                   "l2_cache_size", static_cast<Py_ssize_t>(topology.l2_cache_size),
+                                   "l3_cache_size", static_cast<Py_ssize_t>(topology.l3_cache_size),
+                                   "recommended_threads", cpu_topology::recommended_threads(),
+                                   "numa_node_cpus", node_cpus);
+    if (!info) {
+        return nullptr;
+    }
+    PyDict_SetItemString(info, "simd_kernel_level",
+                         PyUnicode_FromString(simd_kernels::level_name(simd_kernels::active_level())));
+    PyDict_SetItemString(info, "simd_kernel_max_level",
+                         PyUnicode_FromString(simd_kernels::level_name(simd_kernels::detected_level())));
     
     return info;
 }
@@ -254,72 +1139,223 @@ static PyObject* process_strings_optimized(PyObject* self, PyObject* args) {
         return nullptr;
     }
     
-    if (!PyList_Check(string_list)) {
-        PyErr_SetString(PyExc_TypeError, "Expected list of strings");
+    CPUOptimizer* optimizer = get_cpu_optimizer();
+    if (!optimizer) {
+        PyErr_SetString(PyExc_RuntimeError, "CPU optimizer not initialized");
         return nullptr;
     }
     
-    if (!g_cpu_optimizer) {
-        PyErr_SetString(PyExc_RuntimeError, "CPU optimizer not initialized");
+    // The tuple holds the items while the GIL is released, so their cached
+    // UTF-8 is read in place instead of copied into std::strings
+    PyObject* items = PySequence_Tuple(string_list);
+    if (!items) {
         return nullptr;
     }
     
-    // Convert Python list to C++ vector
-    std::vector<std::string> input_strings;
-    Py_ssize_t size = PyList_Size(string_list);
-    
+    Py_ssize_t size = PyTuple_GET_SIZE(items);
+    std::vector<std::pair<const char*, Py_ssize_t>> views(size);
+    std::vector<size_t> offsets(size + 1, 0);
     for (Py_ssize_t i = 0; i < size; ++i) {
-        PyObject* item = PyList_GetItem(string_list, i);
+        PyObject* item = PyTuple_GET_ITEM(items, i);
         if (!PyUnicode_Check(item)) {
+            Py_DECREF(items);
             PyErr_SetString(PyExc_TypeError, "All items must be strings");
             return nullptr;
         }
         
-        const char* str = PyUnicode_AsUTF8(item);
-        input_strings.emplace_back(str);
+        views[i].first = PyUnicode_AsUTF8AndSize(item, &views[i].second);
+        if (!views[i].first) {
+            Py_DECREF(items);
+            return nullptr;
+        }
+        offsets[i + 1] = offsets[i] + static_cast<size_t>(views[i].second);
     }
     
-    // Process strings
-    auto result_strings = g_cpu_optimizer->process_strings_simd(input_strings);
+    // Process into one contiguous buffer; the optimizer only touches atomic counters, so no lock
+    std::string output(offsets[size], '\0');
+    Py_BEGIN_ALLOW_THREADS
+    uint64_t start = optimizer->start_timer();
+    for (Py_ssize_t i = 0; i < size; ++i) {
+        optimizer->process_bytes(views[i].first, &output[offsets[i]], views[i].second);
+    }
+    optimizer->end_timer(start, "cpu.process_strings", output.size());
+    Py_END_ALLOW_THREADS
+    Py_DECREF(items);
     
-    // Convert back to Python list
-    PyObject* result_list = PyList_New(result_strings.size());
-    for (size_t i = 0; i < result_strings.size(); ++i) {
-        PyList_SetItem(result_list, i, PyUnicode_FromString(result_strings[i].c_str()));
+    PyObject* result_list = PyList_New(size);
+    for (Py_ssize_t i = 0; result_list && i < size; ++i) {
+        PyObject* processed = PyUnicode_FromStringAndSize(output.data() + offsets[i], offsets[i + 1] - offsets[i]);
+        if (!processed) {
+            Py_CLEAR(result_list);
+            break;
+        }
+        PyList_SET_ITEM(result_list, i, processed);
     }
     
     return result_list;
 }
 
+// process_strings over any bytes-like object: into a new NativeBuffer, or
+// in place when the buffer is writable and in_place is set
+static PyObject* process_buffer_optimized(PyObject* self, PyObject* args) {
+    PyObject* buffer_obj;
+    int in_place = 0;
+    
+    if (!PyArg_ParseTuple(args, "O|p", &buffer_obj, &in_place)) {
+        return nullptr;
+    }
+    
+    CPUOptimizer* optimizer = get_cpu_optimizer();
+    if (!optimizer) {
+        PyErr_SetString(PyExc_RuntimeError, "CPU optimizer not initialized");
+        return nullptr;
+    }
+    
+    Py_buffer view;
+    if (PyObject_GetBuffer(buffer_obj, &view, in_place ? PyBUF_WRITABLE : PyBUF_SIMPLE) < 0) {
+        return nullptr;
+    }
+    
+    const char* in = static_cast<const char*>(view.buf);
+    size_t len = static_cast<size_t>(view.len);
+    if (in_place) {
+        Py_BEGIN_ALLOW_THREADS
+        uint64_t start = optimizer->start_timer();
+        optimizer->process_bytes(in, static_cast<char*>(view.buf), len);
+        optimizer->end_timer(start, "cpu.process_buffer", len);
+        Py_END_ALLOW_THREADS
+        PyBuffer_Release(&view);
+        Py_RETURN_NONE;
+    }
+    
+    std::string output(len, '\0');
+    Py_BEGIN_ALLOW_THREADS
+    uint64_t start = optimizer->start_timer();
+    optimizer->process_bytes(in, &output[0], len);
+    optimizer->end_timer(start, "cpu.process_buffer", len);
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&view);
+    return native_buffer::from_string(std::move(output));
+}
+
 static PyObject* get_performance_stats(PyObject* self, PyObject* args) {
-    if (!g_cpu_optimizer) {
+    CPUOptimizer* optimizer = get_cpu_optimizer();
+    if (!optimizer) {
         PyErr_SetString(PyExc_RuntimeError, "CPU optimizer not initialized");
         return nullptr;
     }
     
     PyObject* stats = PyDict_New();
-    PyDict_SetItemString(stats, "total_operations", PyLong_FromUnsignedLongLong(g_cpu_optimizer->get_total_operations()));
-    PyDict_SetItemString(stats, "average_time_ns", PyFloat_FromDouble(g_cpu_optimizer->get_average_time_ns()));
+    PyDict_SetItemString(stats, "total_operations", PyLong_FromUnsignedLongLong(optimizer->get_total_operations()));
+    PyDict_SetItemString(stats, "average_time_ns", PyFloat_FromDouble(optimizer->get_average_time_ns()));
     
     return stats;
 }
 
+static PyObject* set_kernel_level(PyObject* self, PyObject* args) {
+    const char* level_name = nullptr;
+    
+    if (!PyArg_ParseTuple(args, "|z", &level_name)) {
+        return nullptr;
+    }
+    
+    if (!level_name) {
+        simd_kernels::clear_level_override();
+        Py_RETURN_NONE;
+    }
+    
+    const simd_kernels::Level levels[] = {
+        simd_kernels::Level::SCALAR, simd_kernels::Level::SSSE3,
+        simd_kernels::Level::AVX2, simd_kernels::Level::AVX512VBMI
+    };
+    for (auto level : levels) {
+        if (std::strcmp(level_name, simd_kernels::level_name(level)) == 0) {
+            simd_kernels::set_level_override(level);
+            return PyUnicode_FromString(simd_kernels::level_name(simd_kernels::active_level()));
+        }
+    }
+    
+    PyErr_SetString(PyExc_ValueError, "Kernel level must be 'scalar', 'ssse3', 'avx2' or 'avx512vbmi'");
+    return nullptr;
+}
+
+static PyObject* get_thread_placement(PyObject* self, PyObject* args) {
+    int n_threads = 0;
+    int node = -1;
+    
+    if (!PyArg_ParseTuple(args, "|ii", &n_threads, &node)) {
+        return nullptr;
+    }
+    
+    if (n_threads <= 0) {
+        n_threads = cpu_topology::recommended_threads(node);
+    }
+    
+    std::vector<int> cpus = cpu_topology::placement(n_threads, node);
+    PyObject* result = PyList_New(static_cast<Py_ssize_t>(cpus.size()));
+    for (size_t i = 0; result && i < cpus.size(); ++i) {
+        PyList_SET_ITEM(result, static_cast<Py_ssize_t>(i), PyLong_FromLong(cpus[i]));
+    }
+    return result;
+}
+
+static PyObject* pin_thread(PyObject* self, PyObject* args) {
+    int cpu = -1;
+    int node = -1;
+    
+    if (!PyArg_ParseTuple(args, "|ii", &cpu, &node)) {
+        return nullptr;
+    }
+    
+    // Neither argument clears the pinning
+    bool pinned;
+    if (cpu >= 0) {
+        pinned = cpu_topology::pin_current_thread(cpu);
+    } else if (node >= 0) {
+        pinned = cpu_topology::pin_current_thread_to_node(node);
+    } else {
+        pinned = cpu_topology::unpin_current_thread();
+    }
+    return PyBool_FromLong(pinned);
+}
+
 static PyMethodDef CPUOptimizerMethods[] = {
     {"init", init_cpu_optimizer, METH_VARARGS, "Initialize CPU optimizer"},
     {"get_cpu_info", get_cpu_info, METH_VARARGS, "Get CPU information"},
     {"process_strings", process_strings_optimized, METH_VARARGS, "Process strings with CPU optimizations"},
+    {"process_buffer", process_buffer_optimized, METH_VARARGS, "Process a bytes-like object: (buffer, in_place=False) -> NativeBuffer, or None in place"},
     {"get_performance_stats", get_performance_stats, METH_VARARGS, "Get performance statistics"},
+    {"set_kernel_level", set_kernel_level, METH_VARARGS, "Cap alphabet-kernel dispatch at a level (None restores auto)"},
+    {"get_thread_placement", get_thread_placement, METH_VARARGS, "CPUs for n threads (default: one per performance core), optionally on one NUMA node"},
+    {"pin_thread", pin_thread, METH_VARARGS, "Pin the calling thread: pin_thread(cpu) or pin_thread(-1, node); no arguments unpins"},
     {nullptr, nullptr, 0, nullptr}
 };
 
+static int cpu_optimizer_exec(PyObject* module) {
+    return native_buffer::init_type() ? 0 : -1;
+}
+
+// No per-module state: the optimizer and kernel dispatch are process-wide
+static PyModuleDef_Slot CPUOptimizerSlots[] = {
+    {Py_mod_exec, reinterpret_cast<void*>(cpu_optimizer_exec)},
+#if PY_VERSION_HEX >= 0x030C0000
+    {Py_mod_multiple_interpreters, Py_MOD_MULTIPLE_INTERPRETERS_SUPPORTED},
+#endif
+#if PY_VERSION_HEX >= 0x030D0000
+    {Py_mod_gil, Py_MOD_GIL_NOT_USED},
+#endif
+    {0, nullptr}
+};
+
 static struct PyModuleDef cpuoptimizermodule = {
     PyModuleDef_HEAD_INIT,
     "cpu_optimizer",
     "CPU optimization utilities",
-    -1,
-    CPUOptimizerMethods
+    0,
+    CPUOptimizerMethods,
+    CPUOptimizerSlots
 };
 
 PyMODINIT_FUNC PyInit_cpu_optimizer(void) {
-    return PyModule_Create(&cpuoptimizermodule);
+    return PyModuleDef_Init(&cpuoptimizermodule);
 }
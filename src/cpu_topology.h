@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// CPU topology detection and thread pinning, implemented in cpu_optimizer.cpp
+// and shared by the executor and the llama interface.
+//
+// On Linux the layout comes from sysfs, restricted to the CPUs this process
+// may run on (taskset, cgroup cpusets). Elsewhere every logical CPU is
+// reported as its own core on a single node and pinning is a no-op.
+namespace cpu_topology {
+
+struct LogicalCpu {
+    int id;            // OS CPU number, as used by affinity masks
+    int core;          // Index of the physical core (SMT siblings share it)
+    int package;       // Socket
+    int node;          // NUMA node
+    bool efficiency;   // E-core on hybrid CPUs
+};
+
+struct Topology {
+    std::vector<LogicalCpu> cpus;            // Usable CPUs, ordered by id
+    std::vector<std::vector<int>> node_cpus; // Usable CPU ids per NUMA node
+    int logical_cores = 0;
+    int physical_cores = 0;
+    int performance_cores = 0;               // Physical cores that are not E-cores
+    int efficiency_cores = 0;
+    int packages = 0;
+    int numa_nodes = 0;
+    size_t cache_line_size = 64;
+    size_t l1d_cache_size = 0;               // Per core
+    size_t l2_cache_size = 0;                // Per core (or per cluster on E-cores)
+    size_t l3_cache_size = 0;                // Per package
+};
+
+// Detected once on first use
+const Topology& get();
+
+// CPUs for `n` compute threads: one per physical core, performance cores
+// before E-cores, spread round-robin over NUMA nodes (or only `node` when
+// it is >= 0). SMT siblings are used only once every core has a thread.
+std::vector<int> placement(int n, int node = -1);
+
+// Physical performance cores, on `node` or the whole machine; the thread
+// count at which compute-bound work stops scaling
+int recommended_threads(int node = -1);
+
+// Restrict the calling thread to one CPU, or to all CPUs of a NUMA node so
+// that memory it first touches is allocated there. False if unsupported.
+bool pin_current_thread(int cpu);
+bool pin_current_thread_to_node(int node);
+
+// Undo pinning: allow every usable CPU again
+bool unpin_current_thread();
+
+}  // namespace cpu_topology
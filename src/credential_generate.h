@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Credential generation as generate() does it: compiled patterns first,
+// then the built-in generators, on the shared engine and RNG mode.
+// Implemented in credential_utils.cpp for native modules that fill
+// credential slots themselves. Include after Python.h.
+class FingerprintSet;
+
+namespace credential_generate {
+
+// Whether `type` is a compiled pattern or a built-in generator
+bool supported(const std::string& type);
+
+// The `unique` argument generate() takes: None or a FingerprintSet.
+// Call with the GIL held.
+bool unique_set(PyObject* obj, FingerprintSet*& set);
+
+// `rounds` passes over `types`, one credential per entry, into `buffer`;
+// credential i spans offsets[i]..offsets[i + 1]. With `unique`, values are
+// regenerated until the set accepts them. Takes the generator lock once
+// for the whole batch; call without the GIL. On failure `error_type` and
+// `error` describe the Python exception to raise.
+bool generate(const std::vector<std::string>& types, size_t rounds, FingerprintSet* unique,
+              std::string& buffer, std::vector<uint64_t>& offsets,
+              PyObject*& error_type, std::string& error);
+
+}  // namespace credential_generate
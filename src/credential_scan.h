@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// The regex_db.json patterns compile_patterns() compiled and their
+// one-pass scanner (see PatternScanner), implemented in credential_utils.cpp
+// and shared with the corpus scanner.
+class PatternRegistry;
+
+namespace credential_scan {
+
+// (start, end) byte offsets per pattern, in order
+using Matches = std::vector<std::vector<std::pair<size_t, size_t>>>;
+
+// The patterns in use, kept alive while a caller holds them;
+// null before compile_patterns()
+std::shared_ptr<const PatternRegistry> patterns();
+
+size_t count(const PatternRegistry& patterns);
+const std::string& type_name(const PatternRegistry& patterns, size_t index);
+
+// Index of a credential type, or -1
+long find(const PatternRegistry& patterns, const std::string& type);
+
+// False for patterns too large to compile into a DFA
+bool scannable(const PatternRegistry& patterns, size_t index);
+
+// Matches of the selected patterns in data[0, n); an empty `selected`
+// scans for all of them
+void scan(const PatternRegistry& patterns, const uint8_t* data, size_t n,
+          const std::vector<bool>& selected, Matches& matches);
+
+}  // namespace credential_scan
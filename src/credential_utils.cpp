@@ -5,6 +5,38 @@
 #include <chrono>
 #include <sstream>
 #include <iomanip>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <unordered_map>
+#include <unordered_set>
+#include <string_view>
+#include <map>
+#include <bitset>
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "credential_scan.h"
+#include "memory_arena.h"
+#include "simd_kernels.h"
+
 #ifdef OPENSSL_FOUND
 #include <openssl/rand.h>
 #include <openssl/sha.h>
@@ -12,174 +44,3650 @@
 #endif
 
 extern "C" {
+    #define PY_SSIZE_T_CLEAN
     #include <Python.h>
 }
 
-class CredentialUtils {
-private:
-    std::mt19937 rng;
-    
+#include "credential_generate.h"
+#include "credential_views.h"
+#include "native_buffer.h"
+#include "tracing.h"
+
+// Random byte engines. Both produce 64-byte blocks that callers consume
+// through a cursor, so alphabet mapping works on whole blocks instead of
+// drawing one distribution sample per character.
+class RandomEngine {
 public:
-    CredentialUtils() : rng(std::chrono::steady_clock::now().time_since_epoch().count()) {}
+    static constexpr size_t kBlockSize = 64;
     
-    std::string generate_random_string(size_t length, const std::string& charset) {
-        std::uniform_int_distribution<> dist(0, charset.size() - 1);
-        std::string result;
-        result.reserve(length);
+    virtual ~RandomEngine() = default;
+    
+    virtual void reseed(uint64_t seed) = 0;
+    
+    uint8_t next_byte() {
+        if (cursor == kBlockSize) {
+            refill(block);
+            cursor = 0;
+        }
+        return block[cursor++];
+    }
+    
+    // Bulk output: buffered bytes first, then whole blocks straight into `out`
+    void fill(uint8_t* out, size_t n) {
+        size_t take = std::min(n, kBlockSize - cursor);
+        std::memcpy(out, block + cursor, take);
+        cursor += take;
+        out += take;
+        n -= take;
         
-        for (size_t i = 0; i < length; ++i) {
-            result += charset[dist(rng)];
+        for (; n >= kBlockSize; out += kBlockSize, n -= kBlockSize) {
+            refill(out);
+        }
+        
+        if (n > 0) {
+            refill(block);
+            std::memcpy(out, block, n);
+            cursor = n;
         }
-        return result;
     }
     
-    std::string generate_hex_string(size_t length) {
-        const std::string hex_chars = "0123456789abcdef";
-        return generate_random_string(length, hex_chars);
+    uint32_t next_u32() {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) {
+            value = (value << 8) | next_byte();
+        }
+        return value;
     }
     
-    std::string generate_base64_string(size_t length) {
-        const std::string base64_chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-        return generate_random_string(length, base64_chars);
+    // Unbiased integer in [0, range) using Lemire's multiply-and-reject
+    uint32_t uniform(uint32_t range) {
+        uint64_t product = static_cast<uint64_t>(next_u32()) * range;
+        uint32_t low = static_cast<uint32_t>(product);
+        if (low < range) {
+            uint32_t threshold = static_cast<uint32_t>(-range) % range;
+            while (low < threshold) {
+                product = static_cast<uint64_t>(next_u32()) * range;
+                low = static_cast<uint32_t>(product);
+            }
+        }
+        return static_cast<uint32_t>(product >> 32);
     }
     
-    std::string generate_aws_access_key() {
-        return "AKIA" + generate_base64_string(16);
+protected:
+    virtual void refill(uint8_t* out) = 0;
+    
+    // Drop buffered output after reseeding so streams stay reproducible
+    void discard_block() {
+        cursor = kBlockSize;
     }
     
-    std::string generate_aws_secret_key() {
-        return generate_base64_string(40);
+    static uint64_t splitmix64(uint64_t& state) {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
     }
     
-    std::string generate_jwt_token() {
-        // Header
-        std::string header = R"({"alg":"HS256","typ":"JWT"})";
-        
-        // Payload
-        std::string payload = R"({"sub":"user123","iat":)" + 
-                             std::to_string(std::time(nullptr)) + 
-                             R"(,"exp":)" + 
-                             std::to_string(std::time(nullptr) + 3600) + "}";
+private:
+    uint8_t block[kBlockSize];
+    size_t cursor = kBlockSize;
+};
+
+// xoshiro256** for bulk generation: 32 bytes of state, ~1ns per 8 bytes
+class Xoshiro256Engine : public RandomEngine {
+public:
+    explicit Xoshiro256Engine(uint64_t seed) {
+        reseed(seed);
+    }
+    
+    void reseed(uint64_t seed) override {
+        uint64_t sm = seed;
+        for (auto& word : state) {
+            word = splitmix64(sm);
+        }
+        discard_block();
+    }
+    
+protected:
+    void refill(uint8_t* out) override {
+        for (size_t i = 0; i < kBlockSize; i += 8) {
+            uint64_t value = next();
+            std::memcpy(out + i, &value, 8);
+        }
+    }
+    
+private:
+    uint64_t state[4];
+    
+    static uint64_t rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+    
+    uint64_t next() {
+        uint64_t result = rotl(state[1] * 5, 7) * 9;
+        uint64_t t = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotl(state[3], 45);
+        return result;
+    }
+};
+
+// ChaCha20 keystream for "crypto-realistic" output. A user seed expands
+// into the key so corpora stay reproducible; unseeded engines take their
+// key from OpenSSL RAND_bytes when available, else std::random_device.
+class ChaCha20Engine : public RandomEngine {
+public:
+    ChaCha20Engine() {
+        uint8_t key[32];
+#ifdef OPENSSL_FOUND
+        if (RAND_bytes(key, sizeof(key)) != 1) {
+            fill_from_random_device(key, sizeof(key));
+        }
+#else
+        fill_from_random_device(key, sizeof(key));
+#endif
+        set_key(key);
+    }
+    
+    explicit ChaCha20Engine(uint64_t seed) {
+        reseed(seed);
+    }
+    
+    void reseed(uint64_t seed) override {
+        uint8_t key[32];
+        uint64_t sm = seed ^ 0x6A09E667F3BCC908ULL;  // Domain-separate from the fast engine
+        for (size_t i = 0; i < sizeof(key); i += 8) {
+            uint64_t word = splitmix64(sm);
+            std::memcpy(key + i, &word, 8);
+        }
+        set_key(key);
+    }
+    
+protected:
+    void refill(uint8_t* out) override {
+        uint32_t x[16];
+        std::memcpy(x, input, sizeof(x));
         
-        // Encode header and payload
-        std::string encoded_header = base64_encode(header);
-        std::string encoded_payload = base64_encode(payload);
+        for (int round = 0; round < 10; ++round) {
+            quarter_round(x[0], x[4], x[8], x[12]);
+            quarter_round(x[1], x[5], x[9], x[13]);
+            quarter_round(x[2], x[6], x[10], x[14]);
+            quarter_round(x[3], x[7], x[11], x[15]);
+            quarter_round(x[0], x[5], x[10], x[15]);
+            quarter_round(x[1], x[6], x[11], x[12]);
+            quarter_round(x[2], x[7], x[8], x[13]);
+            quarter_round(x[3], x[4], x[9], x[14]);
+        }
         
-        // Create signature (simplified)
-        std::string signature = generate_hex_string(32);
+        for (int i = 0; i < 16; ++i) {
+            uint32_t word = x[i] + input[i];
+            out[i * 4 + 0] = static_cast<uint8_t>(word);
+            out[i * 4 + 1] = static_cast<uint8_t>(word >> 8);
+            out[i * 4 + 2] = static_cast<uint8_t>(word >> 16);
+            out[i * 4 + 3] = static_cast<uint8_t>(word >> 24);
+        }
         
-        return encoded_header + "." + encoded_payload + "." + signature;
+        // 64-bit block counter in words 12-13
+        if (++input[12] == 0) {
+            ++input[13];
+        }
     }
     
-    std::string generate_api_key() {
-        return "sk-" + generate_hex_string(32);
+private:
+    uint32_t input[16];
+    
+    static uint32_t rotl32(uint32_t x, int k) {
+        return (x << k) | (x >> (32 - k));
     }
     
-    std::string generate_database_password() {
-        const std::string charset = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789!@#$%^&*";
-        return generate_random_string(16, charset);
+    static void quarter_round(uint32_t& a, uint32_t& b, uint32_t& c, uint32_t& d) {
+        a += b; d ^= a; d = rotl32(d, 16);
+        c += d; b ^= c; b = rotl32(b, 12);
+        a += b; d ^= a; d = rotl32(d, 8);
+        c += d; b ^= c; b = rotl32(b, 7);
     }
     
-    bool validate_credential_pattern(const std::string& credential, const std::string& pattern) {
-        try {
-            std::regex regex_pattern(pattern);
-            return std::regex_match(credential, regex_pattern);
-        } catch (const std::regex_error& e) {
+    static void fill_from_random_device(uint8_t* out, size_t n) {
+        std::random_device device;
+        for (size_t i = 0; i < n; i += 4) {
+            uint32_t word = device();
+            std::memcpy(out + i, &word, std::min<size_t>(4, n - i));
+        }
+    }
+    
+    void set_key(const uint8_t* key) {
+        static const uint32_t sigma[4] = {0x61707865, 0x3320646e, 0x79622d32, 0x6b206574};  // "expand 32-byte k"
+        std::memcpy(input, sigma, sizeof(sigma));
+        for (int i = 0; i < 8; ++i) {
+            input[4 + i] = static_cast<uint32_t>(key[i * 4]) |
+                           (static_cast<uint32_t>(key[i * 4 + 1]) << 8) |
+                           (static_cast<uint32_t>(key[i * 4 + 2]) << 16) |
+                           (static_cast<uint32_t>(key[i * 4 + 3]) << 24);
+        }
+        input[12] = input[13] = 0;  // Block counter
+        input[14] = input[15] = 0;  // Nonce
+        discard_block();
+    }
+};
+
+// Byte-to-symbol lookup for an alphabet of up to 256 symbols. Alphabets of
+// at most 64 symbols go through the SIMD kernels (masked index, reject
+// >= size); larger ones reject bytes at or above `limit` (the largest
+// multiple of the alphabet size). Both schemes are free of modulo bias.
+struct AlphabetTable {
+    char symbols[256];
+    uint16_t size = 0;
+    uint16_t limit = 0;
+    
+    AlphabetTable() = default;
+    
+    explicit AlphabetTable(const std::string& charset) {
+        size = static_cast<uint16_t>(std::min<size_t>(charset.size(), 256));
+        limit = size ? static_cast<uint16_t>(256 - 256 % size) : 0;
+        for (size_t b = 0; b < 256; ++b) {
+            symbols[b] = size ? charset[b % size] : '\0';
+        }
+    }
+    
+    bool vectorizable() const {
+        return size > 0 && size <= 64;
+    }
+};
+
+enum class RngMode { FAST, CRYPTO };
+
+// Parse an optional per-call mode name; nullptr keeps the default
+static bool parse_rng_mode(const char* name, RngMode fallback, RngMode& mode) {
+    if (!name) {
+        mode = fallback;
+        return true;
+    }
+    std::string value(name);
+    if (value == "fast" || value == "bulk") {
+        mode = RngMode::FAST;
+    } else if (value == "crypto") {
+        mode = RngMode::CRYPTO;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Compiled generator program for a regex_db.json pattern.
+// Each node emits a literal, a draw from a character class, or one of
+// several alternative sub-programs, repeated between min and max times.
+// The same program drives validation (see PatternDfa), which matches
+// CHARSET nodes against `accepts` rather than the printable alphabet.
+struct PatternNode {
+    enum Kind { LITERAL, CHARSET, GROUP };
+    
+    Kind kind = LITERAL;
+    std::string text;                                    // Literal bytes or class alphabet
+    std::bitset<256> accepts;                            // Bytes a CHARSET matches
+    AlphabetTable table;                                 // Precomputed mapping for CHARSET
+    std::vector<std::vector<PatternNode>> alternatives;  // Group branches
+    int min_repeat = 1;
+    int max_repeat = 1;
+    bool unbounded = false;                              // +, * or {n,}: max_repeat only bounds generation
+};
+
+// Parses the regex subset used by the credential database into a
+// PatternNode program: literals, escapes, [...] classes (ranges, negation),
+// (a|b) groups, '.', and the ?, *, +, {n}, {n,}, {n,m} quantifiers.
+class PatternCompiler {
+public:
+    // Extra repetitions drawn for open-ended quantifiers (+, *, {n,})
+    static constexpr int kOpenRepeatExtent = 32;
+    
+    static bool compile(const std::string& regex, std::vector<PatternNode>& program, std::string& error) {
+        PatternCompiler compiler(regex);
+        program.clear();
+        
+        if (compiler.peek() == '^') {
+            compiler.pos++;
+        }
+        
+        // Top-level alternation becomes a single group node
+        PatternNode root;
+        root.kind = PatternNode::GROUP;
+        if (!compiler.parse_alternatives(root, false)) {
+            error = compiler.error + " at offset " + std::to_string(compiler.pos);
             return false;
         }
+        
+        if (root.alternatives.size() == 1) {
+            program = std::move(root.alternatives[0]);
+        } else {
+            program.push_back(std::move(root));
+        }
+        return true;
     }
     
 private:
-    std::string base64_encode(const std::string& input) {
-        const std::string chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-        std::string result;
-        int val = 0, valb = -6;
+    const std::string& src;
+    size_t pos;
+    std::string error;
+    
+    explicit PatternCompiler(const std::string& regex) : src(regex), pos(0) {}
+    
+    char peek() const {
+        return pos < src.size() ? src[pos] : '\0';
+    }
+    
+    bool at_end() const {
+        return pos >= src.size();
+    }
+    
+    bool fail(const std::string& message) {
+        error = message;
+        return false;
+    }
+    
+    // Parses '|'-separated branches up to the closing ')' (or end of input)
+    bool parse_alternatives(PatternNode& group, bool in_group) {
+        while (true) {
+            std::vector<PatternNode> branch;
+            if (!parse_sequence(branch)) {
+                return false;
+            }
+            group.alternatives.push_back(std::move(branch));
+            
+            if (at_end()) {
+                return in_group ? fail("Missing ')'") : true;
+            }
+            
+            char next = src[pos++];
+            if (next == ')') {
+                return in_group ? true : fail("Unbalanced ')'");
+            }
+            // next == '|': parse another branch
+        }
+    }
+    
+    bool parse_sequence(std::vector<PatternNode>& out) {
+        while (!at_end()) {
+            char c = peek();
+            
+            if (c == '|' || c == ')') {
+                return true;
+            }
+            
+            if (c == '$' && pos + 1 == src.size()) {
+                pos++;
+                continue;
+            }
+            
+            PatternNode node;
+            if (!parse_atom(node) || !parse_quantifier(node)) {
+                return false;
+            }
+            append_node(out, std::move(node));
+        }
+        return true;
+    }
+    
+    // Merge runs of plain literals so generation appends them in one step
+    static void append_node(std::vector<PatternNode>& out, PatternNode&& node) {
+        if (node.kind == PatternNode::CHARSET) {
+            node.table = AlphabetTable(node.text);
+        }
+        
+        bool plain = node.kind == PatternNode::LITERAL && node.min_repeat == 1 && node.max_repeat == 1;
+        if (plain && !out.empty()) {
+            PatternNode& last = out.back();
+            if (last.kind == PatternNode::LITERAL && last.min_repeat == 1 && last.max_repeat == 1) {
+                last.text += node.text;
+                return;
+            }
+        }
+        out.push_back(std::move(node));
+    }
+    
+    bool parse_atom(PatternNode& node) {
+        char c = src[pos++];
         
-        for (unsigned char c : input) {
-            val = (val << 8) + c;
-            valb += 8;
-            while (valb >= 0) {
-                result.push_back(chars[(val >> valb) & 0x3F]);
-                valb -= 6;
+        switch (c) {
+            case '[': {
+                node.kind = PatternNode::CHARSET;
+                return parse_class(node.text, node.accepts);
+            }
+            case '(': {
+                node.kind = PatternNode::GROUP;
+                if (src.compare(pos, 2, "?:") == 0) {
+                    pos += 2;
+                } else if (peek() == '?') {
+                    return fail("Unsupported group extension");
+                }
+                
+                return parse_alternatives(node, true);
             }
+            case '.': {
+                node.kind = PatternNode::CHARSET;
+                node.text = printable_alphabet(std::bitset<256>());
+                node.accepts.set();
+                node.accepts.reset('\n');
+                return true;
+            }
+            case '\\': {
+                std::bitset<256> set;
+                if (!parse_escape(set)) {
+                    return false;
+                }
+                std::string chars = alphabet_from_set(set);
+                if (chars.size() == 1) {
+                    node.kind = PatternNode::LITERAL;
+                } else {
+                    node.kind = PatternNode::CHARSET;
+                    node.accepts = set;
+                }
+                node.text = chars;
+                return true;
+            }
+            case '*': case '+': case '?': case '{':
+                return fail(std::string("Nothing to repeat before '") + c + "'");
+            default:
+                node.kind = PatternNode::LITERAL;
+                node.text = std::string(1, c);
+                return true;
+        }
+    }
+    
+    bool parse_class(std::string& alphabet, std::bitset<256>& accepts) {
+        std::bitset<256> set;
+        bool negate = false;
+        
+        if (peek() == '^') {
+            negate = true;
+            pos++;
         }
         
-        if (valb > -6) {
-            result.push_back(chars[((val << 8) >> (valb + 8)) & 0x3F]);
+        bool first = true;
+        int prev = -1;  // Last single character, candidate start of a range
+        
+        while (!at_end()) {
+            char c = src[pos];
+            
+            if (c == ']' && !first) {
+                pos++;
+                alphabet = negate ? printable_alphabet(set) : alphabet_from_set(set);
+                if (alphabet.empty()) {
+                    return fail("Empty character class");
+                }
+                accepts = negate ? ~set : set;
+                return true;
+            }
+            first = false;
+            
+            // Range: previous single char followed by '-' and a non-']' char
+            if (c == '-' && prev >= 0 && pos + 1 < src.size() && src[pos + 1] != ']') {
+                pos++;
+                int hi;
+                if (src[pos] == '\\') {
+                    pos++;
+                    std::bitset<256> escaped;
+                    if (!parse_escape(escaped) || escaped.count() != 1) {
+                        return fail("Invalid range end");
+                    }
+                    hi = static_cast<int>(alphabet_from_set(escaped)[0]) & 0xFF;
+                } else {
+                    hi = static_cast<unsigned char>(src[pos++]);
+                }
+                if (hi < prev) {
+                    return fail("Invalid character range");
+                }
+                for (int ch = prev; ch <= hi; ++ch) {
+                    set.set(ch);
+                }
+                prev = -1;
+                continue;
+            }
+            
+            pos++;
+            if (c == '\\') {
+                std::bitset<256> escaped;
+                if (!parse_escape(escaped)) {
+                    return false;
+                }
+                set |= escaped;
+                prev = escaped.count() == 1 ? static_cast<unsigned char>(alphabet_from_set(escaped)[0]) : -1;
+            } else {
+                set.set(static_cast<unsigned char>(c));
+                prev = static_cast<unsigned char>(c);
+            }
         }
         
-        while (result.size() % 4) {
-            result.push_back('=');
+        return fail("Missing ']'");
+    }
+    
+    bool parse_escape(std::bitset<256>& set) {
+        if (at_end()) {
+            return fail("Trailing backslash");
         }
         
-        return result;
+        char c = src[pos++];
+        switch (c) {
+            case 'd':
+                for (int ch = '0'; ch <= '9'; ++ch) set.set(ch);
+                break;
+            case 'w':
+                for (int ch = '0'; ch <= '9'; ++ch) set.set(ch);
+                for (int ch = 'A'; ch <= 'Z'; ++ch) set.set(ch);
+                for (int ch = 'a'; ch <= 'z'; ++ch) set.set(ch);
+                set.set('_');
+                break;
+            case 's':
+                set.set(' ');
+                set.set('\t');
+                set.set('\n');
+                break;
+            case 'n': set.set('\n'); break;
+            case 't': set.set('\t'); break;
+            case 'r': set.set('\r'); break;
+            case 'x': {
+                if (pos + 2 > src.size()) {
+                    return fail("Truncated \\x escape");
+                }
+                if (!std::isxdigit(static_cast<unsigned char>(src[pos])) ||
+                    !std::isxdigit(static_cast<unsigned char>(src[pos + 1]))) {
+                    return fail("Invalid \\x escape");
+                }
+                set.set(std::stoi(src.substr(pos, 2), nullptr, 16) & 0xFF);
+                pos += 2;
+                break;
+            }
+            default:
+                if (std::isalnum(static_cast<unsigned char>(c))) {
+                    return fail(std::string("Unsupported escape \\") + c);
+                }
+                set.set(static_cast<unsigned char>(c));
+                break;
+        }
+        return true;
+    }
+    
+    bool parse_quantifier(PatternNode& node) {
+        char c = peek();
+        
+        if (c == '?') {
+            node.min_repeat = 0;
+            node.max_repeat = 1;
+        } else if (c == '*') {
+            node.min_repeat = 0;
+            node.max_repeat = kOpenRepeatExtent;
+            node.unbounded = true;
+        } else if (c == '+') {
+            node.min_repeat = 1;
+            node.max_repeat = 1 + kOpenRepeatExtent;
+            node.unbounded = true;
+        } else if (c == '{') {
+            size_t close = src.find('}', pos);
+            if (close == std::string::npos) {
+                return fail("Missing '}'");
+            }
+            
+            std::string body = src.substr(pos + 1, close - pos - 1);
+            size_t comma = body.find(',');
+            try {
+                if (comma == std::string::npos) {
+                    node.min_repeat = node.max_repeat = std::stoi(body);
+                } else {
+                    node.min_repeat = std::stoi(body.substr(0, comma));
+                    std::string upper = body.substr(comma + 1);
+                    node.max_repeat = upper.empty() ? node.min_repeat + kOpenRepeatExtent : std::stoi(upper);
+                    node.unbounded = upper.empty();
+                }
+            } catch (const std::exception&) {
+                return fail("Invalid repeat bounds");
+            }
+            
+            if (node.min_repeat < 0 || node.max_repeat < node.min_repeat) {
+                return fail("Invalid repeat bounds");
+            }
+            pos = close;
+        } else {
+            return true;
+        }
+        
+        pos++;
+        if (peek() == '?' || peek() == '+') {
+            pos++;  // Lazy/possessive modifiers do not change what can be generated
+        }
+        return true;
+    }
+    
+    static std::string alphabet_from_set(const std::bitset<256>& set) {
+        std::string chars;
+        for (int ch = 0; ch < 256; ++ch) {
+            if (set.test(ch)) {
+                chars.push_back(static_cast<char>(ch));
+            }
+        }
+        return chars;
+    }
+    
+    // Printable ASCII not in the excluded set (used for '.' and [^...])
+    static std::string printable_alphabet(const std::bitset<256>& excluded) {
+        std::string chars;
+        for (int ch = 0x20; ch < 0x7F; ++ch) {
+            if (!excluded.test(ch)) {
+                chars.push_back(static_cast<char>(ch));
+            }
+        }
+        return chars;
     }
 };
 
-// Python C API functions
-static PyObject* generate_credential_cpp(PyObject* self, PyObject* args) {
-    const char* credential_type;
-    const char* pattern = nullptr;
+// Byte-level automaton for validating against a compiled program. The
+// PatternNode program expands into a Thompson NFA (counted repeats become
+// copies) and is determinized over byte classes, so checking a credential
+// is one table lookup per byte. Fails on programs whose automaton exceeds
+// the state limits.
+class PatternDfa {
+public:
+    static constexpr size_t kMaxNfaStates = 1 << 16;
+    static constexpr size_t kMaxDfaStates = 1 << 15;
+    static constexpr size_t kNoMatch = static_cast<size_t>(-1);
+    static constexpr size_t kMaxPrefix = 16;
     
-    if (!PyArg_ParseTuple(args, "s|s", &credential_type, &pattern)) {
-        return nullptr;
+    bool build(const std::vector<PatternNode>& program) {
+        Nfa nfa;
+        int end;
+        if (!nfa.sequence(program, nfa.add(), end) || nfa.overflow) {
+            return false;
+        }
+        nfa.accept = end;
+        
+        // A single repeated class matches exactly the runs of that class
+        // within its bounds, which a scanner can decide from the run length
+        run_class = program.size() == 1 && program[0].kind == PatternNode::CHARSET && program[0].min_repeat > 0;
+        if (run_class) {
+            run_min = static_cast<size_t>(program[0].min_repeat);
+            run_max = program[0].unbounded ? SIZE_MAX : static_cast<size_t>(program[0].max_repeat);
+        }
+        return determinize(nfa);
     }
     
-    CredentialUtils utils;
-    std::string credential;
+    bool matches(const uint8_t* data, size_t n) const {
+        uint32_t state = kStart;
+        for (size_t i = 0; i < n && state != kDead; ++i) {
+            state = next(state, data[i]);
+        }
+        return accepting[state] != 0;
+    }
     
-    if (std::string(credential_type) == "aws_access_key") {
-        credential = utils.generate_aws_access_key();
-    } else if (std::string(credential_type) == "aws_secret_key") {
-        credential = utils.generate_aws_secret_key();
-    } else if (std::string(credential_type) == "jwt_token") {
-        credential = utils.generate_jwt_token();
-    } else if (std::string(credential_type) == "api_key") {
-        credential = utils.generate_api_key();
-    } else if (std::string(credential_type) == "password") {
-        credential = utils.generate_database_password();
-    } else {
-        PyErr_SetString(PyExc_ValueError, "Unsupported credential type");
-        return nullptr;
+    // Length of the longest match starting at data[0], or kNoMatch
+    size_t longest_match(const uint8_t* data, size_t n) const {
+        size_t longest = accepting[kStart] ? 0 : kNoMatch;
+        uint32_t state = kStart;
+        for (size_t i = 0; i < n; ++i) {
+            state = next(state, data[i]);
+            if (state == kDead) {
+                break;
+            }
+            if (accepting[state]) {
+                longest = i + 1;
+            }
+        }
+        return longest;
     }
     
-    // Validate against pattern if provided
-    if (pattern && !utils.validate_credential_pattern(credential, std::string(pattern))) {
-        // Retry with different random seed
-        credential = utils.generate_aws_access_key(); // Simplified retry
+    // Bytes a match can start with, and bytes it can end with
+    const std::bitset<256>& first_bytes() const { return first; }
+    const std::bitset<256>& last_bytes() const { return last; }
+    
+    // Literal every match starts with (up to kMaxPrefix bytes)
+    const std::string& prefix() const { return literal_prefix; }
+    
+    // Whether the pattern is one class repeated between min and max times
+    // (the class is then first_bytes())
+    bool run_bounds(size_t& min, size_t& max) const {
+        min = run_min;
+        max = run_max;
+        return run_class;
     }
     
-    return PyUnicode_FromString(credential.c_str());
-}
-
-static PyObject* validate_credential_cpp(PyObject* self, PyObject* args) {
-    const char* credential;
-    const char* pattern;
+    size_t states() const { return accepting.size(); }
     
-    if (!PyArg_ParseTuple(args, "ss", &credential, &pattern)) {
-        return nullptr;
+private:
+    static constexpr uint32_t kDead = 0;
+    static constexpr uint32_t kStart = 1;
+    
+    struct Nfa {
+        struct State {
+            std::bitset<256> on;    // Bytes leading to `out`; empty for epsilon-only states
+            int out = -1;
+            std::vector<int> eps;
+        };
+        
+        std::vector<State> states;
+        int accept = -1;
+        bool overflow = false;
+        
+        int add() {
+            if (states.size() >= kMaxNfaStates) {
+                overflow = true;
+                return 0;
+            }
+            states.emplace_back();
+            return static_cast<int>(states.size()) - 1;
+        }
+        
+        void link(int from, int to) {
+            states[from].eps.push_back(to);
+        }
+        
+        // Each builder starts from a fresh state so byte transitions never collide
+        bool sequence(const std::vector<PatternNode>& nodes, int from, int& end) {
+            for (const PatternNode& node : nodes) {
+                if (!repeat(node, from, from)) {
+                    return false;
+                }
+            }
+            end = from;
+            return !overflow;
+        }
+        
+        bool repeat(const PatternNode& node, int from, int& end) {
+            int at = from;
+            for (int i = 0; i < node.min_repeat; ++i) {
+                if (!atom(node, at, at)) {
+                    return false;
+                }
+            }
+            if (node.unbounded) {
+                int loop = add();
+                link(at, loop);
+                int body;
+                if (!atom(node, loop, body)) {
+                    return false;
+                }
+                link(body, loop);
+                at = loop;
+            } else if (node.max_repeat > node.min_repeat) {
+                int join = add();
+                for (int i = node.min_repeat; i < node.max_repeat; ++i) {
+                    link(at, join);
+                    if (!atom(node, at, at)) {
+                        return false;
+                    }
+                }
+                link(at, join);
+                at = join;
+            }
+            end = at;
+            return !overflow;
+        }
+        
+        bool atom(const PatternNode& node, int from, int& end) {
+            if (overflow) {
+                return false;
+            }
+            if (node.kind == PatternNode::GROUP) {
+                int join = add();
+                for (const auto& branch : node.alternatives) {
+                    int branch_end;
+                    if (!sequence(branch, from, branch_end)) {
+                        return false;
+                    }
+                    link(branch_end, join);
+                }
+                end = join;
+                return !overflow;
+            }
+            
+            int at = add();
+            link(from, at);
+            auto step = [&](const std::bitset<256>& on) {
+                int to = add();
+                states[at].on = on;
+                states[at].out = to;
+                at = to;
+            };
+            if (node.kind == PatternNode::CHARSET) {
+                step(node.accepts);
+            } else {
+                for (char c : node.text) {
+                    std::bitset<256> on;
+                    on.set(static_cast<unsigned char>(c));
+                    step(on);
+                }
+            }
+            end = at;
+            return !overflow;
+        }
+    };
+    
+    uint32_t next(uint32_t state, uint8_t byte) const {
+        return transitions[state * class_count + byte_class[byte]];
     }
     
-    CredentialUtils utils;
-    bool is_valid = utils.validate_credential_pattern(std::string(credential), std::string(pattern));
+    // Bytes no transition tells apart share a class
+    void compute_classes(const Nfa& nfa) {
+        std::vector<std::bitset<256>> sets;
+        for (const auto& state : nfa.states) {
+            if (state.on.any() && std::find(sets.begin(), sets.end(), state.on) == sets.end()) {
+                sets.push_back(state.on);
+            }
+        }
+        
+        std::vector<uint32_t> ids(256, 0);
+        uint32_t count = 1;
+        for (const auto& set : sets) {
+            std::unordered_map<uint64_t, uint32_t> split;
+            for (int b = 0; b < 256; ++b) {
+                uint64_t key = (static_cast<uint64_t>(ids[b]) << 1) | (set.test(b) ? 1 : 0);
+                auto it = split.emplace(key, static_cast<uint32_t>(split.size())).first;
+                ids[b] = it->second;
+            }
+            count = static_cast<uint32_t>(split.size());
+        }
+        
+        class_count = count;
+        representative.assign(count, 0);
+        for (int b = 255; b >= 0; --b) {
+            byte_class[b] = static_cast<uint16_t>(ids[b]);
+            representative[ids[b]] = static_cast<uint8_t>(b);
+        }
+    }
     
-    return PyBool_FromLong(is_valid ? 1 : 0);
-}
-
-static PyMethodDef CredentialMethods[] = {
-    {"generate_credential", generate_credential_cpp, METH_VARARGS, "Generate credential using C++"},
-    {"validate_credential", validate_credential_cpp, METH_VARARGS, "Validate credential against pattern"},
-    {nullptr, nullptr, 0, nullptr}
+    bool determinize(const Nfa& nfa) {
+        compute_classes(nfa);
+        
+        std::vector<uint32_t> visited(nfa.states.size(), 0);
+        uint32_t stamp = 0;
+        auto closure = [&](std::vector<int>& set) {
+            ++stamp;
+            std::vector<int> stack(set.begin(), set.end());
+            set.clear();
+            while (!stack.empty()) {
+                int s = stack.back();
+                stack.pop_back();
+                if (visited[s] == stamp) {
+                    continue;
+                }
+                visited[s] = stamp;
+                set.push_back(s);
+                for (int e : nfa.states[s].eps) {
+                    stack.push_back(e);
+                }
+            }
+            std::sort(set.begin(), set.end());
+        };
+        
+        std::map<std::vector<int>, uint32_t> index;
+        std::vector<std::vector<int>> subsets;
+        auto intern = [&](std::vector<int>&& set) -> uint32_t {
+            if (set.empty()) {
+                return kDead;
+            }
+            auto it = index.find(set);
+            if (it != index.end()) {
+                return it->second;
+            }
+            uint32_t id = static_cast<uint32_t>(subsets.size());
+            index.emplace(set, id);
+            subsets.push_back(std::move(set));
+            return id;
+        };
+        
+        subsets.emplace_back();  // kDead
+        std::vector<int> start{0};
+        closure(start);
+        intern(std::move(start));
+        
+        transitions.clear();
+        for (uint32_t d = kStart; d < subsets.size(); ++d) {
+            if (subsets.size() > kMaxDfaStates) {
+                return false;
+            }
+            transitions.resize((d + 1) * class_count, kDead);
+            for (uint32_t c = 0; c < class_count; ++c) {
+                uint8_t byte = representative[c];
+                std::vector<int> target;
+                for (int s : subsets[d]) {
+                    if (nfa.states[s].on.test(byte)) {
+                        target.push_back(nfa.states[s].out);
+                    }
+                }
+                closure(target);
+                transitions[d * class_count + c] = intern(std::move(target));
+            }
+        }
+        
+        accepting.assign(subsets.size(), 0);
+        for (uint32_t d = kStart; d < subsets.size(); ++d) {
+            accepting[d] = std::binary_search(subsets[d].begin(), subsets[d].end(), nfa.accept) ? 1 : 0;
+        }
+        
+        describe();
+        return true;
+    }
+    
+    // Boundary sets and literal prefix used by PatternScanner
+    void describe() {
+        first.reset();
+        last.reset();
+        for (int b = 0; b < 256; ++b) {
+            if (next(kStart, b) != kDead) {
+                first.set(b);
+            }
+            for (uint32_t d = kStart; d < accepting.size() && !last.test(b); ++d) {
+                if (accepting[next(d, b)]) {
+                    last.set(b);
+                }
+            }
+        }
+        
+        literal_prefix.clear();
+        uint32_t state = kStart;
+        while (!accepting[state] && literal_prefix.size() < kMaxPrefix) {
+            int only = -1;
+            for (int b = 0; b < 256; ++b) {
+                if (next(state, b) != kDead) {
+                    if (only >= 0) {
+                        only = -2;
+                        break;
+                    }
+                    only = b;
+                }
+            }
+            if (only < 0) {
+                break;
+            }
+            literal_prefix.push_back(static_cast<char>(only));
+            state = next(state, static_cast<uint8_t>(only));
+        }
+    }
+    
+    uint16_t byte_class[256] = {};
+    std::vector<uint8_t> representative;
+    uint32_t class_count = 1;
+    std::vector<uint32_t> transitions;  // [state * class_count + class]
+    std::vector<uint8_t> accepting = {0};
+    std::bitset<256> first;
+    std::bitset<256> last;
+    std::string literal_prefix;
+    bool run_class = false;
+    size_t run_min = 0;
+    size_t run_max = 0;
+};
+
+// Validator for one pattern: a PatternDfa when the regex is in the subset
+// PatternCompiler understands and its automaton fits, std::regex otherwise.
+// Invalid patterns match nothing; compiling never throws.
+class PatternMatcher {
+public:
+    PatternMatcher() = default;
+    
+    explicit PatternMatcher(const std::string& regex) {
+        std::vector<PatternNode> program;
+        std::string error;
+        bool compiled;
+        try {
+            compiled = PatternCompiler::compile(regex, program, error) && compile(regex, program);
+        } catch (const std::exception&) {
+            dfa_.reset();
+            compiled = false;
+        }
+        if (!compiled) {
+            use_regex(regex);
+        }
+    }
+    
+    // From an already compiled program; false if it fell back to std::regex
+    bool compile(const std::string& regex, const std::vector<PatternNode>& program) {
+        auto built = std::make_unique<PatternDfa>();
+        if (built->build(program)) {
+            dfa_ = std::move(built);
+            return true;
+        }
+        use_regex(regex);
+        return false;
+    }
+    
+    bool matches(const char* data, size_t n) const {
+        if (dfa_) {
+            return dfa_->matches(reinterpret_cast<const uint8_t*>(data), n);
+        }
+        return regex_ && std::regex_match(data, data + n, *regex_);
+    }
+    
+    // Null when validation goes through std::regex
+    const PatternDfa* dfa() const {
+        return dfa_.get();
+    }
+    
+private:
+    void use_regex(const std::string& regex) {
+        try {
+            regex_ = std::make_unique<std::regex>(regex);
+        } catch (const std::exception&) {
+            regex_.reset();
+        }
+    }
+    
+    std::unique_ptr<PatternDfa> dfa_;
+    std::unique_ptr<std::regex> regex_;
+};
+
+// Matchers for ad-hoc patterns passed to validate_credential(), so repeated
+// calls with the same pattern compile it once
+static std::shared_ptr<const PatternMatcher> cached_matcher(const std::string& regex) {
+    static const size_t kMaxCached = 1024;
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::shared_ptr<const PatternMatcher>> cache;
+    
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = cache.find(regex);
+        if (it != cache.end()) {
+            return it->second;
+        }
+    }
+    
+    // Compile outside the lock; a racing thread compiling the same pattern is harmless
+    auto matcher = std::make_shared<const PatternMatcher>(regex);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (cache.size() >= kMaxCached) {
+        cache.clear();
+    }
+    return cache.emplace(regex, std::move(matcher)).first->second;
+}
+
+class CredentialUtils {
+private:
+    Xoshiro256Engine fast_engine;
+    ChaCha20Engine crypto_engine;
+    RandomEngine* engine;
+    RngMode default_mode;
+    std::unordered_map<std::string, AlphabetTable> alphabet_cache;
+    alignas(64) uint8_t random_scratch[4096];
+    
+    // Seed from CREDENTIALFORGE_SEED when set so default corpora are reproducible
+    static bool env_seed(uint64_t& seed) {
+        const char* value = std::getenv("CREDENTIALFORGE_SEED");
+        if (!value || !*value) {
+            return false;
+        }
+        seed = std::strtoull(value, nullptr, 0);
+        return true;
+    }
+    
+    static uint64_t entropy_seed() {
+        std::random_device device;
+        return (static_cast<uint64_t>(device()) << 32) ^ device() ^
+               static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    }
+    
+public:
+    CredentialUtils() : fast_engine(entropy_seed()), engine(&fast_engine), default_mode(RngMode::FAST) {
+        uint64_t seed;
+        if (env_seed(seed)) {
+            reseed(seed);
+        }
+    }
+    
+    explicit CredentialUtils(uint64_t seed)
+        : fast_engine(seed), crypto_engine(seed), engine(&fast_engine), default_mode(RngMode::FAST) {}
+    
+    // Reseed both engines; identical seeds give identical output streams
+    void reseed(uint64_t seed) {
+        fast_engine.reseed(seed);
+        crypto_engine.reseed(seed);
+    }
+    
+    void set_default_mode(RngMode mode) {
+        default_mode = mode;
+        use_mode(mode);
+    }
+    
+    RngMode get_default_mode() const {
+        return default_mode;
+    }
+    
+    // Select the engine used by subsequent calls
+    void use_mode(RngMode mode) {
+        engine = (mode == RngMode::CRYPTO) ? static_cast<RandomEngine*>(&crypto_engine)
+                                           : static_cast<RandomEngine*>(&fast_engine);
+    }
+    
+    void append_random_chars(size_t length, const AlphabetTable& table, std::string& out) {
+        if (table.size == 0) {
+            return;
+        }
+        
+        size_t start = out.size();
+        out.resize(start + length);
+        char* dst = &out[start];
+        
+        if (table.vectorizable()) {
+            // Request enough random bytes to cover typical rejection in one
+            // pass; the sizing depends only on length, so output stays
+            // identical across kernel levels
+            for (size_t produced = 0; produced < length;) {
+                size_t need = length - produced;
+                size_t request = std::min(sizeof(random_scratch), ((need + need / 8 + 16 + 63) / 64) * 64);
+                engine->fill(random_scratch, request);
+                produced += simd_kernels::map_alphabet(random_scratch, request, table.symbols, table.size,
+                                                       dst + produced, need);
+            }
+            return;
+        }
+        
+        for (size_t produced = 0; produced < length;) {
+            uint8_t b = engine->next_byte();
+            if (b < table.limit) {
+                dst[produced++] = table.symbols[b];
+            }
+        }
+    }
+    
+    std::string generate_random_string(size_t length, const std::string& charset) {
+        auto it = alphabet_cache.find(charset);
+        if (it == alphabet_cache.end()) {
+            it = alphabet_cache.emplace(charset, AlphabetTable(charset)).first;
+        }
+        
+        std::string result;
+        append_random_chars(length, it->second, result);
+        return result;
+    }
+    
+    std::string generate_hex_string(size_t length) {
+        static const AlphabetTable hex_table(std::string(simd_kernels::kHexLowerTable, 16));
+        std::string result;
+        append_random_chars(length, hex_table, result);
+        return result;
+    }
+    
+    std::string generate_base64_string(size_t length) {
+        static const AlphabetTable base64_table(std::string(simd_kernels::kBase64Table, 64));
+        std::string result;
+        append_random_chars(length, base64_table, result);
+        return result;
+    }
+    
+    std::string generate_base64url_string(size_t length) {
+        static const AlphabetTable base64url_table(std::string(simd_kernels::kBase64UrlTable, 64));
+        std::string result;
+        append_random_chars(length, base64url_table, result);
+        return result;
+    }
+    
+    std::string generate_aws_access_key() {
+        // Access key IDs are upper-case alphanumeric (^AKIA[0-9A-Z]{16}$)
+        return "AKIA" + generate_random_string(16, "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ");
+    }
+    
+    std::string generate_aws_secret_key() {
+        return generate_base64_string(40);
+    }
+    
+    std::string generate_jwt_token() {
+        // Header
+        std::string header = R"({"alg":"HS256","typ":"JWT"})";
+        
+        // Payload
+        std::string payload = R"({"sub":"user123","iat":)" + 
+                             std::to_string(std::time(nullptr)) + 
+                             R"(,"exp":)" + 
+                             std::to_string(std::time(nullptr) + 3600) + "}";
+        
+        // Encode header and payload
+        std::string encoded_header = base64_encode(header);
+        std::string encoded_payload = base64_encode(payload);
+        
+        // Create signature (simplified)
+        std::string signature = generate_hex_string(32);
+        
+        return encoded_header + "." + encoded_payload + "." + signature;
+    }
+    
+    std::string generate_api_key() {
+        return "sk-" + generate_hex_string(32);
+    }
+    
+    std::string generate_database_password() {
+        const std::string charset = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789!@#$%^&*";
+        return generate_random_string(16, charset);
+    }
+    
+    static bool has_builtin(const std::string& credential_type) {
+        return credential_type == "aws_access_key" || credential_type == "aws_secret_key" ||
+               credential_type == "jwt_token" || credential_type == "api_key" || credential_type == "password";
+    }
+    
+    // Append one of the built-in credential types; false if the type is unknown
+    bool append_builtin(const std::string& credential_type, std::string& out) {
+        if (credential_type == "aws_access_key") {
+            out += generate_aws_access_key();
+        } else if (credential_type == "aws_secret_key") {
+            out += generate_aws_secret_key();
+        } else if (credential_type == "jwt_token") {
+            out += generate_jwt_token();
+        } else if (credential_type == "api_key") {
+            out += generate_api_key();
+        } else if (credential_type == "password") {
+            out += generate_database_password();
+        } else {
+            return false;
+        }
+        return true;
+    }
+    
+    // Generate a string matching a compiled pattern program
+    std::string generate_from_program(const std::vector<PatternNode>& program) {
+        std::string result;
+        append_program(program, result);
+        return result;
+    }
+    
+    void append_program(const std::vector<PatternNode>& program, std::string& out) {
+        for (const auto& node : program) {
+            int count = node.min_repeat;
+            if (node.max_repeat > node.min_repeat) {
+                count += static_cast<int>(engine->uniform(node.max_repeat - node.min_repeat + 1));
+            }
+            
+            switch (node.kind) {
+                case PatternNode::LITERAL:
+                    for (int i = 0; i < count; ++i) {
+                        out += node.text;
+                    }
+                    break;
+                case PatternNode::CHARSET:
+                    append_random_chars(count, node.table, out);
+                    break;
+                case PatternNode::GROUP: {
+                    uint32_t branches = static_cast<uint32_t>(node.alternatives.size());
+                    for (int i = 0; i < count; ++i) {
+                        append_program(node.alternatives[engine->uniform(branches)], out);
+                    }
+                    break;
+                }
+            }
+        }
+    }
+    
+    static bool validate_credential_pattern(const std::string& credential, const std::string& pattern) {
+        return cached_matcher(pattern)->matches(credential.data(), credential.size());
+    }
+    
+private:
+    std::string base64_encode(const std::string& input) {
+        std::string result(simd_kernels::base64_encoded_size(input.size(), true), '\0');
+        size_t written = simd_kernels::base64_encode(reinterpret_cast<const uint8_t*>(input.data()), input.size(),
+                                                     simd_kernels::kBase64Table, &result[0], true);
+        result.resize(written);
+        return result;
+    }
+};
+
+// Finds every compiled credential type in a document in one pass. Patterns
+// that start with a literal of two or more bytes (AKIA, sk-, ghp_, xox...)
+// are located by the SIMD literal prefilter; the others are tried wherever
+// a run of the bytes they can start with begins. Each candidate runs the
+// pattern's DFA for its longest match.
+//
+// A match may not continue a run it could have started earlier (the byte
+// before it is not one of its first bytes) or stop inside one (the byte
+// after it is not one of its last bytes), so a 32-digit hex key is not
+// reported inside a 40-digit one. Matches of one type do not overlap.
+// Patterns that are one repeated class are decided from the run length.
+class PatternScanner {
+public:
+    using Matches = credential_scan::Matches;
+    
+    void build(const std::vector<const PatternDfa*>& pattern_dfas) {
+        dfas = pattern_dfas;
+        std::memset(&masks, 0, sizeof(masks));
+        for (auto& bucket : buckets) {
+            bucket.clear();
+        }
+        group_sets.clear();
+        group_patterns.clear();
+        start_masks.clear();
+        
+        // Literal patterns by their two-byte fingerprint; neighbouring
+        // fingerprints share a bucket so its masks stay selective
+        std::map<uint16_t, std::vector<size_t>> fingerprints;
+        for (size_t p = 0; p < dfas.size(); ++p) {
+            if (!dfas[p]) {
+                continue;
+            }
+            const std::string& prefix = dfas[p]->prefix();
+            if (prefix.size() >= 2) {
+                uint16_t fingerprint = static_cast<uint16_t>((static_cast<uint8_t>(prefix[0]) << 8) |
+                                                             static_cast<uint8_t>(prefix[1]));
+                fingerprints[fingerprint].push_back(p);
+                continue;
+            }
+            
+            const std::bitset<256>& first = dfas[p]->first_bytes();
+            size_t g = std::find(group_sets.begin(), group_sets.end(), first) - group_sets.begin();
+            if (g == group_sets.size()) {
+                group_sets.push_back(first);
+                group_patterns.emplace_back();
+            }
+            group_patterns[g].push_back(p);
+        }
+        
+        size_t k = 0;
+        for (const auto& entry : fingerprints) {
+            uint8_t bit = static_cast<uint8_t>(1u << (k++ * kBuckets / fingerprints.size()));
+            uint8_t bytes[2] = {static_cast<uint8_t>(entry.first >> 8), static_cast<uint8_t>(entry.first)};
+            for (int j = 0; j < 2; ++j) {
+                masks.lo[j][bytes[j] & 15] |= bit;
+                masks.hi[j][bytes[j] >> 4] |= bit;
+            }
+            auto& bucket = buckets[__builtin_ctz(bit)];
+            bucket.insert(bucket.end(), entry.second.begin(), entry.second.end());
+        }
+        
+        start_masks.resize((group_sets.size() + 63) / 64);
+        for (size_t g = 0; g < group_sets.size(); ++g) {
+            auto& word = start_masks[g / 64];
+            for (int b = 0; b < 256; ++b) {
+                if (group_sets[g].test(b)) {
+                    word[b] |= uint64_t(1) << (g % 64);
+                }
+            }
+        }
+    }
+    
+    bool scannable(size_t pattern) const {
+        return pattern < dfas.size() && dfas[pattern] != nullptr;
+    }
+    
+    // (start, end) byte offsets per pattern, in order; `selected` empty scans all
+    void scan(const uint8_t* data, size_t n, const std::vector<bool>& selected, Matches& matches) const {
+        tracing::Span span(tracing::CREDENTIALS, "credentials.scan", static_cast<int64_t>(n));
+        matches.assign(dfas.size(), {});
+        std::vector<size_t> resume(dfas.size(), 0);
+        auto wanted = [&](size_t p) {
+            return selected.empty() || selected[p];
+        };
+        
+        auto try_match = [&](size_t p, size_t start) {
+            const PatternDfa& dfa = *dfas[p];
+            if (start < resume[p] || (start > 0 && dfa.first_bytes().test(data[start - 1]))) {
+                return;
+            }
+            size_t length = dfa.longest_match(data + start, n - start);
+            if (length == PatternDfa::kNoMatch || length == 0) {
+                return;
+            }
+            size_t end = start + length;
+            if (end < n && dfa.last_bytes().test(data[end])) {
+                return;
+            }
+            matches[p].emplace_back(start, end);
+            resume[p] = end;
+        };
+        
+        bool literals = false;
+        for (const auto& bucket : buckets) {
+            for (size_t p : bucket) {
+                literals |= wanted(p);
+            }
+        }
+        if (literals) {
+            uint64_t hits[kHitBatch];
+            size_t pos = 0;
+            while (pos < n) {
+                size_t count = simd_kernels::literal_candidates(data, n, pos, masks, hits, kHitBatch);
+                for (size_t h = 0; h < count; ++h) {
+                    size_t start = static_cast<size_t>(hits[h] >> 8);
+                    for (unsigned bits = hits[h] & 0xFF; bits; bits &= bits - 1) {
+                        for (size_t p : buckets[__builtin_ctz(bits)]) {
+                            const std::string& prefix = dfas[p]->prefix();
+                            if (wanted(p) && n - start >= prefix.size() &&
+                                std::memcmp(data + start, prefix.data(), prefix.size()) == 0) {
+                                try_match(p, start);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        
+        // Run starts of every group in a word at once: bytes that can start
+        // the group's patterns preceded by one that cannot
+        struct RunBounds {
+            size_t pattern;
+            size_t min;
+            size_t max;
+        };
+        std::vector<std::vector<size_t>> general(group_sets.size());
+        std::vector<std::vector<RunBounds>> runs(group_sets.size());
+        for (size_t g = 0; g < group_sets.size(); ++g) {
+            for (size_t p : group_patterns[g]) {
+                RunBounds bounds{p, 0, 0};
+                if (!wanted(p)) {
+                    continue;
+                }
+                if (dfas[p]->run_bounds(bounds.min, bounds.max)) {
+                    runs[g].push_back(bounds);
+                } else {
+                    general[g].push_back(p);
+                }
+            }
+        }
+        
+        for (size_t w = 0; w < start_masks.size(); ++w) {
+            uint64_t active = 0;
+            for (size_t g = w * 64; g < std::min(group_sets.size(), w * 64 + 64); ++g) {
+                if (!general[g].empty() || !runs[g].empty()) {
+                    active |= uint64_t(1) << (g % 64);
+                }
+            }
+            if (!active) {
+                continue;
+            }
+            
+            const auto& table = start_masks[w];
+            uint64_t previous = 0;
+            for (size_t i = 0; i < n; ++i) {
+                uint64_t current = table[data[i]] & active;
+                for (uint64_t starts = current & ~previous; starts; starts &= starts - 1) {
+                    int bit = __builtin_ctzll(starts);
+                    size_t g = w * 64 + bit;
+                    for (size_t p : general[g]) {
+                        try_match(p, i);
+                    }
+                    if (runs[g].empty()) {
+                        continue;
+                    }
+                    
+                    const uint64_t mask = uint64_t(1) << bit;
+                    size_t run = 1;
+                    while (i + run < n && (table[data[i + run]] & mask)) {
+                        ++run;
+                    }
+                    for (const RunBounds& bounds : runs[g]) {
+                        if (run >= bounds.min && run <= bounds.max) {
+                            matches[bounds.pattern].emplace_back(i, i + run);
+                        }
+                    }
+                }
+                previous = current;
+            }
+        }
+    }
+    
+private:
+    static constexpr int kBuckets = 8;
+    static constexpr size_t kHitBatch = 512;
+    
+    std::vector<const PatternDfa*> dfas;  // Per registry pattern; null when not scannable
+    simd_kernels::LiteralMasks masks = {};
+    std::vector<size_t> buckets[kBuckets];
+    std::vector<std::bitset<256>> group_sets;        // First bytes shared by a group of patterns
+    std::vector<std::vector<size_t>> group_patterns;
+    std::vector<std::array<uint64_t, 256>> start_masks;  // Byte -> groups it can start, 64 per word
+};
+
+// Compiled patterns loaded from regex_db.json, addressable by type or index
+class PatternRegistry {
+public:
+    struct CompiledPattern {
+        std::string type;
+        std::string regex;
+        std::vector<PatternNode> program;
+        PatternMatcher matcher;
+    };
+    
+    // Compile every (type, regex) entry; failures are reported and skipped
+    size_t compile(const std::vector<std::pair<std::string, std::string>>& entries) {
+        patterns.clear();
+        index.clear();
+        
+        for (const auto& entry : entries) {
+            CompiledPattern compiled;
+            compiled.type = entry.first;
+            compiled.regex = entry.second;
+            
+            std::string error;
+            if (!PatternCompiler::compile(entry.second, compiled.program, error)) {
+                std::cerr << "Skipping pattern '" << entry.first << "': " << error << std::endl;
+                continue;
+            }
+            if (!compiled.matcher.compile(entry.second, compiled.program)) {
+                std::cerr << "Pattern '" << entry.first << "' exceeds the DFA limits; "
+                          << "validating with std::regex and not scanning it" << std::endl;
+            }
+            
+            index[compiled.type] = patterns.size();
+            patterns.push_back(std::move(compiled));
+        }
+        
+        std::vector<const PatternDfa*> dfas;
+        for (const auto& pattern : patterns) {
+            dfas.push_back(pattern.matcher.dfa());
+        }
+        pattern_scanner.build(dfas);
+        
+        return patterns.size();
+    }
+    
+    const CompiledPattern* find(const std::string& type) const {
+        auto it = index.find(type);
+        return it != index.end() ? &patterns[it->second] : nullptr;
+    }
+    
+    const CompiledPattern* at(size_t i) const {
+        return i < patterns.size() ? &patterns[i] : nullptr;
+    }
+    
+    const std::vector<CompiledPattern>& all() const {
+        return patterns;
+    }
+    
+    size_t position(const CompiledPattern* pattern) const {
+        return static_cast<size_t>(pattern - patterns.data());
+    }
+    
+    const PatternScanner& scanner() const {
+        return pattern_scanner;
+    }
+    
+private:
+    std::vector<CompiledPattern> patterns;
+    std::unordered_map<std::string, size_t> index;
+    PatternScanner pattern_scanner;
+};
+
+// Global instance; shared so validation and scans can keep using a
+// registry that compile_patterns() has replaced
+static std::shared_ptr<PatternRegistry> g_pattern_registry = nullptr;
+
+// 64-bit credential fingerprint (murmur3-style mixing over 8-byte words).
+// Zero and all ones are reserved as empty and sealed slot markers. At 10^8
+// credentials the chance of any false duplicate is below 10^-3.
+static inline uint64_t fmix64(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static uint64_t credential_fingerprint(const char* data, size_t n) {
+    const uint64_t c1 = 0x87c37b91114253d5ULL;
+    const uint64_t c2 = 0x4cf5ad432745937fULL;
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ (static_cast<uint64_t>(n) * c1);
+    
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t k;
+        std::memcpy(&k, data + i, 8);
+        h ^= rotl64(k * c1, 31) * c2;
+        h = rotl64(h, 27) * 5 + 0x52dce729;
+    }
+    
+    uint64_t tail = 0;
+    for (size_t j = 0; i + j < n; ++j) {
+        tail |= static_cast<uint64_t>(static_cast<uint8_t>(data[i + j])) << (8 * j);
+    }
+    h ^= rotl64(tail * c1, 31) * c2;
+    
+    h = fmix64(h);
+    return h && h != ~0ULL ? h : 1;
+}
+
+// Concurrent set of credential fingerprints: open addressing with linear
+// probing, each slot claimed by a single CAS, 8 bytes per credential instead
+// of the string. Process-local sets grow on demand (a reader-writer lock only
+// excludes resizing). Sets in POSIX shared memory cannot be resized in place
+// by processes that map them, so they grow in generations: once a segment
+// reaches its capacity, inserts seal the empty slot that ends their probe
+// chain and continue in a segment twice the size ("name.1", "name.2", ...).
+// A credential in generation k + 1 always has a sealed slot on its chain in
+// generation k, so lookups and concurrent inserts of the same credential in
+// other processes follow it there. An optional Bloom filter answers most
+// negative lookups without touching the larger slot table.
+class FingerprintSet {
+public:
+    enum class InsertResult { INSERTED, PRESENT, FULL, SEALED };
+    
+    static constexpr uint64_t kMagic = 0x43465350524e5432ULL;  // "CFSPRNT2"
+    static constexpr uint64_t kSealedSlot = ~0ULL;
+    static constexpr unsigned kMaxGenerations = 24;
+    
+    // Layout at the start of a shared segment; slots and Bloom words follow
+    struct alignas(64) SharedHeader {
+        std::atomic<uint64_t> ready;
+        uint64_t slot_count;
+        uint64_t bloom_words;
+        uint32_t bloom_hashes;
+        uint32_t bloom_bits_per_key;
+        std::atomic<uint64_t> count;
+        std::atomic<uint32_t> attached;   // Processes with generation 0 open
+        std::atomic<uint32_t> has_next;   // The next generation exists
+        std::atomic<uint32_t> unlinked;   // unlink() already removed the names
+    };
+    
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared fingerprint slots need lock-free 64-bit atomics");
+    
+    ~FingerprintSet() {
+#ifndef _WIN32
+        // The last process to detach removes the names, so workers that are
+        // still attaching never find them gone
+        if (header && generation == 0 && header->attached.fetch_sub(1, std::memory_order_acq_rel) == 1 &&
+            !header->unlinked.load(std::memory_order_acquire)) {
+            unlink();
+        }
+        next_storage.reset();
+        if (mapping) {
+            munmap(mapping, mapping_size);
+        }
+#endif
+    }
+    
+    static std::unique_ptr<FingerprintSet> create_local(size_t capacity, unsigned bloom_bits_per_key) {
+        std::unique_ptr<FingerprintSet> set(new FingerprintSet());
+        set->bloom_bits_per_key = std::min(bloom_bits_per_key, 32u);
+        set->allocate_local(slots_for(capacity));
+        return set;
+    }
+    
+    // Create the named segment, or attach to it when another process already
+    // has; the creator's capacity and Bloom settings win
+    static std::unique_ptr<FingerprintSet> open_shared(const std::string& name, size_t capacity,
+                                                       unsigned bloom_bits_per_key, std::string& error) {
+        std::string base = (!name.empty() && name[0] == '/') ? name : "/" + name;
+        return open_generation(base, 0, capacity, bloom_bits_per_key, error);
+    }
+    
+    InsertResult insert(uint64_t fp) {
+        if (header) {
+            InsertResult result = insert_slot(fp, count->load(std::memory_order_relaxed) < max_count);
+            if (result != InsertResult::SEALED) {
+                return result;
+            }
+            FingerprintSet* next = next_generation();
+            return next ? next->insert(fp) : InsertResult::FULL;
+        }
+        
+        {
+            std::shared_lock<std::shared_mutex> lock(resize_mutex);
+            InsertResult result = insert_slot(fp, true);
+            if (result != InsertResult::INSERTED || count->load(std::memory_order_relaxed) <= max_count) {
+                return result;
+            }
+        }
+        
+        grow();
+        return InsertResult::INSERTED;
+    }
+    
+    bool contains(uint64_t fp) const {
+        std::shared_lock<std::shared_mutex> lock(resize_mutex, std::defer_lock);
+        if (!header) {
+            lock.lock();
+        }
+        
+        bool sealed = false;
+        if (bloom && !bloom_test(fp)) {
+            bloom_rejects.fetch_add(1, std::memory_order_relaxed);
+            sealed = header && header->has_next.load(std::memory_order_acquire);
+        } else {
+            size_t mask = slot_count - 1;
+            for (size_t i = fp & mask, probes = 0; probes < slot_count; i = (i + 1) & mask, ++probes) {
+                uint64_t cur = slots[i].load(std::memory_order_acquire);
+                if (cur == fp) {
+                    return true;
+                }
+                if (cur == 0 || cur == kSealedSlot) {
+                    sealed = cur == kSealedSlot;
+                    break;
+                }
+            }
+        }
+        
+        if (!sealed) {
+            return false;
+        }
+        FingerprintSet* next = const_cast<FingerprintSet*>(this)->next_generation();
+        return next && next->contains(fp);
+    }
+    
+    // Not safe to run concurrently with inserts from other processes
+    void clear() {
+        std::unique_lock<std::shared_mutex> lock(resize_mutex);
+        for (size_t i = 0; i < slot_count; ++i) {
+            slots[i].store(0, std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < bloom_words; ++i) {
+            bloom[i].store(0, std::memory_order_relaxed);
+        }
+        count->store(0, std::memory_order_release);
+        
+        FingerprintSet* next = existing_next();
+        if (next) {
+            next->clear();
+        }
+    }
+    
+    // Remove the names of every generation; mapped segments stay usable
+    bool unlink() {
+#ifndef _WIN32
+        if (shm_name.empty()) {
+            return false;
+        }
+        bool removed = shm_unlink(shm_name.c_str()) == 0;
+        for (unsigned g = generation + 1; g < kMaxGenerations; ++g) {
+            if (shm_unlink(generation_name(base_name, g).c_str()) != 0) {
+                break;
+            }
+        }
+        if (header && generation == 0) {
+            header->unlinked.store(1, std::memory_order_release);
+        }
+        return removed;
+#else
+        return false;
+#endif
+    }
+    
+    // Totals over every generation, attaching those other processes created
+    size_t size() const { return total(&FingerprintSet::own_size); }
+    size_t capacity() const { return total(&FingerprintSet::own_capacity); }
+    size_t slots_allocated() const { return total(&FingerprintSet::own_slots); }
+    size_t bloom_bytes() const { return total(&FingerprintSet::own_bloom_bytes); }
+    unsigned get_bloom_hashes() const { return bloom_hashes; }
+    uint64_t get_bloom_rejects() const { return bloom_rejects.load(std::memory_order_relaxed); }
+    const std::string& get_shared_name() const { return shm_name; }
+    bool is_shared() const { return header != nullptr; }
+    
+    size_t generations() const {
+        size_t n = 1;
+        for (const FingerprintSet* next = following(); next; next = next->following()) {
+            ++n;
+        }
+        return n;
+    }
+    
+    // Why the last insert returned FULL
+    std::string full_reason() const {
+        const FingerprintSet* last = this;
+        while (last->existing_next()) {
+            last = last->existing_next();
+        }
+        std::lock_guard<std::mutex> lock(last->next_mutex);
+        return last->next_error;
+    }
+    
+private:
+    FingerprintSet() = default;
+    
+    // Slot tables stay at most half full
+    static size_t slots_for(size_t capacity) {
+        size_t slots = 64;
+        while (slots < capacity * 2) {
+            slots <<= 1;
+        }
+        return slots;
+    }
+    
+    static void bloom_layout(size_t slots, unsigned bits_per_key, size_t& words, unsigned& hashes) {
+        words = 0;
+        hashes = 0;
+        if (bits_per_key == 0) {
+            return;
+        }
+        
+        // One key per two slots; round the bit array up to a power of two
+        size_t bits = (slots / 2) * bits_per_key;
+        words = 1;
+        while (words * 64 < bits) {
+            words <<= 1;
+        }
+        hashes = std::max(1u, std::min(16u, static_cast<unsigned>(bits_per_key * 0.693 + 0.5)));
+    }
+    
+    static std::string generation_name(const std::string& base, unsigned generation) {
+        return generation ? base + "." + std::to_string(generation) : base;
+    }
+    
+    size_t own_size() const { return count->load(std::memory_order_relaxed); }
+    size_t own_capacity() const { return max_count; }
+    size_t own_slots() const { return slot_count; }
+    size_t own_bloom_bytes() const { return bloom_words * sizeof(uint64_t); }
+    
+    size_t total(size_t (FingerprintSet::*field)() const) const {
+        size_t sum = 0;
+        for (const FingerprintSet* set = this; set; set = set->following()) {
+            sum += (set->*field)();
+        }
+        return sum;
+    }
+    
+    void allocate_local(size_t slots) {
+        slot_storage.reset(new std::atomic<uint64_t>[slots]);
+        for (size_t i = 0; i < slots; ++i) {
+            slot_storage[i].store(0, std::memory_order_relaxed);
+        }
+        slot_count = slots;
+        this->slots = slot_storage.get();
+        max_count = slots / 10 * 7;
+        
+        bloom_layout(slots, bloom_bits_per_key, bloom_words, bloom_hashes);
+        bloom_storage.reset(bloom_words ? new std::atomic<uint64_t>[bloom_words] : nullptr);
+        for (size_t i = 0; i < bloom_words; ++i) {
+            bloom_storage[i].store(0, std::memory_order_relaxed);
+        }
+        bloom = bloom_storage.get();
+    }
+    
+    FingerprintSet* existing_next() const {
+        return next.load(std::memory_order_acquire);
+    }
+    
+    // The next generation if any process has created it
+    const FingerprintSet* following() const {
+        FingerprintSet* existing = existing_next();
+        if (existing || !header || !header->has_next.load(std::memory_order_acquire)) {
+            return existing;
+        }
+        return const_cast<FingerprintSet*>(this)->next_generation();
+    }
+    
+    // The generation after this one, created or attached on first use
+    FingerprintSet* next_generation() {
+        FingerprintSet* existing = existing_next();
+        if (existing) {
+            return existing;
+        }
+        
+        std::lock_guard<std::mutex> lock(next_mutex);
+        if (!next_storage) {
+            if (generation + 1 >= kMaxGenerations) {
+                next_error = "too many generations";
+                return nullptr;
+            }
+            std::string error;
+            next_storage = open_generation(base_name, generation + 1, slot_count, header->bloom_bits_per_key, error);
+            if (!next_storage) {
+                next_error = error;
+                return nullptr;
+            }
+            header->has_next.store(1, std::memory_order_release);
+            next.store(next_storage.get(), std::memory_order_release);
+        }
+        return next_storage.get();
+    }
+    
+    static std::unique_ptr<FingerprintSet> open_generation(const std::string& base, unsigned generation,
+                                                           size_t capacity, unsigned bloom_bits_per_key,
+                                                           std::string& error) {
+#ifdef _WIN32
+        error = "Shared fingerprint sets require POSIX shared memory";
+        return nullptr;
+#else
+        // A name whose last process is detaching gets unlinked shortly;
+        // wait for that and create a fresh segment
+        for (int waited_ms = 0;; ++waited_ms) {
+            std::unique_ptr<FingerprintSet> set(new FingerprintSet());
+            set->base_name = base;
+            set->generation = generation;
+            set->shm_name = generation_name(base, generation);
+            
+            int fd = shm_open(set->shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+            bool creator = fd >= 0;
+            if (!creator) {
+                if (errno != EEXIST || (fd = shm_open(set->shm_name.c_str(), O_RDWR, 0600)) < 0) {
+                    if (errno == ENOENT) {
+                        continue;  // Unlinked between the two opens
+                    }
+                    error = "shm_open failed for " + set->shm_name + ": " + std::strerror(errno);
+                    return nullptr;
+                }
+            }
+            
+            bool detached = false;
+            bool ok = creator ? set->init_segment(fd, capacity, std::min(bloom_bits_per_key, 32u), error)
+                              : set->attach_segment(fd, detached, error);
+            close(fd);
+            if (ok) {
+                return set;
+            }
+            if (!detached || waited_ms >= 5000) {
+                return nullptr;
+            }
+            error.clear();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+#endif
+    }
+    
+#ifndef _WIN32
+    bool init_segment(int fd, size_t capacity, unsigned bits_per_key, std::string& error) {
+        size_t slots = slots_for(capacity);
+        size_t words;
+        unsigned hashes;
+        bloom_layout(slots, bits_per_key, words, hashes);
+        
+        size_t bytes = sizeof(SharedHeader) + (slots + words) * sizeof(uint64_t);
+        if (ftruncate(fd, static_cast<off_t>(bytes)) != 0 || !map_segment(fd, bytes, error)) {
+            if (error.empty()) {
+                error = std::string("ftruncate failed: ") + std::strerror(errno);
+            }
+            shm_unlink(shm_name.c_str());
+            return false;
+        }
+        
+        // The segment is zero-filled, so only the header needs writing
+        header->slot_count = slots;
+        header->bloom_words = words;
+        header->bloom_hashes = hashes;
+        header->bloom_bits_per_key = bits_per_key;
+        header->attached.store(1, std::memory_order_relaxed);
+        header->ready.store(kMagic, std::memory_order_release);
+        bind_segment();
+        return true;
+    }
+    
+    // `detached` reports a segment whose last process already left
+    bool attach_segment(int fd, bool& detached, std::string& error) {
+        // The creator may still be sizing or initializing the segment
+        struct stat st;
+        for (int waited_ms = 0;; ++waited_ms) {
+            if (fstat(fd, &st) != 0) {
+                error = std::string("fstat failed: ") + std::strerror(errno);
+                return false;
+            }
+            if (static_cast<size_t>(st.st_size) >= sizeof(SharedHeader)) {
+                break;
+            }
+            if (waited_ms >= 5000) {
+                error = "Timed out waiting for shared fingerprint set " + shm_name;
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        
+        if (!map_segment(fd, static_cast<size_t>(st.st_size), error)) {
+            return false;
+        }
+        
+        for (int waited_ms = 0; header->ready.load(std::memory_order_acquire) != kMagic; ++waited_ms) {
+            if (waited_ms >= 5000) {
+                error = "Shared segment " + shm_name + " is not a fingerprint set";
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        
+        size_t expected = sizeof(SharedHeader) + (header->slot_count + header->bloom_words) * sizeof(uint64_t);
+        if (expected > mapping_size) {
+            error = "Shared segment " + shm_name + " is truncated";
+            return false;
+        }
+        
+        if (generation == 0) {
+            uint32_t attached = header->attached.load(std::memory_order_acquire);
+            do {
+                if (attached == 0) {
+                    detached = true;
+                    error = "Shared segment " + shm_name + " is being removed";
+                    return false;
+                }
+            } while (!header->attached.compare_exchange_weak(attached, attached + 1, std::memory_order_acq_rel));
+        }
+        
+        bind_segment();
+        return true;
+    }
+    
+    bool map_segment(int fd, size_t bytes, std::string& error) {
+        void* addr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED) {
+            error = std::string("mmap failed: ") + std::strerror(errno);
+            return false;
+        }
+        mapping = addr;
+        mapping_size = bytes;
+        header = static_cast<SharedHeader*>(addr);
+        return true;
+    }
+    
+    void bind_segment() {
+        slot_count = header->slot_count;
+        bloom_words = header->bloom_words;
+        bloom_hashes = header->bloom_hashes;
+        slots = reinterpret_cast<std::atomic<uint64_t>*>(static_cast<char*>(mapping) + sizeof(SharedHeader));
+        bloom = bloom_words ? slots + slot_count : nullptr;
+        count = &header->count;
+        max_count = slot_count / 10 * 9;
+    }
+#endif
+    
+    // With `claim` false (a full shared segment) the empty slot ending the
+    // probe chain is sealed instead of taken
+    InsertResult insert_slot(uint64_t fp, bool claim) {
+        if (bloom) {
+            bloom_add(fp);
+        }
+        
+        size_t mask = slot_count - 1;
+        for (size_t i = fp & mask, probes = 0; probes < slot_count; i = (i + 1) & mask, ++probes) {
+            uint64_t cur = slots[i].load(std::memory_order_acquire);
+            if (cur == 0) {
+                if (slots[i].compare_exchange_strong(cur, claim ? fp : kSealedSlot, std::memory_order_acq_rel)) {
+                    if (!claim) {
+                        return InsertResult::SEALED;
+                    }
+                    count->fetch_add(1, std::memory_order_relaxed);
+                    return InsertResult::INSERTED;
+                }
+            }
+            if (cur == fp) {
+                return InsertResult::PRESENT;
+            }
+            if (cur == kSealedSlot) {
+                return InsertResult::SEALED;
+            }
+        }
+        return header ? InsertResult::SEALED : InsertResult::FULL;
+    }
+    
+    // Double the slot table and rebuild the Bloom filter at the new size
+    void grow() {
+        std::unique_lock<std::shared_mutex> lock(resize_mutex);
+        if (count->load(std::memory_order_relaxed) <= max_count) {
+            return;
+        }
+        
+        std::unique_ptr<std::atomic<uint64_t>[]> old_slots = std::move(slot_storage);
+        size_t old_count = slot_count;
+        allocate_local(old_count * 2);
+        
+        uint64_t kept = 0;
+        for (size_t i = 0; i < old_count; ++i) {
+            uint64_t fp = old_slots[i].load(std::memory_order_relaxed);
+            if (fp != 0 && insert_slot(fp, true) == InsertResult::INSERTED) {
+                ++kept;
+            }
+        }
+        count->store(kept, std::memory_order_relaxed);
+    }
+    
+    template <typename Visit>
+    bool bloom_probe(uint64_t fp, Visit visit) const {
+        uint64_t h = fmix64(fp ^ 0x5bd1e9955bd1e995ULL);
+        uint64_t step = (h >> 32) | 1;
+        uint64_t bit_mask = bloom_words * 64 - 1;
+        for (unsigned k = 0; k < bloom_hashes; ++k, h += step) {
+            uint64_t bit = h & bit_mask;
+            if (!visit(bloom[bit >> 6], uint64_t(1) << (bit & 63))) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    void bloom_add(uint64_t fp) {
+        bloom_probe(fp, [](std::atomic<uint64_t>& word, uint64_t bit) {
+            if (!(word.load(std::memory_order_relaxed) & bit)) {
+                word.fetch_or(bit, std::memory_order_relaxed);
+            }
+            return true;
+        });
+    }
+    
+    bool bloom_test(uint64_t fp) const {
+        return bloom_probe(fp, [](const std::atomic<uint64_t>& word, uint64_t bit) {
+            return (word.load(std::memory_order_relaxed) & bit) != 0;
+        });
+    }
+    
+    std::atomic<uint64_t>* slots = nullptr;
+    std::atomic<uint64_t>* bloom = nullptr;
+    std::atomic<uint64_t>* count = &local_count;
+    size_t slot_count = 0;
+    size_t bloom_words = 0;
+    unsigned bloom_hashes = 0;
+    unsigned bloom_bits_per_key = 0;
+    size_t max_count = 0;
+    
+    std::unique_ptr<std::atomic<uint64_t>[]> slot_storage;
+    std::unique_ptr<std::atomic<uint64_t>[]> bloom_storage;
+    std::atomic<uint64_t> local_count{0};
+    mutable std::atomic<uint64_t> bloom_rejects{0};
+    mutable std::shared_mutex resize_mutex;
+    
+    SharedHeader* header = nullptr;
+    void* mapping = nullptr;
+    size_t mapping_size = 0;
+    std::string shm_name;
+    std::string base_name;
+    unsigned generation = 0;
+    
+    std::atomic<FingerprintSet*> next{nullptr};
+    std::unique_ptr<FingerprintSet> next_storage;
+    mutable std::mutex next_mutex;
+    std::string next_error;
+};
+
+// Read (type, regex) pairs from a regex_db.json file using Python's json module
+static bool load_regex_db_entries(const char* db_path, std::vector<std::pair<std::string, std::string>>& entries) {
+    std::ifstream file(db_path, std::ios::binary);
+    if (!file) {
+        PyErr_Format(PyExc_FileNotFoundError, "Cannot open regex database: %s", db_path);
+        return false;
+    }
+    std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    
+    PyObject* json_module = PyImport_ImportModule("json");
+    if (!json_module) {
+        return false;
+    }
+    PyObject* doc = PyObject_CallMethod(json_module, "loads", "s#", text.data(), static_cast<Py_ssize_t>(text.size()));
+    Py_DECREF(json_module);
+    if (!doc) {
+        return false;
+    }
+    
+    // Accept both {"credentials": [...]} and a bare list of entries
+    PyObject* credentials = PyDict_Check(doc) ? PyDict_GetItemString(doc, "credentials") : doc;
+    if (!credentials || !PyList_Check(credentials)) {
+        Py_DECREF(doc);
+        PyErr_SetString(PyExc_ValueError, "Regex database must contain a 'credentials' list");
+        return false;
+    }
+    
+    for (Py_ssize_t i = 0; i < PyList_Size(credentials); ++i) {
+        PyObject* item = PyList_GetItem(credentials, i);
+        if (!PyDict_Check(item)) {
+            continue;
+        }
+        
+        PyObject* type = PyDict_GetItemString(item, "type");
+        PyObject* regex = PyDict_GetItemString(item, "regex");
+        if (!type || !regex || !PyUnicode_Check(type) || !PyUnicode_Check(regex)) {
+            continue;
+        }
+        
+        entries.emplace_back(PyUnicode_AsUTF8(type), PyUnicode_AsUTF8(regex));
+    }
+    
+    Py_DECREF(doc);
+    return true;
+}
+
+// Type name or index argument of generate(), copied out under the GIL
+struct PatternKey {
+    std::string name;
+    Py_ssize_t index = 0;
+    bool by_index = false;
+};
+
+static bool parse_pattern_key(PyObject* type_id, PatternKey& key) {
+    if (PyUnicode_Check(type_id)) {
+        key.name = PyUnicode_AsUTF8(type_id);
+        return true;
+    }
+    if (PyLong_Check(type_id)) {
+        key.index = PyLong_AsSsize_t(type_id);
+        key.by_index = true;
+        return !PyErr_Occurred();
+    }
+    PyErr_SetString(PyExc_TypeError, "type_id must be a credential type name or index");
+    return false;
+}
+
+// Error recorded while the GIL is released and raised once it is reacquired
+struct PendingError {
+    PyObject* type = nullptr;
+    std::string message;
+    
+    bool set(PyObject* error_type, std::string error_message) {
+        type = error_type;
+        message = std::move(error_message);
+        return false;
+    }
+    
+    PyObject* raise() const {
+        PyErr_SetString(type, message.c_str());
+        return nullptr;
+    }
+};
+
+// Persistent generator shared by all entry points, so callers do not pay
+// for engine construction and seeding on every credential
+static std::unique_ptr<CredentialUtils> g_credential_utils = nullptr;
+
+// Guards g_credential_utils and g_pattern_registry. Generation runs with the
+// GIL released, so this is always taken outside the GIL and no Python API is
+// called while holding it.
+static std::mutex g_generator_mutex;
+
+static CredentialUtils& get_credential_utils() {
+    if (!g_credential_utils) {
+        g_credential_utils = std::make_unique<CredentialUtils>();
+    }
+    return *g_credential_utils;
+}
+
+// Applies a per-call RNG mode and restores the default afterwards
+class ScopedRngMode {
+public:
+    ScopedRngMode(CredentialUtils& u, RngMode mode) : utils(u) {
+        utils.use_mode(mode);
+    }
+    
+    ~ScopedRngMode() {
+        utils.use_mode(utils.get_default_mode());
+    }
+    
+private:
+    CredentialUtils& utils;
+};
+
+// Validate a per-call mode name under the GIL; the default it falls back to
+// is read later, under g_generator_mutex
+static bool check_rng_mode(const char* name) {
+    RngMode mode;
+    if (!parse_rng_mode(name, RngMode::FAST, mode)) {
+        PyErr_SetString(PyExc_ValueError, "RNG mode must be 'fast' or 'crypto'");
+        return false;
+    }
+    return true;
+}
+
+// Look up a compiled pattern in g_pattern_registry (caller holds
+// g_generator_mutex) or in a snapshot of it
+static const PatternRegistry::CompiledPattern* find_pattern(const PatternRegistry* registry, const PatternKey& key,
+                                                            PendingError& error) {
+    if (!registry) {
+        error.set(PyExc_RuntimeError, "Patterns not compiled; call compile_patterns() first");
+        return nullptr;
+    }
+    
+    const PatternRegistry::CompiledPattern* pattern = nullptr;
+    if (!key.by_index) {
+        pattern = registry->find(key.name);
+    } else if (key.index >= 0) {
+        pattern = registry->at(static_cast<size_t>(key.index));
+    }
+    
+    if (!pattern) {
+        error.set(PyExc_KeyError, "Unknown or uncompiled credential type");
+    }
+    return pattern;
+}
+
+// Append one credential of the given type, preferring compiled patterns
+// over the built-in generators
+static bool append_credential(CredentialUtils& utils, const std::string& credential_type, std::string& out) {
+    if (g_pattern_registry) {
+        const PatternRegistry::CompiledPattern* pattern = g_pattern_registry->find(credential_type);
+        if (pattern) {
+            utils.append_program(pattern->program, out);
+            return true;
+        }
+    }
+    return utils.append_builtin(credential_type, out);
+}
+
+// Python wrapper for FingerprintSet
+typedef struct {
+    PyObject_HEAD
+    FingerprintSet* set;
+} PyFingerprintSet;
+
+static PyTypeObject PyFingerprintSetType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+static int fingerprint_set_init(PyFingerprintSet* self, PyObject* args, PyObject* kwargs) {
+    static const char* kwlist[] = {"capacity", "bloom_bits", "name", nullptr};
+    Py_ssize_t capacity = 1 << 20;
+    unsigned int bloom_bits = 0;
+    const char* name = nullptr;
+    
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|nIz", const_cast<char**>(kwlist),
+                                     &capacity, &bloom_bits, &name)) {
+        return -1;
+    }
+    
+    if (capacity <= 0) {
+        PyErr_SetString(PyExc_ValueError, "Capacity must be positive");
+        return -1;
+    }
+    
+    std::unique_ptr<FingerprintSet> set;
+    if (name && *name) {
+        std::string error;
+        set = FingerprintSet::open_shared(name, static_cast<size_t>(capacity), bloom_bits, error);
+        if (!set) {
+            PyErr_SetString(PyExc_OSError, error.c_str());
+            return -1;
+        }
+    } else {
+        set = FingerprintSet::create_local(static_cast<size_t>(capacity), bloom_bits);
+    }
+    
+    delete self->set;
+    self->set = set.release();
+    return 0;
+}
+
+static void fingerprint_set_dealloc(PyFingerprintSet* self) {
+    delete self->set;
+    Py_TYPE(self)->tp_free(reinterpret_cast<PyObject*>(self));
+}
+
+// The set behind a Python object; FingerprintSet.__new__ without __init__
+// leaves none
+static FingerprintSet* fingerprint_set_get(PyFingerprintSet* self) {
+    if (!self->set) {
+        PyErr_SetString(PyExc_RuntimeError, "FingerprintSet not initialized");
+    }
+    return self->set;
+}
+
+static std::string fingerprint_set_full_message(const FingerprintSet& set) {
+    std::string reason = set.full_reason();
+    return reason.empty() ? "Fingerprint set is full" : "Fingerprint set is full: " + reason;
+}
+
+static PyObject* fingerprint_set_add(PyFingerprintSet* self, PyObject* args) {
+    PyObject* credential;
+    const char* data;
+    Py_ssize_t size;
+    
+    FingerprintSet* set = fingerprint_set_get(self);
+    if (!set || !PyArg_ParseTuple(args, "O", &credential) || !credential_bytes(credential, data, size)) {
+        return nullptr;
+    }
+    
+    auto result = set->insert(credential_fingerprint(data, static_cast<size_t>(size)));
+    if (result == FingerprintSet::InsertResult::FULL) {
+        PyErr_SetString(PyExc_RuntimeError, fingerprint_set_full_message(*set).c_str());
+        return nullptr;
+    }
+    return PyBool_FromLong(result == FingerprintSet::InsertResult::INSERTED);
+}
+
+static PyObject* fingerprint_set_update(PyFingerprintSet* self, PyObject* args) {
+    PyObject* iterable;
+    
+    FingerprintSet* set = fingerprint_set_get(self);
+    if (!set || !PyArg_ParseTuple(args, "O", &iterable)) {
+        return nullptr;
+    }
+    
+    PyObject* iter = PyObject_GetIter(iterable);
+    if (!iter) {
+        return nullptr;
+    }
+    
+    size_t inserted = 0;
+    PyObject* item;
+    while ((item = PyIter_Next(iter))) {
+        const char* data;
+        Py_ssize_t size;
+        bool ok = credential_bytes(item, data, size);
+        FingerprintSet::InsertResult result = FingerprintSet::InsertResult::FULL;
+        if (ok) {
+            result = set->insert(credential_fingerprint(data, static_cast<size_t>(size)));
+        }
+        Py_DECREF(item);
+        
+        if (!ok) {
+            Py_DECREF(iter);
+            return nullptr;
+        }
+        if (result == FingerprintSet::InsertResult::FULL) {
+            Py_DECREF(iter);
+            PyErr_SetString(PyExc_RuntimeError, fingerprint_set_full_message(*set).c_str());
+            return nullptr;
+        }
+        inserted += result == FingerprintSet::InsertResult::INSERTED;
+    }
+    Py_DECREF(iter);
+    
+    if (PyErr_Occurred()) {
+        return nullptr;
+    }
+    return PyLong_FromSize_t(inserted);
+}
+
+static PyObject* fingerprint_set_clear(PyFingerprintSet* self, PyObject* args) {
+    FingerprintSet* set = fingerprint_set_get(self);
+    if (!set) {
+        return nullptr;
+    }
+    set->clear();
+    Py_RETURN_NONE;
+}
+
+static PyObject* fingerprint_set_unlink(PyFingerprintSet* self, PyObject* args) {
+    FingerprintSet* set = fingerprint_set_get(self);
+    if (!set) {
+        return nullptr;
+    }
+    return PyBool_FromLong(set->unlink());
+}
+
+static PyObject* fingerprint_set_stats(PyFingerprintSet* self, PyObject* args) {
+    if (!fingerprint_set_get(self)) {
+        return nullptr;
+    }
+    const FingerprintSet& set = *self->set;
+    PyObject* stats = PyDict_New();
+    PyObject* name = set.is_shared() ? PyUnicode_FromString(set.get_shared_name().c_str()) : Py_NewRef(Py_None);
+    
+    PyDict_SetItemString(stats, "size", PyLong_FromSize_t(set.size()));
+    PyDict_SetItemString(stats, "capacity", PyLong_FromSize_t(set.capacity()));
+    PyDict_SetItemString(stats, "slots", PyLong_FromSize_t(set.slots_allocated()));
+    PyDict_SetItemString(stats, "memory_bytes",
+                         PyLong_FromSize_t(set.slots_allocated() * sizeof(uint64_t) + set.bloom_bytes()));
+    PyDict_SetItemString(stats, "bloom_bytes", PyLong_FromSize_t(set.bloom_bytes()));
+    PyDict_SetItemString(stats, "bloom_hashes", PyLong_FromUnsignedLong(set.get_bloom_hashes()));
+    PyDict_SetItemString(stats, "bloom_rejects", PyLong_FromUnsignedLongLong(set.get_bloom_rejects()));
+    PyDict_SetItemString(stats, "generations", PyLong_FromSize_t(set.generations()));
+    PyDict_SetItemString(stats, "shared_name", name);
+    Py_DECREF(name);
+    
+    return stats;
+}
+
+static Py_ssize_t fingerprint_set_len(PyFingerprintSet* self) {
+    FingerprintSet* set = fingerprint_set_get(self);
+    return set ? static_cast<Py_ssize_t>(set->size()) : -1;
+}
+
+static int fingerprint_set_contains(PyFingerprintSet* self, PyObject* credential) {
+    const char* data;
+    Py_ssize_t size;
+    
+    FingerprintSet* set = fingerprint_set_get(self);
+    if (!set || !credential_bytes(credential, data, size)) {
+        return -1;
+    }
+    return set->contains(credential_fingerprint(data, static_cast<size_t>(size))) ? 1 : 0;
+}
+
+static PyMethodDef FingerprintSetMethods[] = {
+    {"add", reinterpret_cast<PyCFunction>(fingerprint_set_add), METH_VARARGS, "Add a credential; returns False if it was already present"},
+    {"update", reinterpret_cast<PyCFunction>(fingerprint_set_update), METH_VARARGS, "Add credentials from an iterable; returns the number newly added"},
+    {"clear", reinterpret_cast<PyCFunction>(fingerprint_set_clear), METH_NOARGS, "Remove all fingerprints"},
+    {"unlink", reinterpret_cast<PyCFunction>(fingerprint_set_unlink), METH_NOARGS, "Remove the shared-memory names now (attached processes keep their mapping)"},
+    {"stats", reinterpret_cast<PyCFunction>(fingerprint_set_stats), METH_NOARGS, "Get size, capacity and memory statistics"},
+    {nullptr, nullptr, 0, nullptr}
+};
+
+static PySequenceMethods FingerprintSetSequence = {};
+
+static bool init_fingerprint_set_type() {
+    // Module exec runs once per interpreter; the static type is shared
+    if (PyFingerprintSetType.tp_flags & Py_TPFLAGS_READY) {
+        return true;
+    }
+    
+    FingerprintSetSequence.sq_length = reinterpret_cast<lenfunc>(fingerprint_set_len);
+    FingerprintSetSequence.sq_contains = reinterpret_cast<objobjproc>(fingerprint_set_contains);
+    
+    PyFingerprintSetType.tp_name = "credential_utils.FingerprintSet";
+    PyFingerprintSetType.tp_doc = "FingerprintSet(capacity=1048576, bloom_bits=0, name=None)\n\n"
+                                  "Concurrent set of 64-bit credential fingerprints. With a name the set lives in "
+                                  "POSIX shared memory and other processes attach to it by the same name; the "
+                                  "last process to release it removes the name.";
+    PyFingerprintSetType.tp_basicsize = sizeof(PyFingerprintSet);
+    PyFingerprintSetType.tp_flags = Py_TPFLAGS_DEFAULT;
+    PyFingerprintSetType.tp_new = PyType_GenericNew;
+    PyFingerprintSetType.tp_init = reinterpret_cast<initproc>(fingerprint_set_init);
+    PyFingerprintSetType.tp_dealloc = reinterpret_cast<destructor>(fingerprint_set_dealloc);
+    PyFingerprintSetType.tp_methods = FingerprintSetMethods;
+    PyFingerprintSetType.tp_as_sequence = &FingerprintSetSequence;
+    return PyType_Ready(&PyFingerprintSetType) == 0;
+}
+
+// Optional `unique` argument of the generate functions
+static bool resolve_unique_set(PyObject* obj, FingerprintSet*& set) {
+    set = nullptr;
+    if (!obj || obj == Py_None) {
+        return true;
+    }
+    if (!PyObject_TypeCheck(obj, &PyFingerprintSetType) || !reinterpret_cast<PyFingerprintSet*>(obj)->set) {
+        PyErr_SetString(PyExc_TypeError, "unique must be a FingerprintSet or None");
+        return false;
+    }
+    set = reinterpret_cast<PyFingerprintSet*>(obj)->set;
+    return true;
+}
+
+// Regenerate into `out` (from `start`) until the set accepts the credential
+static const int kUniqueAttempts = 64;
+
+template <typename Generate>
+static bool append_unique(FingerprintSet* unique, std::string& out, const std::string& type,
+                          PendingError& error, Generate generate) {
+    size_t start = out.size();
+    for (int attempt = 0; attempt < kUniqueAttempts; ++attempt) {
+        out.resize(start);
+        if (!generate(out)) {
+            return error.set(PyExc_ValueError, "Unsupported credential type: " + type);
+        }
+        if (!unique) {
+            return true;
+        }
+        
+        auto result = unique->insert(credential_fingerprint(out.data() + start, out.size() - start));
+        if (result == FingerprintSet::InsertResult::INSERTED) {
+            return true;
+        }
+        if (result == FingerprintSet::InsertResult::FULL) {
+            return error.set(PyExc_RuntimeError, fingerprint_set_full_message(*unique));
+        }
+    }
+    
+    return error.set(PyExc_RuntimeError, "Could not generate a unique " + type + " credential after " +
+                     std::to_string(kUniqueAttempts) + " attempts");
+}
+
+// Python C API functions
+static PyObject* generate_credential_cpp(PyObject* self, PyObject* args) {
+    const char* credential_type;
+    const char* pattern = nullptr;
+    PyObject* unique_obj = nullptr;
+    FingerprintSet* unique;
+    
+    if (!PyArg_ParseTuple(args, "s|zO", &credential_type, &pattern, &unique_obj) ||
+        !resolve_unique_set(unique_obj, unique)) {
+        return nullptr;
+    }
+    
+    std::string credential;
+    PendingError error;
+    bool ok;
+    
+    Py_BEGIN_ALLOW_THREADS
+    {
+        tracing::Span span(tracing::CREDENTIALS, "credentials.generate_one");
+        std::lock_guard<std::mutex> lock(g_generator_mutex);
+        CredentialUtils& utils = get_credential_utils();
+        
+        // Validate against pattern if provided, regenerating the same type
+        auto generate = [&](std::string& out) {
+            size_t start = out.size();
+            if (!utils.append_builtin(credential_type, out)) {
+                return false;
+            }
+            
+            const int max_attempts = 10;
+            for (int attempt = 0; pattern && attempt < max_attempts &&
+                 !CredentialUtils::validate_credential_pattern(out.substr(start), std::string(pattern)); ++attempt) {
+                out.resize(start);
+                utils.append_builtin(credential_type, out);
+            }
+            return true;
+        };
+        
+        ok = append_unique(unique, credential, credential_type, error, generate);
+    }
+    Py_END_ALLOW_THREADS
+    
+    if (!ok) {
+        return error.raise();
+    }
+    
+    return PyUnicode_FromStringAndSize(credential.data(), credential.size());
+}
+
+// Copy a credential type or a sequence of types out of Python
+static bool parse_credential_types(PyObject* types_obj, std::vector<std::string>& types) {
+    if (PyUnicode_Check(types_obj)) {
+        types.emplace_back(PyUnicode_AsUTF8(types_obj));
+        return true;
+    }
+    
+    PyObject* seq = PySequence_Fast(types_obj, "Expected a credential type or a sequence of types");
+    if (!seq) {
+        return false;
+    }
+    
+    Py_ssize_t n_types = PySequence_Fast_GET_SIZE(seq);
+    for (Py_ssize_t i = 0; i < n_types; ++i) {
+        PyObject* item = PySequence_Fast_GET_ITEM(seq, i);
+        if (!PyUnicode_Check(item)) {
+            Py_DECREF(seq);
+            PyErr_SetString(PyExc_TypeError, "All credential types must be strings");
+            return false;
+        }
+        types.emplace_back(PyUnicode_AsUTF8(item));
+    }
+    Py_DECREF(seq);
+    return true;
+}
+
+// Generate count credentials per type into one contiguous buffer, with
+// offsets[i]..offsets[i + 1] delimiting each. Runs without the GIL.
+template <typename Offsets>
+static bool generate_types_into(const std::vector<std::string>& types, Py_ssize_t count,
+                                const char* mode_name, FingerprintSet* unique,
+                                std::string& buffer, Offsets& offsets, PendingError& error) {
+    tracing::Span span(tracing::CREDENTIALS, "credentials.generate_batch", static_cast<int64_t>(types.size() * count));
+    bool ok = true;
+    offsets.reserve(types.size() * count + 1);
+    buffer.reserve(types.size() * count * 48);
+    offsets.push_back(0);
+    
+    std::lock_guard<std::mutex> lock(g_generator_mutex);
+    CredentialUtils& utils = get_credential_utils();
+    RngMode mode;
+    parse_rng_mode(mode_name, utils.get_default_mode(), mode);
+    ScopedRngMode scoped_mode(utils, mode);
+    
+    for (size_t t = 0; ok && t < types.size(); ++t) {
+        const std::string& type = types[t];
+        for (Py_ssize_t i = 0; ok && i < count; ++i) {
+            ok = append_unique(unique, buffer, type, error, [&](std::string& out) {
+                return append_credential(utils, type, out);
+            });
+            offsets.push_back(buffer.size());
+        }
+    }
+    return ok;
+}
+
+// As generate_types_into, for one compiled pattern
+template <typename Offsets>
+static bool generate_pattern_into(const PatternKey& key, Py_ssize_t count,
+                                  const char* mode_name, FingerprintSet* unique,
+                                  std::string& buffer, Offsets& offsets, PendingError& error) {
+    tracing::Span span(tracing::CREDENTIALS, "credentials.generate_pattern", count);
+    offsets.reserve(count + 1);
+    offsets.push_back(0);
+    
+    std::lock_guard<std::mutex> lock(g_generator_mutex);
+    const PatternRegistry::CompiledPattern* pattern = find_pattern(g_pattern_registry.get(), key, error);
+    if (!pattern) {
+        return false;
+    }
+    
+    CredentialUtils& utils = get_credential_utils();
+    RngMode mode;
+    parse_rng_mode(mode_name, utils.get_default_mode(), mode);
+    ScopedRngMode scoped_mode(utils, mode);
+    
+    bool ok = true;
+    for (Py_ssize_t i = 0; ok && i < count; ++i) {
+        ok = append_unique(unique, buffer, pattern->type, error, [&](std::string& out) {
+            utils.append_program(pattern->program, out);
+            return true;
+        });
+        offsets.push_back(buffer.size());
+    }
+    return ok;
+}
+
+namespace credential_generate {
+
+bool supported(const std::string& type) {
+    std::lock_guard<std::mutex> lock(g_generator_mutex);
+    return (g_pattern_registry && g_pattern_registry->find(type)) || CredentialUtils::has_builtin(type);
+}
+
+bool unique_set(PyObject* obj, FingerprintSet*& set) {
+    return resolve_unique_set(obj, set);
+}
+
+bool generate(const std::vector<std::string>& types, size_t rounds, FingerprintSet* unique,
+              std::string& buffer, std::vector<uint64_t>& offsets,
+              PyObject*& error_type, std::string& error) {
+    tracing::Span span(tracing::CREDENTIALS, "credentials.generate", static_cast<int64_t>(types.size() * rounds));
+    offsets.reserve(offsets.size() + types.size() * rounds + 1);
+    offsets.push_back(buffer.size());
+    
+    std::lock_guard<std::mutex> lock(g_generator_mutex);
+    CredentialUtils& utils = get_credential_utils();
+    ScopedRngMode scoped_mode(utils, utils.get_default_mode());
+    
+    PendingError pending;
+    for (size_t r = 0; r < rounds; ++r) {
+        for (const std::string& type : types) {
+            if (!append_unique(unique, buffer, type, pending, [&](std::string& out) {
+                    return append_credential(utils, type, out);
+                })) {
+                error_type = pending.type;
+                error = pending.message;
+                return false;
+            }
+            offsets.push_back(buffer.size());
+        }
+    }
+    return true;
+}
+
+}  // namespace credential_generate
+
+// Hand a generated batch to Python without slicing it into strings
+static PyObject* buffer_pair(std::string&& buffer, std::vector<uint64_t>&& offsets) {
+    PyObject* data = native_buffer::from_string(std::move(buffer));
+    if (!data) {
+        return nullptr;
+    }
+    PyObject* bounds = native_buffer::from_offsets(std::move(offsets));
+    if (!bounds) {
+        Py_DECREF(data);
+        return nullptr;
+    }
+    return Py_BuildValue("(NN)", data, bounds);
+}
+
+static PyObject* generate_batch_cpp(PyObject* self, PyObject* args) {
+    PyObject* types_obj;
+    Py_ssize_t count = 1;
+    int as_dict = 0;
+    const char* mode_name = nullptr;
+    PyObject* unique_obj = nullptr;
+    FingerprintSet* unique;
+    
+    if (!PyArg_ParseTuple(args, "O|npzO", &types_obj, &count, &as_dict, &mode_name, &unique_obj) ||
+        !resolve_unique_set(unique_obj, unique)) {
+        return nullptr;
+    }
+    
+    if (!check_rng_mode(mode_name)) {
+        return nullptr;
+    }
+    
+    if (count < 0) {
+        PyErr_SetString(PyExc_ValueError, "Count must be non-negative");
+        return nullptr;
+    }
+    
+    std::vector<std::string> types;
+    if (!parse_credential_types(types_obj, types)) {
+        return nullptr;
+    }
+    
+    // Generate everything into one contiguous buffer, recording offsets in
+    // scratch from this thread's arena
+    memory_arena::Scope scratch;
+    std::string buffer;
+    memory_arena::ArenaVector<size_t> offsets{memory_arena::ArenaAllocator<size_t>(scratch.arena())};
+    PendingError error;
+    bool ok;
+    
+    Py_BEGIN_ALLOW_THREADS
+    ok = generate_types_into(types, count, mode_name, unique, buffer, offsets, error);
+    Py_END_ALLOW_THREADS
+    
+    if (!ok) {
+        return error.raise();
+    }
+    
+    // Slice the buffer into Python strings in a single pass
+    PyObject* result = as_dict ? PyDict_New() : PyList_New(types.size() * count);
+    size_t slot = 0;
+    for (const auto& type : types) {
+        PyObject* type_list = as_dict ? PyList_New(count) : nullptr;
+        for (Py_ssize_t i = 0; i < count; ++i, ++slot) {
+            PyObject* credential = PyUnicode_FromStringAndSize(
+                buffer.data() + offsets[slot], offsets[slot + 1] - offsets[slot]);
+            if (as_dict) {
+                PyList_SET_ITEM(type_list, i, credential);
+            } else {
+                PyList_SET_ITEM(result, slot, credential);
+            }
+        }
+        if (as_dict) {
+            // A type listed twice gets all of its credentials under one key
+            PyObject* existing = PyDict_GetItemString(result, type.c_str());
+            if (existing) {
+                Py_ssize_t end = PyList_GET_SIZE(existing);
+                PyList_SetSlice(existing, end, end, type_list);
+            } else {
+                PyDict_SetItemString(result, type.c_str(), type_list);
+            }
+            Py_DECREF(type_list);
+        }
+    }
+    
+    return result;
+}
+
+static PyObject* generate_batch_buffer_cpp(PyObject* self, PyObject* args) {
+    PyObject* types_obj;
+    Py_ssize_t count = 1;
+    const char* mode_name = nullptr;
+    PyObject* unique_obj = nullptr;
+    FingerprintSet* unique;
+    
+    if (!PyArg_ParseTuple(args, "O|nzO", &types_obj, &count, &mode_name, &unique_obj) ||
+        !resolve_unique_set(unique_obj, unique)) {
+        return nullptr;
+    }
+    
+    if (!check_rng_mode(mode_name)) {
+        return nullptr;
+    }
+    
+    if (count < 0) {
+        PyErr_SetString(PyExc_ValueError, "Count must be non-negative");
+        return nullptr;
+    }
+    
+    std::vector<std::string> types;
+    if (!parse_credential_types(types_obj, types)) {
+        return nullptr;
+    }
+    
+    // The buffer and offsets move into the returned objects as they are
+    std::string buffer;
+    std::vector<uint64_t> offsets;
+    PendingError error;
+    bool ok;
+    
+    Py_BEGIN_ALLOW_THREADS
+    ok = generate_types_into(types, count, mode_name, unique, buffer, offsets, error);
+    Py_END_ALLOW_THREADS
+    
+    if (!ok) {
+        return error.raise();
+    }
+    return buffer_pair(std::move(buffer), std::move(offsets));
+}
+
+static PyObject* validate_credential_cpp(PyObject* self, PyObject* args) {
+    const char* credential;
+    const char* pattern;
+    
+    if (!PyArg_ParseTuple(args, "ss", &credential, &pattern)) {
+        return nullptr;
+    }
+    
+    bool is_valid;
+    Py_BEGIN_ALLOW_THREADS
+    is_valid = CredentialUtils::validate_credential_pattern(std::string(credential), std::string(pattern));
+    Py_END_ALLOW_THREADS
+    
+    return PyBool_FromLong(is_valid ? 1 : 0);
+}
+
+// Registry snapshot for validation and scans, which run without
+// g_generator_mutex so they do not hold up generation
+static std::shared_ptr<const PatternRegistry> current_registry() {
+    std::lock_guard<std::mutex> lock(g_generator_mutex);
+    return g_pattern_registry;
+}
+
+namespace credential_scan {
+
+std::shared_ptr<const PatternRegistry> patterns() {
+    return current_registry();
+}
+
+size_t count(const PatternRegistry& patterns) {
+    return patterns.all().size();
+}
+
+const std::string& type_name(const PatternRegistry& patterns, size_t index) {
+    return patterns.all()[index].type;
+}
+
+long find(const PatternRegistry& patterns, const std::string& type) {
+    const PatternRegistry::CompiledPattern* pattern = patterns.find(type);
+    return pattern ? static_cast<long>(patterns.position(pattern)) : -1;
+}
+
+bool scannable(const PatternRegistry& patterns, size_t index) {
+    return patterns.scanner().scannable(index);
+}
+
+void scan(const PatternRegistry& patterns, const uint8_t* data, size_t n,
+          const std::vector<bool>& selected, Matches& matches) {
+    patterns.scanner().scan(data, n, selected, matches);
+}
+
+}  // namespace credential_scan
+
+// A credential type or a sequence of them (names or indices)
+static bool parse_pattern_keys(PyObject* obj, std::vector<PatternKey>& keys) {
+    if (PyUnicode_Check(obj) || PyLong_Check(obj)) {
+        keys.emplace_back();
+        return parse_pattern_key(obj, keys.back());
+    }
+    
+    PyObject* seq = PySequence_Fast(obj, "types must be a credential type or a sequence of types");
+    if (!seq) {
+        return false;
+    }
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    keys.resize(n);
+    for (Py_ssize_t i = 0; i < n; ++i) {
+        if (!parse_pattern_key(PySequence_Fast_GET_ITEM(seq, i), keys[i])) {
+            Py_DECREF(seq);
+            return false;
+        }
+    }
+    Py_DECREF(seq);
+    return true;
+}
+
+// Registry positions of `keys`, each of which must be scannable when `scan` is set
+static bool resolve_patterns(const PatternRegistry* registry, const std::vector<PatternKey>& keys, bool scan,
+                             std::vector<size_t>& positions, PendingError& error) {
+    positions.clear();
+    for (const PatternKey& key : keys) {
+        const PatternRegistry::CompiledPattern* pattern = find_pattern(registry, key, error);
+        if (!pattern) {
+            return false;
+        }
+        size_t position = registry->position(pattern);
+        if (scan && !registry->scanner().scannable(position)) {
+            return error.set(PyExc_ValueError, "Credential type '" + pattern->type + "' is too large to scan for");
+        }
+        positions.push_back(position);
+    }
+    return true;
+}
+
+// Document to scan: str (as UTF-8; offsets are byte offsets) or any
+// bytes-like object (bytes, NativeBuffer, mmap, memoryview)
+class DocumentView {
+public:
+    DocumentView() = default;
+    DocumentView(const DocumentView&) = delete;
+    DocumentView& operator=(const DocumentView&) = delete;
+    
+    ~DocumentView() {
+        if (view.obj) {
+            PyBuffer_Release(&view);
+        }
+    }
+    
+    bool parse(PyObject* document) {
+        if (PyUnicode_Check(document)) {
+            Py_ssize_t n;
+            const char* utf8 = PyUnicode_AsUTF8AndSize(document, &n);
+            if (!utf8) {
+                return false;
+            }
+            data = reinterpret_cast<const uint8_t*>(utf8);
+            size = static_cast<size_t>(n);
+            return true;
+        }
+        if (PyObject_GetBuffer(document, &view, PyBUF_SIMPLE) < 0) {
+            return false;
+        }
+        data = static_cast<const uint8_t*>(view.buf);
+        size = static_cast<size_t>(view.len);
+        return true;
+    }
+    
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    
+private:
+    Py_buffer view = {};
+};
+
+// Read-only view of a file to scan: mapped where mmap is available so the
+// scan runs at page-cache speed, read into memory otherwise
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    
+    ~MappedFile() {
+#ifndef _WIN32
+        if (mapping) {
+            munmap(mapping, size);
+        }
+#endif
+    }
+    
+    bool open(const std::string& path, PendingError& error) {
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return error.set(PyExc_OSError, "Cannot open " + path + ": " + std::strerror(errno));
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            int err = errno;
+            ::close(fd);
+            return error.set(PyExc_OSError, "Cannot stat " + path + ": " + std::strerror(err));
+        }
+        size = static_cast<size_t>(st.st_size);
+        if (size > 0) {
+            void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                int err = errno;
+                ::close(fd);
+                return error.set(PyExc_OSError, "Cannot map " + path + ": " + std::strerror(err));
+            }
+            madvise(p, size, MADV_SEQUENTIAL);
+            mapping = p;
+            data = static_cast<const uint8_t*>(p);
+        }
+        ::close(fd);
+        return true;
+#else
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            return error.set(PyExc_OSError, "Cannot open " + path);
+        }
+        contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        data = reinterpret_cast<const uint8_t*>(contents.data());
+        size = contents.size();
+        return true;
+#endif
+    }
+    
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    
+private:
+#ifndef _WIN32
+    void* mapping = nullptr;
+#else
+    std::string contents;
+#endif
+};
+
+// Scan selection from the optional `types` argument; empty selects all
+static bool select_patterns(const PatternRegistry* registry, const std::vector<PatternKey>& keys,
+                            std::vector<bool>& selected, PendingError& error) {
+    if (!registry) {
+        return error.set(PyExc_RuntimeError, "Patterns not compiled; call compile_patterns() first");
+    }
+    std::vector<size_t> positions;
+    if (!resolve_patterns(registry, keys, true, positions, error)) {
+        return false;
+    }
+    selected.assign(positions.empty() ? 0 : registry->all().size(), false);
+    for (size_t p : positions) {
+        selected[p] = true;
+    }
+    return true;
+}
+
+static PyObject* matches_dict(const PatternRegistry& registry, const PatternScanner::Matches& matches) {
+    PyObject* result = PyDict_New();
+    for (size_t p = 0; p < matches.size(); ++p) {
+        if (matches[p].empty()) {
+            continue;
+        }
+        PyObject* spans = PyList_New(matches[p].size());
+        for (size_t i = 0; i < matches[p].size(); ++i) {
+            PyList_SET_ITEM(spans, i, Py_BuildValue("(nn)", static_cast<Py_ssize_t>(matches[p][i].first),
+                                                    static_cast<Py_ssize_t>(matches[p][i].second)));
+        }
+        PyDict_SetItemString(result, registry.all()[p].type.c_str(), spans);
+        Py_DECREF(spans);
+    }
+    return result;
+}
+
+// Outcome of checking a document against the credentials embedded in it
+struct VerifyReport {
+    size_t matched = 0;
+    std::vector<std::pair<size_t, std::string>> missing;            // (pattern, credential)
+    std::vector<std::pair<size_t, std::pair<size_t, size_t>>> unexpected;  // (pattern, (start, end))
+};
+
+// Every expected credential must be found as a match of its type, and every
+// match of an expected type must be expected. A match equal to a credential
+// expected under another type is an overlapping pattern and is ignored.
+static void compare_matches(const uint8_t* data, const std::vector<std::pair<size_t, std::string>>& expected,
+                            const PatternScanner::Matches& matches, VerifyReport& report) {
+    std::unordered_map<size_t, std::unordered_map<std::string_view, size_t>> remaining;
+    std::unordered_set<std::string_view> any_type;
+    for (const auto& entry : expected) {
+        remaining[entry.first][entry.second]++;
+        any_type.insert(entry.second);
+    }
+    
+    for (auto& type : remaining) {
+        auto& counts = type.second;
+        for (const auto& span : matches[type.first]) {
+            std::string_view text(reinterpret_cast<const char*>(data) + span.first, span.second - span.first);
+            auto it = counts.find(text);
+            if (it != counts.end() && it->second > 0) {
+                it->second--;
+                report.matched++;
+            } else if (it != counts.end() || !any_type.count(text)) {
+                report.unexpected.emplace_back(type.first, span);
+            }
+        }
+    }
+    
+    for (const auto& entry : expected) {
+        size_t& count = remaining[entry.first][entry.second];
+        if (count > 0) {
+            count--;
+            report.missing.emplace_back(entry.first, entry.second);
+        }
+    }
+}
+
+// Expected credentials: {type: credentials} or an iterable of (type, credential)
+static bool parse_expected(PyObject* obj, std::vector<std::pair<PatternKey, std::string>>& expected) {
+    auto add = [&](PyObject* type_id, PyObject* credential) {
+        const char* data;
+        Py_ssize_t size;
+        PatternKey key;
+        if (!parse_pattern_key(type_id, key) || !credential_bytes(credential, data, size)) {
+            return false;
+        }
+        expected.emplace_back(std::move(key), std::string(data, size));
+        return true;
+    };
+    
+    if (PyDict_Check(obj)) {
+        PyObject* type_id;
+        PyObject* credentials;
+        Py_ssize_t pos = 0;
+        while (PyDict_Next(obj, &pos, &type_id, &credentials)) {
+            if (PyUnicode_Check(credentials) || PyBytes_Check(credentials)) {
+                if (!add(type_id, credentials)) {
+                    return false;
+                }
+                continue;
+            }
+            PyObject* seq = PySequence_Fast(credentials, "expected credentials must be str, bytes or a sequence of them");
+            if (!seq) {
+                return false;
+            }
+            for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(seq); ++i) {
+                if (!add(type_id, PySequence_Fast_GET_ITEM(seq, i))) {
+                    Py_DECREF(seq);
+                    return false;
+                }
+            }
+            Py_DECREF(seq);
+        }
+        return true;
+    }
+    
+    PyObject* seq = PySequence_Fast(obj, "expected must be a dict or a sequence of (type, credential) pairs");
+    if (!seq) {
+        return false;
+    }
+    for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(seq); ++i) {
+        PyObject* item = PySequence_Fast_GET_ITEM(seq, i);
+        if (!PyTuple_Check(item) || PyTuple_GET_SIZE(item) != 2) {
+            Py_DECREF(seq);
+            PyErr_SetString(PyExc_TypeError, "expected items must be (type, credential) pairs");
+            return false;
+        }
+        if (!add(PyTuple_GET_ITEM(item, 0), PyTuple_GET_ITEM(item, 1))) {
+            Py_DECREF(seq);
+            return false;
+        }
+    }
+    Py_DECREF(seq);
+    return true;
+}
+
+// Scan for the expected credentials' types only and compare
+static bool verify_document(const PatternRegistry* registry, const uint8_t* data, size_t size,
+                            const std::vector<std::pair<PatternKey, std::string>>& expected,
+                            VerifyReport& report, PendingError& error) {
+    std::vector<PatternKey> keys;
+    for (const auto& entry : expected) {
+        keys.push_back(entry.first);
+    }
+    if (!registry) {
+        return error.set(PyExc_RuntimeError, "Patterns not compiled; call compile_patterns() first");
+    }
+    std::vector<size_t> positions;
+    if (!resolve_patterns(registry, keys, true, positions, error)) {
+        return false;
+    }
+    
+    std::vector<bool> selected(registry->all().size(), false);
+    std::vector<std::pair<size_t, std::string>> resolved;
+    for (size_t i = 0; i < expected.size(); ++i) {
+        selected[positions[i]] = true;
+        resolved.emplace_back(positions[i], expected[i].second);
+    }
+    
+    PatternScanner::Matches matches;
+    if (!resolved.empty()) {
+        registry->scanner().scan(data, size, selected, matches);
+    }
+    compare_matches(data, resolved, matches, report);
+    return true;
+}
+
+static PyObject* report_dict(const PatternRegistry& registry, const uint8_t* data, const VerifyReport& report) {
+    PyObject* missing = PyList_New(report.missing.size());
+    for (size_t i = 0; i < report.missing.size(); ++i) {
+        const auto& entry = report.missing[i];
+        PyList_SET_ITEM(missing, i, Py_BuildValue("(ss#)", registry.all()[entry.first].type.c_str(),
+                                                  entry.second.data(), static_cast<Py_ssize_t>(entry.second.size())));
+    }
+    
+    PyObject* unexpected = PyList_New(report.unexpected.size());
+    for (size_t i = 0; i < report.unexpected.size(); ++i) {
+        const auto& entry = report.unexpected[i];
+        size_t start = entry.second.first;
+        PyObject* text = PyUnicode_DecodeUTF8(reinterpret_cast<const char*>(data) + start,
+                                              static_cast<Py_ssize_t>(entry.second.second - start), "replace");
+        PyList_SET_ITEM(unexpected, i, Py_BuildValue("(sNn)", registry.all()[entry.first].type.c_str(),
+                                                     text, static_cast<Py_ssize_t>(start)));
+    }
+    
+    return Py_BuildValue("{s:O,s:n,s:N,s:N}",
+                         "ok", report.missing.empty() && report.unexpected.empty() ? Py_True : Py_False,
+                         "matched", static_cast<Py_ssize_t>(report.matched),
+                         "missing", missing,
+                         "unexpected", unexpected);
+}
+
+static PyObject* validate_batch_cpp(PyObject* self, PyObject* args) {
+    PyObject* types_obj;
+    PyObject* credentials_obj;
+    PyObject* offsets_obj = nullptr;
+    
+    if (!PyArg_ParseTuple(args, "OO|O", &types_obj, &credentials_obj, &offsets_obj)) {
+        return nullptr;
+    }
+    
+    std::vector<PatternKey> keys;
+    CredentialViews credentials;
+    if (!parse_pattern_keys(types_obj, keys) || !credentials.parse(credentials_obj, offsets_obj)) {
+        return nullptr;
+    }
+    if (keys.size() != 1 && keys.size() != credentials.size()) {
+        PyErr_SetString(PyExc_ValueError, "types must be one type or one per credential");
+        return nullptr;
+    }
+    
+    std::vector<uint8_t> valid(credentials.size(), 0);
+    PendingError error;
+    bool ok;
+    
+    Py_BEGIN_ALLOW_THREADS
+    std::shared_ptr<const PatternRegistry> registry = current_registry();
+    std::vector<size_t> positions;
+    ok = resolve_patterns(registry.get(), keys, false, positions, error);
+    for (size_t i = 0; ok && i < credentials.size(); ++i) {
+        const PatternMatcher& matcher = registry->all()[positions[positions.size() == 1 ? 0 : i]].matcher;
+        valid[i] = matcher.matches(credentials[i].first, static_cast<size_t>(credentials[i].second)) ? 1 : 0;
+    }
+    Py_END_ALLOW_THREADS
+    
+    if (!ok) {
+        return error.raise();
+    }
+    
+    PyObject* result_list = PyList_New(valid.size());
+    for (size_t i = 0; i < valid.size(); ++i) {
+        PyList_SET_ITEM(result_list, i, PyBool_FromLong(valid[i]));
+    }
+    return result_list;
+}
+
+static PyObject* scan_cpp(PyObject* self, PyObject* args) {
+    PyObject* document_obj;
+    PyObject* types_obj = Py_None;
+    
+    if (!PyArg_ParseTuple(args, "O|O", &document_obj, &types_obj)) {
+        return nullptr;
+    }
+    
+    std::vector<PatternKey> keys;
+    DocumentView document;
+    if ((types_obj != Py_None && !parse_pattern_keys(types_obj, keys)) || !document.parse(document_obj)) {
+        return nullptr;
+    }
+    
+    std::shared_ptr<const PatternRegistry> registry;
+    PatternScanner::Matches matches;
+    PendingError error;
+    bool ok;
+    
+    Py_BEGIN_ALLOW_THREADS
+    registry = current_registry();
+    std::vector<bool> selected;
+    ok = select_patterns(registry.get(), keys, selected, error);
+    if (ok) {
+        registry->scanner().scan(document.data, document.size, selected, matches);
+    }
+    Py_END_ALLOW_THREADS
+    
+    if (!ok) {
+        return error.raise();
+    }
+    return matches_dict(*registry, matches);
+}
+
+static PyObject* scan_file_cpp(PyObject* self, PyObject* args) {
+    PyObject* path_obj;
+    PyObject* types_obj = Py_None;
+    
+    if (!PyArg_ParseTuple(args, "O&|O", PyUnicode_FSConverter, &path_obj, &types_obj)) {
+        return nullptr;
+    }
+    std::string path(PyBytes_AS_STRING(path_obj), PyBytes_GET_SIZE(path_obj));
+    Py_DECREF(path_obj);
+    
+    std::vector<PatternKey> keys;
+    if (types_obj != Py_None && !parse_pattern_keys(types_obj, keys)) {
+        return nullptr;
+    }
+    
+    std::shared_ptr<const PatternRegistry> registry;
+    PatternScanner::Matches matches;
+    PendingError error;
+    bool ok;
+    
+    Py_BEGIN_ALLOW_THREADS
+    registry = current_registry();
+    std::vector<bool> selected;
+    MappedFile file;
+    ok = select_patterns(registry.get(), keys, selected, error) && file.open(path, error);
+    if (ok) {
+        registry->scanner().scan(file.data, file.size, selected, matches);
+    }
+    Py_END_ALLOW_THREADS
+    
+    if (!ok) {
+        return error.raise();
+    }
+    return matches_dict(*registry, matches);
+}
+
+static PyObject* verify_cpp(PyObject* self, PyObject* args) {
+    PyObject* document_obj;
+    PyObject* expected_obj;
+    
+    if (!PyArg_ParseTuple(args, "OO", &document_obj, &expected_obj)) {
+        return nullptr;
+    }
+    
+    std::vector<std::pair<PatternKey, std::string>> expected;
+    DocumentView document;
+    if (!parse_expected(expected_obj, expected) || !document.parse(document_obj)) {
+        return nullptr;
+    }
+    
+    std::shared_ptr<const PatternRegistry> registry;
+    VerifyReport report;
+    PendingError error;
+    bool ok;
+    
+    Py_BEGIN_ALLOW_THREADS
+    registry = current_registry();
+    ok = verify_document(registry.get(), document.data, document.size, expected, report, error);
+    Py_END_ALLOW_THREADS
+    
+    if (!ok) {
+        return error.raise();
+    }
+    return report_dict(*registry, document.data, report);
+}
+
+static PyObject* verify_file_cpp(PyObject* self, PyObject* args) {
+    PyObject* path_obj;
+    PyObject* expected_obj;
+    
+    if (!PyArg_ParseTuple(args, "O&O", PyUnicode_FSConverter, &path_obj, &expected_obj)) {
+        return nullptr;
+    }
+    std::string path(PyBytes_AS_STRING(path_obj), PyBytes_GET_SIZE(path_obj));
+    Py_DECREF(path_obj);
+    
+    std::vector<std::pair<PatternKey, std::string>> expected;
+    if (!parse_expected(expected_obj, expected)) {
+        return nullptr;
+    }
+    
+    std::shared_ptr<const PatternRegistry> registry;
+    MappedFile file;
+    VerifyReport report;
+    PendingError error;
+    bool ok;
+    
+    Py_BEGIN_ALLOW_THREADS
+    registry = current_registry();
+    ok = file.open(path, error) && verify_document(registry.get(), file.data, file.size, expected, report, error);
+    Py_END_ALLOW_THREADS
+    
+    if (!ok) {
+        return error.raise();
+    }
+    return report_dict(*registry, file.data, report);
+}
+
+static PyObject* compile_patterns_cpp(PyObject* self, PyObject* args) {
+    const char* db_path;
+    
+    if (!PyArg_ParseTuple(args, "s", &db_path)) {
+        return nullptr;
+    }
+    
+    std::vector<std::pair<std::string, std::string>> entries;
+    if (!load_regex_db_entries(db_path, entries)) {
+        return nullptr;
+    }
+    
+    // Compile outside the GIL; generators keep using the old registry until the swap
+    size_t compiled;
+    Py_BEGIN_ALLOW_THREADS
+    auto registry = std::make_shared<PatternRegistry>();
+    compiled = registry->compile(entries);
+    {
+        std::lock_guard<std::mutex> lock(g_generator_mutex);
+        g_pattern_registry.swap(registry);
+    }
+    Py_END_ALLOW_THREADS
+    
+    return PyLong_FromSize_t(compiled);
+}
+
+static PyObject* generate_cpp(PyObject* self, PyObject* args) {
+    PyObject* type_id;
+    Py_ssize_t count = 1;
+    const char* mode_name = nullptr;
+    PyObject* unique_obj = nullptr;
+    FingerprintSet* unique;
+    
+    if (!PyArg_ParseTuple(args, "O|nzO", &type_id, &count, &mode_name, &unique_obj) ||
+        !resolve_unique_set(unique_obj, unique)) {
+        return nullptr;
+    }
+    
+    PatternKey key;
+    if (!check_rng_mode(mode_name) || !parse_pattern_key(type_id, key)) {
+        return nullptr;
+    }
+    
+    if (count < 0) {
+        PyErr_SetString(PyExc_ValueError, "Count must be non-negative");
+        return nullptr;
+    }
+    
+    memory_arena::Scope scratch;
+    std::string buffer;
+    memory_arena::ArenaVector<size_t> offsets{memory_arena::ArenaAllocator<size_t>(scratch.arena())};
+    PendingError error;
+    bool ok;
+    
+    Py_BEGIN_ALLOW_THREADS
+    ok = generate_pattern_into(key, count, mode_name, unique, buffer, offsets, error);
+    Py_END_ALLOW_THREADS
+    
+    if (!ok) {
+        return error.raise();
+    }
+    
+    PyObject* result_list = PyList_New(count);
+    for (Py_ssize_t i = 0; i < count; ++i) {
+        PyList_SET_ITEM(result_list, i, PyUnicode_FromStringAndSize(
+            buffer.data() + offsets[i], offsets[i + 1] - offsets[i]));
+    }
+    
+    return result_list;
+}
+
+static PyObject* generate_buffer_cpp(PyObject* self, PyObject* args) {
+    PyObject* type_id;
+    Py_ssize_t count = 1;
+    const char* mode_name = nullptr;
+    PyObject* unique_obj = nullptr;
+    FingerprintSet* unique;
+    
+    if (!PyArg_ParseTuple(args, "O|nzO", &type_id, &count, &mode_name, &unique_obj) ||
+        !resolve_unique_set(unique_obj, unique)) {
+        return nullptr;
+    }
+    
+    PatternKey key;
+    if (!check_rng_mode(mode_name) || !parse_pattern_key(type_id, key)) {
+        return nullptr;
+    }
+    
+    if (count < 0) {
+        PyErr_SetString(PyExc_ValueError, "Count must be non-negative");
+        return nullptr;
+    }
+    
+    std::string buffer;
+    std::vector<uint64_t> offsets;
+    PendingError error;
+    bool ok;
+    
+    Py_BEGIN_ALLOW_THREADS
+    ok = generate_pattern_into(key, count, mode_name, unique, buffer, offsets, error);
+    Py_END_ALLOW_THREADS
+    
+    if (!ok) {
+        return error.raise();
+    }
+    return buffer_pair(std::move(buffer), std::move(offsets));
+}
+
+static PyObject* get_compiled_types_cpp(PyObject* self, PyObject* args) {
+    std::vector<std::string> types;
+    Py_BEGIN_ALLOW_THREADS
+    {
+        std::lock_guard<std::mutex> lock(g_generator_mutex);
+        if (g_pattern_registry) {
+            for (const auto& pattern : g_pattern_registry->all()) {
+                types.push_back(pattern.type);
+            }
+        }
+    }
+    Py_END_ALLOW_THREADS
+    
+    PyObject* result_list = PyList_New(types.size());
+    for (size_t i = 0; i < types.size(); ++i) {
+        PyList_SetItem(result_list, i, PyUnicode_FromString(types[i].c_str()));
+    }
+    
+    return result_list;
+}
+
+static PyObject* seed_cpp(PyObject* self, PyObject* args) {
+    unsigned long long seed;
+    
+    if (!PyArg_ParseTuple(args, "K", &seed)) {
+        return nullptr;
+    }
+    
+    Py_BEGIN_ALLOW_THREADS
+    {
+        std::lock_guard<std::mutex> lock(g_generator_mutex);
+        get_credential_utils().reseed(seed);
+    }
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
+
+static PyObject* set_rng_mode_cpp(PyObject* self, PyObject* args) {
+    const char* mode_name;
+    
+    if (!PyArg_ParseTuple(args, "s", &mode_name)) {
+        return nullptr;
+    }
+    
+    RngMode mode;
+    if (!check_rng_mode(mode_name)) {
+        return nullptr;
+    }
+    parse_rng_mode(mode_name, RngMode::FAST, mode);
+    
+    Py_BEGIN_ALLOW_THREADS
+    {
+        std::lock_guard<std::mutex> lock(g_generator_mutex);
+        get_credential_utils().set_default_mode(mode);
+    }
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef CredentialMethods[] = {
+    {"generate_credential", generate_credential_cpp, METH_VARARGS, "Generate credential using C++"},
+    {"validate_credential", validate_credential_cpp, METH_VARARGS, "Validate credential against pattern"},
+    {"validate_batch", validate_batch_cpp, METH_VARARGS, "Validate credentials against compiled types (one type or one per credential); credentials may be (data, offsets) from generate_batch_buffer"},
+    {"scan", scan_cpp, METH_VARARGS, "Find compiled credential types in a str or bytes-like document; returns {type: [(start, end), ...]} in byte offsets"},
+    {"scan_file", scan_file_cpp, METH_VARARGS, "As scan, for a file read through mmap"},
+    {"verify", verify_cpp, METH_VARARGS, "Check that a document contains exactly the expected {type: credentials}; returns ok, matched, missing and unexpected"},
+    {"verify_file", verify_file_cpp, METH_VARARGS, "As verify, for a file read through mmap"},
+    {"generate_batch", generate_batch_cpp, METH_VARARGS, "Generate count credentials per type as one list (or dict keyed by type, merging repeated types); optional RNG mode and FingerprintSet for uniqueness"},
+    {"generate_batch_buffer", generate_batch_buffer_cpp, METH_VARARGS, "As generate_batch, but return (data, offsets) NativeBuffers: credential i is data[offsets[i]:offsets[i + 1]]"},
+    {"compile_patterns", compile_patterns_cpp, METH_VARARGS, "Compile regex_db.json patterns into native generators"},
+    {"generate", generate_cpp, METH_VARARGS, "Generate n credentials for a compiled type name or index; optional RNG mode and FingerprintSet for uniqueness"},
+    {"generate_buffer", generate_buffer_cpp, METH_VARARGS, "As generate, but return (data, offsets) NativeBuffers instead of a list of str"},
+    {"seed", seed_cpp, METH_VARARGS, "Reseed the fast and crypto RNG engines for reproducible output"},
+    {"set_rng_mode", set_rng_mode_cpp, METH_VARARGS, "Set the default RNG mode ('fast' or 'crypto')"},
+    {"get_compiled_types", get_compiled_types_cpp, METH_VARARGS, "List compiled credential types"},
+    {nullptr, nullptr, 0, nullptr}
+};
+
+static int credential_utils_exec(PyObject* module) {
+    if (!init_fingerprint_set_type() || !native_buffer::init_type()) {
+        return -1;
+    }
+    
+    Py_INCREF(&PyFingerprintSetType);
+    if (PyModule_AddObject(module, "FingerprintSet", reinterpret_cast<PyObject*>(&PyFingerprintSetType)) < 0) {
+        Py_DECREF(&PyFingerprintSetType);
+        return -1;
+    }
+    return 0;
+}
+
+// Generator state lives in process-wide C++ globals behind g_generator_mutex,
+// so the module shares safely between interpreters and without the GIL
+static PyModuleDef_Slot CredentialSlots[] = {
+    {Py_mod_exec, reinterpret_cast<void*>(credential_utils_exec)},
+#if PY_VERSION_HEX >= 0x030C0000
+    {Py_mod_multiple_interpreters, Py_MOD_MULTIPLE_INTERPRETERS_SUPPORTED},
+#endif
+#if PY_VERSION_HEX >= 0x030D0000
+    {Py_mod_gil, Py_MOD_GIL_NOT_USED},
+#endif
+    {0, nullptr}
 };
 
 static struct PyModuleDef credentialmodule = {
     PyModuleDef_HEAD_INIT,
     "credential_utils",
     "Native credential generation utilities",
-    -1,
-    CredentialMethods
+    0,
+    CredentialMethods,
+    CredentialSlots
 };
 
 PyMODINIT_FUNC PyInit_credential_utils(void) {
-    return PyModule_Create(&credentialmodule);
+    return PyModuleDef_Init(&credentialmodule);
 }
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+// Credential lists read in place by the native modules, so batches that
+// generate_buffer returns go back into native code without a copy.
+// Header-only; include after Python.h.
+
+// UTF-8 of a str, or the bytes of a bytes object
+inline bool credential_bytes(PyObject* obj, const char*& data, Py_ssize_t& size) {
+    if (PyUnicode_Check(obj)) {
+        data = PyUnicode_AsUTF8AndSize(obj, &size);
+        return data != nullptr;
+    }
+    if (PyBytes_Check(obj)) {
+        data = PyBytes_AS_STRING(obj);
+        size = PyBytes_GET_SIZE(obj);
+        return true;
+    }
+    PyErr_SetString(PyExc_TypeError, "Credentials must be str or bytes");
+    return false;
+}
+
+// Credentials viewed in place while the GIL is released: a sequence of str
+// or bytes, or one bytes-like blob sliced by offsets (the (data, offsets)
+// pair generate_buffer returns)
+class CredentialViews {
+public:
+    CredentialViews() = default;
+    CredentialViews(const CredentialViews&) = delete;
+    CredentialViews& operator=(const CredentialViews&) = delete;
+    
+    ~CredentialViews() {
+        if (blob.obj) {
+            PyBuffer_Release(&blob);
+        }
+        Py_XDECREF(items);
+    }
+    
+    bool parse(PyObject* credentials, PyObject* offsets) {
+        if (offsets && offsets != Py_None) {
+            return parse_blob(credentials, offsets);
+        }
+        
+        items = PySequence_Tuple(credentials);
+        if (!items) {
+            return false;
+        }
+        Py_ssize_t n = PyTuple_GET_SIZE(items);
+        spans.resize(n);
+        for (Py_ssize_t i = 0; i < n; ++i) {
+            if (!credential_bytes(PyTuple_GET_ITEM(items, i), spans[i].first, spans[i].second)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    size_t size() const {
+        return spans.size();
+    }
+    
+    const std::pair<const char*, Py_ssize_t>& operator[](size_t i) const {
+        return spans[i];
+    }
+    
+private:
+    bool parse_blob(PyObject* credentials, PyObject* offsets) {
+        if (PyObject_GetBuffer(credentials, &blob, PyBUF_SIMPLE) < 0) {
+            return false;
+        }
+        
+        std::vector<uint64_t> bounds;
+        Py_buffer view;
+        if (PyObject_CheckBuffer(offsets)) {
+            if (PyObject_GetBuffer(offsets, &view, PyBUF_FORMAT | PyBUF_C_CONTIGUOUS) < 0) {
+                return false;
+            }
+            const char* format = view.format ? view.format : "B";
+            char code = format[std::strlen(format) - 1];
+            bool ok = view.itemsize == 8 && (code == 'Q' || code == 'L');
+            if (ok) {
+                const uint64_t* values = static_cast<const uint64_t*>(view.buf);
+                bounds.assign(values, values + view.len / 8);
+            }
+            PyBuffer_Release(&view);
+            if (!ok) {
+                PyErr_SetString(PyExc_TypeError, "offsets buffer must hold unsigned 64-bit integers");
+                return false;
+            }
+        } else {
+            PyObject* seq = PySequence_Fast(offsets, "offsets must be a buffer or a sequence of integers");
+            if (!seq) {
+                return false;
+            }
+            for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(seq); ++i) {
+                bounds.push_back(PyLong_AsUnsignedLongLong(PySequence_Fast_GET_ITEM(seq, i)));
+                if (PyErr_Occurred()) {
+                    Py_DECREF(seq);
+                    return false;
+                }
+            }
+            Py_DECREF(seq);
+        }
+        
+        const char* base = static_cast<const char*>(blob.buf);
+        for (size_t i = 0; i + 1 < bounds.size(); ++i) {
+            if (bounds[i] > bounds[i + 1] || bounds[i + 1] > static_cast<uint64_t>(blob.len)) {
+                PyErr_SetString(PyExc_ValueError, "offsets must be ascending and within the data");
+                return false;
+            }
+            spans.emplace_back(base + bounds[i], static_cast<Py_ssize_t>(bounds[i + 1] - bounds[i]));
+        }
+        return true;
+    }
+    
+    PyObject* items = nullptr;
+    Py_buffer blob = {};
+    std::vector<std::pair<const char*, Py_ssize_t>> spans;
+};
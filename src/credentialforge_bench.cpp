@@ -0,0 +1,663 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+    #include <Python.h>
+}
+
+#include "cpu_topology.h"
+#include "credential_generate.h"
+#include "memory_arena.h"
+#include "memory_manager.h"
+#include "parallel_executor.h"
+#include "simd_kernels.h"
+#include "tracing.h"
+
+// Microbenchmarks for the native modules (the credentialforge_bench target).
+//
+// Each benchmark runs its body with a calibrated iteration count for
+// --repetitions rounds and reports the median rate. Every `value` is a rate,
+// so higher is better, and --baseline fails the run when a benchmark falls
+// more than --tolerance below the same benchmark in an earlier report.
+// Module chatter goes to stderr; the JSON report goes to --out (stdout by
+// default).
+//
+// The llama benchmarks need a model (--model or CREDENTIALFORGE_BENCH_MODEL;
+// use a small GGUF so runs stay comparable) and drive llama_cpp_interface
+// through an embedded interpreter, as the modules are Python extensions.
+
+extern "C" PyObject* PyInit_credential_utils(void);
+extern "C" PyObject* PyInit_llama_cpp_interface(void);
+
+namespace {
+
+struct Options {
+    std::string filter;
+    std::string out = "-";
+    std::string baseline;
+    std::string model;
+    std::string patterns;
+    std::vector<std::string> types = {"aws_access_key", "aws_secret_key", "jwt_token", "api_key", "password"};
+    double min_time = 0.2;     // Seconds per repetition
+    double tolerance = 0.10;
+    int repetitions = 5;
+    int threads = 0;           // 0: recommended_threads()
+    int prompt_tokens = 256;
+    int decode_tokens = 128;
+};
+
+struct Result {
+    std::string name;
+    std::string unit;
+    double value = 0.0;                  // Median rate over the repetitions
+    double min = 0.0;
+    double max = 0.0;
+    uint64_t iterations = 0;             // Per repetition
+    std::map<std::string, double> params;
+};
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Keeps results alive so the optimizer cannot drop the work
+std::atomic<uint64_t> g_sink{0};
+
+class Runner {
+public:
+    explicit Runner(const Options& opts) : options(opts) {}
+
+    bool enabled(const std::string& name) const {
+        return options.filter.empty() || name.find(options.filter) != std::string::npos;
+    }
+
+    // `body(n)` does n iterations and returns the items it processed. The
+    // iteration count doubles until one call takes a tenth of min_time.
+    Result& measure(const std::string& name, const std::string& unit, const std::function<double(uint64_t)>& body) {
+        uint64_t iterations = 1;
+        while (true) {
+            auto start = Clock::now();
+            body(iterations);
+            double elapsed = seconds_since(start);
+            if (elapsed >= options.min_time / 10 || iterations >= (uint64_t(1) << 40)) {
+                double scale = elapsed > 0 ? options.min_time / elapsed : 1024.0;
+                iterations = std::max<uint64_t>(1, static_cast<uint64_t>(iterations * std::min(scale, 1024.0)));
+                break;
+            }
+            iterations *= 2;
+        }
+
+        std::vector<double> rates;
+        for (int r = 0; r < options.repetitions; ++r) {
+            auto start = Clock::now();
+            double items = body(iterations);
+            double elapsed = seconds_since(start);
+            rates.push_back(elapsed > 0 ? items / elapsed : 0.0);
+        }
+        return record(name, unit, rates, iterations);
+    }
+
+    Result& record(const std::string& name, const std::string& unit, std::vector<double> rates, uint64_t iterations) {
+        std::sort(rates.begin(), rates.end());
+        Result result;
+        result.name = name;
+        result.unit = unit;
+        result.value = rates.empty() ? 0.0 : rates[rates.size() / 2];
+        result.min = rates.empty() ? 0.0 : rates.front();
+        result.max = rates.empty() ? 0.0 : rates.back();
+        result.iterations = iterations;
+        results.push_back(result);
+        std::cerr << name << ": " << result.value << " " << unit << std::endl;
+        return results.back();
+    }
+
+    const Options& options;
+    std::vector<Result> results;
+};
+
+// Interpreter for the benchmarks that go through module functions
+bool start_python() {
+    static bool started = false;
+    if (!started) {
+        PyImport_AppendInittab("credential_utils", PyInit_credential_utils);
+        PyImport_AppendInittab("llama_cpp_interface", PyInit_llama_cpp_interface);
+        Py_Initialize();
+        started = true;
+    }
+    return Py_IsInitialized();
+}
+
+// module.function(*Py_BuildValue(format, ...)); null with the error printed
+PyObject* call(const char* module_name, const char* function, const char* format, ...) {
+    PyObject* module = PyImport_ImportModule(module_name);
+    PyObject* result = nullptr;
+    if (module) {
+        PyObject* callable = PyObject_GetAttrString(module, function);
+        va_list va;
+        va_start(va, format);
+        PyObject* args = callable ? Py_VaBuildValue(format, va) : nullptr;
+        va_end(va);
+        if (args && !PyTuple_Check(args)) {
+            PyObject* single = PyTuple_Pack(1, args);
+            Py_DECREF(args);
+            args = single;
+        }
+        if (args) {
+            result = PyObject_CallObject(callable, args);
+            Py_DECREF(args);
+        }
+        Py_XDECREF(callable);
+        Py_DECREF(module);
+    }
+    if (!result) {
+        std::cerr << module_name << "." << function << " failed: ";
+        PyErr_Print();
+    }
+    return result;
+}
+
+double dict_number(PyObject* dict, const char* key) {
+    PyObject* value = dict ? PyDict_GetItemString(dict, key) : nullptr;
+    return value ? PyFloat_AsDouble(value) : 0.0;
+}
+
+// Credentials/sec per type, through the same batch path generate() uses
+void bench_credentials(Runner& runner) {
+    if (!runner.options.patterns.empty()) {
+        if (!start_python()) {
+            return;
+        }
+        PyObject* compiled = call("credential_utils", "compile_patterns", "(s)", runner.options.patterns.c_str());
+        Py_XDECREF(compiled);
+    }
+
+    constexpr size_t kBatch = 256;
+    for (const std::string& type : runner.options.types) {
+        std::string name = "credential_utils/generate/" + type;
+        if (!runner.enabled(name)) {
+            continue;
+        }
+        if (!credential_generate::supported(type)) {
+            std::cerr << name << ": skipped, unknown type (compile it with --patterns)" << std::endl;
+            continue;
+        }
+        std::vector<std::string> types = {type};
+        std::string buffer;
+        std::vector<uint64_t> offsets;
+        uint64_t bytes = 0;
+        uint64_t count = 0;
+        Result& result = runner.measure(name, "credentials/s", [&](uint64_t n) {
+            PyObject* error_type = nullptr;
+            std::string error;
+            for (uint64_t i = 0; i < n; ++i) {
+                buffer.clear();
+                offsets.clear();
+                credential_generate::generate(types, kBatch, nullptr, buffer, offsets, error_type, error);
+                bytes += buffer.size();
+                count += kBatch;
+            }
+            return static_cast<double>(n * kBatch);
+        });
+        result.params["batch"] = kBatch;
+        result.params["mean_length"] = count ? static_cast<double>(bytes) / count : 0.0;
+    }
+}
+
+// Alphabet mapping and base64 at each SIMD level the CPU has, scalar first
+void bench_simd(Runner& runner) {
+    constexpr size_t kInput = 64 << 10;
+    std::vector<uint8_t> input(kInput);
+    std::mt19937_64 rng(42);
+    for (auto& byte : input) {
+        byte = static_cast<uint8_t>(rng());
+    }
+    std::vector<char> output(simd_kernels::base64_encoded_size(kInput, true) + 64);
+    static const char kAlphabet[65] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    static const char kHex[65] = "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef";
+
+    std::map<std::string, double> scalar;
+    int detected = static_cast<int>(simd_kernels::detected_level());
+    for (int level = 0; level <= detected; ++level) {
+        simd_kernels::set_level_override(static_cast<simd_kernels::Level>(level));
+        std::string suffix = std::string("/") + simd_kernels::level_name(static_cast<simd_kernels::Level>(level));
+
+        auto kernel = [&](const std::string& kernel_name, const std::function<size_t()>& run) {
+            std::string name = "cpu_optimizer/" + kernel_name + suffix;
+            if (!runner.enabled(name)) {
+                return;
+            }
+            Result& result = runner.measure(name, "bytes/s", [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    g_sink += run();
+                }
+                return static_cast<double>(n * kInput);
+            });
+            result.params["level"] = level;
+            if (level == 0) {
+                scalar[kernel_name] = result.value;
+            } else if (scalar.count(kernel_name) && scalar[kernel_name] > 0) {
+                result.params["speedup_vs_scalar"] = result.value / scalar[kernel_name];
+            }
+        };
+        kernel("map_alphabet_hex", [&]() {
+            return simd_kernels::map_alphabet(input.data(), kInput, kHex, 16, output.data(), kInput);
+        });
+        kernel("map_alphabet_62", [&]() {
+            return simd_kernels::map_alphabet(input.data(), kInput, kAlphabet, 62, output.data(), kInput);
+        });
+        kernel("base64_encode", [&]() {
+            return simd_kernels::base64_encode(input.data(), kInput, kAlphabet, output.data(), true);
+        });
+    }
+    simd_kernels::clear_level_override();
+}
+
+// A few microseconds of arithmetic, the size of a small generation step
+uint64_t spin_work(uint64_t seed, int rounds) {
+    uint64_t x = seed | 1;
+    for (int i = 0; i < rounds; ++i) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+    }
+    return x;
+}
+
+void bench_executor(Runner& runner) {
+    int max_threads = runner.options.threads > 0 ? runner.options.threads
+                                                 : std::max(1, cpu_topology::recommended_threads());
+
+    if (runner.enabled("parallel_executor/empty_task")) {
+        ParallelExecutor executor(max_threads);
+        constexpr uint64_t kTasks = 4096;
+        Result& result = runner.measure("parallel_executor/empty_task", "tasks/s", [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                for (uint64_t t = 0; t < kTasks; ++t) {
+                    executor.submit([]() {});
+                }
+                executor.wait_for_all();
+            }
+            return static_cast<double>(n * kTasks);
+        });
+        result.params["threads"] = max_threads;
+        result.params["ns_per_task"] = result.value > 0 ? 1e9 / result.value : 0.0;
+    }
+
+    // Scaling curve: the same batch of CPU-bound tasks on 1, 2, 4, ... threads
+    std::vector<int> counts;
+    for (int n = 1; n < max_threads; n *= 2) {
+        counts.push_back(n);
+    }
+    counts.push_back(max_threads);
+
+    constexpr uint64_t kTasks = 1024;
+    constexpr int kRounds = 20000;
+    double single = 0.0;
+    for (int n : counts) {
+        std::string name = "parallel_executor/scaling/" + std::to_string(n);
+        if (!runner.enabled(name)) {
+            continue;
+        }
+        ParallelExecutor executor(n, true);
+        Result& result = runner.measure(name, "tasks/s", [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                for (uint64_t t = 0; t < kTasks; ++t) {
+                    executor.submit([t]() { g_sink += spin_work(t, kRounds); });
+                }
+                executor.wait_for_all();
+            }
+            return static_cast<double>(iterations * kTasks);
+        });
+        if (n == 1) {
+            single = result.value;
+        }
+        result.params["threads"] = n;
+        if (single > 0) {
+            result.params["speedup"] = result.value / single;
+            result.params["efficiency"] = result.value / single / n;
+        }
+    }
+}
+
+void bench_memory(Runner& runner) {
+    MemoryManager manager(size_t(1) << 30);
+    for (size_t size : {size_t(64), size_t(4096), size_t(65536)}) {
+        std::string suffix = "/" + std::to_string(size);
+        constexpr size_t kLive = 64;   // Allocations held at once
+        void* live[kLive];
+
+        if (runner.enabled("memory_manager/allocate_free" + suffix)) {
+            runner.measure("memory_manager/allocate_free" + suffix, "pairs/s", [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    for (size_t j = 0; j < kLive; ++j) {
+                        live[j] = manager.allocate(size);
+                    }
+                    for (size_t j = 0; j < kLive; ++j) {
+                        manager.deallocate(live[j]);
+                    }
+                }
+                return static_cast<double>(n * kLive);
+            }).params["size"] = static_cast<double>(size);
+        }
+
+        if (runner.enabled("memory_manager/pool" + suffix)) {
+            MemoryManager::MemoryPool& pool = manager.get_pool(size);
+            runner.measure("memory_manager/pool" + suffix, "pairs/s", [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    for (size_t j = 0; j < kLive; ++j) {
+                        live[j] = pool.get_block();
+                    }
+                    for (size_t j = 0; j < kLive; ++j) {
+                        pool.return_block(live[j]);
+                    }
+                }
+                return static_cast<double>(n * kLive);
+            }).params["size"] = static_cast<double>(size);
+        }
+
+        if (runner.enabled("memory_manager/arena" + suffix)) {
+            runner.measure("memory_manager/arena" + suffix, "allocations/s", [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    memory_arena::Scope scope;
+                    for (size_t j = 0; j < kLive; ++j) {
+                        live[j] = scope.arena().allocate(size, 64);
+                    }
+                    g_sink += reinterpret_cast<uintptr_t>(live[kLive - 1]) & 1;
+                }
+                return static_cast<double>(n * kLive);
+            }).params["size"] = static_cast<double>(size);
+        }
+    }
+}
+
+// Spans/s with the category off (what instrumented code pays normally)
+// and on; tracing is left off and empty afterwards
+void bench_tracing(Runner& runner) {
+    for (bool on : {false, true}) {
+        std::string name = on ? "tracing/span_enabled" : "tracing/span_disabled";
+        if (!runner.enabled(name)) {
+            continue;
+        }
+        if (on) {
+            tracing::enable(tracing::EXECUTOR);
+        }
+        runner.measure(name, "spans/s", [](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                tracing::Span span(tracing::EXECUTOR, "bench.span", static_cast<int64_t>(i));
+            }
+            return static_cast<double>(n);
+        });
+        tracing::disable();
+        tracing::clear();
+    }
+}
+
+// Prompt-eval and decode tok/s on a pinned model, from the interface's
+// own counters. Each repetition changes the first words of the prompt so
+// no prefix is reused from the previous one.
+void bench_llama(Runner& runner) {
+    const Options& options = runner.options;
+    bool wanted = runner.enabled("llama_cpp_interface/prompt_eval") || runner.enabled("llama_cpp_interface/decode");
+    if (!wanted) {
+        return;
+    }
+    if (options.model.empty()) {
+        std::cerr << "llama_cpp_interface: skipped, no --model" << std::endl;
+        return;
+    }
+    if (!start_python()) {
+        return;
+    }
+
+    PyObject* ok = call("llama_cpp_interface", "init", "()");
+    Py_XDECREF(ok);
+    ok = ok ? call("llama_cpp_interface", "set_cpu_placement", "(ii)", -1, 1) : nullptr;
+    Py_XDECREF(ok);
+    ok = ok ? call("llama_cpp_interface", "load_model", "(si)", options.model.c_str(), 1) : nullptr;
+    if (!ok || ok != Py_True) {
+        std::cerr << "llama_cpp_interface: could not load " << options.model << std::endl;
+        Py_XDECREF(ok);
+        return;
+    }
+    Py_DECREF(ok);
+    if (options.threads > 0) {
+        Py_XDECREF(call("llama_cpp_interface", "set_threads", "(ii)", options.threads, options.threads));
+    }
+
+    // Roughly one token per word for small English vocabularies
+    std::string body;
+    for (int i = 0; i < options.prompt_tokens; ++i) {
+        body += i % 12 == 11 ? "report. " : "quarterly ";
+    }
+
+    std::vector<double> prompt_rates;
+    std::vector<double> decode_rates;
+    double decoded = 0.0;
+    for (int r = 0; r <= options.repetitions; ++r) {
+        std::string prompt = "Run " + std::to_string(r) + " of the benchmark: " + body;
+        Py_XDECREF(call("llama_cpp_interface", "reset_stats", "()"));
+        PyObject* text = call("llama_cpp_interface", "generate_text", "(sidN)", prompt.c_str(),
+                              options.decode_tokens, 0.0, Py_BuildValue("{s:i}", "seed", 1));
+        PyObject* stats = text ? call("llama_cpp_interface", "get_stats", "()") : nullptr;
+        Py_XDECREF(text);
+        if (!stats) {
+            return;
+        }
+        if (r > 0) {  // The first round warms up caches and threads
+            prompt_rates.push_back(dict_number(stats, "prompt_tokens_per_second"));
+            decode_rates.push_back(dict_number(stats, "decode_tokens_per_second"));
+            decoded += dict_number(stats, "generated_tokens");
+        }
+        Py_DECREF(stats);
+    }
+
+    if (runner.enabled("llama_cpp_interface/prompt_eval")) {
+        runner.record("llama_cpp_interface/prompt_eval", "tokens/s", prompt_rates, 1).params["prompt_words"] = options.prompt_tokens;
+    }
+    if (runner.enabled("llama_cpp_interface/decode")) {
+        Result& result = runner.record("llama_cpp_interface/decode", "tokens/s", decode_rates, 1);
+        result.params["max_tokens"] = options.decode_tokens;
+        result.params["mean_tokens"] = options.repetitions > 0 ? decoded / options.repetitions : 0.0;
+    }
+}
+
+std::string json_escape(const std::string& text) {
+    std::string out;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    return out;
+}
+
+std::string json_number(double value) {
+    if (!std::isfinite(value)) {
+        return "0";
+    }
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.6g", value);
+    return buffer;
+}
+
+// One benchmark per line, so baselines can be read back line by line
+std::string report(const Runner& runner) {
+    const cpu_topology::Topology& topology = cpu_topology::get();
+    std::ostringstream out;
+    out << "{\n";
+    out << "  \"schema\": 1,\n";
+    out << "  \"host\": {\"logical_cores\": " << topology.logical_cores
+        << ", \"physical_cores\": " << topology.physical_cores
+        << ", \"numa_nodes\": " << topology.numa_nodes
+        << ", \"simd_level\": \"" << simd_kernels::level_name(simd_kernels::detected_level()) << "\"},\n";
+    out << "  \"min_time\": " << json_number(runner.options.min_time)
+        << ", \"repetitions\": " << runner.options.repetitions << ",\n";
+    out << "  \"benchmarks\": [\n";
+    for (size_t i = 0; i < runner.results.size(); ++i) {
+        const Result& r = runner.results[i];
+        out << "    {\"name\": \"" << json_escape(r.name) << "\", \"unit\": \"" << json_escape(r.unit)
+            << "\", \"value\": " << json_number(r.value) << ", \"min\": " << json_number(r.min)
+            << ", \"max\": " << json_number(r.max) << ", \"iterations\": " << r.iterations << ", \"params\": {";
+        bool first = true;
+        for (const auto& param : r.params) {
+            out << (first ? "" : ", ") << "\"" << json_escape(param.first) << "\": " << json_number(param.second);
+            first = false;
+        }
+        out << "}}" << (i + 1 < runner.results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    return out.str();
+}
+
+// Benchmarks in a report this tool wrote earlier: name -> value
+bool read_baseline(const std::string& path, std::map<std::string, double>& values) {
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t name = line.find("{\"name\": \"");
+        size_t value = line.find("\"value\": ");
+        if (name == std::string::npos || value == std::string::npos) {
+            continue;
+        }
+        name += 10;
+        size_t end = line.find('"', name);
+        values[line.substr(name, end - name)] = std::strtod(line.c_str() + value + 9, nullptr);
+    }
+    return true;
+}
+
+// Regressions beyond the tolerance, printed to stderr; false if any
+bool compare(const Runner& runner, const std::map<std::string, double>& baseline) {
+    bool passed = true;
+    for (const Result& r : runner.results) {
+        auto it = baseline.find(r.name);
+        if (it == baseline.end() || it->second <= 0) {
+            continue;
+        }
+        double ratio = r.value / it->second;
+        if (ratio < 1.0 - runner.options.tolerance) {
+            std::cerr << "REGRESSION " << r.name << ": " << r.value << " " << r.unit << " vs "
+                      << it->second << " (" << json_number((1.0 - ratio) * 100) << "% slower)" << std::endl;
+            passed = false;
+        }
+    }
+    return passed;
+}
+
+void usage() {
+    std::cerr << "usage: credentialforge_bench [--filter TEXT] [--out FILE|-] [--baseline FILE] [--tolerance 0.10]\n"
+                 "                             [--min-time SECONDS] [--repetitions N] [--threads N]\n"
+                 "                             [--types a,b,c] [--patterns regex_db.json]\n"
+                 "                             [--model GGUF] [--prompt-tokens N] [--decode-tokens N]\n";
+}
+
+bool parse_options(int argc, char** argv, Options& options) {
+    if (const char* model = std::getenv("CREDENTIALFORGE_BENCH_MODEL")) {
+        options.model = model;
+    }
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h" || i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--filter") {
+            options.filter = value;
+        } else if (arg == "--out") {
+            options.out = value;
+        } else if (arg == "--baseline") {
+            options.baseline = value;
+        } else if (arg == "--tolerance") {
+            options.tolerance = std::atof(value.c_str());
+        } else if (arg == "--min-time") {
+            options.min_time = std::max(0.001, std::atof(value.c_str()));
+        } else if (arg == "--repetitions") {
+            options.repetitions = std::max(1, std::atoi(value.c_str()));
+        } else if (arg == "--threads") {
+            options.threads = std::atoi(value.c_str());
+        } else if (arg == "--types") {
+            options.types.clear();
+            std::stringstream list(value);
+            for (std::string type; std::getline(list, type, ',');) {
+                if (!type.empty()) {
+                    options.types.push_back(type);
+                }
+            }
+        } else if (arg == "--patterns") {
+            options.patterns = value;
+        } else if (arg == "--model") {
+            options.model = value;
+        } else if (arg == "--prompt-tokens") {
+            options.prompt_tokens = std::max(1, std::atoi(value.c_str()));
+        } else if (arg == "--decode-tokens") {
+            options.decode_tokens = std::max(1, std::atoi(value.c_str()));
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        usage();
+        return 2;
+    }
+
+    // Modules log to stdout; keep it for the report
+    std::cout.rdbuf(std::cerr.rdbuf());
+
+    Runner runner(options);
+    bench_credentials(runner);
+    bench_simd(runner);
+    bench_executor(runner);
+    bench_memory(runner);
+    bench_tracing(runner);
+    bench_llama(runner);
+
+    std::string json = report(runner);
+    if (options.out == "-") {
+        std::fwrite(json.data(), 1, json.size(), stdout);
+    } else {
+        std::ofstream out(options.out, std::ios::binary);
+        out << json;
+        if (!out) {
+            std::cerr << "Could not write " << options.out << std::endl;
+            return 1;
+        }
+    }
+
+    if (!options.baseline.empty()) {
+        std::map<std::string, double> baseline;
+        if (!read_baseline(options.baseline, baseline)) {
+            std::cerr << "Could not read baseline " << options.baseline << std::endl;
+            return 1;
+        }
+        return compare(runner, baseline) ? 0 : 1;
+    }
+    return 0;
+}
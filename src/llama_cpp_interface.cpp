@@ -6,20 +6,638 @@
 #include <atomic>
 #include <chrono>
 #include <iostream>
+#include <queue>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <random>
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+#include <deque>
+#include <future>
+#include <fstream>
+#include <list>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 extern "C" {
+    #define PY_SSIZE_T_CLEAN
     #include <Python.h>
     #include "llama.h"
     #include "ggml.h"
 }
 
+#include "content_cache.h"
+#include "cpu_topology.h"
+#include "memory_arena.h"
+#include "memory_budget.h"
+#include "native_buffer.h"
+#include "token_grammar.h"
+#include "tracing.h"
+
+// Sampling configuration; defaults can be set from Python and overridden
+// per call
+struct SamplingParams {
+    float temperature = 0.7f;     // <= 0 selects greedy decoding
+    int top_k = 40;               // <= 0 keeps the whole vocabulary
+    float top_p = 0.95f;          // 1.0 disables nucleus filtering
+    float min_p = 0.05f;          // relative to the most likely token; 0 disables
+    float repeat_penalty = 1.1f;  // 1.0 disables
+    int repeat_last_n = 64;
+    std::string allowed_chars;    // non-empty restricts output pieces to these characters
+    int64_t seed = -1;            // >= 0 reseeds the sampler before generating
+    std::shared_ptr<const token_grammar::Grammar> grammar;  // non-null constrains output to the grammar
+};
+
+// Fields a caller set explicitly, so remote requests overlay only those on
+// the server's defaults
+enum SamplingField : uint32_t {
+    SAMPLING_TEMPERATURE = 1u << 0,
+    SAMPLING_TOP_K = 1u << 1,
+    SAMPLING_TOP_P = 1u << 2,
+    SAMPLING_MIN_P = 1u << 3,
+    SAMPLING_REPEAT_PENALTY = 1u << 4,
+    SAMPLING_REPEAT_LAST_N = 1u << 5,
+    SAMPLING_ALLOWED_CHARS = 1u << 6,
+    SAMPLING_SEED = 1u << 7,
+    SAMPLING_GRAMMAR = 1u << 8
+};
+
+static void apply_sampling_fields(SamplingParams& target, const SamplingParams& source, uint32_t fields) {
+    if (fields & SAMPLING_TEMPERATURE) target.temperature = source.temperature;
+    if (fields & SAMPLING_TOP_K) target.top_k = source.top_k;
+    if (fields & SAMPLING_TOP_P) target.top_p = source.top_p;
+    if (fields & SAMPLING_MIN_P) target.min_p = source.min_p;
+    if (fields & SAMPLING_REPEAT_PENALTY) target.repeat_penalty = source.repeat_penalty;
+    if (fields & SAMPLING_REPEAT_LAST_N) target.repeat_last_n = source.repeat_last_n;
+    if (fields & SAMPLING_ALLOWED_CHARS) target.allowed_chars = source.allowed_chars;
+    if (fields & SAMPLING_SEED) target.seed = source.seed;
+    if (fields & SAMPLING_GRAMMAR) target.grammar = source.grammar;
+}
+
+// Restricts which tokens may be sampled next (grammar hook). `allows` is
+// only consulted for candidates that survive top-k, most likely first.
+class TokenConstraint {
+public:
+    virtual ~TokenConstraint() = default;
+    virtual bool allows(llama_token token, const std::string& piece) const = 0;
+    virtual void accept(llama_token token, const std::string& piece) = 0;
+    
+    // Whether generation may stop here, and whether it must
+    virtual bool allows_end() const { return true; }
+    virtual bool exhausted() const { return false; }
+};
+
+// Accepts tokens whose pieces consist only of the given characters
+class CharsetConstraint : public TokenConstraint {
+public:
+    explicit CharsetConstraint(const std::string& chars) {
+        for (unsigned char c : chars) {
+            allowed.set(c);
+        }
+    }
+    
+    bool allows(llama_token token, const std::string& piece) const override {
+        for (unsigned char c : piece) {
+            if (!allowed.test(c)) {
+                return false;
+            }
+        }
+        return !piece.empty();
+    }
+    
+    void accept(llama_token token, const std::string& piece) override {}
+    
+private:
+    std::bitset<256> allowed;
+};
+
+// Accepts tokens that keep the output a prefix of the grammar's language;
+// end of generation only once the output is complete
+class GrammarConstraint : public TokenConstraint {
+public:
+    explicit GrammarConstraint(std::shared_ptr<const token_grammar::Grammar> grammar) : matcher(std::move(grammar)) {}
+    
+    bool allows(llama_token token, const std::string& piece) const override {
+        return !piece.empty() && matcher.allows(piece);
+    }
+    
+    void accept(llama_token token, const std::string& piece) override {
+        matcher.accept(piece);
+    }
+    
+    bool allows_end() const override {
+        return matcher.can_end();
+    }
+    
+    bool exhausted() const override {
+        return matcher.done();
+    }
+    
+private:
+    token_grammar::Matcher matcher;
+};
+
+// Sampling chain: repetition penalty -> constraint -> top-k (partial sort)
+// -> temperature -> softmax -> min-p -> top-p -> draw. The candidate buffer
+// is sized once per vocabulary and reused for every token.
+class TokenSampler {
+public:
+    TokenSampler() : rng(std::random_device{}()) {}
+    
+    void reset(const SamplingParams& p, TokenConstraint* c, const std::vector<std::string>* token_pieces,
+               llama_token end_token) {
+        params = p;
+        constraint = c;
+        pieces = token_pieces;
+        eos = end_token;
+        recent.clear();
+    }
+    
+    void seed(uint64_t value) {
+        rng.seed(value);
+    }
+    
+    llama_token sample(const float* logits, int n_vocab) {
+        if (constraint && constraint->exhausted()) {
+            return eos;
+        }
+        
+        candidates.resize(n_vocab);
+        for (int i = 0; i < n_vocab; ++i) {
+            candidates[i] = llama_token_data{i, logits[i], 0.0f};
+        }
+        
+        apply_repeat_penalty();
+        
+        // Keep the top-k, plus enough extra candidates that the constraint
+        // can still find allowed tokens after filtering
+        size_t keep = params.top_k > 0 ? std::min<size_t>(params.top_k, n_vocab) : n_vocab;
+        if (constraint && keep < candidates.size()) {
+            keep = std::min(candidates.size(), std::max<size_t>(keep * 8, 1024));
+        }
+        select_top(keep);
+        
+        if (constraint) {
+            apply_constraint();
+            if (candidates.empty() && keep < static_cast<size_t>(n_vocab)) {
+                // Nothing likely fits: search the whole vocabulary
+                for (int i = 0; i < n_vocab; ++i) {
+                    candidates.push_back(llama_token_data{i, logits[i], 0.0f});
+                }
+                apply_repeat_penalty();
+                select_top(candidates.size());
+                apply_constraint();
+            }
+            if (params.top_k > 0 && candidates.size() > static_cast<size_t>(params.top_k)) {
+                candidates.resize(params.top_k);
+            }
+        }
+        
+        if (candidates.empty()) {
+            return eos;
+        }
+        
+        if (params.temperature <= 0.0f) {
+            return candidates[0].id;
+        }
+        
+        softmax(1.0f / params.temperature);
+        apply_min_p();
+        apply_top_p();
+        return draw();
+    }
+    
+    void accept(llama_token token) {
+        remember(token);
+        if (constraint && pieces && token >= 0 && static_cast<size_t>(token) < pieces->size()) {
+            constraint->accept(token, (*pieces)[token]);
+        }
+    }
+    
+    // Count a token toward the repetition penalty only (prompt tokens)
+    void remember(llama_token token) {
+        if (params.repeat_last_n > 0) {
+            if (recent.size() >= static_cast<size_t>(params.repeat_last_n)) {
+                recent.erase(recent.begin());
+            }
+            recent.push_back(token);
+        }
+    }
+    
+private:
+    void apply_repeat_penalty() {
+        if (params.repeat_penalty == 1.0f || recent.empty()) {
+            return;
+        }
+        
+        penalized.assign(recent.begin(), recent.end());
+        std::sort(penalized.begin(), penalized.end());
+        penalized.erase(std::unique(penalized.begin(), penalized.end()), penalized.end());
+        
+        for (llama_token token : penalized) {
+            if (token < 0 || static_cast<size_t>(token) >= candidates.size()) {
+                continue;
+            }
+            float& logit = candidates[token].logit;
+            logit = logit > 0.0f ? logit / params.repeat_penalty : logit * params.repeat_penalty;
+        }
+    }
+    
+    void select_top(size_t k) {
+        auto by_logit = [](const llama_token_data& a, const llama_token_data& b) { return a.logit > b.logit; };
+        if (k < candidates.size()) {
+            std::nth_element(candidates.begin(), candidates.begin() + k, candidates.end(), by_logit);
+            candidates.resize(k);
+        }
+        std::sort(candidates.begin(), candidates.end(), by_logit);
+    }
+    
+    void apply_constraint() {
+        auto allowed = [this](const llama_token_data& c) {
+            if (c.id == eos) {
+                return constraint->allows_end();
+            }
+            return pieces && static_cast<size_t>(c.id) < pieces->size() && constraint->allows(c.id, (*pieces)[c.id]);
+        };
+        candidates.erase(std::stable_partition(candidates.begin(), candidates.end(), allowed), candidates.end());
+    }
+    
+    void softmax(float inv_temperature) {
+        float max_logit = candidates[0].logit;
+        float sum = 0.0f;
+        for (auto& c : candidates) {
+            c.p = std::exp((c.logit - max_logit) * inv_temperature);
+            sum += c.p;
+        }
+        for (auto& c : candidates) {
+            c.p /= sum;
+        }
+    }
+    
+    void apply_min_p() {
+        if (params.min_p <= 0.0f) {
+            return;
+        }
+        float threshold = candidates[0].p * params.min_p;
+        size_t keep = 1;
+        while (keep < candidates.size() && candidates[keep].p >= threshold) {
+            ++keep;
+        }
+        candidates.resize(keep);
+    }
+    
+    void apply_top_p() {
+        if (params.top_p >= 1.0f) {
+            return;
+        }
+        float total = 0.0f;
+        for (auto& c : candidates) {
+            total += c.p;
+        }
+        
+        float cumulative = 0.0f;
+        size_t keep = 0;
+        while (keep < candidates.size()) {
+            cumulative += candidates[keep++].p;
+            if (cumulative >= params.top_p * total) {
+                break;
+            }
+        }
+        candidates.resize(keep);
+    }
+    
+    llama_token draw() {
+        float total = 0.0f;
+        for (auto& c : candidates) {
+            total += c.p;
+        }
+        
+        float r = std::uniform_real_distribution<float>(0.0f, total)(rng);
+        for (auto& c : candidates) {
+            r -= c.p;
+            if (r <= 0.0f) {
+                return c.id;
+            }
+        }
+        return candidates.back().id;
+    }
+    
+    SamplingParams params;
+    TokenConstraint* constraint = nullptr;
+    const std::vector<std::string>* pieces = nullptr;
+    llama_token eos = -1;
+    
+    std::vector<llama_token_data> candidates;
+    std::vector<llama_token> recent;
+    std::vector<llama_token> penalized;
+    std::mt19937_64 rng;
+};
+
+
+// Text produced by one streaming request, handed from the scheduler thread
+// to a consumer in chunks. Never splits a UTF-8 sequence across chunks;
+// only a generation cut short can leave one incomplete in the last chunk.
+class TokenStream {
+public:
+    void push(const char* data, size_t size) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            buffer.append(data, size);
+        }
+        cv.notify_one();
+    }
+    
+    // An empty `failure` marks a normal end of stream
+    void close(const std::string& failure) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            error = failure;
+            done = true;
+        }
+        cv.notify_one();
+    }
+    
+    void cancel() {
+        cancelled = true;
+    }
+    
+    bool is_cancelled() const {
+        return cancelled;
+    }
+    
+    // Wait until `min_bytes` are buffered, `max_wait` has passed with data
+    // pending, or the stream ends. Returns false once the stream is drained.
+    bool next_chunk(std::string& out, size_t min_bytes, std::chrono::milliseconds max_wait) {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&] { return done || !buffer.empty(); });
+        cv.wait_for(lock, max_wait, [&] { return done || buffer.size() >= min_bytes; });
+        
+        size_t n = done ? buffer.size() : complete_utf8_prefix();
+        out.assign(buffer, 0, n);
+        buffer.erase(0, n);
+        return !out.empty() || !done;
+    }
+    
+    bool failed(std::string& message) {
+        std::lock_guard<std::mutex> lock(mutex);
+        message = error;
+        return done && !error.empty();
+    }
+    
+private:
+    // Length of the buffer without a trailing incomplete UTF-8 sequence
+    size_t complete_utf8_prefix() const {
+        size_t n = buffer.size();
+        size_t lead = n;
+        while (lead > 0 && n - lead < 4 && (static_cast<unsigned char>(buffer[lead - 1]) & 0xC0) == 0x80) {
+            --lead;
+        }
+        if (lead == 0) {
+            return n;
+        }
+        
+        unsigned char c = static_cast<unsigned char>(buffer[lead - 1]);
+        size_t expected = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+        return n - (lead - 1) >= expected ? n : lead - 1;
+    }
+    
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::string buffer;
+    std::string error;
+    bool done = false;
+    std::atomic<bool> cancelled{false};
+};
+
+static void atomic_add(std::atomic<double>& value, double delta) {
+    double current = value.load();
+    while (!value.compare_exchange_weak(current, current + delta)) {
+    }
+}
+
+// Latency distribution in log-scale buckets, four per doubling from 1 us
+// to about two minutes, so percentiles are within ~10% of the exact value
+// without keeping samples. Recorded by the scheduler thread, read by any.
+class LatencyHistogram {
+public:
+    static constexpr int kBucketsPerOctave = 4;
+    static constexpr int kBuckets = 27 * kBucketsPerOctave;
+    static constexpr double kMinSeconds = 1e-6;
+    
+    LatencyHistogram() {
+        reset();
+    }
+    
+    // `n` observations of `seconds` each
+    void record(double seconds, uint64_t n = 1) {
+        int bucket = 0;
+        if (seconds > kMinSeconds) {
+            bucket = std::min(kBuckets - 1, static_cast<int>(std::log2(seconds / kMinSeconds) * kBucketsPerOctave));
+        }
+        buckets[bucket].fetch_add(n, std::memory_order_relaxed);
+        count.fetch_add(n, std::memory_order_relaxed);
+        atomic_add(sum, seconds * n);
+        double current = max.load();
+        while (seconds > current && !max.compare_exchange_weak(current, seconds)) {
+        }
+    }
+    
+    // Geometric midpoint of the bucket holding quantile `q`, capped at the
+    // largest observation; 0 when empty
+    double percentile(double q) const {
+        uint64_t total = count.load();
+        if (total == 0) {
+            return 0.0;
+        }
+        uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * total)));
+        uint64_t seen = 0;
+        int bucket = 0;
+        for (; bucket < kBuckets - 1; ++bucket) {
+            seen += buckets[bucket].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                break;
+            }
+        }
+        double midpoint = kMinSeconds * std::exp2((bucket + 0.5) / kBucketsPerOctave);
+        return std::min(midpoint, max.load());
+    }
+    
+    // <prefix>_count, _mean, _p50, _p95, _p99 and _max
+    void export_stats(std::map<std::string, double>& stats, const std::string& prefix) const {
+        uint64_t total = count.load();
+        stats[prefix + "_count"] = static_cast<double>(total);
+        stats[prefix + "_mean"] = total > 0 ? sum.load() / total : 0.0;
+        stats[prefix + "_p50"] = percentile(0.50);
+        stats[prefix + "_p95"] = percentile(0.95);
+        stats[prefix + "_p99"] = percentile(0.99);
+        stats[prefix + "_max"] = max.load();
+    }
+    
+    void reset() {
+        for (auto& bucket : buckets) {
+            bucket = 0;
+        }
+        count = 0;
+        sum = 0.0;
+        max = 0.0;
+    }
+    
+private:
+    std::atomic<uint64_t> buckets[kBuckets];
+    std::atomic<uint64_t> count;
+    std::atomic<double> sum;
+    std::atomic<double> max;
+};
+
+// A prompt queued for or running in the batch scheduler
+struct GenerationRequest {
+    std::vector<llama_token> prompt;
+    int max_tokens = 0;
+    SamplingParams params;
+    std::promise<std::string> result;
+    std::chrono::high_resolution_clock::time_point submitted;
+    bool snapshot_prefix = false;  // prefill only, then store the KV state in the prefix cache
+    std::shared_ptr<TokenStream> stream;
+    std::shared_ptr<std::atomic<bool>> cancel;  // set by the submitter to stop generating
+    
+    bool is_cancelled() const {
+        return (cancel && cancel->load()) || (stream && stream->is_cancelled());
+    }
+    
+    void finish(std::string text, bool failed = false) {
+        if (stream) {
+            stream->close(failed ? text : std::string());
+        }
+        result.set_value(std::move(text));
+    }
+};
+
+// Serialized KV state of one decoded prompt prefix
+struct PrefixEntry {
+    std::vector<llama_token> tokens;
+    std::vector<uint8_t> state;
+    uint64_t last_used = 0;
+};
+
+// Where an admitted request takes its prompt prefix from
+struct PrefixMatch {
+    size_t length = 0;
+    int source_slot = -1;               // live sequence to copy cells from
+    const PrefixEntry* entry = nullptr;  // or a snapshot to restore
+};
+
+static size_t common_prefix(const std::vector<llama_token>& a, const std::vector<llama_token>& b) {
+    size_t n = std::min(a.size(), b.size());
+    size_t i = 0;
+    while (i < n && a[i] == b[i]) {
+        ++i;
+    }
+    return i;
+}
+
+// Decoding state for one sequence; slot i decodes as seq_id i. Samplers
+// live in the slot so their buffers are reused across requests.
+struct SequenceSlot {
+    std::unique_ptr<GenerationRequest> request;
+    std::unique_ptr<TokenConstraint> constraint;
+    TokenSampler sampler;
+    std::string output;
+    size_t n_prompt_done = 0;    // prompt tokens already submitted for decoding
+    int n_past = 0;
+    int n_generated = 0;
+    int reserved = 0;            // KV cells reserved for prompt + max_tokens
+    int i_batch = -1;            // index of this slot's logits in the current batch
+    llama_token last_token = 0;  // sampled, not yet decoded
+    bool failed = false;
+    std::vector<llama_token> kv_tokens;  // tokens held in this sequence's KV cells
+    uint64_t last_used = 0;
+    std::vector<llama_token> draft;      // proposed by the draft model, verified this step
+    std::vector<llama_token> draft_kv;   // tokens held in the draft model's cells
+    std::chrono::high_resolution_clock::time_point last_emitted;  // when the last token was sampled
+    
+    bool active() const {
+        return request != nullptr;
+    }
+    
+    bool prefilling() const {
+        return request && n_prompt_done < request->prompt.size();
+    }
+};
+
+// Context settings changed by reconfigure(); 0 keeps the current value
+struct ContextSettings {
+    int n_ctx = 0;
+    int n_batch = 0;
+    int n_threads = 0;        // Generation: one token per sequence per step
+    int n_threads_batch = 0;  // Prompt processing
+};
+
+// Weights loaded once per file and shared by every interface using it
+// (registry handles with different context settings, the default
+// interface). A model stays mapped until its last user drops it. The file
+// size is charged to the memory budget while it is mapped, since the
+// pages become resident as inference touches them.
+class SharedModelCache {
+private:
+    std::mutex mutex;
+    std::map<std::string, std::weak_ptr<llama_model>> models;
+    
+public:
+    std::shared_ptr<llama_model> acquire(const std::string& path, const llama_model_params& params) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::shared_ptr<llama_model> model = models[path].lock();
+        if (!model) {
+            struct stat st;
+            size_t bytes = stat(path.c_str(), &st) == 0 ? static_cast<size_t>(st.st_size) : 0;
+            if (!memory_budget::admit(bytes)) {
+                std::cerr << "Model " << path << " (" << bytes / (1024 * 1024)
+                          << " MB) does not fit the memory budget" << std::endl;
+                models.erase(path);
+                return nullptr;
+            }
+            
+            llama_model* loaded = llama_load_model_from_file(path.c_str(), params);
+            if (!loaded) {
+                models.erase(path);
+                return nullptr;
+            }
+            memory_budget::charge(memory_budget::Category::MODEL_WEIGHTS, bytes);
+            model.reset(loaded, [bytes](llama_model* m) {
+                llama_free_model(m);
+                memory_budget::credit(memory_budget::Category::MODEL_WEIGHTS, bytes);
+            });
+            models[path] = model;
+        }
+        return model;
+    }
+};
+
+// K and V for every layer and cell at f16. Models with grouped-query
+// attention need less, so this errs high.
+static size_t estimate_kv_bytes(const llama_model* model, int n_ctx) {
+    return static_cast<size_t>(n_ctx) * static_cast<size_t>(llama_n_layer(model)) *
+           static_cast<size_t>(llama_n_embd(model)) * 2 * sizeof(uint16_t);
+}
+
+static SharedModelCache g_model_cache;
+
 class LlamaCPPInterface {
 private:
-    struct llama_model* model;
+    struct llama_model* model;              // weights.get()
+    std::shared_ptr<llama_model> weights;
+    std::string model_path;
     struct llama_context* ctx;
     std::mutex model_mutex;
     std::atomic<bool> model_loaded{false};
     int n_threads;
+    int n_threads_batch;
     int n_ctx;
     int n_batch;
     
@@ -28,11 +646,31 @@ private:
     bool use_mlock;
     bool use_cpu_optimizations;
     
-    // Performance monitoring
+    // Thread placement (set_cpu_placement). With pin_threads the context
+    // decodes on ggml threadpools pinned to cpu_topology::placement();
+    // prompt processing gets its own pool when its thread count differs.
+    int numa_node = -1;
+    bool pin_threads = false;
+    bool threads_set = false;
+    ggml_threadpool* threadpool = nullptr;
+    ggml_threadpool* threadpool_batch = nullptr;
+    
+    // Performance monitoring. Decode time is split between prompt
+    // processing and generation by each batch's share of tokens; latencies
+    // are measured on the scheduler thread when tokens are sampled.
     std::atomic<uint64_t> total_generations{0};
     std::atomic<uint64_t> total_tokens{0};
     std::atomic<double> total_time{0.0};
     std::chrono::high_resolution_clock::time_point start_time;
+    std::atomic<uint64_t> prompt_eval_tokens{0};  // Prompt tokens decoded (not reused from a prefix)
+    std::atomic<double> prompt_eval_time{0.0};
+    std::atomic<uint64_t> decode_tokens{0};       // Tokens of generating sequences, drafts included
+    std::atomic<double> decode_time{0.0};
+    std::atomic<uint64_t> generated_tokens{0};    // Sampled, counted as they are produced
+    std::atomic<uint64_t> decode_steps{0};
+    LatencyHistogram ttft_histogram;              // Submission to first token
+    LatencyHistogram token_latency_histogram;     // Between tokens of one sequence
+    int batch_prompt_tokens = 0;                  // Prompt tokens in the current batch
     
     // Thread pool for parallel processing
     std::vector<std::thread> worker_threads;
@@ -41,14 +679,74 @@ private:
     std::condition_variable queue_cv;
     std::atomic<bool> stop_workers{false};
     
+    // Sampling defaults and detokenized vocabulary
+    SamplingParams default_params;
+    std::vector<std::string> token_pieces;
+    
+    // Continuous batching: prompts wait in pending_requests until a slot and
+    // enough KV cells are free, then decode together in one llama_batch
+    int n_parallel;
+    std::vector<SequenceSlot> slots;
+    std::deque<std::unique_ptr<GenerationRequest>> pending_requests;
+    std::mutex request_mutex;
+    std::condition_variable request_cv;
+    std::thread scheduler_thread;
+    bool stop_scheduler = false;
+    
+    // reconfigure() pauses admission and waits on idle_cv until running
+    // sequences have finished before it touches the context
+    bool scheduler_paused = false;
+    bool scheduler_idle = false;
+    std::condition_variable idle_cv;
+    llama_batch batch;
+    int kv_reserved = 0;
+    
+    // Speculative decoding (load_draft_model): a small model with the same
+    // vocabulary proposes up to n_draft tokens for every running sequence
+    // and the next batched decode verifies them all. Draft sequence i
+    // mirrors slot i. Used by the scheduler thread, or with it paused.
+    std::shared_ptr<llama_model> draft_weights;
+    std::string draft_path;
+    llama_context* draft_ctx = nullptr;
+    llama_batch draft_batch;
+    int n_draft = 0;
+    std::atomic<uint64_t> spec_steps{0};       // Sequence steps that verified drafted tokens
+    std::atomic<uint64_t> spec_drafted{0};
+    std::atomic<uint64_t> spec_accepted{0};
+    std::atomic<double> spec_draft_time{0.0};
+    
+    // Prompt prefix reuse. Finished sequences keep their KV cells so a new
+    // prompt continues from the longest matching prefix of any sequence;
+    // snapshots (cache_prefix, load_prefix_cache) restore state without
+    // decoding. Guarded by request_mutex.
+    std::vector<PrefixEntry> prefix_entries;
+    size_t prefix_cache_bytes = 0;
+    size_t prefix_cache_limit = size_t(1) << 30;
+    uint64_t use_counter = 0;
+    uint64_t prefix_hits = 0;
+    uint64_t prefix_tokens_reused = 0;
+    uint64_t prompt_tokens_total = 0;
+    
+    static constexpr uint32_t kPrefixCacheMagic = 0x43504643;  // "CFPC"
+    static constexpr uint32_t kPrefixCacheVersion = 1;
+    
+    // Memory budget: contexts and snapshots are charged while held, and
+    // snapshots are shed when the process nears its budget
+    memory_budget::Charge kv_charge{memory_budget::Category::KV_CACHE};
+    memory_budget::Charge draft_kv_charge{memory_budget::Category::KV_CACHE};
+    memory_budget::Charge prefix_charge{memory_budget::Category::PREFIX_CACHE};
+    int reclaimer_id = 0;
+    
 public:
     LlamaCPPInterface() : model(nullptr), ctx(nullptr), n_threads(std::thread::hardware_concurrency()) {
-        // Initialize llama.cpp backend
-        llama_backend_init();
+        // Initialize llama.cpp backend once for every interface in the process
+        static std::once_flag backend_once;
+        std::call_once(backend_once, []() { llama_backend_init(); });
         
         // Set CPU optimization parameters
         n_ctx = 2048;  // Context size
         n_batch = 512; // Batch size for processing
+        n_parallel = 4; // Sequences decoded together
         use_mmap = true;
         use_mlock = false;
         use_cpu_optimizations = true;
@@ -61,9 +759,15 @@ public:
         
         // Initialize thread pool for parallel processing
         initialize_thread_pool();
+        
+        reclaimer_id = memory_budget::add_reclaimer("llama_prefix_cache", 10, [this](size_t bytes) {
+            return shed_prefix_cache(bytes);
+        });
     }
     
     ~LlamaCPPInterface() {
+        memory_budget::remove_reclaimer(reclaimer_id);
+        
         // Stop worker threads
         stop_workers = true;
         queue_cv.notify_all();
@@ -74,139 +778,444 @@ public:
             }
         }
         
+        stop_batch_scheduler();
+        
+        free_draft();
         if (ctx) {
+            llama_batch_free(batch);
             llama_free(ctx);
         }
-        if (model) {
-            llama_free_model(model);
-        }
-        llama_backend_free();
+        free_threadpools();
     }
     
-    bool load_model(const std::string& model_path) {
+    bool load_model(const std::string& path, int parallel = 0) {
         std::lock_guard<std::mutex> lock(model_mutex);
         
         if (model_loaded) {
             return true;
         }
         
+        // The context was lost in a failed reconfigure(); the model and
+        // scheduler are still there
+        if (model) {
+            std::lock_guard<std::mutex> request_lock(request_mutex);
+            model_loaded = create_context();
+            return model_loaded;
+        }
+        
+        if (parallel > 0) {
+            n_parallel = parallel;
+        }
+        
         // Model parameters
         llama_model_params model_params = llama_model_default_params();
         model_params.use_mmap = use_mmap;
         model_params.use_mlock = use_mlock;
         
-        // Load model
-        model = llama_load_model_from_file(model_path.c_str(), model_params);
+        // On a chosen node, load from a thread pinned there so ggml isolates
+        // to it and the weights are first touched (and so allocated) there
+        bool node_pinned = numa_node >= 0 && cpu_topology::pin_current_thread_to_node(numa_node);
+        init_numa();
+        
+        // Load model, or share weights another interface already mapped
+        weights = g_model_cache.acquire(path, model_params);
+        model = weights.get();
+        if (node_pinned) {
+            cpu_topology::unpin_current_thread();
+        }
         if (!model) {
-            std::cerr << "Failed to load model: " << model_path << std::endl;
+            std::cerr << "Failed to load model: " << path << std::endl;
             return false;
         }
         
-        // Context parameters
-        llama_context_params ctx_params = llama_context_default_params();
-        ctx_params.seed = 1234;
-        ctx_params.ctx_size = n_ctx;
-        ctx_params.batch_size = n_batch;
-        ctx_params.threads = n_threads;
-        ctx_params.threads_batch = n_threads;
-        ctx_params.mul_mat_q = true;  // Enable quantized matrix multiplication
-        ctx_params.f16_kv = true;     // Use 16-bit key-value cache
-        ctx_params.logits_all = false;
-        ctx_params.embedding = false;
-        
-        // Create context
-        ctx = llama_new_context_with_model(model, ctx_params);
-        if (!ctx) {
+        if (!create_context()) {
             std::cerr << "Failed to create context" << std::endl;
-            llama_free_model(model);
+            weights.reset();
             model = nullptr;
             return false;
         }
         
+        // Snapshots only restore into the model they were taken from
+        if (path != model_path) {
+            std::lock_guard<std::mutex> request_lock(request_mutex);
+            prefix_entries.clear();
+            prefix_cache_bytes = 0;
+            prefix_charge.set(0);
+            model_path = path;
+        }
+        ensure_token_pieces();
+        start_batch_scheduler();
+        
         model_loaded = true;
-        std::cout << "Model loaded successfully with " << n_threads << " threads" << std::endl;
+        std::cout << "Model loaded successfully with " << n_threads << (threadpool ? " pinned" : "") << " threads, "
+                  << n_parallel << " parallel sequences"
+                  << (numa_node >= 0 ? " on NUMA node " + std::to_string(numa_node) : std::string()) << std::endl;
         return true;
     }
     
-    std::string generate_text(const std::string& prompt, int max_tokens = 100, float temperature = 0.7f) {
-        if (!model_loaded || !ctx) {
-            return "Error: Model not loaded";
+    // Free the context and this interface's reference to the weights (they
+    // stay mapped while another interface shares them). Queued and running
+    // requests fail. Prefix snapshots are kept for the next load_model of
+    // the same file.
+    void unload() {
+        std::lock_guard<std::mutex> lock(model_mutex);
+        if (!model) {
+            return;
         }
         
-        auto start_time = std::chrono::high_resolution_clock::now();
-        std::lock_guard<std::mutex> lock(model_mutex);
+        model_loaded = false;
+        stop_batch_scheduler();
+        free_draft();
+        if (ctx) {
+            llama_batch_free(batch);
+            llama_free(ctx);
+            ctx = nullptr;
+        }
+        kv_charge.set(0);
+        free_threadpools();
+        kv_reserved = 0;
+        token_pieces.clear();
+        weights.reset();
+        model = nullptr;
+    }
+    
+    std::string generate_text(const std::string& prompt, int max_tokens, const SamplingParams& params) {
+        if (!model_loaded) {
+            return "Error: Model not loaded";
+        }
         
-        // Tokenize prompt
-        std::vector<llama_token> tokens_list;
-        tokens_list.resize(prompt.length() + 1);
+        return submit(prompt, max_tokens, params).get();
+    }
+    
+    // Queue a prompt for the batch scheduler; the future yields the
+    // completion (or an "Error: ..." string, as generate_text does). Setting
+    // `cancel` ends the generation early with the text so far.
+    std::future<std::string> submit(const std::string& prompt, int max_tokens, const SamplingParams& params,
+                                    std::shared_ptr<TokenStream> stream = nullptr,
+                                    std::shared_ptr<std::atomic<bool>> cancel = nullptr) {
+        auto request = std::make_unique<GenerationRequest>();
+        std::future<std::string> result = request->result.get_future();
+        request->stream = std::move(stream);
+        request->cancel = std::move(cancel);
         
-        int n_tokens = llama_tokenize(model, prompt.c_str(), prompt.length(), 
-                                    tokens_list.data(), tokens_list.size(), true, false);
-        if (n_tokens < 0) {
-            tokens_list.resize(-n_tokens);
-            n_tokens = llama_tokenize(model, prompt.c_str(), prompt.length(), 
-                                    tokens_list.data(), tokens_list.size(), true, false);
+        if (!model_loaded) {
+            request->finish("Error: Model not loaded", true);
+            return result;
         }
-        tokens_list.resize(n_tokens);
         
-        // Evaluate prompt
-        if (llama_decode(ctx, llama_batch_get_one(tokens_list.data(), n_tokens, 0, 0)) != 0) {
-            return "Error: Failed to evaluate prompt";
-        }
+        request->prompt = tokenize(prompt);
+        request->max_tokens = max_tokens;
+        request->params = params;
+        request->submitted = std::chrono::high_resolution_clock::now();
         
-        // Generate text
-        std::string result;
-        for (int i = 0; i < max_tokens; ++i) {
-            llama_token new_token_id = 0;
-            
-            auto logits = llama_get_logits_ith(ctx, -1);
-            auto n_vocab = llama_n_vocab(model);
-            
-            // Apply temperature
-            std::vector<float> logits_processed(n_vocab);
-            for (int j = 0; j < n_vocab; ++j) {
-                logits_processed[j] = logits[j] / temperature;
-            }
-            
-            // Sample token
-            new_token_id = llama_sample_token_greedy(ctx);
-            
-            if (new_token_id == llama_token_eos(model)) {
-                break;
-            }
-            
-            // Convert token to string
-            char token_str[256];
-            int n_chars = llama_token_to_piece(model, new_token_id, token_str, sizeof(token_str), false);
-            if (n_chars > 0) {
-                result += std::string(token_str, n_chars);
-            }
-            
-            // Evaluate new token
-            if (llama_decode(ctx, llama_batch_get_one(&new_token_id, 1, 0, 0)) != 0) {
-                break;
-            }
+        if (max_tokens <= 0) {
+            request->finish("");
+            return result;
         }
         
-        // Update performance statistics
-        auto end_time = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count() / 1000.0;
-        int tokens_generated = result.length() / 4;  // Rough token estimation
-        update_performance_stats(tokens_generated, duration);
-        
+        enqueue(std::move(request));
         return result;
     }
     
-    void set_threads(int threads) {
-        n_threads = std::max(1, threads);
-        if (model_loaded) {
-            // Context would need to be recreated to change thread count
-            std::cout << "Thread count set to " << n_threads << " (requires model reload)" << std::endl;
+    // Decode `text` and keep its KV state as a prefix snapshot. Returns the
+    // number of tokens cached (0 on failure, with `error` set).
+    size_t cache_prefix(const std::string& text, std::string& error) {
+        if (!model_loaded) {
+            error = "Model not loaded";
+            return 0;
         }
+        
+        auto request = std::make_unique<GenerationRequest>();
+        std::future<std::string> result = request->result.get_future();
+        request->prompt = tokenize(text);
+        request->snapshot_prefix = true;
+        request->submitted = std::chrono::high_resolution_clock::now();
+        size_t n_tokens = request->prompt.size();
+        
+        enqueue(std::move(request));
+        error = result.get();
+        return error.empty() ? n_tokens : 0;
     }
     
-    int get_threads() const {
-        return n_threads;
+    // Snapshot file: header identifying the model, then per entry the
+    // token count, tokens, state size and llama_state_seq_get_data bytes
+    bool save_prefix_cache(const std::string& path, size_t& count, std::string& error) {
+        std::lock_guard<std::mutex> lock(request_mutex);
+        
+        std::ofstream file(path, std::ios::binary);
+        if (!file) {
+            error = "Cannot open " + path;
+            return false;
+        }
+        
+        uint32_t header[3] = {kPrefixCacheMagic, kPrefixCacheVersion, static_cast<uint32_t>(prefix_entries.size())};
+        uint64_t model_id[2] = {llama_model_n_params(model), static_cast<uint64_t>(llama_n_vocab(model))};
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(model_id), sizeof(model_id));
+        
+        for (const auto& entry : prefix_entries) {
+            uint64_t sizes[2] = {entry.tokens.size(), entry.state.size()};
+            file.write(reinterpret_cast<const char*>(sizes), sizeof(sizes));
+            file.write(reinterpret_cast<const char*>(entry.tokens.data()), entry.tokens.size() * sizeof(llama_token));
+            file.write(reinterpret_cast<const char*>(entry.state.data()), entry.state.size());
+        }
+        
+        count = prefix_entries.size();
+        if (!file) {
+            error = "Failed writing " + path;
+            return false;
+        }
+        return true;
+    }
+    
+    bool load_prefix_cache(const std::string& path, size_t& count, std::string& error) {
+        if (!model_loaded) {
+            error = "Model not loaded";
+            return false;
+        }
+        
+        std::ifstream file(path, std::ios::binary);
+        uint32_t header[3];
+        uint64_t model_id[2];
+        if (!file || !file.read(reinterpret_cast<char*>(header), sizeof(header)) ||
+            !file.read(reinterpret_cast<char*>(model_id), sizeof(model_id)) ||
+            header[0] != kPrefixCacheMagic || header[1] != kPrefixCacheVersion) {
+            error = "Not a prefix cache file: " + path;
+            return false;
+        }
+        if (model_id[0] != llama_model_n_params(model) || model_id[1] != static_cast<uint64_t>(llama_n_vocab(model))) {
+            error = "Prefix cache was saved for a different model";
+            return false;
+        }
+        
+        std::vector<PrefixEntry> loaded(header[2]);
+        for (auto& entry : loaded) {
+            uint64_t sizes[2];
+            if (!file.read(reinterpret_cast<char*>(sizes), sizeof(sizes)) || sizes[0] > (1u << 24) || sizes[1] > (uint64_t(1) << 40)) {
+                error = "Truncated prefix cache file: " + path;
+                return false;
+            }
+            entry.tokens.resize(sizes[0]);
+            entry.state.resize(sizes[1]);
+            if (!file.read(reinterpret_cast<char*>(entry.tokens.data()), sizes[0] * sizeof(llama_token)) ||
+                !file.read(reinterpret_cast<char*>(entry.state.data()), sizes[1])) {
+                error = "Truncated prefix cache file: " + path;
+                return false;
+            }
+        }
+        
+        std::lock_guard<std::mutex> lock(request_mutex);
+        count = 0;
+        for (auto& entry : loaded) {
+            count += add_prefix_entry(std::move(entry));
+        }
+        return true;
+    }
+    
+    void clear_prefix_cache() {
+        std::lock_guard<std::mutex> lock(request_mutex);
+        prefix_entries.clear();
+        prefix_cache_bytes = 0;
+        prefix_charge.set(0);
+    }
+    
+    void set_prefix_cache_limit(size_t bytes) {
+        std::lock_guard<std::mutex> lock(request_mutex);
+        prefix_cache_limit = bytes;
+        trim_prefix_cache(prefix_cache_limit);
+    }
+    
+    // Budget reclaimer: drop least recently used snapshots. Skipped while
+    // the scheduler holds request_mutex; it is released between steps.
+    size_t shed_prefix_cache(size_t bytes) {
+        std::unique_lock<std::mutex> lock(request_mutex, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            return 0;
+        }
+        size_t before = prefix_cache_bytes;
+        trim_prefix_cache(before > bytes ? before - bytes : 0);
+        return before - prefix_cache_bytes;
+    }
+    
+    std::map<std::string, double> get_prefix_cache_stats() {
+        std::lock_guard<std::mutex> lock(request_mutex);
+        std::map<std::string, double> stats;
+        stats["entries"] = static_cast<double>(prefix_entries.size());
+        stats["bytes"] = static_cast<double>(prefix_cache_bytes);
+        stats["limit_bytes"] = static_cast<double>(prefix_cache_limit);
+        stats["hits"] = static_cast<double>(prefix_hits);
+        stats["tokens_reused"] = static_cast<double>(prefix_tokens_reused);
+        stats["prompt_tokens"] = static_cast<double>(prompt_tokens_total);
+        return stats;
+    }
+    
+    int get_parallel() const {
+        return n_parallel;
+    }
+    
+    void set_default_params(const SamplingParams& params) {
+        std::lock_guard<std::mutex> lock(model_mutex);
+        default_params = params;
+    }
+    
+    SamplingParams get_default_params() {
+        std::lock_guard<std::mutex> lock(model_mutex);
+        return default_params;
+    }
+    
+    // Change context settings without reloading the model. Thread counts
+    // apply to the live context (repinning its threadpools) between decode
+    // steps. A new n_ctx or n_batch rebuilds the context on the same mapped
+    // weights: running sequences finish first while queued ones wait, then
+    // the old context is freed before the new one is allocated, so cached
+    // KV cells are dropped (prefix snapshots are kept). If the new context
+    // cannot be created the previous settings are restored and `error` is
+    // set. Before load_model the values are only stored.
+    bool reconfigure(ContextSettings settings, std::string& error) {
+        std::lock_guard<std::mutex> lock(model_mutex);
+        
+        settings.n_ctx = settings.n_ctx > 0 ? settings.n_ctx : n_ctx;
+        settings.n_batch = settings.n_batch > 0 ? settings.n_batch : n_batch;
+        settings.n_threads = settings.n_threads > 0 ? settings.n_threads : n_threads;
+        settings.n_threads_batch = settings.n_threads_batch > 0 ? settings.n_threads_batch : n_threads_batch;
+        
+        bool rebuild = settings.n_ctx != n_ctx || settings.n_batch != n_batch;
+        bool rethread = settings.n_threads != n_threads || settings.n_threads_batch != n_threads_batch;
+        if (rethread) {
+            threads_set = true;
+        }
+        if (!model_loaded) {
+            n_ctx = settings.n_ctx;
+            n_batch = settings.n_batch;
+            n_threads = settings.n_threads;
+            n_threads_batch = settings.n_threads_batch;
+            return true;
+        }
+        if (!rebuild && !rethread) {
+            return true;
+        }
+        
+        std::unique_lock<std::mutex> request_lock = pause_scheduler();
+        bool ok = true;
+        if (rebuild) {
+            ok = rebuild_context(settings, error);
+        } else {
+            n_threads = settings.n_threads;
+            n_threads_batch = settings.n_threads_batch;
+            if (threadpool) {
+                attach_threadpools();
+            } else {
+                llama_set_n_threads(ctx, n_threads, n_threads_batch);
+                if (draft_ctx) {
+                    llama_set_n_threads(draft_ctx, n_threads, n_threads_batch);
+                }
+            }
+        }
+        
+        resume_scheduler(request_lock);
+        return ok;
+    }
+    
+    // Speculate with a draft model for every request on this interface.
+    // The draft must share the main model's vocabulary; its weights come
+    // from the shared cache, so a registry handle on the same file costs
+    // no second mapping.
+    bool load_draft_model(const std::string& path, int tokens, std::string& error) {
+        std::lock_guard<std::mutex> lock(model_mutex);
+        if (!model_loaded) {
+            error = "Load the main model before a draft model";
+            return false;
+        }
+        
+        llama_model_params model_params = llama_model_default_params();
+        model_params.use_mmap = use_mmap;
+        model_params.use_mlock = use_mlock;
+        std::shared_ptr<llama_model> weights_draft = g_model_cache.acquire(path, model_params);
+        if (!weights_draft) {
+            error = "Failed to load draft model: " + path;
+            return false;
+        }
+        if (llama_n_vocab(weights_draft.get()) != llama_n_vocab(model) ||
+            llama_token_eos(weights_draft.get()) != llama_token_eos(model)) {
+            error = "Draft model vocabulary does not match the main model";
+            return false;
+        }
+        
+        std::unique_lock<std::mutex> request_lock = pause_scheduler();
+        free_draft();
+        draft_weights = std::move(weights_draft);
+        draft_path = path;
+        n_draft = std::max(1, tokens);
+        bool ok = create_draft_context();
+        if (!ok) {
+            error = "Failed to create draft context";
+            free_draft();
+        }
+        resume_scheduler(request_lock);
+        
+        if (ok) {
+            std::cout << "Speculative decoding with " << path << ", " << n_draft << " draft tokens" << std::endl;
+        }
+        return ok;
+    }
+    
+    void unload_draft_model() {
+        std::lock_guard<std::mutex> lock(model_mutex);
+        if (!draft_weights) {
+            return;
+        }
+        std::unique_lock<std::mutex> request_lock = pause_scheduler();
+        free_draft();
+        resume_scheduler(request_lock);
+    }
+    
+    std::string get_draft_path() {
+        std::lock_guard<std::mutex> lock(model_mutex);
+        return draft_path;
+    }
+    
+    int get_draft_tokens() {
+        std::lock_guard<std::mutex> lock(model_mutex);
+        return n_draft;
+    }
+    
+    ContextSettings get_context_settings() {
+        std::lock_guard<std::mutex> lock(model_mutex);
+        ContextSettings settings;
+        settings.n_ctx = n_ctx;
+        settings.n_batch = n_batch;
+        settings.n_threads = n_threads;
+        settings.n_threads_batch = n_threads_batch;
+        return settings;
+    }
+    
+    bool threads_pinned() {
+        std::lock_guard<std::mutex> lock(model_mutex);
+        return threadpool != nullptr;
+    }
+    
+    int get_threads() {
+        std::lock_guard<std::mutex> lock(model_mutex);
+        return n_threads;
+    }
+    
+    // Choose where inference threads run; takes effect at load_model. A
+    // node >= 0 keeps threads and model pages on that NUMA node, so one
+    // process per node each gets local memory bandwidth. Unless
+    // set_threads() was called, the thread count follows the node's
+    // physical cores. False once a model is loaded.
+    bool set_cpu_placement(int node, bool pin) {
+        std::lock_guard<std::mutex> lock(model_mutex);
+        if (model_loaded) {
+            return false;
+        }
+        numa_node = node;
+        pin_threads = pin;
+        if (!threads_set) {
+            n_threads = cpu_topology::recommended_threads(numa_node);
+            n_threads_batch = n_threads;
+        }
+        return true;
     }
     
     bool is_loaded() const {
@@ -226,15 +1235,237 @@ private:
         ggml_cpu_has_sse4_2();
         ggml_cpu_has_popcnt();
         
-        // Set optimal thread count based on CPU cores
-        n_threads = std::thread::hardware_concurrency();
-        if (n_threads > 8) {
-            n_threads = 8;  // Cap at 8 threads for optimal performance
-        }
+        // One thread per physical performance core: SMT siblings and
+        // E-cores only slow down the synchronised matmul threads
+        n_threads = cpu_topology::recommended_threads();
+        n_threads_batch = n_threads;
         
         std::cout << "CPU optimizations configured for " << n_threads << " threads" << std::endl;
     }
     
+    // ggml's NUMA mode is process-wide and set once: isolate to the node
+    // the loading thread is pinned to, or spread threads over all nodes
+    void init_numa() {
+        static std::once_flag once;
+        std::call_once(once, [this]() {
+            if (cpu_topology::get().numa_nodes > 1) {
+                llama_numa_init(numa_node >= 0 ? GGML_NUMA_STRATEGY_ISOLATE : GGML_NUMA_STRATEGY_DISTRIBUTE);
+            }
+        });
+    }
+    
+    // Stop admitting requests and wait for running sequences to finish.
+    // Returns holding request_mutex, so the context and slots can change
+    // until resume_scheduler(). Called with model_mutex held.
+    std::unique_lock<std::mutex> pause_scheduler() {
+        std::unique_lock<std::mutex> request_lock(request_mutex);
+        scheduler_paused = true;
+        scheduler_idle = false;
+        request_cv.notify_all();
+        idle_cv.wait(request_lock, [this] { return scheduler_idle || stop_scheduler; });
+        return request_lock;
+    }
+    
+    void resume_scheduler(std::unique_lock<std::mutex>& request_lock) {
+        scheduler_paused = false;
+        scheduler_idle = false;
+        request_lock.unlock();
+        request_cv.notify_all();
+    }
+    
+    // Draft context with the main context's size, sequences and threads
+    bool create_draft_context() {
+        llama_context_params ctx_params = llama_context_default_params();
+        ctx_params.n_ctx = n_ctx;
+        ctx_params.n_batch = n_batch;
+        ctx_params.n_threads = n_threads;
+        ctx_params.n_threads_batch = n_threads_batch;
+        ctx_params.n_seq_max = n_parallel;
+        ctx_params.logits_all = false;
+        ctx_params.embeddings = false;
+        
+        size_t kv_bytes = estimate_kv_bytes(draft_weights.get(), n_ctx);
+        if (!memory_budget::admit(kv_bytes)) {
+            std::cerr << "Draft KV cache (" << kv_bytes / (1024 * 1024) << " MB) does not fit the memory budget" << std::endl;
+            return false;
+        }
+        draft_ctx = llama_new_context_with_model(draft_weights.get(), ctx_params);
+        if (!draft_ctx) {
+            return false;
+        }
+        draft_kv_charge.set(kv_bytes);
+        if (threadpool) {
+            llama_attach_threadpool(draft_ctx, threadpool, threadpool_batch ? threadpool_batch : threadpool);
+        }
+        draft_batch = llama_batch_init(n_batch, 0, 1);
+        return true;
+    }
+    
+    void free_draft_context() {
+        if (draft_ctx) {
+            llama_batch_free(draft_batch);
+            llama_free(draft_ctx);
+            draft_ctx = nullptr;
+        }
+        draft_kv_charge.set(0);
+        for (auto& slot : slots) {
+            slot.draft.clear();
+            slot.draft_kv.clear();
+        }
+    }
+    
+    void free_draft() {
+        free_draft_context();
+        draft_weights.reset();
+        draft_path.clear();
+        n_draft = 0;
+    }
+    
+    // Context on the loaded model with the current settings, plus its
+    // batch and pinned threadpools. Called with model_mutex held.
+    bool create_context() {
+        llama_context_params ctx_params = llama_context_default_params();
+        ctx_params.n_ctx = n_ctx;
+        ctx_params.n_batch = n_batch;
+        ctx_params.n_threads = n_threads;
+        ctx_params.n_threads_batch = n_threads_batch;
+        ctx_params.n_seq_max = n_parallel;
+        ctx_params.logits_all = false;
+        ctx_params.embeddings = false;
+        
+        size_t kv_bytes = estimate_kv_bytes(model, n_ctx);
+        if (!memory_budget::admit(kv_bytes)) {
+            std::cerr << "KV cache for n_ctx=" << n_ctx << " (" << kv_bytes / (1024 * 1024)
+                      << " MB) does not fit the memory budget" << std::endl;
+            return false;
+        }
+        ctx = llama_new_context_with_model(model, ctx_params);
+        if (!ctx) {
+            return false;
+        }
+        kv_charge.set(kv_bytes);
+        
+        if (pin_threads) {
+            attach_threadpools();
+        }
+        
+        batch = llama_batch_init(n_batch, 0, 1);
+        return true;
+    }
+    
+    // Replace the context for a new n_ctx or n_batch. Called by
+    // reconfigure() with the scheduler idle and request_mutex held.
+    bool rebuild_context(const ContextSettings& settings, std::string& error) {
+        const ContextSettings previous = {n_ctx, n_batch, n_threads, n_threads_batch};
+        
+        free_draft_context();
+        llama_batch_free(batch);
+        llama_free(ctx);
+        ctx = nullptr;
+        kv_charge.set(0);
+        
+        // KV cells went with the old context
+        for (auto& slot : slots) {
+            slot.kv_tokens.clear();
+        }
+        kv_reserved = 0;
+        
+        n_ctx = settings.n_ctx;
+        n_batch = settings.n_batch;
+        n_threads = settings.n_threads;
+        n_threads_batch = settings.n_threads_batch;
+        if (create_context()) {
+            std::cout << "Context rebuilt with n_ctx=" << n_ctx << ", n_batch=" << n_batch << std::endl;
+            rebuild_draft_context();
+            return true;
+        }
+        
+        error = "Failed to create a context with n_ctx=" + std::to_string(n_ctx) +
+                " and n_batch=" + std::to_string(n_batch);
+        n_ctx = previous.n_ctx;
+        n_batch = previous.n_batch;
+        n_threads = previous.n_threads;
+        n_threads_batch = previous.n_threads_batch;
+        if (create_context()) {
+            rebuild_draft_context();
+            return false;
+        }
+        
+        // Without any context, answer queued requests rather than strand them
+        error += "; restoring the previous context also failed";
+        free_draft();
+        model_loaded = false;
+        for (auto& request : pending_requests) {
+            request->finish("Error: Model not loaded", true);
+        }
+        pending_requests.clear();
+        return false;
+    }
+    
+    void rebuild_draft_context() {
+        if (draft_weights && !create_draft_context()) {
+            std::cerr << "Failed to recreate draft context; speculative decoding disabled" << std::endl;
+            free_draft();
+        }
+    }
+    
+    ggml_threadpool* new_pinned_threadpool(int count) {
+        ggml_threadpool_params tp_params = ggml_threadpool_params_default(count);
+        for (int cpu : cpu_topology::placement(count, numa_node)) {
+            if (cpu < GGML_MAX_N_THREADS) {
+                tp_params.cpumask[cpu] = true;
+            }
+        }
+        // Strict: thread i takes the i-th CPU of the mask
+        tp_params.strict_cpu = true;
+        return ggml_threadpool_new(&tp_params);
+    }
+    
+    // (Re)create pinned pools for the current thread counts and attach them.
+    // Both start at the first placement CPUs; they never run at once since
+    // one context decodes either a prompt batch or a generation step.
+    void attach_threadpools() {
+        ggml_threadpool* old_pool = threadpool;
+        ggml_threadpool* old_batch_pool = threadpool_batch;
+        
+        threadpool = new_pinned_threadpool(n_threads);
+        threadpool_batch = n_threads_batch != n_threads ? new_pinned_threadpool(n_threads_batch) : nullptr;
+        
+        if (threadpool && (threadpool_batch || n_threads_batch == n_threads)) {
+            llama_attach_threadpool(ctx, threadpool, threadpool_batch ? threadpool_batch : threadpool);
+            if (draft_ctx) {
+                llama_attach_threadpool(draft_ctx, threadpool, threadpool_batch ? threadpool_batch : threadpool);
+            }
+        } else {
+            std::cerr << "Failed to create pinned threadpool; using default threads" << std::endl;
+            llama_detach_threadpool(ctx);
+            llama_set_n_threads(ctx, n_threads, n_threads_batch);
+            if (draft_ctx) {
+                llama_detach_threadpool(draft_ctx);
+                llama_set_n_threads(draft_ctx, n_threads, n_threads_batch);
+            }
+            free_threadpools();
+        }
+        
+        if (old_pool) {
+            ggml_threadpool_free(old_pool);
+        }
+        if (old_batch_pool) {
+            ggml_threadpool_free(old_batch_pool);
+        }
+    }
+    
+    void free_threadpools() {
+        if (threadpool) {
+            ggml_threadpool_free(threadpool);
+            threadpool = nullptr;
+        }
+        if (threadpool_batch) {
+            ggml_threadpool_free(threadpool_batch);
+            threadpool_batch = nullptr;
+        }
+    }
+    
     void initialize_thread_pool() {
         // Initialize worker threads for parallel processing
         int num_workers = std::min(n_threads, 4);  // Limit to 4 workers
@@ -271,152 +1502,3544 @@ private:
         }
     }
     
-    void submit_task(std::function<void()> task) {
+    // Tokenize into worst-case sized scratch from the thread's arena and
+    // copy out only the tokens produced, so queued prompts hold no slack
+    std::vector<llama_token> tokenize(const std::string& text) {
+        memory_arena::Scope scratch;
+        memory_arena::ArenaVector<llama_token> tokens_list(text.length() + 1, 0,
+                                                           memory_arena::ArenaAllocator<llama_token>(scratch.arena()));
+        
+        int n_tokens = llama_tokenize(model, text.c_str(), text.length(),
+                                      tokens_list.data(), tokens_list.size(), true, false);
+        if (n_tokens < 0) {
+            tokens_list.resize(-n_tokens);
+            n_tokens = llama_tokenize(model, text.c_str(), text.length(),
+                                      tokens_list.data(), tokens_list.size(), true, false);
+        }
+        return std::vector<llama_token>(tokens_list.begin(), tokens_list.begin() + std::max(0, n_tokens));
+    }
+    
+    void enqueue(std::unique_ptr<GenerationRequest> request) {
         {
-            std::lock_guard<std::mutex> lock(queue_mutex);
-            task_queue.push(task);
+            std::lock_guard<std::mutex> lock(request_mutex);
+            if (stop_scheduler) {
+                request->finish("Error: Interface shutting down", true);
+                return;
+            }
+            if (!model_loaded) {
+                request->finish("Error: Model not loaded", true);
+                return;
+            }
+            pending_requests.push_back(std::move(request));
         }
-        queue_cv.notify_one();
+        request_cv.notify_one();
     }
     
-    void update_performance_stats(int tokens_generated, double generation_time) {
-        total_generations++;
-        total_tokens += tokens_generated;
-        total_time += generation_time;
+    void start_batch_scheduler() {
+        slots = std::vector<SequenceSlot>(n_parallel);
+        stop_scheduler = false;
+        scheduler_thread = std::thread([this]() {
+            tracing::set_thread_name("llama-scheduler");
+            scheduler_loop();
+        });
     }
     
-    std::map<std::string, double> get_performance_stats() {
-        std::map<std::string, double> stats;
-        
-        auto current_time = std::chrono::high_resolution_clock::now();
-        auto uptime = std::chrono::duration_cast<std::chrono::seconds>(current_time - start_time).count();
-        
-        stats["total_generations"] = total_generations.load();
-        stats["total_tokens"] = total_tokens.load();
-        stats["total_time"] = total_time.load();
-        stats["uptime_seconds"] = uptime;
-        
-        if (total_time.load() > 0) {
-            stats["avg_tokens_per_second"] = total_tokens.load() / total_time.load();
-        } else {
-            stats["avg_tokens_per_second"] = 0.0;
+    void stop_batch_scheduler() {
+        {
+            std::lock_guard<std::mutex> lock(request_mutex);
+            stop_scheduler = true;
         }
+        request_cv.notify_all();
+        idle_cv.notify_all();
         
-        if (total_generations.load() > 0) {
-            stats["avg_generation_time"] = total_time.load() / total_generations.load();
-        } else {
-            stats["avg_generation_time"] = 0.0;
+        if (scheduler_thread.joinable()) {
+            scheduler_thread.join();
         }
-        
-        return stats;
     }
     
-    void reset_performance_stats() {
-        total_generations = 0;
-        total_tokens = 0;
-        total_time = 0.0;
-        start_time = std::chrono::high_resolution_clock::now();
-    }
-};
-
-// Global instance
-static std::unique_ptr<LlamaCPPInterface> g_llama_interface = nullptr;
-
-// Python C API functions
-static PyObject* init_llama_cpp(PyObject* self, PyObject* args) {
-    if (g_llama_interface) {
-        return PyBool_FromLong(1);
+    bool has_active_slots() const {
+        for (const auto& slot : slots) {
+            if (slot.active()) {
+                return true;
+            }
+        }
+        return false;
     }
     
-    g_llama_interface = std::make_unique<LlamaCPPInterface>();
-    return PyBool_FromLong(1);
-}
-
-static PyObject* load_model_cpp(PyObject* self, PyObject* args) {
-    const char* model_path;
-    
-    if (!PyArg_ParseTuple(args, "s", &model_path)) {
-        return nullptr;
+    void scheduler_loop() {
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(request_mutex);
+                request_cv.wait(lock, [this] {
+                    return stop_scheduler || has_active_slots() ||
+                           (scheduler_paused ? !scheduler_idle : !pending_requests.empty());
+                });
+                
+                if (stop_scheduler) {
+                    break;
+                }
+                if (!scheduler_paused) {
+                    admit_pending_requests();
+                } else if (!has_active_slots()) {
+                    // Hand the context to pause_scheduler() until it resumes us
+                    scheduler_idle = true;
+                    idle_cv.notify_all();
+                    continue;
+                }
+            }
+            
+            if (draft_ctx) {
+                draft_tokens();
+            }
+            if (!fill_batch()) {
+                continue;
+            }
+            
+            auto decode_start = std::chrono::high_resolution_clock::now();
+            uint64_t trace_start = tracing::now_ns();
+            int status = llama_decode(ctx, batch);
+            tracing::record(tracing::LLM, batch_prompt_tokens == batch.n_tokens ? "llama.prompt_eval" : "llama.decode",
+                            trace_start, tracing::now_ns(), batch.n_tokens);
+            record_decode_time(std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - decode_start).count());
+            if (status != 0) {
+                for (auto& slot : slots) {
+                    if (slot.active()) {
+                        slot.output = "Error: Failed to decode batch";
+                        slot.failed = true;
+                        finish_slot(static_cast<int>(&slot - slots.data()), false);
+                    }
+                }
+                continue;
+            }
+            
+            sample_slots();
+        }
+        
+        // Fail whatever is left so no caller waits forever
+        std::lock_guard<std::mutex> lock(request_mutex);
+        for (auto& slot : slots) {
+            if (slot.active()) {
+                slot.request->finish("Error: Interface shutting down", true);
+                slot.request.reset();
+            }
+        }
+        for (auto& request : pending_requests) {
+            request->finish("Error: Interface shutting down", true);
+        }
+        pending_requests.clear();
     }
     
-    if (!g_llama_interface) {
-        PyErr_SetString(PyExc_RuntimeError, "LlamaCPP interface not initialized");
+    // Move pending requests into free slots in FIFO order while their prompt
+    // plus max_tokens fit in the KV cells not reserved by running sequences
+    // or held by idle ones (evicted least recently used first). Called with
+    // request_mutex held.
+    void admit_pending_requests() {
+        const int ctx_limit = static_cast<int>(llama_n_ctx(ctx));
+        
+        // Requests cancelled while queued end without taking a slot
+        for (auto it = pending_requests.begin(); it != pending_requests.end();) {
+            if ((*it)->is_cancelled()) {
+                (*it)->finish("");
+                it = pending_requests.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        
+        while (!pending_requests.empty() && has_free_slot()) {
+            GenerationRequest& request = *pending_requests.front();
+            int prompt_size = static_cast<int>(request.prompt.size());
+            
+            // Answer requests that can never run without taking a slot
+            if (prompt_size == 0 || prompt_size >= ctx_limit) {
+                request.finish(prompt_size ? "Error: Prompt does not fit in the context" : "", prompt_size > 0);
+                pending_requests.pop_front();
+                continue;
+            }
+            
+            PrefixMatch match = find_prefix(request.prompt);
+            int target = choose_slot(match);
+            
+            // A request larger than the whole cache runs alone, truncated
+            int needed = prompt_size + request.max_tokens;
+            if (!make_room(needed, target, match.source_slot)) {
+                match = PrefixMatch();
+                if (!make_room(needed, target, -1)) {
+                    if (kv_reserved > 0) {
+                        break;
+                    }
+                    request.max_tokens = ctx_limit - prompt_size;
+                    needed = ctx_limit;
+                }
+            }
+            
+            slots[target].request = std::move(pending_requests.front());
+            pending_requests.pop_front();
+            start_slot(target, needed, match);
+        }
+    }
+    
+    bool has_free_slot() const {
+        for (const auto& slot : slots) {
+            if (!slot.active()) {
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    // Longest prefix of `prompt` held by a sequence or a snapshot. At least
+    // the last prompt token is always decoded, to get its logits.
+    PrefixMatch find_prefix(const std::vector<llama_token>& prompt) const {
+        PrefixMatch best;
+        size_t limit = prompt.size() - 1;
+        
+        for (size_t i = 0; i < slots.size(); ++i) {
+            size_t n = std::min(common_prefix(slots[i].kv_tokens, prompt), limit);
+            if (n > best.length) {
+                best.length = n;
+                best.source_slot = static_cast<int>(i);
+            }
+        }
+        
+        for (const auto& entry : prefix_entries) {
+            size_t n = std::min(common_prefix(entry.tokens, prompt), limit);
+            if (n > best.length) {
+                best.length = n;
+                best.source_slot = -1;
+                best.entry = &entry;
+            }
+        }
+        return best;
+    }
+    
+    // Reuse an idle source sequence in place, otherwise take the least
+    // recently used free slot
+    int choose_slot(const PrefixMatch& match) const {
+        if (match.source_slot >= 0 && !slots[match.source_slot].active()) {
+            return match.source_slot;
+        }
+        
+        int target = -1;
+        for (size_t i = 0; i < slots.size(); ++i) {
+            if (!slots[i].active() && (target < 0 || slots[i].last_used < slots[target].last_used)) {
+                target = static_cast<int>(i);
+            }
+        }
+        return target;
+    }
+    
+    // Evict idle sequences (other than `target` and `keep`) until `needed`
+    // cells fit; returns false if they still do not
+    bool make_room(int needed, int target, int keep) {
+        const int ctx_limit = static_cast<int>(llama_n_ctx(ctx));
+        
+        while (true) {
+            int held = 0;
+            int victim = -1;
+            for (size_t i = 0; i < slots.size(); ++i) {
+                const SequenceSlot& slot = slots[i];
+                if (slot.active() || static_cast<int>(i) == target) {
+                    continue;
+                }
+                held += static_cast<int>(slot.kv_tokens.size());
+                if (static_cast<int>(i) != keep && !slot.kv_tokens.empty() &&
+                    (victim < 0 || slot.last_used < slots[victim].last_used)) {
+                    victim = static_cast<int>(i);
+                }
+            }
+            
+            if (kv_reserved + held + needed <= ctx_limit) {
+                return true;
+            }
+            if (victim < 0) {
+                return false;
+            }
+            
+            llama_kv_cache_seq_rm(ctx, victim, -1, -1);
+            slots[victim].kv_tokens.clear();
+        }
+    }
+    
+    void start_slot(int seq_id, int reserved, const PrefixMatch& match) {
+        SequenceSlot& slot = slots[seq_id];
+        const GenerationRequest& request = *slot.request;
+        
+        if (tracing::enabled(tracing::LLM)) {
+            uint64_t now = tracing::now_ns();
+            uint64_t waited = static_cast<uint64_t>(std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::high_resolution_clock::now() - request.submitted).count()));
+            tracing::record_wait(tracing::LLM, "llama.queue_wait", now - std::min(waited, now), now,
+                                 static_cast<int64_t>(request.prompt.size()));
+        }
+        
+        slot.output.clear();
+        slot.failed = false;
+        slot.n_generated = 0;
+        slot.i_batch = -1;
+        slot.reserved = reserved;
+        kv_reserved += reserved;
+        
+        // Bring the matched prefix into this sequence, drop everything else
+        size_t n_reused = match.length;
+        if (match.source_slot == seq_id) {
+            llama_kv_cache_seq_rm(ctx, seq_id, static_cast<llama_pos>(n_reused), -1);
+        } else {
+            llama_kv_cache_seq_rm(ctx, seq_id, -1, -1);
+            if (match.source_slot >= 0) {
+                llama_kv_cache_seq_cp(ctx, match.source_slot, seq_id, 0, static_cast<llama_pos>(n_reused));
+            } else if (match.entry) {
+                if (llama_state_seq_set_data(ctx, match.entry->state.data(), match.entry->state.size(), seq_id) == 0) {
+                    llama_kv_cache_seq_rm(ctx, seq_id, -1, -1);
+                    n_reused = 0;
+                } else {
+                    llama_kv_cache_seq_rm(ctx, seq_id, static_cast<llama_pos>(n_reused), -1);
+                    const_cast<PrefixEntry*>(match.entry)->last_used = ++use_counter;
+                }
+            }
+        }
+        
+        slot.kv_tokens.assign(request.prompt.begin(), request.prompt.begin() + n_reused);
+        slot.n_prompt_done = n_reused;
+        slot.n_past = static_cast<int>(n_reused);
+        
+        prompt_tokens_total += request.prompt.size();
+        prefix_tokens_reused += n_reused;
+        prefix_hits += n_reused > 0;
+        
+        slot.constraint.reset();
+        if (request.params.grammar) {
+            slot.constraint = std::make_unique<GrammarConstraint>(request.params.grammar);
+        } else if (!request.params.allowed_chars.empty()) {
+            slot.constraint = std::make_unique<CharsetConstraint>(request.params.allowed_chars);
+        }
+        
+        if (request.params.seed >= 0) {
+            slot.sampler.seed(static_cast<uint64_t>(request.params.seed));
+        }
+        slot.sampler.reset(request.params, slot.constraint.get(), &token_pieces, llama_token_eos(model));
+        
+        int n_prompt = static_cast<int>(request.prompt.size());
+        for (int i = std::max(0, n_prompt - request.params.repeat_last_n); i < n_prompt; ++i) {
+            slot.sampler.remember(request.prompt[i]);
+        }
+    }
+    
+    void batch_add(llama_token token, llama_pos pos, llama_seq_id seq_id, bool logits) {
+        int i = batch.n_tokens++;
+        batch.token[i] = token;
+        batch.pos[i] = pos;
+        batch.n_seq_id[i] = 1;
+        batch.seq_id[i][0] = seq_id;
+        batch.logits[i] = logits;
+        slots[seq_id].kv_tokens.push_back(token);
+    }
+    
+    // Greedy proposals from the draft model: slot.draft gets up to n_draft
+    // tokens following each generating sequence's last_token. The draft
+    // sequence first catches up with the main one (after a prompt or a
+    // rejected proposal), then one batched draft decode per extra token.
+    void draft_tokens() {
+        tracing::Span span(tracing::LLM, "llama.draft");
+        auto start = std::chrono::high_resolution_clock::now();
+        const int n_vocab = llama_n_vocab(model);
+        
+        // Only generating sequences keep draft cells, so the draft cache
+        // never holds more than the main one has reserved
+        std::vector<int> drafting;
+        std::vector<int> limit(slots.size(), 0);
+        std::vector<size_t> pending(slots.size(), 0);
+        std::vector<std::vector<llama_token>> history(slots.size());
+        for (size_t i = 0; i < slots.size(); ++i) {
+            SequenceSlot& slot = slots[i];
+            slot.draft.clear();
+            if (!slot.active() || slot.prefilling() || slot.request->snapshot_prefix) {
+                if (!slot.draft_kv.empty()) {
+                    llama_kv_cache_seq_rm(draft_ctx, static_cast<llama_seq_id>(i), -1, -1);
+                    slot.draft_kv.clear();
+                }
+                continue;
+            }
+            
+            // Proposing past max_tokens would overrun the slot's KV reservation
+            limit[i] = std::min(n_draft, slot.request->max_tokens - slot.n_generated);
+            if (limit[i] <= 0) {
+                continue;
+            }
+            
+            // Keep the common prefix, re-decoding at least last_token for its logits
+            history[i] = slot.kv_tokens;
+            history[i].push_back(slot.last_token);
+            size_t keep = std::min(common_prefix(slot.draft_kv, history[i]), history[i].size() - 1);
+            llama_kv_cache_seq_rm(draft_ctx, static_cast<llama_seq_id>(i), static_cast<llama_pos>(keep), -1);
+            slot.draft_kv.resize(keep);
+            pending[i] = keep;
+            drafting.push_back(static_cast<int>(i));
+        }
+        
+        // Catch up in n_batch chunks; a sequence proposes its first token
+        // from the chunk that holds its last history token
+        bool caught_up = drafting.empty();
+        while (!caught_up) {
+            draft_batch.n_tokens = 0;
+            std::vector<std::pair<int, int>> logit_rows;
+            for (int i : drafting) {
+                while (pending[i] < history[i].size() && draft_batch.n_tokens < n_batch) {
+                    bool last = pending[i] + 1 == history[i].size();
+                    if (last) {
+                        logit_rows.emplace_back(i, draft_batch.n_tokens);
+                    }
+                    draft_batch_add(i, history[i][pending[i]++], last);
+                }
+            }
+            
+            if (llama_decode(draft_ctx, draft_batch) != 0) {
+                abandon_drafts();
+                return;
+            }
+            for (const auto& row : logit_rows) {
+                slots[row.first].draft.push_back(argmax(llama_get_logits_ith(draft_ctx, row.second), n_vocab));
+            }
+            
+            caught_up = true;
+            for (int i : drafting) {
+                caught_up = caught_up && pending[i] == history[i].size();
+            }
+        }
+        
+        // Extend every proposal by one token per decode until each reaches
+        // its limit or proposes end of generation
+        while (true) {
+            draft_batch.n_tokens = 0;
+            std::vector<std::pair<int, int>> logit_rows;
+            for (int i : drafting) {
+                SequenceSlot& slot = slots[i];
+                if (static_cast<int>(slot.draft.size()) < limit[i] && !llama_token_is_eog(model, slot.draft.back())) {
+                    logit_rows.emplace_back(i, draft_batch.n_tokens);
+                    draft_batch_add(i, slot.draft.back(), true);
+                }
+            }
+            if (logit_rows.empty()) {
+                break;
+            }
+            
+            if (llama_decode(draft_ctx, draft_batch) != 0) {
+                abandon_drafts();
+                return;
+            }
+            for (const auto& row : logit_rows) {
+                slots[row.first].draft.push_back(argmax(llama_get_logits_ith(draft_ctx, row.second), n_vocab));
+            }
+        }
+        
+        atomic_add(spec_draft_time, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count());
+    }
+    
+    void draft_batch_add(int seq_id, llama_token token, bool logits) {
+        SequenceSlot& slot = slots[seq_id];
+        int i = draft_batch.n_tokens++;
+        draft_batch.token[i] = token;
+        draft_batch.pos[i] = static_cast<llama_pos>(slot.draft_kv.size());
+        draft_batch.n_seq_id[i] = 1;
+        draft_batch.seq_id[i][0] = seq_id;
+        draft_batch.logits[i] = logits;
+        slot.draft_kv.push_back(token);
+    }
+    
+    // A failed draft decode leaves its cells unknown: start every draft
+    // sequence over and decode this step without proposals
+    void abandon_drafts() {
+        llama_kv_cache_clear(draft_ctx);
+        for (auto& slot : slots) {
+            slot.draft.clear();
+            slot.draft_kv.clear();
+        }
+    }
+    
+    static llama_token argmax(const float* logits, int n_vocab) {
+        return static_cast<llama_token>(std::max_element(logits, logits + n_vocab) - logits);
+    }
+    
+    // Drop a sequence's cells from position `n` on
+    void truncate_sequence(int seq_id, int n) {
+        SequenceSlot& slot = slots[seq_id];
+        if (static_cast<int>(slot.kv_tokens.size()) > n) {
+            llama_kv_cache_seq_rm(ctx, seq_id, static_cast<llama_pos>(n), -1);
+            slot.kv_tokens.resize(n);
+        }
+        slot.n_past = n;
+    }
+    
+    // For every generating sequence its last token plus any draft tokens,
+    // all with logits, then prompt chunks for prefilling ones in the
+    // remaining space. Returns false if empty.
+    bool fill_batch() {
+        batch.n_tokens = 0;
+        batch_prompt_tokens = 0;
+        
+        int n_generating = 0;
+        for (const auto& slot : slots) {
+            n_generating += slot.active() && !slot.prefilling();
+        }
+        const size_t max_draft = n_generating > 0 ? std::max(0, n_batch / n_generating - 1) : 0;
+        
+        for (size_t i = 0; i < slots.size(); ++i) {
+            SequenceSlot& slot = slots[i];
+            if (slot.active() && !slot.prefilling()) {
+                if (slot.draft.size() > max_draft) {
+                    slot.draft.resize(max_draft);
+                }
+                slot.i_batch = batch.n_tokens;
+                batch_add(slot.last_token, slot.n_past++, static_cast<llama_seq_id>(i), true);
+                for (llama_token token : slot.draft) {
+                    batch_add(token, slot.n_past++, static_cast<llama_seq_id>(i), true);
+                }
+            }
+        }
+        
+        for (size_t i = 0; i < slots.size() && batch.n_tokens < n_batch; ++i) {
+            SequenceSlot& slot = slots[i];
+            if (!slot.prefilling()) {
+                continue;
+            }
+            
+            const auto& prompt = slot.request->prompt;
+            while (slot.n_prompt_done < prompt.size() && batch.n_tokens < n_batch) {
+                bool last = slot.n_prompt_done + 1 == prompt.size();
+                if (last) {
+                    slot.i_batch = batch.n_tokens;
+                }
+                batch_add(prompt[slot.n_prompt_done++], slot.n_past++, static_cast<llama_seq_id>(i), last);
+                ++batch_prompt_tokens;
+            }
+        }
+        
+        return batch.n_tokens > 0;
+    }
+    
+    void sample_slots() {
+        tracing::Span span(tracing::LLM, "llama.sample");
+        const int n_vocab = llama_n_vocab(model);
+        const auto now = std::chrono::high_resolution_clock::now();
+        
+        for (size_t i = 0; i < slots.size(); ++i) {
+            SequenceSlot& slot = slots[i];
+            if (!slot.active() || slot.i_batch < 0) {
+                continue;
+            }
+            
+            int i_batch = slot.i_batch;
+            slot.i_batch = -1;
+            if (slot.request->snapshot_prefix) {
+                store_snapshot(static_cast<int>(i));
+                finish_slot(static_cast<int>(i));
+                continue;
+            }
+            
+            // Sample at each verified position: while the sample equals the
+            // draft token, the logits after it are valid and sampling goes
+            // on, so the output is what plain decoding would sample for any
+            // sampling settings.
+            const int n_drafted = static_cast<int>(slot.draft.size());
+            const int n_valid = slot.n_past - n_drafted;  // cells through last_token
+            const int n_before = slot.n_generated;
+            const auto submitted = slot.request->submitted;
+            int n_accepted = 0;
+            bool finished = false;
+            for (int j = 0; j <= n_drafted && !finished; ++j) {
+                llama_token token = slot.sampler.sample(llama_get_logits_ith(ctx, i_batch + j), n_vocab);
+                bool matched = j < n_drafted && token == slot.draft[j];
+                
+                if (llama_token_is_eog(model, token)) {
+                    truncate_sequence(static_cast<int>(i), n_valid + j);
+                    finished = true;
+                    break;
+                }
+                
+                slot.sampler.accept(token);
+                size_t piece_start = slot.output.size();
+                append_piece(token, slot.output);
+                slot.last_token = token;
+                
+                const auto& stream = slot.request->stream;
+                if (stream) {
+                    stream->push(slot.output.data() + piece_start, slot.output.size() - piece_start);
+                }
+                if (++slot.n_generated >= slot.request->max_tokens || slot.request->is_cancelled()) {
+                    truncate_sequence(static_cast<int>(i), n_valid + j);
+                    finished = true;
+                } else if (matched) {
+                    ++n_accepted;
+                } else {
+                    // The sample replaces the rejected draft as the next input
+                    truncate_sequence(static_cast<int>(i), n_valid + j);
+                    break;
+                }
+            }
+            
+            if (n_drafted > 0) {
+                spec_steps++;
+                spec_drafted += n_drafted;
+                spec_accepted += n_accepted;
+            }
+            slot.draft.clear();
+            record_token_latency(slot, n_before, submitted, now);
+            // Only now, so callers woken by the result see its tokens counted
+            if (finished) {
+                finish_slot(static_cast<int>(i));
+            }
+        }
+    }
+    
+    // The first token of a request counts toward time to first token; the
+    // tokens of later steps share the time since the previous step
+    void record_token_latency(SequenceSlot& slot, int n_before,
+                              std::chrono::high_resolution_clock::time_point submitted,
+                              std::chrono::high_resolution_clock::time_point now) {
+        int n_emitted = slot.n_generated - n_before;
+        if (n_emitted <= 0) {
+            return;
+        }
+        generated_tokens += n_emitted;
+        if (n_before == 0) {
+            ttft_histogram.record(std::chrono::duration<double>(now - submitted).count());
+        } else {
+            double seconds = std::chrono::duration<double>(now - slot.last_emitted).count();
+            token_latency_histogram.record(seconds / n_emitted, n_emitted);
+        }
+        slot.last_emitted = now;
+    }
+    
+    void record_decode_time(double seconds) {
+        int n_tokens = batch.n_tokens;
+        double prompt_share = seconds * batch_prompt_tokens / n_tokens;
+        prompt_eval_tokens += batch_prompt_tokens;
+        atomic_add(prompt_eval_time, prompt_share);
+        if (n_tokens > batch_prompt_tokens) {
+            decode_tokens += n_tokens - batch_prompt_tokens;
+            atomic_add(decode_time, seconds - prompt_share);
+            decode_steps++;
+        }
+    }
+    
+    // Release the slot; its KV cells stay cached for prefix reuse unless
+    // `keep_cache` is false
+    void finish_slot(int seq_id, bool keep_cache = true) {
+        SequenceSlot& slot = slots[seq_id];
+        
+        if (!keep_cache) {
+            llama_kv_cache_seq_rm(ctx, seq_id, -1, -1);
+            slot.kv_tokens.clear();
+        }
+        kv_reserved -= slot.reserved;
+        slot.reserved = 0;
+        slot.last_used = ++use_counter;
+        
+        auto end_time = std::chrono::high_resolution_clock::now();
+        double duration = std::chrono::duration<double>(end_time - slot.request->submitted).count();
+        update_performance_stats(slot.n_generated, duration);
+        
+        slot.request->finish(std::move(slot.output), slot.failed);
+        slot.request.reset();
+        slot.output.clear();
+    }
+    
+    void store_snapshot(int seq_id) {
+        SequenceSlot& slot = slots[seq_id];
+        
+        PrefixEntry entry;
+        entry.tokens = slot.kv_tokens;
+        entry.state.resize(llama_state_seq_get_size(ctx, seq_id));
+        size_t written = llama_state_seq_get_data(ctx, entry.state.data(), entry.state.size(), seq_id);
+        if (written == 0) {
+            slot.output = "Error: Failed to read sequence state";
+            slot.failed = true;
+            return;
+        }
+        entry.state.resize(written);
+        
+        std::lock_guard<std::mutex> lock(request_mutex);
+        if (!add_prefix_entry(std::move(entry))) {
+            slot.output = "Error: Prefix state exceeds the cache limit";
+            slot.failed = true;
+        }
+    }
+    
+    // Insert or replace a snapshot, evicting least recently used entries to
+    // stay within prefix_cache_limit. Called with request_mutex held.
+    bool add_prefix_entry(PrefixEntry entry) {
+        if (entry.state.size() > prefix_cache_limit) {
+            return false;
+        }
+        
+        for (auto it = prefix_entries.begin(); it != prefix_entries.end(); ++it) {
+            if (it->tokens == entry.tokens) {
+                prefix_cache_bytes -= it->state.size();
+                prefix_entries.erase(it);
+                break;
+            }
+        }
+        
+        entry.last_used = ++use_counter;
+        prefix_cache_bytes += entry.state.size();
+        prefix_entries.push_back(std::move(entry));
+        trim_prefix_cache(prefix_cache_limit);
+        return true;
+    }
+    
+    // Evict least recently used snapshots down to `limit` bytes. Called
+    // with request_mutex held.
+    void trim_prefix_cache(size_t limit) {
+        while (prefix_cache_bytes > limit && !prefix_entries.empty()) {
+            auto victim = std::min_element(prefix_entries.begin(), prefix_entries.end(),
+                                           [](const PrefixEntry& a, const PrefixEntry& b) {
+                                               return a.last_used < b.last_used;
+                                           });
+            prefix_cache_bytes -= victim->state.size();
+            prefix_entries.erase(victim);
+        }
+        prefix_charge.set(prefix_cache_bytes);
+    }
+    
+    // Detokenized piece for every vocabulary entry, built at load so
+    // generation appends cached strings instead of detokenizing per token
+    void ensure_token_pieces() {
+        if (!token_pieces.empty()) {
+            return;
+        }
+        
+        const int n_vocab = llama_n_vocab(model);
+        std::vector<std::string> pieces(n_vocab);
+        for (int i = 0; i < n_vocab; ++i) {
+            detokenize(i, pieces[i]);
+        }
+        token_pieces = std::move(pieces);
+    }
+    
+    void append_piece(llama_token token, std::string& out) {
+        if (static_cast<size_t>(token) < token_pieces.size()) {
+            out += token_pieces[token];
+        } else {
+            detokenize(token, out);
+        }
+    }
+    
+    void detokenize(llama_token token, std::string& out) {
+        char piece[256];
+        int n_chars = llama_token_to_piece(model, token, piece, sizeof(piece), 0, false);
+        if (n_chars > 0) {
+            out.append(piece, n_chars);
+        } else if (n_chars < 0) {
+            std::string long_piece(-n_chars, '\0');
+            n_chars = llama_token_to_piece(model, token, &long_piece[0], -n_chars, 0, false);
+            out.append(long_piece, 0, std::max(0, n_chars));
+        }
+    }
+    
+    void submit_task(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            task_queue.push(task);
+        }
+        queue_cv.notify_one();
+    }
+    
+    void update_performance_stats(int tokens_generated, double generation_time) {
+        total_generations++;
+        total_tokens += tokens_generated;
+        atomic_add(total_time, generation_time);
+    }
+    
+public:
+    std::map<std::string, double> get_performance_stats() {
+        std::map<std::string, double> stats;
+        
+        auto current_time = std::chrono::high_resolution_clock::now();
+        double uptime = std::chrono::duration<double>(current_time - start_time).count();
+        
+        stats["total_generations"] = total_generations.load();
+        stats["total_tokens"] = total_tokens.load();
+        stats["total_time"] = total_time.load();
+        stats["uptime_seconds"] = uptime;
+        
+        if (total_time.load() > 0) {
+            stats["avg_tokens_per_second"] = total_tokens.load() / total_time.load();
+        } else {
+            stats["avg_tokens_per_second"] = 0.0;
+        }
+        
+        if (total_generations.load() > 0) {
+            stats["avg_generation_time"] = total_time.load() / total_generations.load();
+        } else {
+            stats["avg_generation_time"] = 0.0;
+        }
+        
+        // Speculative decoding: share of drafted tokens accepted and tokens
+        // produced per verified sequence step (1 without speculation)
+        uint64_t steps = spec_steps.load();
+        uint64_t drafted = spec_drafted.load();
+        uint64_t accepted = spec_accepted.load();
+        stats["speculative_steps"] = static_cast<double>(steps);
+        stats["draft_tokens"] = static_cast<double>(drafted);
+        stats["draft_accepted"] = static_cast<double>(accepted);
+        stats["draft_acceptance_rate"] = drafted > 0 ? static_cast<double>(accepted) / drafted : 0.0;
+        stats["tokens_per_verify"] = steps > 0 ? static_cast<double>(accepted + steps) / steps : 1.0;
+        stats["draft_time"] = spec_draft_time.load();
+        
+        // Per phase: prompt processing and generation throughput, time to
+        // first token and inter-token latency
+        {
+            std::lock_guard<std::mutex> lock(request_mutex);
+            stats["prompt_tokens"] = static_cast<double>(prompt_tokens_total);
+            stats["prompt_tokens_cached"] = static_cast<double>(prefix_tokens_reused);
+        }
+        double prompt_seconds = prompt_eval_time.load();
+        double decode_seconds = decode_time.load();
+        double generated = static_cast<double>(generated_tokens.load());
+        stats["prompt_eval_tokens"] = static_cast<double>(prompt_eval_tokens.load());
+        stats["prompt_eval_time"] = prompt_seconds;
+        stats["prompt_tokens_per_second"] = prompt_seconds > 0 ? stats["prompt_eval_tokens"] / prompt_seconds : 0.0;
+        stats["generated_tokens"] = generated;
+        stats["decode_tokens"] = static_cast<double>(decode_tokens.load());
+        stats["decode_steps"] = static_cast<double>(decode_steps.load());
+        stats["decode_time"] = decode_seconds;
+        stats["decode_tokens_per_second"] = decode_seconds > 0 ? generated / (decode_seconds + spec_draft_time.load()) : 0.0;
+        ttft_histogram.export_stats(stats, "ttft");
+        token_latency_histogram.export_stats(stats, "token_latency");
+        
+        return stats;
+    }
+    
+    void reset_performance_stats() {
+        total_generations = 0;
+        total_tokens = 0;
+        total_time = 0.0;
+        spec_steps = 0;
+        spec_drafted = 0;
+        spec_accepted = 0;
+        spec_draft_time = 0.0;
+        prompt_eval_tokens = 0;
+        prompt_eval_time = 0.0;
+        decode_tokens = 0;
+        decode_time = 0.0;
+        generated_tokens = 0;
+        decode_steps = 0;
+        ttft_histogram.reset();
+        token_latency_histogram.reset();
+        start_time = std::chrono::high_resolution_clock::now();
+        
+        std::lock_guard<std::mutex> lock(request_mutex);
+        prompt_tokens_total = 0;
+        prefix_tokens_reused = 0;
+        prefix_hits = 0;
+    }
+};
+
+// Generated texts served again within their reuse budget, configured by
+// set_content_cache. The mutator, if set, rewrites each reused text.
+static ContentCache g_content_cache;
+static PyObject* g_content_mutator = nullptr;
+static std::mutex g_content_mutator_mutex;
+
+// Sampling settings that change what text is valid, so they key the cache
+static std::string content_cache_salt(const SamplingParams& params) {
+    if (!params.grammar) {
+        return params.allowed_chars;
+    }
+    return params.allowed_chars + '\0' + token_grammar::source(*params.grammar);
+}
+
+// A cached completion for `prompt`, passed through the mutator. Returns 1
+// on a hit, 0 when the prompt has to be decoded (after which `key` goes to
+// content_cache_insert) and -1 with an exception set. Call with the GIL.
+static int content_cache_lookup(const std::string& prompt, int max_tokens, const SamplingParams& params,
+                                uint64_t& key, std::string& text) {
+    key = ContentCache::key(prompt, max_tokens, content_cache_salt(params));
+    uint32_t use;
+    if (!g_content_cache.lookup(key, text, use)) {
+        return 0;
+    }
+    
+    PyObject* mutator;
+    {
+        std::lock_guard<std::mutex> lock(g_content_mutator_mutex);
+        mutator = Py_XNewRef(g_content_mutator);
+    }
+    if (!mutator) {
+        return 1;
+    }
+    PyObject* mutated = PyObject_CallFunction(mutator, "s#I", text.data(), static_cast<Py_ssize_t>(text.size()), use);
+    Py_DECREF(mutator);
+    if (!mutated) {
+        return -1;
+    }
+    Py_ssize_t size;
+    const char* data = PyUnicode_AsUTF8AndSize(mutated, &size);
+    if (data) {
+        text.assign(data, static_cast<size_t>(size));
+    }
+    Py_DECREF(mutated);
+    return data ? 1 : -1;
+}
+
+// Keep a fresh completion; error strings are not cached
+static void content_cache_insert(uint64_t key, const std::string& text) {
+    if (!text.empty() && text.compare(0, 7, "Error: ") != 0) {
+        g_content_cache.insert(key, text);
+    }
+}
+
+// Inference server: one process owns the model and serves completions to
+// worker processes over a Unix socket, so memory stays flat in the number
+// of workers and their prompts share the batch scheduler. Both ends run on
+// the same host and use its native byte order.
+struct RemoteRequestHeader {
+    uint32_t magic;
+    uint32_t fields;              // SamplingField bits overlaid on server defaults
+    int32_t max_tokens;
+    int32_t top_k;
+    int32_t repeat_last_n;
+    float temperature;
+    float top_p;
+    float min_p;
+    float repeat_penalty;
+    uint32_t allowed_chars_size;
+    uint32_t grammar_size;        // GBNF source, sent after allowed_chars
+    int64_t seed;
+    uint64_t prompt_size;
+};
+
+struct RemoteResponseHeader {
+    uint32_t magic;
+    uint32_t reserved;
+    uint64_t text_size;
+};
+
+static constexpr uint32_t kRemoteRequestMagic = 0x43465251;   // "CFRQ"
+static constexpr uint32_t kRemoteResponseMagic = 0x43465253;  // "CFRS"
+static constexpr uint64_t kRemoteMaxPromptBytes = uint64_t(64) << 20;
+static constexpr uint32_t kRemoteMaxCharsetBytes = 1u << 20;
+static constexpr uint32_t kRemoteMaxGrammarBytes = 1u << 20;
+
+// Requests one connection may have in flight. The server stops reading a
+// connection at this depth until responses drain; clients keep at most
+// this many outstanding so they never block on each other.
+static constexpr size_t kRemotePipelineDepth = 64;
+
+static bool read_exact(int fd, void* data, size_t size) {
+    char* out = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t n = ::recv(fd, out, size, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        out += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static bool write_exact(int fd, const void* data, size_t size) {
+    const char* in = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = ::send(fd, in, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        in += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static bool make_socket_address(const std::string& path, sockaddr_un& addr, std::string& error) {
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        error = "Socket path must be 1-" + std::to_string(sizeof(addr.sun_path) - 1) + " bytes";
+        return false;
+    }
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size());
+    return true;
+}
+
+class InferenceServer {
+private:
+    // A request in flight; decoded results are added to the content cache
+    struct Pending {
+        std::future<std::string> result;
+        uint64_t cache_key = 0;
+        bool cache = false;
+    };
+    
+    // Requests on one connection are pipelined: the reader submits each to
+    // the scheduler as it arrives (up to kRemotePipelineDepth in flight)
+    // and the writer answers them in order
+    struct Connection {
+        int fd = -1;
+        std::thread reader;
+        std::thread writer;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<Pending> pending;
+        bool reading = true;
+        std::atomic<bool> finished{false};
+    };
+    
+    LlamaCPPInterface& llama;
+    std::string socket_path;
+    int listen_fd = -1;
+    std::thread accept_thread;
+    std::atomic<bool> stopping{false};
+    
+    std::mutex connections_mutex;
+    std::list<std::unique_ptr<Connection>> connections;
+    
+    std::atomic<uint64_t> total_connections{0};
+    std::atomic<uint64_t> total_requests{0};
+    
+public:
+    explicit InferenceServer(LlamaCPPInterface& interface) : llama(interface) {}
+    
+    ~InferenceServer() {
+        stop();
+    }
+    
+    bool start(const std::string& path, std::string& error) {
+        sockaddr_un addr;
+        if (!make_socket_address(path, addr, error)) {
+            return false;
+        }
+        
+        if (!remove_stale_socket(path, addr, error)) {
+            return false;
+        }
+        
+        listen_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listen_fd < 0) {
+            error = std::string("socket: ") + std::strerror(errno);
+            return false;
+        }
+        
+        // Owner-only before listen(), so no other user can ever connect
+        if (::bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+            ::chmod(path.c_str(), 0600) < 0 || ::listen(listen_fd, 128) < 0) {
+            error = "Cannot listen on " + path + ": " + std::strerror(errno);
+            ::close(listen_fd);
+            listen_fd = -1;
+            return false;
+        }
+        
+        socket_path = path;
+        accept_thread = std::thread([this]() {
+            accept_loop();
+        });
+        std::cout << "Inference server listening on " << socket_path << std::endl;
+        return true;
+    }
+    
+    void stop() {
+        if (listen_fd < 0) {
+            return;
+        }
+        
+        stopping = true;
+        if (accept_thread.joinable()) {
+            accept_thread.join();
+        }
+        ::close(listen_fd);
+        listen_fd = -1;
+        ::unlink(socket_path.c_str());
+        
+        // Unblock readers; writers still answer requests already submitted
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        for (auto& connection : connections) {
+            ::shutdown(connection->fd, SHUT_RD);
+        }
+        for (auto& connection : connections) {
+            close_connection(*connection);
+        }
+        connections.clear();
+    }
+    
+    std::map<std::string, double> get_stats() {
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        size_t active = 0;
+        for (const auto& connection : connections) {
+            active += !connection->finished;
+        }
+        
+        std::map<std::string, double> stats;
+        stats["connections"] = static_cast<double>(total_connections.load());
+        stats["active_connections"] = static_cast<double>(active);
+        stats["requests"] = static_cast<double>(total_requests.load());
+        return stats;
+    }
+    
+    const std::string& get_socket_path() const {
+        return socket_path;
+    }
+    
+private:
+    // A socket left by a run that died would make bind fail. Only a socket
+    // nobody is listening on is removed; any other file is an error.
+    static bool remove_stale_socket(const std::string& path, const sockaddr_un& addr, std::string& error) {
+        struct stat st;
+        if (::lstat(path.c_str(), &st) < 0) {
+            if (errno == ENOENT) {
+                return true;
+            }
+            error = "Cannot stat " + path + ": " + std::strerror(errno);
+            return false;
+        }
+        if (!S_ISSOCK(st.st_mode)) {
+            error = path + " exists and is not a socket";
+            return false;
+        }
+        
+        int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (probe < 0) {
+            error = std::string("socket: ") + std::strerror(errno);
+            return false;
+        }
+        bool live = ::connect(probe, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0;
+        ::close(probe);
+        if (live) {
+            error = "Another server is listening on " + path;
+            return false;
+        }
+        ::unlink(path.c_str());
+        return true;
+    }
+    
+    void accept_loop() {
+        while (!stopping) {
+            pollfd pfd = {listen_fd, POLLIN, 0};
+            int ready = ::poll(&pfd, 1, 200);
+            reap_connections();
+            if (ready <= 0) {
+                continue;
+            }
+            
+            int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0) {
+                continue;
+            }
+            
+            auto connection = std::make_unique<Connection>();
+            Connection* conn = connection.get();
+            conn->fd = fd;
+            conn->reader = std::thread([this, conn]() {
+                read_requests(*conn);
+            });
+            conn->writer = std::thread([this, conn]() {
+                write_responses(*conn);
+            });
+            total_connections++;
+            
+            std::lock_guard<std::mutex> lock(connections_mutex);
+            connections.push_back(std::move(connection));
+        }
+    }
+    
+    void read_requests(Connection& conn) {
+        while (true) {
+            RemoteRequestHeader header;
+            if (!read_exact(conn.fd, &header, sizeof(header)) || header.magic != kRemoteRequestMagic ||
+                header.prompt_size > kRemoteMaxPromptBytes || header.allowed_chars_size > kRemoteMaxCharsetBytes ||
+                header.grammar_size > kRemoteMaxGrammarBytes) {
+                break;
+            }
+            
+            SamplingParams overrides;
+            overrides.temperature = header.temperature;
+            overrides.top_k = header.top_k;
+            overrides.top_p = header.top_p;
+            overrides.min_p = header.min_p;
+            overrides.repeat_penalty = header.repeat_penalty;
+            overrides.repeat_last_n = header.repeat_last_n;
+            overrides.seed = header.seed;
+            overrides.allowed_chars.resize(header.allowed_chars_size);
+            std::string grammar(header.grammar_size, '\0');
+            std::string prompt(header.prompt_size, '\0');
+            if (!read_exact(conn.fd, &overrides.allowed_chars[0], header.allowed_chars_size) ||
+                !read_exact(conn.fd, &grammar[0], grammar.size()) ||
+                !read_exact(conn.fd, &prompt[0], prompt.size())) {
+                break;
+            }
+            
+            // Grammars come as source and compile once per distinct text
+            std::string grammar_error;
+            if (!grammar.empty()) {
+                overrides.grammar = token_grammar::compile_cached(grammar, grammar_error);
+            }
+            
+            SamplingParams params = llama.get_default_params();
+            apply_sampling_fields(params, overrides, header.fields);
+            
+            // Cache hits are answered as is: the mutator needs the GIL,
+            // which server threads do not take
+            Pending result;
+            result.cache = g_content_cache.enabled() && grammar_error.empty();
+            if (!grammar_error.empty()) {
+                std::promise<std::string> ready;
+                ready.set_value("Error: Invalid grammar: " + grammar_error);
+                result.result = ready.get_future();
+            } else if (result.cache) {
+                result.cache_key = ContentCache::key(prompt, header.max_tokens, content_cache_salt(params));
+                std::string text;
+                uint32_t use;
+                if (g_content_cache.lookup(result.cache_key, text, use)) {
+                    std::promise<std::string> ready;
+                    ready.set_value(std::move(text));
+                    result.result = ready.get_future();
+                    result.cache = false;
+                }
+            }
+            if (!result.result.valid()) {
+                result.result = llama.submit(prompt, header.max_tokens, params);
+            }
+            total_requests++;
+            
+            // Stop reading at full depth until the writer catches up
+            {
+                std::unique_lock<std::mutex> lock(conn.mutex);
+                conn.pending.push_back(std::move(result));
+                conn.cv.notify_all();
+                conn.cv.wait(lock, [&conn]() {
+                    return conn.pending.size() < kRemotePipelineDepth;
+                });
+            }
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(conn.mutex);
+            conn.reading = false;
+        }
+        conn.cv.notify_all();
+    }
+    
+    void write_responses(Connection& conn) {
+        bool writable = true;
+        while (true) {
+            Pending result;
+            {
+                std::unique_lock<std::mutex> lock(conn.mutex);
+                conn.cv.wait(lock, [&conn]() {
+                    return !conn.pending.empty() || !conn.reading;
+                });
+                if (conn.pending.empty()) {
+                    break;
+                }
+                result = std::move(conn.pending.front());
+                conn.pending.pop_front();
+            }
+            conn.cv.notify_all();
+            
+            // Keep draining after a write failure so the reader is not left
+            // with an ever-growing queue
+            std::string text = result.result.get();
+            if (result.cache) {
+                content_cache_insert(result.cache_key, text);
+            }
+            if (writable) {
+                RemoteResponseHeader header = {kRemoteResponseMagic, 0, text.size()};
+                writable = write_exact(conn.fd, &header, sizeof(header)) && write_exact(conn.fd, text.data(), text.size());
+                if (!writable) {
+                    ::shutdown(conn.fd, SHUT_RDWR);
+                }
+            }
+        }
+        conn.finished = true;
+    }
+    
+    void close_connection(Connection& conn) {
+        if (conn.reader.joinable()) {
+            conn.reader.join();
+        }
+        if (conn.writer.joinable()) {
+            conn.writer.join();
+        }
+        ::close(conn.fd);
+    }
+    
+    void reap_connections() {
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        for (auto it = connections.begin(); it != connections.end();) {
+            if ((*it)->finished) {
+                close_connection(**it);
+                it = connections.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+};
+
+// Client side of the inference server. Idle connections are pooled per
+// socket path; a forked child drops the ones it inherited instead of
+// sharing them with its parent.
+static std::mutex g_remote_mutex;
+static std::multimap<std::string, int> g_remote_idle;
+static pid_t g_remote_owner = 0;
+
+static int acquire_remote_connection(const std::string& path, bool& pooled, std::string& error) {
+    pooled = false;
+    {
+        std::lock_guard<std::mutex> lock(g_remote_mutex);
+        if (g_remote_owner != ::getpid()) {
+            for (const auto& idle : g_remote_idle) {
+                ::close(idle.second);
+            }
+            g_remote_idle.clear();
+            g_remote_owner = ::getpid();
+        }
+        
+        auto it = g_remote_idle.find(path);
+        if (it != g_remote_idle.end()) {
+            int fd = it->second;
+            g_remote_idle.erase(it);
+            pooled = true;
+            return fd;
+        }
+    }
+    
+    sockaddr_un addr;
+    if (!make_socket_address(path, addr, error)) {
+        return -1;
+    }
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        error = "Cannot connect to inference server at " + path + ": " + std::strerror(errno);
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+static void release_remote_connection(const std::string& path, int fd) {
+    std::lock_guard<std::mutex> lock(g_remote_mutex);
+    g_remote_idle.emplace(path, fd);
+}
+
+static bool send_remote_request(int fd, const std::string& prompt, int max_tokens, const SamplingParams& overrides,
+                                uint32_t fields, const std::string& grammar) {
+    RemoteRequestHeader header = {};
+    header.magic = kRemoteRequestMagic;
+    header.fields = fields;
+    header.max_tokens = max_tokens;
+    header.top_k = overrides.top_k;
+    header.repeat_last_n = overrides.repeat_last_n;
+    header.temperature = overrides.temperature;
+    header.top_p = overrides.top_p;
+    header.min_p = overrides.min_p;
+    header.repeat_penalty = overrides.repeat_penalty;
+    header.allowed_chars_size = static_cast<uint32_t>(overrides.allowed_chars.size());
+    header.grammar_size = static_cast<uint32_t>(grammar.size());
+    header.seed = overrides.seed;
+    header.prompt_size = prompt.size();
+    return write_exact(fd, &header, sizeof(header)) &&
+           write_exact(fd, overrides.allowed_chars.data(), overrides.allowed_chars.size()) &&
+           write_exact(fd, grammar.data(), grammar.size()) &&
+           write_exact(fd, prompt.data(), prompt.size());
+}
+
+// Send the prompts on one connection and read the completions in order.
+// A pooled connection the server has since closed is retried once on a
+// fresh one.
+static bool remote_generate(const std::string& path, const std::vector<std::string>& prompts, int max_tokens,
+                            const SamplingParams& overrides, uint32_t fields,
+                            std::vector<std::string>& results, std::string& error) {
+    bool pooled;
+    int fd = acquire_remote_connection(path, pooled, error);
+    if (fd < 0) {
+        return false;
+    }
+    
+    std::string grammar;
+    if ((fields & SAMPLING_GRAMMAR) && overrides.grammar) {
+        grammar = token_grammar::source(*overrides.grammar);
+    }
+    
+    // Keep up to kRemotePipelineDepth requests ahead of the responses read
+    bool ok = true;
+    bool answered = false;
+    results.assign(prompts.size(), std::string());
+    for (size_t sent = 0, received = 0; ok && received < prompts.size();) {
+        if (sent < prompts.size() && sent - received < kRemotePipelineDepth) {
+            ok = send_remote_request(fd, prompts[sent++], max_tokens, overrides, fields, grammar);
+            continue;
+        }
+        
+        RemoteResponseHeader header;
+        ok = read_exact(fd, &header, sizeof(header)) && header.magic == kRemoteResponseMagic;
+        answered |= ok;
+        if (ok) {
+            results[received].resize(header.text_size);
+            ok = read_exact(fd, &results[received][0], header.text_size);
+            ++received;
+        }
+    }
+    
+    if (!ok) {
+        ::close(fd);
+        if (pooled && !answered) {
+            return remote_generate(path, prompts, max_tokens, overrides, fields, results, error);
+        }
+        error = "Lost connection to inference server at " + path;
+        return false;
+    }
+    release_remote_connection(path, fd);
+    return true;
+}
+
+// Global instance; created once and never replaced. The interface locks
+// its own state, the mutex only orders creation against readers.
+static std::unique_ptr<LlamaCPPInterface> g_llama_interface = nullptr;
+static std::mutex g_llama_interface_mutex;
+
+static LlamaCPPInterface* get_llama_interface() {
+    std::lock_guard<std::mutex> lock(g_llama_interface_mutex);
+    return g_llama_interface.get();
+}
+
+// Per-handle view for get_model_stats
+struct ModelStats {
+    long long handle;
+    std::string path;
+    bool resident;
+    size_t bytes;
+    int active;
+    uint64_t requests;
+    uint64_t loads;
+    uint64_t evictions;
+    double load_time;
+    std::string draft_path;
+    ContextSettings settings;
+    std::map<std::string, double> performance;
+};
+
+// Models opened by handle (open_model), each with its own interface:
+// context, batch scheduler and thread settings. Handles on the same file
+// share its mapped weights. When the mapped files would exceed the model
+// budget, or the process nears its memory budget (memory_budget.h), the
+// least recently used idle handles are unloaded; a request on an unloaded
+// handle loads it again. Handles are never reused.
+class ModelRegistry {
+private:
+    struct Entry {
+        std::string path;
+        int n_parallel = 0;
+        size_t bytes = 0;                  // File size, i.e. the mapped weights
+        std::unique_ptr<LlamaCPPInterface> llama;
+        std::string draft_path;            // Speculative draft, reloaded with the model
+        size_t draft_bytes = 0;
+        int n_draft = 0;
+        std::mutex load_mutex;             // Orders load and unload of this handle
+        
+        // Guarded by the registry mutex
+        int active = 0;                    // Requests in flight
+        uint64_t last_used = 0;
+        uint64_t requests = 0;
+        uint64_t loads = 0;
+        uint64_t evictions = 0;
+        double load_time = 0.0;
+    };
+    
+    std::mutex mutex;
+    std::map<long long, std::shared_ptr<Entry>> entries;
+    long long next_handle = 1;
+    size_t budget = 0;                     // Bytes; 0 is unlimited
+    uint64_t use_counter = 0;
+    int reclaimer_id = 0;
+    
+public:
+    ModelRegistry() {
+        reclaimer_id = memory_budget::add_reclaimer("idle_models", 20, [this](size_t bytes) {
+            return reclaim(bytes);
+        });
+    }
+    
+    ~ModelRegistry() {
+        memory_budget::remove_reclaimer(reclaimer_id);
+    }
+    
+    // Returns the new handle, or 0 with `error` set. The model is loaded
+    // here so a bad file fails at open rather than on first use.
+    long long open(const std::string& path, int n_parallel, const ContextSettings& settings, std::string& error) {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) {
+            error = "Model file not found: " + path;
+            return 0;
+        }
+        
+        auto entry = std::make_shared<Entry>();
+        entry->path = path;
+        entry->n_parallel = n_parallel;
+        entry->bytes = static_cast<size_t>(st.st_size);
+        entry->llama = std::make_unique<LlamaCPPInterface>();
+        entry->llama->reconfigure(settings, error);  // Only stores values before load
+        
+        long long handle;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            handle = next_handle++;
+            entries[handle] = entry;
+        }
+        
+        if (!acquire(handle, error)) {
+            close(handle);
+            return 0;
+        }
+        release(entry);
+        return handle;
+    }
+    
+    // Forget a handle. Requests already running on it keep their reference
+    // and the last one to finish frees its interface.
+    bool close(long long handle) {
+        std::shared_ptr<Entry> entry;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = entries.find(handle);
+            if (it == entries.end()) {
+                return false;
+            }
+            entry = std::move(it->second);
+            entries.erase(it);
+        }
+        return true;
+    }
+    
+    // Run `fn` on the handle's interface, loading it first if it was evicted
+    bool with_model(long long handle, const std::function<void(LlamaCPPInterface&)>& fn, std::string& error) {
+        std::shared_ptr<Entry> entry = acquire(handle, error);
+        if (!entry) {
+            return false;
+        }
+        fn(*entry->llama);
+        release(entry);
+        return true;
+    }
+    
+    // Speculate on `handle` with a draft model; kept across evictions. An
+    // empty path removes the draft.
+    bool set_draft(long long handle, const std::string& path, int tokens, std::string& error) {
+        struct stat st;
+        if (!path.empty() && stat(path.c_str(), &st) != 0) {
+            error = "Draft model file not found: " + path;
+            return false;
+        }
+        
+        std::shared_ptr<Entry> entry = acquire(handle, error);
+        if (!entry) {
+            return false;
+        }
+        bool ok = true;
+        if (path.empty()) {
+            entry->llama->unload_draft_model();
+        } else {
+            ok = entry->llama->load_draft_model(path, tokens, error);
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (ok) {
+                entry->draft_path = path;
+                entry->draft_bytes = path.empty() ? 0 : static_cast<size_t>(st.st_size);
+                entry->n_draft = entry->llama->get_draft_tokens();
+            }
+        }
+        release(entry);
+        return ok;
+    }
+    
+    void set_budget(size_t bytes) {
+        std::lock_guard<std::mutex> lock(mutex);
+        budget = bytes;
+        evict_for(nullptr);
+    }
+    
+    size_t get_budget() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return budget;
+    }
+    
+    size_t resident_bytes() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return mapped_bytes();
+    }
+    
+    std::vector<ModelStats> get_stats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<ModelStats> stats;
+        for (const auto& item : entries) {
+            const Entry& entry = *item.second;
+            ModelStats model;
+            model.handle = item.first;
+            model.path = entry.path;
+            model.resident = entry.llama->is_loaded();
+            model.bytes = entry.bytes;
+            model.active = entry.active;
+            model.requests = entry.requests;
+            model.loads = entry.loads;
+            model.evictions = entry.evictions;
+            model.load_time = entry.load_time;
+            model.draft_path = entry.draft_path;
+            model.settings = entry.llama->get_context_settings();
+            model.performance = entry.llama->get_performance_stats();
+            stats.push_back(std::move(model));
+        }
+        return stats;
+    }
+    
+private:
+    std::shared_ptr<Entry> acquire(long long handle, std::string& error) {
+        std::shared_ptr<Entry> entry;
+        std::pair<std::string, int> draft;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = entries.find(handle);
+            if (it == entries.end()) {
+                error = "Unknown model handle: " + std::to_string(handle);
+                return nullptr;
+            }
+            entry = it->second;
+            entry->active++;
+            entry->requests++;
+            entry->last_used = ++use_counter;
+            draft = {entry->draft_path, entry->n_draft};
+            if (!entry->llama->is_loaded()) {
+                evict_for(entry.get());
+            }
+        }
+        
+        // Load outside the registry lock so other handles keep serving
+        bool loaded = true;
+        bool loaded_now = false;
+        double seconds = 0.0;
+        {
+            std::lock_guard<std::mutex> load_lock(entry->load_mutex);
+            if (!entry->llama->is_loaded()) {
+                auto start = std::chrono::high_resolution_clock::now();
+                loaded = entry->llama->load_model(entry->path, entry->n_parallel);
+                loaded_now = loaded;
+                if (loaded && !draft.first.empty()) {
+                    std::string draft_error;
+                    if (!entry->llama->load_draft_model(draft.first, draft.second, draft_error)) {
+                        std::cerr << draft_error << std::endl;
+                    }
+                }
+                seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+            }
+        }
+        
+        std::lock_guard<std::mutex> lock(mutex);
+        if (loaded_now) {
+            entry->loads++;
+            entry->load_time += seconds;
+        }
+        if (!loaded) {
+            entry->active--;
+            error = "Failed to load model: " + entry->path;
+            return nullptr;
+        }
+        return entry;
+    }
+    
+    // Drop the request and, if loads went over budget while everything was
+    // busy, unload what has become idle
+    void release(const std::shared_ptr<Entry>& entry) {
+        std::lock_guard<std::mutex> lock(mutex);
+        entry->active--;
+        evict_for(nullptr);
+    }
+    
+    // Distinct files (models and drafts) mapped by resident handles.
+    // Called with mutex held.
+    std::map<std::string, size_t> mapped_files() const {
+        std::map<std::string, size_t> files;
+        for (const auto& item : entries) {
+            const Entry& entry = *item.second;
+            if (entry.llama->is_loaded()) {
+                files[entry.path] = entry.bytes;
+                if (!entry.draft_path.empty()) {
+                    files[entry.draft_path] = entry.draft_bytes;
+                }
+            }
+        }
+        return files;
+    }
+    
+    size_t mapped_bytes() const {
+        size_t total = 0;
+        for (const auto& file : mapped_files()) {
+            total += file.second;
+        }
+        return total;
+    }
+    
+    // Unload files, least recently used first, until the budget holds the
+    // resident ones plus the one `incoming` is about to map. A file is
+    // unmapped only when every handle on it is idle, so all of them are
+    // unloaded together. If nothing idle is left the load goes ahead over
+    // budget until a release. Called with mutex held.
+    void evict_for(const Entry* incoming) {
+        if (budget == 0) {
+            return;
+        }
+        
+        while (true) {
+            std::map<std::string, size_t> mapped = mapped_files();
+            size_t needed = mapped_bytes();
+            if (incoming && !mapped.count(incoming->path)) {
+                needed += incoming->bytes;
+            }
+            if (incoming && !incoming->draft_path.empty() && !mapped.count(incoming->draft_path)) {
+                needed += incoming->draft_bytes;
+            }
+            if (needed <= budget || unload_least_recent(incoming) == 0) {
+                return;
+            }
+        }
+    }
+    
+    // Memory budget reclaimer: unload idle models until `bytes` of mapped
+    // files are gone. Skipped while the registry is busy.
+    size_t reclaim(size_t bytes) {
+        std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            return 0;
+        }
+        size_t freed = 0;
+        while (freed < bytes) {
+            size_t unloaded = unload_least_recent(nullptr);
+            if (unloaded == 0) {
+                break;
+            }
+            freed += unloaded;
+        }
+        return freed;
+    }
+    
+    // Unload every handle on the least recently used file that no request
+    // is using (other than the one `incoming` needs). Returns the mapped
+    // bytes that went, 0 if nothing was idle. Called with mutex held.
+    size_t unload_least_recent(const Entry* incoming) {
+        struct FileUse {
+            uint64_t last_used = 0;
+            bool busy = false;
+        };
+        std::map<std::string, FileUse> files;
+        for (const auto& item : entries) {
+            const Entry& entry = *item.second;
+            if (entry.llama->is_loaded()) {
+                FileUse& use = files[entry.path];
+                use.last_used = std::max(use.last_used, entry.last_used);
+                use.busy = use.busy || entry.active > 0;
+            }
+        }
+        
+        const std::string* victim = nullptr;
+        uint64_t victim_used = 0;
+        for (const auto& file : files) {
+            if (file.second.busy || (incoming && file.first == incoming->path)) {
+                continue;
+            }
+            if (!victim || file.second.last_used < victim_used) {
+                victim = &file.first;
+                victim_used = file.second.last_used;
+            }
+        }
+        if (!victim) {
+            return 0;
+        }
+        
+        // Idle handles are not being loaded, so these do not wait
+        size_t before = mapped_bytes();
+        for (const auto& item : entries) {
+            Entry& entry = *item.second;
+            if (entry.path == *victim && entry.llama->is_loaded()) {
+                std::lock_guard<std::mutex> load_lock(entry.load_mutex);
+                entry.llama->unload();
+                entry.evictions++;
+            }
+        }
+        size_t after = mapped_bytes();
+        return std::max<size_t>(before - after, 1);  // Progress, even for a file that is still shared
+    }
+};
+
+static ModelRegistry g_model_registry;
+
+// Python C API functions
+static PyObject* init_llama_cpp(PyObject* self, PyObject* args) {
+    std::lock_guard<std::mutex> lock(g_llama_interface_mutex);
+    if (!g_llama_interface) {
+        g_llama_interface = std::make_unique<LlamaCPPInterface>();
+    }
+    return PyBool_FromLong(1);
+}
+
+static PyObject* load_model_cpp(PyObject* self, PyObject* args) {
+    const char* model_path;
+    int n_parallel = 0;
+    
+    if (!PyArg_ParseTuple(args, "s|i", &model_path, &n_parallel)) {
+        return nullptr;
+    }
+    
+    LlamaCPPInterface* llama = get_llama_interface();
+    if (!llama) {
+        PyErr_SetString(PyExc_RuntimeError, "LlamaCPP interface not initialized");
+        return nullptr;
+    }
+    
+    std::string path(model_path);
+    bool success;
+    Py_BEGIN_ALLOW_THREADS
+    success = llama->load_model(path, n_parallel);
+    Py_END_ALLOW_THREADS
+    return PyBool_FromLong(success ? 1 : 0);
+}
+
+// Compile a 'grammar' (GBNF text) or 'json_schema' (dict or JSON text)
+// parameter through the grammar cache; None clears the grammar
+static bool parse_grammar_param(PyObject* value, bool schema, SamplingParams& params) {
+    if (value == Py_None) {
+        params.grammar.reset();
+        return true;
+    }
+    
+    PyObject* text_obj = nullptr;
+    if (schema && (PyDict_Check(value) || PyList_Check(value))) {
+        PyObject* json = PyImport_ImportModule("json");
+        if (!json) {
+            return false;
+        }
+        text_obj = PyObject_CallMethod(json, "dumps", "O", value);
+        Py_DECREF(json);
+    } else if (PyUnicode_Check(value)) {
+        text_obj = Py_NewRef(value);
+    } else {
+        PyErr_SetString(PyExc_TypeError, schema ? "json_schema must be a dict or a JSON string"
+                                                : "grammar must be a GBNF string");
+        return false;
+    }
+    if (!text_obj) {
+        return false;
+    }
+    Py_ssize_t size;
+    const char* data = PyUnicode_AsUTF8AndSize(text_obj, &size);
+    if (!data) {
+        Py_DECREF(text_obj);
+        return false;
+    }
+    std::string text(data, static_cast<size_t>(size));
+    Py_DECREF(text_obj);
+    
+    std::string error;
+    params.grammar = schema ? token_grammar::compile_schema_cached(text, error)
+                            : token_grammar::compile_cached(text, error);
+    if (!params.grammar) {
+        PyErr_SetString(PyExc_ValueError, error.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Apply overrides from a dict of sampling parameters, recording which
+// fields were set in `fields` when given
+static bool parse_sampling_params(PyObject* dict, SamplingParams& params, uint32_t* fields = nullptr) {
+    if (!dict || dict == Py_None) {
+        return true;
+    }
+    if (!PyDict_Check(dict)) {
+        PyErr_SetString(PyExc_TypeError, "Sampling parameters must be a dict");
+        return false;
+    }
+    
+    PyObject* key;
+    PyObject* value;
+    Py_ssize_t pos = 0;
+    while (PyDict_Next(dict, &pos, &key, &value)) {
+        const char* name = PyUnicode_Check(key) ? PyUnicode_AsUTF8(key) : nullptr;
+        if (!name) {
+            PyErr_SetString(PyExc_TypeError, "Sampling parameter names must be strings");
+            return false;
+        }
+        
+        std::string param(name);
+        uint32_t field;
+        if (param == "temperature") {
+            params.temperature = static_cast<float>(PyFloat_AsDouble(value));
+            field = SAMPLING_TEMPERATURE;
+        } else if (param == "top_k") {
+            params.top_k = static_cast<int>(PyLong_AsLong(value));
+            field = SAMPLING_TOP_K;
+        } else if (param == "top_p") {
+            params.top_p = static_cast<float>(PyFloat_AsDouble(value));
+            field = SAMPLING_TOP_P;
+        } else if (param == "min_p") {
+            params.min_p = static_cast<float>(PyFloat_AsDouble(value));
+            field = SAMPLING_MIN_P;
+        } else if (param == "repeat_penalty") {
+            params.repeat_penalty = static_cast<float>(PyFloat_AsDouble(value));
+            field = SAMPLING_REPEAT_PENALTY;
+        } else if (param == "repeat_last_n") {
+            params.repeat_last_n = static_cast<int>(PyLong_AsLong(value));
+            field = SAMPLING_REPEAT_LAST_N;
+        } else if (param == "seed") {
+            params.seed = value == Py_None ? -1 : PyLong_AsLongLong(value);
+            field = SAMPLING_SEED;
+        } else if (param == "allowed_chars") {
+            const char* chars = value == Py_None ? "" : PyUnicode_AsUTF8(value);
+            if (!chars) {
+                return false;
+            }
+            params.allowed_chars = chars;
+            field = SAMPLING_ALLOWED_CHARS;
+        } else if (param == "grammar" || param == "json_schema") {
+            if (!parse_grammar_param(value, param == "json_schema", params)) {
+                return false;
+            }
+            field = SAMPLING_GRAMMAR;
+        } else {
+            PyErr_Format(PyExc_ValueError, "Unknown sampling parameter: %s", name);
+            return false;
+        }
+        
+        if (PyErr_Occurred()) {
+            return false;
+        }
+        if (fields) {
+            *fields |= field;
+        }
+    }
+    return true;
+}
+
+static PyObject* sampling_params_to_dict(const SamplingParams& params) {
+    PyObject* dict = PyDict_New();
+    PyObject* seed = params.seed >= 0 ? PyLong_FromLongLong(params.seed) : Py_NewRef(Py_None);
+    PyDict_SetItemString(dict, "temperature", PyFloat_FromDouble(params.temperature));
+    PyDict_SetItemString(dict, "top_k", PyLong_FromLong(params.top_k));
+    PyDict_SetItemString(dict, "top_p", PyFloat_FromDouble(params.top_p));
+    PyDict_SetItemString(dict, "min_p", PyFloat_FromDouble(params.min_p));
+    PyDict_SetItemString(dict, "repeat_penalty", PyFloat_FromDouble(params.repeat_penalty));
+    PyDict_SetItemString(dict, "repeat_last_n", PyLong_FromLong(params.repeat_last_n));
+    PyDict_SetItemString(dict, "allowed_chars", PyUnicode_FromString(params.allowed_chars.c_str()));
+    PyDict_SetItemString(dict, "seed", seed);
+    Py_DECREF(seed);
+    PyObject* grammar = params.grammar ? PyUnicode_FromString(token_grammar::source(*params.grammar).c_str())
+                                       : Py_NewRef(Py_None);
+    PyDict_SetItemString(dict, "grammar", grammar);
+    Py_DECREF(grammar);
+    return dict;
+}
+
+// Generated text as str. A generation cut off by max_tokens or a
+// cancellation can end inside a multi-byte character; that tail decodes
+// as U+FFFD instead of raising.
+static PyObject* generated_text(const char* data, size_t size) {
+    return PyUnicode_DecodeUTF8(data, static_cast<Py_ssize_t>(size), "replace");
+}
+
+static PyObject* generated_text(const std::string& text) {
+    return generated_text(text.data(), text.size());
+}
+
+// Defaults, then the positional temperature, then the params dict
+static bool build_sampling_params(LlamaCPPInterface* llama, PyObject* temperature_obj, PyObject* params_obj,
+                                  SamplingParams& params) {
+    params = llama->get_default_params();
+    if (temperature_obj && temperature_obj != Py_None) {
+        params.temperature = static_cast<float>(PyFloat_AsDouble(temperature_obj));
+        if (PyErr_Occurred()) {
+            return false;
+        }
+    }
+    return parse_sampling_params(params_obj, params);
+}
+
+// Completions submitted from Python, keyed by request id until collected or
+// cancelled. Guarded by g_submitted_mutex, which is never held while
+// waiting on a future.
+struct SubmittedRequest {
+    std::shared_future<std::string> result;
+    std::shared_ptr<std::atomic<bool>> cancel;
+};
+
+static std::map<long long, SubmittedRequest> g_submitted_requests;
+static long long g_next_request_id = 1;
+static std::mutex g_submitted_mutex;
+
+static PyObject* generate_text_cpp(PyObject* self, PyObject* args) {
+    const char* prompt;
+    int max_tokens = 100;
+    PyObject* temperature_obj = nullptr;
+    PyObject* params_obj = nullptr;
+    
+    if (!PyArg_ParseTuple(args, "s|iOO", &prompt, &max_tokens, &temperature_obj, &params_obj)) {
+        return nullptr;
+    }
+    
+    LlamaCPPInterface* llama = get_llama_interface();
+    if (!llama || !llama->is_loaded()) {
+        PyErr_SetString(PyExc_RuntimeError, "Model not loaded");
+        return nullptr;
+    }
+    
+    SamplingParams params;
+    if (!build_sampling_params(llama, temperature_obj, params_obj, params)) {
+        return nullptr;
+    }
+    
+    std::string prompt_text(prompt);
+    std::string result;
+    bool cached = g_content_cache.enabled();
+    uint64_t cache_key = 0;
+    if (cached) {
+        int found = content_cache_lookup(prompt_text, max_tokens, params, cache_key, result);
+        if (found < 0) {
+            return nullptr;
+        }
+        if (found) {
+            return generated_text(result);
+        }
+    }
+    
+    Py_BEGIN_ALLOW_THREADS
+    result = llama->generate_text(prompt_text, max_tokens, params);
+    if (cached) {
+        content_cache_insert(cache_key, result);
+    }
+    Py_END_ALLOW_THREADS
+    return generated_text(result);
+}
+
+// generate_text without the str: the UTF-8 result moves into a NativeBuffer
+// that can be written to a file or archive as is
+static PyObject* generate_buffer_cpp(PyObject* self, PyObject* args) {
+    const char* prompt;
+    int max_tokens = 100;
+    PyObject* temperature_obj = nullptr;
+    PyObject* params_obj = nullptr;
+    
+    if (!PyArg_ParseTuple(args, "s|iOO", &prompt, &max_tokens, &temperature_obj, &params_obj)) {
+        return nullptr;
+    }
+    
+    LlamaCPPInterface* llama = get_llama_interface();
+    if (!llama || !llama->is_loaded()) {
+        PyErr_SetString(PyExc_RuntimeError, "Model not loaded");
+        return nullptr;
+    }
+    
+    SamplingParams params;
+    if (!build_sampling_params(llama, temperature_obj, params_obj, params)) {
+        return nullptr;
+    }
+    
+    std::string prompt_text(prompt);
+    std::string result;
+    bool cached = g_content_cache.enabled();
+    uint64_t cache_key = 0;
+    if (cached) {
+        int found = content_cache_lookup(prompt_text, max_tokens, params, cache_key, result);
+        if (found < 0) {
+            return nullptr;
+        }
+        if (found) {
+            return native_buffer::from_string(std::move(result));
+        }
+    }
+    
+    Py_BEGIN_ALLOW_THREADS
+    result = llama->generate_text(prompt_text, max_tokens, params);
+    if (cached) {
+        content_cache_insert(cache_key, result);
+    }
+    Py_END_ALLOW_THREADS
+    return native_buffer::from_string(std::move(result));
+}
+
+static PyObject* generate_batch_cpp(PyObject* self, PyObject* args) {
+    PyObject* prompts_obj;
+    int max_tokens = 100;
+    PyObject* temperature_obj = nullptr;
+    PyObject* params_obj = nullptr;
+    
+    if (!PyArg_ParseTuple(args, "O|iOO", &prompts_obj, &max_tokens, &temperature_obj, &params_obj)) {
+        return nullptr;
+    }
+    
+    LlamaCPPInterface* llama = get_llama_interface();
+    if (!llama || !llama->is_loaded()) {
+        PyErr_SetString(PyExc_RuntimeError, "Model not loaded");
+        return nullptr;
+    }
+    
+    SamplingParams params;
+    if (!build_sampling_params(llama, temperature_obj, params_obj, params)) {
+        return nullptr;
+    }
+    
+    PyObject* seq = PySequence_Fast(prompts_obj, "Expected a sequence of prompts");
+    if (!seq) {
+        return nullptr;
+    }
+    
+    std::vector<std::string> prompts;
+    Py_ssize_t n_prompts = PySequence_Fast_GET_SIZE(seq);
+    for (Py_ssize_t i = 0; i < n_prompts; ++i) {
+        const char* prompt = PyUnicode_AsUTF8(PySequence_Fast_GET_ITEM(seq, i));
+        if (!prompt) {
+            Py_DECREF(seq);
+            return nullptr;
+        }
+        prompts.emplace_back(prompt);
+    }
+    Py_DECREF(seq);
+    
+    // Cached prompts are answered first; only the rest are decoded
+    std::vector<std::string> results(prompts.size());
+    std::vector<size_t> pending;
+    std::vector<uint64_t> cache_keys;
+    bool cached = g_content_cache.enabled();
+    for (size_t i = 0; i < prompts.size(); ++i) {
+        uint64_t cache_key = 0;
+        int found = cached ? content_cache_lookup(prompts[i], max_tokens, params, cache_key, results[i]) : 0;
+        if (found < 0) {
+            return nullptr;
+        }
+        if (!found) {
+            pending.push_back(i);
+            cache_keys.push_back(cache_key);
+        }
+    }
+    
+    // Submit everything first so the scheduler can decode them together
+    Py_BEGIN_ALLOW_THREADS
+    std::vector<std::future<std::string>> futures;
+    futures.reserve(pending.size());
+    for (size_t i : pending) {
+        futures.push_back(llama->submit(prompts[i], max_tokens, params));
+    }
+    for (size_t j = 0; j < futures.size(); ++j) {
+        results[pending[j]] = futures[j].get();
+        if (cached) {
+            content_cache_insert(cache_keys[j], results[pending[j]]);
+        }
+    }
+    Py_END_ALLOW_THREADS
+    
+    PyObject* result_list = PyList_New(results.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        PyList_SET_ITEM(result_list, i, generated_text(results[i]));
+    }
+    return result_list;
+}
+
+static PyObject* submit_cpp(PyObject* self, PyObject* args) {
+    const char* prompt;
+    int max_tokens = 100;
+    PyObject* temperature_obj = nullptr;
+    PyObject* params_obj = nullptr;
+    
+    if (!PyArg_ParseTuple(args, "s|iOO", &prompt, &max_tokens, &temperature_obj, &params_obj)) {
+        return nullptr;
+    }
+    
+    LlamaCPPInterface* llama = get_llama_interface();
+    if (!llama || !llama->is_loaded()) {
+        PyErr_SetString(PyExc_RuntimeError, "Model not loaded");
+        return nullptr;
+    }
+    
+    SamplingParams params;
+    if (!build_sampling_params(llama, temperature_obj, params_obj, params)) {
+        return nullptr;
+    }
+    
+    // Tokenization happens in submit(), so release the GIL around it
+    std::string prompt_text(prompt);
+    long long request_id;
+    Py_BEGIN_ALLOW_THREADS
+    auto cancel = std::make_shared<std::atomic<bool>>(false);
+    std::shared_future<std::string> result = llama->submit(prompt_text, max_tokens, params, nullptr, cancel).share();
+    {
+        std::lock_guard<std::mutex> lock(g_submitted_mutex);
+        request_id = g_next_request_id++;
+        g_submitted_requests[request_id] = SubmittedRequest{std::move(result), std::move(cancel)};
+    }
+    Py_END_ALLOW_THREADS
+    return PyLong_FromLongLong(request_id);
+}
+
+// Forget a submitted request: its generation stops and its result is freed
+// instead of waiting for a collect() that will never come
+static PyObject* cancel_cpp(PyObject* self, PyObject* args) {
+    long long request_id;
+    
+    if (!PyArg_ParseTuple(args, "L", &request_id)) {
+        return nullptr;
+    }
+    
+    std::lock_guard<std::mutex> lock(g_submitted_mutex);
+    auto it = g_submitted_requests.find(request_id);
+    if (it == g_submitted_requests.end()) {
+        Py_RETURN_FALSE;
+    }
+    it->second.cancel->store(true);
+    g_submitted_requests.erase(it);
+    Py_RETURN_TRUE;
+}
+
+static PyObject* collect_cpp(PyObject* self, PyObject* args) {
+    long long request_id;
+    PyObject* timeout_obj = nullptr;
+    
+    if (!PyArg_ParseTuple(args, "L|O", &request_id, &timeout_obj)) {
+        return nullptr;
+    }
+    
+    // Wait on a copy; the map may change while the GIL is released
+    std::shared_future<std::string> result;
+    {
+        std::lock_guard<std::mutex> lock(g_submitted_mutex);
+        auto it = g_submitted_requests.find(request_id);
+        if (it != g_submitted_requests.end()) {
+            result = it->second.result;
+        }
+    }
+    if (!result.valid()) {
+        PyErr_SetString(PyExc_KeyError, "Unknown, collected or cancelled request id");
+        return nullptr;
+    }
+    
+    double timeout = -1.0;
+    if (timeout_obj && timeout_obj != Py_None) {
+        timeout = PyFloat_AsDouble(timeout_obj);
+        if (PyErr_Occurred()) {
+            return nullptr;
+        }
+    }
+    
+    bool ready;
+    Py_BEGIN_ALLOW_THREADS
+    if (timeout < 0) {
+        result.wait();
+        ready = true;
+    } else {
+        ready = result.wait_for(std::chrono::duration<double>(timeout)) == std::future_status::ready;
+    }
+    Py_END_ALLOW_THREADS
+    
+    if (!ready) {
+        Py_RETURN_NONE;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(g_submitted_mutex);
+        g_submitted_requests.erase(request_id);
+    }
+    const std::string& text = result.get();
+    return generated_text(text);
+}
+
+// Chunks are delivered once this many bytes are buffered, or after
+// kStreamFlushInterval with anything pending
+static const std::chrono::milliseconds kStreamFlushInterval(50);
+
+static bool raise_stream_error(TokenStream& stream) {
+    std::string message;
+    if (stream.failed(message)) {
+        PyErr_SetString(PyExc_RuntimeError, message.c_str());
+        return true;
+    }
+    return false;
+}
+
+static PyObject* generate_stream_cpp(PyObject* self, PyObject* args) {
+    const char* prompt;
+    PyObject* callback;
+    int max_tokens = 100;
+    PyObject* temperature_obj = nullptr;
+    PyObject* params_obj = nullptr;
+    Py_ssize_t chunk_bytes = 16;
+    
+    if (!PyArg_ParseTuple(args, "sO|iOOn", &prompt, &callback, &max_tokens, &temperature_obj, &params_obj, &chunk_bytes)) {
+        return nullptr;
+    }
+    
+    if (!PyCallable_Check(callback)) {
+        PyErr_SetString(PyExc_TypeError, "callback must be callable");
+        return nullptr;
+    }
+    
+    LlamaCPPInterface* llama = get_llama_interface();
+    if (!llama || !llama->is_loaded()) {
+        PyErr_SetString(PyExc_RuntimeError, "Model not loaded");
+        return nullptr;
+    }
+    
+    SamplingParams params;
+    if (!build_sampling_params(llama, temperature_obj, params_obj, params)) {
+        return nullptr;
+    }
+    
+    auto stream = std::make_shared<TokenStream>();
+    std::string prompt_text(prompt);
+    std::future<std::string> result;
+    Py_BEGIN_ALLOW_THREADS
+    result = llama->submit(prompt_text, max_tokens, params, stream);
+    Py_END_ALLOW_THREADS
+    
+    // Decode runs on the scheduler thread; hold the GIL only per callback
+    std::string chunk;
+    while (true) {
+        bool more;
+        Py_BEGIN_ALLOW_THREADS
+        more = stream->next_chunk(chunk, static_cast<size_t>(std::max<Py_ssize_t>(1, chunk_bytes)), kStreamFlushInterval);
+        Py_END_ALLOW_THREADS
+        
+        if (!more) {
+            break;
+        }
+        
+        PyObject* chunk_text = generated_text(chunk);
+        PyObject* ret = chunk_text ? PyObject_CallOneArg(callback, chunk_text) : nullptr;
+        Py_XDECREF(chunk_text);
+        if (!ret) {
+            stream->cancel();
+            Py_BEGIN_ALLOW_THREADS
+            result.wait();
+            Py_END_ALLOW_THREADS
+            return nullptr;
+        }
+        Py_DECREF(ret);
+    }
+    
+    std::string text;
+    Py_BEGIN_ALLOW_THREADS
+    text = result.get();
+    Py_END_ALLOW_THREADS
+    
+    if (raise_stream_error(*stream)) {
+        return nullptr;
+    }
+    return generated_text(text);
+}
+
+// Iterator over the chunks of one streaming request
+typedef struct {
+    PyObject_HEAD
+    std::shared_ptr<TokenStream>* stream;
+    size_t chunk_bytes;
+} PyTokenStream;
+
+static PyTypeObject PyTokenStreamType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+static void token_stream_dealloc(PyTokenStream* self) {
+    if (self->stream) {
+        (*self->stream)->cancel();
+        delete self->stream;
+    }
+    Py_TYPE(self)->tp_free(reinterpret_cast<PyObject*>(self));
+}
+
+static PyObject* token_stream_next(PyTokenStream* self) {
+    std::shared_ptr<TokenStream> stream = *self->stream;
+    std::string chunk;
+    bool more;
+    
+    Py_BEGIN_ALLOW_THREADS
+    more = stream->next_chunk(chunk, self->chunk_bytes, kStreamFlushInterval);
+    Py_END_ALLOW_THREADS
+    
+    if (!more) {
+        raise_stream_error(*stream);
+        return nullptr;  // StopIteration unless an error was set
+    }
+    return generated_text(chunk);
+}
+
+static PyObject* token_stream_cancel(PyTokenStream* self, PyObject* args) {
+    (*self->stream)->cancel();
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef TokenStreamMethods[] = {
+    {"cancel", reinterpret_cast<PyCFunction>(token_stream_cancel), METH_NOARGS, "Stop generation after the current token"},
+    {nullptr, nullptr, 0, nullptr}
+};
+
+static bool init_token_stream_type() {
+    // Module exec runs once per interpreter; the static type is shared
+    if (PyTokenStreamType.tp_flags & Py_TPFLAGS_READY) {
+        return true;
+    }
+    
+    PyTokenStreamType.tp_name = "llama_cpp_interface.TokenStream";
+    PyTokenStreamType.tp_doc = "Iterator over generated text chunks; returned by stream()";
+    PyTokenStreamType.tp_basicsize = sizeof(PyTokenStream);
+    PyTokenStreamType.tp_flags = Py_TPFLAGS_DEFAULT;
+    PyTokenStreamType.tp_dealloc = reinterpret_cast<destructor>(token_stream_dealloc);
+    PyTokenStreamType.tp_iter = PyObject_SelfIter;
+    PyTokenStreamType.tp_iternext = reinterpret_cast<iternextfunc>(token_stream_next);
+    PyTokenStreamType.tp_methods = TokenStreamMethods;
+    return PyType_Ready(&PyTokenStreamType) == 0;
+}
+
+static PyObject* stream_cpp(PyObject* self, PyObject* args) {
+    const char* prompt;
+    int max_tokens = 100;
+    PyObject* temperature_obj = nullptr;
+    PyObject* params_obj = nullptr;
+    Py_ssize_t chunk_bytes = 16;
+    
+    if (!PyArg_ParseTuple(args, "s|iOOn", &prompt, &max_tokens, &temperature_obj, &params_obj, &chunk_bytes)) {
+        return nullptr;
+    }
+    
+    LlamaCPPInterface* llama = get_llama_interface();
+    if (!llama || !llama->is_loaded()) {
+        PyErr_SetString(PyExc_RuntimeError, "Model not loaded");
+        return nullptr;
+    }
+    
+    SamplingParams params;
+    if (!build_sampling_params(llama, temperature_obj, params_obj, params)) {
+        return nullptr;
+    }
+    
+    PyTokenStream* iterator = PyObject_New(PyTokenStream, &PyTokenStreamType);
+    if (!iterator) {
+        return nullptr;
+    }
+    iterator->stream = new std::shared_ptr<TokenStream>(std::make_shared<TokenStream>());
+    iterator->chunk_bytes = static_cast<size_t>(std::max<Py_ssize_t>(1, chunk_bytes));
+    
+    // The completion is also delivered through the stream
+    std::string prompt_text(prompt);
+    std::shared_ptr<TokenStream> stream = *iterator->stream;
+    Py_BEGIN_ALLOW_THREADS
+    llama->submit(prompt_text, max_tokens, params, stream);
+    Py_END_ALLOW_THREADS
+    return reinterpret_cast<PyObject*>(iterator);
+}
+
+static PyObject* cache_prefix_cpp(PyObject* self, PyObject* args) {
+    const char* text;
+    
+    if (!PyArg_ParseTuple(args, "s", &text)) {
+        return nullptr;
+    }
+    
+    LlamaCPPInterface* llama = get_llama_interface();
+    if (!llama || !llama->is_loaded()) {
+        PyErr_SetString(PyExc_RuntimeError, "Model not loaded");
+        return nullptr;
+    }
+    
+    std::string prefix(text);
+    std::string error;
+    size_t n_tokens;
+    Py_BEGIN_ALLOW_THREADS
+    n_tokens = llama->cache_prefix(prefix, error);
+    Py_END_ALLOW_THREADS
+    
+    if (!error.empty()) {
+        PyErr_SetString(PyExc_RuntimeError, error.c_str());
+        return nullptr;
+    }
+    return PyLong_FromSize_t(n_tokens);
+}
+
+static PyObject* save_prefix_cache_cpp(PyObject* self, PyObject* args) {
+    const char* path;
+    
+    if (!PyArg_ParseTuple(args, "s", &path)) {
+        return nullptr;
+    }
+    
+    LlamaCPPInterface* llama = get_llama_interface();
+    if (!llama || !llama->is_loaded()) {
+        PyErr_SetString(PyExc_RuntimeError, "Model not loaded");
+        return nullptr;
+    }
+    
+    std::string file_path(path);
+    size_t count = 0;
+    std::string error;
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS
+    ok = llama->save_prefix_cache(file_path, count, error);
+    Py_END_ALLOW_THREADS
+    
+    if (!ok) {
+        PyErr_SetString(PyExc_OSError, error.c_str());
+        return nullptr;
+    }
+    return PyLong_FromSize_t(count);
+}
+
+static PyObject* load_prefix_cache_cpp(PyObject* self, PyObject* args) {
+    const char* path;
+    
+    if (!PyArg_ParseTuple(args, "s", &path)) {
+        return nullptr;
+    }
+    
+    LlamaCPPInterface* llama = get_llama_interface();
+    if (!llama || !llama->is_loaded()) {
+        PyErr_SetString(PyExc_RuntimeError, "Model not loaded");
+        return nullptr;
+    }
+    
+    std::string file_path(path);
+    size_t count = 0;
+    std::string error;
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS
+    ok = llama->load_prefix_cache(file_path, count, error);
+    Py_END_ALLOW_THREADS
+    
+    if (!ok) {
+        PyErr_SetString(PyExc_OSError, error.c_str());
+        return nullptr;
+    }
+    return PyLong_FromSize_t(count);
+}
+
+static PyObject* clear_prefix_cache_cpp(PyObject* self, PyObject* args) {
+    LlamaCPPInterface* llama = get_llama_interface();
+    if (llama) {
+        llama->clear_prefix_cache();
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject* set_prefix_cache_limit_cpp(PyObject* self, PyObject* args) {
+    unsigned long long limit;
+    
+    if (!PyArg_ParseTuple(args, "K", &limit)) {
+        return nullptr;
+    }
+    
+    LlamaCPPInterface* llama = get_llama_interface();
+    if (!llama) {
+        PyErr_SetString(PyExc_RuntimeError, "LlamaCPP interface not initialized");
+        return nullptr;
+    }
+    
+    llama->set_prefix_cache_limit(static_cast<size_t>(limit));
+    Py_RETURN_NONE;
+}
+
+static PyObject* get_prefix_cache_stats_cpp(PyObject* self, PyObject* args) {
+    LlamaCPPInterface* llama = get_llama_interface();
+    if (!llama) {
+        PyErr_SetString(PyExc_RuntimeError, "LlamaCPP interface not initialized");
+        return nullptr;
+    }
+    
+    PyObject* stats = PyDict_New();
+    for (const auto& item : llama->get_prefix_cache_stats()) {
+        PyObject* value = PyLong_FromUnsignedLongLong(static_cast<unsigned long long>(item.second));
+        PyDict_SetItemString(stats, item.first.c_str(), value);
+        Py_DECREF(value);
+    }
+    return stats;
+}
+
+static PyObject* set_content_cache_cpp(PyObject* self, PyObject* args) {
+    PyObject* options;
+    
+    if (!PyArg_ParseTuple(args, "O!", &PyDict_Type, &options)) {
+        return nullptr;
+    }
+    
+    ContentCache::Config config = g_content_cache.get_config();
+    std::string path;
+    PyObject* key;
+    PyObject* value;
+    Py_ssize_t pos = 0;
+    while (PyDict_Next(options, &pos, &key, &value)) {
+        const char* name = PyUnicode_Check(key) ? PyUnicode_AsUTF8(key) : nullptr;
+        if (!name) {
+            PyErr_SetString(PyExc_TypeError, "Content cache option names must be strings");
+            return nullptr;
+        }
+        
+        std::string option(name);
+        if (option == "reuse") {
+            config.reuse = static_cast<uint32_t>(PyLong_AsUnsignedLong(value));
+        } else if (option == "variants") {
+            config.variants = static_cast<uint32_t>(PyLong_AsUnsignedLong(value));
+        } else if (option == "max_bytes") {
+            config.max_bytes = static_cast<size_t>(PyLong_AsUnsignedLongLong(value));
+        } else if (option == "shards") {
+            config.shards = static_cast<size_t>(PyLong_AsUnsignedLong(value));
+        } else if (option == "path") {
+            if (value != Py_None) {
+                const char* text = PyUnicode_AsUTF8(value);
+                if (!text) {
+                    return nullptr;
+                }
+                path = text;
+            }
+        } else {
+            PyErr_Format(PyExc_ValueError, "Unknown content cache option: %s", name);
+            return nullptr;
+        }
+        
+        if (PyErr_Occurred()) {
+            return nullptr;
+        }
+    }
+    
+    size_t count = 0;
+    std::string error;
+    bool ok = true;
+    Py_BEGIN_ALLOW_THREADS
+    g_content_cache.configure(config);
+    if (!path.empty() && path != g_content_cache.path()) {
+        ok = g_content_cache.open(path, count, error);
+    }
+    Py_END_ALLOW_THREADS
+    
+    if (!ok) {
+        PyErr_SetString(PyExc_OSError, error.c_str());
+        return nullptr;
+    }
+    return PyLong_FromSize_t(count);
+}
+
+static PyObject* save_content_cache_cpp(PyObject* self, PyObject* args) {
+    const char* path = nullptr;
+    
+    if (!PyArg_ParseTuple(args, "|z", &path)) {
+        return nullptr;
+    }
+    
+    std::string file_path = path ? path : g_content_cache.path();
+    if (file_path.empty()) {
+        PyErr_SetString(PyExc_ValueError, "No path given and the content cache has none");
+        return nullptr;
+    }
+    
+    size_t count = 0;
+    std::string error;
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS
+    ok = g_content_cache.save(file_path, count, error);
+    Py_END_ALLOW_THREADS
+    
+    if (!ok) {
+        PyErr_SetString(PyExc_OSError, error.c_str());
+        return nullptr;
+    }
+    return PyLong_FromSize_t(count);
+}
+
+static PyObject* clear_content_cache_cpp(PyObject* self, PyObject* args) {
+    Py_BEGIN_ALLOW_THREADS
+    g_content_cache.clear();
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
+
+static PyObject* set_content_mutator_cpp(PyObject* self, PyObject* args) {
+    PyObject* mutator;
+    
+    if (!PyArg_ParseTuple(args, "O", &mutator)) {
+        return nullptr;
+    }
+    if (mutator != Py_None && !PyCallable_Check(mutator)) {
+        PyErr_SetString(PyExc_TypeError, "Mutator must be callable or None");
+        return nullptr;
+    }
+    
+    PyObject* previous;
+    {
+        std::lock_guard<std::mutex> lock(g_content_mutator_mutex);
+        previous = g_content_mutator;
+        g_content_mutator = mutator == Py_None ? nullptr : Py_NewRef(mutator);
+    }
+    Py_XDECREF(previous);
+    Py_RETURN_NONE;
+}
+
+static PyObject* get_content_cache_stats_cpp(PyObject* self, PyObject* args) {
+    ContentCache::Stats stats = g_content_cache.stats();
+    uint64_t lookups = stats.hits + stats.misses;
+    return Py_BuildValue("{s:I,s:I,s:K,s:n,s:n,s:n,s:n,s:n,s:K,s:K,s:d,s:K,s:K,s:s}",
+                         "reuse", stats.config.reuse,
+                         "variants", stats.config.variants,
+                         "max_bytes", static_cast<unsigned long long>(stats.config.max_bytes),
+                         "shards", static_cast<Py_ssize_t>(stats.config.shards),
+                         "keys", static_cast<Py_ssize_t>(stats.keys),
+                         "texts", static_cast<Py_ssize_t>(stats.texts),
+                         "bytes", static_cast<Py_ssize_t>(stats.bytes),
+                         "mapped_bytes", static_cast<Py_ssize_t>(stats.mapped_bytes),
+                         "hits", static_cast<unsigned long long>(stats.hits),
+                         "misses", static_cast<unsigned long long>(stats.misses),
+                         "hit_rate", lookups ? static_cast<double>(stats.hits) / lookups : 0.0,
+                         "inserts", static_cast<unsigned long long>(stats.inserts),
+                         "evictions", static_cast<unsigned long long>(stats.evictions),
+                         "path", stats.path.c_str());
+}
+
+// Check a GBNF grammar (compiling it into the cache); returns its rule count
+static PyObject* compile_grammar_cpp(PyObject* self, PyObject* args) {
+    PyObject* grammar_obj;
+    
+    if (!PyArg_ParseTuple(args, "U", &grammar_obj)) {
+        return nullptr;
+    }
+    
+    SamplingParams params;
+    if (!parse_grammar_param(grammar_obj, false, params)) {
+        return nullptr;
+    }
+    return PyLong_FromSize_t(token_grammar::rule_count(*params.grammar));
+}
+
+static PyObject* json_schema_to_grammar_cpp(PyObject* self, PyObject* args) {
+    PyObject* schema_obj;
+    
+    if (!PyArg_ParseTuple(args, "O", &schema_obj)) {
+        return nullptr;
+    }
+    
+    SamplingParams params;
+    if (!parse_grammar_param(schema_obj, true, params)) {
+        return nullptr;
+    }
+    return PyUnicode_FromString(token_grammar::source(*params.grammar).c_str());
+}
+
+static PyObject* get_grammar_cache_stats_cpp(PyObject* self, PyObject* args) {
+    token_grammar::CacheStats stats = token_grammar::cache_stats();
+    return Py_BuildValue("{s:n,s:K,s:K}",
+                         "grammars", static_cast<Py_ssize_t>(stats.grammars),
+                         "hits", static_cast<unsigned long long>(stats.hits),
+                         "compiles", static_cast<unsigned long long>(stats.compiles));
+}
+
+static PyObject* clear_grammar_cache_cpp(PyObject* self, PyObject* args) {
+    token_grammar::clear_cache();
+    Py_RETURN_NONE;
+}
+
+// Inference server owned by this process, if serve() was called
+static std::unique_ptr<InferenceServer> g_inference_server = nullptr;
+static std::mutex g_inference_server_mutex;
+
+static PyObject* serve_cpp(PyObject* self, PyObject* args) {
+    const char* socket_path;
+    
+    if (!PyArg_ParseTuple(args, "s", &socket_path)) {
+        return nullptr;
+    }
+    
+    LlamaCPPInterface* llama = get_llama_interface();
+    if (!llama || !llama->is_loaded()) {
+        PyErr_SetString(PyExc_RuntimeError, "Model not loaded");
         return nullptr;
     }
     
-    bool success = g_llama_interface->load_model(std::string(model_path));
-    return PyBool_FromLong(success ? 1 : 0);
+    std::string path(socket_path);
+    std::string error;
+    bool ok = true;
+    Py_BEGIN_ALLOW_THREADS
+    {
+        std::lock_guard<std::mutex> lock(g_inference_server_mutex);
+        if (g_inference_server) {
+            error = "Inference server already running on " + g_inference_server->get_socket_path();
+            ok = false;
+        } else {
+            auto server = std::make_unique<InferenceServer>(*llama);
+            ok = server->start(path, error);
+            if (ok) {
+                g_inference_server = std::move(server);
+            }
+        }
+    }
+    Py_END_ALLOW_THREADS
+    
+    if (!ok) {
+        PyErr_SetString(PyExc_OSError, error.c_str());
+        return nullptr;
+    }
+    Py_RETURN_TRUE;
 }
 
-static PyObject* generate_text_cpp(PyObject* self, PyObject* args) {
-    const char* prompt;
+static PyObject* stop_server_cpp(PyObject* self, PyObject* args) {
+    std::unique_ptr<InferenceServer> server;
+    {
+        std::lock_guard<std::mutex> lock(g_inference_server_mutex);
+        server = std::move(g_inference_server);
+    }
+    
+    // Waits for in-flight requests to be answered
+    Py_BEGIN_ALLOW_THREADS
+    server.reset();
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
+
+static PyObject* get_server_stats_cpp(PyObject* self, PyObject* args) {
+    std::map<std::string, double> values;
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(g_inference_server_mutex);
+        if (!g_inference_server) {
+            Py_RETURN_NONE;
+        }
+        values = g_inference_server->get_stats();
+        path = g_inference_server->get_socket_path();
+    }
+    
+    PyObject* stats = PyDict_New();
+    for (const auto& item : values) {
+        PyObject* value = PyLong_FromUnsignedLongLong(static_cast<unsigned long long>(item.second));
+        PyDict_SetItemString(stats, item.first.c_str(), value);
+        Py_DECREF(value);
+    }
+    PyObject* socket = PyUnicode_FromString(path.c_str());
+    PyDict_SetItemString(stats, "socket_path", socket);
+    Py_DECREF(socket);
+    return stats;
+}
+
+// Explicit overrides only; the server fills the rest from its defaults
+static bool build_remote_params(PyObject* temperature_obj, PyObject* params_obj,
+                                SamplingParams& overrides, uint32_t& fields) {
+    fields = 0;
+    if (temperature_obj && temperature_obj != Py_None) {
+        overrides.temperature = static_cast<float>(PyFloat_AsDouble(temperature_obj));
+        if (PyErr_Occurred()) {
+            return false;
+        }
+        fields |= SAMPLING_TEMPERATURE;
+    }
+    return parse_sampling_params(params_obj, overrides, &fields);
+}
+
+// A single prompt returns a string, a sequence returns a list
+static bool parse_prompts(PyObject* obj, std::vector<std::string>& prompts, bool& single) {
+    single = PyUnicode_Check(obj);
+    if (single) {
+        const char* prompt = PyUnicode_AsUTF8(obj);
+        if (!prompt) {
+            return false;
+        }
+        prompts.emplace_back(prompt);
+        return true;
+    }
+    
+    PyObject* seq = PySequence_Fast(obj, "Expected a prompt or a sequence of prompts");
+    if (!seq) {
+        return false;
+    }
+    Py_ssize_t n_prompts = PySequence_Fast_GET_SIZE(seq);
+    for (Py_ssize_t i = 0; i < n_prompts; ++i) {
+        const char* prompt = PyUnicode_AsUTF8(PySequence_Fast_GET_ITEM(seq, i));
+        if (!prompt) {
+            Py_DECREF(seq);
+            return false;
+        }
+        prompts.emplace_back(prompt);
+    }
+    Py_DECREF(seq);
+    return true;
+}
+
+static PyObject* texts_to_python(const std::vector<std::string>& texts, bool single) {
+    if (single) {
+        return generated_text(texts[0]);
+    }
+    PyObject* result_list = PyList_New(texts.size());
+    for (size_t i = 0; i < texts.size(); ++i) {
+        PyList_SET_ITEM(result_list, i, generated_text(texts[i]));
+    }
+    return result_list;
+}
+
+static PyObject* remote_generate_cpp(PyObject* self, PyObject* args) {
+    const char* socket_path;
+    PyObject* prompts_obj;
     int max_tokens = 100;
-    float temperature = 0.7f;
+    PyObject* temperature_obj = nullptr;
+    PyObject* params_obj = nullptr;
     
-    if (!PyArg_ParseTuple(args, "s|if", &prompt, &max_tokens, &temperature)) {
+    if (!PyArg_ParseTuple(args, "sO|iOO", &socket_path, &prompts_obj, &max_tokens, &temperature_obj, &params_obj)) {
         return nullptr;
     }
     
-    if (!g_llama_interface || !g_llama_interface->is_loaded()) {
-        PyErr_SetString(PyExc_RuntimeError, "Model not loaded");
+    SamplingParams overrides;
+    uint32_t fields;
+    if (!build_remote_params(temperature_obj, params_obj, overrides, fields)) {
+        return nullptr;
+    }
+    
+    bool single;
+    std::vector<std::string> prompts;
+    if (!parse_prompts(prompts_obj, prompts, single)) {
+        return nullptr;
+    }
+    
+    std::string path(socket_path);
+    std::vector<std::string> results;
+    std::string error;
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS
+    ok = remote_generate(path, prompts, max_tokens, overrides, fields, results, error);
+    Py_END_ALLOW_THREADS
+    
+    if (!ok) {
+        PyErr_SetString(PyExc_ConnectionError, error.c_str());
+        return nullptr;
+    }
+    
+    return texts_to_python(results, single);
+}
+
+static PyObject* set_sampling_params_cpp(PyObject* self, PyObject* args) {
+    PyObject* params_obj;
+    
+    if (!PyArg_ParseTuple(args, "O", &params_obj)) {
+        return nullptr;
+    }
+    
+    LlamaCPPInterface* llama = get_llama_interface();
+    if (!llama) {
+        PyErr_SetString(PyExc_RuntimeError, "LlamaCPP interface not initialized");
+        return nullptr;
+    }
+    
+    SamplingParams params = llama->get_default_params();
+    if (!parse_sampling_params(params_obj, params)) {
         return nullptr;
     }
     
-    std::string result = g_llama_interface->generate_text(std::string(prompt), max_tokens, temperature);
-    return PyUnicode_FromString(result.c_str());
+    llama->set_default_params(params);
+    return sampling_params_to_dict(params);
+}
+
+static PyObject* get_sampling_params_cpp(PyObject* self, PyObject* args) {
+    LlamaCPPInterface* llama = get_llama_interface();
+    if (!llama) {
+        return sampling_params_to_dict(SamplingParams());
+    }
+    
+    return sampling_params_to_dict(llama->get_default_params());
+}
+
+// Apply settings with the GIL released: a context rebuild waits for
+// running sequences to finish
+static bool apply_context_settings(LlamaCPPInterface* llama, const ContextSettings& settings) {
+    std::string error;
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS
+    ok = llama->reconfigure(settings, error);
+    Py_END_ALLOW_THREADS
+    
+    if (!ok) {
+        PyErr_SetString(PyExc_RuntimeError, error.c_str());
+    }
+    return ok;
 }
 
 static PyObject* set_threads_cpp(PyObject* self, PyObject* args) {
     int threads;
+    int threads_batch = 0;
     
-    if (!PyArg_ParseTuple(args, "i", &threads)) {
+    if (!PyArg_ParseTuple(args, "i|i", &threads, &threads_batch)) {
+        return nullptr;
+    }
+    if (threads <= 0 || threads_batch < 0) {
+        PyErr_SetString(PyExc_ValueError, "Thread counts must be positive");
         return nullptr;
     }
     
-    if (!g_llama_interface) {
+    LlamaCPPInterface* llama = get_llama_interface();
+    if (!llama) {
         PyErr_SetString(PyExc_RuntimeError, "LlamaCPP interface not initialized");
         return nullptr;
     }
     
-    g_llama_interface->set_threads(threads);
+    ContextSettings settings;
+    settings.n_threads = threads;
+    settings.n_threads_batch = threads_batch > 0 ? threads_batch : threads;
+    if (!apply_context_settings(llama, settings)) {
+        return nullptr;
+    }
     return PyBool_FromLong(1);
 }
 
+static bool parse_context_settings(PyObject* dict, ContextSettings& settings) {
+    PyObject* key;
+    PyObject* value;
+    Py_ssize_t pos = 0;
+    while (PyDict_Next(dict, &pos, &key, &value)) {
+        const char* name = PyUnicode_Check(key) ? PyUnicode_AsUTF8(key) : nullptr;
+        if (!name) {
+            PyErr_SetString(PyExc_TypeError, "Context parameter names must be strings");
+            return false;
+        }
+        
+        std::string param(name);
+        int* field;
+        if (param == "n_ctx") {
+            field = &settings.n_ctx;
+        } else if (param == "n_batch") {
+            field = &settings.n_batch;
+        } else if (param == "n_threads") {
+            field = &settings.n_threads;
+        } else if (param == "n_threads_batch") {
+            field = &settings.n_threads_batch;
+        } else {
+            PyErr_Format(PyExc_ValueError, "Unknown context parameter: %s", name);
+            return false;
+        }
+        
+        long number = PyLong_AsLong(value);
+        if (PyErr_Occurred()) {
+            return false;
+        }
+        if (number <= 0 || number > INT_MAX) {
+            PyErr_Format(PyExc_ValueError, "Context parameter %s must be a positive int", name);
+            return false;
+        }
+        *field = static_cast<int>(number);
+    }
+    return true;
+}
+
+static PyObject* set_context_params_cpp(PyObject* self, PyObject* args) {
+    PyObject* dict;
+    
+    if (!PyArg_ParseTuple(args, "O!", &PyDict_Type, &dict)) {
+        return nullptr;
+    }
+    
+    ContextSettings settings;
+    if (!parse_context_settings(dict, settings)) {
+        return nullptr;
+    }
+    
+    LlamaCPPInterface* llama = get_llama_interface();
+    if (!llama) {
+        PyErr_SetString(PyExc_RuntimeError, "LlamaCPP interface not initialized");
+        return nullptr;
+    }
+    
+    if (!apply_context_settings(llama, settings)) {
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject* get_context_params_cpp(PyObject* self, PyObject* args) {
+    LlamaCPPInterface* llama = get_llama_interface();
+    if (!llama) {
+        PyErr_SetString(PyExc_RuntimeError, "LlamaCPP interface not initialized");
+        return nullptr;
+    }
+    
+    ContextSettings settings;
+    bool pinned;
+    Py_BEGIN_ALLOW_THREADS
+    settings = llama->get_context_settings();
+    pinned = llama->threads_pinned();
+    Py_END_ALLOW_THREADS
+    
+    return Py_BuildValue("{s:i,s:i,s:i,s:i,s:i,s:O}",
+                         "n_ctx", settings.n_ctx,
+                         "n_batch", settings.n_batch,
+                         "n_threads", settings.n_threads,
+                         "n_threads_batch", settings.n_threads_batch,
+                         "n_parallel", llama->get_parallel(),
+                         "pinned", pinned ? Py_True : Py_False);
+}
+
+static PyObject* set_cpu_placement_cpp(PyObject* self, PyObject* args) {
+    int numa_node = -1;
+    int pin_threads = 1;
+    
+    if (!PyArg_ParseTuple(args, "|ip", &numa_node, &pin_threads)) {
+        return nullptr;
+    }
+    
+    LlamaCPPInterface* llama = get_llama_interface();
+    if (!llama) {
+        PyErr_SetString(PyExc_RuntimeError, "LlamaCPP interface not initialized");
+        return nullptr;
+    }
+    
+    const cpu_topology::Topology& topology = cpu_topology::get();
+    if (numa_node >= 0 && (static_cast<size_t>(numa_node) >= topology.node_cpus.size() ||
+                           topology.node_cpus[numa_node].empty())) {
+        PyErr_Format(PyExc_ValueError, "NUMA node %d has no usable CPUs", numa_node);
+        return nullptr;
+    }
+    
+    if (!llama->set_cpu_placement(numa_node, pin_threads != 0)) {
+        PyErr_SetString(PyExc_RuntimeError, "CPU placement must be set before load_model");
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
 static PyObject* get_threads_cpp(PyObject* self, PyObject* args) {
-    if (!g_llama_interface) {
+    LlamaCPPInterface* llama = get_llama_interface();
+    if (!llama) {
+        PyErr_SetString(PyExc_RuntimeError, "LlamaCPP interface not initialized");
+        return nullptr;
+    }
+    
+    int threads;
+    Py_BEGIN_ALLOW_THREADS
+    threads = llama->get_threads();
+    Py_END_ALLOW_THREADS
+    return PyLong_FromLong(threads);
+}
+
+// Registry handles (ModelRegistry)
+static PyObject* open_model_cpp(PyObject* self, PyObject* args) {
+    const char* model_path;
+    int n_parallel = 0;
+    PyObject* params_obj = nullptr;
+    
+    if (!PyArg_ParseTuple(args, "s|iO", &model_path, &n_parallel, &params_obj)) {
+        return nullptr;
+    }
+    
+    ContextSettings settings;
+    if (params_obj && params_obj != Py_None) {
+        if (!PyDict_Check(params_obj)) {
+            PyErr_SetString(PyExc_TypeError, "Context parameters must be a dict");
+            return nullptr;
+        }
+        if (!parse_context_settings(params_obj, settings)) {
+            return nullptr;
+        }
+    }
+    
+    std::string path(model_path);
+    std::string error;
+    long long handle;
+    Py_BEGIN_ALLOW_THREADS
+    handle = g_model_registry.open(path, n_parallel, settings, error);
+    Py_END_ALLOW_THREADS
+    
+    if (!handle) {
+        PyErr_SetString(PyExc_RuntimeError, error.c_str());
+        return nullptr;
+    }
+    return PyLong_FromLongLong(handle);
+}
+
+static PyObject* close_model_cpp(PyObject* self, PyObject* args) {
+    long long handle;
+    
+    if (!PyArg_ParseTuple(args, "L", &handle)) {
+        return nullptr;
+    }
+    
+    bool closed;
+    Py_BEGIN_ALLOW_THREADS
+    closed = g_model_registry.close(handle);
+    Py_END_ALLOW_THREADS
+    return PyBool_FromLong(closed ? 1 : 0);
+}
+
+static PyObject* generate_with_model_cpp(PyObject* self, PyObject* args) {
+    long long handle;
+    PyObject* prompts_obj;
+    int max_tokens = 100;
+    PyObject* temperature_obj = nullptr;
+    PyObject* params_obj = nullptr;
+    
+    if (!PyArg_ParseTuple(args, "LO|iOO", &handle, &prompts_obj, &max_tokens, &temperature_obj, &params_obj)) {
+        return nullptr;
+    }
+    
+    // Overrides apply on top of the handle's own defaults
+    SamplingParams overrides;
+    uint32_t fields;
+    if (!build_remote_params(temperature_obj, params_obj, overrides, fields)) {
+        return nullptr;
+    }
+    
+    bool single;
+    std::vector<std::string> prompts;
+    if (!parse_prompts(prompts_obj, prompts, single)) {
+        return nullptr;
+    }
+    
+    std::vector<std::string> results(prompts.size());
+    std::string error;
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS
+    ok = g_model_registry.with_model(handle, [&](LlamaCPPInterface& llama) {
+        SamplingParams params = llama.get_default_params();
+        apply_sampling_fields(params, overrides, fields);
+        
+        std::vector<std::future<std::string>> futures;
+        futures.reserve(prompts.size());
+        for (const auto& prompt : prompts) {
+            futures.push_back(llama.submit(prompt, max_tokens, params));
+        }
+        for (size_t i = 0; i < futures.size(); ++i) {
+            results[i] = futures[i].get();
+        }
+    }, error);
+    Py_END_ALLOW_THREADS
+    
+    if (!ok) {
+        PyErr_SetString(PyExc_RuntimeError, error.c_str());
+        return nullptr;
+    }
+    return texts_to_python(results, single);
+}
+
+static PyObject* set_model_memory_budget_cpp(PyObject* self, PyObject* args) {
+    unsigned long long bytes;
+    
+    if (!PyArg_ParseTuple(args, "K", &bytes)) {
+        return nullptr;
+    }
+    
+    Py_BEGIN_ALLOW_THREADS
+    g_model_registry.set_budget(static_cast<size_t>(bytes));
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
+
+static PyObject* get_model_stats_cpp(PyObject* self, PyObject* args) {
+    std::vector<ModelStats> stats;
+    size_t budget;
+    size_t resident;
+    Py_BEGIN_ALLOW_THREADS
+    stats = g_model_registry.get_stats();
+    budget = g_model_registry.get_budget();
+    resident = g_model_registry.resident_bytes();
+    Py_END_ALLOW_THREADS
+    
+    PyObject* models = PyDict_New();
+    if (!models) {
+        return nullptr;
+    }
+    for (const ModelStats& model : stats) {
+        PyObject* performance = PyDict_New();
+        if (!performance) {
+            Py_DECREF(models);
+            return nullptr;
+        }
+        for (const auto& item : model.performance) {
+            PyObject* value = PyFloat_FromDouble(item.second);
+            PyDict_SetItemString(performance, item.first.c_str(), value);
+            Py_XDECREF(value);
+        }
+        
+        PyObject* entry = Py_BuildValue("{s:s,s:s,s:O,s:K,s:i,s:K,s:K,s:K,s:d,s:i,s:i,s:i,s:i,s:N}",
+                                        "path", model.path.c_str(),
+                                        "draft_model", model.draft_path.c_str(),
+                                        "resident", model.resident ? Py_True : Py_False,
+                                        "bytes", static_cast<unsigned long long>(model.bytes),
+                                        "active", model.active,
+                                        "requests", static_cast<unsigned long long>(model.requests),
+                                        "loads", static_cast<unsigned long long>(model.loads),
+                                        "evictions", static_cast<unsigned long long>(model.evictions),
+                                        "load_time", model.load_time,
+                                        "n_ctx", model.settings.n_ctx,
+                                        "n_batch", model.settings.n_batch,
+                                        "n_threads", model.settings.n_threads,
+                                        "n_threads_batch", model.settings.n_threads_batch,
+                                        "performance", performance);
+        PyObject* key = PyLong_FromLongLong(model.handle);
+        if (!entry || !key || PyDict_SetItem(models, key, entry) < 0) {
+            Py_XDECREF(entry);
+            Py_XDECREF(key);
+            Py_DECREF(models);
+            return nullptr;
+        }
+        Py_DECREF(entry);
+        Py_DECREF(key);
+    }
+    
+    return Py_BuildValue("{s:K,s:K,s:N}",
+                         "budget_bytes", static_cast<unsigned long long>(budget),
+                         "resident_bytes", static_cast<unsigned long long>(resident),
+                         "models", models);
+}
+
+// Speculative decoding on the default interface (handle 0) or a registry handle
+static PyObject* load_draft_model_cpp(PyObject* self, PyObject* args) {
+    const char* draft_path;
+    int n_draft = 4;
+    long long handle = 0;
+    
+    if (!PyArg_ParseTuple(args, "s|iL", &draft_path, &n_draft, &handle)) {
+        return nullptr;
+    }
+    if (n_draft <= 0) {
+        PyErr_SetString(PyExc_ValueError, "n_draft must be positive");
+        return nullptr;
+    }
+    
+    LlamaCPPInterface* llama = handle ? nullptr : get_llama_interface();
+    if (!handle && !llama) {
+        PyErr_SetString(PyExc_RuntimeError, "LlamaCPP interface not initialized");
+        return nullptr;
+    }
+    
+    std::string path(draft_path);
+    std::string error;
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS
+    ok = handle ? g_model_registry.set_draft(handle, path, n_draft, error) : llama->load_draft_model(path, n_draft, error);
+    Py_END_ALLOW_THREADS
+    
+    if (!ok) {
+        PyErr_SetString(PyExc_RuntimeError, error.c_str());
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject* unload_draft_model_cpp(PyObject* self, PyObject* args) {
+    long long handle = 0;
+    
+    if (!PyArg_ParseTuple(args, "|L", &handle)) {
+        return nullptr;
+    }
+    
+    LlamaCPPInterface* llama = handle ? nullptr : get_llama_interface();
+    if (!handle && !llama) {
+        Py_RETURN_NONE;
+    }
+    
+    std::string error;
+    bool ok = true;
+    Py_BEGIN_ALLOW_THREADS
+    if (handle) {
+        ok = g_model_registry.set_draft(handle, std::string(), 0, error);
+    } else {
+        llama->unload_draft_model();
+    }
+    Py_END_ALLOW_THREADS
+    
+    if (!ok) {
+        PyErr_SetString(PyExc_RuntimeError, error.c_str());
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+// Apply `fn` to the default interface or a registry handle with the GIL
+// released; false (exception set) if neither is available
+static bool with_interface(long long handle, const std::function<void(LlamaCPPInterface&)>& fn) {
+    LlamaCPPInterface* llama = handle ? nullptr : get_llama_interface();
+    if (!handle && !llama) {
         PyErr_SetString(PyExc_RuntimeError, "LlamaCPP interface not initialized");
+        return false;
+    }
+    
+    std::string error;
+    bool ok = true;
+    Py_BEGIN_ALLOW_THREADS
+    if (handle) {
+        ok = g_model_registry.with_model(handle, fn, error);
+    } else {
+        fn(*llama);
+    }
+    Py_END_ALLOW_THREADS
+    
+    if (!ok) {
+        PyErr_SetString(PyExc_RuntimeError, error.c_str());
+    }
+    return ok;
+}
+
+static PyObject* get_speculative_stats_cpp(PyObject* self, PyObject* args) {
+    long long handle = 0;
+    
+    if (!PyArg_ParseTuple(args, "|L", &handle)) {
+        return nullptr;
+    }
+    
+    std::map<std::string, double> stats;
+    std::string draft_path;
+    int n_draft = 0;
+    auto collect_stats = [&](LlamaCPPInterface& model) {
+        stats = model.get_performance_stats();
+        draft_path = model.get_draft_path();
+        n_draft = model.get_draft_tokens();
+    };
+    if (!with_interface(handle, collect_stats)) {
+        return nullptr;
+    }
+    return Py_BuildValue("{s:s,s:i,s:K,s:K,s:K,s:d,s:d,s:d}",
+                         "draft_model", draft_path.c_str(),
+                         "n_draft", n_draft,
+                         "steps", static_cast<unsigned long long>(stats["speculative_steps"]),
+                         "drafted", static_cast<unsigned long long>(stats["draft_tokens"]),
+                         "accepted", static_cast<unsigned long long>(stats["draft_accepted"]),
+                         "acceptance_rate", stats["draft_acceptance_rate"],
+                         "tokens_per_verify", stats["tokens_per_verify"],
+                         "draft_time", stats["draft_time"]);
+}
+
+static PyObject* get_stats_cpp(PyObject* self, PyObject* args) {
+    long long handle = 0;
+    
+    if (!PyArg_ParseTuple(args, "|L", &handle)) {
+        return nullptr;
+    }
+    
+    std::map<std::string, double> stats;
+    if (!with_interface(handle, [&](LlamaCPPInterface& model) { stats = model.get_performance_stats(); })) {
+        return nullptr;
+    }
+    
+    PyObject* dict = PyDict_New();
+    if (!dict) {
+        return nullptr;
+    }
+    for (const auto& item : stats) {
+        PyObject* value = PyFloat_FromDouble(item.second);
+        if (!value || PyDict_SetItemString(dict, item.first.c_str(), value) < 0) {
+            Py_XDECREF(value);
+            Py_DECREF(dict);
+            return nullptr;
+        }
+        Py_DECREF(value);
+    }
+    return dict;
+}
+
+static PyObject* reset_stats_cpp(PyObject* self, PyObject* args) {
+    long long handle = 0;
+    
+    if (!PyArg_ParseTuple(args, "|L", &handle)) {
         return nullptr;
     }
     
-    return PyLong_FromLong(g_llama_interface->get_threads());
+    if (!with_interface(handle, [](LlamaCPPInterface& model) { model.reset_performance_stats(); })) {
+        return nullptr;
+    }
+    Py_RETURN_NONE;
 }
 
 static PyObject* is_model_loaded_cpp(PyObject* self, PyObject* args) {
-    if (!g_llama_interface) {
+    LlamaCPPInterface* llama = get_llama_interface();
+    if (!llama) {
         return PyBool_FromLong(0);
     }
     
-    return PyBool_FromLong(g_llama_interface->is_loaded() ? 1 : 0);
+    return PyBool_FromLong(llama->is_loaded() ? 1 : 0);
 }
 
 static PyMethodDef LlamaCPPMethods[] = {
     {"init", init_llama_cpp, METH_VARARGS, "Initialize llama.cpp interface"},
-    {"load_model", load_model_cpp, METH_VARARGS, "Load model for inference"},
-    {"generate_text", generate_text_cpp, METH_VARARGS, "Generate text using loaded model"},
-    {"set_threads", set_threads_cpp, METH_VARARGS, "Set number of threads"},
-    {"get_threads", get_threads_cpp, METH_VARARGS, "Get number of threads"},
+    {"load_model", load_model_cpp, METH_VARARGS, "Load model for inference; optional number of parallel sequences"},
+    {"generate_text", generate_text_cpp, METH_VARARGS, "Generate text using loaded model; optional temperature and sampling params dict"},
+    {"generate_buffer", generate_buffer_cpp, METH_VARARGS, "As generate_text, but return the UTF-8 text as a NativeBuffer"},
+    {"generate_batch", generate_batch_cpp, METH_VARARGS, "Generate completions for a list of prompts, decoded together by the batch scheduler"},
+    {"submit", submit_cpp, METH_VARARGS, "Queue a prompt for the batch scheduler; returns a request id"},
+    {"collect", collect_cpp, METH_VARARGS, "Wait for a submitted request (optional timeout in seconds; None if not ready)"},
+    {"cancel", cancel_cpp, METH_VARARGS, "Stop a submitted request and drop its result; returns False for an unknown or collected id"},
+    {"generate_stream", generate_stream_cpp, METH_VARARGS, "Generate text, calling callback(chunk) as pieces are decoded; returns the full text"},
+    {"stream", stream_cpp, METH_VARARGS, "Start a generation and return an iterator over its text chunks"},
+    {"cache_prefix", cache_prefix_cpp, METH_VARARGS, "Decode a prompt prefix and keep its KV state for reuse; returns its token count"},
+    {"save_prefix_cache", save_prefix_cache_cpp, METH_VARARGS, "Write cached prefix states to a file"},
+    {"load_prefix_cache", load_prefix_cache_cpp, METH_VARARGS, "Load prefix states saved by save_prefix_cache"},
+    {"clear_prefix_cache", clear_prefix_cache_cpp, METH_VARARGS, "Drop cached prefix states"},
+    {"set_prefix_cache_limit", set_prefix_cache_limit_cpp, METH_VARARGS, "Set the memory limit for cached prefix states in bytes"},
+    {"get_prefix_cache_stats", get_prefix_cache_stats_cpp, METH_VARARGS, "Get prefix cache entries, bytes, hits and reused tokens"},
+    {"set_content_cache", set_content_cache_cpp, METH_VARARGS, "Configure the generated-text cache from a dict (reuse, variants, max_bytes, shards, path); returns texts loaded from path"},
+    {"save_content_cache", save_content_cache_cpp, METH_VARARGS, "Write cached texts and their use counts to a file (default: the configured path)"},
+    {"clear_content_cache", clear_content_cache_cpp, METH_VARARGS, "Drop cached texts"},
+    {"set_content_mutator", set_content_mutator_cpp, METH_VARARGS, "Set a callable(text, use) -> str applied to reused texts, or None"},
+    {"get_content_cache_stats", get_content_cache_stats_cpp, METH_VARARGS, "Get content cache settings, keys, texts, bytes, hits and misses"},
+    {"compile_grammar", compile_grammar_cpp, METH_VARARGS, "Compile a GBNF grammar (root rule required) into the grammar cache; returns its rule count, raises ValueError on errors"},
+    {"json_schema_to_grammar", json_schema_to_grammar_cpp, METH_VARARGS, "Convert a JSON schema (dict or JSON text) to the GBNF grammar used for json_schema sampling"},
+    {"get_grammar_cache_stats", get_grammar_cache_stats_cpp, METH_VARARGS, "Get compiled grammar count, cache hits and compiles"},
+    {"clear_grammar_cache", clear_grammar_cache_cpp, METH_VARARGS, "Drop compiled grammars"},
+    {"serve", serve_cpp, METH_VARARGS, "Serve completions from the loaded model to other processes on a Unix socket path"},
+    {"stop_server", stop_server_cpp, METH_VARARGS, "Stop the inference server after answering in-flight requests"},
+    {"get_server_stats", get_server_stats_cpp, METH_VARARGS, "Get inference server connection and request counts (None if not serving)"},
+    {"remote_generate", remote_generate_cpp, METH_VARARGS, "Generate on an inference server: (socket_path, prompt or list of prompts, max_tokens, temperature, params)"},
+    {"set_sampling_params", set_sampling_params_cpp, METH_VARARGS, "Update default sampling params (top_k, top_p, min_p, temperature, repeat_penalty, repeat_last_n, allowed_chars, seed, grammar, json_schema)"},
+    {"get_sampling_params", get_sampling_params_cpp, METH_VARARGS, "Get default sampling params"},
+    {"set_threads", set_threads_cpp, METH_VARARGS, "Set generation (and optionally prompt processing) threads; applies to a loaded model between decode steps"},
+    {"get_threads", get_threads_cpp, METH_VARARGS, "Get number of generation threads"},
+    {"set_context_params", set_context_params_cpp, METH_VARARGS, "Update n_ctx, n_batch, n_threads and n_threads_batch from a dict; a new n_ctx or n_batch rebuilds the context without reloading the model"},
+    {"get_context_params", get_context_params_cpp, METH_VARARGS, "Get context size, batch size, thread counts, parallel sequences and whether threads are pinned"},
+    {"set_cpu_placement", set_cpu_placement_cpp, METH_VARARGS, "Before load_model: (numa_node=-1, pin_threads=True) to pin inference threads, optionally to one NUMA node"},
     {"is_model_loaded", is_model_loaded_cpp, METH_VARARGS, "Check if model is loaded"},
+    {"load_draft_model", load_draft_model_cpp, METH_VARARGS, "Speculative decoding: (draft_path, n_draft=4, handle=0); the draft proposes n_draft tokens the model verifies in one decode"},
+    {"unload_draft_model", unload_draft_model_cpp, METH_VARARGS, "Stop speculative decoding on the default interface or a registry handle"},
+    {"get_speculative_stats", get_speculative_stats_cpp, METH_VARARGS, "Get drafted and accepted token counts, acceptance rate and tokens per verify step"},
+    {"get_stats", get_stats_cpp, METH_VARARGS, "Get token counts, prompt and decode time, and time-to-first-token and per-token latency percentiles (handle=0)"},
+    {"reset_stats", reset_stats_cpp, METH_VARARGS, "Reset performance counters and latency histograms (handle=0)"},
+    {"open_model", open_model_cpp, METH_VARARGS, "Load a model into the registry: (path, n_parallel=0, context_params=None) -> handle; handles on one file share its weights"},
+    {"close_model", close_model_cpp, METH_VARARGS, "Release a registry handle"},
+    {"generate_with_model", generate_with_model_cpp, METH_VARARGS, "Generate on a registry handle: (handle, prompt or list of prompts, max_tokens, temperature, params); reloads an evicted model"},
+    {"set_model_memory_budget", set_model_memory_budget_cpp, METH_VARARGS, "Limit the bytes of model files mapped by registry handles (0: unlimited); least recently used idle handles are unloaded"},
+    {"get_model_stats", get_model_stats_cpp, METH_VARARGS, "Get registry budget, resident bytes and per-handle load, eviction and generation stats"},
     {nullptr, nullptr, 0, nullptr}
 };
 
+static int llama_cpp_interface_exec(PyObject* module) {
+    if (!init_token_stream_type() || !native_buffer::init_type()) {
+        return -1;
+    }
+    
+    Py_INCREF(&PyTokenStreamType);
+    if (PyModule_AddObject(module, "TokenStream", reinterpret_cast<PyObject*>(&PyTokenStreamType)) < 0) {
+        Py_DECREF(&PyTokenStreamType);
+        return -1;
+    }
+    return 0;
+}
+
+// The model and scheduler are process-wide; every entry point either copies
+// its arguments out and releases the GIL or only touches internally locked state
+static PyModuleDef_Slot LlamaCPPSlots[] = {
+    {Py_mod_exec, reinterpret_cast<void*>(llama_cpp_interface_exec)},
+#if PY_VERSION_HEX >= 0x030C0000
+    {Py_mod_multiple_interpreters, Py_MOD_MULTIPLE_INTERPRETERS_SUPPORTED},
+#endif
+#if PY_VERSION_HEX >= 0x030D0000
+    {Py_mod_gil, Py_MOD_GIL_NOT_USED},
+#endif
+    {0, nullptr}
+};
+
 static struct PyModuleDef llamacppmodule = {
     PyModuleDef_HEAD_INIT,
     "llama_cpp_interface",
     "Native llama.cpp interface for CPU optimization",
-    -1,
-    LlamaCPPMethods
+    0,
+    LlamaCPPMethods,
+    LlamaCPPSlots
 };
 
 PyMODINIT_FUNC PyInit_llama_cpp_interface(void) {
-    return PyModule_Create(&llamacppmodule);
+    return PyModuleDef_Init(&llamacppmodule);
 }
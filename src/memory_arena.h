@@ -0,0 +1,208 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+// Bump-pointer arenas for per-document scratch memory, implemented in
+// memory_manager.cpp and shared by the native modules.
+//
+// Allocating is a pointer increment inside large chunks and nothing is
+// freed on its own: reset() rewinds to the first chunk in O(1) and keeps
+// the chunks for the next document, so steady-state generation does not
+// touch the system allocator. On Linux chunks are backed by transparent
+// huge pages. Every thread has its own arena; an Arena is used by one
+// thread at a time, only add_stats() may be called from others.
+namespace memory_arena {
+
+struct Config {
+    size_t chunk_size = size_t(2) << 20;     // Bytes per chunk (whole huge pages when huge_pages is set)
+    size_t max_retained = size_t(64) << 20;  // Chunk bytes an arena keeps across reset()
+    bool huge_pages = true;                  // madvise(MADV_HUGEPAGE) on chunks (Linux)
+    bool tracking = false;                   // Count allocations and requested bytes
+};
+
+// Settings for arenas created afterwards; tracking applies immediately
+void configure(const Config& config);
+Config config();
+
+struct Stats {
+    size_t arenas = 0;             // Live arenas (one per thread that used one)
+    size_t chunks = 0;
+    size_t huge_page_chunks = 0;
+    size_t bytes_reserved = 0;     // Chunk memory held
+    size_t bytes_used = 0;         // Since each arena's last reset, padding and skipped chunk tails included
+    size_t peak_bytes_used = 0;    // Most any arena had in use between resets
+    uint64_t resets = 0;
+    uint64_t allocations = 0;      // With tracking only
+    uint64_t bytes_requested = 0;  // With tracking only
+};
+
+class Arena {
+public:
+    // Where allocation stands; rewind() to it frees everything allocated since
+    struct Mark {
+        int chunk;
+        char* cursor;
+    };
+
+    Arena();
+    ~Arena();
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // `alignment` must be a power of two; memory is uninitialized
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t)) {
+        char* at = cursor.load(std::memory_order_relaxed);
+        uintptr_t aligned = (reinterpret_cast<uintptr_t>(at) + alignment - 1) & ~(uintptr_t(alignment) - 1);
+        if (size == 0 || aligned + size > reinterpret_cast<uintptr_t>(limit)) {
+            return allocate_slow(size, alignment);
+        }
+        cursor.store(reinterpret_cast<char*>(aligned + size), std::memory_order_relaxed);
+        if (tracking_enabled()) {
+            track(size);
+        }
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    template <typename T>
+    T* allocate_array(size_t n) {
+        return static_cast<T*>(allocate(n * sizeof(T), alignof(T)));
+    }
+
+    Mark mark() const {
+        return {current, cursor.load(std::memory_order_relaxed)};
+    }
+
+    void rewind(const Mark& mark);
+
+    // Rewind to the start, keeping up to Config::max_retained of chunks.
+    // Not while a Scope on this arena is open.
+    void reset();
+
+    // Return every chunk to the system
+    void release();
+
+    size_t bytes_used() const;
+
+    // Adds this arena's figures; callable from any thread
+    void add_stats(Stats& stats) const;
+
+    // Held by whatever keeps this arena's memory past a Scope (buffers
+    // handed to Python). Callers refuse reset() while exports() > 0; if
+    // the arena is destroyed first, as when its thread exits, the chunks
+    // stay mapped until the last copy of the handle is dropped.
+    std::shared_ptr<void> export_handle();
+    long exports() const;
+
+private:
+    struct Chunk {
+        char* base;
+        size_t size;
+        bool mapped;     // mmap (munmap to free) rather than aligned_alloc
+        bool huge_pages;
+    };
+
+    // Chunks a destroyed arena left to its export handle
+    struct Exported {
+        std::vector<Chunk> chunks;
+        ~Exported();
+    };
+
+    static void free_chunk(const Chunk& chunk);
+    void* allocate_slow(size_t size, size_t alignment);
+    void enter_chunk(int index, char* at);  // with mutex held
+    void track(size_t size);
+    void note_peak();
+    static bool tracking_enabled();
+
+    // Bumped by the owning thread only; atomic so add_stats() can read it
+    std::atomic<char*> cursor{nullptr};
+    char* limit = nullptr;
+
+    size_t chunk_size;
+    size_t max_retained;
+    bool huge_pages;
+
+    // The chunk list and the chunk the cursor is in change under mutex
+    mutable std::mutex mutex;
+    std::vector<Chunk> chunks;
+    int current = -1;                // -1 before the first chunk
+    size_t used_before_current = 0;  // Bytes of chunks before `current`
+    std::atomic<size_t> peak_used{0};
+    std::atomic<uint64_t> resets{0};
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> bytes_requested{0};
+    std::shared_ptr<Exported> exported;  // Owner thread only
+};
+
+// The calling thread's arena, created on first use
+Arena& thread_arena();
+
+// Totals over every live arena plus those of exited threads
+Stats stats();
+
+// Frees everything allocated from `arena` while in scope, so nested users
+// (tokenization inside a generation call) stack on one arena
+class Scope {
+public:
+    explicit Scope(Arena& arena = thread_arena()) : arena_(arena), mark_(arena.mark()) {}
+    ~Scope() {
+        arena_.rewind(mark_);
+    }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+    Arena& arena() const {
+        return arena_;
+    }
+
+private:
+    Arena& arena_;
+    Arena::Mark mark_;
+};
+
+// Standard allocator drawing from an arena; deallocation is a no-op, the
+// memory returns when the arena rewinds
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(Arena& arena = thread_arena()) noexcept : arena(&arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena(other.arena) {}
+
+    T* allocate(size_t n) {
+        T* p = arena->allocate_array<T>(n);
+        if (!p) {
+            throw std::bad_alloc();
+        }
+        return p;
+    }
+
+    void deallocate(T*, size_t) noexcept {}
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const noexcept {
+        return arena == other.arena;
+    }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const noexcept {
+        return arena != other.arena;
+    }
+
+private:
+    template <typename U>
+    friend class ArenaAllocator;
+    Arena* arena;
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+}  // namespace memory_arena
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// Process-wide memory budget, implemented in memory_manager.cpp and shared
+// by the native modules.
+//
+// Components charge what they hold (mapped model files, KV caches, pool
+// blocks, MemoryManager allocations) to a category, so the stats show
+// where the memory went. Pressure is judged on the process RSS, which
+// also covers memory nothing reported. Above the soft limit reclaimers
+// registered by the components shed caches; above the hard limit
+// admit() refuses new allocations and throttle() holds back new work
+// until reclaiming or finishing work brings usage down.
+namespace memory_budget {
+
+enum class Category {
+    MODEL_WEIGHTS,   // Mapped model files, drafts included
+    KV_CACHE,        // llama contexts
+    PREFIX_CACHE,    // Serialized KV snapshots
+    CONTENT_CACHE,   // Generated texts kept for reuse
+    POOLS,           // MemoryManager block pools, free blocks included
+    MANAGER,         // MemoryManager::allocate
+    COUNT
+};
+
+const char* category_name(Category category);
+
+struct Config {
+    size_t limit = 0;              // Bytes; 0 takes the cgroup limit, else physical memory
+    double soft_fraction = 0.85;   // Reclaim caches above this share of the limit
+    double hard_fraction = 0.95;   // Refuse allocations and throttle submission above it
+    double throttle_timeout = 30;  // Seconds throttle() waits before giving up
+    double sample_interval = 0.01; // Seconds an RSS reading is reused
+    bool enforce = true;           // False: account and report only
+};
+
+void configure(const Config& config);
+Config config();
+
+// Limit in effect (Config::limit or the detected one)
+size_t limit();
+
+enum class Pressure { NORMAL, SOFT, HARD };
+
+// Judged on RSS plus `incoming` bytes about to be allocated
+Pressure pressure(size_t incoming = 0);
+
+// Resident set size of the process, sampled at most every sample_interval
+size_t rss(bool refresh = false);
+
+void charge(Category category, size_t bytes);
+void credit(Category category, size_t bytes);
+
+// Holds a charge that follows one component's size; credits it on destruction
+class Charge {
+public:
+    explicit Charge(Category category, size_t bytes = 0) : category_(category), bytes_(0) {
+        set(bytes);
+    }
+    ~Charge() {
+        set(0);
+    }
+    Charge(const Charge&) = delete;
+    Charge& operator=(const Charge&) = delete;
+
+    void set(size_t bytes) {
+        size_t old = bytes_.exchange(bytes, std::memory_order_relaxed);
+        if (bytes > old) {
+            charge(category_, bytes - old);
+        } else if (old > bytes) {
+            credit(category_, old - bytes);
+        }
+    }
+
+    size_t bytes() const {
+        return bytes_.load(std::memory_order_relaxed);
+    }
+
+private:
+    Category category_;
+    std::atomic<size_t> bytes_;
+};
+
+// A reclaimer frees what it can of `bytes` and returns how much it freed.
+// It runs on whichever thread hit the pressure, which may hold locks of
+// the reclaiming component, so it only try-locks and skips what is busy;
+// it must not call admit() or throttle(). Lower `order` runs first:
+// cheap-to-rebuild caches before models. Returns an id for
+// remove_reclaimer(), which waits for a running reclaim to finish.
+int add_reclaimer(const char* name, int order, std::function<size_t(size_t bytes)> reclaimer);
+void remove_reclaimer(int id);
+
+// Run reclaimers until `bytes` are freed; returns the bytes they freed
+size_t reclaim(size_t bytes);
+
+// Whether `bytes` fit under the hard limit, reclaiming first if needed.
+// Never waits. Always true when not enforcing.
+bool admit(size_t bytes);
+
+// Called before queueing work. Below the hard limit it returns at once,
+// after reclaiming if above the soft one and no other thread already is.
+// Otherwise it reclaims and waits up to throttle_timeout for usage to
+// drop; false if it did not, and callers then refuse the work. Call
+// without locks held.
+bool throttle();
+
+struct Stats {
+    size_t limit = 0;
+    size_t soft_limit = 0;
+    size_t hard_limit = 0;
+    size_t rss = 0;
+    size_t peak_rss = 0;
+    size_t charged[static_cast<int>(Category::COUNT)] = {};
+    size_t charged_total = 0;
+    size_t arena_bytes = 0;       // Arena chunks, from memory_arena::stats()
+    Pressure pressure = Pressure::NORMAL;
+    uint64_t admissions_refused = 0;
+    uint64_t throttled = 0;       // throttle() calls that had to wait
+    uint64_t throttle_rejected = 0;
+    double throttle_wait_time = 0.0;
+    uint64_t reclaims = 0;
+    uint64_t bytes_reclaimed = 0;
+};
+
+Stats stats();
+
+}  // namespace memory_budget
@@ -6,315 +6,1178 @@
 #include <chrono>
 #include <iostream>
 #include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
 
 extern "C" {
     #include <Python.h>
 }
 
-class MemoryManager {
-private:
-    struct MemoryBlock {
-        void* ptr;
-        size_t size;
-        std::chrono::steady_clock::time_point allocated_time;
-        bool in_use;
-        
-        MemoryBlock(void* p, size_t s) : ptr(p), size(s), in_use(true) {
-            allocated_time = std::chrono::steady_clock::now();
-        }
-    };
-    
-    std::unordered_map<void*, MemoryBlock> allocated_blocks;
-    std::mutex memory_mutex;
-    std::atomic<size_t> total_allocated{0};
-    std::atomic<size_t> peak_allocated{0};
-    std::atomic<size_t> allocation_count{0};
-    std::atomic<size_t> deallocation_count{0};
-    
-    size_t max_memory_limit;
-    bool enable_tracking;
+#include "memory_arena.h"
+#include "memory_budget.h"
+#include "memory_manager.h"
+#include "native_buffer.h"
+#include "tracing.h"
+
+namespace memory_arena {
+
+static constexpr size_t kHugePageSize = size_t(2) << 20;
+static constexpr size_t kChunkAlignment = 64;
+
+static std::mutex g_config_mutex;
+static Config g_config;
+static std::atomic<bool> g_tracking{false};
+
+// Live arenas for stats(), and what exited threads left behind. Never
+// destroyed: threads may exit after static destructors have run.
+struct ArenaRegistry {
+    std::mutex mutex;
+    std::vector<const Arena*> arenas;
+    Stats retired;
+};
+
+static ArenaRegistry& registry() {
+    static ArenaRegistry* instance = new ArenaRegistry();
+    return *instance;
+}
+
+static size_t round_up(size_t n, size_t multiple) {
+    return (n + multiple - 1) / multiple * multiple;
+}
+
+void configure(const Config& config) {
+    std::lock_guard<std::mutex> lock(g_config_mutex);
+    g_config = config;
+    g_config.chunk_size = std::max<size_t>(config.chunk_size, 4096);
+    g_tracking = config.tracking;
+}
+
+Config config() {
+    std::lock_guard<std::mutex> lock(g_config_mutex);
+    return g_config;
+}
+
+Arena::Arena() {
+    Config settings = config();
+    chunk_size = settings.chunk_size;
+    max_retained = settings.max_retained;
+    huge_pages = settings.huge_pages;
     
-public:
-    MemoryManager(size_t max_mem = 1024 * 1024 * 1024) : max_memory_limit(max_mem), enable_tracking(true) {
-        std::cout << "Memory Manager initialized with limit: " << max_mem / (1024 * 1024) << " MB" << std::endl;
+    ArenaRegistry& arenas = registry();
+    std::lock_guard<std::mutex> lock(arenas.mutex);
+    arenas.arenas.push_back(this);
+}
+
+Arena::~Arena() {
+    ArenaRegistry& arenas = registry();
+    std::lock_guard<std::mutex> lock(arenas.mutex);
+    arenas.arenas.erase(std::find(arenas.arenas.begin(), arenas.arenas.end(), this));
+    arenas.retired.peak_bytes_used = std::max(arenas.retired.peak_bytes_used, peak_used.load());
+    arenas.retired.resets += resets;
+    arenas.retired.allocations += allocations;
+    arenas.retired.bytes_requested += bytes_requested;
+    if (exported && exported.use_count() > 1) {
+        std::lock_guard<std::mutex> chunks_lock(mutex);
+        exported->chunks.swap(chunks);
+        enter_chunk(-1, nullptr);
+    }
+    exported.reset();
+    release();
+}
+
+Arena::Exported::~Exported() {
+    for (const Chunk& chunk : chunks) {
+        free_chunk(chunk);
+    }
+}
+
+void Arena::free_chunk(const Chunk& chunk) {
+#ifdef __linux__
+    if (chunk.mapped) {
+        munmap(chunk.base, chunk.size);
+        return;
+    }
+#endif
+    std::free(chunk.base);
+}
+
+std::shared_ptr<void> Arena::export_handle() {
+    if (!exported) {
+        exported = std::make_shared<Exported>();
+    }
+    return exported;
+}
+
+long Arena::exports() const {
+    return exported ? exported.use_count() - 1 : 0;
+}
+
+bool Arena::tracking_enabled() {
+    return g_tracking.load(std::memory_order_relaxed);
+}
+
+void Arena::track(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    bytes_requested.fetch_add(size, std::memory_order_relaxed);
+}
+
+void Arena::enter_chunk(int index, char* at) {
+    used_before_current = 0;
+    for (int i = 0; i < index; ++i) {
+        used_before_current += chunks[i].size;
+    }
+    current = index;
+    cursor.store(at, std::memory_order_relaxed);
+    limit = index >= 0 ? chunks[index].base + chunks[index].size : nullptr;
+}
+
+// Move to the next chunk that fits, or map a new one. Chunks skipped over
+// stay idle until the arena rewinds past them.
+void* Arena::allocate_slow(size_t size, size_t alignment) {
+    if (size == 0) {
+        size = 1;
     }
     
-    ~MemoryManager() {
-        cleanup_all();
+    std::lock_guard<std::mutex> lock(mutex);
+    int index = current + 1;
+    while (index < static_cast<int>(chunks.size()) && chunks[index].size < size + alignment) {
+        ++index;
     }
     
-    void* allocate(size_t size, size_t alignment = 64) {
-        if (!enable_tracking) {
-            return std::aligned_alloc(alignment, size);
-        }
-        
-        std::lock_guard<std::mutex> lock(memory_mutex);
-        
-        // Check memory limit
-        if (total_allocated + size > max_memory_limit) {
-            std::cerr << "Memory limit exceeded: " << total_allocated << " + " << size 
-                      << " > " << max_memory_limit << std::endl;
-            return nullptr;
+    if (index == static_cast<int>(chunks.size())) {
+        Chunk chunk{nullptr, std::max(chunk_size, round_up(size + alignment, kChunkAlignment)), false, false};
+#ifdef __linux__
+        if (huge_pages) {
+            // Over-map so a 2 MiB aligned run can be trimmed out and backed
+            // entirely by huge pages
+            chunk.size = round_up(chunk.size, kHugePageSize);
+            size_t span = chunk.size + kHugePageSize;
+            void* region = mmap(nullptr, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (region != MAP_FAILED) {
+                char* start = static_cast<char*>(region);
+                char* base = reinterpret_cast<char*>(round_up(reinterpret_cast<uintptr_t>(start), kHugePageSize));
+                if (base > start) {
+                    munmap(start, base - start);
+                }
+                munmap(base + chunk.size, start + span - (base + chunk.size));
+                chunk.base = base;
+                chunk.mapped = true;
+                chunk.huge_pages = madvise(base, chunk.size, MADV_HUGEPAGE) == 0;
+            }
         }
-        
-        void* ptr = std::aligned_alloc(alignment, size);
-        if (!ptr) {
-            return nullptr;
+#endif
+        if (!chunk.base) {
+            chunk.base = static_cast<char*>(std::aligned_alloc(kChunkAlignment, chunk.size));
+            if (!chunk.base) {
+                return nullptr;
+            }
         }
-        
-        // Track allocation
-        allocated_blocks[ptr] = MemoryBlock(ptr, size);
-        total_allocated += size;
-        peak_allocated = std::max(peak_allocated.load(), total_allocated.load());
-        allocation_count++;
-        
-        return ptr;
+        chunks.push_back(chunk);
     }
     
-    void deallocate(void* ptr) {
-        if (!ptr) return;
-        
-        if (!enable_tracking) {
-            std::free(ptr);
-            return;
-        }
-        
-        std::lock_guard<std::mutex> lock(memory_mutex);
-        
-        auto it = allocated_blocks.find(ptr);
-        if (it != allocated_blocks.end()) {
-            total_allocated -= it->second.size;
-            allocated_blocks.erase(it);
-            deallocation_count++;
-        }
-        
-        std::free(ptr);
+    note_peak();
+    char* at = chunks[index].base;
+    enter_chunk(index, at);
+    
+    uintptr_t aligned = round_up(reinterpret_cast<uintptr_t>(at), alignment);
+    cursor.store(reinterpret_cast<char*>(aligned + size), std::memory_order_relaxed);
+    if (tracking_enabled()) {
+        track(size);
+    }
+    return reinterpret_cast<void*>(aligned);
+}
+
+void Arena::note_peak() {
+    size_t used = bytes_used();
+    size_t peak = peak_used.load(std::memory_order_relaxed);
+    if (used > peak) {
+        peak_used.store(used, std::memory_order_relaxed);
+    }
+}
+
+void Arena::rewind(const Mark& mark) {
+    if (mark.chunk == current) {
+        note_peak();
+        cursor.store(mark.cursor, std::memory_order_relaxed);
+        return;
     }
     
-    void cleanup_unused() {
-        std::lock_guard<std::mutex> lock(memory_mutex);
-        
-        auto now = std::chrono::steady_clock::now();
-        auto timeout = std::chrono::minutes(5);  // 5 minute timeout
-        
-        auto it = allocated_blocks.begin();
-        while (it != allocated_blocks.end()) {
-            if (!it->second.in_use && 
-                (now - it->second.allocated_time) > timeout) {
-                std::free(it->first);
-                total_allocated -= it->second.size;
-                it = allocated_blocks.erase(it);
-            } else {
-                ++it;
-            }
+    std::lock_guard<std::mutex> lock(mutex);
+    note_peak();
+    enter_chunk(mark.chunk, mark.cursor);
+}
+
+void Arena::reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    note_peak();
+    resets.fetch_add(1, std::memory_order_relaxed);
+    
+    // Keep the first chunks up to max_retained (always the first one)
+    size_t kept = 0;
+    size_t n_keep = 0;
+    while (n_keep < chunks.size() && (n_keep == 0 || kept + chunks[n_keep].size <= max_retained)) {
+        kept += chunks[n_keep++].size;
+    }
+    for (size_t i = n_keep; i < chunks.size(); ++i) {
+        free_chunk(chunks[i]);
+    }
+    chunks.resize(n_keep);
+    
+    enter_chunk(chunks.empty() ? -1 : 0, chunks.empty() ? nullptr : chunks[0].base);
+}
+
+void Arena::release() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const Chunk& chunk : chunks) {
+            free_chunk(chunk);
         }
+        chunks.clear();
+        enter_chunk(-1, nullptr);
+    }
+}
+
+size_t Arena::bytes_used() const {
+    if (current < 0) {
+        return 0;
+    }
+    return used_before_current + (cursor.load(std::memory_order_relaxed) - chunks[current].base);
+}
+
+void Arena::add_stats(Stats& stats) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.arenas += 1;
+    stats.chunks += chunks.size();
+    for (const Chunk& chunk : chunks) {
+        stats.huge_page_chunks += chunk.huge_pages;
+        stats.bytes_reserved += chunk.size;
     }
+    size_t used = bytes_used();
+    stats.bytes_used += used;
+    stats.peak_bytes_used = std::max({stats.peak_bytes_used, peak_used.load(), used});
+    stats.resets += resets;
+    stats.allocations += allocations;
+    stats.bytes_requested += bytes_requested;
+}
+
+Arena& thread_arena() {
+    thread_local Arena arena;
+    return arena;
+}
+
+Stats stats() {
+    ArenaRegistry& arenas = registry();
+    std::lock_guard<std::mutex> lock(arenas.mutex);
+    Stats total = arenas.retired;
+    for (const Arena* arena : arenas.arenas) {
+        arena->add_stats(total);
+    }
+    return total;
+}
+
+}  // namespace memory_arena
+
+namespace memory_budget {
+
+static constexpr int kCategories = static_cast<int>(Category::COUNT);
+
+// Limits derived from the config, read on every pressure check
+struct Limits {
+    std::atomic<size_t> limit{0};
+    std::atomic<size_t> soft{0};
+    std::atomic<size_t> hard{0};
+    std::atomic<int64_t> sample_ns{10000000};
+    std::atomic<bool> enforce{true};
+};
+
+struct Reclaimer {
+    int id;
+    int order;
+    std::string name;
+    std::function<size_t(size_t)> fn;
+};
+
+// Shared with components in other modules that register during static
+// initialization or unregister at exit, so created on first use and
+// never destroyed
+struct BudgetState {
+    std::mutex config_mutex;
+    Config config;
+    Limits limits;
     
-    void cleanup_all() {
-        std::lock_guard<std::mutex> lock(memory_mutex);
-        
-        for (auto& pair : allocated_blocks) {
-            std::free(pair.first);
+    std::atomic<size_t> charged[kCategories];
+    std::atomic<size_t> rss{0};
+    std::atomic<size_t> peak_rss{0};
+    std::atomic<int64_t> rss_time_ns{0};
+    
+    std::mutex reclaim_mutex;  // Held while reclaimers run
+    std::vector<Reclaimer> reclaimers;
+    int next_id = 1;
+    
+    std::atomic<uint64_t> admissions_refused{0};
+    std::atomic<uint64_t> throttled{0};
+    std::atomic<uint64_t> throttle_rejected{0};
+    std::atomic<uint64_t> throttle_wait_ns{0};
+    std::atomic<uint64_t> reclaims{0};
+    std::atomic<uint64_t> bytes_reclaimed{0};
+    
+    BudgetState() {
+        for (auto& bytes : charged) {
+            bytes = 0;
         }
-        allocated_blocks.clear();
-        total_allocated = 0;
+    }
+};
+
+static BudgetState& state();
+
+static int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#ifdef __linux__
+// First number in a file, 0 when unreadable or "max"
+static size_t read_size_file(const char* path) {
+    FILE* f = std::fopen(path, "r");
+    if (!f) {
+        return 0;
+    }
+    unsigned long long value = 0;
+    if (std::fscanf(f, "%llu", &value) != 1) {
+        value = 0;
+    }
+    std::fclose(f);
+    return static_cast<size_t>(value);
+}
+#endif
+
+// The cgroup limit (v2, then v1) if below physical memory, else physical memory
+static size_t detect_limit() {
+    size_t physical = 0;
+#if defined(_SC_PHYS_PAGES) && defined(_SC_PAGESIZE)
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long page_size = sysconf(_SC_PAGESIZE);
+    if (pages > 0 && page_size > 0) {
+        physical = static_cast<size_t>(pages) * static_cast<size_t>(page_size);
+    }
+#endif
+    size_t cgroup = 0;
+#ifdef __linux__
+    cgroup = read_size_file("/sys/fs/cgroup/memory.max");
+    if (cgroup == 0) {
+        cgroup = read_size_file("/sys/fs/cgroup/memory/memory.limit_in_bytes");
+    }
+#endif
+    if (cgroup > 0 && (physical == 0 || cgroup < physical)) {
+        return cgroup;
+    }
+    return physical;
+}
+
+static size_t read_rss() {
+#ifdef __linux__
+    FILE* f = std::fopen("/proc/self/statm", "r");
+    if (!f) {
+        return 0;
+    }
+    unsigned long long total = 0;
+    unsigned long long resident = 0;
+    int fields = std::fscanf(f, "%llu %llu", &total, &resident);
+    std::fclose(f);
+    if (fields != 2) {
+        return 0;
+    }
+    return static_cast<size_t>(resident) * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#else
+    return 0;
+#endif
+}
+
+static void apply_config(BudgetState& budget, const Config& config) {
+    size_t limit = config.limit > 0 ? config.limit : detect_limit();
+    budget.limits.limit = limit;
+    budget.limits.soft = static_cast<size_t>(limit * config.soft_fraction);
+    budget.limits.hard = static_cast<size_t>(limit * config.hard_fraction);
+    budget.limits.sample_ns = static_cast<int64_t>(config.sample_interval * 1e9);
+    budget.limits.enforce = config.enforce;
+}
+
+static BudgetState& state() {
+    static BudgetState* instance = []() {
+        BudgetState* budget = new BudgetState();
+        apply_config(*budget, budget->config);
+        return budget;
+    }();
+    return *instance;
+}
+
+const char* category_name(Category category) {
+    switch (category) {
+        case Category::MODEL_WEIGHTS: return "model_weights";
+        case Category::KV_CACHE: return "kv_cache";
+        case Category::PREFIX_CACHE: return "prefix_cache";
+        case Category::CONTENT_CACHE: return "content_cache";
+        case Category::POOLS: return "pools";
+        case Category::MANAGER: return "manager";
+        default: return "unknown";
+    }
+}
+
+void configure(const Config& config) {
+    BudgetState& budget = state();
+    std::lock_guard<std::mutex> lock(budget.config_mutex);
+    budget.config = config;
+    budget.config.soft_fraction = std::min(std::max(config.soft_fraction, 0.0), 1.0);
+    budget.config.hard_fraction = std::min(std::max(config.hard_fraction, budget.config.soft_fraction), 1.0);
+    budget.config.throttle_timeout = std::max(config.throttle_timeout, 0.0);
+    budget.config.sample_interval = std::max(config.sample_interval, 0.0);
+    apply_config(budget, budget.config);
+}
+
+Config config() {
+    BudgetState& budget = state();
+    std::lock_guard<std::mutex> lock(budget.config_mutex);
+    return budget.config;
+}
+
+size_t limit() {
+    return state().limits.limit;
+}
+
+size_t rss(bool refresh) {
+    BudgetState& budget = state();
+    int64_t now = now_ns();
+    if (!refresh && now - budget.rss_time_ns.load(std::memory_order_relaxed) < budget.limits.sample_ns) {
+        return budget.rss.load(std::memory_order_relaxed);
     }
     
-    size_t get_total_allocated() const {
-        return total_allocated;
+    size_t resident = read_rss();
+    budget.rss.store(resident, std::memory_order_relaxed);
+    budget.rss_time_ns.store(now, std::memory_order_relaxed);
+    size_t peak = budget.peak_rss.load(std::memory_order_relaxed);
+    while (resident > peak && !budget.peak_rss.compare_exchange_weak(peak, resident)) {
+    }
+    return resident;
+}
+
+Pressure pressure(size_t incoming) {
+    BudgetState& budget = state();
+    if (budget.limits.limit == 0) {
+        return Pressure::NORMAL;
+    }
+    size_t usage = rss() + incoming;
+    if (usage >= budget.limits.hard) {
+        return Pressure::HARD;
+    }
+    return usage >= budget.limits.soft ? Pressure::SOFT : Pressure::NORMAL;
+}
+
+void charge(Category category, size_t bytes) {
+    state().charged[static_cast<int>(category)].fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void credit(Category category, size_t bytes) {
+    state().charged[static_cast<int>(category)].fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+int add_reclaimer(const char* name, int order, std::function<size_t(size_t bytes)> reclaimer) {
+    BudgetState& budget = state();
+    std::lock_guard<std::mutex> lock(budget.reclaim_mutex);
+    int id = budget.next_id++;
+    auto at = std::upper_bound(budget.reclaimers.begin(), budget.reclaimers.end(), order,
+                               [](int o, const Reclaimer& r) { return o < r.order; });
+    budget.reclaimers.insert(at, Reclaimer{id, order, name, std::move(reclaimer)});
+    return id;
+}
+
+void remove_reclaimer(int id) {
+    BudgetState& budget = state();
+    std::lock_guard<std::mutex> lock(budget.reclaim_mutex);
+    budget.reclaimers.erase(std::remove_if(budget.reclaimers.begin(), budget.reclaimers.end(),
+                                           [id](const Reclaimer& r) { return r.id == id; }),
+                            budget.reclaimers.end());
+}
+
+// With reclaim_mutex held
+static size_t run_reclaimers(BudgetState& budget, size_t bytes) {
+    tracing::Span span(tracing::MEMORY, "memory.reclaim");
+    size_t freed = 0;
+    for (const Reclaimer& reclaimer : budget.reclaimers) {
+        if (freed >= bytes) {
+            break;
+        }
+        freed += reclaimer.fn(bytes - freed);
     }
     
-    size_t get_peak_allocated() const {
-        return peak_allocated;
+#ifdef __GLIBC__
+    // Freed heap memory only lowers RSS once malloc hands it back
+    if (freed > 0) {
+        malloc_trim(0);
+    }
+#endif
+    budget.reclaims++;
+    budget.bytes_reclaimed += freed;
+    rss(true);
+    span.set_value(static_cast<int64_t>(freed));
+    return freed;
+}
+
+size_t reclaim(size_t bytes) {
+    BudgetState& budget = state();
+    std::lock_guard<std::mutex> lock(budget.reclaim_mutex);
+    return run_reclaimers(budget, bytes);
+}
+
+// Bytes to free to bring `usage` back under the soft limit
+static size_t excess_over_soft(BudgetState& budget, size_t usage) {
+    size_t soft = budget.limits.soft;
+    return usage > soft ? usage - soft : 0;
+}
+
+bool admit(size_t bytes) {
+    BudgetState& budget = state();
+    if (!budget.limits.enforce || budget.limits.limit == 0) {
+        return true;
+    }
+    if (rss() + bytes < budget.limits.hard) {
+        return true;
     }
     
-    size_t get_allocation_count() const {
-        return allocation_count;
+    reclaim(excess_over_soft(budget, rss(true) + bytes));
+    if (rss() + bytes < budget.limits.hard) {
+        return true;
+    }
+    budget.admissions_refused++;
+    return false;
+}
+
+bool throttle() {
+    BudgetState& budget = state();
+    if (!budget.limits.enforce) {
+        return true;
     }
     
-    size_t get_deallocation_count() const {
-        return deallocation_count;
+    Pressure level = pressure();
+    if (level == Pressure::NORMAL) {
+        return true;
+    }
+    if (level == Pressure::SOFT) {
+        // One thread sheds caches; the others carry on
+        std::unique_lock<std::mutex> lock(budget.reclaim_mutex, std::try_to_lock);
+        if (lock.owns_lock()) {
+            run_reclaimers(budget, excess_over_soft(budget, rss()));
+        }
+        return true;
     }
     
-    size_t get_active_blocks() const {
-        std::lock_guard<std::mutex> lock(memory_mutex);
-        return allocated_blocks.size();
+    budget.throttled++;
+    double timeout = config().throttle_timeout;
+    int64_t start = now_ns();
+    int64_t deadline = start + static_cast<int64_t>(timeout * 1e9);
+    int64_t poll_ns = std::max<int64_t>(budget.limits.sample_ns, 1000000);
+    bool admitted = false;
+    while (true) {
+        reclaim(excess_over_soft(budget, rss(true)));
+        if (rss() < budget.limits.hard) {
+            admitted = true;
+            break;
+        }
+        int64_t now = now_ns();
+        if (now >= deadline) {
+            break;
+        }
+        // Running work finishing is the other way usage comes down
+        std::this_thread::sleep_for(std::chrono::nanoseconds(std::min(poll_ns * 5, deadline - now)));
     }
     
-    void set_memory_limit(size_t limit) {
-        max_memory_limit = limit;
+    int64_t end = now_ns();
+    budget.throttle_wait_ns += static_cast<uint64_t>(end - start);
+    tracing::record(tracing::MEMORY, "memory.throttle", static_cast<uint64_t>(start), static_cast<uint64_t>(end), admitted);
+    if (!admitted) {
+        budget.throttle_rejected++;
+    }
+    return admitted;
+}
+
+Stats stats() {
+    BudgetState& budget = state();
+    Stats result;
+    result.limit = budget.limits.limit;
+    result.soft_limit = budget.limits.soft;
+    result.hard_limit = budget.limits.hard;
+    result.rss = rss(true);
+    result.peak_rss = budget.peak_rss;
+    for (int i = 0; i < kCategories; ++i) {
+        result.charged[i] = budget.charged[i];
+        result.charged_total += result.charged[i];
+    }
+    result.arena_bytes = memory_arena::stats().bytes_reserved;
+    result.pressure = pressure();
+    result.admissions_refused = budget.admissions_refused;
+    result.throttled = budget.throttled;
+    result.throttle_rejected = budget.throttle_rejected;
+    result.throttle_wait_time = budget.throttle_wait_ns / 1e9;
+    result.reclaims = budget.reclaims;
+    result.bytes_reclaimed = budget.bytes_reclaimed;
+    return result;
+}
+
+}  // namespace memory_budget
+
+namespace native_buffer {
+
+typedef struct {
+    PyObject_HEAD
+    std::shared_ptr<void>* owner;     // null once released
+    char* data;
+    Py_ssize_t size;                  // bytes
+    Py_ssize_t itemsize;
+    Py_ssize_t n_items;               // shape of exported views
+    const char* format;
+    bool readonly;
+    std::atomic<Py_ssize_t> exports;  // live memoryviews and other consumers
+} PyNativeBuffer;
+
+static PyTypeObject PyNativeBufferType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+static void native_buffer_dealloc(PyNativeBuffer* self) {
+    delete self->owner;
+    self->exports.~atomic();
+    Py_TYPE(self)->tp_free(reinterpret_cast<PyObject*>(self));
+}
+
+static int native_buffer_getbuffer(PyNativeBuffer* self, Py_buffer* view, int flags) {
+    if (!self->owner) {
+        view->obj = nullptr;
+        PyErr_SetString(PyExc_BufferError, "NativeBuffer has been released");
+        return -1;
+    }
+    if ((flags & PyBUF_WRITABLE) == PyBUF_WRITABLE && self->readonly) {
+        view->obj = nullptr;
+        PyErr_SetString(PyExc_BufferError, "NativeBuffer is read-only");
+        return -1;
     }
     
-    void set_tracking(bool enable) {
-        enable_tracking = enable;
+    view->obj = reinterpret_cast<PyObject*>(self);
+    Py_INCREF(self);
+    view->buf = self->data;
+    view->len = self->size;
+    view->itemsize = self->itemsize;
+    view->readonly = self->readonly;
+    view->format = (flags & PyBUF_FORMAT) == PyBUF_FORMAT ? const_cast<char*>(self->format) : nullptr;
+    view->ndim = 1;
+    view->shape = (flags & PyBUF_ND) == PyBUF_ND ? &self->n_items : nullptr;
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? &self->itemsize : nullptr;
+    view->suboffsets = nullptr;
+    view->internal = nullptr;
+    self->exports++;
+    return 0;
+}
+
+static void native_buffer_releasebuffer(PyNativeBuffer* self, Py_buffer* /*view*/) {
+    self->exports--;
+}
+
+static Py_ssize_t native_buffer_length(PyNativeBuffer* self) {
+    return self->owner ? self->n_items : 0;
+}
+
+static PyObject* native_buffer_release(PyNativeBuffer* self, PyObject* args) {
+    if (self->exports > 0) {
+        PyErr_SetString(PyExc_BufferError, "NativeBuffer is still exported (release its memoryviews first)");
+        return nullptr;
     }
     
-    // Memory pool for frequent allocations
-    class MemoryPool {
-    private:
-        std::vector<void*> free_blocks;
-        size_t block_size;
-        size_t pool_size;
-        std::mutex pool_mutex;
-        
-    public:
-        MemoryPool(size_t block_sz, size_t initial_blocks = 100) 
-            : block_size(block_sz), pool_size(initial_blocks) {
-            for (size_t i = 0; i < initial_blocks; ++i) {
-                void* block = std::aligned_alloc(64, block_size);
-                if (block) {
-                    free_blocks.push_back(block);
-                }
-            }
-        }
-        
-        ~MemoryPool() {
-            std::lock_guard<std::mutex> lock(pool_mutex);
-            for (void* block : free_blocks) {
-                std::free(block);
-            }
-        }
-        
-        void* get_block() {
-            std::lock_guard<std::mutex> lock(pool_mutex);
-            if (free_blocks.empty()) {
-                return std::aligned_alloc(64, block_size);
-            }
-            
-            void* block = free_blocks.back();
-            free_blocks.pop_back();
-            return block;
-        }
-        
-        void return_block(void* block) {
-            if (!block) return;
-            
-            std::lock_guard<std::mutex> lock(pool_mutex);
-            if (free_blocks.size() < pool_size * 2) {  // Limit pool size
-                free_blocks.push_back(block);
-            } else {
-                std::free(block);
-            }
-        }
-    };
+    // Dropping the owner may free a large allocation; do it without the GIL
+    std::shared_ptr<void>* owner = self->owner;
+    self->owner = nullptr;
+    self->data = nullptr;
+    Py_BEGIN_ALLOW_THREADS
+    delete owner;
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
+
+static PyObject* native_buffer_decode(PyNativeBuffer* self, PyObject* args) {
+    const char* encoding = "utf-8";
+    const char* errors = "strict";
     
-    // Get memory pool for specific block size
-    MemoryPool& get_pool(size_t block_size) {
-        static std::unordered_map<size_t, std::unique_ptr<MemoryPool>> pools;
-        static std::mutex pools_mutex;
-        
-        std::lock_guard<std::mutex> lock(pools_mutex);
-        
-        auto it = pools.find(block_size);
-        if (it == pools.end()) {
-            pools[block_size] = std::make_unique<MemoryPool>(block_size);
-            it = pools.find(block_size);
-        }
-        
-        return *it->second;
+    if (!PyArg_ParseTuple(args, "|ss", &encoding, &errors)) {
+        return nullptr;
+    }
+    if (!self->owner) {
+        PyErr_SetString(PyExc_BufferError, "NativeBuffer has been released");
+        return nullptr;
     }
+    return PyUnicode_Decode(self->data, self->size, encoding, errors);
+}
+
+static PyObject* native_buffer_address(PyNativeBuffer* self, void* /*closure*/) {
+    if (!self->owner) {
+        Py_RETURN_NONE;
+    }
+    return PyLong_FromVoidPtr(self->data);
+}
+
+static PyObject* native_buffer_readonly(PyNativeBuffer* self, void* /*closure*/) {
+    return PyBool_FromLong(self->readonly);
+}
+
+static PyBufferProcs NativeBufferProcs = {
+    reinterpret_cast<getbufferproc>(native_buffer_getbuffer),
+    reinterpret_cast<releasebufferproc>(native_buffer_releasebuffer)
+};
+
+static PySequenceMethods NativeBufferSequence = {
+    reinterpret_cast<lenfunc>(native_buffer_length)
 };
 
-// Global instance
+static PyMethodDef NativeBufferMethods[] = {
+    {"release", reinterpret_cast<PyCFunction>(native_buffer_release), METH_NOARGS, "Free the native memory now; fails while memoryviews of it exist"},
+    {"decode", reinterpret_cast<PyCFunction>(native_buffer_decode), METH_VARARGS, "Decode the bytes to str: (encoding='utf-8', errors='strict')"},
+    {nullptr, nullptr, 0, nullptr}
+};
+
+static PyGetSetDef NativeBufferGetSet[] = {
+    {"address", reinterpret_cast<getter>(native_buffer_address), nullptr, "Address of the first byte (None once released)", nullptr},
+    {"readonly", reinterpret_cast<getter>(native_buffer_readonly), nullptr, "Whether views are read-only", nullptr},
+    {nullptr, nullptr, nullptr, nullptr, nullptr}
+};
+
+bool init_type() {
+    // Module exec runs once per interpreter; the static type is shared
+    static std::once_flag once;
+    static bool ready = false;
+    std::call_once(once, []() {
+        PyNativeBufferType.tp_name = "memory_manager.NativeBuffer";
+        PyNativeBufferType.tp_doc = "Native memory exposed through the buffer protocol; use memoryview() or bytes()";
+        PyNativeBufferType.tp_basicsize = sizeof(PyNativeBuffer);
+        PyNativeBufferType.tp_flags = Py_TPFLAGS_DEFAULT;
+        PyNativeBufferType.tp_dealloc = reinterpret_cast<destructor>(native_buffer_dealloc);
+        PyNativeBufferType.tp_as_buffer = &NativeBufferProcs;
+        PyNativeBufferType.tp_as_sequence = &NativeBufferSequence;
+        PyNativeBufferType.tp_methods = NativeBufferMethods;
+        PyNativeBufferType.tp_getset = NativeBufferGetSet;
+        ready = PyType_Ready(&PyNativeBufferType) == 0;
+    });
+    return ready;
+}
+
+bool add_type(PyObject* module) {
+    if (!init_type()) {
+        return false;
+    }
+    Py_INCREF(&PyNativeBufferType);
+    if (PyModule_AddObject(module, "NativeBuffer", reinterpret_cast<PyObject*>(&PyNativeBufferType)) < 0) {
+        Py_DECREF(&PyNativeBufferType);
+        return false;
+    }
+    return true;
+}
+
+bool check(PyObject* obj) {
+    return PyObject_TypeCheck(obj, &PyNativeBufferType);
+}
+
+PyObject* wrap(std::shared_ptr<void> owner, void* data, size_t size, bool readonly,
+               const char* format, size_t itemsize) {
+    PyNativeBuffer* self = PyObject_New(PyNativeBuffer, &PyNativeBufferType);
+    if (!self) {
+        return nullptr;
+    }
+    self->owner = new std::shared_ptr<void>(std::move(owner));
+    self->data = static_cast<char*>(data);
+    self->size = static_cast<Py_ssize_t>(size);
+    self->itemsize = static_cast<Py_ssize_t>(itemsize);
+    self->n_items = static_cast<Py_ssize_t>(size / itemsize);
+    self->format = format;
+    self->readonly = readonly;
+    new (&self->exports) std::atomic<Py_ssize_t>(0);
+    return reinterpret_cast<PyObject*>(self);
+}
+
+PyObject* from_string(std::string&& bytes) {
+    auto holder = std::make_shared<std::string>(std::move(bytes));
+    return wrap(holder, &(*holder)[0], holder->size(), false);
+}
+
+PyObject* from_offsets(std::vector<uint64_t>&& offsets) {
+    auto holder = std::make_shared<std::vector<uint64_t>>(std::move(offsets));
+    return wrap(holder, holder->data(), holder->size() * sizeof(uint64_t), true, "Q", sizeof(uint64_t));
+}
+
+}  // namespace native_buffer
+
+// Global instance; created once and never replaced. The manager locks its
+// own state, the mutex only orders creation against readers.
 static std::unique_ptr<MemoryManager> g_memory_manager = nullptr;
+static std::mutex g_memory_manager_mutex;
+
+static MemoryManager* get_memory_manager() {
+    std::lock_guard<std::mutex> lock(g_memory_manager_mutex);
+    return g_memory_manager.get();
+}
 
 // Python C API functions
 static PyObject* init_memory_manager(PyObject* self, PyObject* args) {
-    size_t max_memory = 1024 * 1024 * 1024;  // 1GB default
+    unsigned long long max_memory = 1024 * 1024 * 1024;  // 1GB default
     
     if (!PyArg_ParseTuple(args, "|K", &max_memory)) {
         return nullptr;
     }
     
-    if (g_memory_manager) {
-        return PyBool_FromLong(1);
+    std::lock_guard<std::mutex> lock(g_memory_manager_mutex);
+    if (!g_memory_manager) {
+        g_memory_manager = std::make_unique<MemoryManager>(max_memory);
     }
-    
-    g_memory_manager = std::make_unique<MemoryManager>(max_memory);
     return PyBool_FromLong(1);
 }
 
 static PyObject* allocate_memory(PyObject* self, PyObject* args) {
-    size_t size;
-    size_t alignment = 64;
+    unsigned long long size;
+    unsigned long long alignment = 64;
     
     if (!PyArg_ParseTuple(args, "K|K", &size, &alignment)) {
         return nullptr;
     }
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        PyErr_SetString(PyExc_ValueError, "Alignment must be a power of two");
+        return nullptr;
+    }
     
-    if (!g_memory_manager) {
+    MemoryManager* manager = get_memory_manager();
+    if (!manager) {
         PyErr_SetString(PyExc_RuntimeError, "Memory manager not initialized");
         return nullptr;
     }
     
-    void* ptr = g_memory_manager->allocate(size, alignment);
+    void* ptr = manager->allocate(size, alignment);
     if (!ptr) {
         PyErr_SetString(PyExc_MemoryError, "Failed to allocate memory");
         return nullptr;
     }
     
-    return PyLong_FromVoidPtr(ptr);
+    // The manager is never replaced, so the deleter may outlive this call
+    std::shared_ptr<void> owner(ptr, [manager](void* p) { manager->deallocate(p); });
+    return native_buffer::wrap(std::move(owner), ptr, size, false);
 }
 
 static PyObject* deallocate_memory(PyObject* self, PyObject* args) {
-    void* ptr;
+    PyObject* buffer;
     
-    if (!PyArg_ParseTuple(args, "L", &ptr)) {
+    if (!PyArg_ParseTuple(args, "O", &buffer)) {
         return nullptr;
     }
-    
-    if (!g_memory_manager) {
-        PyErr_SetString(PyExc_RuntimeError, "Memory manager not initialized");
+    if (!native_buffer::check(buffer)) {
+        PyErr_SetString(PyExc_TypeError, "Expected a NativeBuffer returned by allocate()");
         return nullptr;
     }
-    
-    g_memory_manager->deallocate(ptr);
-    Py_RETURN_NONE;
+    return PyObject_CallMethod(buffer, "release", nullptr);
 }
 
 static PyObject* get_memory_stats(PyObject* self, PyObject* args) {
-    if (!g_memory_manager) {
+    MemoryManager* manager = get_memory_manager();
+    if (!manager) {
         PyErr_SetString(PyExc_RuntimeError, "Memory manager not initialized");
         return nullptr;
     }
     
     PyObject* stats = PyDict_New();
-    PyDict_SetItemString(stats, "total_allocated", PyLong_FromUnsignedLongLong(g_memory_manager->get_total_allocated()));
-    PyDict_SetItemString(stats, "peak_allocated", PyLong_FromUnsignedLongLong(g_memory_manager->get_peak_allocated()));
-    PyDict_SetItemString(stats, "allocation_count", PyLong_FromUnsignedLongLong(g_memory_manager->get_allocation_count()));
-    PyDict_SetItemString(stats, "deallocation_count", PyLong_FromUnsignedLongLong(g_memory_manager->get_deallocation_count()));
-    PyDict_SetItemString(stats, "active_blocks", PyLong_FromUnsignedLongLong(g_memory_manager->get_active_blocks()));
+    PyDict_SetItemString(stats, "total_allocated", PyLong_FromUnsignedLongLong(manager->get_total_allocated()));
+    PyDict_SetItemString(stats, "peak_allocated", PyLong_FromUnsignedLongLong(manager->get_peak_allocated()));
+    PyDict_SetItemString(stats, "allocation_count", PyLong_FromUnsignedLongLong(manager->get_allocation_count()));
+    PyDict_SetItemString(stats, "deallocation_count", PyLong_FromUnsignedLongLong(manager->get_deallocation_count()));
+    PyDict_SetItemString(stats, "active_blocks", PyLong_FromUnsignedLongLong(manager->get_active_blocks()));
     
     return stats;
 }
 
 static PyObject* cleanup_memory(PyObject* self, PyObject* args) {
-    if (!g_memory_manager) {
+    MemoryManager* manager = get_memory_manager();
+    if (!manager) {
         PyErr_SetString(PyExc_RuntimeError, "Memory manager not initialized");
         return nullptr;
     }
     
-    g_memory_manager->cleanup_unused();
+    manager->cleanup_unused();
+    Py_RETURN_NONE;
+}
+
+// Per-thread scratch arenas (memory_arena.h). Python threads get their own
+// native arena, like the native threads that allocate from one. Every
+// buffer handed out holds the arena's export handle, so a reset that would
+// leave a memoryview dangling is refused, and buffers that outlive their
+// thread keep its chunks mapped.
+
+static PyObject* configure_arena_cpp(PyObject* self, PyObject* args) {
+    PyObject* dict;
+    
+    if (!PyArg_ParseTuple(args, "O!", &PyDict_Type, &dict)) {
+        return nullptr;
+    }
+    
+    memory_arena::Config settings = memory_arena::config();
+    PyObject* key;
+    PyObject* value;
+    Py_ssize_t pos = 0;
+    while (PyDict_Next(dict, &pos, &key, &value)) {
+        const char* name = PyUnicode_Check(key) ? PyUnicode_AsUTF8(key) : nullptr;
+        if (!name) {
+            PyErr_SetString(PyExc_TypeError, "Arena parameter names must be strings");
+            return nullptr;
+        }
+        
+        std::string param(name);
+        if (param == "huge_pages" || param == "tracking") {
+            int flag = PyObject_IsTrue(value);
+            if (flag < 0) {
+                return nullptr;
+            }
+            (param == "huge_pages" ? settings.huge_pages : settings.tracking) = flag != 0;
+        } else if (param == "chunk_size" || param == "max_retained") {
+            unsigned long long bytes = PyLong_AsUnsignedLongLong(value);
+            if (PyErr_Occurred()) {
+                return nullptr;
+            }
+            (param == "chunk_size" ? settings.chunk_size : settings.max_retained) = static_cast<size_t>(bytes);
+        } else {
+            PyErr_Format(PyExc_ValueError, "Unknown arena parameter: %s", name);
+            return nullptr;
+        }
+    }
+    
+    memory_arena::configure(settings);
     Py_RETURN_NONE;
 }
 
+static PyObject* get_arena_stats_cpp(PyObject* self, PyObject* args) {
+    memory_arena::Stats stats = memory_arena::stats();
+    memory_arena::Config settings = memory_arena::config();
+    
+    return Py_BuildValue("{s:K,s:K,s:K,s:K,s:K,s:K,s:K,s:K,s:K,s:K,s:K,s:O,s:O}",
+                         "arenas", static_cast<unsigned long long>(stats.arenas),
+                         "chunks", static_cast<unsigned long long>(stats.chunks),
+                         "huge_page_chunks", static_cast<unsigned long long>(stats.huge_page_chunks),
+                         "bytes_reserved", static_cast<unsigned long long>(stats.bytes_reserved),
+                         "bytes_used", static_cast<unsigned long long>(stats.bytes_used),
+                         "peak_bytes_used", static_cast<unsigned long long>(stats.peak_bytes_used),
+                         "resets", static_cast<unsigned long long>(stats.resets),
+                         "allocations", static_cast<unsigned long long>(stats.allocations),
+                         "bytes_requested", static_cast<unsigned long long>(stats.bytes_requested),
+                         "chunk_size", static_cast<unsigned long long>(settings.chunk_size),
+                         "max_retained", static_cast<unsigned long long>(settings.max_retained),
+                         "huge_pages", settings.huge_pages ? Py_True : Py_False,
+                         "tracking", settings.tracking ? Py_True : Py_False);
+}
+
+static PyObject* arena_allocate_cpp(PyObject* self, PyObject* args) {
+    unsigned long long size;
+    unsigned long long alignment = alignof(std::max_align_t);
+    
+    if (!PyArg_ParseTuple(args, "K|K", &size, &alignment)) {
+        return nullptr;
+    }
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        PyErr_SetString(PyExc_ValueError, "Alignment must be a power of two");
+        return nullptr;
+    }
+    
+    memory_arena::Arena& arena = memory_arena::thread_arena();
+    void* ptr = arena.allocate(size, alignment);
+    if (!ptr) {
+        PyErr_SetString(PyExc_MemoryError, "Failed to allocate arena memory");
+        return nullptr;
+    }
+    return native_buffer::wrap(arena.export_handle(), ptr, size, false);
+}
+
+// Document boundary; every buffer arena_allocate returned on this thread must be gone
+static PyObject* arena_reset_cpp(PyObject* self, PyObject* args) {
+    int release = 0;
+    
+    if (!PyArg_ParseTuple(args, "|p", &release)) {
+        return nullptr;
+    }
+    
+    long live = memory_arena::thread_arena().exports();
+    if (live > 0) {
+        PyErr_Format(PyExc_BufferError, "%ld arena buffers from this thread are still alive", live);
+        return nullptr;
+    }
+    
+    memory_arena::Arena& arena = memory_arena::thread_arena();
+    if (release) {
+        arena.release();
+    } else {
+        arena.reset();
+    }
+    Py_RETURN_NONE;
+}
+
+// Process-wide memory budget (memory_budget.h); usable without init()
+static PyObject* configure_budget_cpp(PyObject* self, PyObject* args) {
+    PyObject* dict;
+    
+    if (!PyArg_ParseTuple(args, "O!", &PyDict_Type, &dict)) {
+        return nullptr;
+    }
+    
+    memory_budget::Config settings = memory_budget::config();
+    PyObject* key;
+    PyObject* value;
+    Py_ssize_t pos = 0;
+    while (PyDict_Next(dict, &pos, &key, &value)) {
+        const char* name = PyUnicode_Check(key) ? PyUnicode_AsUTF8(key) : nullptr;
+        if (!name) {
+            PyErr_SetString(PyExc_TypeError, "Budget parameter names must be strings");
+            return nullptr;
+        }
+        
+        std::string param(name);
+        if (param == "enforce") {
+            int flag = PyObject_IsTrue(value);
+            if (flag < 0) {
+                return nullptr;
+            }
+            settings.enforce = flag != 0;
+        } else if (param == "limit") {
+            unsigned long long bytes = PyLong_AsUnsignedLongLong(value);
+            if (PyErr_Occurred()) {
+                return nullptr;
+            }
+            settings.limit = static_cast<size_t>(bytes);
+        } else if (param == "soft_fraction" || param == "hard_fraction" ||
+                   param == "throttle_timeout" || param == "sample_interval") {
+            double number = PyFloat_AsDouble(value);
+            if (PyErr_Occurred()) {
+                return nullptr;
+            }
+            if (param == "soft_fraction") {
+                settings.soft_fraction = number;
+            } else if (param == "hard_fraction") {
+                settings.hard_fraction = number;
+            } else if (param == "throttle_timeout") {
+                settings.throttle_timeout = number;
+            } else {
+                settings.sample_interval = number;
+            }
+        } else {
+            PyErr_Format(PyExc_ValueError, "Unknown budget parameter: %s", name);
+            return nullptr;
+        }
+    }
+    
+    memory_budget::configure(settings);
+    Py_RETURN_NONE;
+}
+
+static PyObject* get_budget_stats_cpp(PyObject* self, PyObject* args) {
+    memory_budget::Stats stats;
+    Py_BEGIN_ALLOW_THREADS
+    stats = memory_budget::stats();
+    Py_END_ALLOW_THREADS
+    memory_budget::Config settings = memory_budget::config();
+    
+    const char* pressure = stats.pressure == memory_budget::Pressure::HARD ? "hard" :
+                           stats.pressure == memory_budget::Pressure::SOFT ? "soft" : "normal";
+    PyObject* charged = PyDict_New();
+    for (int i = 0; charged && i < static_cast<int>(memory_budget::Category::COUNT); ++i) {
+        PyObject* bytes = PyLong_FromUnsignedLongLong(stats.charged[i]);
+        PyDict_SetItemString(charged, memory_budget::category_name(static_cast<memory_budget::Category>(i)), bytes);
+        Py_XDECREF(bytes);
+    }
+    if (!charged) {
+        return nullptr;
+    }
+    
+    return Py_BuildValue("{s:K,s:K,s:K,s:K,s:K,s:N,s:K,s:K,s:s,s:K,s:K,s:K,s:d,s:K,s:K,s:O}",
+                         "limit", static_cast<unsigned long long>(stats.limit),
+                         "soft_limit", static_cast<unsigned long long>(stats.soft_limit),
+                         "hard_limit", static_cast<unsigned long long>(stats.hard_limit),
+                         "rss", static_cast<unsigned long long>(stats.rss),
+                         "peak_rss", static_cast<unsigned long long>(stats.peak_rss),
+                         "charged", charged,
+                         "charged_total", static_cast<unsigned long long>(stats.charged_total),
+                         "arena_bytes", static_cast<unsigned long long>(stats.arena_bytes),
+                         "pressure", pressure,
+                         "admissions_refused", static_cast<unsigned long long>(stats.admissions_refused),
+                         "throttled", static_cast<unsigned long long>(stats.throttled),
+                         "throttle_rejected", static_cast<unsigned long long>(stats.throttle_rejected),
+                         "throttle_wait_time", stats.throttle_wait_time,
+                         "reclaims", static_cast<unsigned long long>(stats.reclaims),
+                         "bytes_reclaimed", static_cast<unsigned long long>(stats.bytes_reclaimed),
+                         "enforce", settings.enforce ? Py_True : Py_False);
+}
+
+static PyObject* reclaim_memory_cpp(PyObject* self, PyObject* args) {
+    unsigned long long bytes = 0;
+    
+    if (!PyArg_ParseTuple(args, "|K", &bytes)) {
+        return nullptr;
+    }
+    
+    // 0: whatever the reclaimers can give back
+    size_t freed;
+    Py_BEGIN_ALLOW_THREADS
+    freed = memory_budget::reclaim(bytes > 0 ? static_cast<size_t>(bytes) : SIZE_MAX);
+    Py_END_ALLOW_THREADS
+    return PyLong_FromSize_t(freed);
+}
+
 static PyMethodDef MemoryManagerMethods[] = {
     {"init", init_memory_manager, METH_VARARGS, "Initialize memory manager"},
-    {"allocate", allocate_memory, METH_VARARGS, "Allocate aligned memory"},
-    {"deallocate", deallocate_memory, METH_VARARGS, "Deallocate memory"},
+    {"allocate", allocate_memory, METH_VARARGS, "Allocate aligned memory: (size, alignment=64) -> NativeBuffer, freed with the buffer"},
+    {"deallocate", deallocate_memory, METH_VARARGS, "Free a NativeBuffer from allocate() now instead of when it is collected"},
     {"get_stats", get_memory_stats, METH_VARARGS, "Get memory statistics"},
     {"cleanup", cleanup_memory, METH_VARARGS, "Cleanup unused memory"},
+    {"configure_arena", configure_arena_cpp, METH_VARARGS, "Set arena chunk_size, max_retained, huge_pages and tracking from a dict"},
+    {"get_arena_stats", get_arena_stats_cpp, METH_VARARGS, "Get chunk, reserved and used bytes and reset counts over all thread arenas"},
+    {"arena_allocate", arena_allocate_cpp, METH_VARARGS, "Allocate scratch memory from this thread's arena: (size, alignment=16) -> NativeBuffer"},
+    {"arena_reset", arena_reset_cpp, METH_VARARGS, "Free this thread's arena allocations at a document boundary; release=True also returns its chunks"},
+    {"configure_budget", configure_budget_cpp, METH_VARARGS, "Set the process memory budget: limit, soft_fraction, hard_fraction, throttle_timeout, sample_interval, enforce"},
+    {"get_budget_stats", get_budget_stats_cpp, METH_VARARGS, "Get RSS against the budget, bytes charged per category, pressure and throttling counters"},
+    {"reclaim_memory", reclaim_memory_cpp, METH_VARARGS, "Ask caches, pools and idle models to give back bytes (default: all they can); returns bytes freed"},
     {nullptr, nullptr, 0, nullptr}
 };
 
+static int memory_manager_exec(PyObject* module) {
+    return native_buffer::add_type(module) ? 0 : -1;
+}
+
+// No per-module state: the manager is process-wide and internally locked
+static PyModuleDef_Slot MemoryManagerSlots[] = {
+    {Py_mod_exec, reinterpret_cast<void*>(memory_manager_exec)},
+#if PY_VERSION_HEX >= 0x030C0000
+    {Py_mod_multiple_interpreters, Py_MOD_MULTIPLE_INTERPRETERS_SUPPORTED},
+#endif
+#if PY_VERSION_HEX >= 0x030D0000
+    {Py_mod_gil, Py_MOD_GIL_NOT_USED},
+#endif
+    {0, nullptr}
+};
+
 static struct PyModuleDef memorymanagermodule = {
     PyModuleDef_HEAD_INIT,
     "memory_manager",
     "Memory management utilities",
-    -1,
-    MemoryManagerMethods
+    0,
+    MemoryManagerMethods,
+    MemoryManagerSlots
 };
 
 PyMODINIT_FUNC PyInit_memory_manager(void) {
-    return PyModule_Create(&memorymanagermodule);
+    return PyModuleDef_Init(&memorymanagermodule);
 }
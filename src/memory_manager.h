@@ -0,0 +1,288 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "memory_budget.h"
+
+// Tracked allocator behind the memory_manager module, implemented inline
+// so native benchmarks can drive it without the Python layer. Allocations
+// are charged to the memory budget as MANAGER, pool blocks as POOLS.
+class MemoryManager {
+private:
+    struct MemoryBlock {
+        void* ptr;
+        size_t size;
+        std::chrono::steady_clock::time_point allocated_time;
+        bool in_use;
+        
+        MemoryBlock(void* p, size_t s) : ptr(p), size(s), in_use(true) {
+            allocated_time = std::chrono::steady_clock::now();
+        }
+    };
+    
+    std::unordered_map<void*, MemoryBlock> allocated_blocks;
+    mutable std::mutex memory_mutex;
+    std::atomic<size_t> total_allocated{0};
+    std::atomic<size_t> peak_allocated{0};
+    std::atomic<size_t> allocation_count{0};
+    std::atomic<size_t> deallocation_count{0};
+    
+    size_t max_memory_limit;
+    bool enable_tracking;
+    
+    int reclaimer_id = 0;  // memory_budget reclaimer trimming the pools
+    
+public:
+    // max_mem caps allocate(); the process as a whole is held to the
+    // memory budget (memory_budget.h)
+    MemoryManager(size_t max_mem = 1024 * 1024 * 1024) : max_memory_limit(max_mem), enable_tracking(true) {
+        std::cout << "Memory Manager initialized with limit: " << max_mem / (1024 * 1024) << " MB" << std::endl;
+        reclaimer_id = memory_budget::add_reclaimer("memory_pools", 0, [this](size_t bytes) {
+            return trim_pools(bytes);
+        });
+    }
+    
+    ~MemoryManager() {
+        memory_budget::remove_reclaimer(reclaimer_id);
+        cleanup_all();
+    }
+    
+    void* allocate(size_t size, size_t alignment = 64) {
+        if (!enable_tracking) {
+            return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+        }
+        
+        // Before taking the lock: admission may run reclaimers
+        if (!memory_budget::admit(size)) {
+            std::cerr << "Memory budget exceeded: " << size << " bytes refused at "
+                      << memory_budget::rss() << " bytes resident" << std::endl;
+            return nullptr;
+        }
+        
+        std::lock_guard<std::mutex> lock(memory_mutex);
+        
+        // Check memory limit
+        if (total_allocated + size > max_memory_limit) {
+            std::cerr << "Memory limit exceeded: " << total_allocated << " + " << size 
+                      << " > " << max_memory_limit << std::endl;
+            return nullptr;
+        }
+        
+        // aligned_alloc requires a size that is a multiple of the alignment
+        void* ptr = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+        if (!ptr) {
+            return nullptr;
+        }
+        
+        // Track allocation
+        allocated_blocks.emplace(ptr, MemoryBlock(ptr, size));
+        memory_budget::charge(memory_budget::Category::MANAGER, size);
+        total_allocated += size;
+        peak_allocated = std::max(peak_allocated.load(), total_allocated.load());
+        allocation_count++;
+        
+        return ptr;
+    }
+    
+    void deallocate(void* ptr) {
+        if (!ptr) return;
+        
+        if (!enable_tracking) {
+            std::free(ptr);
+            return;
+        }
+        
+        std::lock_guard<std::mutex> lock(memory_mutex);
+        
+        auto it = allocated_blocks.find(ptr);
+        if (it == allocated_blocks.end()) {
+            return;  // Not ours, or already released by cleanup_all()
+        }
+        total_allocated -= it->second.size;
+        memory_budget::credit(memory_budget::Category::MANAGER, it->second.size);
+        allocated_blocks.erase(it);
+        deallocation_count++;
+        
+        std::free(ptr);
+    }
+    
+    void cleanup_unused() {
+        std::lock_guard<std::mutex> lock(memory_mutex);
+        
+        auto now = std::chrono::steady_clock::now();
+        auto timeout = std::chrono::minutes(5);  // 5 minute timeout
+        
+        auto it = allocated_blocks.begin();
+        while (it != allocated_blocks.end()) {
+            if (!it->second.in_use && 
+                (now - it->second.allocated_time) > timeout) {
+                std::free(it->first);
+                total_allocated -= it->second.size;
+                memory_budget::credit(memory_budget::Category::MANAGER, it->second.size);
+                it = allocated_blocks.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    
+    void cleanup_all() {
+        std::lock_guard<std::mutex> lock(memory_mutex);
+        
+        for (auto& pair : allocated_blocks) {
+            std::free(pair.first);
+            memory_budget::credit(memory_budget::Category::MANAGER, pair.second.size);
+        }
+        allocated_blocks.clear();
+        total_allocated = 0;
+    }
+    
+    size_t get_total_allocated() const {
+        return total_allocated;
+    }
+    
+    size_t get_peak_allocated() const {
+        return peak_allocated;
+    }
+    
+    size_t get_allocation_count() const {
+        return allocation_count;
+    }
+    
+    size_t get_deallocation_count() const {
+        return deallocation_count;
+    }
+    
+    size_t get_active_blocks() const {
+        std::lock_guard<std::mutex> lock(memory_mutex);
+        return allocated_blocks.size();
+    }
+    
+    void set_memory_limit(size_t limit) {
+        max_memory_limit = limit;
+    }
+    
+    void set_tracking(bool enable) {
+        enable_tracking = enable;
+    }
+    
+    // Memory pool for frequent allocations. Every block it allocates, free
+    // or handed out, is charged to the budget's pools category.
+    class MemoryPool {
+    private:
+        std::vector<void*> free_blocks;
+        size_t block_size;
+        size_t pool_size;
+        std::mutex pool_mutex;
+        
+        void* new_block() {
+            void* block = std::aligned_alloc(64, block_size);
+            if (block) {
+                memory_budget::charge(memory_budget::Category::POOLS, block_size);
+            }
+            return block;
+        }
+        
+        void free_block(void* block) {
+            std::free(block);
+            memory_budget::credit(memory_budget::Category::POOLS, block_size);
+        }
+        
+    public:
+        // Blocks are whole multiples of the 64-byte alignment
+        MemoryPool(size_t block_sz, size_t initial_blocks = 100) 
+            : block_size((std::max<size_t>(block_sz, 1) + 63) / 64 * 64), pool_size(initial_blocks) {
+            for (size_t i = 0; i < initial_blocks; ++i) {
+                void* block = new_block();
+                if (block) {
+                    free_blocks.push_back(block);
+                }
+            }
+        }
+        
+        ~MemoryPool() {
+            std::lock_guard<std::mutex> lock(pool_mutex);
+            for (void* block : free_blocks) {
+                free_block(block);
+            }
+        }
+        
+        void* get_block() {
+            std::lock_guard<std::mutex> lock(pool_mutex);
+            if (free_blocks.empty()) {
+                return new_block();
+            }
+            
+            void* block = free_blocks.back();
+            free_blocks.pop_back();
+            return block;
+        }
+        
+        void return_block(void* block) {
+            if (!block) return;
+            
+            std::lock_guard<std::mutex> lock(pool_mutex);
+            if (free_blocks.size() < pool_size * 2) {  // Limit pool size
+                free_blocks.push_back(block);
+            } else {
+                free_block(block);
+            }
+        }
+        
+        // Free idle blocks until `bytes` are freed; skipped while the pool is in use
+        size_t trim(size_t bytes) {
+            std::unique_lock<std::mutex> lock(pool_mutex, std::try_to_lock);
+            if (!lock.owns_lock()) {
+                return 0;
+            }
+            size_t freed = 0;
+            while (freed < bytes && !free_blocks.empty()) {
+                free_block(free_blocks.back());
+                free_blocks.pop_back();
+                freed += block_size;
+            }
+            return freed;
+        }
+    };
+    
+    // Get memory pool for specific block size
+    MemoryPool& get_pool(size_t block_size) {
+        std::lock_guard<std::mutex> lock(pools_mutex);
+        
+        std::unique_ptr<MemoryPool>& pool = pools[block_size];
+        if (!pool) {
+            pool = std::make_unique<MemoryPool>(block_size);
+        }
+        return *pool;
+    }
+    
+    // Budget reclaimer: give back idle pool blocks
+    size_t trim_pools(size_t bytes) {
+        std::unique_lock<std::mutex> lock(pools_mutex, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            return 0;
+        }
+        size_t freed = 0;
+        for (auto& pool : pools) {
+            if (freed >= bytes) {
+                break;
+            }
+            freed += pool.second->trim(bytes - freed);
+        }
+        return freed;
+    }
+    
+private:
+    // Pools live as long as the manager; their free blocks are the first
+    // thing given back under memory pressure
+    std::unordered_map<size_t, std::unique_ptr<MemoryPool>> pools;
+    std::mutex pools_mutex;
+};
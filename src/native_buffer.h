@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// NativeBuffer: a Python object exposing native memory through the buffer
+// protocol, implemented in memory_manager.cpp and shared by the native
+// modules. memoryview(), bytes(), file.write() and zipfile read it in
+// place, so generated payloads reach Python without a str copy.
+//
+// The buffer keeps `owner` alive until the object and every memoryview
+// of it are gone; release() drops it early when nothing is exported.
+// Include after Python.h.
+namespace native_buffer {
+
+// Ready the type; call from every module exec that creates buffers
+bool init_type();
+
+// Add the type to a module as "NativeBuffer"
+bool add_type(PyObject* module);
+
+bool check(PyObject* obj);
+
+// New reference. `format` is a struct module code describing items of
+// `itemsize` bytes; `size` is in bytes.
+PyObject* wrap(std::shared_ptr<void> owner, void* data, size_t size, bool readonly,
+               const char* format = "B", size_t itemsize = 1);
+
+// Take over a string or vector without copying its contents
+PyObject* from_string(std::string&& bytes);
+PyObject* from_offsets(std::vector<uint64_t>&& offsets);  // format "Q"
+
+}  // namespace native_buffer
@@ -0,0 +1,2299 @@
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <ctime>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+#ifdef ZLIB_FOUND
+#include <zlib.h>
+#endif
+
+extern "C" {
+    #define PY_SSIZE_T_CLEAN
+    #include <Python.h>
+}
+
+#include "credential_views.h"
+#include "tracing.h"
+
+// Streaming writers for xlsx, docx and pptx packages. Parts are emitted
+// front to back as the document is built: XML is produced into a small
+// staging buffer and pushed through incremental deflate straight into the
+// zip file, each entry followed by a data descriptor. Only the central
+// directory and the list of parts stay in memory, so a sheet with a
+// million credential rows costs the same memory as one with ten.
+// Without zlib, entries are stored uncompressed.
+
+namespace {
+
+// Staging buffer flushed into the open entry once it reaches this size
+constexpr size_t kFlushThreshold = size_t(64) << 10;
+
+// Excel rejects longer cell text
+constexpr size_t kMaxCellBytes = 32767;
+
+const char kXmlHeader[] = "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n";
+const char kRelsNs[] = "http://schemas.openxmlformats.org/package/2006/relationships";
+const char kDocRelNs[] = "http://schemas.openxmlformats.org/officeDocument/2006/relationships";
+
+#ifndef ZLIB_FOUND
+uint32_t crc32_update(uint32_t crc, const uint8_t* data, size_t n) {
+    static const struct Table {
+        uint32_t value[256];
+        Table() {
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k) {
+                    c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                value[i] = c;
+            }
+        }
+    } table;
+
+    crc = ~crc;
+    for (size_t i = 0; i < n; ++i) {
+        crc = table.value[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+#endif
+
+void put16(std::string& out, uint16_t v) {
+    out.push_back(static_cast<char>(v & 0xFF));
+    out.push_back(static_cast<char>(v >> 8));
+}
+
+void put32(std::string& out, uint32_t v) {
+    put16(out, static_cast<uint16_t>(v & 0xFFFF));
+    put16(out, static_cast<uint16_t>(v >> 16));
+}
+
+// Append text as XML character data (or an attribute value), dropping the
+// control characters XML 1.0 cannot represent
+void append_escaped(std::string& out, std::string_view text) {
+    size_t run = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        const char* entity = nullptr;
+        switch (c) {
+            case '&': entity = "&amp;"; break;
+            case '<': entity = "&lt;"; break;
+            case '>': entity = "&gt;"; break;
+            case '"': entity = "&quot;"; break;
+            default:
+                if (c >= 0x20 || c == '\t' || c == '\n' || c == '\r') {
+                    continue;
+                }
+                entity = "";
+        }
+        out.append(text.data() + run, i - run);
+        out.append(entity);
+        run = i + 1;
+    }
+    out.append(text.data() + run, text.size() - run);
+}
+
+// Leading or trailing whitespace is dropped by readers unless preserved
+bool needs_preserve(std::string_view text) {
+    auto space = [](char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; };
+    return !text.empty() && (space(text.front()) || space(text.back()));
+}
+
+// Cut at most `limit` bytes without splitting a UTF-8 sequence
+std::string_view utf8_prefix(std::string_view text, size_t limit) {
+    if (text.size() <= limit) {
+        return text;
+    }
+    size_t cut = limit;
+    while (cut > 0 && (static_cast<unsigned char>(text[cut]) & 0xC0) == 0x80) {
+        --cut;
+    }
+    return text.substr(0, cut);
+}
+
+// Zip archive written front to back
+class ZipStream {
+public:
+    ZipStream() = default;
+    ZipStream(const ZipStream&) = delete;
+    ZipStream& operator=(const ZipStream&) = delete;
+
+    ~ZipStream() {
+        abort();
+    }
+
+    bool open(const std::string& path, int compression, std::string& error) {
+        file = std::fopen(path.c_str(), "wb");
+        if (!file) {
+            error = "Cannot create " + path + ": " + std::strerror(errno);
+            return false;
+        }
+        this->path = path;
+        level = compression;
+
+        std::time_t now = std::time(nullptr);
+        std::tm local = *std::localtime(&now);
+        dos_time = static_cast<uint16_t>((local.tm_hour << 11) | (local.tm_min << 5) | (local.tm_sec / 2));
+        dos_date = static_cast<uint16_t>(((std::max(local.tm_year, 80) - 80) << 9) | ((local.tm_mon + 1) << 5) | local.tm_mday);
+        return true;
+    }
+
+    bool begin(const std::string& name, std::string& error) {
+        Entry entry;
+        entry.name = name;
+        entry.offset = written;
+#ifdef ZLIB_FOUND
+        entry.method = level > 0 ? 8 : 0;
+#else
+        entry.method = 0;
+#endif
+        entries.push_back(entry);
+
+        std::string header;
+        put32(header, 0x04034b50);
+        put16(header, 20);                // Version needed: 2.0
+        put16(header, kFlags);
+        put16(header, entry.method);
+        put16(header, dos_time);
+        put16(header, dos_date);
+        put32(header, 0);                 // CRC and sizes follow in the data descriptor
+        put32(header, 0);
+        put32(header, 0);
+        put16(header, static_cast<uint16_t>(name.size()));
+        put16(header, 0);
+        header += name;
+        if (!emit(header.data(), header.size(), error)) {
+            return false;
+        }
+
+        crc = 0;
+        compressed_start = written;
+#ifdef ZLIB_FOUND
+        if (entry.method == 8) {
+            stream = {};
+            if (deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+                error = "deflateInit2 failed";
+                return false;
+            }
+            deflating = true;
+        }
+#endif
+        return true;
+    }
+
+    bool write(const char* data, size_t n, std::string& error) {
+        Entry& entry = entries.back();
+        entry.size += n;
+#ifdef ZLIB_FOUND
+        crc = static_cast<uint32_t>(crc32_z(crc, reinterpret_cast<const Bytef*>(data), n));
+        if (deflating) {
+            return deflate_chunk(data, n, Z_NO_FLUSH, error);
+        }
+#else
+        crc = crc32_update(crc, reinterpret_cast<const uint8_t*>(data), n);
+#endif
+        return emit(data, n, error);
+    }
+
+    bool end(std::string& error) {
+#ifdef ZLIB_FOUND
+        if (deflating) {
+            bool ok = deflate_chunk(nullptr, 0, Z_FINISH, error);
+            deflateEnd(&stream);
+            deflating = false;
+            if (!ok) {
+                return false;
+            }
+        }
+#endif
+        Entry& entry = entries.back();
+        entry.crc = crc;
+        entry.compressed = written - compressed_start;
+        if (entry.size > 0xFFFFFFFEu || entry.compressed > 0xFFFFFFFEu) {
+            error = "Part " + entry.name + " exceeds 4 GiB";
+            return false;
+        }
+
+        std::string descriptor;
+        put32(descriptor, 0x08074b50);
+        put32(descriptor, entry.crc);
+        put32(descriptor, static_cast<uint32_t>(entry.compressed));
+        put32(descriptor, static_cast<uint32_t>(entry.size));
+        return emit(descriptor.data(), descriptor.size(), error);
+    }
+
+    // Central directory; closes the file
+    bool finish(std::string& error) {
+        uint64_t directory_start = written;
+        std::string directory;
+        for (const Entry& entry : entries) {
+            if (entry.offset > 0xFFFFFFFEu) {
+                error = "Package exceeds 4 GiB";
+                return false;
+            }
+            put32(directory, 0x02014b50);
+            put16(directory, 20);         // Made by: MS-DOS, 2.0
+            put16(directory, 20);
+            put16(directory, kFlags);
+            put16(directory, entry.method);
+            put16(directory, dos_time);
+            put16(directory, dos_date);
+            put32(directory, entry.crc);
+            put32(directory, static_cast<uint32_t>(entry.compressed));
+            put32(directory, static_cast<uint32_t>(entry.size));
+            put16(directory, static_cast<uint16_t>(entry.name.size()));
+            put16(directory, 0);          // Extra field
+            put16(directory, 0);          // Comment
+            put16(directory, 0);          // Disk
+            put16(directory, 0);          // Internal attributes
+            put32(directory, 0);          // External attributes
+            put32(directory, static_cast<uint32_t>(entry.offset));
+            directory += entry.name;
+        }
+        if (entries.size() > 0xFFFF || directory_start > 0xFFFFFFFEu) {
+            error = "Package exceeds the zip limits";
+            return false;
+        }
+
+        uint32_t directory_size = static_cast<uint32_t>(directory.size());
+        put32(directory, 0x06054b50);
+        put16(directory, 0);
+        put16(directory, 0);
+        put16(directory, static_cast<uint16_t>(entries.size()));
+        put16(directory, static_cast<uint16_t>(entries.size()));
+        put32(directory, directory_size);
+        put32(directory, static_cast<uint32_t>(directory_start));
+        put16(directory, 0);
+        if (!emit(directory.data(), directory.size(), error)) {
+            return false;
+        }
+
+        std::FILE* f = file;
+        file = nullptr;
+        if (std::fclose(f) != 0) {
+            error = "Cannot write " + path + ": " + std::strerror(errno);
+            return false;
+        }
+        return true;
+    }
+
+    // Close and remove an unfinished package
+    void abort() {
+#ifdef ZLIB_FOUND
+        if (deflating) {
+            deflateEnd(&stream);
+            deflating = false;
+        }
+#endif
+        if (file) {
+            std::fclose(file);
+            file = nullptr;
+            std::remove(path.c_str());
+        }
+    }
+
+    size_t parts() const {
+        return entries.size();
+    }
+
+    uint64_t bytes_in() const {
+        uint64_t total = 0;
+        for (const Entry& entry : entries) {
+            total += entry.size;
+        }
+        return total;
+    }
+
+    uint64_t bytes_out() const {
+        return written;
+    }
+
+private:
+    // Data descriptor follows each entry; names are UTF-8
+    static constexpr uint16_t kFlags = 0x0008 | 0x0800;
+
+    struct Entry {
+        std::string name;
+        uint16_t method = 0;
+        uint32_t crc = 0;
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        uint64_t compressed = 0;
+    };
+
+    bool emit(const void* data, size_t n, std::string& error) {
+        if (n > 0 && std::fwrite(data, 1, n, file) != n) {
+            error = "Cannot write " + path + ": " + std::strerror(errno);
+            return false;
+        }
+        written += n;
+        return true;
+    }
+
+#ifdef ZLIB_FOUND
+    bool deflate_chunk(const char* data, size_t n, int flush, std::string& error) {
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        stream.avail_in = static_cast<uInt>(n);
+        int status;
+        do {
+            stream.next_out = out;
+            stream.avail_out = sizeof(out);
+            status = deflate(&stream, flush);
+            if (status == Z_STREAM_ERROR) {
+                error = "deflate failed";
+                return false;
+            }
+            if (!emit(out, sizeof(out) - stream.avail_out, error)) {
+                return false;
+            }
+        } while (stream.avail_out == 0 || (flush == Z_FINISH && status != Z_STREAM_END));
+        return true;
+    }
+
+    z_stream stream = {};
+    bool deflating = false;
+    Bytef out[kFlushThreshold];
+#endif
+
+    std::FILE* file = nullptr;
+    std::string path;
+    int level = 6;
+    uint16_t dos_time = 0;
+    uint16_t dos_date = 0;
+    std::vector<Entry> entries;
+    uint64_t written = 0;
+    uint64_t compressed_start = 0;
+    uint32_t crc = 0;
+};
+
+struct PackageOptions {
+    int compression = 6;   // zlib level; 0 stores parts uncompressed
+    std::string title;     // docProps/core.xml
+    std::string creator = "CredentialForge";
+};
+
+// Parts shared by every package type; subclasses stream their main parts
+// and describe the rest at close. One thread at a time: the Python
+// wrappers serialize calls through `mutex`.
+class PackageWriter {
+public:
+    virtual ~PackageWriter() = default;
+
+    bool open(const std::string& path, const PackageOptions& package_options) {
+        options = package_options;
+        started = std::chrono::steady_clock::now();
+        return zip.open(path, options.compression, error);
+    }
+
+    bool close() {
+        if (!check_open() || !write_package_parts()) {
+            return fail();
+        }
+
+        add_override("/docProps/core.xml", "application/vnd.openxmlformats-package.core-properties+xml");
+        begin_part("docProps/core.xml");
+        xml += kXmlHeader;
+        xml += "<cp:coreProperties xmlns:cp=\"http://schemas.openxmlformats.org/package/2006/metadata/core-properties\" "
+               "xmlns:dc=\"http://purl.org/dc/elements/1.1/\" xmlns:dcterms=\"http://purl.org/dc/terms/\" "
+               "xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\">";
+        if (!options.title.empty()) {
+            xml += "<dc:title>";
+            append_escaped(xml, options.title);
+            xml += "</dc:title>";
+        }
+        xml += "<dc:creator>";
+        append_escaped(xml, options.creator);
+        xml += "</dc:creator>";
+        char created[32];
+        std::time_t now = std::time(nullptr);
+        std::strftime(created, sizeof(created), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+        xml += "<dcterms:created xsi:type=\"dcterms:W3CDTF\">";
+        xml += created;
+        xml += "</dcterms:created></cp:coreProperties>";
+        if (!end_part()) {
+            return fail();
+        }
+
+        begin_part("[Content_Types].xml");
+        xml += kXmlHeader;
+        xml += "<Types xmlns=\"http://schemas.openxmlformats.org/package/2006/content-types\">"
+               "<Default Extension=\"rels\" ContentType=\"application/vnd.openxmlformats-package.relationships+xml\"/>"
+               "<Default Extension=\"xml\" ContentType=\"application/xml\"/>";
+        for (const auto& entry : overrides) {
+            xml += "<Override PartName=\"" + entry.first + "\" ContentType=\"" + entry.second + "\"/>";
+        }
+        xml += "</Types>";
+        if (!end_part()) {
+            return fail();
+        }
+
+        begin_part("_rels/.rels");
+        xml += kXmlHeader;
+        xml += std::string("<Relationships xmlns=\"") + kRelsNs + "\">"
+               "<Relationship Id=\"rId1\" Type=\"" + kDocRelNs + "/officeDocument\" Target=\"" + main_part() + "\"/>"
+               "<Relationship Id=\"rId2\" Type=\"" + kRelsNs + "/metadata/core-properties\" Target=\"docProps/core.xml\"/>"
+               "</Relationships>";
+        if (!end_part() || !zip.finish(error)) {
+            return fail();
+        }
+        closed = true;
+        return true;
+    }
+
+    void abort() {
+        zip.abort();
+        closed = true;
+    }
+
+    bool is_closed() const {
+        return closed;
+    }
+
+    double elapsed() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    }
+
+    const ZipStream& archive() const {
+        return zip;
+    }
+
+    std::mutex mutex;
+    std::string error;
+
+protected:
+    // Closes the part left open, then writes the package-specific parts and
+    // overrides
+    virtual bool write_package_parts() = 0;
+    virtual const char* main_part() const = 0;
+
+    bool check_open() {
+        if (closed) {
+            error = "Writer is closed";
+            return false;
+        }
+        return true;
+    }
+
+    // Failures leave a broken package behind; remove it
+    bool fail() {
+        if (!closed) {
+            std::string reason = error;
+            abort();
+            error = reason;
+        }
+        return false;
+    }
+
+    void add_override(std::string part, const char* content_type) {
+        overrides.emplace_back(std::move(part), content_type);
+    }
+
+    // Ends the open part, if any, and starts `name`
+    bool begin_part(const std::string& name) {
+        if (!end_part() || !zip.begin(name, error)) {
+            return fail();
+        }
+        open_part = true;
+        return true;
+    }
+
+    bool flush_if_full() {
+        return xml.size() < kFlushThreshold || flush();
+    }
+
+    bool flush() {
+        if (!xml.empty() && !zip.write(xml.data(), xml.size(), error)) {
+            return fail();
+        }
+        xml.clear();
+        return true;
+    }
+
+    bool end_part() {
+        if (!open_part) {
+            return true;
+        }
+        open_part = false;
+        if (!flush() || !zip.end(error)) {
+            return fail();
+        }
+        return true;
+    }
+
+    // One-shot part from a complete string
+    bool write_part(const std::string& name, const std::string& content) {
+        if (!begin_part(name)) {
+            return false;
+        }
+        xml += content;
+        return end_part();
+    }
+
+    std::string xml;  // Staging buffer for the open part
+    PackageOptions options;
+
+private:
+    ZipStream zip;
+    std::vector<std::pair<std::string, const char*>> overrides;
+    bool open_part = false;
+    bool closed = false;
+    std::chrono::steady_clock::time_point started;
+};
+
+// Cell values converted from Python while the GIL is held
+struct Cell {
+    enum Kind : uint8_t { EMPTY, TEXT, NUMBER, BOOLEAN };
+    Kind kind = EMPTY;
+    uint8_t style = 0;
+    std::string_view text;  // TEXT: UTF-8; NUMBER: xsd:double literal; BOOLEAN: "0" or "1"
+};
+
+// Built-in cell formats, by cellXfs index
+struct CellStyle {
+    const char* name;
+    int font;   // 0 regular 11pt, 1 bold, 2 bold 14pt, 3 bold 16pt
+    int fill;   // 0 none, 2 CCCCCC, 3 DDDDDD, 4 FFCCCC, 5 CCCCFF, 6 CCFFCC
+};
+
+const CellStyle kCellStyles[] = {
+    {"normal", 0, 0},
+    {"bold", 1, 0},
+    {"title", 3, 0},
+    {"heading", 2, 2},
+    {"header", 1, 3},
+    {"red", 0, 4},
+    {"blue", 0, 5},
+    {"green", 0, 6},
+    {"alert_heading", 2, 4},
+};
+
+constexpr size_t kCellStyleCount = sizeof(kCellStyles) / sizeof(kCellStyles[0]);
+
+class XlsxWriter : public PackageWriter {
+public:
+    // Ends the current sheet. `widths` are column widths in characters.
+    bool add_sheet(std::string_view requested, const std::vector<double>& widths) {
+        if (!check_open()) {
+            return false;
+        }
+        if (!close_sheet()) {
+            return false;
+        }
+
+        std::string name = unique_sheet_name(requested);
+        sheets.push_back(name);
+        row = 0;
+        std::string part = "xl/worksheets/sheet" + std::to_string(sheets.size()) + ".xml";
+        add_override("/" + part, "application/vnd.openxmlformats-officedocument.spreadsheetml.worksheet+xml");
+        if (!begin_part(part)) {
+            return false;
+        }
+
+        xml += kXmlHeader;
+        xml += "<worksheet xmlns=\"http://schemas.openxmlformats.org/spreadsheetml/2006/main\">";
+        if (!widths.empty()) {
+            xml += "<cols>";
+            char col[96];
+            for (size_t i = 0; i < widths.size(); ++i) {
+                std::snprintf(col, sizeof(col), "<col min=\"%zu\" max=\"%zu\" width=\"%.2f\" customWidth=\"1\"/>",
+                              i + 1, i + 1, widths[i]);
+                xml += col;
+            }
+            xml += "</cols>";
+        }
+        xml += "<sheetData>";
+        sheet_open = true;
+        return true;
+    }
+
+    // Writes the next row; numbering continues across calls
+    bool write_row(const Cell* cells, size_t n) {
+        if (!check_open() || (!sheet_open && !add_sheet("", {}))) {
+            return false;
+        }
+        ++row;
+        ++rows_written;
+        std::string index = std::to_string(row);
+        xml += "<row r=\"" + index + "\">";
+        for (size_t i = 0; i < n; ++i) {
+            const Cell& cell = cells[i];
+            if (cell.kind == Cell::EMPTY && cell.style == 0) {
+                continue;
+            }
+            xml += "<c r=\"";
+            append_column(xml, i);
+            xml += index;
+            xml += '"';
+            if (cell.style) {
+                xml += " s=\"" + std::to_string(cell.style) + "\"";
+            }
+            switch (cell.kind) {
+                case Cell::EMPTY:
+                    xml += "/>";
+                    continue;
+                case Cell::TEXT: {
+                    std::string_view text = utf8_prefix(cell.text, kMaxCellBytes);
+                    xml += needs_preserve(text) ? " t=\"inlineStr\"><is><t xml:space=\"preserve\">"
+                                                : " t=\"inlineStr\"><is><t>";
+                    append_escaped(xml, text);
+                    xml += "</t></is></c>";
+                    break;
+                }
+                case Cell::BOOLEAN:
+                    xml += " t=\"b\"><v>";
+                    xml += cell.text;
+                    xml += "</v></c>";
+                    break;
+                case Cell::NUMBER:
+                    xml += "><v>";
+                    xml += cell.text;
+                    xml += "</v></c>";
+                    break;
+            }
+            ++cells_written;
+        }
+        xml += "</row>";
+        return flush_if_full();
+    }
+
+    void skip_rows(size_t n) {
+        row += n;
+    }
+
+    size_t current_row() const {
+        return row;
+    }
+
+    size_t sheet_count() const {
+        return sheets.size();
+    }
+
+    uint64_t rows() const {
+        return rows_written;
+    }
+
+    uint64_t cells() const {
+        return cells_written;
+    }
+
+protected:
+    const char* main_part() const override {
+        return "xl/workbook.xml";
+    }
+
+    bool write_package_parts() override {
+        if (sheets.empty() && !add_sheet("", {})) {
+            return false;  // Excel refuses workbooks without a sheet
+        }
+        if (!close_sheet()) {
+            return false;
+        }
+
+        std::string workbook = kXmlHeader;
+        workbook += std::string("<workbook xmlns=\"http://schemas.openxmlformats.org/spreadsheetml/2006/main\" "
+                                "xmlns:r=\"") + kDocRelNs + "\"><sheets>";
+        std::string rels = kXmlHeader;
+        rels += std::string("<Relationships xmlns=\"") + kRelsNs + "\">";
+        for (size_t i = 0; i < sheets.size(); ++i) {
+            std::string id = std::to_string(i + 1);
+            workbook += "<sheet name=\"";
+            append_escaped(workbook, sheets[i]);
+            workbook += "\" sheetId=\"" + id + "\" r:id=\"rId" + id + "\"/>";
+            rels += "<Relationship Id=\"rId" + id + "\" Type=\"" + kDocRelNs +
+                    "/worksheet\" Target=\"worksheets/sheet" + id + ".xml\"/>";
+        }
+        workbook += "</sheets></workbook>";
+        rels += "<Relationship Id=\"rId" + std::to_string(sheets.size() + 1) + "\" Type=\"" + kDocRelNs +
+                "/styles\" Target=\"styles.xml\"/></Relationships>";
+
+        add_override("/xl/workbook.xml", "application/vnd.openxmlformats-officedocument.spreadsheetml.sheet.main+xml");
+        add_override("/xl/styles.xml", "application/vnd.openxmlformats-officedocument.spreadsheetml.styles+xml");
+        return write_part("xl/workbook.xml", workbook) &&
+               write_part("xl/_rels/workbook.xml.rels", rels) &&
+               write_part("xl/styles.xml", stylesheet());
+    }
+
+private:
+    bool close_sheet() {
+        if (!sheet_open) {
+            return true;
+        }
+        sheet_open = false;
+        xml += "</sheetData></worksheet>";
+        return end_part();
+    }
+
+    static void append_column(std::string& out, size_t index) {
+        char letters[8];
+        int n = 0;
+        for (size_t v = index + 1; v > 0; v = (v - 1) / 26) {
+            letters[n++] = static_cast<char>('A' + (v - 1) % 26);
+        }
+        while (n > 0) {
+            out += letters[--n];
+        }
+    }
+
+    // Sheet names are at most 31 characters, unique ignoring ASCII case,
+    // and cannot contain []:*?/\ or start or end with an apostrophe
+    std::string unique_sheet_name(std::string_view requested) {
+        std::string base;
+        for (char c : requested) {
+            base += std::strchr("[]:*?/\\", c) && c ? '_' : c;
+        }
+        while (!base.empty() && base.front() == '\'') {
+            base.erase(base.begin());
+        }
+        while (!base.empty() && base.back() == '\'') {
+            base.pop_back();
+        }
+        if (base.empty()) {
+            base = "Sheet" + std::to_string(sheets.size() + 1);
+        }
+
+        auto lower = [](std::string s) {
+            for (char& c : s) {
+                c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            }
+            return s;
+        };
+        auto truncate = [](const std::string& s, size_t chars) {
+            size_t at = 0;
+            for (size_t seen = 0; at < s.size(); ++at) {
+                if ((static_cast<unsigned char>(s[at]) & 0xC0) != 0x80 && seen++ == chars) {
+                    break;
+                }
+            }
+            return s.substr(0, at);
+        };
+        auto taken = [&](const std::string& name) {
+            for (const std::string& sheet : sheets) {
+                if (lower(sheet) == lower(name)) {
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        std::string name = truncate(base, 31);
+        for (int n = 1; taken(name); ++n) {
+            std::string suffix = std::to_string(n);
+            name = truncate(base, 31 - suffix.size()) + suffix;
+        }
+        return name;
+    }
+
+    static std::string stylesheet() {
+        std::string xml = kXmlHeader;
+        xml += "<styleSheet xmlns=\"http://schemas.openxmlformats.org/spreadsheetml/2006/main\">"
+               "<fonts count=\"4\">"
+               "<font><sz val=\"11\"/><name val=\"Calibri\"/><family val=\"2\"/></font>"
+               "<font><b/><sz val=\"11\"/><name val=\"Calibri\"/><family val=\"2\"/></font>"
+               "<font><b/><sz val=\"14\"/><name val=\"Calibri\"/><family val=\"2\"/></font>"
+               "<font><b/><sz val=\"16\"/><name val=\"Calibri\"/><family val=\"2\"/></font>"
+               "</fonts><fills count=\"7\">"
+               "<fill><patternFill patternType=\"none\"/></fill>"
+               "<fill><patternFill patternType=\"gray125\"/></fill>";
+        for (const char* color : {"FFCCCCCC", "FFDDDDDD", "FFFFCCCC", "FFCCCCFF", "FFCCFFCC"}) {
+            xml += std::string("<fill><patternFill patternType=\"solid\"><fgColor rgb=\"") + color +
+                   "\"/><bgColor indexed=\"64\"/></patternFill></fill>";
+        }
+        xml += "</fills><borders count=\"1\"><border><left/><right/><top/><bottom/><diagonal/></border></borders>"
+               "<cellStyleXfs count=\"1\"><xf numFmtId=\"0\" fontId=\"0\" fillId=\"0\" borderId=\"0\"/></cellStyleXfs>"
+               "<cellXfs count=\"" + std::to_string(kCellStyleCount) + "\">";
+        for (const CellStyle& style : kCellStyles) {
+            xml += "<xf numFmtId=\"0\" fontId=\"" + std::to_string(style.font) + "\" fillId=\"" +
+                   std::to_string(style.fill) + "\" borderId=\"0\" xfId=\"0\"";
+            xml += style.font ? " applyFont=\"1\"" : "";
+            xml += style.fill ? " applyFill=\"1\"/>" : "/>";
+        }
+        xml += "</cellXfs><cellStyles count=\"1\"><cellStyle name=\"Normal\" xfId=\"0\" builtinId=\"0\"/></cellStyles>"
+               "</styleSheet>";
+        return xml;
+    }
+
+    std::vector<std::string> sheets;
+    bool sheet_open = false;
+    size_t row = 0;
+    uint64_t rows_written = 0;
+    uint64_t cells_written = 0;
+};
+
+const char kWordNs[] = "http://schemas.openxmlformats.org/wordprocessingml/2006/main";
+
+class DocxWriter : public PackageWriter {
+public:
+    // `style` is a paragraph style id (Normal, Title, Heading1-3)
+    bool add_paragraph(std::string_view text, std::string_view style, bool bold) {
+        if (!start_document()) {
+            return false;
+        }
+        xml += "<w:p>";
+        if (!style.empty() && style != "Normal") {
+            xml += "<w:pPr><w:pStyle w:val=\"";
+            append_escaped(xml, style);
+            xml += "\"/></w:pPr>";
+        }
+        append_runs(text, bold);
+        xml += "</w:p>";
+        ++paragraphs_written;
+        last_was_table = false;
+        return flush_if_full();
+    }
+
+    bool add_page_break() {
+        if (!start_document()) {
+            return false;
+        }
+        xml += "<w:p><w:r><w:br w:type=\"page\"/></w:r></w:p>";
+        last_was_table = false;
+        return flush_if_full();
+    }
+
+    // Grid table; rows shorter than the widest are padded with empty cells
+    bool add_table(const std::vector<std::vector<std::string_view>>& rows, bool header) {
+        if (!start_document()) {
+            return false;
+        }
+        size_t columns = 1;
+        for (const auto& cells : rows) {
+            columns = std::max(columns, cells.size());
+        }
+        std::string width = std::to_string(9360 / columns);  // Twips across a letter page's text
+
+        xml += "<w:tbl><w:tblPr><w:tblStyle w:val=\"TableGrid\"/><w:tblW w:w=\"0\" w:type=\"auto\"/>"
+               "<w:tblLook w:val=\"04A0\" w:firstRow=\"1\" w:lastRow=\"0\" w:firstColumn=\"1\" w:lastColumn=\"0\" "
+               "w:noHBand=\"0\" w:noVBand=\"1\"/></w:tblPr><w:tblGrid>";
+        for (size_t c = 0; c < columns; ++c) {
+            xml += "<w:gridCol w:w=\"" + width + "\"/>";
+        }
+        xml += "</w:tblGrid>";
+        for (size_t r = 0; r < rows.size(); ++r) {
+            xml += "<w:tr>";
+            for (size_t c = 0; c < columns; ++c) {
+                xml += "<w:tc><w:tcPr><w:tcW w:w=\"" + width + "\" w:type=\"dxa\"/></w:tcPr><w:p>";
+                if (c < rows[r].size()) {
+                    append_runs(rows[r][c], header && r == 0);
+                }
+                xml += "</w:p></w:tc>";
+            }
+            xml += "</w:tr>";
+            if (!flush_if_full()) {
+                return false;
+            }
+        }
+        xml += "</w:tbl>";
+        ++tables_written;
+        last_was_table = true;
+        return flush_if_full();
+    }
+
+    uint64_t paragraphs() const {
+        return paragraphs_written;
+    }
+
+    uint64_t tables() const {
+        return tables_written;
+    }
+
+protected:
+    const char* main_part() const override {
+        return "word/document.xml";
+    }
+
+    bool write_package_parts() override {
+        if (!start_document()) {
+            return false;
+        }
+        if (last_was_table) {
+            xml += "<w:p/>";  // Word expects a paragraph after a closing table
+        }
+        xml += "<w:sectPr><w:pgSz w:w=\"12240\" w:h=\"15840\"/><w:pgMar w:top=\"1440\" w:right=\"1440\" "
+               "w:bottom=\"1440\" w:left=\"1440\" w:header=\"720\" w:footer=\"720\" w:gutter=\"0\"/></w:sectPr>"
+               "</w:body></w:document>";
+        if (!end_part()) {
+            return false;
+        }
+
+        std::string rels = kXmlHeader;
+        rels += std::string("<Relationships xmlns=\"") + kRelsNs + "\"><Relationship Id=\"rId1\" Type=\"" +
+                kDocRelNs + "/styles\" Target=\"styles.xml\"/></Relationships>";
+        add_override("/word/document.xml", "application/vnd.openxmlformats-officedocument.wordprocessingml.document.main+xml");
+        add_override("/word/styles.xml", "application/vnd.openxmlformats-officedocument.wordprocessingml.styles+xml");
+        return write_part("word/_rels/document.xml.rels", rels) && write_part("word/styles.xml", styles());
+    }
+
+private:
+    // document.xml stays open from the first block to close
+    bool start_document() {
+        if (!check_open()) {
+            return false;
+        }
+        if (started_document) {
+            return true;
+        }
+        started_document = true;
+        if (!begin_part("word/document.xml")) {
+            return false;
+        }
+        xml += kXmlHeader;
+        xml += std::string("<w:document xmlns:w=\"") + kWordNs + "\" xmlns:r=\"" + kDocRelNs + "\"><w:body>";
+        return true;
+    }
+
+    // Newlines become line breaks and tabs tab stops, within one run
+    void append_runs(std::string_view text, bool bold) {
+        xml += bold ? "<w:r><w:rPr><w:b/></w:rPr>" : "<w:r>";
+        size_t start = 0;
+        for (size_t i = 0; i <= text.size(); ++i) {
+            if (i < text.size() && text[i] != '\n' && text[i] != '\t') {
+                continue;
+            }
+            std::string_view piece = text.substr(start, i - start);
+            if (!piece.empty() && piece.back() == '\r') {
+                piece.remove_suffix(1);
+            }
+            if (!piece.empty()) {
+                xml += needs_preserve(piece) ? "<w:t xml:space=\"preserve\">" : "<w:t>";
+                append_escaped(xml, piece);
+                xml += "</w:t>";
+            }
+            if (i < text.size()) {
+                xml += text[i] == '\n' ? "<w:br/>" : "<w:tab/>";
+            }
+            start = i + 1;
+        }
+        xml += "</w:r>";
+    }
+
+    static std::string styles() {
+        std::string xml = kXmlHeader;
+        xml += std::string("<w:styles xmlns:w=\"") + kWordNs + "\">"
+               "<w:docDefaults><w:rPrDefault><w:rPr><w:rFonts w:ascii=\"Calibri\" w:hAnsi=\"Calibri\" "
+               "w:eastAsia=\"Calibri\" w:cs=\"Calibri\"/><w:sz w:val=\"22\"/><w:szCs w:val=\"22\"/>"
+               "<w:lang w:val=\"en-US\"/></w:rPr></w:rPrDefault><w:pPrDefault><w:pPr>"
+               "<w:spacing w:after=\"160\" w:line=\"259\" w:lineRule=\"auto\"/></w:pPr></w:pPrDefault></w:docDefaults>"
+               "<w:style w:type=\"paragraph\" w:default=\"1\" w:styleId=\"Normal\"><w:name w:val=\"Normal\"/><w:qFormat/></w:style>"
+               "<w:style w:type=\"paragraph\" w:styleId=\"Title\"><w:name w:val=\"Title\"/><w:basedOn w:val=\"Normal\"/>"
+               "<w:next w:val=\"Normal\"/><w:qFormat/><w:pPr><w:spacing w:after=\"240\"/><w:jc w:val=\"center\"/></w:pPr>"
+               "<w:rPr><w:sz w:val=\"56\"/><w:szCs w:val=\"56\"/></w:rPr></w:style>";
+        const char* sizes[] = {"32", "26", "24"};
+        for (int level = 1; level <= 3; ++level) {
+            std::string n = std::to_string(level);
+            std::string size = sizes[level - 1];
+            xml += "<w:style w:type=\"paragraph\" w:styleId=\"Heading" + n + "\"><w:name w:val=\"heading " + n + "\"/>"
+                   "<w:basedOn w:val=\"Normal\"/><w:next w:val=\"Normal\"/><w:qFormat/><w:pPr><w:keepNext/>"
+                   "<w:spacing w:before=\"240\" w:after=\"80\"/><w:outlineLvl w:val=\"" + std::to_string(level - 1) + "\"/>"
+                   "</w:pPr><w:rPr><w:b/><w:color w:val=\"2F5496\"/><w:sz w:val=\"" + size + "\"/><w:szCs w:val=\"" +
+                   size + "\"/></w:rPr></w:style>";
+        }
+        xml += "<w:style w:type=\"table\" w:default=\"1\" w:styleId=\"TableNormal\"><w:name w:val=\"Normal Table\"/>"
+               "<w:tblPr><w:tblInd w:w=\"0\" w:type=\"dxa\"/><w:tblCellMar><w:top w:w=\"0\" w:type=\"dxa\"/>"
+               "<w:left w:w=\"108\" w:type=\"dxa\"/><w:bottom w:w=\"0\" w:type=\"dxa\"/><w:right w:w=\"108\" w:type=\"dxa\"/>"
+               "</w:tblCellMar></w:tblPr></w:style>"
+               "<w:style w:type=\"table\" w:styleId=\"TableGrid\"><w:name w:val=\"Table Grid\"/><w:basedOn w:val=\"TableNormal\"/>"
+               "<w:tblPr><w:tblBorders>";
+        for (const char* edge : {"top", "left", "bottom", "right", "insideH", "insideV"}) {
+            xml += std::string("<w:") + edge + " w:val=\"single\" w:sz=\"4\" w:space=\"0\" w:color=\"auto\"/>";
+        }
+        xml += "</w:tblBorders></w:tblPr></w:style></w:styles>";
+        return xml;
+    }
+
+    bool started_document = false;
+    bool last_was_table = false;
+    uint64_t paragraphs_written = 0;
+    uint64_t tables_written = 0;
+};
+
+const char kDrawingNs[] = "http://schemas.openxmlformats.org/drawingml/2006/main";
+const char kPresentationNs[] = "http://schemas.openxmlformats.org/presentationml/2006/main";
+
+// Text run formatting on slides
+struct SlideText {
+    std::string_view text;
+    bool bold = false;
+    int size = 0;       // Hundredths of a point; 0 inherits
+    uint32_t color = 0; // 0xRRGGBB, used when has_color
+    bool has_color = false;
+};
+
+class PptxWriter : public PackageWriter {
+public:
+    // Each slide, with its relationships and notes, is complete when this
+    // returns; `title_layout` uses the centered title and subtitle layout
+    bool add_slide(const SlideText& title, const std::vector<SlideText>& body,
+                   const std::vector<std::string_view>& notes, bool title_layout) {
+        if (!check_open()) {
+            return false;
+        }
+        size_t number = ++slides;
+        std::string n = std::to_string(number);
+        std::string part = "ppt/slides/slide" + n + ".xml";
+        add_override("/" + part, "application/vnd.openxmlformats-officedocument.presentationml.slide+xml");
+        if (!begin_part(part)) {
+            return false;
+        }
+
+        xml += kXmlHeader;
+        xml += std::string("<p:sld xmlns:a=\"") + kDrawingNs + "\" xmlns:r=\"" + kDocRelNs + "\" xmlns:p=\"" +
+               kPresentationNs + "\"><p:cSld><p:spTree>";
+        append_group_header(xml);
+        append_placeholder(xml, 2, "Title 1", title_layout ? "<p:ph type=\"ctrTitle\"/>" : "<p:ph type=\"title\"/>", &title, 1);
+        append_placeholder(xml, 3, title_layout ? "Subtitle 2" : "Content Placeholder 2",
+                           title_layout ? "<p:ph type=\"subTitle\" idx=\"1\"/>" : "<p:ph idx=\"1\"/>",
+                           body.data(), body.size());
+        xml += "</p:spTree></p:cSld><p:clrMapOvr><a:masterClrMapping/></p:clrMapOvr></p:sld>";
+
+        std::string rels = kXmlHeader;
+        rels += std::string("<Relationships xmlns=\"") + kRelsNs + "\"><Relationship Id=\"rId1\" Type=\"" + kDocRelNs +
+                "/slideLayout\" Target=\"../slideLayouts/slideLayout" + (title_layout ? "1" : "2") + ".xml\"/>";
+        if (!notes.empty()) {
+            rels += std::string("<Relationship Id=\"rId2\" Type=\"") + kDocRelNs +
+                    "/notesSlide\" Target=\"../notesSlides/notesSlide" + n + ".xml\"/>";
+        }
+        rels += "</Relationships>";
+        if (!end_part() || !write_part("ppt/slides/_rels/slide" + n + ".xml.rels", rels)) {
+            return false;
+        }
+        return notes.empty() || write_notes(n, notes);
+    }
+
+    uint64_t slide_count() const {
+        return slides;
+    }
+
+    uint64_t notes_count() const {
+        return notes_slides;
+    }
+
+protected:
+    const char* main_part() const override {
+        return "ppt/presentation.xml";
+    }
+
+    bool write_package_parts() override {
+        // Relationship ids: master, theme, slides, then the notes master
+        std::string presentation = kXmlHeader;
+        presentation += std::string("<p:presentation xmlns:a=\"") + kDrawingNs + "\" xmlns:r=\"" + kDocRelNs +
+                        "\" xmlns:p=\"" + kPresentationNs + "\" saveSubsetFonts=\"1\">"
+                        "<p:sldMasterIdLst><p:sldMasterId id=\"2147483648\" r:id=\"rId1\"/></p:sldMasterIdLst>";
+        std::string notes_id = "rId" + std::to_string(slides + 3);
+        if (notes_slides > 0) {
+            presentation += "<p:notesMasterIdLst><p:notesMasterId r:id=\"" + notes_id + "\"/></p:notesMasterIdLst>";
+        }
+        std::string rels = kXmlHeader;
+        rels += std::string("<Relationships xmlns=\"") + kRelsNs + "\">"
+                "<Relationship Id=\"rId1\" Type=\"" + kDocRelNs + "/slideMaster\" Target=\"slideMasters/slideMaster1.xml\"/>"
+                "<Relationship Id=\"rId2\" Type=\"" + kDocRelNs + "/theme\" Target=\"theme/theme1.xml\"/>";
+        if (slides > 0) {
+            presentation += "<p:sldIdLst>";
+            for (uint64_t i = 1; i <= slides; ++i) {
+                std::string id = "rId" + std::to_string(i + 2);
+                presentation += "<p:sldId id=\"" + std::to_string(255 + i) + "\" r:id=\"" + id + "\"/>";
+                rels += "<Relationship Id=\"" + id + "\" Type=\"" + kDocRelNs + "/slide\" Target=\"slides/slide" +
+                        std::to_string(i) + ".xml\"/>";
+            }
+            presentation += "</p:sldIdLst>";
+        }
+        if (notes_slides > 0) {
+            rels += "<Relationship Id=\"" + notes_id + "\" Type=\"" + kDocRelNs +
+                    "/notesMaster\" Target=\"notesMasters/notesMaster1.xml\"/>";
+        }
+        presentation += "<p:sldSz cx=\"9144000\" cy=\"6858000\" type=\"screen4x3\"/><p:notesSz cx=\"6858000\" cy=\"9144000\"/>"
+                        "</p:presentation>";
+        rels += "</Relationships>";
+
+        add_override("/ppt/presentation.xml", "application/vnd.openxmlformats-officedocument.presentationml.presentation.main+xml");
+        add_override("/ppt/slideMasters/slideMaster1.xml", "application/vnd.openxmlformats-officedocument.presentationml.slideMaster+xml");
+        add_override("/ppt/slideLayouts/slideLayout1.xml", "application/vnd.openxmlformats-officedocument.presentationml.slideLayout+xml");
+        add_override("/ppt/slideLayouts/slideLayout2.xml", "application/vnd.openxmlformats-officedocument.presentationml.slideLayout+xml");
+        add_override("/ppt/theme/theme1.xml", "application/vnd.openxmlformats-officedocument.theme+xml");
+        bool ok = write_part("ppt/presentation.xml", presentation) &&
+                  write_part("ppt/_rels/presentation.xml.rels", rels) &&
+                  write_part("ppt/slideMasters/slideMaster1.xml", slide_master()) &&
+                  write_part("ppt/slideMasters/_rels/slideMaster1.xml.rels", relationships({
+                      {"slideLayout", "../slideLayouts/slideLayout1.xml"},
+                      {"slideLayout", "../slideLayouts/slideLayout2.xml"},
+                      {"theme", "../theme/theme1.xml"}})) &&
+                  write_part("ppt/slideLayouts/slideLayout1.xml", slide_layout(true)) &&
+                  write_part("ppt/slideLayouts/_rels/slideLayout1.xml.rels", relationships({{"slideMaster", "../slideMasters/slideMaster1.xml"}})) &&
+                  write_part("ppt/slideLayouts/slideLayout2.xml", slide_layout(false)) &&
+                  write_part("ppt/slideLayouts/_rels/slideLayout2.xml.rels", relationships({{"slideMaster", "../slideMasters/slideMaster1.xml"}})) &&
+                  write_part("ppt/theme/theme1.xml", theme());
+        if (!ok || notes_slides == 0) {
+            return ok;
+        }
+
+        // The notes master needs a theme of its own
+        add_override("/ppt/notesMasters/notesMaster1.xml", "application/vnd.openxmlformats-officedocument.presentationml.notesMaster+xml");
+        add_override("/ppt/theme/theme2.xml", "application/vnd.openxmlformats-officedocument.theme+xml");
+        std::string master = kXmlHeader;
+        master += std::string("<p:notesMaster xmlns:a=\"") + kDrawingNs + "\" xmlns:r=\"" + kDocRelNs + "\" xmlns:p=\"" +
+                  kPresentationNs + "\"><p:cSld><p:spTree>";
+        append_group_header(master);
+        master += "<p:sp><p:nvSpPr><p:cNvPr id=\"2\" name=\"Notes Placeholder 1\"/><p:cNvSpPr><a:spLocks noGrp=\"1\"/></p:cNvSpPr>"
+                  "<p:nvPr><p:ph type=\"body\" idx=\"1\"/></p:nvPr></p:nvSpPr><p:spPr><a:xfrm><a:off x=\"685800\" y=\"4343400\"/>"
+                  "<a:ext cx=\"5486400\" cy=\"4114800\"/></a:xfrm><a:prstGeom prst=\"rect\"><a:avLst/></a:prstGeom></p:spPr>"
+                  "<p:txBody><a:bodyPr/><a:lstStyle/><a:p><a:endParaRPr lang=\"en-US\"/></a:p></p:txBody></p:sp>"
+                  "</p:spTree></p:cSld>";
+        master += color_map();
+        master += "</p:notesMaster>";
+        return write_part("ppt/notesMasters/notesMaster1.xml", master) &&
+               write_part("ppt/notesMasters/_rels/notesMaster1.xml.rels", relationships({{"theme", "../theme/theme2.xml"}})) &&
+               write_part("ppt/theme/theme2.xml", theme());
+    }
+
+private:
+    bool write_notes(const std::string& n, const std::vector<std::string_view>& notes) {
+        ++notes_slides;
+        std::string part = "ppt/notesSlides/notesSlide" + n + ".xml";
+        add_override("/" + part, "application/vnd.openxmlformats-officedocument.presentationml.notesSlide+xml");
+        if (!begin_part(part)) {
+            return false;
+        }
+        xml += kXmlHeader;
+        xml += std::string("<p:notes xmlns:a=\"") + kDrawingNs + "\" xmlns:r=\"" + kDocRelNs + "\" xmlns:p=\"" +
+               kPresentationNs + "\"><p:cSld><p:spTree>";
+        append_group_header(xml);
+        std::vector<SlideText> lines;
+        for (std::string_view line : notes) {
+            lines.push_back(SlideText{line});
+        }
+        append_placeholder(xml, 2, "Notes Placeholder 1", "<p:ph type=\"body\" idx=\"1\"/>", lines.data(), lines.size());
+        xml += "</p:spTree></p:cSld><p:clrMapOvr><a:masterClrMapping/></p:clrMapOvr></p:notes>";
+        return end_part() &&
+               write_part("ppt/notesSlides/_rels/notesSlide" + n + ".xml.rels", relationships({
+                   {"notesMaster", "../notesMasters/notesMaster1.xml"},
+                   {"slide", "../slides/slide" + n + ".xml"}}));
+    }
+
+    static std::string relationships(const std::vector<std::pair<const char*, std::string>>& targets) {
+        std::string rels = kXmlHeader;
+        rels += std::string("<Relationships xmlns=\"") + kRelsNs + "\">";
+        for (size_t i = 0; i < targets.size(); ++i) {
+            rels += "<Relationship Id=\"rId" + std::to_string(i + 1) + "\" Type=\"" + kDocRelNs + "/" +
+                    targets[i].first + "\" Target=\"" + targets[i].second + "\"/>";
+        }
+        rels += "</Relationships>";
+        return rels;
+    }
+
+    static void append_group_header(std::string& out) {
+        out += "<p:nvGrpSpPr><p:cNvPr id=\"1\" name=\"\"/><p:cNvGrpSpPr/><p:nvPr/></p:nvGrpSpPr>"
+               "<p:grpSpPr><a:xfrm><a:off x=\"0\" y=\"0\"/><a:ext cx=\"0\" cy=\"0\"/><a:chOff x=\"0\" y=\"0\"/>"
+               "<a:chExt cx=\"0\" cy=\"0\"/></a:xfrm></p:grpSpPr>";
+    }
+
+    // Placeholder shape positioned by its layout, one paragraph per item
+    static void append_placeholder(std::string& out, int id, const char* name, const char* placeholder,
+                                   const SlideText* paragraphs, size_t n) {
+        out += "<p:sp><p:nvSpPr><p:cNvPr id=\"" + std::to_string(id) + "\" name=\"" + name + "\"/>"
+               "<p:cNvSpPr><a:spLocks noGrp=\"1\"/></p:cNvSpPr><p:nvPr>" + placeholder + "</p:nvPr></p:nvSpPr>"
+               "<p:spPr/><p:txBody><a:bodyPr/><a:lstStyle/>";
+        if (n == 0) {
+            out += "<a:p><a:endParaRPr lang=\"en-US\"/></a:p>";
+        }
+        for (size_t i = 0; i < n; ++i) {
+            const SlideText& paragraph = paragraphs[i];
+            std::string properties = "<a:rPr lang=\"en-US\"";
+            if (paragraph.size > 0) {
+                properties += " sz=\"" + std::to_string(paragraph.size) + "\"";
+            }
+            if (paragraph.bold) {
+                properties += " b=\"1\"";
+            }
+            properties += " dirty=\"0\"";
+            if (paragraph.has_color) {
+                char color[64];
+                std::snprintf(color, sizeof(color), "><a:solidFill><a:srgbClr val=\"%06X\"/></a:solidFill></a:rPr>",
+                              static_cast<unsigned>(paragraph.color & 0xFFFFFF));
+                properties += color;
+            } else {
+                properties += "/>";
+            }
+
+            // Lines within a paragraph are joined by soft breaks
+            out += "<a:p>";
+            std::string_view text = paragraph.text;
+            size_t start = 0;
+            for (size_t k = 0; k <= text.size(); ++k) {
+                if (k < text.size() && text[k] != '\n') {
+                    continue;
+                }
+                std::string_view line = text.substr(start, k - start);
+                if (!line.empty() && line.back() == '\r') {
+                    line.remove_suffix(1);
+                }
+                if (start > 0) {
+                    out += "<a:br>" + properties + "</a:br>";
+                }
+                out += "<a:r>" + properties + "<a:t>";
+                append_escaped(out, line);
+                out += "</a:t></a:r>";
+                start = k + 1;
+            }
+            out += "</a:p>";
+        }
+        out += "</p:txBody></p:sp>";
+    }
+
+    static const char* color_map() {
+        return "<p:clrMap bg1=\"lt1\" tx1=\"dk1\" bg2=\"lt2\" tx2=\"dk2\" accent1=\"accent1\" accent2=\"accent2\" "
+               "accent3=\"accent3\" accent4=\"accent4\" accent5=\"accent5\" accent6=\"accent6\" hlink=\"hlink\" "
+               "folHlink=\"folHlink\"/>";
+    }
+
+    static std::string frame(const char* x, const char* y, const char* cx, const char* cy) {
+        return std::string("<p:spPr><a:xfrm><a:off x=\"") + x + "\" y=\"" + y + "\"/><a:ext cx=\"" + cx + "\" cy=\"" + cy +
+               "\"/></a:xfrm><a:prstGeom prst=\"rect\"><a:avLst/></a:prstGeom></p:spPr>";
+    }
+
+    static std::string slide_master() {
+        std::string xml = kXmlHeader;
+        xml += std::string("<p:sldMaster xmlns:a=\"") + kDrawingNs + "\" xmlns:r=\"" + kDocRelNs + "\" xmlns:p=\"" +
+               kPresentationNs + "\"><p:cSld><p:bg><p:bgRef idx=\"1001\"><a:schemeClr val=\"bg1\"/></p:bgRef></p:bg><p:spTree>";
+        append_group_header(xml);
+        xml += "<p:sp><p:nvSpPr><p:cNvPr id=\"2\" name=\"Title Placeholder 1\"/><p:cNvSpPr><a:spLocks noGrp=\"1\"/></p:cNvSpPr>"
+               "<p:nvPr><p:ph type=\"title\"/></p:nvPr></p:nvSpPr>" + frame("457200", "274638", "8229600", "1143000") +
+               "<p:txBody><a:bodyPr anchor=\"ctr\"/><a:lstStyle/><a:p><a:endParaRPr lang=\"en-US\"/></a:p></p:txBody></p:sp>"
+               "<p:sp><p:nvSpPr><p:cNvPr id=\"3\" name=\"Text Placeholder 2\"/><p:cNvSpPr><a:spLocks noGrp=\"1\"/></p:cNvSpPr>"
+               "<p:nvPr><p:ph type=\"body\" idx=\"1\"/></p:nvPr></p:nvSpPr>" + frame("457200", "1600200", "8229600", "4525963") +
+               "<p:txBody><a:bodyPr/><a:lstStyle/><a:p><a:endParaRPr lang=\"en-US\"/></a:p></p:txBody></p:sp>"
+               "</p:spTree></p:cSld>";
+        xml += color_map();
+        xml += "<p:sldLayoutIdLst><p:sldLayoutId id=\"2147483649\" r:id=\"rId1\"/><p:sldLayoutId id=\"2147483650\" r:id=\"rId2\"/>"
+               "</p:sldLayoutIdLst><p:txStyles>"
+               "<p:titleStyle><a:lvl1pPr algn=\"ctr\"><a:defRPr sz=\"4400\"><a:solidFill><a:schemeClr val=\"tx1\"/></a:solidFill>"
+               "<a:latin typeface=\"+mj-lt\"/><a:ea typeface=\"+mj-ea\"/><a:cs typeface=\"+mj-cs\"/></a:defRPr></a:lvl1pPr></p:titleStyle>"
+               "<p:bodyStyle><a:lvl1pPr marL=\"342900\" indent=\"-342900\"><a:buFont typeface=\"Arial\"/><a:buChar char=\"&#8226;\"/>"
+               "<a:defRPr sz=\"3200\"><a:solidFill><a:schemeClr val=\"tx1\"/></a:solidFill><a:latin typeface=\"+mn-lt\"/>"
+               "<a:ea typeface=\"+mn-ea\"/><a:cs typeface=\"+mn-cs\"/></a:defRPr></a:lvl1pPr></p:bodyStyle>"
+               "<p:otherStyle><a:defPPr><a:defRPr lang=\"en-US\"/></a:defPPr></p:otherStyle></p:txStyles></p:sldMaster>";
+        return xml;
+    }
+
+    static std::string slide_layout(bool title_slide) {
+        std::string xml = kXmlHeader;
+        xml += std::string("<p:sldLayout xmlns:a=\"") + kDrawingNs + "\" xmlns:r=\"" + kDocRelNs + "\" xmlns:p=\"" +
+               kPresentationNs + "\" type=\"" + (title_slide ? "title" : "obj") + "\" preserve=\"1\"><p:cSld name=\"" +
+               (title_slide ? "Title Slide" : "Title and Content") + "\"><p:spTree>";
+        append_group_header(xml);
+        const char* empty_body = "<p:txBody><a:bodyPr/><a:lstStyle/><a:p><a:endParaRPr lang=\"en-US\"/></a:p></p:txBody></p:sp>";
+        if (title_slide) {
+            xml += "<p:sp><p:nvSpPr><p:cNvPr id=\"2\" name=\"Title 1\"/><p:cNvSpPr><a:spLocks noGrp=\"1\"/></p:cNvSpPr>"
+                   "<p:nvPr><p:ph type=\"ctrTitle\"/></p:nvPr></p:nvSpPr>" + frame("685800", "2130425", "7772400", "1470025") +
+                   empty_body +
+                   "<p:sp><p:nvSpPr><p:cNvPr id=\"3\" name=\"Subtitle 2\"/><p:cNvSpPr><a:spLocks noGrp=\"1\"/></p:cNvSpPr>"
+                   "<p:nvPr><p:ph type=\"subTitle\" idx=\"1\"/></p:nvPr></p:nvSpPr>" + frame("1371600", "3886200", "6400800", "1752600") +
+                   "<p:txBody><a:bodyPr/><a:lstStyle><a:lvl1pPr marL=\"0\" indent=\"0\" algn=\"ctr\"><a:buNone/></a:lvl1pPr>"
+                   "</a:lstStyle><a:p><a:endParaRPr lang=\"en-US\"/></a:p></p:txBody></p:sp>";
+        } else {
+            xml += std::string("<p:sp><p:nvSpPr><p:cNvPr id=\"2\" name=\"Title 1\"/><p:cNvSpPr><a:spLocks noGrp=\"1\"/></p:cNvSpPr>"
+                   "<p:nvPr><p:ph type=\"title\"/></p:nvPr></p:nvSpPr><p:spPr/>") + empty_body +
+                   "<p:sp><p:nvSpPr><p:cNvPr id=\"3\" name=\"Content Placeholder 2\"/><p:cNvSpPr><a:spLocks noGrp=\"1\"/></p:cNvSpPr>"
+                   "<p:nvPr><p:ph idx=\"1\"/></p:nvPr></p:nvSpPr><p:spPr/>" + empty_body;
+        }
+        xml += "</p:spTree></p:cSld><p:clrMapOvr><a:masterClrMapping/></p:clrMapOvr></p:sldLayout>";
+        return xml;
+    }
+
+    static std::string theme() {
+        std::string xml = kXmlHeader;
+        xml += std::string("<a:theme xmlns:a=\"") + kDrawingNs + "\" name=\"Office Theme\"><a:themeElements>"
+               "<a:clrScheme name=\"Office\"><a:dk1><a:sysClr val=\"windowText\" lastClr=\"000000\"/></a:dk1>"
+               "<a:lt1><a:sysClr val=\"window\" lastClr=\"FFFFFF\"/></a:lt1>";
+        const std::pair<const char*, const char*> colors[] = {
+            {"dk2", "1F497D"}, {"lt2", "EEECE1"}, {"accent1", "4F81BD"}, {"accent2", "C0504D"},
+            {"accent3", "9BBB59"}, {"accent4", "8064A2"}, {"accent5", "4BACC6"}, {"accent6", "F79646"},
+            {"hlink", "0000FF"}, {"folHlink", "800080"}};
+        for (const auto& color : colors) {
+            xml += std::string("<a:") + color.first + "><a:srgbClr val=\"" + color.second + "\"/></a:" + color.first + ">";
+        }
+        xml += "</a:clrScheme><a:fontScheme name=\"Office\">"
+               "<a:majorFont><a:latin typeface=\"Calibri\"/><a:ea typeface=\"\"/><a:cs typeface=\"\"/></a:majorFont>"
+               "<a:minorFont><a:latin typeface=\"Calibri\"/><a:ea typeface=\"\"/><a:cs typeface=\"\"/></a:minorFont>"
+               "</a:fontScheme><a:fmtScheme name=\"Office\">";
+        const char* fill = "<a:solidFill><a:schemeClr val=\"phClr\"/></a:solidFill>";
+        std::string fills = std::string(fill) + fill + fill;
+        xml += "<a:fillStyleLst>" + fills + "</a:fillStyleLst><a:lnStyleLst>";
+        for (const char* width : {"9525", "25400", "38100"}) {
+            xml += std::string("<a:ln w=\"") + width + "\">" + fill + "</a:ln>";
+        }
+        xml += "</a:lnStyleLst><a:effectStyleLst>";
+        for (int i = 0; i < 3; ++i) {
+            xml += "<a:effectStyle><a:effectLst/></a:effectStyle>";
+        }
+        xml += "</a:effectStyleLst><a:bgFillStyleLst>" + fills + "</a:bgFillStyleLst></a:fmtScheme>"
+               "</a:themeElements><a:objectDefaults/><a:extraClrSchemeLst/></a:theme>";
+        return xml;
+    }
+
+    uint64_t slides = 0;
+    uint64_t notes_slides = 0;
+};
+
+}  // namespace
+
+// Python wrappers. Arguments are converted into views onto the argument
+// objects while the GIL is held; the XML, deflate and file writes then run
+// with it released, under the writer's mutex.
+
+typedef struct {
+    PyObject_HEAD
+    PackageWriter* writer;
+    const char* kind;
+    PyObject* close_stats;  // What close() returned, for repeated calls
+} PyOoxmlWriter;
+
+static PyTypeObject PyXlsxWriterType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+static PyTypeObject PyDocxWriterType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+static PyTypeObject PyPptxWriterType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+// Trace span for each writer call, close included
+static const char* span_name(const char* kind) {
+    if (kind == std::string_view("xlsx")) {
+        return "ooxml.xlsx";
+    }
+    return kind == std::string_view("docx") ? "ooxml.docx" : "ooxml.pptx";
+}
+
+// Run `work` on the writer without the GIL; raises OSError with the
+// writer's error if it fails
+template <typename Writer, typename Work>
+static bool run_unlocked(PyOoxmlWriter* self, Work&& work) {
+    if (!self->writer) {
+        PyErr_SetString(PyExc_RuntimeError, "Writer not initialized");
+        return false;
+    }
+    Writer* writer = static_cast<Writer*>(self->writer);
+    bool ok;
+    std::string error;
+    Py_BEGIN_ALLOW_THREADS
+    {
+        tracing::Span span(tracing::DOCUMENTS, span_name(self->kind));
+        std::lock_guard<std::mutex> lock(writer->mutex);
+        ok = work(*writer);
+        if (!ok) {
+            error = writer->error;
+        }
+    }
+    Py_END_ALLOW_THREADS
+
+    if (!ok) {
+        PyErr_SetString(error == "Writer is closed" ? PyExc_ValueError : PyExc_OSError, error.c_str());
+    }
+    return ok;
+}
+
+static bool text_view(PyObject* obj, std::string_view& text, const char* what) {
+    const char* data;
+    Py_ssize_t size;
+    if (PyUnicode_Check(obj) || PyBytes_Check(obj)) {
+        if (!credential_bytes(obj, data, size)) {
+            return false;
+        }
+        text = std::string_view(data, static_cast<size_t>(size));
+        return true;
+    }
+    PyErr_Format(PyExc_TypeError, "%s must be str or bytes", what);
+    return false;
+}
+
+static bool parse_package_options(PyObject* options_obj, PackageOptions& options) {
+    if (!options_obj || options_obj == Py_None) {
+        return true;
+    }
+    if (!PyDict_Check(options_obj)) {
+        PyErr_SetString(PyExc_TypeError, "options must be a dict");
+        return false;
+    }
+
+    PyObject* key;
+    PyObject* value;
+    Py_ssize_t pos = 0;
+    while (PyDict_Next(options_obj, &pos, &key, &value)) {
+        const char* name = PyUnicode_Check(key) ? PyUnicode_AsUTF8(key) : nullptr;
+        if (!name) {
+            PyErr_SetString(PyExc_TypeError, "Option names must be strings");
+            return false;
+        }
+
+        std::string_view text;
+        if (std::strcmp(name, "compression") == 0) {
+            long level = PyLong_AsLong(value);
+            if (level == -1 && PyErr_Occurred()) {
+                return false;
+            }
+            if (level < 0 || level > 9) {
+                PyErr_SetString(PyExc_ValueError, "compression must be between 0 and 9");
+                return false;
+            }
+            options.compression = static_cast<int>(level);
+        } else if (std::strcmp(name, "title") == 0) {
+            if (!text_view(value, text, "title")) {
+                return false;
+            }
+            options.title.assign(text);
+        } else if (std::strcmp(name, "creator") == 0) {
+            if (!text_view(value, text, "creator")) {
+                return false;
+            }
+            options.creator.assign(text);
+        } else {
+            PyErr_Format(PyExc_ValueError, "Unknown writer option: %s", name);
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename Writer>
+static int writer_init(PyOoxmlWriter* self, PyObject* args, PyObject* kwargs, const char* kind) {
+    static const char* kwlist[] = {"path", "options", nullptr};
+    PyObject* path_obj;
+    PyObject* options_obj = nullptr;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|O", const_cast<char**>(kwlist), &path_obj, &options_obj)) {
+        return -1;
+    }
+
+    PackageOptions options;
+    PyObject* encoded;
+    if (!parse_package_options(options_obj, options) || !PyUnicode_FSConverter(path_obj, &encoded)) {
+        return -1;
+    }
+    std::string path(PyBytes_AS_STRING(encoded), PyBytes_GET_SIZE(encoded));
+    Py_DECREF(encoded);
+
+    Writer* writer = new Writer();
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS
+    ok = writer->open(path, options);
+    Py_END_ALLOW_THREADS
+    if (!ok) {
+        PyErr_SetString(PyExc_OSError, writer->error.c_str());
+        delete writer;
+        return -1;
+    }
+
+    delete self->writer;
+    self->writer = writer;
+    self->kind = kind;
+    Py_CLEAR(self->close_stats);
+    return 0;
+}
+
+static void writer_dealloc(PyOoxmlWriter* self) {
+    // Dropped without close(): the package is incomplete, so remove it
+    if (self->writer) {
+        PackageWriter* writer = self->writer;
+        Py_BEGIN_ALLOW_THREADS
+        {
+            std::lock_guard<std::mutex> lock(writer->mutex);
+            if (!writer->is_closed()) {
+                writer->abort();
+            }
+        }
+        Py_END_ALLOW_THREADS
+        delete writer;
+    }
+    Py_XDECREF(self->close_stats);
+    Py_TYPE(self)->tp_free(reinterpret_cast<PyObject*>(self));
+}
+
+// Closing again returns the first close()'s stats, or None after abort()
+static PyObject* writer_close(PyOoxmlWriter* self, PyObject* args) {
+    if (self->close_stats) {
+        return Py_NewRef(self->close_stats);
+    }
+
+    struct {
+        uint64_t parts, bytes_in, bytes_out, a, b;
+        double seconds;
+    } stats = {};
+    const char* kind = self->kind;
+    bool aborted = false;
+
+    bool ok = run_unlocked<PackageWriter>(self, [&](PackageWriter& writer) {
+        if (writer.is_closed()) {
+            aborted = true;
+            return true;
+        }
+        if (!writer.close()) {
+            return false;
+        }
+        stats.parts = writer.archive().parts();
+        stats.bytes_in = writer.archive().bytes_in();
+        stats.bytes_out = writer.archive().bytes_out();
+        stats.seconds = writer.elapsed();
+        if (kind == std::string_view("xlsx")) {
+            auto& xlsx = static_cast<XlsxWriter&>(writer);
+            stats.a = xlsx.sheet_count();
+            stats.b = xlsx.rows();
+        } else if (kind == std::string_view("docx")) {
+            auto& docx = static_cast<DocxWriter&>(writer);
+            stats.a = docx.paragraphs();
+            stats.b = docx.tables();
+        } else {
+            auto& pptx = static_cast<PptxWriter&>(writer);
+            stats.a = pptx.slide_count();
+            stats.b = pptx.notes_count();
+        }
+        return true;
+    });
+    if (!ok) {
+        return nullptr;
+    }
+    if (aborted) {
+        Py_RETURN_NONE;
+    }
+
+    const char* first = "sheets";
+    const char* second = "rows";
+    if (kind == std::string_view("docx")) {
+        first = "paragraphs";
+        second = "tables";
+    } else if (kind == std::string_view("pptx")) {
+        first = "slides";
+        second = "notes";
+    }
+    self->close_stats = Py_BuildValue("{s:K,s:K,s:K,s:d,s:d,s:K,s:K}",
+                                      "parts", static_cast<unsigned long long>(stats.parts),
+                                      "xml_bytes", static_cast<unsigned long long>(stats.bytes_in),
+                                      "file_size", static_cast<unsigned long long>(stats.bytes_out),
+                                      "compression_ratio", stats.bytes_out ? static_cast<double>(stats.bytes_in) / stats.bytes_out : 0.0,
+                                      "seconds", stats.seconds,
+                                      first, static_cast<unsigned long long>(stats.a),
+                                      second, static_cast<unsigned long long>(stats.b));
+    return Py_XNewRef(self->close_stats);
+}
+
+static PyObject* writer_abort(PyOoxmlWriter* self, PyObject* args) {
+    if (!run_unlocked<PackageWriter>(self, [](PackageWriter& writer) {
+            writer.abort();
+            return true;
+        })) {
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject* writer_enter(PyOoxmlWriter* self, PyObject* args) {
+    return Py_NewRef(reinterpret_cast<PyObject*>(self));
+}
+
+// Closes on normal exit; an exception discards the unfinished package
+static PyObject* writer_exit(PyOoxmlWriter* self, PyObject* args) {
+    PyObject* type;
+    PyObject* value;
+    PyObject* traceback;
+    if (!PyArg_ParseTuple(args, "OOO", &type, &value, &traceback)) {
+        return nullptr;
+    }
+
+    bool closed = false;
+    if (self->writer) {
+        std::lock_guard<std::mutex> lock(self->writer->mutex);
+        closed = self->writer->is_closed();
+    }
+    if (type != Py_None) {
+        PyObject* result = closed ? Py_NewRef(Py_None) : writer_abort(self, nullptr);
+        if (!result) {
+            return nullptr;
+        }
+        Py_DECREF(result);
+        Py_RETURN_FALSE;
+    }
+    if (!closed) {
+        PyObject* stats = writer_close(self, nullptr);
+        if (!stats) {
+            return nullptr;
+        }
+        Py_DECREF(stats);
+    }
+    Py_RETURN_FALSE;
+}
+
+#define WRITER_COMMON_METHODS \
+    {"close", reinterpret_cast<PyCFunction>(writer_close), METH_NOARGS, "Write the remaining parts and the zip directory; returns size and timing stats (the same ones if called again)"}, \
+    {"abort", reinterpret_cast<PyCFunction>(writer_abort), METH_NOARGS, "Stop writing and remove the unfinished file"}, \
+    {"__enter__", reinterpret_cast<PyCFunction>(writer_enter), METH_NOARGS, nullptr}, \
+    {"__exit__", reinterpret_cast<PyCFunction>(writer_exit), METH_VARARGS, nullptr}
+
+// A cell style: index or name from kCellStyles
+static bool parse_cell_style(PyObject* obj, uint8_t& style) {
+    if (PyLong_Check(obj)) {
+        long index = PyLong_AsLong(obj);
+        if (index < 0 || static_cast<size_t>(index) >= kCellStyleCount) {
+            PyErr_Format(PyExc_ValueError, "Cell style index out of range: %ld", index);
+            return false;
+        }
+        style = static_cast<uint8_t>(index);
+        return true;
+    }
+    const char* name = PyUnicode_Check(obj) ? PyUnicode_AsUTF8(obj) : nullptr;
+    if (!name) {
+        PyErr_SetString(PyExc_TypeError, "Cell styles must be names or indexes");
+        return false;
+    }
+    for (size_t i = 0; i < kCellStyleCount; ++i) {
+        if (std::strcmp(kCellStyles[i].name, name) == 0) {
+            style = static_cast<uint8_t>(i);
+            return true;
+        }
+    }
+    PyErr_Format(PyExc_ValueError, "Unknown cell style: %s", name);
+    return false;
+}
+
+// Styles for a row: None, one style for every cell, or one per cell
+class RowStyles {
+public:
+    bool parse(PyObject* obj) {
+        if (!obj || obj == Py_None) {
+            return true;
+        }
+        if (PyLong_Check(obj) || PyUnicode_Check(obj)) {
+            uniform = true;
+            styles.resize(1);
+            return parse_cell_style(obj, styles[0]);
+        }
+        PyObject* seq = PySequence_Fast(obj, "style must be a name, an index or a sequence of them");
+        if (!seq) {
+            return false;
+        }
+        styles.resize(PySequence_Fast_GET_SIZE(seq));
+        for (size_t i = 0; i < styles.size(); ++i) {
+            PyObject* item = PySequence_Fast_GET_ITEM(seq, i);
+            if (item != Py_None && !parse_cell_style(item, styles[i])) {
+                Py_DECREF(seq);
+                return false;
+            }
+        }
+        Py_DECREF(seq);
+        return true;
+    }
+
+    uint8_t operator[](size_t column) const {
+        if (uniform) {
+            return styles[0];
+        }
+        return column < styles.size() ? styles[column] : 0;
+    }
+
+private:
+    bool uniform = false;
+    std::vector<uint8_t> styles;
+};
+
+// Cells of one row. Views point into the items of `seq` or into `numbers`,
+// which is sized up front so it never reallocates.
+class RowCells {
+public:
+    RowCells() = default;
+    RowCells(const RowCells&) = delete;
+    RowCells& operator=(const RowCells&) = delete;
+
+    ~RowCells() {
+        Py_XDECREF(seq);
+    }
+
+    bool parse(PyObject* values) {
+        seq = PySequence_Fast(values, "row values must be a sequence");
+        if (!seq) {
+            return false;
+        }
+        Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+        cells.resize(n);
+        numbers.reserve(n);
+        for (Py_ssize_t i = 0; i < n; ++i) {
+            if (!parse_cell(PySequence_Fast_GET_ITEM(seq, i), cells[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void apply(const RowStyles& styles, size_t first_column = 0) {
+        for (size_t i = 0; i < cells.size(); ++i) {
+            cells[i].style = styles[first_column + i];
+        }
+    }
+
+    std::vector<Cell> cells;
+
+private:
+    bool parse_cell(PyObject* value, Cell& cell) {
+        if (value == Py_None) {
+            cell.kind = Cell::EMPTY;
+            return true;
+        }
+        if (PyBool_Check(value)) {
+            cell.kind = Cell::BOOLEAN;
+            cell.text = value == Py_True ? "1" : "0";
+            return true;
+        }
+        if (PyLong_Check(value)) {
+            PyObject* text = PyObject_Str(value);
+            if (!text) {
+                return false;
+            }
+            numbers.emplace_back(PyUnicode_AsUTF8(text));
+            Py_DECREF(text);
+            cell.kind = Cell::NUMBER;
+            cell.text = numbers.back();
+            return true;
+        }
+        if (PyFloat_Check(value)) {
+            // A cell's xsd:double cannot be inf or nan; those become text
+            double number = PyFloat_AS_DOUBLE(value);
+            char* repr = PyOS_double_to_string(number, 'r', 0, 0, nullptr);
+            if (!repr) {
+                return false;
+            }
+            numbers.emplace_back(repr);
+            PyMem_Free(repr);
+            cell.kind = std::isfinite(number) ? Cell::NUMBER : Cell::TEXT;
+            cell.text = numbers.back();
+            return true;
+        }
+        cell.kind = Cell::TEXT;
+        return text_view(value, cell.text, "Cell values");
+    }
+
+    PyObject* seq = nullptr;
+    std::vector<std::string> numbers;
+};
+
+static int xlsx_writer_init(PyOoxmlWriter* self, PyObject* args, PyObject* kwargs) {
+    return writer_init<XlsxWriter>(self, args, kwargs, "xlsx");
+}
+
+static PyObject* xlsx_add_sheet(PyOoxmlWriter* self, PyObject* args, PyObject* kwargs) {
+    static const char* kwlist[] = {"name", "widths", nullptr};
+    PyObject* name_obj;
+    PyObject* widths_obj = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|O", const_cast<char**>(kwlist), &name_obj, &widths_obj)) {
+        return nullptr;
+    }
+    std::string_view name;
+    if (!text_view(name_obj, name, "Sheet names")) {
+        return nullptr;
+    }
+
+    std::vector<double> widths;
+    if (widths_obj != Py_None) {
+        PyObject* seq = PySequence_Fast(widths_obj, "widths must be a sequence of numbers");
+        if (!seq) {
+            return nullptr;
+        }
+        for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(seq); ++i) {
+            widths.push_back(PyFloat_AsDouble(PySequence_Fast_GET_ITEM(seq, i)));
+        }
+        Py_DECREF(seq);
+        if (PyErr_Occurred()) {
+            return nullptr;
+        }
+    }
+
+    size_t sheet = 0;
+    if (!run_unlocked<XlsxWriter>(self, [&](XlsxWriter& writer) {
+            bool ok = writer.add_sheet(name, widths);
+            sheet = writer.sheet_count();
+            return ok;
+        })) {
+        return nullptr;
+    }
+    return PyLong_FromSize_t(sheet);
+}
+
+static PyObject* xlsx_write_row(PyOoxmlWriter* self, PyObject* args, PyObject* kwargs) {
+    static const char* kwlist[] = {"values", "style", nullptr};
+    PyObject* values;
+    PyObject* style_obj = nullptr;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|O", const_cast<char**>(kwlist), &values, &style_obj)) {
+        return nullptr;
+    }
+    RowCells row;
+    RowStyles styles;
+    if (!row.parse(values) || !styles.parse(style_obj)) {
+        return nullptr;
+    }
+    row.apply(styles);
+
+    size_t number = 0;
+    if (!run_unlocked<XlsxWriter>(self, [&](XlsxWriter& writer) {
+            bool ok = writer.write_row(row.cells.data(), row.cells.size());
+            number = writer.current_row();
+            return ok;
+        })) {
+        return nullptr;
+    }
+    return PyLong_FromSize_t(number);
+}
+
+static PyObject* xlsx_write_rows(PyOoxmlWriter* self, PyObject* args, PyObject* kwargs) {
+    static const char* kwlist[] = {"rows", "style", nullptr};
+    PyObject* rows_obj;
+    PyObject* style_obj = nullptr;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|O", const_cast<char**>(kwlist), &rows_obj, &style_obj)) {
+        return nullptr;
+    }
+    RowStyles styles;
+    PyObject* seq = styles.parse(style_obj) ? PySequence_Fast(rows_obj, "rows must be a sequence of rows") : nullptr;
+    if (!seq) {
+        return nullptr;
+    }
+
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    std::vector<std::unique_ptr<RowCells>> rows(n);
+    for (Py_ssize_t i = 0; i < n; ++i) {
+        rows[i] = std::make_unique<RowCells>();
+        if (!rows[i]->parse(PySequence_Fast_GET_ITEM(seq, i))) {
+            Py_DECREF(seq);
+            return nullptr;
+        }
+        rows[i]->apply(styles);
+    }
+
+    size_t number = 0;
+    bool ok = run_unlocked<XlsxWriter>(self, [&](XlsxWriter& writer) {
+        for (const auto& row : rows) {
+            if (!writer.write_row(row->cells.data(), row->cells.size())) {
+                return false;
+            }
+        }
+        number = writer.current_row();
+        return true;
+    });
+    Py_DECREF(seq);
+    return ok ? PyLong_FromSize_t(number) : nullptr;
+}
+
+// One row per value: before + [value] + after
+static PyObject* xlsx_write_column(PyOoxmlWriter* self, PyObject* args, PyObject* kwargs) {
+    static const char* kwlist[] = {"values", "offsets", "before", "after", "style", nullptr};
+    PyObject* values;
+    PyObject* offsets = Py_None;
+    PyObject* before_obj = nullptr;
+    PyObject* after_obj = nullptr;
+    PyObject* style_obj = nullptr;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|OOOO", const_cast<char**>(kwlist), &values, &offsets, &before_obj, &after_obj, &style_obj)) {
+        return nullptr;
+    }
+
+    CredentialViews views;
+    RowCells before;
+    RowCells after;
+    RowStyles styles;
+    PyObject* empty = PyTuple_New(0);
+    bool parsed = views.parse(values, offsets) && before.parse(before_obj ? before_obj : empty) &&
+                  after.parse(after_obj ? after_obj : empty) && styles.parse(style_obj);
+    Py_DECREF(empty);
+    if (!parsed) {
+        return nullptr;
+    }
+
+    size_t value_column = before.cells.size();
+    std::vector<Cell> cells(before.cells.begin(), before.cells.end());
+    cells.emplace_back();
+    cells.insert(cells.end(), after.cells.begin(), after.cells.end());
+    for (size_t i = 0; i < cells.size(); ++i) {
+        cells[i].style = styles[i];
+    }
+    cells[value_column].kind = Cell::TEXT;
+
+    size_t number = 0;
+    if (!run_unlocked<XlsxWriter>(self, [&](XlsxWriter& writer) {
+            for (size_t i = 0; i < views.size(); ++i) {
+                cells[value_column].text = std::string_view(views[i].first, static_cast<size_t>(views[i].second));
+                if (!writer.write_row(cells.data(), cells.size())) {
+                    return false;
+                }
+            }
+            number = writer.current_row();
+            return true;
+        })) {
+        return nullptr;
+    }
+    return PyLong_FromSize_t(number);
+}
+
+static PyObject* xlsx_skip_rows(PyOoxmlWriter* self, PyObject* args, PyObject* kwargs) {
+    static const char* kwlist[] = {"n", nullptr};
+    Py_ssize_t n = 1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|n", const_cast<char**>(kwlist), &n)) {
+        return nullptr;
+    }
+    if (n < 0) {
+        PyErr_SetString(PyExc_ValueError, "Cannot skip a negative number of rows");
+        return nullptr;
+    }
+    size_t number = 0;
+    if (!run_unlocked<XlsxWriter>(self, [&](XlsxWriter& writer) {
+            writer.skip_rows(static_cast<size_t>(n));
+            number = writer.current_row();
+            return true;
+        })) {
+        return nullptr;
+    }
+    return PyLong_FromSize_t(number);
+}
+
+static PyMethodDef XlsxWriterMethods[] = {
+    {"add_sheet", (PyCFunction)(void(*)(void))xlsx_add_sheet, METH_VARARGS | METH_KEYWORDS, "Finish the current sheet and start another: (name, widths=None); returns its number"},
+    {"write_row", (PyCFunction)(void(*)(void))xlsx_write_row, METH_VARARGS | METH_KEYWORDS, "Append a row of str, int, float, bool or None cells: (values, style=None); returns the row number"},
+    {"write_rows", (PyCFunction)(void(*)(void))xlsx_write_rows, METH_VARARGS | METH_KEYWORDS, "Append several rows: (rows, style=None)"},
+    {"write_column", (PyCFunction)(void(*)(void))xlsx_write_column, METH_VARARGS | METH_KEYWORDS, "One row per value, between fixed cells: (values, offsets=None, before=(), after=(), style=None)"},
+    {"skip_rows", (PyCFunction)(void(*)(void))xlsx_skip_rows, METH_VARARGS | METH_KEYWORDS, "Leave rows empty: (n=1)"},
+    WRITER_COMMON_METHODS,
+    {nullptr, nullptr, 0, nullptr}
+};
+
+static int docx_writer_init(PyOoxmlWriter* self, PyObject* args, PyObject* kwargs) {
+    return writer_init<DocxWriter>(self, args, kwargs, "docx");
+}
+
+static PyObject* docx_add_paragraph(PyOoxmlWriter* self, PyObject* args, PyObject* kwargs) {
+    static const char* kwlist[] = {"text", "style", "bold", nullptr};
+    PyObject* text_obj;
+    const char* style = nullptr;
+    int bold = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|zp", const_cast<char**>(kwlist), &text_obj, &style, &bold)) {
+        return nullptr;
+    }
+    std::string_view text;
+    if (!text_view(text_obj, text, "Paragraph text")) {
+        return nullptr;
+    }
+    std::string_view style_id = style ? style : "";
+    if (!run_unlocked<DocxWriter>(self, [&](DocxWriter& writer) { return writer.add_paragraph(text, style_id, bold); })) {
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject* docx_add_heading(PyOoxmlWriter* self, PyObject* args, PyObject* kwargs) {
+    static const char* kwlist[] = {"text", "level", nullptr};
+    PyObject* text_obj;
+    int level = 1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|i", const_cast<char**>(kwlist), &text_obj, &level)) {
+        return nullptr;
+    }
+    std::string_view text;
+    if (!text_view(text_obj, text, "Heading text")) {
+        return nullptr;
+    }
+    if (level < 0 || level > 3) {
+        PyErr_SetString(PyExc_ValueError, "Heading level must be 0 (title) to 3");
+        return nullptr;
+    }
+    std::string style = level == 0 ? "Title" : "Heading" + std::to_string(level);
+    if (!run_unlocked<DocxWriter>(self, [&](DocxWriter& writer) { return writer.add_paragraph(text, style, false); })) {
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject* docx_add_paragraphs(PyOoxmlWriter* self, PyObject* args, PyObject* kwargs) {
+    static const char* kwlist[] = {"texts", "offsets", "style", nullptr};
+    PyObject* texts;
+    PyObject* offsets = Py_None;
+    const char* style = nullptr;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|Oz", const_cast<char**>(kwlist), &texts, &offsets, &style)) {
+        return nullptr;
+    }
+    CredentialViews views;
+    if (!views.parse(texts, offsets)) {
+        return nullptr;
+    }
+    std::string_view style_id = style ? style : "";
+    if (!run_unlocked<DocxWriter>(self, [&](DocxWriter& writer) {
+            for (size_t i = 0; i < views.size(); ++i) {
+                std::string_view text(views[i].first, static_cast<size_t>(views[i].second));
+                if (!writer.add_paragraph(text, style_id, false)) {
+                    return false;
+                }
+            }
+            return true;
+        })) {
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject* docx_add_table(PyOoxmlWriter* self, PyObject* args, PyObject* kwargs) {
+    static const char* kwlist[] = {"rows", "header", nullptr};
+    PyObject* rows_obj;
+    int header = 1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|p", const_cast<char**>(kwlist), &rows_obj, &header)) {
+        return nullptr;
+    }
+    PyObject* rows_seq = PySequence_Fast(rows_obj, "rows must be a sequence of rows");
+    if (!rows_seq) {
+        return nullptr;
+    }
+
+    // Row sequences stay referenced until the table is written
+    std::vector<PyObject*> held;
+    std::vector<std::vector<std::string_view>> rows(PySequence_Fast_GET_SIZE(rows_seq));
+    bool parsed = true;
+    for (size_t r = 0; parsed && r < rows.size(); ++r) {
+        PyObject* row = PySequence_Fast(PySequence_Fast_GET_ITEM(rows_seq, r), "table rows must be sequences");
+        if (!row) {
+            parsed = false;
+            break;
+        }
+        held.push_back(row);
+        for (Py_ssize_t c = 0; c < PySequence_Fast_GET_SIZE(row); ++c) {
+            PyObject* item = PySequence_Fast_GET_ITEM(row, c);
+            std::string_view text;
+            if (item != Py_None) {
+                PyObject* str = PyUnicode_Check(item) || PyBytes_Check(item) ? Py_NewRef(item) : PyObject_Str(item);
+                if (!str) {
+                    parsed = false;
+                    break;
+                }
+                held.push_back(str);
+                if (!text_view(str, text, "Table cells")) {
+                    parsed = false;
+                    break;
+                }
+            }
+            rows[r].push_back(text);
+        }
+    }
+
+    bool ok = parsed && run_unlocked<DocxWriter>(self, [&](DocxWriter& writer) { return writer.add_table(rows, header); });
+    for (PyObject* obj : held) {
+        Py_DECREF(obj);
+    }
+    Py_DECREF(rows_seq);
+    if (!ok) {
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject* docx_add_page_break(PyOoxmlWriter* self, PyObject* args) {
+    if (!run_unlocked<DocxWriter>(self, [](DocxWriter& writer) { return writer.add_page_break(); })) {
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef DocxWriterMethods[] = {
+    {"add_heading", (PyCFunction)(void(*)(void))docx_add_heading, METH_VARARGS | METH_KEYWORDS, "Append a heading: (text, level=1); level 0 is the document title"},
+    {"add_paragraph", (PyCFunction)(void(*)(void))docx_add_paragraph, METH_VARARGS | METH_KEYWORDS, "Append a paragraph: (text, style=None, bold=False); newlines become line breaks"},
+    {"add_paragraphs", (PyCFunction)(void(*)(void))docx_add_paragraphs, METH_VARARGS | METH_KEYWORDS, "One paragraph per text: (texts, offsets=None, style=None)"},
+    {"add_table", (PyCFunction)(void(*)(void))docx_add_table, METH_VARARGS | METH_KEYWORDS, "Append a grid table: (rows, header=True)"},
+    {"add_page_break", reinterpret_cast<PyCFunction>(docx_add_page_break), METH_NOARGS, "Start a new page"},
+    WRITER_COMMON_METHODS,
+    {nullptr, nullptr, 0, nullptr}
+};
+
+static int pptx_writer_init(PyOoxmlWriter* self, PyObject* args, PyObject* kwargs) {
+    return writer_init<PptxWriter>(self, args, kwargs, "pptx");
+}
+
+// str, or (text, bold=False, size_pt=0, color=None) with color 0xRRGGBB or "RRGGBB"
+static bool parse_slide_text(PyObject* obj, SlideText& text) {
+    if (!PyTuple_Check(obj)) {
+        return text_view(obj, text.text, "Slide text");
+    }
+    PyObject* value;
+    PyObject* bold = Py_False;
+    double size = 0;
+    PyObject* color = Py_None;
+    if (!PyArg_ParseTuple(obj, "O|OdO", &value, &bold, &size, &color) || !text_view(value, text.text, "Slide text")) {
+        return false;
+    }
+    text.bold = PyObject_IsTrue(bold) == 1;
+    text.size = static_cast<int>(size * 100);
+    if (color == Py_None) {
+        return true;
+    }
+    text.has_color = true;
+    if (PyLong_Check(color)) {
+        text.color = static_cast<uint32_t>(PyLong_AsUnsignedLong(color));
+        return !PyErr_Occurred();
+    }
+    const char* hex = PyUnicode_Check(color) ? PyUnicode_AsUTF8(color) : nullptr;
+    char* end = nullptr;
+    text.color = hex ? static_cast<uint32_t>(std::strtoul(hex + (hex[0] == '#'), &end, 16)) : 0;
+    if (!hex || !end || *end || std::strlen(hex + (hex[0] == '#')) != 6) {
+        PyErr_SetString(PyExc_ValueError, "Colors must be 0xRRGGBB or an RRGGBB string");
+        return false;
+    }
+    return true;
+}
+
+static bool parse_slide_texts(PyObject* obj, std::vector<SlideText>& texts, std::vector<PyObject*>& held) {
+    if (!obj || obj == Py_None) {
+        return true;
+    }
+    if (PyUnicode_Check(obj)) {
+        texts.emplace_back();
+        return parse_slide_text(obj, texts.back());
+    }
+    PyObject* seq = PySequence_Fast(obj, "paragraphs must be a sequence");
+    if (!seq) {
+        return false;
+    }
+    held.push_back(seq);
+    texts.resize(PySequence_Fast_GET_SIZE(seq));
+    for (size_t i = 0; i < texts.size(); ++i) {
+        if (!parse_slide_text(PySequence_Fast_GET_ITEM(seq, i), texts[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static PyObject* pptx_add_slide_impl(PyOoxmlWriter* self, PyObject* args, PyObject* kwargs, bool title_layout) {
+    // The body is the subtitle on a title slide
+    static const char* title_kwlist[] = {"title", "subtitle", "notes", nullptr};
+    static const char* content_kwlist[] = {"title", "paragraphs", "notes", nullptr};
+    PyObject* title_obj;
+    PyObject* body_obj = nullptr;
+    PyObject* notes_obj = nullptr;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|OO", const_cast<char**>(title_layout ? title_kwlist : content_kwlist),
+                                     &title_obj, &body_obj, &notes_obj)) {
+        return nullptr;
+    }
+
+    std::vector<PyObject*> held;
+    SlideText title;
+    std::vector<SlideText> body;
+    std::vector<SlideText> note_lines;
+    bool parsed = parse_slide_text(title_obj, title) && parse_slide_texts(body_obj, body, held) &&
+                  parse_slide_texts(notes_obj, note_lines, held);
+    std::vector<std::string_view> notes;
+    for (const SlideText& line : note_lines) {
+        notes.push_back(line.text);
+    }
+
+    size_t number = 0;
+    bool ok = parsed && run_unlocked<PptxWriter>(self, [&](PptxWriter& writer) {
+        bool written = writer.add_slide(title, body, notes, title_layout);
+        number = writer.slide_count();
+        return written;
+    });
+    for (PyObject* obj : held) {
+        Py_DECREF(obj);
+    }
+    return ok ? PyLong_FromSize_t(number) : nullptr;
+}
+
+static PyObject* pptx_add_title_slide(PyOoxmlWriter* self, PyObject* args, PyObject* kwargs) {
+    return pptx_add_slide_impl(self, args, kwargs, true);
+}
+
+static PyObject* pptx_add_slide(PyOoxmlWriter* self, PyObject* args, PyObject* kwargs) {
+    return pptx_add_slide_impl(self, args, kwargs, false);
+}
+
+static PyMethodDef PptxWriterMethods[] = {
+    {"add_title_slide", (PyCFunction)(void(*)(void))pptx_add_title_slide, METH_VARARGS | METH_KEYWORDS, "Append a title slide: (title, subtitle=None, notes=None); returns its number"},
+    {"add_slide", (PyCFunction)(void(*)(void))pptx_add_slide, METH_VARARGS | METH_KEYWORDS, "Append a title and content slide: (title, paragraphs=(), notes=None); returns its number"},
+    WRITER_COMMON_METHODS,
+    {nullptr, nullptr, 0, nullptr}
+};
+
+static bool init_writer_type(PyTypeObject& type, const char* name, const char* doc, initproc init, PyMethodDef* methods) {
+    if (type.tp_flags & Py_TPFLAGS_READY) {
+        return true;
+    }
+    type.tp_name = name;
+    type.tp_doc = doc;
+    type.tp_basicsize = sizeof(PyOoxmlWriter);
+    type.tp_flags = Py_TPFLAGS_DEFAULT;
+    type.tp_new = PyType_GenericNew;
+    type.tp_init = init;
+    type.tp_dealloc = reinterpret_cast<destructor>(writer_dealloc);
+    type.tp_methods = methods;
+    return PyType_Ready(&type) == 0;
+}
+
+static int ooxml_writer_exec(PyObject* module) {
+    struct {
+        PyTypeObject* type;
+        const char* name;
+        const char* qualified;
+        const char* doc;
+        initproc init;
+        PyMethodDef* methods;
+    } types[] = {
+        {&PyXlsxWriterType, "XlsxWriter", "ooxml_writer.XlsxWriter",
+         "XlsxWriter(path, options=None)\n\nStreams a workbook to `path` one row at a time; sheets are written in order.",
+         reinterpret_cast<initproc>(xlsx_writer_init), XlsxWriterMethods},
+        {&PyDocxWriterType, "DocxWriter", "ooxml_writer.DocxWriter",
+         "DocxWriter(path, options=None)\n\nStreams a Word document to `path` one block at a time.",
+         reinterpret_cast<initproc>(docx_writer_init), DocxWriterMethods},
+        {&PyPptxWriterType, "PptxWriter", "ooxml_writer.PptxWriter",
+         "PptxWriter(path, options=None)\n\nStreams a presentation to `path` one slide at a time.",
+         reinterpret_cast<initproc>(pptx_writer_init), PptxWriterMethods},
+    };
+
+    for (const auto& entry : types) {
+        if (!init_writer_type(*entry.type, entry.qualified, entry.doc, entry.init, entry.methods)) {
+            return -1;
+        }
+        Py_INCREF(entry.type);
+        if (PyModule_AddObject(module, entry.name, reinterpret_cast<PyObject*>(entry.type)) < 0) {
+            Py_DECREF(entry.type);
+            return -1;
+        }
+    }
+
+    PyObject* styles = PyTuple_New(kCellStyleCount);
+    if (!styles) {
+        return -1;
+    }
+    for (size_t i = 0; i < kCellStyleCount; ++i) {
+        PyTuple_SET_ITEM(styles, i, PyUnicode_FromString(kCellStyles[i].name));
+    }
+    if (PyModule_AddObject(module, "CELL_STYLES", styles) < 0) {
+        Py_DECREF(styles);
+        return -1;
+    }
+    return 0;
+}
+
+static PyMethodDef OoxmlWriterMethods[] = {
+    {nullptr, nullptr, 0, nullptr}
+};
+
+static PyModuleDef_Slot OoxmlWriterSlots[] = {
+    {Py_mod_exec, reinterpret_cast<void*>(ooxml_writer_exec)},
+#if PY_VERSION_HEX >= 0x030C0000
+    {Py_mod_multiple_interpreters, Py_MOD_MULTIPLE_INTERPRETERS_SUPPORTED},
+#endif
+#if PY_VERSION_HEX >= 0x030D0000
+    {Py_mod_gil, Py_MOD_GIL_NOT_USED},
+#endif
+    {0, nullptr}
+};
+
+static struct PyModuleDef ooxmlwritermodule = {
+    PyModuleDef_HEAD_INIT,
+    "ooxml_writer",
+    "Streaming xlsx, docx and pptx writers",
+    0,
+    OoxmlWriterMethods,
+    OoxmlWriterSlots
+};
+
+PyMODINIT_FUNC PyInit_ooxml_writer(void) {
+    return PyModuleDef_Init(&ooxmlwritermodule);
+}
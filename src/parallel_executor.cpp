@@ -1,6 +1,6 @@
 #include <thread>
 #include <vector>
-#include <queue>
+#include <deque>
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
@@ -9,253 +9,701 @@
 #include <chrono>
 #include <iostream>
 #include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
 
 extern "C" {
     #include <Python.h>
 }
 
-class ParallelExecutor {
+#include "cpu_topology.h"
+#include "memory_budget.h"
+#include "parallel_executor.h"
+
+// Task scheduler for load balancing
+class TaskScheduler {
 private:
-    std::vector<std::thread> workers;
-    std::queue<std::function<void()>> tasks;
-    std::mutex queue_mutex;
-    std::condition_variable condition;
-    std::atomic<bool> stop{false};
-    std::atomic<int> active_tasks{0};
-    std::atomic<uint64_t> completed_tasks{0};
-    std::atomic<uint64_t> total_execution_time{0};
-    
-    int num_threads;
+    std::vector<std::unique_ptr<ParallelExecutor>> executors;
+    std::atomic<int> current_executor{0};
     
 public:
-    ParallelExecutor(int threads = 0) : num_threads(threads) {
-        if (num_threads <= 0) {
-            num_threads = std::thread::hardware_concurrency();
+    // With `numa_aware` executors are assigned to NUMA nodes round-robin
+    // and their workers pinned there, so each executor's tasks share a node
+    TaskScheduler(int num_executors = 1, int threads_per_executor = 0, bool numa_aware = false) {
+        const cpu_topology::Topology& topology = cpu_topology::get();
+        std::vector<int> nodes;
+        for (size_t node = 0; numa_aware && node < topology.node_cpus.size(); ++node) {
+            if (!topology.node_cpus[node].empty()) {
+                nodes.push_back(static_cast<int>(node));
+            }
         }
         
-        // Start worker threads
-        for (int i = 0; i < num_threads; ++i) {
-            workers.emplace_back([this]() {
-                worker_loop();
-            });
+        if (threads_per_executor <= 0) {
+            threads_per_executor = std::max(1u, std::thread::hardware_concurrency() / num_executors);
+        }
+        
+        for (int i = 0; i < num_executors; ++i) {
+            int node = nodes.empty() ? -1 : nodes[static_cast<size_t>(i) % nodes.size()];
+            executors.push_back(std::make_unique<ParallelExecutor>(threads_per_executor, numa_aware, node));
         }
         
-        std::cout << "Parallel Executor initialized with " << num_threads << " threads" << std::endl;
+        std::cout << "Task Scheduler initialized with " << num_executors 
+                  << " executors, " << threads_per_executor << " threads each" << std::endl;
     }
     
-    ~ParallelExecutor() {
-        shutdown();
+    ~TaskScheduler() {
+        for (auto& executor : executors) {
+            executor->shutdown();
+        }
     }
     
-    // Submit task for execution
     template<typename F, typename... Args>
     auto submit(F&& f, Args&&... args) -> std::future<decltype(f(args...))> {
-        using ReturnType = decltype(f(args...));
-        
-        auto task = std::make_shared<std::packaged_task<ReturnType()>>(
-            std::bind(std::forward<F>(f), std::forward<Args>(args)...)
-        );
-        
-        std::future<ReturnType> result = task->get_future();
-        
-        {
-            std::unique_lock<std::mutex> lock(queue_mutex);
-            if (stop) {
-                throw std::runtime_error("Executor has been stopped");
+        // Least-loaded executor, scanning from a round-robin cursor so ties
+        // still spread out; each executor then balances across its workers
+        size_t n = executors.size();
+        size_t start = static_cast<size_t>(current_executor.fetch_add(1)) % n;
+        size_t best = start;
+        int64_t best_load = executors[start]->load();
+        for (size_t k = 1; k < n && best_load > 0; ++k) {
+            size_t i = (start + k) % n;
+            int64_t load = executors[i]->load();
+            if (load < best_load) {
+                best = i;
+                best_load = load;
             }
-            
-            tasks.emplace([task]() {
-                (*task)();
-            });
         }
-        
-        condition.notify_one();
-        return result;
+        return executors[best]->submit(std::forward<F>(f), std::forward<Args>(args)...);
     }
     
-    // Submit multiple tasks in batch
-    template<typename F, typename Iterator>
-    std::vector<std::future<void>> submit_batch(F&& f, Iterator begin, Iterator end) {
-        std::vector<std::future<void>> futures;
-        futures.reserve(std::distance(begin, end));
-        
-        for (auto it = begin; it != end; ++it) {
-            futures.push_back(submit(f, *it));
+    void wait_for_all() {
+        for (auto& executor : executors) {
+            executor->wait_for_all();
         }
-        
-        return futures;
     }
     
-    // Wait for all tasks to complete
-    void wait_for_all() {
-        std::unique_lock<std::mutex> lock(queue_mutex);
-        condition.wait(lock, [this]() {
-            return tasks.empty() && active_tasks == 0;
-        });
-    }
-    
-    // Get execution statistics
-    struct Stats {
-        int num_threads;
-        int active_tasks;
-        uint64_t completed_tasks;
-        uint64_t total_execution_time;
-        double average_task_time;
-    };
-    
-    Stats get_stats() const {
-        Stats stats;
-        stats.num_threads = num_threads;
-        stats.active_tasks = active_tasks;
-        stats.completed_tasks = completed_tasks;
-        stats.total_execution_time = total_execution_time;
-        stats.average_task_time = (completed_tasks > 0) ? 
-            static_cast<double>(total_execution_time) / completed_tasks : 0.0;
+    std::vector<ParallelExecutor::Stats> get_all_stats() const {
+        std::vector<ParallelExecutor::Stats> stats;
+        for (const auto& executor : executors) {
+            stats.push_back(executor->get_stats());
+        }
         return stats;
     }
+};
+
+// Bounded multi-producer multi-consumer channel. push() blocks while the
+// channel is full, which is how a slow stage holds back the stages feeding
+// it; pop() blocks while it is empty. After close() pushes fail and pops
+// drain whatever is left.
+template <typename T>
+class BoundedChannel {
+private:
+    mutable std::mutex mutex;
+    std::condition_variable not_full;
+    std::condition_variable not_empty;
+    std::deque<T> items;
+    size_t capacity;
+    bool closed = false;
     
-    // Shutdown executor
-    void shutdown() {
-        {
-            std::unique_lock<std::mutex> lock(queue_mutex);
-            stop = true;
+public:
+    explicit BoundedChannel(size_t capacity) : capacity(std::max<size_t>(1, capacity)) {}
+    
+    // Moves from `item` only on success
+    bool push(T& item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_full.wait(lock, [this]() { return closed || items.size() < capacity; });
+        if (closed) {
+            return false;
         }
-        
-        condition.notify_all();
-        
-        for (std::thread& worker : workers) {
-            if (worker.joinable()) {
-                worker.join();
+        items.push_back(std::move(item));
+        lock.unlock();
+        not_empty.notify_one();
+        return true;
+    }
+    
+    // False once the channel is closed and drained. A negative timeout
+    // waits forever; `timed_out` reports an expired wait.
+    bool pop(T& item, double timeout = -1.0, bool* timed_out = nullptr) {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto ready = [this]() { return closed || !items.empty(); };
+        if (timeout < 0) {
+            not_empty.wait(lock, ready);
+        } else if (!not_empty.wait_for(lock, std::chrono::duration<double>(timeout), ready)) {
+            if (timed_out) {
+                *timed_out = true;
             }
+            return false;
         }
-        
-        workers.clear();
+        if (items.empty()) {
+            return false;
+        }
+        item = std::move(items.front());
+        items.pop_front();
+        lock.unlock();
+        not_full.notify_one();
+        return true;
     }
     
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        not_full.notify_all();
+        not_empty.notify_all();
+    }
+    
+    bool is_closed() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return closed;
+    }
+    
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return items.size();
+    }
+};
+
+// Item moving through a pipeline. `value` and `error` are owned Python
+// references; once a stage fails, later stages pass the item through.
+struct PipelineItem {
+    uint64_t seq = 0;
+    PyObject* value = nullptr;
+    PyObject* error = nullptr;
+};
+
+// Chain of stages connected by bounded channels. Each stage runs its own
+// number of workers as long-lived tasks on a private executor, so a
+// document can be in one stage while the next is in another. Per-stage
+// timings split each worker's time into busy, waiting for input
+// (starved by upstream) and waiting for output (blocked by downstream).
+class Pipeline {
+public:
+    using StageFunction = std::function<void(PipelineItem&)>;
+    
+    struct StageStats {
+        std::string name;
+        int workers;
+        uint64_t processed;
+        uint64_t errors;
+        double busy_time;
+        double input_wait_time;
+        double output_wait_time;
+        size_t queued;
+    };
+    
 private:
-    void worker_loop() {
-        while (true) {
-            std::function<void()> task;
+    struct Stage {
+        std::string name;
+        int workers;
+        StageFunction function;
+        std::atomic<int> running{0};
+        std::atomic<uint64_t> processed{0};
+        std::atomic<uint64_t> errors{0};
+        std::atomic<uint64_t> busy_ns{0};
+        std::atomic<uint64_t> input_wait_ns{0};
+        std::atomic<uint64_t> output_wait_ns{0};
+    };
+    
+    std::vector<std::unique_ptr<Stage>> stages;
+    // channels[i] feeds stage i; the last one holds finished items
+    std::vector<std::unique_ptr<BoundedChannel<PipelineItem>>> channels;
+    std::unique_ptr<ParallelExecutor> executor;
+    StageFunction discard;
+    std::atomic<bool> cancelled{false};
+    std::atomic<uint64_t> next_seq{0};
+    std::chrono::steady_clock::time_point start_time;
+    
+    static uint64_t elapsed_ns(std::chrono::steady_clock::time_point since,
+                               std::chrono::steady_clock::time_point until) {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(until - since).count());
+    }
+    
+    void run_stage(size_t index) {
+        Stage& stage = *stages[index];
+        BoundedChannel<PipelineItem>& input = *channels[index];
+        BoundedChannel<PipelineItem>& output = *channels[index + 1];
+        
+        PipelineItem item;
+        auto t0 = std::chrono::steady_clock::now();
+        while (input.pop(item)) {
+            auto t1 = std::chrono::steady_clock::now();
+            stage.input_wait_ns += elapsed_ns(t0, t1);
             
-            {
-                std::unique_lock<std::mutex> lock(queue_mutex);
-                condition.wait(lock, [this]() {
-                    return stop || !tasks.empty();
-                });
-                
-                if (stop && tasks.empty()) {
-                    return;
-                }
-                
-                task = std::move(tasks.front());
-                tasks.pop();
-                active_tasks++;
+            if (cancelled.load(std::memory_order_relaxed)) {
+                discard(item);
+                t0 = std::chrono::steady_clock::now();
+                continue;
             }
             
-            // Execute task
-            auto start_time = std::chrono::high_resolution_clock::now();
-            task();
-            auto end_time = std::chrono::high_resolution_clock::now();
-            
-            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-                end_time - start_time).count();
+            if (!item.error) {
+                stage.function(item);
+                if (item.error) {
+                    stage.errors++;
+                }
+            }
+            stage.processed++;
+            auto t2 = std::chrono::steady_clock::now();
+            stage.busy_ns += elapsed_ns(t1, t2);
             
-            total_execution_time += duration;
-            completed_tasks++;
-            active_tasks--;
+            if (!output.push(item)) {
+                discard(item);
+            }
+            t0 = std::chrono::steady_clock::now();
+            stage.output_wait_ns += elapsed_ns(t2, t0);
+        }
+        stage.input_wait_ns += elapsed_ns(t0, std::chrono::steady_clock::now());
+        
+        // The last worker out closes the next stage's input
+        if (--stage.running == 0) {
+            output.close();
         }
     }
-};
-
-// Task scheduler for load balancing
-class TaskScheduler {
-private:
-    std::vector<std::unique_ptr<ParallelExecutor>> executors;
-    std::atomic<int> current_executor{0};
     
 public:
-    TaskScheduler(int num_executors = 1, int threads_per_executor = 0) {
-        if (threads_per_executor <= 0) {
-            threads_per_executor = std::thread::hardware_concurrency() / num_executors;
+    // `discard` releases an item dropped after cancel(); it runs on
+    // worker threads
+    Pipeline(std::vector<std::pair<std::string, int>> specs, std::vector<StageFunction> functions,
+             size_t capacity, StageFunction discard_item)
+        : discard(std::move(discard_item)), start_time(std::chrono::steady_clock::now()) {
+        if (specs.empty() || specs.size() != functions.size()) {
+            throw std::invalid_argument("Pipeline needs at least one stage");
         }
         
-        for (int i = 0; i < num_executors; ++i) {
-            executors.push_back(std::make_unique<ParallelExecutor>(threads_per_executor));
+        int total_workers = 0;
+        for (size_t i = 0; i < specs.size(); ++i) {
+            auto stage = std::make_unique<Stage>();
+            stage->name = specs[i].first;
+            stage->workers = std::max(1, specs[i].second);
+            stage->function = std::move(functions[i]);
+            stage->running = stage->workers;
+            total_workers += stage->workers;
+            stages.push_back(std::move(stage));
+        }
+        for (size_t i = 0; i <= stages.size(); ++i) {
+            channels.push_back(std::make_unique<BoundedChannel<PipelineItem>>(capacity));
         }
         
-        std::cout << "Task Scheduler initialized with " << num_executors 
-                  << " executors, " << threads_per_executor << " threads each" << std::endl;
+        executor = std::make_unique<ParallelExecutor>(total_workers);
+        for (size_t i = 0; i < stages.size(); ++i) {
+            for (int w = 0; w < stages[i]->workers; ++w) {
+                executor->submit([this, i]() { run_stage(i); });
+            }
+        }
     }
     
-    ~TaskScheduler() {
-        for (auto& executor : executors) {
-            executor->shutdown();
-        }
+    ~Pipeline() {
+        cancel();
+        join();
     }
     
-    template<typename F, typename... Args>
-    auto submit(F&& f, Args&&... args) -> std::future<decltype(f(args...))> {
-        // Round-robin load balancing
-        int executor_id = current_executor.fetch_add(1) % executors.size();
-        return executors[executor_id]->submit(std::forward<F>(f), std::forward<Args>(args)...);
+    // Feed an item into the first stage, blocking while it is full; false
+    // once input is closed. Assigns the item's sequence number.
+    bool put(PipelineItem& item) {
+        item.seq = next_seq++;
+        return channels.front()->push(item);
     }
     
-    void wait_for_all() {
-        for (auto& executor : executors) {
-            executor->wait_for_all();
+    // Next finished item in completion order; false when drained or timed out
+    bool get(PipelineItem& item, double timeout = -1.0, bool* timed_out = nullptr) {
+        return channels.back()->pop(item, timeout, timed_out);
+    }
+    
+    // No more input; stages finish what is queued, then close in turn
+    void close_input() {
+        channels.front()->close();
+    }
+    
+    // Stop accepting and drop queued items
+    void cancel() {
+        cancelled = true;
+        for (auto& channel : channels) {
+            channel->close();
         }
     }
     
-    std::vector<ParallelExecutor::Stats> get_all_stats() const {
-        std::vector<ParallelExecutor::Stats> stats;
-        for (const auto& executor : executors) {
-            stats.push_back(executor->get_stats());
+    // Wait for stage workers to exit (after close_input() or cancel())
+    void join() {
+        // Stage loops must all finish on workers; shutdown() would run a
+        // leftover one inline, where it could block on a full channel
+        executor->wait_for_all();
+        executor->shutdown();
+    }
+    
+    std::vector<StageStats> get_stats() const {
+        std::vector<StageStats> result;
+        for (size_t i = 0; i < stages.size(); ++i) {
+            const Stage& stage = *stages[i];
+            result.push_back({stage.name, stage.workers, stage.processed.load(), stage.errors.load(),
+                              stage.busy_ns.load() / 1e9, stage.input_wait_ns.load() / 1e9,
+                              stage.output_wait_ns.load() / 1e9, channels[i]->size()});
         }
-        return stats;
+        return result;
+    }
+    
+    uint64_t submitted() const {
+        return next_seq.load();
+    }
+    
+    bool input_closed() const {
+        return channels.front()->is_closed();
+    }
+    
+    double elapsed_time() const {
+        return elapsed_ns(start_time, std::chrono::steady_clock::now()) / 1e9;
     }
 };
 
-// Global instances
-static std::unique_ptr<ParallelExecutor> g_executor = nullptr;
-static std::unique_ptr<TaskScheduler> g_scheduler = nullptr;
+// Global instances. Calls hand out shared_ptr copies taken under the mutex,
+// so shutdown() can release the executor while other threads still use it.
+static std::shared_ptr<ParallelExecutor> g_executor = nullptr;
+static std::shared_ptr<TaskScheduler> g_scheduler = nullptr;
+static std::mutex g_executor_mutex;
+
+static std::shared_ptr<ParallelExecutor> get_executor() {
+    std::lock_guard<std::mutex> lock(g_executor_mutex);
+    return g_executor;
+}
 
 // Python C API functions
 static PyObject* init_parallel_executor(PyObject* self, PyObject* args) {
     int num_threads = 0;
+    int pin_threads = 0;
+    int numa_node = -1;
     
-    if (!PyArg_ParseTuple(args, "|i", &num_threads)) {
+    if (!PyArg_ParseTuple(args, "|ipi", &num_threads, &pin_threads, &numa_node)) {
         return nullptr;
     }
     
-    if (g_executor) {
-        return PyBool_FromLong(1);
+    std::lock_guard<std::mutex> lock(g_executor_mutex);
+    if (!g_executor) {
+        g_executor = std::make_shared<ParallelExecutor>(num_threads, pin_threads != 0, numa_node);
     }
-    
-    g_executor = std::make_unique<ParallelExecutor>(num_threads);
     return PyBool_FromLong(1);
 }
 
 static PyObject* init_task_scheduler(PyObject* self, PyObject* args) {
     int num_executors = 1;
     int threads_per_executor = 0;
+    int numa_aware = 0;
     
-    if (!PyArg_ParseTuple(args, "|ii", &num_executors, &threads_per_executor)) {
+    if (!PyArg_ParseTuple(args, "|iip", &num_executors, &threads_per_executor, &numa_aware)) {
         return nullptr;
     }
     
-    if (g_scheduler) {
-        return PyBool_FromLong(1);
+    if (num_executors <= 0) {
+        PyErr_SetString(PyExc_ValueError, "Number of executors must be positive");
+        return nullptr;
     }
     
-    g_scheduler = std::make_unique<TaskScheduler>(num_executors, threads_per_executor);
+    std::lock_guard<std::mutex> lock(g_executor_mutex);
+    if (!g_scheduler) {
+        g_scheduler = std::make_shared<TaskScheduler>(num_executors, threads_per_executor, numa_aware != 0);
+    }
     return PyBool_FromLong(1);
 }
 
+// Python-visible future for a submitted task. The worker stores the
+// callable's return value or exception under the GIL, then marks the
+// future done under `mutex`; waiters block on `cv` with the GIL released.
+struct FutureState {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done = false;
+    PyObject* result = nullptr;
+    PyObject* exc_type = nullptr;
+    PyObject* exc_value = nullptr;
+    PyObject* exc_traceback = nullptr;
+    std::vector<PyObject*> callbacks;
+};
+
+typedef struct {
+    PyObject_HEAD
+    FutureState* state;
+} PyNativeFuture;
+
+static PyTypeObject PyNativeFutureType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+static PyNativeFuture* new_native_future() {
+    PyNativeFuture* future = PyObject_New(PyNativeFuture, &PyNativeFutureType);
+    if (future) {
+        future->state = new FutureState();
+    }
+    return future;
+}
+
+static void native_future_dealloc(PyNativeFuture* self) {
+    FutureState* state = self->state;
+    if (state) {
+        Py_XDECREF(state->result);
+        Py_XDECREF(state->exc_type);
+        Py_XDECREF(state->exc_value);
+        Py_XDECREF(state->exc_traceback);
+        for (PyObject* callback : state->callbacks) {
+            Py_DECREF(callback);
+        }
+        delete state;
+    }
+    PyObject_Free(self);
+}
+
+static void run_done_callback(PyObject* callback, PyNativeFuture* future) {
+    PyObject* ret = PyObject_CallFunctionObjArgs(callback, reinterpret_cast<PyObject*>(future), nullptr);
+    if (ret) {
+        Py_DECREF(ret);
+    } else {
+        PyErr_Print();
+    }
+}
+
+// Run `callable(*args)` and resolve `future`. Called with the GIL held.
+static void resolve_native_future(PyNativeFuture* future, PyObject* callable, PyObject* args) {
+    FutureState* state = future->state;
+    PyObject* result = PyObject_Call(callable, args, nullptr);
+    PyObject* exc_type = nullptr;
+    PyObject* exc_value = nullptr;
+    PyObject* exc_traceback = nullptr;
+    if (!result) {
+        PyErr_Fetch(&exc_type, &exc_value, &exc_traceback);
+        PyErr_NormalizeException(&exc_type, &exc_value, &exc_traceback);
+    }
+    
+    std::vector<PyObject*> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->result = result;
+        state->exc_type = exc_type;
+        state->exc_value = exc_value;
+        state->exc_traceback = exc_traceback;
+        state->done = true;
+        callbacks.swap(state->callbacks);
+    }
+    state->cv.notify_all();
+    
+    for (PyObject* callback : callbacks) {
+        run_done_callback(callback, future);
+        Py_DECREF(callback);
+    }
+}
+
+// How long a waiting worker sleeps when it finds no task to run before it
+// looks again; the future finishing wakes it sooner
+static constexpr std::chrono::milliseconds kHelpPollInterval(1);
+
+// Wait with the GIL released; false on timeout. A negative timeout waits forever.
+// Called on an executor worker (a task waiting on tasks it submitted), it
+// runs queued tasks while it waits; otherwise a pool whose workers all
+// wait would never run the tasks they wait for. A task it picks up runs
+// to completion, so the wait can outlast the timeout by that task.
+static bool wait_native_future(PyNativeFuture* future, double timeout) {
+    FutureState* state = future->state;
+    ParallelExecutor* executor = ParallelExecutor::current();
+    auto ready = [state]() { return state->done; };
+    bool done;
+    Py_BEGIN_ALLOW_THREADS
+    {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        if (executor) {
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(std::max(0.0, timeout)));
+            while (!state->done && (timeout < 0 || std::chrono::steady_clock::now() < deadline)) {
+                lock.unlock();
+                bool ran = executor->run_pending_task();
+                lock.lock();
+                if (!ran) {
+                    auto wake = std::chrono::steady_clock::now() + kHelpPollInterval;
+                    state->cv.wait_until(lock, timeout < 0 ? wake : std::min(wake, deadline), ready);
+                }
+            }
+        } else if (timeout < 0) {
+            state->cv.wait(lock, ready);
+        } else {
+            state->cv.wait_for(lock, std::chrono::duration<double>(timeout), ready);
+        }
+        done = state->done;
+    }
+    Py_END_ALLOW_THREADS
+    return done;
+}
+
+// Return a new reference to the result, or raise the task's exception
+static PyObject* native_future_value(PyNativeFuture* future) {
+    FutureState* state = future->state;
+    if (state->exc_type) {
+        Py_INCREF(state->exc_type);
+        Py_XINCREF(state->exc_value);
+        Py_XINCREF(state->exc_traceback);
+        PyErr_Restore(state->exc_type, state->exc_value, state->exc_traceback);
+        return nullptr;
+    }
+    return Py_NewRef(state->result);
+}
+
+static bool parse_timeout(PyObject* timeout_obj, double& timeout) {
+    timeout = -1.0;
+    if (timeout_obj && timeout_obj != Py_None) {
+        timeout = PyFloat_AsDouble(timeout_obj);
+        if (PyErr_Occurred()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static PyObject* native_future_result(PyNativeFuture* self, PyObject* args) {
+    PyObject* timeout_obj = nullptr;
+    double timeout;
+    
+    if (!PyArg_ParseTuple(args, "|O", &timeout_obj) || !parse_timeout(timeout_obj, timeout)) {
+        return nullptr;
+    }
+    
+    if (!wait_native_future(self, timeout)) {
+        PyErr_SetString(PyExc_TimeoutError, "Task did not finish within the timeout");
+        return nullptr;
+    }
+    return native_future_value(self);
+}
+
+static PyObject* native_future_done(PyNativeFuture* self, PyObject* args) {
+    std::lock_guard<std::mutex> lock(self->state->mutex);
+    return PyBool_FromLong(self->state->done);
+}
+
+static PyObject* native_future_add_done_callback(PyNativeFuture* self, PyObject* args) {
+    PyObject* callback;
+    
+    if (!PyArg_ParseTuple(args, "O", &callback)) {
+        return nullptr;
+    }
+    
+    if (!PyCallable_Check(callback)) {
+        PyErr_SetString(PyExc_TypeError, "Callback must be callable");
+        return nullptr;
+    }
+    
+    // Callbacks run on the worker that finishes the task, or right away
+    // if it already has
+    {
+        std::lock_guard<std::mutex> lock(self->state->mutex);
+        if (!self->state->done) {
+            Py_INCREF(callback);
+            self->state->callbacks.push_back(callback);
+            Py_RETURN_NONE;
+        }
+    }
+    run_done_callback(callback, self);
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef NativeFutureMethods[] = {
+    {"result", reinterpret_cast<PyCFunction>(native_future_result), METH_VARARGS, "Wait for the task (optional timeout in seconds) and return its result or raise its exception"},
+    {"done", reinterpret_cast<PyCFunction>(native_future_done), METH_NOARGS, "Whether the task has finished"},
+    {"add_done_callback", reinterpret_cast<PyCFunction>(native_future_add_done_callback), METH_VARARGS, "Call fn(future) once the task finishes"},
+    {nullptr, nullptr, 0, nullptr}
+};
+
+static bool init_native_future_type() {
+    // Module exec runs once per interpreter; the static type is shared
+    if (PyNativeFutureType.tp_flags & Py_TPFLAGS_READY) {
+        return true;
+    }
+    
+    PyNativeFutureType.tp_name = "parallel_executor.NativeFuture";
+    PyNativeFutureType.tp_doc = "Result of a task submitted to the native executor";
+    PyNativeFutureType.tp_basicsize = sizeof(PyNativeFuture);
+    PyNativeFutureType.tp_flags = Py_TPFLAGS_DEFAULT;
+    PyNativeFutureType.tp_dealloc = reinterpret_cast<destructor>(native_future_dealloc);
+    PyNativeFutureType.tp_methods = NativeFutureMethods;
+    return PyType_Ready(&PyNativeFutureType) == 0;
+}
+
+// Hold back new work while the process is over its memory budget (see
+// memory_budget::throttle); MemoryError if usage did not come down in time
+static bool throttle_submission() {
+    if (memory_budget::pressure() == memory_budget::Pressure::NORMAL) {
+        return true;
+    }
+    
+    bool admitted;
+    Py_BEGIN_ALLOW_THREADS
+    admitted = memory_budget::throttle();
+    Py_END_ALLOW_THREADS
+    if (!admitted) {
+        PyErr_SetString(PyExc_MemoryError, "Memory budget exceeded; task not submitted");
+    }
+    return admitted;
+}
+
+// Queue callable(*args) on the executor; returns a new future reference.
+// The task owns references to the callable, arguments and future until it
+// has run.
+static PyNativeFuture* submit_python_task(ParallelExecutor& executor, PyObject* callable, PyObject* args_tuple) {
+    if (!throttle_submission()) {
+        return nullptr;
+    }
+    
+    PyNativeFuture* future = new_native_future();
+    if (!future) {
+        return nullptr;
+    }
+    
+    Py_INCREF(callable);
+    Py_INCREF(args_tuple);
+    Py_INCREF(future);
+    auto wrapper = [callable, args_tuple, future]() {
+        PyGILState_STATE gstate = PyGILState_Ensure();
+        resolve_native_future(future, callable, args_tuple);
+        Py_DECREF(callable);
+        Py_DECREF(args_tuple);
+        Py_DECREF(future);
+        PyGILState_Release(gstate);
+    };
+    
+    try {
+        executor.submit(wrapper);
+    } catch (const std::exception& e) {
+        Py_DECREF(callable);
+        Py_DECREF(args_tuple);
+        Py_DECREF(future);
+        Py_DECREF(future);
+        PyErr_SetString(PyExc_RuntimeError, e.what());
+        return nullptr;
+    }
+    return future;
+}
+
+// Submit callable once per item of `iterable`; tuples are unpacked as
+// arguments, anything else is passed as the single argument
+static PyObject* submit_all(ParallelExecutor& executor, PyObject* callable, PyObject* iterable) {
+    PyObject* seq = PySequence_Fast(iterable, "Expected an iterable of argument tuples");
+    if (!seq) {
+        return nullptr;
+    }
+    
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    PyObject* futures = PyList_New(n);
+    for (Py_ssize_t i = 0; futures && i < n; ++i) {
+        PyObject* item = PySequence_Fast_GET_ITEM(seq, i);
+        PyObject* call_args = PyTuple_Check(item) ? Py_NewRef(item) : PyTuple_Pack(1, item);
+        PyNativeFuture* future = call_args ? submit_python_task(executor, callable, call_args) : nullptr;
+        Py_XDECREF(call_args);
+        if (!future) {
+            Py_CLEAR(futures);
+            break;
+        }
+        PyList_SET_ITEM(futures, i, reinterpret_cast<PyObject*>(future));
+    }
+    Py_DECREF(seq);
+    return futures;
+}
+
 static PyObject* submit_task(PyObject* self, PyObject* args) {
     PyObject* callable;
     PyObject* args_tuple;
     
-    if (!PyArg_ParseTuple(args, "OO", &callable, &args_tuple)) {
+    if (!PyArg_ParseTuple(args, "OO!", &callable, &PyTuple_Type, &args_tuple)) {
         return nullptr;
     }
     
@@ -264,55 +712,510 @@ static PyObject* submit_task(PyObject* self, PyObject* args) {
         return nullptr;
     }
     
-    if (!g_executor) {
+    std::shared_ptr<ParallelExecutor> executor = get_executor();
+    if (!executor) {
         PyErr_SetString(PyExc_RuntimeError, "Parallel executor not initialized");
         return nullptr;
     }
     
-    // Create a wrapper function that calls the Python function
-    auto wrapper = [callable, args_tuple]() {
+    return reinterpret_cast<PyObject*>(submit_python_task(*executor, callable, args_tuple));
+}
+
+static PyObject* submit_many(PyObject* self, PyObject* args) {
+    PyObject* callable;
+    PyObject* iterable;
+    
+    if (!PyArg_ParseTuple(args, "OO", &callable, &iterable)) {
+        return nullptr;
+    }
+    
+    if (!PyCallable_Check(callable)) {
+        PyErr_SetString(PyExc_TypeError, "First argument must be callable");
+        return nullptr;
+    }
+    
+    std::shared_ptr<ParallelExecutor> executor = get_executor();
+    if (!executor) {
+        PyErr_SetString(PyExc_RuntimeError, "Parallel executor not initialized");
+        return nullptr;
+    }
+    
+    return submit_all(*executor, callable, iterable);
+}
+
+static PyObject* map_tasks(PyObject* self, PyObject* args) {
+    PyObject* callable;
+    PyObject* iterable;
+    PyObject* timeout_obj = nullptr;
+    double timeout;
+    
+    if (!PyArg_ParseTuple(args, "OO|O", &callable, &iterable, &timeout_obj) ||
+        !parse_timeout(timeout_obj, timeout)) {
+        return nullptr;
+    }
+    
+    if (!PyCallable_Check(callable)) {
+        PyErr_SetString(PyExc_TypeError, "First argument must be callable");
+        return nullptr;
+    }
+    
+    std::shared_ptr<ParallelExecutor> executor = get_executor();
+    if (!executor) {
+        PyErr_SetString(PyExc_RuntimeError, "Parallel executor not initialized");
+        return nullptr;
+    }
+    
+    PyObject* futures = submit_all(*executor, callable, iterable);
+    if (!futures) {
+        return nullptr;
+    }
+    
+    // The timeout bounds the whole map, as in concurrent.futures
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(std::max(0.0, timeout));
+    Py_ssize_t n = PyList_GET_SIZE(futures);
+    PyObject* results = PyList_New(n);
+    for (Py_ssize_t i = 0; results && i < n; ++i) {
+        PyNativeFuture* future = reinterpret_cast<PyNativeFuture*>(PyList_GET_ITEM(futures, i));
+        double remaining = timeout < 0 ? -1.0 :
+            std::max(0.0, std::chrono::duration<double>(deadline - std::chrono::steady_clock::now()).count());
+        
+        PyObject* value = nullptr;
+        if (!wait_native_future(future, remaining)) {
+            PyErr_SetString(PyExc_TimeoutError, "map() did not finish within the timeout");
+        } else {
+            value = native_future_value(future);
+        }
+        
+        if (!value) {
+            Py_CLEAR(results);
+            break;
+        }
+        PyList_SET_ITEM(results, i, value);
+    }
+    Py_DECREF(futures);
+    return results;
+}
+
+// Python-facing pipeline. Each stage callable takes one item and returns
+// the value handed to the next stage; `stages` keeps the callables alive.
+typedef struct {
+    PyObject_HEAD
+    Pipeline* pipeline;
+    PyObject* stages;
+} PyPipeline;
+
+static PyTypeObject PyPipelineType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+// Take the raised exception as an instance carrying its traceback
+static PyObject* fetch_exception() {
+    PyObject* type = nullptr;
+    PyObject* value = nullptr;
+    PyObject* traceback = nullptr;
+    PyErr_Fetch(&type, &value, &traceback);
+    PyErr_NormalizeException(&type, &value, &traceback);
+    if (traceback) {
+        PyException_SetTraceback(value, traceback);
+    }
+    Py_XDECREF(type);
+    Py_XDECREF(traceback);
+    return value;
+}
+
+static void raise_exception(PyObject* error) {
+    PyErr_Restore(Py_NewRef(reinterpret_cast<PyObject*>(Py_TYPE(error))), error, PyException_GetTraceback(error));
+}
+
+static void release_pipeline_item(PipelineItem& item) {
+    Py_CLEAR(item.value);
+    Py_CLEAR(item.error);
+}
+
+static Pipeline::StageFunction make_python_stage(PyObject* callable) {
+    return [callable](PipelineItem& item) {
         PyGILState_STATE gstate = PyGILState_Ensure();
-        PyObject* result = PyObject_Call(callable, args_tuple, nullptr);
+        PyObject* result = PyObject_CallOneArg(callable, item.value);
+        if (result) {
+            Py_SETREF(item.value, result);
+        } else {
+            item.error = fetch_exception();
+        }
         PyGILState_Release(gstate);
+    };
+}
+
+static int pipeline_init(PyPipeline* self, PyObject* args, PyObject* kwargs) {
+    static const char* kwlist[] = {"stages", "capacity", nullptr};
+    PyObject* stages_obj;
+    Py_ssize_t capacity = 16;
+    
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|n", const_cast<char**>(kwlist), &stages_obj, &capacity)) {
+        return -1;
+    }
+    
+    if (self->pipeline) {
+        PyErr_SetString(PyExc_RuntimeError, "Pipeline is already running");
+        return -1;
+    }
+    
+    if (capacity <= 0) {
+        PyErr_SetString(PyExc_ValueError, "Capacity must be positive");
+        return -1;
+    }
+    
+    PyObject* seq = PySequence_Fast(stages_obj, "Stages must be a sequence");
+    if (!seq) {
+        return -1;
+    }
+    
+    // Each stage is a callable or a (callable, workers[, name]) tuple
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    PyObject* callables = PyList_New(0);
+    std::vector<std::pair<std::string, int>> specs;
+    std::vector<Pipeline::StageFunction> functions;
+    for (Py_ssize_t i = 0; callables && i < n; ++i) {
+        PyObject* spec = PySequence_Fast_GET_ITEM(seq, i);
+        PyObject* callable = spec;
+        int workers = 1;
+        const char* name = nullptr;
         
-        if (result) {
-            Py_DECREF(result);
+        if (PyTuple_Check(spec) && !PyArg_ParseTuple(spec, "Oi|s", &callable, &workers, &name)) {
+            Py_CLEAR(callables);
+            break;
         }
+        if (!PyCallable_Check(callable)) {
+            PyErr_Format(PyExc_TypeError, "Stage %zd is not callable", i);
+            Py_CLEAR(callables);
+            break;
+        }
+        if (workers <= 0) {
+            PyErr_Format(PyExc_ValueError, "Stage %zd needs at least one worker", i);
+            Py_CLEAR(callables);
+            break;
+        }
+        
+        std::string stage_name = name ? name : "stage" + std::to_string(i);
+        if (!name) {
+            PyObject* name_obj = PyObject_GetAttrString(callable, "__name__");
+            const char* text = name_obj && PyUnicode_Check(name_obj) ? PyUnicode_AsUTF8(name_obj) : nullptr;
+            if (text) {
+                stage_name = text;
+            }
+            Py_XDECREF(name_obj);
+            PyErr_Clear();
+        }
+        
+        if (PyList_Append(callables, callable) < 0) {
+            Py_CLEAR(callables);
+            break;
+        }
+        specs.emplace_back(stage_name, workers);
+        functions.push_back(make_python_stage(callable));
+    }
+    Py_DECREF(seq);
+    if (!callables) {
+        return -1;
+    }
+    
+    auto discard = [](PipelineItem& item) {
+        PyGILState_STATE gstate = PyGILState_Ensure();
+        release_pipeline_item(item);
+        PyGILState_Release(gstate);
     };
     
     try {
-        auto future = g_executor->submit(wrapper);
-        // For simplicity, we'll just return True
-        // In a real implementation, you'd want to return a future object
-        return PyBool_FromLong(1);
+        self->pipeline = new Pipeline(std::move(specs), std::move(functions), static_cast<size_t>(capacity), discard);
     } catch (const std::exception& e) {
-        PyErr_SetString(PyExc_RuntimeError, e.what());
+        Py_DECREF(callables);
+        PyErr_SetString(PyExc_ValueError, e.what());
+        return -1;
+    }
+    
+    Py_XSETREF(self->stages, callables);
+    return 0;
+}
+
+static void pipeline_dealloc(PyPipeline* self) {
+    if (self->pipeline) {
+        Pipeline* pipeline = self->pipeline;
+        // Stage workers need the GIL to finish their current call
+        Py_BEGIN_ALLOW_THREADS
+        pipeline->cancel();
+        pipeline->join();
+        Py_END_ALLOW_THREADS
+        
+        // Finished items nobody collected
+        PipelineItem item;
+        while (pipeline->get(item, 0.0)) {
+            release_pipeline_item(item);
+        }
+        delete pipeline;
+    }
+    Py_XDECREF(self->stages);
+    Py_TYPE(self)->tp_free(reinterpret_cast<PyObject*>(self));
+}
+
+static bool check_pipeline(PyPipeline* self) {
+    if (!self->pipeline) {
+        PyErr_SetString(PyExc_RuntimeError, "Pipeline not initialized");
+        return false;
+    }
+    return true;
+}
+
+static PyObject* pipeline_put(PyPipeline* self, PyObject* args) {
+    PyObject* value;
+    
+    if (!PyArg_ParseTuple(args, "O", &value) || !check_pipeline(self) || !throttle_submission()) {
+        return nullptr;
+    }
+    
+    PipelineItem item;
+    item.value = Py_NewRef(value);
+    bool accepted;
+    // Blocks while the first stage's input is full
+    Py_BEGIN_ALLOW_THREADS
+    accepted = self->pipeline->put(item);
+    Py_END_ALLOW_THREADS
+    
+    if (!accepted) {
+        Py_DECREF(value);
+        PyErr_SetString(PyExc_RuntimeError, "Pipeline input is closed");
+        return nullptr;
+    }
+    return PyLong_FromUnsignedLongLong(item.seq);
+}
+
+// Shared by get() and iteration. Returns (seq, result), or nullptr with
+// no exception set once the pipeline is drained.
+static PyObject* pipeline_next_item(PyPipeline* self, double timeout) {
+    PipelineItem item;
+    bool got;
+    bool timed_out = false;
+    Py_BEGIN_ALLOW_THREADS
+    got = self->pipeline->get(item, timeout, &timed_out);
+    Py_END_ALLOW_THREADS
+    
+    if (!got) {
+        if (timed_out) {
+            PyErr_SetString(PyExc_TimeoutError, "No pipeline result within the timeout");
+        }
         return nullptr;
     }
+    
+    if (item.error) {
+        Py_XDECREF(item.value);
+        raise_exception(item.error);
+        return nullptr;
+    }
+    return Py_BuildValue("(KN)", static_cast<unsigned long long>(item.seq), item.value);
+}
+
+static PyObject* pipeline_get(PyPipeline* self, PyObject* args) {
+    PyObject* timeout_obj = nullptr;
+    double timeout;
+    
+    if (!PyArg_ParseTuple(args, "|O", &timeout_obj) || !parse_timeout(timeout_obj, timeout) ||
+        !check_pipeline(self)) {
+        return nullptr;
+    }
+    
+    PyObject* result = pipeline_next_item(self, timeout);
+    if (!result && !PyErr_Occurred()) {
+        Py_RETURN_NONE;
+    }
+    return result;
+}
+
+static PyObject* pipeline_iternext(PyPipeline* self) {
+    if (!check_pipeline(self)) {
+        return nullptr;
+    }
+    return pipeline_next_item(self, -1.0);
+}
+
+static PyObject* pipeline_close(PyPipeline* self, PyObject* args) {
+    if (!check_pipeline(self)) {
+        return nullptr;
+    }
+    self->pipeline->close_input();
+    Py_RETURN_NONE;
+}
+
+static PyObject* pipeline_run(PyPipeline* self, PyObject* args) {
+    PyObject* iterable;
+    
+    if (!PyArg_ParseTuple(args, "O", &iterable) || !check_pipeline(self)) {
+        return nullptr;
+    }
+    
+    Pipeline* pipeline = self->pipeline;
+    if (pipeline->submitted() != 0 || pipeline->input_closed()) {
+        PyErr_SetString(PyExc_RuntimeError, "run() needs a pipeline that has not been fed yet");
+        return nullptr;
+    }
+    
+    PyObject* seq = PySequence_Fast(iterable, "Expected an iterable of items");
+    if (!seq) {
+        return nullptr;
+    }
+    
+    size_t n = static_cast<size_t>(PySequence_Fast_GET_SIZE(seq));
+    std::vector<PyObject*> values(n);
+    for (size_t i = 0; i < n; ++i) {
+        values[i] = Py_NewRef(PySequence_Fast_GET_ITEM(seq, i));
+    }
+    Py_DECREF(seq);
+    
+    // A feeder thread fills the pipeline while this thread drains it, so
+    // backpressure cannot stall the caller. Sequence numbers are the
+    // input positions because the feeder is the only producer.
+    std::vector<PipelineItem> finished(n);
+    std::vector<PyObject*> rejected;
+    Py_BEGIN_ALLOW_THREADS
+    std::thread feeder([pipeline, &values, &rejected]() {
+        for (PyObject* value : values) {
+            PipelineItem item;
+            item.value = value;
+            if (!pipeline->put(item)) {
+                rejected.push_back(value);
+            }
+        }
+        pipeline->close_input();
+    });
+    
+    PipelineItem item;
+    while (pipeline->get(item)) {
+        finished[item.seq] = item;
+    }
+    feeder.join();
+    Py_END_ALLOW_THREADS
+    
+    for (PyObject* value : rejected) {
+        Py_DECREF(value);
+    }
+    
+    // Results in input order; the first failure by position is raised
+    PyObject* error = nullptr;
+    for (PipelineItem& done : finished) {
+        if (done.error && !error) {
+            std::swap(error, done.error);
+        }
+    }
+    
+    PyObject* results = error ? nullptr : PyList_New(static_cast<Py_ssize_t>(n));
+    for (size_t i = 0; i < n; ++i) {
+        if (results) {
+            PyList_SET_ITEM(results, static_cast<Py_ssize_t>(i), finished[i].value ? finished[i].value : Py_NewRef(Py_None));
+            finished[i].value = nullptr;
+        }
+        release_pipeline_item(finished[i]);
+    }
+    
+    if (error) {
+        raise_exception(error);
+    }
+    return results;
+}
+
+static PyObject* pipeline_stats(PyPipeline* self, PyObject* args) {
+    if (!check_pipeline(self)) {
+        return nullptr;
+    }
+    
+    double elapsed = self->pipeline->elapsed_time();
+    std::vector<Pipeline::StageStats> stats = self->pipeline->get_stats();
+    
+    // The stage whose workers are busiest limits throughput; stages
+    // ahead of it show output wait, stages behind it input wait
+    PyObject* stages = PyList_New(0);
+    const char* bottleneck = nullptr;
+    double max_utilization = -1.0;
+    for (const Pipeline::StageStats& stage : stats) {
+        double utilization = elapsed > 0 ? stage.busy_time / (stage.workers * elapsed) : 0.0;
+        if (utilization > max_utilization) {
+            max_utilization = utilization;
+            bottleneck = stage.name.c_str();
+        }
+        
+        PyObject* entry = Py_BuildValue("{s:s,s:i,s:K,s:K,s:d,s:d,s:d,s:d,s:n}",
+                                        "name", stage.name.c_str(),
+                                        "workers", stage.workers,
+                                        "processed", static_cast<unsigned long long>(stage.processed),
+                                        "errors", static_cast<unsigned long long>(stage.errors),
+                                        "busy_time", stage.busy_time,
+                                        "input_wait_time", stage.input_wait_time,
+                                        "output_wait_time", stage.output_wait_time,
+                                        "utilization", utilization,
+                                        "queued", static_cast<Py_ssize_t>(stage.queued));
+        if (!entry || PyList_Append(stages, entry) < 0) {
+            Py_XDECREF(entry);
+            Py_DECREF(stages);
+            return nullptr;
+        }
+        Py_DECREF(entry);
+    }
+    
+    return Py_BuildValue("{s:d,s:N,s:s}", "elapsed", elapsed, "stages", stages, "bottleneck", bottleneck);
+}
+
+static PyMethodDef PipelineMethods[] = {
+    {"put", reinterpret_cast<PyCFunction>(pipeline_put), METH_VARARGS, "Feed an item, blocking while the first stage is full; returns its sequence number"},
+    {"get", reinterpret_cast<PyCFunction>(pipeline_get), METH_VARARGS, "Next (seq, result) in completion order, None once drained; raises a stage's exception"},
+    {"close", reinterpret_cast<PyCFunction>(pipeline_close), METH_NOARGS, "Stop accepting input; stages finish what is queued"},
+    {"run", reinterpret_cast<PyCFunction>(pipeline_run), METH_VARARGS, "Feed all items, close, and return results in input order"},
+    {"stats", reinterpret_cast<PyCFunction>(pipeline_stats), METH_NOARGS, "Per-stage counts and timings, plus the bottleneck stage"},
+    {nullptr, nullptr, 0, nullptr}
+};
+
+static bool init_pipeline_type() {
+    if (PyPipelineType.tp_flags & Py_TPFLAGS_READY) {
+        return true;
+    }
+    
+    PyPipelineType.tp_name = "parallel_executor.Pipeline";
+    PyPipelineType.tp_doc = "Pipeline(stages, capacity=16)\n\n"
+                            "Stages connected by bounded channels of `capacity` items. Each stage is a callable "
+                            "or a (callable, workers[, name]) tuple; a full channel blocks the stage feeding it.";
+    PyPipelineType.tp_basicsize = sizeof(PyPipeline);
+    PyPipelineType.tp_flags = Py_TPFLAGS_DEFAULT;
+    PyPipelineType.tp_new = PyType_GenericNew;
+    PyPipelineType.tp_init = reinterpret_cast<initproc>(pipeline_init);
+    PyPipelineType.tp_dealloc = reinterpret_cast<destructor>(pipeline_dealloc);
+    PyPipelineType.tp_iter = PyObject_SelfIter;
+    PyPipelineType.tp_iternext = reinterpret_cast<iternextfunc>(pipeline_iternext);
+    PyPipelineType.tp_methods = PipelineMethods;
+    return PyType_Ready(&PyPipelineType) == 0;
 }
 
 static PyObject* wait_for_completion(PyObject* self, PyObject* args) {
-    if (!g_executor) {
+    std::shared_ptr<ParallelExecutor> executor = get_executor();
+    if (!executor) {
         PyErr_SetString(PyExc_RuntimeError, "Parallel executor not initialized");
         return nullptr;
     }
     
-    g_executor->wait_for_all();
+    // Workers need the GIL to run Python tasks, so never wait while holding it
+    Py_BEGIN_ALLOW_THREADS
+    executor->wait_for_all();
+    Py_END_ALLOW_THREADS
     Py_RETURN_NONE;
 }
 
 static PyObject* get_executor_stats(PyObject* self, PyObject* args) {
-    if (!g_executor) {
+    std::shared_ptr<ParallelExecutor> executor = get_executor();
+    if (!executor) {
         PyErr_SetString(PyExc_RuntimeError, "Parallel executor not initialized");
         return nullptr;
     }
     
-    auto stats = g_executor->get_stats();
+    auto stats = executor->get_stats();
     
     PyObject* result = PyDict_New();
     PyDict_SetItemString(result, "num_threads", PyLong_FromLong(stats.num_threads));
     PyDict_SetItemString(result, "active_tasks", PyLong_FromLong(stats.active_tasks));
+    PyDict_SetItemString(result, "pending_tasks", PyLong_FromLongLong(stats.pending_tasks));
     PyDict_SetItemString(result, "completed_tasks", PyLong_FromUnsignedLongLong(stats.completed_tasks));
+    PyDict_SetItemString(result, "stolen_tasks", PyLong_FromUnsignedLongLong(stats.stolen_tasks));
     PyDict_SetItemString(result, "total_execution_time", PyLong_FromUnsignedLongLong(stats.total_execution_time));
     PyDict_SetItemString(result, "average_task_time", PyFloat_FromDouble(stats.average_task_time));
     
@@ -320,36 +1223,97 @@ static PyObject* get_executor_stats(PyObject* self, PyObject* args) {
 }
 
 static PyObject* shutdown_executor(PyObject* self, PyObject* args) {
-    if (g_executor) {
-        g_executor->shutdown();
-        g_executor.reset();
+    std::shared_ptr<ParallelExecutor> executor;
+    std::shared_ptr<TaskScheduler> scheduler;
+    {
+        std::lock_guard<std::mutex> lock(g_executor_mutex);
+        executor.swap(g_executor);
+        scheduler.swap(g_scheduler);
     }
     
-    if (g_scheduler) {
-        g_scheduler.reset();
+    // Joining drains queued Python tasks, which need the GIL
+    Py_BEGIN_ALLOW_THREADS
+    if (executor) {
+        executor->shutdown();
     }
+    scheduler.reset();
+    Py_END_ALLOW_THREADS
     
     Py_RETURN_NONE;
 }
 
 static PyMethodDef ParallelExecutorMethods[] = {
-    {"init_executor", init_parallel_executor, METH_VARARGS, "Initialize parallel executor"},
-    {"init_scheduler", init_task_scheduler, METH_VARARGS, "Initialize task scheduler"},
-    {"submit_task", submit_task, METH_VARARGS, "Submit task for parallel execution"},
+    {"init_executor", init_parallel_executor, METH_VARARGS, "Initialize parallel executor: (num_threads=0, pin_threads=False, numa_node=-1)"},
+    {"init_scheduler", init_task_scheduler, METH_VARARGS, "Initialize task scheduler: (num_executors=1, threads_per_executor=0, numa_aware=False)"},
+    {"submit_task", submit_task, METH_VARARGS, "Submit callable(*args) for parallel execution; returns a NativeFuture"},
+    {"submit_many", submit_many, METH_VARARGS, "Submit callable once per argument tuple; returns a list of NativeFutures"},
+    {"map", map_tasks, METH_VARARGS, "Run callable over argument tuples and return the results in order (optional overall timeout)"},
     {"wait_for_completion", wait_for_completion, METH_VARARGS, "Wait for all tasks to complete"},
     {"get_stats", get_executor_stats, METH_VARARGS, "Get executor statistics"},
     {"shutdown", shutdown_executor, METH_VARARGS, "Shutdown executor"},
     {nullptr, nullptr, 0, nullptr}
 };
 
+static int parallel_executor_exec(PyObject* module) {
+    if (!init_native_future_type()) {
+        return -1;
+    }
+    
+    Py_INCREF(&PyNativeFutureType);
+    if (PyModule_AddObject(module, "NativeFuture", reinterpret_cast<PyObject*>(&PyNativeFutureType)) < 0) {
+        Py_DECREF(&PyNativeFutureType);
+        return -1;
+    }
+    
+    if (!init_pipeline_type()) {
+        return -1;
+    }
+    
+    Py_INCREF(&PyPipelineType);
+    if (PyModule_AddObject(module, "Pipeline", reinterpret_cast<PyObject*>(&PyPipelineType)) < 0) {
+        Py_DECREF(&PyPipelineType);
+        return -1;
+    }
+    
+    // Drain the workers before finalization; a task still holding a future
+    // would otherwise take the GIL from a dying interpreter
+    PyObject* atexit = PyImport_ImportModule("atexit");
+    if (!atexit) {
+        return -1;
+    }
+    PyObject* shutdown = PyObject_GetAttrString(module, "shutdown");
+    PyObject* ret = shutdown ? PyObject_CallMethod(atexit, "register", "O", shutdown) : nullptr;
+    Py_XDECREF(shutdown);
+    Py_DECREF(atexit);
+    if (!ret) {
+        return -1;
+    }
+    Py_DECREF(ret);
+    return 0;
+}
+
+// Workers attach through PyGILState_Ensure, which only knows the main
+// interpreter, so sub-interpreters cannot use this module
+static PyModuleDef_Slot ParallelExecutorSlots[] = {
+    {Py_mod_exec, reinterpret_cast<void*>(parallel_executor_exec)},
+#if PY_VERSION_HEX >= 0x030C0000
+    {Py_mod_multiple_interpreters, Py_MOD_MULTIPLE_INTERPRETERS_NOT_SUPPORTED},
+#endif
+#if PY_VERSION_HEX >= 0x030D0000
+    {Py_mod_gil, Py_MOD_GIL_NOT_USED},
+#endif
+    {0, nullptr}
+};
+
 static struct PyModuleDef parallelexecutormodule = {
     PyModuleDef_HEAD_INIT,
     "parallel_executor",
     "Parallel execution utilities",
-    -1,
-    ParallelExecutorMethods
+    0,
+    ParallelExecutorMethods,
+    ParallelExecutorSlots
 };
 
 PyMODINIT_FUNC PyInit_parallel_executor(void) {
-    return PyModule_Create(&parallelexecutormodule);
-}
\ No newline at end of file
+    return PyModuleDef_Init(&parallelexecutormodule);
+}
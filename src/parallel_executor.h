@@ -0,0 +1,476 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cpu_topology.h"
+#include "tracing.h"
+
+// Work-stealing thread pool behind the parallel_executor module, shared
+// with native modules that spread their own work over every core (the
+// corpus scanner). Header-only: each user creates its own executor.
+
+// Chase-Lev work-stealing deque (Le et al., "Correct and Efficient
+// Work-Stealing for Weak Memory Models"). The owning worker pushes and pops
+// at the bottom; other workers steal from the top. Only the owner grows the
+// ring, and retired rings are kept until destruction because a thief may
+// still be reading one.
+template <typename T>
+class ChaseLevDeque {
+private:
+    struct Ring {
+        int64_t capacity;
+        int64_t mask;
+        std::unique_ptr<std::atomic<T*>[]> items;
+        
+        explicit Ring(int64_t cap) : capacity(cap), mask(cap - 1), items(new std::atomic<T*>[cap]) {}
+        
+        T* get(int64_t i) const {
+            return items[i & mask].load(std::memory_order_relaxed);
+        }
+        
+        void put(int64_t i, T* item) {
+            items[i & mask].store(item, std::memory_order_relaxed);
+        }
+    };
+    
+    alignas(64) std::atomic<int64_t> top{0};
+    alignas(64) std::atomic<int64_t> bottom{0};
+    alignas(64) std::atomic<Ring*> ring;
+    std::vector<std::unique_ptr<Ring>> rings;
+    
+public:
+    explicit ChaseLevDeque(int64_t capacity = 256) {
+        rings.push_back(std::make_unique<Ring>(capacity));
+        ring.store(rings.back().get(), std::memory_order_relaxed);
+    }
+    
+    // Owner only
+    void push(T* item) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        Ring* r = ring.load(std::memory_order_relaxed);
+        if (b - t > r->capacity - 1) {
+            r = grow(r, t, b);
+        }
+        r->put(b, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    
+    // Owner only; nullptr when empty
+    T* pop() {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Ring* r = ring.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        
+        T* item = r->get(b);
+        if (t == b) {
+            // Last item: race thieves for it
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+    
+    // Any thread; nullptr when empty or when another thief won the race
+    T* steal() {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return nullptr;
+        }
+        
+        Ring* r = ring.load(std::memory_order_acquire);
+        T* item = r->get(t);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return item;
+    }
+    
+    bool empty() const {
+        return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+    }
+    
+private:
+    Ring* grow(Ring* old_ring, int64_t t, int64_t b) {
+        auto bigger = std::make_unique<Ring>(old_ring->capacity * 2);
+        for (int64_t i = t; i < b; ++i) {
+            bigger->put(i, old_ring->get(i));
+        }
+        Ring* r = bigger.get();
+        rings.push_back(std::move(bigger));
+        ring.store(r, std::memory_order_release);
+        return r;
+    }
+};
+
+// Work-stealing executor. Each worker runs tasks from its own deque first
+// (tasks submitted from inside a task land there), then from the shared
+// injection queue that external submits use, then steals from a random
+// peer. Idle workers spin briefly, then sleep until work is queued.
+class ParallelExecutor {
+private:
+    using Task = std::function<void()>;
+    
+    struct alignas(64) Worker {
+        ChaseLevDeque<Task> deque;
+        uint64_t rng_state;
+    };
+    
+    // Identifies the executor and worker the current thread belongs to
+    struct WorkerContext {
+        ParallelExecutor* executor = nullptr;
+        size_t index = 0;
+    };
+    
+    static WorkerContext& current_worker() {
+        thread_local WorkerContext context;
+        return context;
+    }
+    
+    std::vector<std::thread> threads;
+    std::vector<std::unique_ptr<Worker>> workers;
+    
+    // Injection queue for submits from non-worker threads
+    std::mutex injection_mutex;
+    std::deque<Task*> injection_queue;
+    
+    // Sleeping workers wait here until pending_tasks becomes non-zero
+    std::mutex sleep_mutex;
+    std::condition_variable sleep_condition;
+    std::atomic<int> sleeping_workers{0};
+    
+    std::mutex idle_mutex;
+    std::condition_variable idle_condition;
+    
+    std::atomic<bool> stop{false};
+    std::atomic<int64_t> pending_tasks{0};
+    std::atomic<int> active_tasks{0};
+    std::atomic<uint64_t> completed_tasks{0};
+    std::atomic<uint64_t> total_execution_time{0};
+    std::atomic<uint64_t> stolen_tasks{0};
+    
+    int num_threads;
+    
+    static constexpr int kSpinRounds = 64;
+    
+public:
+    // With `pin_threads` each worker is pinned to its own core (see
+    // cpu_topology::placement). A `numa_node` >= 0 keeps the workers on
+    // that node and defaults the thread count to its CPUs.
+    ParallelExecutor(int threads_count = 0, bool pin_threads = false, int numa_node = -1) : num_threads(threads_count) {
+        const cpu_topology::Topology& topology = cpu_topology::get();
+        if (num_threads <= 0 && numa_node >= 0 && static_cast<size_t>(numa_node) < topology.node_cpus.size()) {
+            num_threads = static_cast<int>(topology.node_cpus[numa_node].size());
+        }
+        if (num_threads <= 0) {
+            num_threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        
+        for (int i = 0; i < num_threads; ++i) {
+            workers.push_back(std::make_unique<Worker>());
+            workers.back()->rng_state = 0x9E3779B97F4A7C15ull * (i + 1);
+        }
+        
+        std::vector<int> cpus;
+        if (pin_threads) {
+            cpus = cpu_topology::placement(num_threads, numa_node);
+        }
+        
+        // Start worker threads
+        for (int i = 0; i < num_threads; ++i) {
+            int cpu = static_cast<size_t>(i) < cpus.size() ? cpus[i] : -1;
+            threads.emplace_back([this, i, cpu, numa_node]() {
+                tracing::set_thread_name("executor-" + std::to_string(i));
+                if (cpu >= 0) {
+                    cpu_topology::pin_current_thread(cpu);
+                } else if (numa_node >= 0) {
+                    cpu_topology::pin_current_thread_to_node(numa_node);
+                }
+                worker_loop(static_cast<size_t>(i));
+            });
+        }
+    }
+    
+    ~ParallelExecutor() {
+        shutdown();
+    }
+    
+    // Submit task for execution
+    template<typename F, typename... Args>
+    auto submit(F&& f, Args&&... args) -> std::future<decltype(f(args...))> {
+        using ReturnType = decltype(f(args...));
+        
+        auto task = std::make_shared<std::packaged_task<ReturnType()>>(
+            std::bind(std::forward<F>(f), std::forward<Args>(args)...)
+        );
+        
+        std::future<ReturnType> result = task->get_future();
+        
+        if (stop) {
+            throw std::runtime_error("Executor has been stopped");
+        }
+        // The queue wait ends where the task's span starts, on the worker
+        // that ran it
+        uint64_t queued = tracing::enabled(tracing::EXECUTOR) ? tracing::now_ns() : 0;
+        schedule(new Task([task, queued]() {
+            if (queued) {
+                tracing::record_wait(tracing::EXECUTOR, "executor.queue_wait", queued, tracing::now_ns());
+            }
+            tracing::Span span(tracing::EXECUTOR, "executor.task");
+            (*task)();
+        }));
+        return result;
+    }
+    
+    // Submit multiple tasks in batch
+    template<typename F, typename Iterator>
+    std::vector<std::future<void>> submit_batch(F&& f, Iterator begin, Iterator end) {
+        std::vector<std::future<void>> futures;
+        futures.reserve(std::distance(begin, end));
+        
+        for (auto it = begin; it != end; ++it) {
+            futures.push_back(submit(f, *it));
+        }
+        
+        return futures;
+    }
+    
+    // Wait for all tasks to complete
+    void wait_for_all() {
+        std::unique_lock<std::mutex> lock(idle_mutex);
+        idle_condition.wait(lock, [this]() {
+            return pending_tasks == 0 && active_tasks == 0;
+        });
+    }
+    
+    // The executor the calling thread is a worker of, nullptr on other threads
+    static ParallelExecutor* current() {
+        return current_worker().executor;
+    }
+    
+    // Run one queued task on the calling worker, as its own loop would;
+    // false if nothing was queued or the caller is not one of its workers.
+    // A task waiting on tasks it submitted calls this so its worker keeps
+    // draining the queues instead of blocking a full pool.
+    bool run_pending_task() {
+        WorkerContext& context = current_worker();
+        if (context.executor != this) {
+            return false;
+        }
+        Task* task = find_task(context.index);
+        if (!task) {
+            return false;
+        }
+        run_task(task);
+        return true;
+    }
+    
+    // Queued plus running tasks
+    int64_t load() const {
+        return pending_tasks.load(std::memory_order_relaxed) + active_tasks.load(std::memory_order_relaxed);
+    }
+    
+    // Get execution statistics
+    struct Stats {
+        int num_threads;
+        int active_tasks;
+        int64_t pending_tasks;
+        uint64_t completed_tasks;
+        uint64_t total_execution_time;
+        uint64_t stolen_tasks;
+        double average_task_time;
+    };
+    
+    Stats get_stats() const {
+        Stats stats;
+        stats.num_threads = num_threads;
+        stats.active_tasks = active_tasks;
+        stats.pending_tasks = pending_tasks;
+        stats.completed_tasks = completed_tasks;
+        stats.total_execution_time = total_execution_time;
+        stats.stolen_tasks = stolen_tasks;
+        stats.average_task_time = (completed_tasks > 0) ? 
+            static_cast<double>(total_execution_time) / completed_tasks : 0.0;
+        return stats;
+    }
+    
+    // Shutdown executor; queued tasks still run
+    void shutdown() {
+        stop = true;
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+        }
+        sleep_condition.notify_all();
+        
+        for (std::thread& worker : threads) {
+            if (worker.joinable()) {
+                worker.join();
+            }
+        }
+        
+        threads.clear();
+        
+        // A submit racing with shutdown can land after the workers exited;
+        // run it here so its future is still satisfied
+        std::vector<Task*> leftovers;
+        for (auto& worker : workers) {
+            while (Task* task = worker->deque.pop()) {
+                leftovers.push_back(task);
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(injection_mutex);
+            leftovers.insert(leftovers.end(), injection_queue.begin(), injection_queue.end());
+            injection_queue.clear();
+        }
+        for (Task* task : leftovers) {
+            (*task)();
+            delete task;
+            pending_tasks--;
+            completed_tasks++;
+        }
+    }
+    
+private:
+    void schedule(Task* task) {
+        // Count before publishing so sleepers never miss queued work
+        pending_tasks++;
+        
+        WorkerContext& context = current_worker();
+        if (context.executor == this) {
+            workers[context.index]->deque.push(task);
+        } else {
+            std::lock_guard<std::mutex> lock(injection_mutex);
+            injection_queue.push_back(task);
+        }
+        
+        if (sleeping_workers > 0) {
+            {
+                std::lock_guard<std::mutex> lock(sleep_mutex);
+            }
+            sleep_condition.notify_one();
+        }
+    }
+    
+    Task* find_task(size_t index) {
+        Worker& self = *workers[index];
+        if (Task* task = self.deque.pop()) {
+            return task;
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(injection_mutex);
+            if (!injection_queue.empty()) {
+                Task* task = injection_queue.front();
+                injection_queue.pop_front();
+                return task;
+            }
+        }
+        
+        // Steal from peers, starting at a random victim
+        size_t n = workers.size();
+        self.rng_state ^= self.rng_state << 13;
+        self.rng_state ^= self.rng_state >> 7;
+        self.rng_state ^= self.rng_state << 17;
+        size_t start = static_cast<size_t>(self.rng_state % n);
+        for (size_t k = 0; k < n; ++k) {
+            size_t victim = (start + k) % n;
+            if (victim == index) {
+                continue;
+            }
+            if (Task* task = workers[victim]->deque.steal()) {
+                stolen_tasks++;
+                return task;
+            }
+        }
+        return nullptr;
+    }
+    
+    void worker_loop(size_t index) {
+        current_worker() = {this, index};
+        int idle_rounds = 0;
+        
+        while (true) {
+            Task* task = find_task(index);
+            
+            if (!task) {
+                if (stop && pending_tasks == 0) {
+                    return;
+                }
+                
+                // Idle backoff: spin, then yield, then sleep until work is queued
+                if (++idle_rounds < kSpinRounds) {
+                    continue;
+                }
+                if (idle_rounds < 2 * kSpinRounds) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                
+                std::unique_lock<std::mutex> lock(sleep_mutex);
+                sleeping_workers++;
+                sleep_condition.wait(lock, [this]() {
+                    return stop || pending_tasks > 0;
+                });
+                sleeping_workers--;
+                idle_rounds = 0;
+                continue;
+            }
+            idle_rounds = 0;
+            run_task(task);
+        }
+    }
+    
+    void run_task(Task* task) {
+        active_tasks++;
+        pending_tasks--;
+        
+        // Execute task
+        auto start_time = std::chrono::high_resolution_clock::now();
+        (*task)();
+        delete task;
+        auto end_time = std::chrono::high_resolution_clock::now();
+        
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+            end_time - start_time).count();
+        
+        total_execution_time += duration;
+        completed_tasks++;
+        
+        // Decrement under the lock so wait_for_all cannot miss the wakeup
+        bool idle;
+        {
+            std::unique_lock<std::mutex> lock(idle_mutex);
+            idle = --active_tasks == 0 && pending_tasks == 0;
+        }
+        if (idle) {
+            idle_condition.notify_all();
+        }
+    }
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Vectorized alphabet-mapping kernels, implemented in cpu_optimizer.cpp and
+// dispatched at runtime to the best instruction set the CPU supports.
+//
+// All levels produce byte-identical output, so seeded credential streams do
+// not depend on the machine that generated them.
+namespace simd_kernels {
+
+enum class Level {
+    SCALAR = 0,
+    SSSE3 = 1,       // pshufb, 16 bytes per step
+    AVX2 = 2,        // vpshufb, 32 bytes per step
+    AVX512VBMI = 3   // vpermb, 64 bytes per step
+};
+
+// Best level supported by this CPU (detected once)
+Level detected_level();
+
+// Level used for dispatch: the detected level unless overridden
+Level active_level();
+
+// Force a lower level (for benchmarks and testing); clamped to detected_level()
+void set_level_override(Level level);
+void clear_level_override();
+
+const char* level_name(Level level);
+
+// Map random bytes onto an alphabet of k <= 64 symbols. `table` holds the
+// k symbols in its first k entries (64 bytes readable). Each input byte is
+// masked to the next power of two >= k and rejected if the index is >= k.
+// Stops when `out_capacity` symbols are written or input is exhausted;
+// returns the number written.
+size_t map_alphabet(const uint8_t* in, size_t n, const char* table, size_t k,
+                    char* out, size_t out_capacity);
+
+// Standard base64 encoding of binary input with a 64-symbol table
+// (standard or URL-safe). Writes 4 * ceil(n / 3) bytes when `pad` is set,
+// otherwise omits trailing '='. Returns the number of bytes written.
+size_t base64_encode(const uint8_t* in, size_t n, const char* table, char* out, bool pad);
+
+// Encoded length for base64_encode
+inline size_t base64_encoded_size(size_t n, bool pad) {
+    return pad ? ((n + 2) / 3) * 4 : (n * 4 + 2) / 3;
+}
+
+// Bucketed two-byte fingerprints for finding up to 8 groups of literals
+// in one pass (a "Teddy" prefilter). A literal may start at position i in
+// bucket b when bit b is set in
+//   lo[0][d[i] & 15] & hi[0][d[i] >> 4] & lo[1][d[i+1] & 15] & hi[1][d[i+1] >> 4]
+// Hits are candidates only; callers compare the literals themselves.
+struct LiteralMasks {
+    uint8_t lo[2][16];
+    uint8_t hi[2][16];
+};
+
+// Record each position in [pos, n - 1) whose fingerprint hits a bucket as
+// (position << 8 | bucket bits), until `capacity` hits are stored, and
+// advance `pos` past the bytes scanned (to n once done). Only positions
+// with a following byte are tested, so literals need at least two bytes.
+// Returns the number of hits stored.
+size_t literal_candidates(const uint8_t* data, size_t n, size_t& pos, const LiteralMasks& masks,
+                          uint64_t* hits, size_t capacity);
+
+extern const char kHexLowerTable[64];
+extern const char kBase64Table[64];
+extern const char kBase64UrlTable[64];
+
+}  // namespace simd_kernels
@@ -0,0 +1,980 @@
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#include "memory_arena.h"
+
+extern "C" {
+    #define PY_SSIZE_T_CLEAN
+    #include <Python.h>
+}
+
+#include "credential_generate.h"
+#include "credential_views.h"
+#include "native_buffer.h"
+#include "tracing.h"
+
+// Document skeletons compiled once per format: the source is split into
+// literal segments and typed slots when the Template is built, so
+// producing a document only generates the credentials (one locked batch
+// for all of them), escapes the fresh values and gathers segments and
+// values into the output with writev(). Nothing about the layout is
+// looked at again per file.
+//
+// Slots are written {{kind[:argument]}}:
+//   {{credential:TYPE}}       a fresh credential of TYPE
+//   {{credential:TYPE:KEY}}   the same credential wherever TYPE:KEY recurs
+//   {{paragraph}}             the next paragraph; {{paragraph:N}} the Nth
+//   {{company}}               the company name
+//   {{field:NAME}}            a named value (title, topic, date)
+
+namespace {
+
+#ifndef _WIN32
+#ifdef IOV_MAX
+constexpr int kMaxIovecs = IOV_MAX;
+#else
+constexpr int kMaxIovecs = 1024;
+#endif
+#endif
+
+enum class Escape { NONE, XML, RTF };
+
+bool parse_escape(std::string_view name, Escape& escape) {
+    if (name == "none") {
+        escape = Escape::NONE;
+    } else if (name == "xml") {
+        escape = Escape::XML;
+    } else if (name == "rtf") {
+        escape = Escape::RTF;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Next code point of UTF-8 text; invalid bytes decode as themselves
+uint32_t next_code_point(std::string_view text, size_t& i) {
+    unsigned char c = static_cast<unsigned char>(text[i++]);
+    int extra = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : 0;
+    if (extra == 0 || i + extra > text.size()) {
+        return c;
+    }
+    uint32_t cp = c & (0x3F >> extra);
+    for (int k = 0; k < extra; ++k) {
+        cp = (cp << 6) | (static_cast<unsigned char>(text[i++]) & 0x3F);
+    }
+    return cp;
+}
+
+// Escaped form of one byte (XML) or code point (RTF); null when it is
+// copied as is. `scratch` holds numeric escapes.
+const char* xml_escape(unsigned char c) {
+    switch (c) {
+        case '&': return "&amp;";
+        case '<': return "&lt;";
+        case '>': return "&gt;";
+        case '"': return "&quot;";
+        default:
+            // XML 1.0 cannot represent other control characters; drop them
+            return c < 0x20 && c != '\t' && c != '\n' && c != '\r' ? "" : nullptr;
+    }
+}
+
+void append_rtf_unicode(std::string& out, uint32_t cp) {
+    char code[16];
+    std::snprintf(code, sizeof(code), "\\u%d?", static_cast<int>(static_cast<int16_t>(cp)));
+    out += code;
+}
+
+// Values that need no escaping are passed through without a copy
+bool needs_escape(std::string_view text, Escape escape) {
+    for (char ch : text) {
+        unsigned char c = static_cast<unsigned char>(ch);
+        if (escape == Escape::XML ? xml_escape(c) != nullptr
+                                  : c >= 0x80 || c == '\\' || c == '{' || c == '}' || c == '\n' || c == '\t') {
+            return true;
+        }
+    }
+    return false;
+}
+
+void append_escaped(std::string& out, std::string_view text, Escape escape) {
+    if (escape == Escape::XML) {
+        size_t run = 0;
+        for (size_t i = 0; i < text.size(); ++i) {
+            const char* entity = xml_escape(static_cast<unsigned char>(text[i]));
+            if (entity) {
+                out.append(text.data() + run, i - run);
+                out += entity;
+                run = i + 1;
+            }
+        }
+        out.append(text.data() + run, text.size() - run);
+        return;
+    }
+
+    for (size_t i = 0; i < text.size();) {
+        char c = text[i];
+        if (static_cast<unsigned char>(c) >= 0x80) {
+            uint32_t cp = next_code_point(text, i);
+            if (cp > 0xFFFF) {
+                // Outside the BMP: as a UTF-16 surrogate pair
+                cp -= 0x10000;
+                append_rtf_unicode(out, 0xD800 + (cp >> 10));
+                append_rtf_unicode(out, 0xDC00 + (cp & 0x3FF));
+            } else {
+                append_rtf_unicode(out, cp);
+            }
+            continue;
+        }
+        ++i;
+        switch (c) {
+            case '\\': out += "\\\\"; break;
+            case '{': out += "\\{"; break;
+            case '}': out += "\\}"; break;
+            case '\n': out += "\\line "; break;
+            case '\t': out += "\\tab "; break;
+            case '\r': break;
+            default: out += c;
+        }
+    }
+}
+
+// Values of one document, viewed in place in the Python arguments
+struct DocumentValues {
+    std::vector<std::string_view> paragraphs;  // Missing paragraphs render empty
+    std::string_view company;
+    std::vector<std::string_view> fields;      // By field number; missing ones render empty
+};
+
+// A compiled skeleton. Immutable once compiled, so any number of threads
+// render from it at once.
+class TemplateProgram {
+public:
+    struct Piece {
+        enum Kind : uint8_t { LITERAL, CREDENTIAL, PARAGRAPH, COMPANY, FIELD };
+        Kind kind;
+        uint32_t index;  // CREDENTIAL: value number; PARAGRAPH: paragraph; FIELD: field
+        size_t offset;   // LITERAL: span of `literals`
+        size_t length;
+    };
+
+    bool compile(std::string_view source, std::string_view open, std::string_view close,
+                 Escape value_escape, std::string& error) {
+        escape = value_escape;
+        std::unordered_map<std::string, uint32_t> keyed_values;
+        std::unordered_map<std::string, uint32_t> field_numbers;
+        uint32_t next_paragraph = 0;
+
+        size_t at = 0;
+        while (at <= source.size()) {
+            size_t start = source.find(open, at);
+            add_literal(source.substr(at, start == std::string_view::npos ? std::string_view::npos : start - at));
+            if (start == std::string_view::npos) {
+                break;
+            }
+            size_t end = source.find(close, start + open.size());
+            if (end == std::string_view::npos) {
+                error = "Unterminated slot at byte " + std::to_string(start);
+                return false;
+            }
+            std::string_view slot = trim(source.substr(start + open.size(), end - start - open.size()));
+            at = end + close.size();
+
+            std::string_view kind = slot.substr(0, slot.find(':'));
+            std::string_view argument = kind.size() < slot.size() ? trim(slot.substr(kind.size() + 1)) : "";
+            kind = trim(kind);
+            Piece piece = {Piece::LITERAL, 0, 0, 0};
+
+            if (kind == "credential") {
+                std::string_view type = argument.substr(0, argument.find(':'));
+                std::string key = type.size() < argument.size() ? std::string(argument) : std::string();
+                type = trim(type);
+                if (type.empty()) {
+                    error = "Credential slot without a type at byte " + std::to_string(start);
+                    return false;
+                }
+                if (!credential_generate::supported(std::string(type))) {
+                    error = "Unknown credential type in template: " + std::string(type);
+                    return false;
+                }
+                piece.kind = Piece::CREDENTIAL;
+                auto keyed = key.empty() ? keyed_values.end() : keyed_values.find(key);
+                if (keyed != keyed_values.end()) {
+                    piece.index = keyed->second;
+                } else {
+                    piece.index = static_cast<uint32_t>(value_types.size());
+                    value_types.emplace_back(type);
+                    if (!key.empty()) {
+                        keyed_values.emplace(key, piece.index);
+                    }
+                }
+            } else if (kind == "paragraph") {
+                piece.kind = Piece::PARAGRAPH;
+                if (argument.empty()) {
+                    piece.index = next_paragraph++;
+                } else if (!parse_index(argument, piece.index)) {
+                    error = "Paragraph slots take a number: " + std::string(slot);
+                    return false;
+                }
+                paragraphs = std::max<size_t>(paragraphs, piece.index + 1);
+            } else if (kind == "company" && argument.empty()) {
+                piece.kind = Piece::COMPANY;
+            } else if (kind == "field" && !argument.empty()) {
+                piece.kind = Piece::FIELD;
+                auto inserted = field_numbers.emplace(std::string(argument), static_cast<uint32_t>(fields.size()));
+                if (inserted.second) {
+                    fields.emplace_back(argument);
+                }
+                piece.index = inserted.first->second;
+            } else {
+                error = "Unknown template slot: " + std::string(slot);
+                return false;
+            }
+            pieces.push_back(piece);
+            ++slot_count;
+        }
+        return true;
+    }
+
+    // Assemble one document as (data, size) views into the template, the
+    // values and `credentials`, whose offsets hold one span per value
+    // number. Escaped copies of values are allocated from `arena`.
+    size_t assemble(const DocumentValues& values, const char* credentials, const uint64_t* offsets,
+                    memory_arena::Arena& arena, std::string& escaped,
+                    memory_arena::ArenaVector<std::pair<const char*, size_t>>& views) const {
+        views.clear();
+        views.reserve(pieces.size());
+        size_t total = 0;
+        for (const Piece& piece : pieces) {
+            std::string_view text;
+            switch (piece.kind) {
+                case Piece::LITERAL:
+                    text = std::string_view(literals.data() + piece.offset, piece.length);
+                    break;
+                case Piece::CREDENTIAL:
+                    text = std::string_view(credentials + offsets[piece.index],
+                                            offsets[piece.index + 1] - offsets[piece.index]);
+                    break;
+                case Piece::PARAGRAPH:
+                    text = piece.index < values.paragraphs.size() ? values.paragraphs[piece.index] : "";
+                    break;
+                case Piece::COMPANY:
+                    text = values.company;
+                    break;
+                case Piece::FIELD:
+                    text = piece.index < values.fields.size() ? values.fields[piece.index] : "";
+                    break;
+            }
+            if (piece.kind != Piece::LITERAL && escape != Escape::NONE && needs_escape(text, escape)) {
+                escaped.clear();
+                append_escaped(escaped, text, escape);
+                char* copy = arena.allocate_array<char>(escaped.size());
+                std::memcpy(copy, escaped.data(), escaped.size());
+                text = std::string_view(copy, escaped.size());
+            }
+            if (!text.empty()) {
+                views.emplace_back(text.data(), text.size());
+                total += text.size();
+            }
+        }
+        documents.fetch_add(1, std::memory_order_relaxed);
+        bytes_out.fetch_add(total, std::memory_order_relaxed);
+        return total;
+    }
+
+    const std::vector<Piece>& all_pieces() const {
+        return pieces;
+    }
+
+    const std::vector<std::string>& credential_types() const {
+        return value_types;
+    }
+
+    const std::vector<std::string>& field_names() const {
+        return fields;
+    }
+
+    size_t paragraph_count() const {
+        return paragraphs;
+    }
+
+    size_t slots() const {
+        return slot_count;
+    }
+
+    size_t literal_bytes() const {
+        return literals.size();
+    }
+
+    uint64_t documents_rendered() const {
+        return documents.load(std::memory_order_relaxed);
+    }
+
+    uint64_t bytes_rendered() const {
+        return bytes_out.load(std::memory_order_relaxed);
+    }
+
+private:
+    // Adjacent literals (around an empty source slot, say) are merged
+    void add_literal(std::string_view text) {
+        if (text.empty()) {
+            return;
+        }
+        if (!pieces.empty() && pieces.back().kind == Piece::LITERAL) {
+            pieces.back().length += text.size();
+        } else {
+            pieces.push_back({Piece::LITERAL, 0, literals.size(), text.size()});
+        }
+        literals.append(text);
+    }
+
+    static std::string_view trim(std::string_view text) {
+        size_t first = text.find_first_not_of(" \t\r\n");
+        if (first == std::string_view::npos) {
+            return "";
+        }
+        return text.substr(first, text.find_last_not_of(" \t\r\n") - first + 1);
+    }
+
+    static bool parse_index(std::string_view text, uint32_t& index) {
+        if (text.empty() || text.size() > 6) {
+            return false;
+        }
+        index = 0;
+        for (char c : text) {
+            if (c < '0' || c > '9') {
+                return false;
+            }
+            index = index * 10 + static_cast<uint32_t>(c - '0');
+        }
+        return true;
+    }
+
+    std::string literals;
+    std::vector<Piece> pieces;
+    std::vector<std::string> value_types;  // Credential type per value number
+    std::vector<std::string> fields;
+    size_t paragraphs = 0;
+    size_t slot_count = 0;
+    Escape escape = Escape::NONE;
+    mutable std::atomic<uint64_t> documents{0};
+    mutable std::atomic<uint64_t> bytes_out{0};
+};
+
+using ViewVector = memory_arena::ArenaVector<std::pair<const char*, size_t>>;
+
+// Gather the views into `path` with writev, as few system calls as the
+// iovec limit allows
+bool write_views(const std::string& path, const ViewVector& views, std::string& error) {
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        error = "Cannot create " + path + ": " + std::strerror(errno);
+        return false;
+    }
+
+    memory_arena::Scope scratch;
+    iovec* iov = scratch.arena().allocate_array<iovec>(std::min<size_t>(views.size(), kMaxIovecs) + 1);
+    size_t next = 0;
+    size_t skip = 0;  // Bytes of views[next] already written
+    while (next < views.size()) {
+        int n = 0;
+        for (size_t i = next; i < views.size() && n < kMaxIovecs; ++i, ++n) {
+            size_t offset = i == next ? skip : 0;
+            iov[n].iov_base = const_cast<char*>(views[i].first + offset);
+            iov[n].iov_len = views[i].second - offset;
+        }
+        ssize_t written = ::writev(fd, iov, n);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            error = "Cannot write " + path + ": " + std::strerror(errno);
+            ::close(fd);
+            return false;
+        }
+        // Advance past what was written; a short write resumes mid-view
+        size_t left = static_cast<size_t>(written);
+        while (next < views.size() && left >= views[next].second - skip) {
+            left -= views[next].second - skip;
+            skip = 0;
+            ++next;
+        }
+        skip += left;
+    }
+    if (::close(fd) != 0) {
+        error = "Cannot write " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    return true;
+#else
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        error = "Cannot create " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    for (const auto& view : views) {
+        if (std::fwrite(view.first, 1, view.second, file) != view.second) {
+            error = "Cannot write " + path + ": " + std::strerror(errno);
+            std::fclose(file);
+            return false;
+        }
+    }
+    if (std::fclose(file) != 0) {
+        error = "Cannot write " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    return true;
+#endif
+}
+
+}  // namespace
+
+// Python wrapper for TemplateProgram
+
+typedef struct {
+    PyObject_HEAD
+    TemplateProgram* program;
+} PyTemplate;
+
+static PyTypeObject PyTemplateType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+static bool text_view(PyObject* obj, std::string_view& text) {
+    const char* data;
+    Py_ssize_t size;
+    if (!credential_bytes(obj, data, size)) {
+        return false;
+    }
+    text = std::string_view(data, static_cast<size_t>(size));
+    return true;
+}
+
+static int template_init(PyTemplate* self, PyObject* args, PyObject* kwargs) {
+    static const char* kwlist[] = {"source", "options", nullptr};
+    PyObject* source_obj;
+    PyObject* options_obj = nullptr;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|O", const_cast<char**>(kwlist), &source_obj, &options_obj)) {
+        return -1;
+    }
+    if (self->program) {
+        // Renders may be running on it without the GIL
+        PyErr_SetString(PyExc_RuntimeError, "Template already initialized");
+        return -1;
+    }
+
+    std::string_view source;
+    if (!text_view(source_obj, source)) {
+        return -1;
+    }
+
+    Escape escape = Escape::NONE;
+    std::string open = "{{";
+    std::string close = "}}";
+    if (options_obj && options_obj != Py_None) {
+        if (!PyDict_Check(options_obj)) {
+            PyErr_SetString(PyExc_TypeError, "options must be a dict");
+            return -1;
+        }
+        PyObject* key;
+        PyObject* value;
+        Py_ssize_t pos = 0;
+        while (PyDict_Next(options_obj, &pos, &key, &value)) {
+            const char* name = PyUnicode_Check(key) ? PyUnicode_AsUTF8(key) : nullptr;
+            if (!name) {
+                PyErr_SetString(PyExc_TypeError, "Option names must be strings");
+                return -1;
+            }
+            if (std::strcmp(name, "escape") == 0) {
+                const char* mode = PyUnicode_Check(value) ? PyUnicode_AsUTF8(value) : nullptr;
+                if (!mode || !parse_escape(mode, escape)) {
+                    PyErr_SetString(PyExc_ValueError, "escape must be 'none', 'xml' or 'rtf'");
+                    return -1;
+                }
+            } else if (std::strcmp(name, "delimiters") == 0) {
+                const char* first;
+                const char* second;
+                if (!PyArg_ParseTuple(value, "ss", &first, &second)) {
+                    return -1;
+                }
+                if (!*first || !*second) {
+                    PyErr_SetString(PyExc_ValueError, "Delimiters cannot be empty");
+                    return -1;
+                }
+                open = first;
+                close = second;
+            } else {
+                PyErr_Format(PyExc_ValueError, "Unknown template option: %s", name);
+                return -1;
+            }
+        }
+    }
+
+    auto program = std::make_unique<TemplateProgram>();
+    std::string error;
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS
+    ok = program->compile(source, open, close, escape, error);
+    Py_END_ALLOW_THREADS
+    if (!ok) {
+        PyErr_SetString(PyExc_ValueError, error.c_str());
+        return -1;
+    }
+    self->program = program.release();
+    return 0;
+}
+
+static void template_dealloc(PyTemplate* self) {
+    delete self->program;
+    Py_TYPE(self)->tp_free(reinterpret_cast<PyObject*>(self));
+}
+
+static TemplateProgram* checked_program(PyTemplate* self) {
+    if (!self->program) {
+        PyErr_SetString(PyExc_RuntimeError, "Template not initialized");
+    }
+    return self->program;
+}
+
+// Arguments of one document. Views point into the argument objects, which
+// the caller keeps alive until the document is written.
+class DocumentInput {
+public:
+    bool parse(const TemplateProgram& program, PyObject* paragraphs_obj, PyObject* company_obj, PyObject* fields_obj) {
+        if (paragraphs_obj && paragraphs_obj != Py_None) {
+            // A lone string is one paragraph, not a sequence of characters
+            bool single = PyUnicode_Check(paragraphs_obj) || PyBytes_Check(paragraphs_obj);
+            PyObject* sequence = single ? PyTuple_Pack(1, paragraphs_obj) : Py_NewRef(paragraphs_obj);
+            bool parsed = sequence && paragraphs.parse(sequence, nullptr);
+            Py_XDECREF(sequence);
+            if (!parsed) {
+                return false;
+            }
+            for (size_t i = 0; i < paragraphs.size(); ++i) {
+                values.paragraphs.emplace_back(paragraphs[i].first, static_cast<size_t>(paragraphs[i].second));
+            }
+        }
+
+        if (company_obj && company_obj != Py_None && !text_view(company_obj, values.company)) {
+            return false;
+        }
+
+        values.fields.resize(program.field_names().size());
+        if (!fields_obj || fields_obj == Py_None) {
+            return true;
+        }
+        if (!PyDict_Check(fields_obj)) {
+            PyErr_SetString(PyExc_TypeError, "fields must be a dict");
+            return false;
+        }
+        for (size_t i = 0; i < values.fields.size(); ++i) {
+            PyObject* value = PyDict_GetItemString(fields_obj, program.field_names()[i].c_str());
+            if (value && value != Py_None) {
+                // Non-string values (dates, counts) are rendered with str()
+                PyObject* text = PyUnicode_Check(value) || PyBytes_Check(value) ? Py_NewRef(value) : PyObject_Str(value);
+                if (!text) {
+                    return false;
+                }
+                held.emplace_back(text);
+                if (!text_view(text, values.fields[i])) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    ~DocumentInput() {
+        for (PyObject* obj : held) {
+            Py_DECREF(obj);
+        }
+    }
+
+    DocumentValues values;
+
+private:
+    CredentialViews paragraphs;
+    std::vector<PyObject*> held;
+};
+
+// [(type, value), ...] for one document's credential values
+static PyObject* credential_list(const TemplateProgram& program, const std::string& buffer,
+                                 const std::vector<uint64_t>& offsets, size_t first) {
+    const std::vector<std::string>& types = program.credential_types();
+    PyObject* list = PyList_New(types.size());
+    if (!list) {
+        return nullptr;
+    }
+    for (size_t i = 0; i < types.size(); ++i) {
+        uint64_t start = offsets[first + i];
+        PyObject* item = Py_BuildValue("(s#s#)", types[i].data(), static_cast<Py_ssize_t>(types[i].size()),
+                                       buffer.data() + start, static_cast<Py_ssize_t>(offsets[first + i + 1] - start));
+        if (!item) {
+            Py_DECREF(list);
+            return nullptr;
+        }
+        PyList_SET_ITEM(list, i, item);
+    }
+    return list;
+}
+
+static PyObject* template_render(PyTemplate* self, PyObject* args, PyObject* kwargs) {
+    static const char* kwlist[] = {"paragraphs", "company", "fields", "unique", nullptr};
+    PyObject* paragraphs_obj = nullptr;
+    PyObject* company_obj = nullptr;
+    PyObject* fields_obj = nullptr;
+    PyObject* unique_obj = nullptr;
+    TemplateProgram* program = checked_program(self);
+    FingerprintSet* unique;
+    if (!program || !PyArg_ParseTupleAndKeywords(args, kwargs, "|OOOO", const_cast<char**>(kwlist),
+                                                  &paragraphs_obj, &company_obj, &fields_obj, &unique_obj) ||
+        !credential_generate::unique_set(unique_obj, unique)) {
+        return nullptr;
+    }
+    DocumentInput input;
+    if (!input.parse(*program, paragraphs_obj, company_obj, fields_obj)) {
+        return nullptr;
+    }
+
+    std::string credentials;
+    std::vector<uint64_t> offsets;
+    std::string document;
+    PyObject* error_type = nullptr;
+    std::string error;
+    bool ok;
+
+    Py_BEGIN_ALLOW_THREADS
+    {
+        tracing::Span span(tracing::DOCUMENTS, "template.render");
+        ok = credential_generate::generate(program->credential_types(), 1, unique, credentials, offsets, error_type, error);
+        if (ok) {
+            memory_arena::Scope scratch;
+            ViewVector views{memory_arena::ArenaAllocator<std::pair<const char*, size_t>>(scratch.arena())};
+            std::string escaped;
+            size_t total = program->assemble(input.values, credentials.data(), offsets.data(), scratch.arena(), escaped, views);
+            document.reserve(total);
+            for (const auto& view : views) {
+                document.append(view.first, view.second);
+            }
+        }
+    }
+    Py_END_ALLOW_THREADS
+
+    if (!ok) {
+        PyErr_SetString(error_type, error.c_str());
+        return nullptr;
+    }
+    PyObject* values = credential_list(*program, credentials, offsets, 0);
+    PyObject* buffer = values ? native_buffer::from_string(std::move(document)) : nullptr;
+    if (!buffer) {
+        Py_XDECREF(values);
+        return nullptr;
+    }
+    return Py_BuildValue("(NN)", buffer, values);
+}
+
+static bool path_string(PyObject* obj, std::string& path) {
+    PyObject* encoded;
+    if (!PyUnicode_FSConverter(obj, &encoded)) {
+        return false;
+    }
+    path.assign(PyBytes_AS_STRING(encoded), PyBytes_GET_SIZE(encoded));
+    Py_DECREF(encoded);
+    return true;
+}
+
+// Generate the credentials of every document in one batch, then gather
+// each document into its file
+static bool write_documents(const TemplateProgram& program, const std::vector<std::string>& paths,
+                            const std::vector<std::unique_ptr<DocumentInput>>& inputs, FingerprintSet* unique,
+                            std::string& credentials, std::vector<uint64_t>& offsets,
+                            PyObject*& error_type, std::string& error) {
+    tracing::Span span(tracing::DOCUMENTS, "template.write", static_cast<int64_t>(paths.size()));
+    if (!credential_generate::generate(program.credential_types(), paths.size(), unique, credentials, offsets,
+                                       error_type, error)) {
+        return false;
+    }
+
+    size_t per_document = program.credential_types().size();
+    memory_arena::Scope scratch;
+    ViewVector views{memory_arena::ArenaAllocator<std::pair<const char*, size_t>>(scratch.arena())};
+    std::string escaped;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        memory_arena::Scope document(scratch.arena());
+        program.assemble(inputs[i]->values, credentials.data(), offsets.data() + i * per_document,
+                         scratch.arena(), escaped, views);
+        if (!write_views(paths[i], views, error)) {
+            error_type = PyExc_OSError;
+            return false;
+        }
+    }
+    return true;
+}
+
+static PyObject* template_write(PyTemplate* self, PyObject* args, PyObject* kwargs) {
+    static const char* kwlist[] = {"path", "paragraphs", "company", "fields", "unique", nullptr};
+    PyObject* path_obj;
+    PyObject* paragraphs_obj = nullptr;
+    PyObject* company_obj = nullptr;
+    PyObject* fields_obj = nullptr;
+    PyObject* unique_obj = nullptr;
+    TemplateProgram* program = checked_program(self);
+    FingerprintSet* unique;
+    if (!program || !PyArg_ParseTupleAndKeywords(args, kwargs, "O|OOOO", const_cast<char**>(kwlist),
+                                                  &path_obj, &paragraphs_obj, &company_obj, &fields_obj, &unique_obj) ||
+        !credential_generate::unique_set(unique_obj, unique)) {
+        return nullptr;
+    }
+
+    std::vector<std::string> paths(1);
+    std::vector<std::unique_ptr<DocumentInput>> inputs;
+    inputs.push_back(std::make_unique<DocumentInput>());
+    if (!path_string(path_obj, paths[0]) || !inputs[0]->parse(*program, paragraphs_obj, company_obj, fields_obj)) {
+        return nullptr;
+    }
+
+    std::string credentials;
+    std::vector<uint64_t> offsets;
+    PyObject* error_type = nullptr;
+    std::string error;
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS
+    ok = write_documents(*program, paths, inputs, unique, credentials, offsets, error_type, error);
+    Py_END_ALLOW_THREADS
+    if (!ok) {
+        PyErr_SetString(error_type, error.c_str());
+        return nullptr;
+    }
+    return credential_list(*program, credentials, offsets, 0);
+}
+
+static PyObject* template_write_batch(PyTemplate* self, PyObject* args, PyObject* kwargs) {
+    static const char* kwlist[] = {"paths", "documents", "unique", nullptr};
+    PyObject* paths_obj;
+    PyObject* documents_obj = Py_None;
+    PyObject* unique_obj = nullptr;
+    TemplateProgram* program = checked_program(self);
+    FingerprintSet* unique;
+    if (!program || !PyArg_ParseTupleAndKeywords(args, kwargs, "O|OO", const_cast<char**>(kwlist), &paths_obj, &documents_obj, &unique_obj) ||
+        !credential_generate::unique_set(unique_obj, unique)) {
+        return nullptr;
+    }
+
+    PyObject* paths_seq = PySequence_Fast(paths_obj, "paths must be a sequence");
+    if (!paths_seq) {
+        return nullptr;
+    }
+    PyObject* documents_seq = nullptr;
+    if (documents_obj != Py_None) {
+        documents_seq = PySequence_Fast(documents_obj, "documents must be a sequence of dicts");
+        if (!documents_seq) {
+            Py_DECREF(paths_seq);
+            return nullptr;
+        }
+        if (PySequence_Fast_GET_SIZE(documents_seq) != PySequence_Fast_GET_SIZE(paths_seq)) {
+            PyErr_SetString(PyExc_ValueError, "documents and paths differ in length");
+            Py_DECREF(documents_seq);
+            Py_DECREF(paths_seq);
+            return nullptr;
+        }
+    }
+
+    // Each document is {'paragraphs': ..., 'company': ..., 'fields': {...}}
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(paths_seq);
+    std::vector<std::string> paths(n);
+    std::vector<std::unique_ptr<DocumentInput>> inputs(n);
+    bool parsed = true;
+    for (Py_ssize_t i = 0; parsed && i < n; ++i) {
+        inputs[i] = std::make_unique<DocumentInput>();
+        parsed = path_string(PySequence_Fast_GET_ITEM(paths_seq, i), paths[i]);
+        if (!parsed || !documents_seq) {
+            continue;
+        }
+        PyObject* document = PySequence_Fast_GET_ITEM(documents_seq, i);
+        if (document == Py_None) {
+            continue;
+        }
+        if (!PyDict_Check(document)) {
+            PyErr_SetString(PyExc_TypeError, "documents must be a sequence of dicts");
+            parsed = false;
+            break;
+        }
+        parsed = inputs[i]->parse(*program, PyDict_GetItemString(document, "paragraphs"),
+                                  PyDict_GetItemString(document, "company"), PyDict_GetItemString(document, "fields"));
+    }
+
+    std::string credentials;
+    std::vector<uint64_t> offsets;
+    PyObject* error_type = nullptr;
+    std::string error;
+    bool ok = false;
+    if (parsed) {
+        Py_BEGIN_ALLOW_THREADS
+        ok = write_documents(*program, paths, inputs, unique, credentials, offsets, error_type, error);
+        Py_END_ALLOW_THREADS
+        if (!ok) {
+            PyErr_SetString(error_type, error.c_str());
+        }
+    }
+    inputs.clear();
+    Py_XDECREF(documents_seq);
+    Py_DECREF(paths_seq);
+    if (!ok) {
+        return nullptr;
+    }
+
+    PyObject* result = PyList_New(n);
+    if (!result) {
+        return nullptr;
+    }
+    size_t per_document = program->credential_types().size();
+    for (Py_ssize_t i = 0; i < n; ++i) {
+        PyObject* values = credential_list(*program, credentials, offsets, i * per_document);
+        if (!values) {
+            Py_DECREF(result);
+            return nullptr;
+        }
+        PyList_SET_ITEM(result, i, values);
+    }
+    return result;
+}
+
+static PyObject* template_slots(PyTemplate* self, PyObject* args) {
+    TemplateProgram* program = checked_program(self);
+    if (!program) {
+        return nullptr;
+    }
+    PyObject* list = PyList_New(0);
+    for (const TemplateProgram::Piece& piece : program->all_pieces()) {
+        PyObject* item = nullptr;
+        switch (piece.kind) {
+            case TemplateProgram::Piece::LITERAL:
+                continue;
+            case TemplateProgram::Piece::CREDENTIAL:
+                item = Py_BuildValue("(sI)", program->credential_types()[piece.index].c_str(), piece.index);
+                item = item ? Py_BuildValue("(sN)", "credential", item) : nullptr;
+                break;
+            case TemplateProgram::Piece::PARAGRAPH:
+                item = Py_BuildValue("(sI)", "paragraph", piece.index);
+                break;
+            case TemplateProgram::Piece::COMPANY:
+                item = Py_BuildValue("(sO)", "company", Py_None);
+                break;
+            case TemplateProgram::Piece::FIELD:
+                item = Py_BuildValue("(ss)", "field", program->field_names()[piece.index].c_str());
+                break;
+        }
+        if (!item || PyList_Append(list, item) < 0) {
+            Py_XDECREF(item);
+            Py_DECREF(list);
+            return nullptr;
+        }
+        Py_DECREF(item);
+    }
+    return list;
+}
+
+static PyObject* template_stats(PyTemplate* self, PyObject* args) {
+    TemplateProgram* program = checked_program(self);
+    if (!program) {
+        return nullptr;
+    }
+    PyObject* types = PyList_New(program->credential_types().size());
+    for (size_t i = 0; types && i < program->credential_types().size(); ++i) {
+        PyList_SET_ITEM(types, i, PyUnicode_FromString(program->credential_types()[i].c_str()));
+    }
+    return Py_BuildValue("{s:n,s:n,s:n,s:n,s:n,s:n,s:N,s:K,s:K}",
+                         "literal_bytes", static_cast<Py_ssize_t>(program->literal_bytes()),
+                         "pieces", static_cast<Py_ssize_t>(program->all_pieces().size()),
+                         "slots", static_cast<Py_ssize_t>(program->slots()),
+                         "paragraphs", static_cast<Py_ssize_t>(program->paragraph_count()),
+                         "fields", static_cast<Py_ssize_t>(program->field_names().size()),
+                         "credentials", static_cast<Py_ssize_t>(program->credential_types().size()),
+                         "credential_types", types,
+                         "documents", static_cast<unsigned long long>(program->documents_rendered()),
+                         "bytes_rendered", static_cast<unsigned long long>(program->bytes_rendered()));
+}
+
+static PyMethodDef TemplateMethods[] = {
+    {"render", (PyCFunction)(void(*)(void))template_render, METH_VARARGS | METH_KEYWORDS, "Instantiate in memory: (paragraphs=(), company=None, fields=None, unique=None) -> (NativeBuffer, [(type, credential), ...])"},
+    {"write", (PyCFunction)(void(*)(void))template_write, METH_VARARGS | METH_KEYWORDS, "Instantiate into a file: (path, paragraphs=(), company=None, fields=None, unique=None) -> [(type, credential), ...]"},
+    {"write_batch", (PyCFunction)(void(*)(void))template_write_batch, METH_VARARGS | METH_KEYWORDS, "Instantiate one file per path: (paths, documents=None, unique=None); documents are dicts of paragraphs, company and fields"},
+    {"slots", reinterpret_cast<PyCFunction>(template_slots), METH_NOARGS, "List the slots in order as (kind, argument)"},
+    {"stats", reinterpret_cast<PyCFunction>(template_stats), METH_NOARGS, "Get layout and rendering statistics"},
+    {nullptr, nullptr, 0, nullptr}
+};
+
+static bool init_template_type() {
+    if (PyTemplateType.tp_flags & Py_TPFLAGS_READY) {
+        return true;
+    }
+    PyTemplateType.tp_name = "template_engine.Template";
+    PyTemplateType.tp_doc = "Template(source, options=None)\n\n"
+                            "A document skeleton compiled into literal segments and credential, paragraph, company "
+                            "and field slots. Options: escape ('none', 'xml' or 'rtf', applied to slot values) and "
+                            "delimiters (default ('{{', '}}')).";
+    PyTemplateType.tp_basicsize = sizeof(PyTemplate);
+    PyTemplateType.tp_flags = Py_TPFLAGS_DEFAULT;
+    PyTemplateType.tp_new = PyType_GenericNew;
+    PyTemplateType.tp_init = reinterpret_cast<initproc>(template_init);
+    PyTemplateType.tp_dealloc = reinterpret_cast<destructor>(template_dealloc);
+    PyTemplateType.tp_methods = TemplateMethods;
+    return PyType_Ready(&PyTemplateType) == 0;
+}
+
+static int template_engine_exec(PyObject* module) {
+    if (!init_template_type() || !native_buffer::init_type()) {
+        return -1;
+    }
+    Py_INCREF(&PyTemplateType);
+    if (PyModule_AddObject(module, "Template", reinterpret_cast<PyObject*>(&PyTemplateType)) < 0) {
+        Py_DECREF(&PyTemplateType);
+        return -1;
+    }
+    return 0;
+}
+
+static PyMethodDef TemplateEngineMethods[] = {
+    {nullptr, nullptr, 0, nullptr}
+};
+
+static PyModuleDef_Slot TemplateEngineSlots[] = {
+    {Py_mod_exec, reinterpret_cast<void*>(template_engine_exec)},
+#if PY_VERSION_HEX >= 0x030C0000
+    {Py_mod_multiple_interpreters, Py_MOD_MULTIPLE_INTERPRETERS_SUPPORTED},
+#endif
+#if PY_VERSION_HEX >= 0x030D0000
+    {Py_mod_gil, Py_MOD_GIL_NOT_USED},
+#endif
+    {0, nullptr}
+};
+
+static struct PyModuleDef templateenginemodule = {
+    PyModuleDef_HEAD_INIT,
+    "template_engine",
+    "Precompiled document skeletons with credential slots",
+    0,
+    TemplateEngineMethods,
+    TemplateEngineSlots
+};
+
+PyMODINIT_FUNC PyInit_template_engine(void) {
+    return PyModuleDef_Init(&templateenginemodule);
+}
@@ -0,0 +1,1493 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "token_grammar.h"
+#include "tracing.h"
+
+namespace token_grammar {
+
+// Rules are flat element lists in the llama.cpp layout: alternatives
+// separated by ALT and closed by END. A character class is a CHAR (or
+// CHAR_NOT) element followed by CHAR_RNG_UPPER for a range end and
+// CHAR_ALT for further characters.
+enum ElementType : uint8_t {
+    END,
+    ALT,
+    RULE_REF,
+    CHAR,
+    CHAR_NOT,
+    CHAR_RNG_UPPER,
+    CHAR_ALT,
+    CHAR_ANY
+};
+
+struct Element {
+    ElementType type;
+    uint32_t value;  // Code point, or rule number for RULE_REF
+};
+
+class Grammar {
+public:
+    std::vector<std::vector<Element>> rules;
+    std::vector<std::string> names;
+    uint32_t root = 0;
+    std::string source;
+};
+
+const std::string& source(const Grammar& grammar) {
+    return grammar.source;
+}
+
+size_t rule_count(const Grammar& grammar) {
+    return grammar.rules.size();
+}
+
+namespace {
+
+constexpr uint32_t kUnbounded = UINT32_MAX;
+constexpr size_t kMaxStacks = 1024;    // Bound on ambiguity; further parses are dropped
+constexpr size_t kMaxCached = 256;
+
+size_t sequence_length(unsigned char c) {
+    return c >= 0xF8 ? 1 : c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+}
+
+// Code point of a complete sequence; invalid bytes decode as themselves
+uint32_t decode(const char* p, size_t length) {
+    unsigned char c = static_cast<unsigned char>(p[0]);
+    if (length == 1) {
+        return c;
+    }
+    uint32_t cp = c & (0x7F >> length);
+    for (size_t k = 1; k < length; ++k) {
+        cp = (cp << 6) | (static_cast<unsigned char>(p[k]) & 0x3F);
+    }
+    return cp;
+}
+
+void append_utf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+bool is_end(const Element* e) {
+    return e->type == END || e->type == ALT;
+}
+
+bool is_char(const Element* e) {
+    return e->type == CHAR || e->type == CHAR_NOT || e->type == CHAR_ANY;
+}
+
+// Whether the class at `pos` takes `cp`; `after` is the element past it
+bool match_char(const Element* pos, uint32_t cp, const Element** after) {
+    if (pos->type == CHAR_ANY) {
+        *after = pos + 1;
+        return true;
+    }
+    bool negate = pos->type == CHAR_NOT;
+    bool found = false;
+    do {
+        if (pos[1].type == CHAR_RNG_UPPER) {
+            found |= pos->value <= cp && cp <= pos[1].value;
+            pos += 2;
+        } else {
+            found |= pos->value == cp;
+            pos += 1;
+        }
+    } while (pos->type == CHAR_ALT);
+    *after = pos;
+    return found != negate;
+}
+
+bool admits_non_ascii(const Element* pos) {
+    if (pos->type == CHAR_ANY || pos->type == CHAR_NOT) {
+        return true;
+    }
+    do {
+        uint32_t upper = pos[1].type == CHAR_RNG_UPPER ? pos[1].value : pos->value;
+        if (upper >= 0x80) {
+            return true;
+        }
+        pos += pos[1].type == CHAR_RNG_UPPER ? 2 : 1;
+    } while (pos->type == CHAR_ALT);
+    return false;
+}
+
+using Stack = std::vector<const Element*>;
+
+void add_stack(std::vector<Stack>& out, const Stack& stack) {
+    if (out.size() < kMaxStacks && std::find(out.begin(), out.end(), stack) == out.end()) {
+        out.push_back(stack);
+    }
+}
+
+// Push `stack` with each alternative of `rule` on top, expanding rule
+// references until every stack ends in a character class (or is empty:
+// the text matches)
+void expand(const Grammar& grammar, const Stack& stack, std::vector<Stack>& out);
+
+void push_alternatives(const Grammar& grammar, const Stack& base, uint32_t rule_id, std::vector<Stack>& out) {
+    const std::vector<Element>& rule = grammar.rules[rule_id];
+    for (size_t i = 0; i < rule.size(); ++i) {
+        Stack next = base;
+        if (!is_end(&rule[i])) {
+            next.push_back(&rule[i]);
+        }
+        expand(grammar, next, out);
+        while (!is_end(&rule[i])) {
+            ++i;
+        }
+        if (rule[i].type == END) {
+            break;
+        }
+    }
+}
+
+void expand(const Grammar& grammar, const Stack& stack, std::vector<Stack>& out) {
+    if (stack.empty() || stack.back()->type != RULE_REF) {
+        add_stack(out, stack);
+        return;
+    }
+    const Element* pos = stack.back();
+    Stack base(stack.begin(), stack.end() - 1);
+    if (!is_end(pos + 1)) {
+        base.push_back(pos + 1);
+    }
+    push_alternatives(grammar, base, pos->value, out);
+}
+
+// GBNF parser. Newlines end a rule except inside parentheses and around
+// `|`; `#` starts a comment.
+class Parser {
+public:
+    explicit Parser(const std::string& text) : src(text) {}
+
+    bool parse(Grammar& grammar, std::string& error) {
+        skip_space(true);
+        while (pos < src.size()) {
+            if (!parse_rule()) {
+                error = message;
+                return false;
+            }
+            skip_space(true);
+        }
+
+        for (size_t id = 0; id < names.size(); ++id) {
+            if (!defined[id]) {
+                error = "Undefined rule: " + names[id];
+                return false;
+            }
+        }
+        auto root = ids.find("root");
+        if (root == ids.end()) {
+            error = "Grammar has no root rule";
+            return false;
+        }
+        std::string recursive = left_recursive_rule();
+        if (!recursive.empty()) {
+            error = "Left-recursive rule: " + recursive;
+            return false;
+        }
+
+        grammar.rules = std::move(rules);
+        grammar.names = std::move(names);
+        grammar.root = root->second;
+        grammar.source = src;
+        return true;
+    }
+
+private:
+    bool fail(const std::string& what) {
+        size_t line = 1 + std::count(src.begin(), src.begin() + std::min(pos, src.size()), '\n');
+        message = "Grammar line " + std::to_string(line) + ": " + what;
+        return false;
+    }
+
+    void skip_space(bool newlines) {
+        while (pos < src.size()) {
+            char c = src[pos];
+            if (c == '#') {
+                while (pos < src.size() && src[pos] != '\n') {
+                    ++pos;
+                }
+            } else if (c == ' ' || c == '\t' || c == '\r' || (c == '\n' && newlines)) {
+                ++pos;
+            } else {
+                break;
+            }
+        }
+    }
+
+    static bool is_name_char(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '_';
+    }
+
+    bool parse_name(std::string& name) {
+        size_t start = pos;
+        while (pos < src.size() && is_name_char(src[pos])) {
+            ++pos;
+        }
+        name.assign(src, start, pos - start);
+        return !name.empty();
+    }
+
+    uint32_t symbol(const std::string& name) {
+        auto it = ids.find(name);
+        if (it != ids.end()) {
+            return it->second;
+        }
+        uint32_t id = static_cast<uint32_t>(names.size());
+        ids.emplace(name, id);
+        names.push_back(name);
+        rules.emplace_back();
+        defined.push_back(false);
+        return id;
+    }
+
+    uint32_t fresh(const std::string& base) {
+        for (size_t n = names.size();; ++n) {
+            std::string name = base + "_" + std::to_string(n);
+            if (!ids.count(name)) {
+                return symbol(name);
+            }
+        }
+    }
+
+    void define(uint32_t id, std::vector<Element> rule) {
+        rules[id] = std::move(rule);
+        defined[id] = true;
+    }
+
+    bool parse_rule() {
+        std::string name;
+        if (!parse_name(name)) {
+            return fail("expected a rule name");
+        }
+        skip_space(false);
+        if (src.compare(pos, 3, "::=") != 0) {
+            return fail("expected ::= after " + name);
+        }
+        pos += 3;
+        skip_space(true);
+
+        uint32_t id = symbol(name);
+        if (defined[id]) {
+            return fail("rule defined twice: " + name);
+        }
+        if (!parse_alternates(name, id, false)) {
+            return false;
+        }
+        skip_space(false);
+        if (pos < src.size() && src[pos] != '\n') {
+            return fail(std::string("unexpected '") + src[pos] + "'");
+        }
+        return true;
+    }
+
+    bool parse_alternates(const std::string& name, uint32_t id, bool nested) {
+        std::vector<Element> rule;
+        if (!parse_sequence(name, rule, nested)) {
+            return false;
+        }
+        while (true) {
+            size_t save = pos;
+            skip_space(true);
+            if (pos >= src.size() || src[pos] != '|') {
+                pos = save;
+                break;
+            }
+            ++pos;
+            skip_space(true);
+            rule.push_back({ALT, 0});
+            if (!parse_sequence(name, rule, nested)) {
+                return false;
+            }
+        }
+        rule.push_back({END, 0});
+        define(id, std::move(rule));
+        return true;
+    }
+
+    bool parse_sequence(const std::string& name, std::vector<Element>& out, bool nested) {
+        size_t last_start = SIZE_MAX;  // Where the last symbol starts, for repetition
+        while (pos < src.size()) {
+            char c = src[pos];
+            if (c == '"') {
+                ++pos;
+                last_start = out.size();
+                while (pos < src.size() && src[pos] != '"') {
+                    uint32_t cp;
+                    if (!parse_char(cp)) {
+                        return false;
+                    }
+                    out.push_back({CHAR, cp});
+                }
+                if (pos >= src.size()) {
+                    return fail("unterminated literal");
+                }
+                ++pos;
+            } else if (c == '[') {
+                ++pos;
+                last_start = out.size();
+                ElementType first = CHAR;
+                if (pos < src.size() && src[pos] == '^') {
+                    first = CHAR_NOT;
+                    ++pos;
+                }
+                while (pos < src.size() && src[pos] != ']') {
+                    uint32_t low;
+                    if (!parse_char(low)) {
+                        return false;
+                    }
+                    out.push_back({out.size() == last_start ? first : CHAR_ALT, low});
+                    if (pos + 1 < src.size() && src[pos] == '-' && src[pos + 1] != ']') {
+                        ++pos;
+                        uint32_t high;
+                        if (!parse_char(high)) {
+                            return false;
+                        }
+                        out.push_back({CHAR_RNG_UPPER, high});
+                    }
+                }
+                if (pos >= src.size()) {
+                    return fail("unterminated character class");
+                }
+                if (out.size() == last_start) {
+                    return fail("empty character class");
+                }
+                ++pos;
+            } else if (c == '.') {
+                ++pos;
+                last_start = out.size();
+                out.push_back({CHAR_ANY, 0});
+            } else if (is_name_char(c)) {
+                size_t start = pos;
+                std::string ref;
+                parse_name(ref);
+                size_t end = pos;
+                skip_space(false);
+                if (src.compare(pos, 3, "::=") == 0) {
+                    // The next rule starts here
+                    pos = start;
+                    break;
+                }
+                pos = end;
+                last_start = out.size();
+                out.push_back({RULE_REF, symbol(ref)});
+            } else if (c == '(') {
+                ++pos;
+                skip_space(true);
+                uint32_t group = fresh(name);
+                if (!parse_alternates(name, group, true)) {
+                    return false;
+                }
+                skip_space(true);
+                if (pos >= src.size() || src[pos] != ')') {
+                    return fail("expected )");
+                }
+                ++pos;
+                last_start = out.size();
+                out.push_back({RULE_REF, group});
+            } else if (c == '*' || c == '+' || c == '?' || c == '{') {
+                if (last_start == SIZE_MAX) {
+                    return fail(std::string("'") + c + "' without a preceding symbol");
+                }
+                ++pos;
+                uint32_t min = c == '+' ? 1 : 0;
+                uint32_t max = c == '?' ? 1 : kUnbounded;
+                if (c == '{' && !parse_bounds(min, max)) {
+                    return false;
+                }
+                repeat(name, out, last_start, min, max);
+                last_start = SIZE_MAX;
+            } else {
+                break;
+            }
+            skip_space(nested);
+        }
+        return true;
+    }
+
+    // {m}, {m,} or {m,n}; the opening brace is consumed
+    bool parse_bounds(uint32_t& min, uint32_t& max) {
+        auto number = [this](uint32_t& value) {
+            size_t start = pos;
+            value = 0;
+            while (pos < src.size() && src[pos] >= '0' && src[pos] <= '9' && pos - start < 6) {
+                value = value * 10 + static_cast<uint32_t>(src[pos++] - '0');
+            }
+            return pos > start;
+        };
+        skip_space(false);
+        if (!number(min)) {
+            return fail("expected a repetition count");
+        }
+        skip_space(false);
+        max = min;
+        if (pos < src.size() && src[pos] == ',') {
+            ++pos;
+            skip_space(false);
+            if (!number(max)) {
+                max = kUnbounded;
+            }
+            skip_space(false);
+        }
+        if (pos >= src.size() || src[pos] != '}') {
+            return fail("expected }");
+        }
+        ++pos;
+        if (max < min) {
+            return fail("repetition maximum below its minimum");
+        }
+        return true;
+    }
+
+    // Replace the symbol at out[start:] with min copies, then either a
+    // right-recursive rule (unbounded) or nested optional rules
+    void repeat(const std::string& name, std::vector<Element>& out, size_t start, uint32_t min, uint32_t max) {
+        std::vector<Element> symbol_elements(out.begin() + start, out.end());
+        out.resize(start);
+        for (uint32_t i = 0; i < min; ++i) {
+            out.insert(out.end(), symbol_elements.begin(), symbol_elements.end());
+        }
+
+        if (max == kUnbounded) {
+            uint32_t rest = fresh(name);
+            std::vector<Element> rule = symbol_elements;
+            rule.push_back({RULE_REF, rest});
+            rule.push_back({ALT, 0});
+            rule.push_back({END, 0});
+            define(rest, std::move(rule));
+            out.push_back({RULE_REF, rest});
+            return;
+        }
+
+        uint32_t inner = UINT32_MAX;
+        for (uint32_t i = min; i < max; ++i) {
+            uint32_t optional = fresh(name);
+            std::vector<Element> rule = symbol_elements;
+            if (inner != UINT32_MAX) {
+                rule.push_back({RULE_REF, inner});
+            }
+            rule.push_back({ALT, 0});
+            rule.push_back({END, 0});
+            define(optional, std::move(rule));
+            inner = optional;
+        }
+        if (inner != UINT32_MAX) {
+            out.push_back({RULE_REF, inner});
+        }
+    }
+
+    bool parse_hex(size_t digits, uint32_t& cp) {
+        cp = 0;
+        for (size_t i = 0; i < digits; ++i, ++pos) {
+            char c = pos < src.size() ? src[pos] : '\0';
+            int v = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+            if (v < 0) {
+                return fail("invalid hex escape");
+            }
+            cp = (cp << 4) | static_cast<uint32_t>(v);
+        }
+        return true;
+    }
+
+    bool parse_char(uint32_t& cp) {
+        if (src[pos] != '\\') {
+            size_t length = std::min(sequence_length(static_cast<unsigned char>(src[pos])), src.size() - pos);
+            cp = decode(src.data() + pos, length);
+            pos += length;
+            return true;
+        }
+        if (++pos >= src.size()) {
+            return fail("unterminated escape");
+        }
+        char c = src[pos++];
+        switch (c) {
+            case 'n': cp = '\n'; return true;
+            case 'r': cp = '\r'; return true;
+            case 't': cp = '\t'; return true;
+            case 'x': return parse_hex(2, cp);
+            case 'u': return parse_hex(4, cp);
+            case 'U': return parse_hex(8, cp);
+            case '\\': case '"': case '[': case ']': case '-': case '^': case '/':
+                cp = static_cast<unsigned char>(c);
+                return true;
+            default:
+                --pos;
+                return fail(std::string("unknown escape \\") + c);
+        }
+    }
+
+    // Name of a rule that can reach itself without consuming a character,
+    // or empty. Such rules would make stack expansion loop forever.
+    std::string left_recursive_rule() const {
+        size_t n = rules.size();
+        std::vector<bool> nullable(n, false);
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (size_t id = 0; id < n; ++id) {
+                if (nullable[id]) {
+                    continue;
+                }
+                bool alternative = true;
+                for (const Element& e : rules[id]) {
+                    if (e.type == END || e.type == ALT) {
+                        if (alternative) {
+                            nullable[id] = true;
+                            changed = true;
+                            break;
+                        }
+                        alternative = true;
+                    } else if (e.type != RULE_REF || !nullable[e.value]) {
+                        alternative = false;
+                    }
+                }
+            }
+        }
+
+        // Edges to the rules each alternative can start with
+        std::vector<std::vector<uint32_t>> leading(n);
+        for (size_t id = 0; id < n; ++id) {
+            bool open = true;
+            for (const Element& e : rules[id]) {
+                if (e.type == END || e.type == ALT) {
+                    open = true;
+                } else if (open && e.type == RULE_REF) {
+                    leading[id].push_back(e.value);
+                    open = nullable[e.value];
+                } else {
+                    open = false;
+                }
+            }
+        }
+
+        std::vector<uint8_t> state(n, 0);  // 0 unseen, 1 on the path, 2 done
+        std::function<bool(size_t)> cyclic = [&](size_t id) {
+            state[id] = 1;
+            for (uint32_t next : leading[id]) {
+                if (state[next] == 1 || (state[next] == 0 && cyclic(next))) {
+                    return true;
+                }
+            }
+            state[id] = 2;
+            return false;
+        };
+        for (size_t id = 0; id < n; ++id) {
+            if (state[id] == 0 && cyclic(id)) {
+                return names[id];
+            }
+        }
+        return std::string();
+    }
+
+    const std::string& src;
+    size_t pos = 0;
+    std::string message;
+    std::unordered_map<std::string, uint32_t> ids;
+    std::vector<std::string> names;
+    std::vector<std::vector<Element>> rules;
+    std::vector<bool> defined;
+};
+
+// Just enough JSON for schemas
+struct Json {
+    enum Kind { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+    Kind kind = NUL;
+    bool boolean = false;
+    std::string text;  // STRING: the value; NUMBER: its literal
+    std::vector<Json> items;
+    std::vector<std::pair<std::string, Json>> members;
+
+    const Json* get(std::string_view key) const {
+        for (const auto& member : members) {
+            if (member.first == key) {
+                return &member.second;
+            }
+        }
+        return nullptr;
+    }
+};
+
+class JsonParser {
+public:
+    explicit JsonParser(const std::string& text) : src(text) {}
+
+    bool parse(Json& value, std::string& error) {
+        if (!parse_value(value, 0) || (skip_space(), pos != src.size() && fail("trailing characters"))) {
+            error = message;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    bool fail(const std::string& what) {
+        message = "Invalid JSON schema at byte " + std::to_string(pos) + ": " + what;
+        return false;
+    }
+
+    void skip_space() {
+        while (pos < src.size() && (src[pos] == ' ' || src[pos] == '\t' || src[pos] == '\n' || src[pos] == '\r')) {
+            ++pos;
+        }
+    }
+
+    bool literal(const char* word) {
+        size_t n = std::strlen(word);
+        if (src.compare(pos, n, word) != 0) {
+            return fail("unexpected token");
+        }
+        pos += n;
+        return true;
+    }
+
+    bool parse_value(Json& value, int depth) {
+        if (depth > 64) {
+            return fail("nested too deeply");
+        }
+        skip_space();
+        if (pos >= src.size()) {
+            return fail("unexpected end");
+        }
+        char c = src[pos];
+        if (c == '{') {
+            value.kind = Json::OBJECT;
+            ++pos;
+            skip_space();
+            if (pos < src.size() && src[pos] == '}') {
+                ++pos;
+                return true;
+            }
+            while (true) {
+                skip_space();
+                std::string key;
+                if (pos >= src.size() || src[pos] != '"' || !parse_string(key)) {
+                    return message.empty() ? fail("expected a key") : false;
+                }
+                skip_space();
+                if (pos >= src.size() || src[pos++] != ':') {
+                    return fail("expected :");
+                }
+                value.members.emplace_back(std::move(key), Json());
+                if (!parse_value(value.members.back().second, depth + 1)) {
+                    return false;
+                }
+                skip_space();
+                if (pos < src.size() && src[pos] == ',') {
+                    ++pos;
+                } else if (pos < src.size() && src[pos] == '}') {
+                    ++pos;
+                    return true;
+                } else {
+                    return fail("expected , or }");
+                }
+            }
+        }
+        if (c == '[') {
+            value.kind = Json::ARRAY;
+            ++pos;
+            skip_space();
+            if (pos < src.size() && src[pos] == ']') {
+                ++pos;
+                return true;
+            }
+            while (true) {
+                value.items.emplace_back();
+                if (!parse_value(value.items.back(), depth + 1)) {
+                    return false;
+                }
+                skip_space();
+                if (pos < src.size() && src[pos] == ',') {
+                    ++pos;
+                } else if (pos < src.size() && src[pos] == ']') {
+                    ++pos;
+                    return true;
+                } else {
+                    return fail("expected , or ]");
+                }
+            }
+        }
+        if (c == '"') {
+            value.kind = Json::STRING;
+            return parse_string(value.text);
+        }
+        if (c == 't' || c == 'f') {
+            value.kind = Json::BOOLEAN;
+            value.boolean = c == 't';
+            return literal(c == 't' ? "true" : "false");
+        }
+        if (c == 'n') {
+            value.kind = Json::NUL;
+            return literal("null");
+        }
+        size_t start = pos;
+        while (pos < src.size() && std::strchr("+-0123456789.eE", src[pos])) {
+            ++pos;
+        }
+        if (pos == start) {
+            return fail("unexpected character");
+        }
+        value.kind = Json::NUMBER;
+        value.text.assign(src, start, pos - start);
+        return true;
+    }
+
+    bool parse_hex4(uint32_t& cp) {
+        if (src.size() - pos < 4) {
+            return fail("truncated \\u escape");
+        }
+        cp = 0;
+        for (int i = 0; i < 4; ++i) {
+            char c = src[pos++];
+            int v = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+            if (v < 0) {
+                return fail("invalid \\u escape");
+            }
+            cp = (cp << 4) | static_cast<uint32_t>(v);
+        }
+        return true;
+    }
+
+    bool parse_string(std::string& out) {
+        ++pos;
+        while (pos < src.size() && src[pos] != '"') {
+            char c = src[pos++];
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (pos >= src.size()) {
+                break;
+            }
+            char e = src[pos++];
+            uint32_t cp = 0;
+            switch (e) {
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'u':
+                    if (!parse_hex4(cp)) {
+                        return false;
+                    }
+                    if (cp >= 0xD800 && cp < 0xDC00 && src.compare(pos, 2, "\\u") == 0) {
+                        uint32_t low = 0;
+                        pos += 2;
+                        if (!parse_hex4(low)) {
+                            return false;
+                        }
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    append_utf8(out, cp);
+                    break;
+                default: out += e;
+            }
+        }
+        if (pos >= src.size()) {
+            return fail("unterminated string");
+        }
+        ++pos;
+        return true;
+    }
+
+    const std::string& src;
+    size_t pos = 0;
+    std::string message;
+};
+
+std::string json_string(const std::string& value) {
+    std::string out = "\"";
+    for (unsigned char c : value) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += static_cast<char>(c);
+        } else if (c == '\n') {
+            out += "\\n";
+        } else if (c == '\t') {
+            out += "\\t";
+        } else if (c == '\r') {
+            out += "\\r";
+        } else if (c < 0x20) {
+            char code[8];
+            std::snprintf(code, sizeof(code), "\\u%04x", c);
+            out += code;
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+    return out + "\"";
+}
+
+// Compact JSON text of a value, as enum and const values must appear
+std::string json_text(const Json& value) {
+    switch (value.kind) {
+        case Json::NUL: return "null";
+        case Json::BOOLEAN: return value.boolean ? "true" : "false";
+        case Json::NUMBER: return value.text;
+        case Json::STRING: return json_string(value.text);
+        case Json::ARRAY: {
+            std::string out = "[";
+            for (size_t i = 0; i < value.items.size(); ++i) {
+                out += (i ? "," : "") + json_text(value.items[i]);
+            }
+            return out + "]";
+        }
+        case Json::OBJECT: {
+            std::string out = "{";
+            for (size_t i = 0; i < value.members.size(); ++i) {
+                out += (i ? "," : "") + json_string(value.members[i].first) + ":" + json_text(value.members[i].second);
+            }
+            return out + "}";
+        }
+    }
+    return "null";
+}
+
+// GBNF literal matching `text` exactly
+std::string gbnf_literal(const std::string& text) {
+    std::string out = "\"";
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += static_cast<char>(c);
+        } else if (c == '\n') {
+            out += "\\n";
+        } else if (c == '\r') {
+            out += "\\r";
+        } else if (c == '\t') {
+            out += "\\t";
+        } else if (c < 0x20) {
+            char code[8];
+            std::snprintf(code, sizeof(code), "\\x%02X", c);
+            out += code;
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+    return out + "\"";
+}
+
+// Shared rules, added with their dependencies on first use. Whitespace is
+// bounded so a constrained model cannot pad its way to max_tokens.
+struct Primitive {
+    const char* name;
+    const char* body;
+    std::vector<const char*> uses;
+};
+
+const std::vector<Primitive>& primitives() {
+    static const std::vector<Primitive> table = {
+        {"space", R"(| " " | "\n" [ \t]{0,20})", {}},
+        {"char", R"([^"\\\x7F\x00-\x1F] | [\\] (["\\bfnrt/] | "u" [0-9a-fA-F]{4}))", {}},
+        {"string", R"("\"" char* "\"" space)", {"char", "space"}},
+        {"integral-part", R"([0] | [1-9] [0-9]{0,15})", {}},
+        {"number", R"("-"? integral-part ("." [0-9]{1,16})? ([eE] [-+]? [0-9]{1,3})? space)", {"integral-part", "space"}},
+        {"integer", R"("-"? integral-part space)", {"integral-part", "space"}},
+        {"boolean", R"(("true" | "false") space)", {"space"}},
+        {"null", R"("null" space)", {"space"}},
+        {"value", R"(object | array | string | number | boolean | null)", {"object", "array", "string", "number", "boolean", "null"}},
+        {"object", R"("{" space (string ":" space value ("," space string ":" space value)*)? "}" space)", {"string", "value", "space"}},
+        {"array", R"("[" space (value ("," space value)*)? "]" space)", {"value", "space"}},
+    };
+    return table;
+}
+
+class SchemaConverter {
+public:
+    explicit SchemaConverter(const Json& schema) : root(schema) {}
+
+    bool convert(std::string& gbnf, std::string& error) {
+        std::string top;
+        if (!visit(root, "root", top)) {
+            error = message;
+            return false;
+        }
+        if (top != "root") {
+            define(reserve("root"), top);
+        }
+        gbnf.clear();
+        for (const auto& rule : rules) {
+            gbnf += rule.first + " ::= " + rule.second + "\n";
+        }
+        return true;
+    }
+
+private:
+    bool fail(const std::string& what) {
+        message = "Unsupported JSON schema: " + what;
+        return false;
+    }
+
+    static std::string sanitize(const std::string& hint) {
+        std::string name;
+        for (char c : hint) {
+            bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-';
+            name += ok ? c : '-';
+        }
+        return name.empty() ? "rule" : name;
+    }
+
+    // A fresh rule name for `hint`, defined later
+    std::string reserve(const std::string& hint) {
+        std::string base = sanitize(hint);
+        std::string name = base;
+        for (int i = 1; index.count(name); ++i) {
+            name = base + std::to_string(i);
+        }
+        index.emplace(name, rules.size());
+        rules.emplace_back(name, std::string());
+        return name;
+    }
+
+    void define(const std::string& name, const std::string& body) {
+        rules[index.at(name)].second = body;
+    }
+
+    // Reuse an identical rule under the same base name, else add one
+    std::string add_rule(const std::string& hint, const std::string& body) {
+        std::string base = sanitize(hint);
+        std::string name = base;
+        for (int i = 1;; ++i) {
+            auto it = index.find(name);
+            if (it == index.end()) {
+                break;
+            }
+            if (rules[it->second].second == body) {
+                return name;
+            }
+            name = base + std::to_string(i);
+        }
+        index.emplace(name, rules.size());
+        rules.emplace_back(name, body);
+        return name;
+    }
+
+    std::string primitive(const std::string& name) {
+        if (used.count(name)) {
+            return name;
+        }
+        used.insert(name);
+        for (const Primitive& p : primitives()) {
+            if (name == p.name) {
+                index.emplace(name, rules.size());
+                rules.emplace_back(name, p.body);
+                for (const char* dependency : p.uses) {
+                    primitive(dependency);
+                }
+                break;
+            }
+        }
+        return name;
+    }
+
+    bool count(const Json& schema, const char* key, uint32_t& value) {
+        const Json* field = schema.get(key);
+        if (!field) {
+            return true;
+        }
+        if (field->kind != Json::NUMBER || field->text.empty() || field->text[0] == '-') {
+            return fail(std::string(key) + " must be a non-negative integer");
+        }
+        value = static_cast<uint32_t>(std::min<unsigned long>(std::strtoul(field->text.c_str(), nullptr, 10), 100000));
+        return true;
+    }
+
+    static std::string repetition(uint32_t min, uint32_t max) {
+        if (max == kUnbounded) {
+            return min == 0 ? "*" : min == 1 ? "+" : "{" + std::to_string(min) + ",}";
+        }
+        if (min == 0 && max == 1) {
+            return "?";
+        }
+        return min == max ? "{" + std::to_string(min) + "}" : "{" + std::to_string(min) + "," + std::to_string(max) + "}";
+    }
+
+    bool resolve(const std::string& ref, std::string& out) {
+        auto known = refs.find(ref);
+        if (known != refs.end()) {
+            out = known->second;
+            return true;
+        }
+        if (ref.compare(0, 2, "#/") != 0 && ref != "#") {
+            return fail("only local $ref is supported: " + ref);
+        }
+
+        const Json* target = &root;
+        std::string last = "root";
+        size_t at = 1;
+        while (at < ref.size()) {
+            size_t next = ref.find('/', at + 1);
+            std::string segment = ref.substr(at + 1, next == std::string::npos ? std::string::npos : next - at - 1);
+            target = target->kind == Json::OBJECT ? target->get(segment) : nullptr;
+            if (!target) {
+                return fail("unresolved $ref " + ref);
+            }
+            last = segment;
+            at = next == std::string::npos ? ref.size() : next;
+        }
+
+        // Reserve the name first: the target may refer back to itself
+        std::string name = reserve(last);
+        refs.emplace(ref, name);
+        std::string body;
+        if (!visit(*target, name + "-def", body)) {
+            return false;
+        }
+        define(name, body);
+        out = name;
+        return true;
+    }
+
+    bool visit(const Json& schema, const std::string& name, std::string& out) {
+        if (schema.kind == Json::BOOLEAN) {
+            if (!schema.boolean) {
+                return fail("false schema at " + name);
+            }
+            out = primitive("value");
+            return true;
+        }
+        if (schema.kind != Json::OBJECT) {
+            return fail("schema at " + name + " is not an object");
+        }
+
+        if (const Json* ref = schema.get("$ref")) {
+            return ref->kind == Json::STRING ? resolve(ref->text, out) : fail("$ref must be a string");
+        }
+        if (const Json* value = schema.get("const")) {
+            primitive("space");
+            out = add_rule(name, gbnf_literal(json_text(*value)) + " space");
+            return true;
+        }
+        if (const Json* values = schema.get("enum")) {
+            if (values->kind != Json::ARRAY || values->items.empty()) {
+                return fail("enum must be a non-empty array");
+            }
+            std::string body = "(";
+            for (size_t i = 0; i < values->items.size(); ++i) {
+                body += (i ? " | " : "") + gbnf_literal(json_text(values->items[i]));
+            }
+            primitive("space");
+            out = add_rule(name, body + ") space");
+            return true;
+        }
+        for (const char* key : {"anyOf", "oneOf"}) {
+            if (const Json* options = schema.get(key)) {
+                if (options->kind != Json::ARRAY || options->items.empty()) {
+                    return fail(std::string(key) + " must be a non-empty array");
+                }
+                std::string body;
+                for (size_t i = 0; i < options->items.size(); ++i) {
+                    std::string option;
+                    if (!visit(options->items[i], name + "-" + std::to_string(i), option)) {
+                        return false;
+                    }
+                    body += (i ? " | " : "") + option;
+                }
+                out = add_rule(name, body);
+                return true;
+            }
+        }
+        if (schema.get("allOf")) {
+            return fail("allOf at " + name);
+        }
+
+        const Json* type = schema.get("type");
+        if (type && type->kind == Json::ARRAY) {
+            std::string body;
+            for (size_t i = 0; i < type->items.size(); ++i) {
+                const Json& each = type->items[i];
+                std::string option;
+                if (each.kind != Json::STRING || !visit_type(schema, each.text, name + "-" + each.text, option)) {
+                    return message.empty() ? fail("type list at " + name) : false;
+                }
+                body += (i ? " | " : "") + option;
+            }
+            out = add_rule(name, body);
+            return true;
+        }
+        if (type && type->kind == Json::STRING) {
+            return visit_type(schema, type->text, name, out);
+        }
+        if (type) {
+            return fail("type at " + name);
+        }
+        if (schema.get("properties")) {
+            return visit_type(schema, "object", name, out);
+        }
+        if (schema.get("items")) {
+            return visit_type(schema, "array", name, out);
+        }
+        out = primitive("value");
+        return true;
+    }
+
+    bool visit_type(const Json& schema, const std::string& type, const std::string& name, std::string& out) {
+        if (type == "object") {
+            return visit_object(schema, name, out);
+        }
+        if (type == "array") {
+            return visit_array(schema, name, out);
+        }
+        if (type == "string") {
+            uint32_t min = 0;
+            uint32_t max = kUnbounded;
+            if (!count(schema, "minLength", min) || !count(schema, "maxLength", max)) {
+                return false;
+            }
+            if (min == 0 && max == kUnbounded) {
+                out = primitive("string");
+                return true;
+            }
+            primitive("char");
+            primitive("space");
+            out = add_rule(name, R"("\"" char)" + repetition(min, max) + R"( "\"" space)");
+            return true;
+        }
+        if (type == "number" || type == "integer" || type == "boolean" || type == "null") {
+            out = primitive(type);
+            return true;
+        }
+        return fail("type " + type + " at " + name);
+    }
+
+    bool visit_object(const Json& schema, const std::string& name, std::string& out) {
+        const Json* properties = schema.get("properties");
+        primitive("space");
+        if (!properties || properties->kind != Json::OBJECT || properties->members.empty()) {
+            const Json* additional = schema.get("additionalProperties");
+            if (!additional || additional->kind != Json::OBJECT) {
+                out = primitive("object");
+                return true;
+            }
+            std::string value;
+            if (!visit(*additional, name + "-value", value)) {
+                return false;
+            }
+            primitive("string");
+            std::string pair = "string \":\" space " + value;
+            out = add_rule(name, "\"{\" space (" + pair + " (\",\" space " + pair + ")*)? \"}\" space");
+            return true;
+        }
+
+        std::unordered_set<std::string> required;
+        if (const Json* list = schema.get("required")) {
+            for (const Json& key : list->items) {
+                required.insert(key.text);
+            }
+        }
+
+        // Properties in schema order; required ones always, optional ones
+        // each present or not
+        std::vector<std::string> mandatory;
+        std::vector<std::string> optional;
+        for (const auto& property : properties->members) {
+            std::string value;
+            if (!visit(property.second, name + "-" + property.first, value)) {
+                return false;
+            }
+            std::string pair = add_rule(name + "-" + property.first + "-kv",
+                                        gbnf_literal(json_string(property.first)) + " space \":\" space " + value);
+            (required.count(property.first) ? mandatory : optional).push_back(pair);
+        }
+
+        std::string body = "\"{\" space ";
+        if (!mandatory.empty()) {
+            for (size_t i = 0; i < mandatory.size(); ++i) {
+                body += (i ? " \",\" space " : "") + mandatory[i];
+            }
+            for (const std::string& pair : optional) {
+                body += " (\",\" space " + pair + ")?";
+            }
+        } else {
+            // The first property present opens the list; the rest follow it
+            body += "(";
+            for (size_t i = 0; i < optional.size(); ++i) {
+                body += (i ? " | " : "") + optional[i];
+                for (size_t j = i + 1; j < optional.size(); ++j) {
+                    body += " (\",\" space " + optional[j] + ")?";
+                }
+            }
+            body += ")?";
+        }
+        out = add_rule(name, body + " \"}\" space");
+        return true;
+    }
+
+    bool visit_array(const Json& schema, const std::string& name, std::string& out) {
+        std::string item;
+        const Json* items = schema.get("items");
+        if (items) {
+            if (!visit(*items, name + "-item", item)) {
+                return false;
+            }
+        } else {
+            item = primitive("value");
+        }
+        uint32_t min = 0;
+        uint32_t max = kUnbounded;
+        if (!count(schema, "minItems", min) || !count(schema, "maxItems", max)) {
+            return false;
+        }
+        if (max < min) {
+            return fail("maxItems below minItems at " + name);
+        }
+
+        primitive("space");
+        std::string list;
+        if (max > 0) {
+            std::string rest = max - 1 > 0 || max == kUnbounded
+                ? " (\",\" space " + item + ")" + repetition(min > 0 ? min - 1 : 0, max == kUnbounded ? max : max - 1)
+                : "";
+            list = min > 0 ? item + rest + " " : "(" + item + rest + ")? ";
+        }
+        out = add_rule(name, "\"[\" space " + list + "\"]\" space");
+        return true;
+    }
+
+    const Json& root;
+    std::vector<std::pair<std::string, std::string>> rules;
+    std::unordered_map<std::string, size_t> index;
+    std::unordered_set<std::string> used;
+    std::unordered_map<std::string, std::string> refs;
+    std::string message;
+};
+
+struct GrammarCache {
+    std::mutex mutex;
+    std::unordered_map<std::string, std::shared_ptr<const Grammar>> grammars;
+    std::unordered_map<std::string, std::shared_ptr<const Grammar>> schemas;
+    uint64_t hits = 0;
+    uint64_t compiles = 0;
+};
+
+GrammarCache& cache() {
+    static GrammarCache* instance = new GrammarCache();
+    return *instance;
+}
+
+// Look up or build under the cache lock; compiling is fast next to a decode
+std::shared_ptr<const Grammar> cached(std::unordered_map<std::string, std::shared_ptr<const Grammar>>& map,
+                                      const std::string& key, std::string& error,
+                                      const std::function<std::shared_ptr<const Grammar>(std::string&)>& build) {
+    GrammarCache& c = cache();
+    std::lock_guard<std::mutex> lock(c.mutex);
+    auto it = map.find(key);
+    if (it != map.end()) {
+        c.hits++;
+        return it->second;
+    }
+    tracing::Span span(tracing::LLM, "grammar.compile");
+    std::shared_ptr<const Grammar> grammar = build(error);
+    if (grammar) {
+        c.compiles++;
+        if (map.size() >= kMaxCached) {
+            map.clear();
+        }
+        map.emplace(key, grammar);
+    }
+    return grammar;
+}
+
+}  // namespace
+
+std::shared_ptr<const Grammar> compile(const std::string& gbnf, std::string& error) {
+    auto grammar = std::make_shared<Grammar>();
+    Parser parser(gbnf);
+    if (!parser.parse(*grammar, error)) {
+        return nullptr;
+    }
+    return grammar;
+}
+
+bool schema_to_gbnf(const std::string& schema_json, std::string& gbnf, std::string& error) {
+    Json schema;
+    JsonParser parser(schema_json);
+    if (!parser.parse(schema, error)) {
+        return false;
+    }
+    SchemaConverter converter(schema);
+    return converter.convert(gbnf, error);
+}
+
+std::shared_ptr<const Grammar> compile_cached(const std::string& gbnf, std::string& error) {
+    return cached(cache().grammars, gbnf, error, [&gbnf](std::string& message) {
+        return compile(gbnf, message);
+    });
+}
+
+std::shared_ptr<const Grammar> compile_schema_cached(const std::string& schema_json, std::string& error) {
+    return cached(cache().schemas, schema_json, error, [&schema_json](std::string& message) {
+        std::string gbnf;
+        return schema_to_gbnf(schema_json, gbnf, message) ? compile(gbnf, message) : nullptr;
+    });
+}
+
+CacheStats cache_stats() {
+    GrammarCache& c = cache();
+    std::lock_guard<std::mutex> lock(c.mutex);
+    CacheStats stats;
+    stats.grammars = c.grammars.size() + c.schemas.size();
+    stats.hits = c.hits;
+    stats.compiles = c.compiles;
+    return stats;
+}
+
+void clear_cache() {
+    GrammarCache& c = cache();
+    std::lock_guard<std::mutex> lock(c.mutex);
+    c.grammars.clear();
+    c.schemas.clear();
+}
+
+Matcher::Matcher(std::shared_ptr<const Grammar> grammar) : grammar_(std::move(grammar)) {
+    push_alternatives(*grammar_, Stack(), grammar_->root, stacks);
+    update_first_bytes();
+}
+
+// Run `piece` (after any pending partial sequence) through the stacks.
+// A trailing incomplete UTF-8 sequence is allowed when some stack takes
+// non-ASCII characters next.
+bool Matcher::advance(std::string_view piece, std::vector<Stack>* next) const {
+    if (piece.empty()) {
+        return true;
+    }
+    if (partial.empty() && !first_bytes.test(static_cast<unsigned char>(piece[0]))) {
+        return false;
+    }
+
+    std::string joined;
+    std::string_view text = piece;
+    if (!partial.empty()) {
+        joined = partial;
+        joined.append(piece.data(), piece.size());
+        text = joined;
+    }
+
+    const Grammar& grammar = *grammar_;
+    std::vector<Stack> current = stacks;
+    std::vector<Stack> stepped;
+    for (size_t i = 0; i < text.size();) {
+        size_t length = sequence_length(static_cast<unsigned char>(text[i]));
+        if (i + length > text.size()) {
+            bool open = std::any_of(current.begin(), current.end(), [](const Stack& stack) {
+                return !stack.empty() && admits_non_ascii(stack.back());
+            });
+            if (!open) {
+                return false;
+            }
+            break;
+        }
+        uint32_t cp = decode(text.data() + i, length);
+        i += length;
+
+        stepped.clear();
+        for (const Stack& stack : current) {
+            const Element* after;
+            if (!stack.empty() && is_char(stack.back()) && match_char(stack.back(), cp, &after)) {
+                Stack moved(stack.begin(), stack.end() - 1);
+                if (!is_end(after)) {
+                    moved.push_back(after);
+                }
+                expand(grammar, moved, stepped);
+            }
+        }
+        if (stepped.empty()) {
+            return false;
+        }
+        current.swap(stepped);
+    }
+    if (next) {
+        *next = std::move(current);
+    }
+    return true;
+}
+
+bool Matcher::allows(std::string_view piece) const {
+    return advance(piece, nullptr);
+}
+
+bool Matcher::accept(std::string_view piece) {
+    std::vector<Stack> next;
+    if (!advance(piece, &next)) {
+        return false;
+    }
+    if (piece.empty()) {
+        return true;
+    }
+
+    // Keep an incomplete trailing sequence for the next piece
+    std::string text = partial;
+    text.append(piece.data(), piece.size());
+    size_t complete = 0;
+    while (complete < text.size()) {
+        size_t length = sequence_length(static_cast<unsigned char>(text[complete]));
+        if (complete + length > text.size()) {
+            break;
+        }
+        complete += length;
+    }
+    partial = text.substr(complete);
+    if (complete > 0) {
+        stacks = std::move(next);
+        update_first_bytes();
+    }
+    return true;
+}
+
+bool Matcher::can_end() const {
+    return partial.empty() && std::any_of(stacks.begin(), stacks.end(), [](const Stack& stack) {
+        return stack.empty();
+    });
+}
+
+bool Matcher::done() const {
+    return partial.empty() && std::all_of(stacks.begin(), stacks.end(), [](const Stack& stack) {
+        return stack.empty();
+    });
+}
+
+void Matcher::update_first_bytes() {
+    first_bytes.reset();
+    for (const Stack& stack : stacks) {
+        if (stack.empty()) {
+            continue;
+        }
+        const Element* top = stack.back();
+        const Element* after;
+        for (uint32_t c = 0; c < 0x80; ++c) {
+            if (!first_bytes.test(c) && match_char(top, c, &after)) {
+                first_bytes.set(c);
+            }
+        }
+        if (admits_non_ascii(top)) {
+            for (uint32_t c = 0x80; c < 0x100; ++c) {
+                first_bytes.set(c);
+            }
+        }
+    }
+}
+
+}  // namespace token_grammar
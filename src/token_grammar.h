@@ -0,0 +1,86 @@
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Grammar-constrained decoding, implemented in token_grammar.cpp.
+//
+// Grammars are written in GBNF (the llama.cpp grammar format) with a
+// `root` rule, or derived from a JSON schema. Compiling one resolves rule
+// references and repetitions into flat element lists once; a Matcher then
+// tracks where generated text can be in the grammar as a set of pushdown
+// stacks, so the sampler can drop tokens whose pieces would leave it.
+// Left-recursive rules are rejected when compiling.
+namespace token_grammar {
+
+struct Element;
+class Grammar;
+
+// Compile GBNF source; null with `error` set on a syntax error, an
+// undefined or left-recursive rule, or a missing root
+std::shared_ptr<const Grammar> compile(const std::string& gbnf, std::string& error);
+
+// GBNF accepting the JSON documents a JSON schema (given as JSON text)
+// describes. Supports type, properties/required, additionalProperties,
+// items/minItems/maxItems, enum, const, anyOf/oneOf, string lengths and
+// local $refs; pattern and format are not enforced.
+bool schema_to_gbnf(const std::string& schema_json, std::string& gbnf, std::string& error);
+
+// As compile() and schema_to_gbnf() + compile(), cached by source text so
+// each distinct grammar or schema compiles once per process
+std::shared_ptr<const Grammar> compile_cached(const std::string& gbnf, std::string& error);
+std::shared_ptr<const Grammar> compile_schema_cached(const std::string& schema_json, std::string& error);
+
+struct CacheStats {
+    size_t grammars = 0;
+    uint64_t hits = 0;
+    uint64_t compiles = 0;
+};
+
+CacheStats cache_stats();
+void clear_cache();
+
+// GBNF the grammar was compiled from (schemas: the generated GBNF)
+const std::string& source(const Grammar& grammar);
+size_t rule_count(const Grammar& grammar);
+
+// Position of generated text in a grammar. Text is fed as raw bytes; a
+// UTF-8 sequence split across pieces is completed by the next piece.
+class Matcher {
+public:
+    explicit Matcher(std::shared_ptr<const Grammar> grammar);
+
+    // Whether `piece` could be appended without leaving the grammar
+    bool allows(std::string_view piece) const;
+
+    // Append `piece`; false (and no change) if the grammar rejects it
+    bool accept(std::string_view piece);
+
+    // The text so far is a complete match
+    bool can_end() const;
+
+    // Complete, and nothing more can be appended
+    bool done() const;
+
+    const Grammar& grammar() const {
+        return *grammar_;
+    }
+
+private:
+    using Stack = std::vector<const Element*>;
+
+    bool advance(std::string_view piece, std::vector<Stack>* next) const;
+    void update_first_bytes();
+
+    std::shared_ptr<const Grammar> grammar_;
+    std::vector<Stack> stacks;
+    std::string partial;              // Incomplete UTF-8 sequence at the end of the text
+    std::bitset<256> first_bytes;     // Lead bytes some stack can take next
+};
+
+}  // namespace token_grammar
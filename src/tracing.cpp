@@ -0,0 +1,573 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+extern "C" {
+    #define PY_SSIZE_T_CLEAN
+    #include <Python.h>
+}
+
+#include "tracing.h"
+
+namespace tracing {
+
+std::atomic<uint32_t> g_categories{0};
+
+namespace {
+
+constexpr size_t kDefaultRingEvents = 8192;   // ~320 KB per recording thread
+constexpr size_t kMaxRingEvents = size_t(1) << 22;
+constexpr uint64_t kAsyncFlag = uint64_t(1) << 31;
+
+const char* const kCategoryNames[kCategoryCount] = {
+    "llm", "credentials", "executor", "memory", "documents", "scan", "cpu", "python"
+};
+
+// Every field is atomic so export can read a slot while its thread
+// overwrites it; a torn copy is detected through the ring head and dropped
+struct Event {
+    std::atomic<const char*> name{nullptr};
+    std::atomic<uint64_t> start{0};
+    std::atomic<uint64_t> end{0};
+    std::atomic<int64_t> value{-1};
+    std::atomic<uint64_t> meta{0};   // tid << 32 | async flag | category
+};
+
+struct Ring {
+    explicit Ring(size_t capacity) : events(new Event[capacity]), mask(capacity - 1) {
+    }
+
+    size_t capacity() const {
+        return mask + 1;
+    }
+
+    std::unique_ptr<Event[]> events;
+    size_t mask;
+    std::atomic<uint64_t> head{0};    // Spans ever written
+    std::atomic<uint64_t> floor{0};   // Spans before this were cleared
+};
+
+// Rings outlive their threads so their spans still export; a thread that
+// exits hands its ring to the next new one, so thread churn (connection
+// handlers) does not grow memory
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Ring>> rings;
+    std::vector<Ring*> retired;
+    std::unordered_map<uint32_t, std::string> thread_names;
+    std::unordered_set<std::string> names;   // Node-based: c_str() stays put
+    size_t ring_events = kDefaultRingEvents;
+};
+
+// Leaked: threads may still record while static destructors run
+Registry& registry() {
+    static Registry* instance = new Registry();
+    return *instance;
+}
+
+uint32_t current_tid() {
+#ifdef __linux__
+    return static_cast<uint32_t>(syscall(SYS_gettid));
+#else
+    return static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id()));
+#endif
+}
+
+struct ThreadRing {
+    Ring* ring = nullptr;
+    uint32_t tid = 0;
+
+    ~ThreadRing() {
+        if (ring) {
+            Registry& reg = registry();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+            reg.retired.push_back(ring);
+            ring = nullptr;
+        }
+    }
+};
+
+thread_local ThreadRing t_ring;
+
+Ring* attach() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    if (!reg.retired.empty()) {
+        t_ring.ring = reg.retired.back();
+        reg.retired.pop_back();
+    } else {
+        reg.rings.push_back(std::make_unique<Ring>(reg.ring_events));
+        t_ring.ring = reg.rings.back().get();
+    }
+    t_ring.tid = current_tid();
+    return t_ring.ring;
+}
+
+size_t round_ring_size(size_t events) {
+    size_t size = 64;
+    while (size < events && size < kMaxRingEvents) {
+        size <<= 1;
+    }
+    return size;
+}
+
+struct Copied {
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+    int64_t value;
+    uint64_t meta;
+};
+
+// Spans of one ring still valid after the copy. Called with the registry
+// mutex held, which only keeps rings from being added.
+void copy_ring(const Ring& ring, std::vector<Copied>& out) {
+    const uint64_t capacity = ring.capacity();
+    uint64_t head = ring.head.load(std::memory_order_acquire);
+    uint64_t begin = std::max(ring.floor.load(std::memory_order_relaxed), head > capacity ? head - capacity : 0);
+
+    size_t first = out.size();
+    for (uint64_t i = begin; i < head; ++i) {
+        const Event& event = ring.events[i & ring.mask];
+        out.push_back({event.name.load(std::memory_order_relaxed), event.start.load(std::memory_order_relaxed),
+                       event.end.load(std::memory_order_relaxed), event.value.load(std::memory_order_relaxed),
+                       event.meta.load(std::memory_order_relaxed)});
+    }
+
+    // A slot is intact unless the writer has since reached its next lap;
+    // the one it may be writing right now counts as reached
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t now = ring.head.load(std::memory_order_relaxed);
+    uint64_t valid_from = now >= capacity ? now - capacity + 1 : 0;
+    if (valid_from > begin) {
+        size_t stale = static_cast<size_t>(std::min(valid_from, head) - begin);
+        out.erase(out.begin() + first, out.begin() + first + stale);
+    }
+}
+
+void append_json_string(std::string& out, const char* text) {
+    out += '"';
+    for (const char* p = text; *p; ++p) {
+        unsigned char c = static_cast<unsigned char>(*p);
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += static_cast<char>(c);
+        } else if (c < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+    out += '"';
+}
+
+// Trace event timestamps are microseconds; keep the nanoseconds as decimals
+void append_micros(std::string& out, uint64_t ns) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%llu.%03u", static_cast<unsigned long long>(ns / 1000),
+                  static_cast<unsigned>(ns % 1000));
+    out += text;
+}
+
+int process_id() {
+#if defined(__unix__) || defined(__APPLE__)
+    return static_cast<int>(getpid());
+#else
+    return 0;
+#endif
+}
+
+}  // namespace
+
+const char* category_name(uint32_t category) {
+    for (int i = 0; i < kCategoryCount; ++i) {
+        if (category == (1u << i)) {
+            return kCategoryNames[i];
+        }
+    }
+    return nullptr;
+}
+
+void enable(uint32_t categories, size_t ring_events) {
+    if (ring_events) {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.ring_events = round_ring_size(ring_events);
+    }
+    g_categories.store(categories & ALL, std::memory_order_relaxed);
+}
+
+void disable() {
+    g_categories.store(0, std::memory_order_relaxed);
+}
+
+void emit(Category category, const char* name, uint64_t start_ns, uint64_t end_ns, int64_t value, bool async) {
+    Ring* ring = t_ring.ring ? t_ring.ring : attach();
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    Event& event = ring->events[head & ring->mask];
+
+    // Orders the previous head store before these, so export sees a slot
+    // being overwritten as already lapped
+    std::atomic_thread_fence(std::memory_order_release);
+    event.name.store(name, std::memory_order_relaxed);
+    event.start.store(start_ns, std::memory_order_relaxed);
+    event.end.store(std::max(end_ns, start_ns), std::memory_order_relaxed);
+    event.value.store(value, std::memory_order_relaxed);
+    event.meta.store(static_cast<uint64_t>(t_ring.tid) << 32 | (async ? kAsyncFlag : 0) | category,
+                     std::memory_order_relaxed);
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+const char* intern(const std::string& name) {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    return reg.names.insert(name).first->c_str();
+}
+
+void set_thread_name(const std::string& name) {
+    uint32_t tid = t_ring.ring ? t_ring.tid : current_tid();
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.thread_names[tid] = name;
+}
+
+std::string export_chrome(size_t* events) {
+    std::vector<Copied> spans;
+    std::vector<std::pair<uint32_t, std::string>> threads;
+    {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        for (const auto& ring : reg.rings) {
+            copy_ring(*ring, spans);
+        }
+        threads.assign(reg.thread_names.begin(), reg.thread_names.end());
+    }
+    std::sort(spans.begin(), spans.end(), [](const Copied& a, const Copied& b) {
+        // Enclosing spans first, so viewers nest ones that start together
+        return a.start != b.start ? a.start < b.start : a.end > b.end;
+    });
+    std::sort(threads.begin(), threads.end());
+
+    const std::string pid = std::to_string(process_id());
+    std::string out;
+    out.reserve(128 * (spans.size() + threads.size()) + 256);
+    out += "{\"traceEvents\":[\n";
+    out += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" + pid + ",\"args\":{\"name\":\"credentialforge\"}}";
+    for (const auto& thread : threads) {
+        out += ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + pid + ",\"tid\":" + std::to_string(thread.first) +
+               ",\"args\":{\"name\":";
+        append_json_string(out, thread.second.c_str());
+        out += "}}";
+    }
+    // Complete events for spans, begin/end pairs for async ones
+    uint64_t async_id = 0;
+    for (const Copied& span : spans) {
+        const char* cat = category_name(static_cast<uint32_t>(span.meta & (kAsyncFlag - 1)));
+        bool async = (span.meta & kAsyncFlag) != 0;
+        std::string head = ",\n{\"name\":";
+        append_json_string(head, span.name ? span.name : "");
+        head += ",\"cat\":\"";
+        head += cat ? cat : "unknown";
+        head += "\",\"pid\":" + pid + ",\"tid\":" + std::to_string(span.meta >> 32);
+        std::string id = async ? ",\"id\":" + std::to_string(++async_id) : std::string();
+
+        out += head;
+        out += async ? ",\"ph\":\"b\"" + id : std::string(",\"ph\":\"X\",\"dur\":");
+        if (!async) {
+            append_micros(out, span.end - span.start);
+        }
+        out += ",\"ts\":";
+        append_micros(out, span.start);
+        if (span.value >= 0) {
+            out += ",\"args\":{\"value\":" + std::to_string(span.value) + "}";
+        }
+        out += '}';
+        if (async) {
+            out += head + ",\"ph\":\"e\"" + id + ",\"ts\":";
+            append_micros(out, span.end);
+            out += '}';
+        }
+    }
+    out += "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    if (events) {
+        *events = spans.size();
+    }
+    return out;
+}
+
+void clear() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (const auto& ring : reg.rings) {
+        ring->floor.store(ring->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+}
+
+Stats stats() {
+    Stats result;
+    result.categories = g_categories.load(std::memory_order_relaxed);
+
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    result.threads = reg.rings.size() - reg.retired.size();
+    result.ring_events = reg.ring_events;
+    for (const auto& ring : reg.rings) {
+        uint64_t head = ring->head.load(std::memory_order_relaxed);
+        uint64_t lapped = head > ring->capacity() ? head - ring->capacity() : 0;
+        result.recorded += head;
+        result.overwritten += lapped;
+        // As copy_ring(): a full ring exports one slot short
+        uint64_t valid_from = head >= ring->capacity() ? lapped + 1 : 0;
+        result.buffered += head - std::max(valid_from, std::min(ring->floor.load(std::memory_order_relaxed), head));
+    }
+    return result;
+}
+
+}  // namespace tracing
+
+// Category names (a string or a sequence of them, "all" for every one) to a mask
+static bool parse_categories(PyObject* obj, uint32_t& mask) {
+    mask = 0;
+    if (obj == Py_None) {
+        mask = tracing::ALL;
+        return true;
+    }
+
+    PyObject* seq = PyUnicode_Check(obj) ? PyTuple_Pack(1, obj)
+                                         : PySequence_Fast(obj, "categories must be a name or a sequence of names");
+    if (!seq) {
+        return false;
+    }
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    for (Py_ssize_t i = 0; i < n; ++i) {
+        PyObject* item = PySequence_Fast_GET_ITEM(seq, i);
+        const char* name = PyUnicode_Check(item) ? PyUnicode_AsUTF8(item) : nullptr;
+        if (!name) {
+            Py_DECREF(seq);
+            PyErr_SetString(PyExc_TypeError, "Category names must be strings");
+            return false;
+        }
+        if (std::strcmp(name, "all") == 0) {
+            mask |= tracing::ALL;
+            continue;
+        }
+        uint32_t bit = 0;
+        for (int c = 0; c < tracing::kCategoryCount; ++c) {
+            if (std::strcmp(name, tracing::category_name(1u << c)) == 0) {
+                bit = 1u << c;
+            }
+        }
+        if (!bit) {
+            Py_DECREF(seq);
+            PyErr_Format(PyExc_ValueError, "Unknown trace category '%s'", name);
+            return false;
+        }
+        mask |= bit;
+    }
+    Py_DECREF(seq);
+    return true;
+}
+
+static PyObject* category_list(uint32_t mask) {
+    PyObject* list = PyList_New(0);
+    for (int c = 0; list && c < tracing::kCategoryCount; ++c) {
+        if (mask & (1u << c)) {
+            PyObject* name = PyUnicode_FromString(tracing::category_name(1u << c));
+            if (!name || PyList_Append(list, name) < 0) {
+                Py_XDECREF(name);
+                Py_CLEAR(list);
+                break;
+            }
+            Py_DECREF(name);
+        }
+    }
+    return list;
+}
+
+static PyObject* tracing_enable(PyObject* self, PyObject* args) {
+    PyObject* categories_obj = Py_None;
+    Py_ssize_t ring_events = 0;
+
+    if (!PyArg_ParseTuple(args, "|On", &categories_obj, &ring_events)) {
+        return nullptr;
+    }
+    if (ring_events < 0) {
+        PyErr_SetString(PyExc_ValueError, "ring_events must not be negative");
+        return nullptr;
+    }
+
+    uint32_t mask;
+    if (!parse_categories(categories_obj, mask)) {
+        return nullptr;
+    }
+    tracing::enable(mask, static_cast<size_t>(ring_events));
+    return category_list(mask);
+}
+
+static PyObject* tracing_disable(PyObject* self, PyObject* args) {
+    tracing::disable();
+    Py_RETURN_NONE;
+}
+
+static PyObject* tracing_is_enabled(PyObject* self, PyObject* args) {
+    PyObject* categories_obj = Py_None;
+
+    if (!PyArg_ParseTuple(args, "|O", &categories_obj)) {
+        return nullptr;
+    }
+
+    uint32_t mask;
+    if (!parse_categories(categories_obj, mask)) {
+        return nullptr;
+    }
+    return PyBool_FromLong((tracing::g_categories.load(std::memory_order_relaxed) & mask) != 0);
+}
+
+static PyObject* tracing_record(PyObject* self, PyObject* args) {
+    const char* name;
+    unsigned long long start_ns;
+    unsigned long long end_ns;
+    PyObject* category_obj = nullptr;
+    long long value = -1;
+
+    if (!PyArg_ParseTuple(args, "sKK|OL", &name, &start_ns, &end_ns, &category_obj, &value)) {
+        return nullptr;
+    }
+
+    uint32_t category = tracing::PYTHON;
+    if (category_obj && !parse_categories(category_obj, category)) {
+        return nullptr;
+    }
+    if (category == 0 || (category & (category - 1)) != 0) {
+        PyErr_SetString(PyExc_ValueError, "A span takes exactly one category");
+        return nullptr;
+    }
+
+    if (tracing::enabled(static_cast<tracing::Category>(category))) {
+        tracing::emit(static_cast<tracing::Category>(category), tracing::intern(name), start_ns, end_ns, value);
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject* tracing_set_thread_name(PyObject* self, PyObject* args) {
+    const char* name;
+
+    if (!PyArg_ParseTuple(args, "s", &name)) {
+        return nullptr;
+    }
+    tracing::set_thread_name(name);
+    Py_RETURN_NONE;
+}
+
+static PyObject* tracing_export(PyObject* self, PyObject* args) {
+    const char* path = nullptr;
+
+    if (!PyArg_ParseTuple(args, "|z", &path)) {
+        return nullptr;
+    }
+
+    std::string json;
+    size_t events = 0;
+    bool written = true;
+    Py_BEGIN_ALLOW_THREADS
+    json = tracing::export_chrome(&events);
+    if (path) {
+        FILE* file = std::fopen(path, "wb");
+        written = file && std::fwrite(json.data(), 1, json.size(), file) == json.size();
+        if (file && std::fclose(file) != 0) {
+            written = false;
+        }
+    }
+    Py_END_ALLOW_THREADS
+
+    if (!path) {
+        return PyUnicode_FromStringAndSize(json.data(), static_cast<Py_ssize_t>(json.size()));
+    }
+    if (!written) {
+        PyErr_SetFromErrnoWithFilename(PyExc_OSError, path);
+        return nullptr;
+    }
+    return PyLong_FromSize_t(events);
+}
+
+static PyObject* tracing_clear(PyObject* self, PyObject* args) {
+    tracing::clear();
+    Py_RETURN_NONE;
+}
+
+static PyObject* tracing_get_stats(PyObject* self, PyObject* args) {
+    tracing::Stats stats = tracing::stats();
+
+    PyObject* categories = category_list(stats.categories);
+    if (!categories) {
+        return nullptr;
+    }
+    PyObject* result = Py_BuildValue("{s:N,s:n,s:n,s:n,s:K,s:K}",
+                                     "categories", categories,
+                                     "threads", static_cast<Py_ssize_t>(stats.threads),
+                                     "ring_events", static_cast<Py_ssize_t>(stats.ring_events),
+                                     "buffered", static_cast<Py_ssize_t>(stats.buffered),
+                                     "recorded", static_cast<unsigned long long>(stats.recorded),
+                                     "overwritten", static_cast<unsigned long long>(stats.overwritten));
+    return result;
+}
+
+static PyObject* tracing_now_ns(PyObject* self, PyObject* args) {
+    return PyLong_FromUnsignedLongLong(tracing::now_ns());
+}
+
+static PyMethodDef TracingMethods[] = {
+    {"enable", tracing_enable, METH_VARARGS, "Record spans: enable(categories=None (all), ring_events=0) -> enabled category names"},
+    {"disable", tracing_disable, METH_NOARGS, "Stop recording spans; recorded ones stay exportable"},
+    {"is_enabled", tracing_is_enabled, METH_VARARGS, "Whether any of the categories (default: any) is recorded"},
+    {"record", tracing_record, METH_VARARGS, "Record a finished span: record(name, start_ns, end_ns, category='python', value=-1)"},
+    {"set_thread_name", tracing_set_thread_name, METH_VARARGS, "Label the calling thread's track in exported traces"},
+    {"export", tracing_export, METH_VARARGS, "Chrome trace JSON: export() -> str, export(path) -> span count written"},
+    {"clear", tracing_clear, METH_NOARGS, "Forget recorded spans"},
+    {"get_stats", tracing_get_stats, METH_NOARGS, "Enabled categories, threads, ring size and span counts"},
+    {"now_ns", tracing_now_ns, METH_NOARGS, "The span clock (same as time.monotonic_ns())"},
+    {nullptr, nullptr, 0, nullptr}
+};
+
+// No per-module state: the rings are process-wide
+static PyModuleDef_Slot TracingSlots[] = {
+#if PY_VERSION_HEX >= 0x030C0000
+    {Py_mod_multiple_interpreters, Py_MOD_MULTIPLE_INTERPRETERS_SUPPORTED},
+#endif
+#if PY_VERSION_HEX >= 0x030D0000
+    {Py_mod_gil, Py_MOD_GIL_NOT_USED},
+#endif
+    {0, nullptr}
+};
+
+static struct PyModuleDef tracingmodule = {
+    PyModuleDef_HEAD_INIT,
+    "tracing",
+    "Low-overhead timeline tracing across the native modules",
+    0,
+    TracingMethods,
+    TracingSlots
+};
+
+PyMODINIT_FUNC PyInit_tracing(void) {
+    return PyModuleDef_Init(&tracingmodule);
+}
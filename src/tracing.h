@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Timeline tracing for the native modules and the Python pipeline,
+// implemented in tracing.cpp.
+//
+// Each thread writes finished spans into its own ring buffer: one writer
+// per ring, no locks, and the oldest spans are overwritten when it wraps.
+// Export copies the rings and skips slots overwritten meanwhile, so
+// recording never waits on it. A span in a disabled category costs one
+// relaxed load, which keeps the instrumentation in release builds.
+// Traces export as Chrome trace event JSON, which Perfetto also opens.
+namespace tracing {
+
+enum Category : uint32_t {
+    LLM = 1u << 0,           // Scheduler steps, drafting, queue waits, grammars
+    CREDENTIALS = 1u << 1,   // Generation and pattern scans
+    EXECUTOR = 1u << 2,      // ParallelExecutor tasks and their queue waits
+    MEMORY = 1u << 3,        // Budget reclaims and throttling
+    DOCUMENTS = 1u << 4,     // Templates and OOXML writers
+    SCAN = 1u << 5,          // Corpus scanner files
+    CPU = 1u << 6,           // CPU optimizer string processing
+    PYTHON = 1u << 7,        // Spans recorded from Python
+    ALL = (1u << 8) - 1
+};
+
+constexpr int kCategoryCount = 8;
+
+// Name of a single category bit, nullptr for anything else
+const char* category_name(uint32_t category);
+
+extern std::atomic<uint32_t> g_categories;
+
+inline bool enabled(Category category) {
+    return (g_categories.load(std::memory_order_relaxed) & category) != 0;
+}
+
+// Monotonic clock the spans use; same epoch as Python's time.monotonic_ns()
+inline uint64_t now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Record the categories in `categories` from now on. `ring_events` sizes
+// rings allocated afterwards (rounded up to a power of two, 0 keeps the
+// current size); a thread reuses the ring of one that exited if it can.
+void enable(uint32_t categories, size_t ring_events = 0);
+void disable();
+
+// Append a finished span to the calling thread's ring. `name` must stay
+// valid until the trace is exported: a literal or an intern()ed string.
+// `value` shows up as args.value when not negative. An async span may
+// overlap the thread's other spans without nesting in them.
+void emit(Category category, const char* name, uint64_t start_ns, uint64_t end_ns, int64_t value, bool async = false);
+
+inline void record(Category category, const char* name, uint64_t start_ns, uint64_t end_ns, int64_t value = -1) {
+    if (enabled(category)) {
+        emit(category, name, start_ns, end_ns, value);
+    }
+}
+
+// A wait that began before the recording thread picked the work up (queue
+// waits), recorded as an async span
+inline void record_wait(Category category, const char* name, uint64_t start_ns, uint64_t end_ns, int64_t value = -1) {
+    if (enabled(category)) {
+        emit(category, name, start_ns, end_ns, value, true);
+    }
+}
+
+// Stable copy of a dynamic span name (names from Python); kept for the
+// life of the process, so meant for a bounded set of names
+const char* intern(const std::string& name);
+
+// Label the calling thread's track in exported traces
+void set_thread_name(const std::string& name);
+
+// Chrome trace event JSON of every span still in the rings
+std::string export_chrome(size_t* events = nullptr);
+
+// Forget the recorded spans; rings stay allocated
+void clear();
+
+struct Stats {
+    uint32_t categories = 0;
+    size_t threads = 0;           // Threads that have recorded
+    size_t ring_events = 0;       // Ring size for new threads
+    size_t buffered = 0;          // Spans export would return
+    uint64_t recorded = 0;
+    uint64_t overwritten = 0;     // Lost to ring wraparound
+};
+
+Stats stats();
+
+// Times the enclosing scope when its category is enabled at construction
+class Span {
+public:
+    Span(Category category, const char* name, int64_t value = -1)
+        : category_(category), name_(name), value_(value), start_(enabled(category) ? now_ns() : 0) {
+    }
+    ~Span() {
+        if (start_) {
+            emit(category_, name_, start_, now_ns(), value_);
+        }
+    }
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+    void set_value(int64_t value) {
+        value_ = value;
+    }
+
+private:
+    Category category_;
+    const char* name_;
+    int64_t value_;
+    uint64_t start_;
+};
+
+}  // namespace tracing
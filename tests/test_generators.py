@@ -10,6 +10,7 @@ from credentialforge.generators.credential_generator import CredentialGenerator
 from credentialforge.generators.topic_generator import TopicGenerator
 from credentialforge.db.regex_db import RegexDatabase
 from credentialforge.llm.llama_interface import LlamaInterface
+from credentialforge.utils.exceptions import GenerationError
 
 
 class TestCredentialGenerator:
@@ -68,6 +69,31 @@ class TestCredentialGenerator:
             assert result1 != result2
             assert len(generator.generated_credentials) == 2
     
+    def test_generate_credential_unique_on_last_attempt(self, generator, mock_regex_db):
+        """Test a credential that becomes unique on the final retry is accepted."""
+        generator.generated_credentials.add('AKIADUPLICATE0000000')
+        values = ['AKIADUPLICATE0000000'] * 64 + ['AKIAUNIQUE0000000000']
+        with patch.object(generator, '_generate_fast', side_effect=values):
+            assert generator.generate_credential('aws_access_key') == 'AKIAUNIQUE0000000000'
+        
+        with patch.object(generator, '_generate_fast', return_value='AKIADUPLICATE0000000'):
+            with pytest.raises(GenerationError):
+                generator.generate_credential('aws_access_key')
+    
+    def test_generate_credential_retries_claimed_value(self, generator, mock_regex_db):
+        """Test a value claimed by another process between check and add is regenerated."""
+        claimed = {'AKIACLAIMED000000000'}
+        local = set()
+        shared = Mock()
+        shared.__contains__ = Mock(side_effect=lambda value: value in local)
+        shared.add = Mock(side_effect=lambda value: value not in claimed and not local.add(value))
+        generator.generated_credentials = shared
+        
+        values = ['AKIACLAIMED000000000', 'AKIAUNIQUE0000000000']
+        with patch.object(generator, '_generate_fast', side_effect=values):
+            assert generator.generate_credential('aws_access_key') == 'AKIAUNIQUE0000000000'
+        assert local == {'AKIAUNIQUE0000000000'}
+    
     def test_generate_batch(self, generator, mock_regex_db):
         """Test batch credential generation."""
         with patch.object(generator, '_apply_generator', return_value='AKIA1234567890ABCDEF'):
@@ -0,0 +1,58 @@
+"""Tests for the native corpus scanner."""
+
+import os
+import zipfile
+
+import pytest
+
+corpus_scanner = pytest.importorskip("credentialforge.native.corpus_scanner")
+credential_utils = pytest.importorskip("credentialforge.native.credential_utils")
+
+REGEX_DB_PATH = os.path.join(os.path.dirname(__file__), '..', 'data', 'regex_db.json')
+
+
+@pytest.fixture
+def corpus(tmp_path):
+    """A text file, a deflated docx-like zip and a file without credentials."""
+    credential_utils.compile_patterns(REGEX_DB_PATH)
+    keys = credential_utils.generate('aws_access_key', 2)
+    
+    (tmp_path / "notes.txt").write_text(f"access key: {keys[0]}\n")
+    with zipfile.ZipFile(tmp_path / "report.docx", "w", zipfile.ZIP_DEFLATED) as archive:
+        archive.writestr("word/document.xml", f"<w:document><w:t>{keys[1]}</w:t></w:document>")
+    (tmp_path / "empty.txt").write_text("nothing to see\n")
+    return tmp_path, keys
+
+
+class TestScan:
+    """Test cases for corpus_scanner.scan."""
+    
+    def test_finds_embedded_credentials(self, corpus):
+        """Test each file reports the credential written into it."""
+        directory, keys = corpus
+        
+        result = corpus_scanner.scan([str(directory)], ['aws_access_key'])
+        
+        files = {os.path.basename(entry['path']): entry for entry in result['files']}
+        assert files['notes.txt']['hits'] == {'aws_access_key': [keys[0]]}
+        assert files['report.docx']['hits'] == {'aws_access_key': [keys[1]]}
+        assert files['report.docx']['format'] == 'zip'
+        assert files['empty.txt']['hits'] == {}
+        assert result['stats']['files'] == 3
+        assert result['stats']['matches'] == 2
+    
+    def test_missing_file_is_reported(self, corpus):
+        """Test an unreadable path becomes a per-file error, not an exception."""
+        directory, _ = corpus
+        
+        result = corpus_scanner.scan([str(directory / "missing.txt")], ['aws_access_key'])
+        
+        assert result['stats']['failed'] == 1
+        assert result['files'][0]['error']
+    
+    def test_unknown_type(self, corpus):
+        """Test an unknown credential type raises KeyError."""
+        directory, _ = corpus
+        
+        with pytest.raises(KeyError):
+            corpus_scanner.scan([str(directory)], ['no_such_type'])
@@ -0,0 +1,266 @@
+"""Tests for the native credential_utils module against the Python path."""
+
+import json
+import os
+import re
+import uuid
+
+import pytest
+
+credential_utils = pytest.importorskip("credentialforge.native.credential_utils")
+
+REGEX_DB_PATH = os.path.join(os.path.dirname(__file__), '..', 'data', 'regex_db.json')
+
+
+@pytest.fixture(scope="module")
+def patterns():
+    """regex_db.json entries, compiled into the native registry."""
+    credential_utils.compile_patterns(REGEX_DB_PATH)
+    with open(REGEX_DB_PATH) as f:
+        return json.load(f)['credentials']
+
+
+class TestGenerateBatch:
+    """Test cases for credential_utils.generate_batch."""
+    
+    def test_list_has_count_per_type(self):
+        """Test the flat list holds count credentials for each type in order."""
+        result = credential_utils.generate_batch(['aws_access_key', 'jwt_token'], 3)
+        
+        assert len(result) == 6
+        assert all(credential.startswith('AKIA') for credential in result[:3])
+        assert all(credential.startswith('eyJ') for credential in result[3:])
+    
+    def test_as_dict_keys_by_type(self):
+        """Test as_dict maps each type to its credentials."""
+        result = credential_utils.generate_batch(['aws_access_key', 'jwt_token'], 2, True)
+        
+        assert sorted(result) == ['aws_access_key', 'jwt_token']
+        assert len(result['aws_access_key']) == 2
+        assert len(result['jwt_token']) == 2
+    
+    def test_as_dict_merges_repeated_types(self):
+        """Test a type listed twice keeps the credentials of both entries."""
+        result = credential_utils.generate_batch(['aws_access_key', 'jwt_token', 'aws_access_key'], 2, True)
+        
+        assert len(result['aws_access_key']) == 4
+        assert len(result['jwt_token']) == 2
+        assert all(credential.startswith('AKIA') for credential in result['aws_access_key'])
+    
+    def test_seed_reproduces_batch(self):
+        """Test a fixed seed reproduces the same batch with xoshiro256** and ChaCha20."""
+        types = ['aws_access_key', 'jwt_token', 'aws_access_key']
+        batches = {}
+        for mode in ('fast', 'crypto'):
+            credential_utils.seed(1234)
+            first = credential_utils.generate_batch(types, 50, False, mode)
+            credential_utils.seed(1234)
+            second = credential_utils.generate_batch(types, 50, False, mode)
+            credential_utils.seed(4321)
+            other = credential_utils.generate_batch(types, 50, False, mode)
+            
+            assert first == second, mode
+            assert first != other, mode
+            batches[mode] = first
+        
+        assert batches['fast'] != batches['crypto']
+    
+    def test_kernel_levels_agree(self):
+        """Test the scalar and vector map_alphabet kernels give byte-identical batches."""
+        cpu_optimizer = pytest.importorskip("credentialforge.native.cpu_optimizer")
+        types = ['aws_access_key', 'jwt_token']
+        
+        batches = {}
+        try:
+            for level in ('scalar', 'ssse3', 'avx2', 'avx512vbmi'):
+                # Levels the CPU lacks are capped to the best it has
+                active = cpu_optimizer.set_kernel_level(level)
+                for mode in ('fast', 'crypto'):
+                    credential_utils.seed(99)
+                    batches[active, mode] = credential_utils.generate_batch(types, 200, False, mode)
+        finally:
+            cpu_optimizer.set_kernel_level(None)
+        
+        for (active, mode), batch in batches.items():
+            assert batch == batches['scalar', mode], active
+
+
+class TestFingerprintSet:
+    """Test cases for credential_utils.FingerprintSet."""
+    
+    @pytest.fixture
+    def shared_name(self):
+        """Unique shared-memory name, removed if a test leaves it behind."""
+        name = f"cf-test-{uuid.uuid4().hex}"
+        yield name
+        for path in os.listdir('/dev/shm') if os.path.isdir('/dev/shm') else []:
+            if path.startswith(name):
+                os.unlink(os.path.join('/dev/shm', path))
+    
+    def test_local_add_contains_len(self):
+        """Test a process-local set behaves like a Python set of credentials."""
+        fingerprints = credential_utils.FingerprintSet(1024)
+        
+        assert fingerprints.add(b'AKIA0000000000000000') is True
+        assert fingerprints.add('AKIA0000000000000000') is False
+        assert 'AKIA0000000000000000' in fingerprints
+        assert 'AKIA1111111111111111' not in fingerprints
+        assert len(fingerprints) == 1
+        
+        fingerprints.clear()
+        assert len(fingerprints) == 0
+    
+    def test_local_set_grows_past_capacity(self):
+        """Test a local set keeps accepting credentials beyond its capacity."""
+        fingerprints = credential_utils.FingerprintSet(16)
+        keys = [f"key-{i}" for i in range(5000)]
+        
+        assert fingerprints.update(keys) == 5000
+        assert fingerprints.update(keys) == 0
+        assert len(fingerprints) == 5000
+        assert all(key in fingerprints for key in keys)
+    
+    def test_shared_set_grows_past_capacity(self, shared_name):
+        """Test a full shared set continues in new generations."""
+        fingerprints = credential_utils.FingerprintSet(64, 8, shared_name)
+        keys = [f"key-{i}" for i in range(5000)]
+        
+        assert fingerprints.update(keys) == 5000
+        assert fingerprints.update(keys) == 0
+        assert len(fingerprints) == 5000
+        assert all(key in fingerprints for key in keys)
+        assert 'missing' not in fingerprints
+        assert fingerprints.stats()['generations'] > 1
+    
+    def test_shared_handles_see_each_other(self, shared_name):
+        """Test two handles on one name share contents, including new generations."""
+        first = credential_utils.FingerprintSet(64, 8, shared_name)
+        second = credential_utils.FingerprintSet(64, 8, shared_name)
+        keys = [f"key-{i}" for i in range(2000)]
+        
+        assert first.update(keys[:1000]) == 1000
+        assert second.update(keys) == 1000
+        assert len(first) == 2000
+        assert all(key in first for key in keys)
+    
+    def test_shared_set_name_removed_by_last_handle(self, shared_name):
+        """Test the segment outlives its creator while another handle is open."""
+        first = credential_utils.FingerprintSet(64, 0, shared_name)
+        second = credential_utils.FingerprintSet(64, 0, shared_name)
+        first.add('kept')
+        
+        del first
+        assert shared_name in os.listdir('/dev/shm')
+        third = credential_utils.FingerprintSet(64, 0, shared_name)
+        assert 'kept' in third
+        
+        del second, third
+        assert shared_name not in os.listdir('/dev/shm')
+    
+    def test_uninitialized_set_raises(self):
+        """Test a set created without __init__ raises instead of crashing."""
+        fingerprints = credential_utils.FingerprintSet.__new__(credential_utils.FingerprintSet)
+        
+        with pytest.raises(RuntimeError, match="not initialized"):
+            fingerprints.add(b'x')
+        with pytest.raises(RuntimeError, match="not initialized"):
+            fingerprints.update([b'x'])
+        with pytest.raises(RuntimeError, match="not initialized"):
+            b'x' in fingerprints
+        with pytest.raises(RuntimeError, match="not initialized"):
+            len(fingerprints)
+        with pytest.raises(RuntimeError, match="not initialized"):
+            fingerprints.stats()
+    
+    def test_generate_batch_unique_across_handles(self, shared_name):
+        """Test generation through two handles on one name never repeats."""
+        first = credential_utils.FingerprintSet(64, 8, shared_name)
+        second = credential_utils.FingerprintSet(64, 8, shared_name)
+        
+        batch = credential_utils.generate_batch(['aws_access_key'], 500, False, None, first)
+        batch += credential_utils.generate_batch(['aws_access_key'], 500, False, None, second)
+        
+        assert len(set(batch)) == 1000
+        assert len(first) == 1000
+
+
+class TestCompilePatterns:
+    """Test cases for credential_utils.compile_patterns."""
+    
+    def test_malformed_hex_escape(self, tmp_path):
+        """Test a bad \\x escape skips its pattern instead of aborting."""
+        db_path = tmp_path / "regex_db.json"
+        db_path.write_text(json.dumps({'credentials': [
+            {'type': 'bad_hex', 'regex': r'^a\xZZ$'},
+            {'type': 'good_hex', 'regex': r'^a\x41$'},
+        ]}))
+        try:
+            assert credential_utils.compile_patterns(str(db_path)) == 1
+            with pytest.raises(KeyError):
+                credential_utils.generate('bad_hex', 1)
+            assert credential_utils.generate('good_hex', 1) == ['aA']
+        finally:
+            credential_utils.compile_patterns(REGEX_DB_PATH)
+
+
+class TestValidateBatch:
+    """Test cases for credential_utils.validate_batch against the re module."""
+    
+    def test_agrees_with_fullmatch(self, patterns):
+        """Test every regex_db type accepts and rejects what re.fullmatch does."""
+        for entry in patterns:
+            credentials = credential_utils.generate(entry['type'], 5)
+            candidates = list(credentials)
+            for credential in credentials:
+                candidates += [credential[:-1], credential + 'x', credential[1:], '',
+                               credential.upper(), credential.lower(),
+                               credential[:len(credential) // 2] + '!' + credential[len(credential) // 2 + 1:]]
+            
+            expected = [bool(re.fullmatch(entry['regex'], candidate)) for candidate in candidates]
+            assert credential_utils.validate_batch(entry['type'], candidates) == expected, entry['type']
+    
+    def test_invalid_pattern_is_false(self):
+        """Test validate_credential() returns False for patterns that do not compile."""
+        for pattern in (r'a\xZZ', r'a\x4', '(abc', 'a{3,1}', '[z-a]'):
+            assert credential_utils.validate_credential('abc', pattern) is False, pattern
+        assert credential_utils.validate_credential('aA', r'a\x41') is True
+    
+    def test_one_type_per_credential(self, patterns):
+        """Test a list of types pairs each credential with its own type."""
+        aws = credential_utils.generate('aws_access_key', 1)[0]
+        jwt = credential_utils.generate('jwt_token', 1)[0]
+        
+        result = credential_utils.validate_batch(['aws_access_key', 'jwt_token', 'jwt_token'], [aws, jwt, aws])
+        
+        assert result == [True, True, False]
+
+
+class TestScan:
+    """Test cases for credential_utils.scan and verify."""
+    
+    @pytest.fixture
+    def document(self, patterns):
+        """A document with two embedded credentials of three types."""
+        embedded = {t: credential_utils.generate(t, 2) for t in ('aws_access_key', 'github_token', 'jwt_token')}
+        lines = [f"{t} = {credential}" for t, credentials in embedded.items() for credential in credentials]
+        return "Deployment notes\n" + "\n".join(lines) + "\nend\n", embedded
+    
+    def test_scan_finds_embedded(self, document):
+        """Test scan() finds exactly the credentials just embedded."""
+        text, embedded = document
+        data = text.encode()
+        
+        matches = credential_utils.scan(text, list(embedded))
+        
+        found = {t: [data[start:end].decode() for start, end in spans] for t, spans in matches.items()}
+        assert found == embedded
+    
+    def test_verify_reports_missing(self, document):
+        """Test verify() passes the full document and flags a removed credential."""
+        text, embedded = document
+        removed = embedded['aws_access_key'][0]
+        
+        assert credential_utils.verify(text, embedded)['ok']
+        report = credential_utils.verify(text.replace(removed, ''), embedded)
+        assert not report['ok']
+        assert report['missing'] == [('aws_access_key', removed)]
@@ -0,0 +1,453 @@
+"""Tests for the native llama.cpp interface.
+
+These need a GGUF model; set CREDENTIALFORGE_TEST_MODEL to its path.
+"""
+
+import os
+
+import pytest
+
+llama_cpp_interface = pytest.importorskip("credentialforge.native.llama_cpp_interface")
+
+MODEL_PATH = os.environ.get('CREDENTIALFORGE_TEST_MODEL')
+
+pytestmark = pytest.mark.skipif(not MODEL_PATH or not os.path.exists(MODEL_PATH),
+                                reason="CREDENTIALFORGE_TEST_MODEL not set")
+
+
+@pytest.fixture(scope="module")
+def llama():
+    """Native interface with the test model loaded."""
+    llama_cpp_interface.init()
+    assert llama_cpp_interface.load_model(MODEL_PATH, 2)
+    return llama_cpp_interface
+
+
+class TestSubmitCollect:
+    """Test cases for submit, collect and cancel."""
+    
+    def test_collect_returns_completion(self, llama):
+        """Test a submitted prompt is collected once."""
+        request_id = llama.submit("Hello", 8, 0.0)
+        
+        assert isinstance(llama.collect(request_id), str)
+        with pytest.raises(KeyError):
+            llama.collect(request_id)
+    
+    def test_cancel_drops_request(self, llama):
+        """Test a cancelled request can no longer be collected."""
+        request_id = llama.submit("Hello", 64, 0.0)
+        
+        assert llama.cancel(request_id) is True
+        assert llama.cancel(request_id) is False
+        with pytest.raises(KeyError):
+            llama.collect(request_id, 0)
+    
+    def test_cancel_unknown_id(self, llama):
+        """Test cancelling an id that was never submitted."""
+        assert llama.cancel(-1) is False
+
+
+class TestStreaming:
+    """Test cases for generate_stream and stream."""
+    
+    def test_truncated_output_decodes(self, llama):
+        """Test output cut at any token count decodes, even mid-character."""
+        for max_tokens in range(1, 12):
+            chunks = []
+            text = llama.generate_stream("Grüße, naïve café: €", chunks.append, max_tokens, 0.0, None, 1)
+            
+            assert ''.join(chunks) == text
+            assert ''.join(llama.stream("Grüße, naïve café: €", max_tokens, 0.0)) == text
+    
+    def test_cancel_while_pending(self, llama):
+        """Test a stream cancelled before it gets a slot produces nothing."""
+        blockers = [llama.submit("Keep going", 512, 0.0) for _ in range(2)]
+        try:
+            stream = llama.stream("Hello", 32, 0.0)
+            stream.cancel()
+            
+            assert ''.join(stream) == ''
+        finally:
+            for request_id in blockers:
+                llama.cancel(request_id)
+
+
+class TestConstrainedGeneration:
+    """Test cases for grammar-constrained generation."""
+    
+    def test_grammar_limits_output(self, llama):
+        """Test output stays inside a GBNF grammar."""
+        text = llama.generate_text("Answer:", 16, 0.0, {'grammar': 'root ::= "yes" | "no"'})
+        
+        assert text in ("yes", "no")
+
+
+class TestInferenceServer:
+    """Test cases for serve, remote_generate and stop_server."""
+    
+    def test_socket_is_owner_only(self, llama, tmp_path):
+        """Test the socket is created mode 0600."""
+        path = str(tmp_path / "llm.sock")
+        llama.serve(path)
+        try:
+            assert os.stat(path).st_mode & 0o777 == 0o600
+        finally:
+            llama.stop_server()
+    
+    def test_refuses_to_replace_regular_file(self, llama, tmp_path):
+        """Test a file that is not a socket is never unlinked."""
+        path = tmp_path / "llm.sock"
+        path.write_text("keep")
+        
+        with pytest.raises(OSError):
+            llama.serve(str(path))
+        assert path.read_text() == "keep"
+    
+    def test_replaces_stale_socket(self, llama, tmp_path):
+        """Test a socket nobody listens on is replaced."""
+        import socket
+        path = str(tmp_path / "llm.sock")
+        stale = socket.socket(socket.AF_UNIX)
+        stale.bind(path)
+        stale.close()
+        
+        llama.serve(path)
+        try:
+            assert isinstance(llama.remote_generate(path, "Hello", 4, 0.0), str)
+        finally:
+            llama.stop_server()
+    
+    def test_refuses_live_socket(self, llama, tmp_path):
+        """Test a socket another server listens on is left alone."""
+        import socket
+        path = str(tmp_path / "llm.sock")
+        live = socket.socket(socket.AF_UNIX)
+        live.bind(path)
+        live.listen(1)
+        try:
+            with pytest.raises(OSError, match="listening"):
+                llama.serve(path)
+        finally:
+            live.close()
+    
+    def test_remote_batch_deeper_than_pipeline(self, llama, tmp_path):
+        """Test more prompts than one connection keeps in flight."""
+        path = str(tmp_path / "llm.sock")
+        llama.serve(path)
+        try:
+            prompts = [f"Prompt {i}" for i in range(150)]
+            results = llama.remote_generate(path, prompts, 2, 0.0)
+            
+            assert len(results) == len(prompts)
+            assert results == llama.generate_batch(prompts, 2, 0.0)
+        finally:
+            llama.stop_server()
+
+
+class TestRuntimeParams:
+    """Test cases for set_threads and set_context_params on a loaded model."""
+    
+    def test_set_threads_without_reload(self, llama):
+        """Test thread counts change between generations and output does not."""
+        saved = llama.get_context_params()
+        expected = llama.generate_text("Hello", 16, 0.0)
+        try:
+            assert llama.set_threads(2, 3) is True
+            
+            params = llama.get_context_params()
+            assert llama.get_threads() == 2
+            assert (params['n_threads'], params['n_threads_batch']) == (2, 3)
+            assert llama.generate_text("Hello", 16, 0.0) == expected
+        finally:
+            llama.set_threads(saved['n_threads'], saved['n_threads_batch'])
+    
+    def test_context_rebuild_keeps_model(self, llama):
+        """Test a new n_ctx and n_batch rebuild the context around the loaded model."""
+        saved = llama.get_context_params()
+        expected = llama.generate_text("Hello", 16, 0.0)
+        try:
+            llama.set_context_params({'n_ctx': 1024, 'n_batch': 256})
+            
+            params = llama.get_context_params()
+            assert (params['n_ctx'], params['n_batch']) == (1024, 256)
+            assert params['n_parallel'] == saved['n_parallel']
+            assert llama.is_model_loaded()
+            assert llama.generate_text("Hello", 16, 0.0) == expected
+        finally:
+            llama.set_context_params({key: saved[key] for key in ('n_ctx', 'n_batch')})
+    
+    def test_rejects_invalid_params(self, llama):
+        """Test bad thread counts and unknown parameters leave the settings alone."""
+        saved = llama.get_context_params()
+        
+        with pytest.raises(ValueError):
+            llama.set_threads(0)
+        with pytest.raises(ValueError):
+            llama.set_context_params({'bogus': 1})
+        assert llama.get_context_params() == saved
+
+
+class TestModelRegistry:
+    """Test cases for open_model, generate_with_model and close_model."""
+    
+    def test_handle_lifecycle(self, llama):
+        """Test a handle generates like the default model until it is closed."""
+        handle = llama.open_model(MODEL_PATH, 1)
+        try:
+            model = llama.get_model_stats()['models'][handle]
+            assert model['path'] == MODEL_PATH
+            assert model['resident'] is True
+            
+            assert llama.generate_with_model(handle, "Hello", 8, 0.0) == llama.generate_text("Hello", 8, 0.0)
+            assert llama.generate_with_model(handle, ["Hello", "Hey"], 4, 0.0) == \
+                llama.generate_batch(["Hello", "Hey"], 4, 0.0)
+        finally:
+            assert llama.close_model(handle) is True
+        
+        assert llama.close_model(handle) is False
+        assert handle not in llama.get_model_stats()['models']
+        with pytest.raises(RuntimeError):
+            llama.generate_with_model(handle, "Hello", 8, 0.0)
+    
+    def test_handles_share_weights(self, llama):
+        """Test two handles on one file count its mapped bytes once."""
+        first = llama.open_model(MODEL_PATH)
+        second = llama.open_model(MODEL_PATH)
+        try:
+            stats = llama.get_model_stats()
+            assert first != second
+            assert stats['resident_bytes'] == stats['models'][first]['bytes']
+        finally:
+            llama.close_model(first)
+            llama.close_model(second)
+    
+    def test_budget_evicts_idle_handles(self, llama):
+        """Test a memory budget unloads idle handles and generation reloads them."""
+        first = llama.open_model(MODEL_PATH)
+        second = llama.open_model(MODEL_PATH)
+        try:
+            expected = llama.generate_with_model(first, "Hello", 8, 0.0)
+            llama.set_model_memory_budget(1)
+            llama.generate_with_model(second, "Hello", 8, 0.0)
+            
+            stats = llama.get_model_stats()
+            assert stats['budget_bytes'] == 1
+            assert stats['models'][first]['resident'] is False
+            assert stats['models'][first]['evictions'] >= 1
+            
+            assert llama.generate_with_model(first, "Hello", 8, 0.0) == expected
+            assert llama.get_model_stats()['models'][first]['loads'] == 2
+        finally:
+            llama.set_model_memory_budget(0)
+            llama.close_model(first)
+            llama.close_model(second)
+    
+    def test_missing_file(self, llama):
+        """Test opening a file that does not exist raises."""
+        with pytest.raises(RuntimeError):
+            llama.open_model(MODEL_PATH + ".missing")
+
+
+class TestSpeculativeDecoding:
+    """Test cases for load_draft_model and get_speculative_stats."""
+    
+    PROMPTS = ("Hello", "Hey there", "Write a short note")
+    
+    def test_matches_greedy_output(self, llama):
+        """Test greedy output is the same with and without a draft model."""
+        expected = [llama.generate_text(prompt, 24, 0.0) for prompt in self.PROMPTS]
+        before = llama.get_speculative_stats()
+        
+        llama.load_draft_model(MODEL_PATH, 4)
+        try:
+            assert [llama.generate_text(prompt, 24, 0.0) for prompt in self.PROMPTS] == expected
+            
+            stats = llama.get_speculative_stats()
+            assert stats['draft_model'] == MODEL_PATH
+            assert stats['n_draft'] == 4
+            assert stats['steps'] > before['steps']
+            assert before['accepted'] < stats['accepted'] <= stats['drafted']
+            assert stats['tokens_per_verify'] > 1.0
+        finally:
+            llama.unload_draft_model()
+        
+        assert llama.get_speculative_stats()['draft_model'] == ''
+        assert [llama.generate_text(prompt, 24, 0.0) for prompt in self.PROMPTS] == expected
+    
+    def test_registry_handle_draft(self, llama):
+        """Test a registry handle speculates on its own without touching the default model."""
+        handle = llama.open_model(MODEL_PATH)
+        try:
+            expected = llama.generate_with_model(handle, "Hello", 24, 0.0)
+            llama.load_draft_model(MODEL_PATH, 3, handle)
+            
+            assert llama.generate_with_model(handle, "Hello", 24, 0.0) == expected
+            assert llama.get_model_stats()['models'][handle]['draft_model'] == MODEL_PATH
+            assert llama.get_speculative_stats(handle)['drafted'] > 0
+            assert llama.get_speculative_stats()['draft_model'] == ''
+        finally:
+            llama.close_model(handle)
+    
+    def test_missing_draft(self, llama):
+        """Test a draft file that does not exist raises and leaves decoding as it was."""
+        with pytest.raises(RuntimeError):
+            llama.load_draft_model(MODEL_PATH + ".missing", 4)
+        assert llama.get_speculative_stats()['draft_model'] == ''
+
+
+class TestStats:
+    """Test cases for get_stats and reset_stats."""
+    
+    def test_counts_tokens_per_phase(self, llama):
+        """Test prompt, first-token and decode phases are counted in tokens."""
+        llama.reset_stats()
+        text = llama.generate_text("Hi", 8, 0.0)
+        stats = llama.get_stats()
+        
+        # The test model emits one byte per token; BOS plus two bytes of prompt
+        assert stats['generated_tokens'] == len(text.encode()) == 8
+        assert stats['prompt_tokens'] == 3
+        assert stats['prompt_eval_tokens'] + stats['prompt_tokens_cached'] == stats['prompt_tokens']
+        # The first token comes out of prompt processing, the rest from decode steps
+        assert stats['ttft_count'] == 1
+        assert stats['decode_tokens'] == stats['token_latency_count'] == 7
+        assert stats['total_generations'] == 1
+        assert stats['total_tokens'] == 8
+    
+    def test_latency_percentiles_ordered(self, llama):
+        """Test the latency percentiles are ordered and bounded by the maximum."""
+        llama.reset_stats()
+        for prompt in ("Hello", "Hey there", "Write a short note"):
+            llama.generate_text(prompt, 32, 0.0)
+        stats = llama.get_stats()
+        
+        for name in ('ttft', 'token_latency'):
+            assert 0 < stats[f'{name}_p50'] <= stats[f'{name}_p95'] <= stats[f'{name}_p99']
+            assert stats[f'{name}_p99'] <= stats[f'{name}_max']
+        assert stats['ttft_count'] == 3
+        assert stats['token_latency_count'] == 3 * 31
+    
+    def test_reset_clears_counters(self, llama):
+        """Test reset_stats() zeroes the counters and histograms."""
+        llama.generate_text("Hello", 8, 0.0)
+        llama.reset_stats()
+        stats = llama.get_stats()
+        
+        assert stats['generated_tokens'] == 0
+        assert stats['ttft_count'] == 0
+        assert stats['token_latency_p99'] == 0
+    
+    def test_handle_stats_are_separate(self, llama):
+        """Test a registry handle keeps its own counters."""
+        handle = llama.open_model(MODEL_PATH)
+        try:
+            llama.reset_stats()
+            llama.generate_with_model(handle, "Hi", 8, 0.0)
+            
+            assert llama.get_stats(handle)['generated_tokens'] == 8
+            assert llama.get_stats()['generated_tokens'] == 0
+            llama.reset_stats(handle)
+            assert llama.get_stats(handle)['generated_tokens'] == 0
+        finally:
+            llama.close_model(handle)
+
+
+class TestContentCache:
+    """Test cases for the generated-content cache."""
+    
+    @pytest.fixture
+    def cache(self, llama):
+        """The interface with a cleared cache, switched off again after the test."""
+        llama.clear_content_cache()
+        yield llama
+        llama.set_content_cache({'reuse': 0, 'variants': 4, 'max_bytes': 64 << 20, 'shards': 16})
+        llama.clear_content_cache()
+    
+    def test_normalized_prompt_hits(self, cache):
+        """Test prompts differing in case and spacing share a text until its reuse runs out."""
+        cache.set_content_cache({'reuse': 3, 'variants': 1})
+        before = cache.get_content_cache_stats()
+        text = cache.generate_text("Topic: Billing  Report", 16, 0.0)
+        
+        assert cache.generate_text("topic: billing report", 16, 0.0) == text
+        assert cache.generate_text("  TOPIC:\tBilling\nReport ", 16, 0.0) == text
+        stats = cache.get_content_cache_stats()
+        assert stats['hits'] - before['hits'] == 2
+        assert stats['misses'] - before['misses'] == 1
+        assert stats['keys'] == 1
+        
+        # The third use spent the text; the next request decodes again
+        cache.generate_text("Topic: Billing Report", 16, 0.0)
+        stats = cache.get_content_cache_stats()
+        assert stats['hits'] - before['hits'] == 2
+        assert stats['misses'] - before['misses'] == 2
+        assert stats['inserts'] - before['inserts'] == 2
+    
+    def test_other_prompts_miss(self, cache):
+        """Test a different prompt or token limit is a different key."""
+        cache.set_content_cache({'reuse': 4})
+        before = cache.get_content_cache_stats()
+        cache.generate_text("Topic: billing", 16, 0.0)
+        cache.generate_text("Topic: payroll", 16, 0.0)
+        cache.generate_text("Topic: billing", 8, 0.0)
+        
+        stats = cache.get_content_cache_stats()
+        assert stats['hits'] == before['hits']
+        assert stats['misses'] - before['misses'] == 3
+        assert stats['keys'] == 3
+    
+    def test_off_by_default(self, cache):
+        """Test nothing is cached while reuse is below 2."""
+        before = cache.get_content_cache_stats()
+        cache.generate_text("Topic: billing", 16, 0.0)
+        cache.generate_text("Topic: billing", 16, 0.0)
+        
+        stats = cache.get_content_cache_stats()
+        assert stats['reuse'] < 2
+        assert (stats['hits'], stats['inserts']) == (before['hits'], before['inserts'])
+        assert stats['texts'] == 0
+    
+    def test_evicts_over_byte_limit(self, cache):
+        """Test least recently used texts are evicted to stay within max_bytes."""
+        cache.set_content_cache({'reuse': 4, 'max_bytes': 256, 'shards': 1})
+        before = cache.get_content_cache_stats()
+        for i in range(16):
+            cache.generate_text(f"Topic {i}", 32, 0.0)
+        
+        stats = cache.get_content_cache_stats()
+        evictions = stats['evictions'] - before['evictions']
+        assert stats['inserts'] - before['inserts'] == 16
+        assert evictions > 0
+        assert stats['bytes'] <= 256
+        assert stats['texts'] == 16 - evictions
+    
+    def test_save_and_reopen(self, cache, tmp_path):
+        """Test saved texts are served from the mapped file after a clear."""
+        path = str(tmp_path / "content.cache")
+        cache.set_content_cache({'reuse': 4, 'variants': 1})
+        billing = cache.generate_text("Topic: billing", 16, 0.0)
+        cache.generate_text("Topic: payroll", 16, 0.0)
+        
+        assert cache.save_content_cache(path) == 2
+        cache.clear_content_cache()
+        assert cache.get_content_cache_stats()['texts'] == 0
+        
+        assert cache.set_content_cache({'path': path}) == 2
+        stats = cache.get_content_cache_stats()
+        assert stats['mapped_bytes'] == stats['bytes'] > 0
+        hits = stats['hits']
+        assert cache.generate_text("topic:  BILLING", 16, 0.0) == billing
+        assert cache.get_content_cache_stats()['hits'] == hits + 1
+    
+    def test_reclaimed_under_memory_pressure(self, cache):
+        """Test the memory budget's reclaim drops cached texts."""
+        memory_manager = pytest.importorskip("credentialforge.native.memory_manager")
+        cache.set_content_cache({'reuse': 4})
+        cache.generate_text("Topic: billing", 16, 0.0)
+        assert memory_manager.get_budget_stats()['charged']['content_cache'] > 0
+        
+        assert memory_manager.reclaim_memory() > 0
+        stats = cache.get_content_cache_stats()
+        assert stats['texts'] == 0
+        assert memory_manager.get_budget_stats()['charged']['content_cache'] == 0
@@ -0,0 +1,252 @@
+"""Tests for the native memory manager, arenas, budget and NativeBuffer."""
+
+import threading
+
+import pytest
+
+memory_manager = pytest.importorskip("credentialforge.native.memory_manager")
+
+
+class TestNativeBuffer:
+    """Test cases for buffers from allocate()."""
+    
+    def test_allocate_is_writable(self):
+        """Test an allocated buffer can be written and read in place."""
+        memory_manager.init()
+        buf = memory_manager.allocate(16)
+        view = memoryview(buf)
+        view[:5] = b"hello"
+        
+        assert bytes(buf)[:5] == b"hello"
+        assert len(buf) == 16
+        view.release()
+    
+    def test_release_refused_while_exported(self):
+        """Test release() waits for memoryviews to go."""
+        memory_manager.init()
+        buf = memory_manager.allocate(8)
+        view = memoryview(buf)
+        
+        with pytest.raises(BufferError):
+            buf.release()
+        view.release()
+        buf.release()
+        with pytest.raises(BufferError):
+            memoryview(buf)
+
+
+class TestArena:
+    """Test cases for arena_allocate and arena_reset."""
+    
+    @pytest.fixture
+    def small_chunks(self):
+        """64 KiB chunks without huge pages; the previous settings are restored."""
+        saved = memory_manager.get_arena_stats()
+        memory_manager.configure_arena({'chunk_size': 1 << 16, 'huge_pages': False})
+        yield 1 << 16
+        memory_manager.configure_arena({key: saved[key] for key in
+                                        ('chunk_size', 'max_retained', 'huge_pages', 'tracking')})
+    
+    def test_reset_refused_while_buffer_alive(self):
+        """Test arena_reset() refuses while a buffer from it is alive."""
+        buf = memory_manager.arena_allocate(64)
+        
+        with pytest.raises(BufferError):
+            memory_manager.arena_reset()
+        del buf
+        memory_manager.arena_reset()
+    
+    def test_buffer_outlives_its_thread(self):
+        """Test a buffer stays readable after the thread that allocated it exits."""
+        buffers = []
+        
+        def allocate():
+            buf = memory_manager.arena_allocate(1 << 16)
+            memoryview(buf)[:] = b"x" * (1 << 16)
+            buffers.append(buf)
+        
+        for _ in range(4):
+            thread = threading.Thread(target=allocate)
+            thread.start()
+            thread.join()
+        
+        # Later threads would reuse the freed chunks if they were not kept
+        assert all(bytes(buf) == b"x" * (1 << 16) for buf in buffers)
+    
+    def test_stats(self):
+        """Test get_arena_stats() reports reserved memory."""
+        buf = memory_manager.arena_allocate(1024)
+        stats = memory_manager.get_arena_stats()
+        
+        assert stats['arenas'] >= 1
+        assert stats['bytes_reserved'] >= 1024
+        del buf
+    
+    def test_reset_reuses_memory(self):
+        """Test arena_reset() hands the same memory out again and counts the reset."""
+        memory_manager.arena_reset()
+        buf = memory_manager.arena_allocate(1000)
+        address = buf.address
+        resets = memory_manager.get_arena_stats()['resets']
+        del buf
+        
+        memory_manager.arena_reset()
+        buf = memory_manager.arena_allocate(1000)
+        
+        assert buf.address == address
+        assert memory_manager.get_arena_stats()['resets'] == resets + 1
+        del buf
+        memory_manager.arena_reset()
+    
+    def test_grows_by_chunks(self, small_chunks):
+        """Test an arena adds chunks as it fills and takes oversized requests whole."""
+        results = {}
+        
+        def allocate():
+            before = memory_manager.get_arena_stats()
+            buffers = [memory_manager.arena_allocate(40000) for _ in range(4)]
+            results['filled'] = memory_manager.get_arena_stats()['chunks'] - before['chunks']
+            buffers.append(memory_manager.arena_allocate(4 * small_chunks))
+            results['oversized'] = memory_manager.get_arena_stats()['chunks'] - before['chunks']
+            results['length'] = len(buffers[-1])
+            
+            del buffers
+            memory_manager.arena_reset(True)
+            results['released'] = memory_manager.get_arena_stats()['chunks'] - before['chunks']
+        
+        thread = threading.Thread(target=allocate)
+        thread.start()
+        thread.join()
+        
+        # Two 40000-byte blocks do not share a 64 KiB chunk
+        assert results['filled'] == 4
+        assert results['oversized'] == 5
+        assert results['length'] == 4 * small_chunks
+        assert results['released'] == 0
+    
+    def test_threads_are_isolated(self):
+        """Test threads allocate from their own arenas and reset independently."""
+        held = memory_manager.arena_allocate(256)
+        memoryview(held)[:] = b"m" * 256
+        barrier = threading.Barrier(4)
+        errors = []
+        
+        def work(index):
+            try:
+                buf = memory_manager.arena_allocate(256)
+                memoryview(buf)[:] = bytes([index]) * 256
+                barrier.wait()
+                assert bytes(buf) == bytes([index]) * 256
+                del buf
+                # The main thread's live buffer does not block this thread's reset
+                memory_manager.arena_reset()
+            except Exception as exc:
+                errors.append(exc)
+        
+        threads = [threading.Thread(target=work, args=(i,)) for i in range(4)]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        
+        assert errors == []
+        assert bytes(held) == b"m" * 256
+        with pytest.raises(BufferError):
+            memory_manager.arena_reset()
+        del held
+        memory_manager.arena_reset()
+
+
+class TestBudget:
+    """Test cases for the process-wide memory budget."""
+    
+    @pytest.fixture
+    def configure_budget(self):
+        """configure_budget(), with the default budget put back after the test."""
+        yield memory_manager.configure_budget
+        memory_manager.configure_budget({'limit': 0, 'soft_fraction': 0.85, 'hard_fraction': 0.95,
+                                         'throttle_timeout': 30.0, 'sample_interval': 0.01,
+                                         'enforce': True})
+    
+    @pytest.fixture
+    def executor(self):
+        """Two-worker executor whose submissions are throttled by the budget."""
+        parallel_executor = pytest.importorskip("credentialforge.native.parallel_executor")
+        parallel_executor.init_executor(2)
+        yield parallel_executor
+        parallel_executor.shutdown()
+    
+    def test_manager_allocations_charged(self):
+        """Test allocate() charges the manager category until the buffer is freed."""
+        memory_manager.init()
+        before = memory_manager.get_budget_stats()['charged']['manager']
+        buf = memory_manager.allocate(1 << 20)
+        
+        stats = memory_manager.get_budget_stats()
+        assert stats['charged']['manager'] == before + (1 << 20)
+        assert stats['charged_total'] >= stats['charged']['manager']
+        
+        memory_manager.deallocate(buf)
+        assert memory_manager.get_budget_stats()['charged']['manager'] == before
+    
+    def test_limits_follow_configuration(self, configure_budget):
+        """Test the soft and hard limits are the configured shares of the limit."""
+        configure_budget({'limit': 1 << 30, 'soft_fraction': 0.5, 'hard_fraction': 0.75})
+        stats = memory_manager.get_budget_stats()
+        
+        assert stats['limit'] == 1 << 30
+        assert stats['soft_limit'] == 1 << 29
+        assert stats['hard_limit'] == 3 << 28
+        assert stats['pressure'] == 'normal'
+    
+    def test_submission_rejected_over_hard_limit(self, executor, configure_budget):
+        """Test work is refused after reclaiming and throttling fail to get under the limit."""
+        before = memory_manager.get_budget_stats()
+        configure_budget({'limit': 1 << 20, 'throttle_timeout': 0.05})
+        
+        with pytest.raises(MemoryError):
+            executor.submit_task(abs, (-1,))
+        
+        stats = memory_manager.get_budget_stats()
+        assert stats['pressure'] == 'hard'
+        assert stats['throttled'] == before['throttled'] + 1
+        assert stats['throttle_rejected'] == before['throttle_rejected'] + 1
+        assert stats['throttle_wait_time'] - before['throttle_wait_time'] >= 0.05
+        assert stats['reclaims'] > before['reclaims']
+    
+    def test_throttled_submission_resumes(self, executor, configure_budget):
+        """Test a throttled submission goes through once usage is back under the limit."""
+        before = memory_manager.get_budget_stats()
+        configure_budget({'limit': 1 << 20, 'throttle_timeout': 10.0})
+        
+        raise_limit = threading.Timer(0.1, configure_budget, ({'limit': 0},))
+        raise_limit.start()
+        future = executor.submit_task(abs, (-1,))
+        raise_limit.join()
+        
+        assert future.result(5) == 1
+        stats = memory_manager.get_budget_stats()
+        assert stats['throttled'] == before['throttled'] + 1
+        assert stats['throttle_rejected'] == before['throttle_rejected']
+        assert stats['throttle_wait_time'] - before['throttle_wait_time'] >= 0.05
+    
+    def test_report_only_when_not_enforcing(self, executor, configure_budget):
+        """Test enforce=False reports pressure without holding back work."""
+        before = memory_manager.get_budget_stats()
+        configure_budget({'limit': 1 << 20, 'enforce': False})
+        
+        assert executor.submit_task(abs, (-1,)).result(5) == 1
+        stats = memory_manager.get_budget_stats()
+        assert stats['pressure'] == 'hard'
+        assert stats['enforce'] is False
+        assert stats['throttled'] == before['throttled']
+    
+    def test_reclaim_memory_counts(self):
+        """Test reclaim_memory() runs the reclaimers and updates the counters."""
+        before = memory_manager.get_budget_stats()
+        freed = memory_manager.reclaim_memory()
+        
+        stats = memory_manager.get_budget_stats()
+        assert freed >= 0
+        assert stats['reclaims'] == before['reclaims'] + 1
+        assert stats['bytes_reclaimed'] == before['bytes_reclaimed'] + freed
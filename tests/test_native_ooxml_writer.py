@@ -0,0 +1,98 @@
+"""Tests for the native streaming OOXML writers."""
+
+import zipfile
+
+import pytest
+
+ooxml_writer = pytest.importorskip("credentialforge.native.ooxml_writer")
+
+
+class TestXlsxWriter:
+    """Test cases for ooxml_writer.XlsxWriter."""
+    
+    def test_round_trip(self, tmp_path):
+        """Test a workbook written with keywords reads back."""
+        path = tmp_path / "book.xlsx"
+        with ooxml_writer.XlsxWriter(path=str(path), options={'title': 'Keys'}) as writer:
+            writer.add_sheet(name="Credentials", widths=[20, 40])
+            writer.write_row(values=["service", "key"], style="header")
+            writer.write_rows(rows=[["aws", "AKIAEXAMPLE"], ["count", 2]])
+            writer.skip_rows(n=1)
+            writer.write_column(values=["a", "b"], before=["left"], after=[1.5])
+        
+        with zipfile.ZipFile(path) as archive:
+            assert archive.testzip() is None
+            sheet = archive.read("xl/worksheets/sheet1.xml").decode()
+        assert "AKIAEXAMPLE" in sheet
+        
+        openpyxl = pytest.importorskip("openpyxl")
+        rows = list(openpyxl.load_workbook(path)["Credentials"].iter_rows(values_only=True))
+        assert rows[0] == ("service", "key", None)
+        assert rows[1][:2] == ("aws", "AKIAEXAMPLE")
+        assert rows[2][:2] == ("count", 2)
+        assert rows[4] == ("left", "a", 1.5)
+    
+    def test_close_twice(self, tmp_path):
+        """Test a second close() returns the first one's stats."""
+        writer = ooxml_writer.XlsxWriter(str(tmp_path / "book.xlsx"))
+        writer.add_sheet("Sheet1")
+        writer.write_row(["x"])
+        
+        stats = writer.close()
+        assert writer.close() == stats
+        assert stats['rows'] == 1
+        with pytest.raises(ValueError):
+            writer.write_row(["y"])
+    
+    def test_close_after_abort(self, tmp_path):
+        """Test close() after abort() does nothing."""
+        path = tmp_path / "book.xlsx"
+        writer = ooxml_writer.XlsxWriter(str(path))
+        writer.abort()
+        
+        assert writer.close() is None
+        assert not path.exists()
+
+
+class TestDocxWriter:
+    """Test cases for ooxml_writer.DocxWriter."""
+    
+    def test_round_trip(self, tmp_path):
+        """Test a document written with keywords reads back."""
+        path = tmp_path / "doc.docx"
+        with ooxml_writer.DocxWriter(str(path)) as writer:
+            writer.add_heading(text="Runbook", level=0)
+            writer.add_paragraph(text="token: ghp_example", bold=True)
+            writer.add_paragraphs(texts=["one", "two"])
+            writer.add_table(rows=[["name", "value"], ["user", "admin"]], header=True)
+        
+        with zipfile.ZipFile(path) as archive:
+            assert archive.testzip() is None
+            body = archive.read("word/document.xml").decode()
+        assert "ghp_example" in body
+        
+        docx = pytest.importorskip("docx")
+        document = docx.Document(str(path))
+        assert [p.text for p in document.paragraphs][:4] == ["Runbook", "token: ghp_example", "one", "two"]
+        assert document.tables[0].cell(1, 1).text == "admin"
+
+
+class TestPptxWriter:
+    """Test cases for ooxml_writer.PptxWriter."""
+    
+    def test_round_trip(self, tmp_path):
+        """Test a presentation written with keywords reads back."""
+        path = tmp_path / "deck.pptx"
+        with ooxml_writer.PptxWriter(str(path)) as writer:
+            writer.add_title_slide(title="Rotation", subtitle="Q3")
+            writer.add_slide(title="Keys", paragraphs=["AKIAEXAMPLE"], notes=["rotate"])
+        
+        with zipfile.ZipFile(path) as archive:
+            assert archive.testzip() is None
+            assert "AKIAEXAMPLE" in archive.read("ppt/slides/slide2.xml").decode()
+        
+        pptx = pytest.importorskip("pptx")
+        slides = pptx.Presentation(str(path)).slides
+        assert len(slides) == 2
+        assert slides[0].shapes.title.text == "Rotation"
+        assert slides[1].notes_slide.notes_text_frame.text == "rotate"
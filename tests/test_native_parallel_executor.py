@@ -0,0 +1,187 @@
+"""Tests for the native parallel executor."""
+
+import pytest
+
+parallel_executor = pytest.importorskip("credentialforge.native.parallel_executor")
+
+
+@pytest.fixture
+def executor():
+    """Executor with four workers, shut down afterwards."""
+    parallel_executor.shutdown()
+    parallel_executor.init_executor(4)
+    yield parallel_executor
+    parallel_executor.shutdown()
+
+
+def _square(x):
+    return x * x
+
+
+class TestExecutor:
+    """Test cases for submitting tasks."""
+    
+    def test_submit_task_result(self, executor):
+        """Test a task's return value reaches its future."""
+        assert executor.submit_task(_square, (7,)).result(30) == 49
+    
+    def test_task_exception_is_raised(self, executor):
+        """Test result() raises what the task raised."""
+        future = executor.submit_task(lambda: 1 / 0, ())
+        
+        with pytest.raises(ZeroDivisionError):
+            future.result(30)
+    
+    def test_map_keeps_input_order(self, executor):
+        """Test map() returns results in input order."""
+        assert executor.map(_square, range(100), 30) == [x * x for x in range(100)]
+    
+    def test_done_callback(self, executor):
+        """Test a done callback receives the finished future."""
+        import threading
+        called = threading.Event()
+        future = executor.submit_task(_square, (3,))
+        future.add_done_callback(lambda f: called.set() if f.result() == 9 else None)
+        
+        assert called.wait(30)
+        assert future.done()
+    
+    def test_stats_count_tasks(self, executor):
+        """Test completed tasks show up in get_stats()."""
+        executor.map(_square, range(10), 30)
+        executor.wait_for_completion()
+        stats = executor.get_stats()
+        
+        assert stats['num_threads'] == 4
+        assert stats['completed_tasks'] >= 10
+
+
+class TestPipeline:
+    """Test cases for Pipeline."""
+    
+    def test_run_in_input_order(self):
+        """Test run() applies every stage and keeps input order."""
+        pipeline = parallel_executor.Pipeline([(lambda x: x + 1, 3, 'add'), (lambda x: x * 2, 2, 'double')], 4)
+        
+        assert pipeline.run(range(50)) == [(x + 1) * 2 for x in range(50)]
+    
+    def test_stats_name_stages(self):
+        """Test stats() reports each stage and a bottleneck."""
+        pipeline = parallel_executor.Pipeline([(_square, 2, 'square'), (str, 1, 'format')])
+        pipeline.run(range(10))
+        stats = pipeline.stats()
+        
+        assert [stage['name'] for stage in stats['stages']] == ['square', 'format']
+        assert all(stage['processed'] == 10 for stage in stats['stages'])
+        assert stats['bottleneck'] in ('square', 'format')
+    
+    def test_stage_exception_is_raised(self):
+        """Test run() raises what a stage raised."""
+        pipeline = parallel_executor.Pipeline([lambda x: 1 / x])
+        
+        with pytest.raises(ZeroDivisionError):
+            pipeline.run([1, 0, 2])
+    
+    def test_put_get(self):
+        """Test items fed with put() come back from get() until drained."""
+        pipeline = parallel_executor.Pipeline([lambda x: -x])
+        seqs = [pipeline.put(x) for x in (3, 4, 5)]
+        pipeline.close()
+        
+        results = []
+        while (item := pipeline.get(30)) is not None:
+            results.append(item)
+        
+        assert sorted(results) == [(seq, -x) for seq, x in zip(seqs, (3, 4, 5))]
+
+
+class TestNestedWaits:
+    """Test cases for tasks that wait on tasks they submitted."""
+    
+    def test_result_inside_saturated_pool(self, executor):
+        """Test more outer tasks than workers, each waiting on an inner task."""
+        def outer(x):
+            return executor.submit_task(_square, (x,)).result(30)
+        
+        futures = executor.submit_many(outer, range(8))
+        
+        assert [f.result(30) for f in futures] == [x * x for x in range(8)]
+    
+    def test_map_inside_saturated_pool(self, executor):
+        """Test map() called from every worker at once."""
+        def outer(x):
+            return sum(executor.map(_square, range(x, x + 4), 30))
+        
+        results = executor.map(outer, range(8), 60)
+        
+        assert results == [sum(y * y for y in range(x, x + 4)) for x in range(8)]
+    
+    def test_timeout_inside_pool(self, executor):
+        """Test a worker waiting on a running task still honours the timeout."""
+        import threading
+        started = threading.Event()
+        release = threading.Event()
+        
+        def blocked():
+            started.set()
+            return release.wait(30)
+        
+        inner = executor.submit_task(blocked, ())
+        assert started.wait(30)
+        
+        def outer():
+            with pytest.raises(TimeoutError):
+                inner.result(0.05)
+            release.set()
+            return inner.result(30)
+        
+        assert executor.submit_task(outer, ()).result(30) is True
+
+
+class TestWorkStealing:
+    """Test cases for idle workers taking tasks queued on a busy worker."""
+    
+    def test_fan_out_is_stolen(self, executor):
+        """Test children one worker submits are run by the idle ones."""
+        import threading
+        import time
+        before = executor.get_stats()['stolen_tasks']
+        
+        def child(x):
+            # Sleeping drops the GIL so several children can run at once
+            time.sleep(0.01)
+            return x, threading.get_ident()
+        
+        def parent():
+            futures = executor.submit_many(child, range(32))
+            return [f.result(30) for f in futures]
+        
+        results = executor.submit_task(parent, ()).result(60)
+        stats = executor.get_stats()
+        
+        assert [x for x, _ in results] == list(range(32))
+        assert len({ident for _, ident in results}) > 1
+        assert stats['stolen_tasks'] > before
+        assert stats['num_threads'] == 4
+    
+    def test_recursive_fan_out(self, executor):
+        """Test a task tree built from inside workers completes with every task counted."""
+        import time
+        before = executor.get_stats()
+        
+        def tree(depth):
+            if depth == 0:
+                # Without it the tree is done before sleeping workers wake
+                time.sleep(0.002)
+                return 1
+            futures = [executor.submit_task(tree, (depth - 1,)) for _ in range(3)]
+            return 1 + sum(f.result(30) for f in futures)
+        
+        # 1 + 3 + 9 + 27 + 81 tasks
+        assert executor.submit_task(tree, (4,)).result(60) == 121
+        executor.wait_for_completion()
+        stats = executor.get_stats()
+        
+        assert stats['completed_tasks'] - before['completed_tasks'] == 121
+        assert stats['stolen_tasks'] > before['stolen_tasks']
+        assert stats['pending_tasks'] == 0
@@ -0,0 +1,62 @@
+"""Tests for the native template engine."""
+
+import os
+
+import pytest
+
+template_engine = pytest.importorskip("credentialforge.native.template_engine")
+credential_utils = pytest.importorskip("credentialforge.native.credential_utils")
+
+REGEX_DB_PATH = os.path.join(os.path.dirname(__file__), '..', 'data', 'regex_db.json')
+
+SOURCE = ("<h>{{field:title}}</h><p>{{company}}</p><p>{{paragraph}}</p>"
+          "<p>{{credential:aws_access_key:key}} {{credential:aws_access_key:key}} {{credential:jwt_token}}</p>")
+
+
+@pytest.fixture
+def template():
+    """An XML-escaping template with every kind of slot."""
+    credential_utils.compile_patterns(REGEX_DB_PATH)
+    return template_engine.Template(source=SOURCE, options={'escape': 'xml'})
+
+
+class TestTemplate:
+    """Test cases for template_engine.Template."""
+    
+    def test_render_keywords(self, template):
+        """Test render() fills every slot from keyword arguments."""
+        buffer, credentials = template.render(paragraphs=["A & B"], company="Acme", fields={'title': "Runbook"})
+        text = bytes(buffer).decode()
+        
+        assert text.startswith("<h>Runbook</h><p>Acme</p><p>A &amp; B</p>")
+        assert [t for t, _ in credentials] == ['aws_access_key', 'jwt_token']
+        assert text.count(credentials[0][1]) == 2
+        assert credential_utils.validate_batch([t for t, _ in credentials], [c for _, c in credentials]) == [True, True]
+    
+    def test_render_positional(self, template):
+        """Test positional arguments still work."""
+        buffer, _ = template.render(["text"], "Acme", {'title': "T"})
+        
+        assert b"<p>text</p>" in bytes(buffer)
+    
+    def test_unknown_keyword(self, template):
+        """Test an unknown keyword raises TypeError."""
+        with pytest.raises(TypeError):
+            template.render(paragraph=["text"])
+    
+    def test_write_batch_keywords(self, template, tmp_path):
+        """Test write() and write_batch() take keywords and report what they embedded."""
+        document = {'paragraphs': ["p"], 'company': "Acme", 'fields': {'title': "T"}}
+        single = template.write(path=str(tmp_path / "one.xml"), **document)
+        batch = template.write_batch(paths=[str(tmp_path / "a.xml"), str(tmp_path / "b.xml")],
+                                     documents=[document, document])
+        
+        assert single[0][1] in (tmp_path / "one.xml").read_text()
+        assert len(batch) == 2
+        assert batch[1][1][1] in (tmp_path / "b.xml").read_text()
+    
+    def test_slots(self, template):
+        """Test slots() lists the compiled slots in order."""
+        kinds = [kind for kind, _ in template.slots()]
+        
+        assert kinds == ['field', 'company', 'paragraph', 'credential', 'credential', 'credential']
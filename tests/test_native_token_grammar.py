@@ -0,0 +1,71 @@
+"""Tests for GBNF grammars and JSON schema conversion.
+
+Compiling needs no model; constrained generation is tested with the model
+in test_native_llama_interface.py.
+"""
+
+import json
+
+import pytest
+
+llama_cpp_interface = pytest.importorskip("credentialforge.native.llama_cpp_interface")
+
+SCHEMA = {
+    'type': 'object',
+    'properties': {'key': {'type': 'string'}, 'rotations': {'type': 'integer'}},
+    'required': ['key', 'rotations'],
+}
+
+
+class TestCompileGrammar:
+    """Test cases for compile_grammar."""
+    
+    def test_counts_rules(self):
+        """Test a valid grammar compiles to its rule count."""
+        assert llama_cpp_interface.compile_grammar('root ::= answer\nanswer ::= "yes" | "no"') == 2
+    
+    def test_undefined_rule(self):
+        """Test a reference to a missing rule is rejected."""
+        with pytest.raises(ValueError, match="Undefined rule"):
+            llama_cpp_interface.compile_grammar('root ::= missing')
+    
+    def test_syntax_error(self):
+        """Test a syntax error names the line."""
+        with pytest.raises(ValueError, match="line 1"):
+            llama_cpp_interface.compile_grammar('root ::= (')
+    
+    def test_cache(self):
+        """Test compiling the same grammar twice hits the cache."""
+        llama_cpp_interface.clear_grammar_cache()
+        before = llama_cpp_interface.get_grammar_cache_stats()
+        llama_cpp_interface.compile_grammar('root ::= "a"+')
+        llama_cpp_interface.compile_grammar('root ::= "a"+')
+        after = llama_cpp_interface.get_grammar_cache_stats()
+        
+        assert after['grammars'] == 1
+        assert after['compiles'] - before['compiles'] == 1
+        assert after['hits'] - before['hits'] == 1
+
+
+class TestJsonSchema:
+    """Test cases for json_schema_to_grammar."""
+    
+    def test_required_properties_in_order(self):
+        """Test the root rule requires every property, in schema order."""
+        grammar = llama_cpp_interface.json_schema_to_grammar(SCHEMA)
+        rules = dict(line.split(' ::= ', 1) for line in grammar.splitlines() if line)
+        
+        assert rules['root'].index('root-key-kv') < rules['root'].index('root-rotations-kv')
+        assert 'integer' in rules['root-rotations-kv']
+        assert 'string' in rules['root-key-kv']
+    
+    def test_accepts_json_text(self):
+        """Test a schema given as JSON text converts the same as a dict."""
+        assert (llama_cpp_interface.json_schema_to_grammar(json.dumps(SCHEMA)) ==
+                llama_cpp_interface.json_schema_to_grammar(SCHEMA))
+    
+    def test_output_compiles(self):
+        """Test the generated grammar is valid GBNF."""
+        grammar = llama_cpp_interface.json_schema_to_grammar(SCHEMA)
+        
+        assert llama_cpp_interface.compile_grammar(grammar) > 0
@@ -0,0 +1,96 @@
+"""Tests for the native tracing module."""
+
+import json
+import threading
+
+import pytest
+
+tracing = pytest.importorskip("credentialforge.native.tracing")
+
+
+@pytest.fixture
+def trace():
+    """Tracing enabled for Python and executor spans, cleared afterwards."""
+    tracing.clear()
+    tracing.enable(['python', 'executor'], 1024)
+    yield tracing
+    tracing.disable()
+    tracing.clear()
+
+
+def _events(trace, name):
+    return [event for event in json.loads(trace.export())['traceEvents'] if event.get('name') == name]
+
+
+class TestTracing:
+    """Test cases for recording and exporting spans."""
+    
+    def test_enable_reports_categories(self, trace):
+        """Test enable() returns the categories now recorded."""
+        assert trace.enable(['python']) == ['python']
+        assert trace.is_enabled('python')
+        assert not trace.is_enabled('llm')
+    
+    def test_recorded_span_is_exported(self, trace):
+        """Test a span recorded from Python shows up with its value."""
+        start = trace.now_ns()
+        trace.record('test.block', start, start + 2000, 'python', 7)
+        
+        events = _events(trace, 'test.block')
+        
+        assert len(events) == 1
+        assert events[0]['ph'] == 'X'
+        assert events[0]['dur'] == pytest.approx(2.0)
+        assert events[0]['args'] == {'value': 7}
+    
+    def test_executor_spans(self, trace):
+        """Test executor tasks record their own spans."""
+        parallel_executor = pytest.importorskip("credentialforge.native.parallel_executor")
+        parallel_executor.shutdown()
+        parallel_executor.init_executor(2)
+        parallel_executor.map(abs, range(4), 30)
+        parallel_executor.shutdown()
+        
+        assert len(_events(trace, 'executor.task')) == 4
+    
+    def test_disabled_category_not_recorded(self, trace):
+        """Test spans outside the enabled categories are dropped."""
+        start = trace.now_ns()
+        trace.record('test.llm', start, start + 1, 'llm')
+        trace.disable()
+        trace.record('test.after', start, start + 1)
+        
+        assert _events(trace, 'test.llm') == []
+        assert _events(trace, 'test.after') == []
+    
+    def test_ring_wraps(self, trace):
+        """Test a full ring overwrites its oldest spans and counts them."""
+        def record():
+            start = trace.now_ns()
+            for i in range(3000):
+                trace.record('test.wrap', start + i, start + i + 1)
+        
+        # A new thread gets a ring of the size enabled above
+        thread = threading.Thread(target=record)
+        thread.start()
+        thread.join()
+        stats = trace.get_stats()
+        
+        assert stats['overwritten'] > 0
+        assert len(_events(trace, 'test.wrap')) <= stats['ring_events']
+    
+    def test_export_to_file(self, trace, tmp_path):
+        """Test export(path) writes loadable JSON and returns the span count."""
+        start = trace.now_ns()
+        trace.record('test.file', start, start + 1)
+        path = tmp_path / "trace.json"
+        
+        count = trace.export(str(path))
+        
+        assert count >= 1
+        assert any(event.get('name') == 'test.file' for event in json.loads(path.read_text())['traceEvents'])
+    
+    def test_unknown_category(self, trace):
+        """Test an unknown category name raises ValueError."""
+        with pytest.raises(ValueError):
+            trace.record('test.bad', 1, 2, 'no-such-category')